@@ -0,0 +1,102 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <benchmark/benchmark.h>
+#include <random>
+#include <repo/core/handler/fileservice/repo_blob_files_handler.h>
+
+#include "repo_bench_utils.h"
+
+using namespace repo::bench::utils;
+using namespace repo::core::handler::fileservice;
+
+static std::vector<uint8_t> makeBuffer(size_t size)
+{
+	std::mt19937 rng(size);
+	std::vector<uint8_t> buffer(size);
+	for (auto& b : buffer) {
+		b = (uint8_t)rng();
+	}
+	return buffer;
+}
+
+static void BM_BlobFilesHandler_Write(benchmark::State& state)
+{
+	auto handler = getHandler();
+	auto buffer = makeBuffer(state.range(0));
+	auto count = state.range(1);
+
+	for (auto _ : state) {
+		state.PauseTiming();
+		auto project = makeProjectName("BlobFilesHandler");
+		state.ResumeTiming();
+
+		{
+			BlobFilesHandler blobHandler(handler->getFileManager(), REPO_BENCH_DBNAME, project + ".scene");
+			for (int64_t i = 0; i < count; i++) {
+				benchmark::DoNotOptimize(blobHandler.insertBinary(buffer));
+			}
+			blobHandler.finished();
+		}
+
+		state.PauseTiming();
+		dropProject(handler.get(), REPO_BENCH_DBNAME, project);
+		state.ResumeTiming();
+	}
+
+	state.SetBytesProcessed(state.iterations() * count * buffer.size());
+}
+
+static void BM_BlobFilesHandler_Read(benchmark::State& state)
+{
+	auto handler = getHandler();
+	auto buffer = makeBuffer(state.range(0));
+	auto count = state.range(1);
+
+	auto project = makeProjectName("BlobFilesHandler");
+	std::vector<DataRef> refs;
+	{
+		BlobFilesHandler blobHandler(handler->getFileManager(), REPO_BENCH_DBNAME, project + ".scene");
+		for (int64_t i = 0; i < count; i++) {
+			refs.push_back(blobHandler.insertBinary(buffer));
+		}
+		blobHandler.finished();
+	}
+
+	for (auto _ : state) {
+		BlobFilesHandler blobHandler(handler->getFileManager(), REPO_BENCH_DBNAME, project + ".scene");
+		for (const auto& ref : refs) {
+			benchmark::DoNotOptimize(blobHandler.readToBuffer(ref));
+		}
+	}
+
+	state.SetBytesProcessed(state.iterations() * count * buffer.size());
+
+	dropProject(handler.get(), REPO_BENCH_DBNAME, project);
+}
+
+BENCHMARK(BM_BlobFilesHandler_Write)
+	->Args({ 4096, 10000 })
+	->Args({ 1 << 20, 500 })
+	->Unit(benchmark::kMillisecond)
+	->UseRealTime();
+
+BENCHMARK(BM_BlobFilesHandler_Read)
+	->Args({ 4096, 10000 })
+	->Args({ 1 << 20, 500 })
+	->Unit(benchmark::kMillisecond)
+	->UseRealTime();
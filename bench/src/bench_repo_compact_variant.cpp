@@ -0,0 +1,211 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <benchmark/benchmark.h>
+#include <repo/lib/datastructure/repo_compact_variant.h>
+#include <repo/lib/datastructure/repo_variant_utils.h>
+#include <repo/core/model/bson/repo_bson_builder.h>
+#include <repo/core/model/bson/repo_node_metadata.h>
+
+#include <random>
+
+// Compares RepoVariant with RepoCompactVariant for the operations performed on
+// large amounts of metadata: building the values, copying them (e.g. when
+// merging parent metadata), and serialising them to strings and BSON. The
+// values are a mix similar to that of a typical BIM file.
+
+static void makeDate(repo::lib::RepoVariant& v, int year, int day)
+{
+	tm t = {};
+	t.tm_year = year;
+	t.tm_mday = day;
+	t.tm_isdst = -1;
+	v = t;
+}
+
+static void makeDate(repo::lib::RepoCompactVariant& v, int year, int day)
+{
+	v = repo::lib::RepoTimestamp{ ((year - 70) * 365LL + day) * 86400000LL };
+}
+
+template<typename T>
+static std::vector<T> generateValues(size_t count)
+{
+	std::mt19937 rng(0);
+	std::uniform_real_distribution<double> real(0, 1000);
+	std::vector<T> values(count);
+	for (auto& v : values) {
+		switch (rng() % 8) {
+		case 0:
+			v = (bool)(rng() % 2);
+			break;
+		case 1:
+			v = (int)(rng() % 1000);
+			break;
+		case 2:
+			v = (int64_t)(rng() * 1000003ull);
+			break;
+		case 3:
+		case 4:
+			v = real(rng);
+			break;
+		case 5:
+			v = std::string("Type ") + std::to_string(rng() % 100);
+			break;
+		case 6:
+			v = std::string("Level 1 - Ground Floor Structural Slab Finish ") + std::to_string(rng() % 100);
+			break;
+		case 7:
+			makeDate(v, 100 + rng() % 25, 1 + rng() % 28);
+			break;
+		}
+	}
+	return values;
+}
+
+static void appendString(std::string& s, const repo::lib::RepoVariant& v)
+{
+	s += boost::apply_visitor(repo::lib::StringConversionVisitor(), v);
+}
+
+static void appendString(std::string& s, const repo::lib::RepoCompactVariant& v)
+{
+	v.appendString(s);
+}
+
+template<typename T>
+static void BM_Variant_Build(benchmark::State& state)
+{
+	for (auto _ : state) {
+		auto values = generateValues<T>(state.range(0));
+		benchmark::DoNotOptimize(values.data());
+	}
+	state.counters["bytes"] = state.range(0) * sizeof(T);
+}
+
+template<typename T>
+static void BM_Variant_Copy(benchmark::State& state)
+{
+	auto values = generateValues<T>(state.range(0));
+	for (auto _ : state) {
+		std::vector<T> copy(values);
+		benchmark::DoNotOptimize(copy.data());
+	}
+}
+
+template<typename T>
+static void BM_Variant_String(benchmark::State& state)
+{
+	auto values = generateValues<T>(state.range(0));
+	size_t length = 0;
+	for (auto _ : state) {
+		std::string s;
+		for (const auto& v : values) {
+			s.clear();
+			appendString(s, v);
+			length += s.size();
+		}
+	}
+	benchmark::DoNotOptimize(length);
+}
+
+// Writes the values as metadata nodes would, one document per 100 entries
+
+template<typename T>
+static void BM_Variant_BSON(benchmark::State& state)
+{
+	auto values = generateValues<T>(state.range(0));
+	size_t size = 0;
+	for (auto _ : state) {
+		for (size_t i = 0; i < values.size(); i += 100) {
+			repo::core::model::RepoBSONBuilder builder;
+			for (size_t j = i; j < std::min(values.size(), i + 100); j++) {
+				builder.appendRepoVariant("value", values[j]);
+			}
+			size += builder.obj().objsize();
+		}
+	}
+	benchmark::DoNotOptimize(size);
+}
+
+static void BM_CompactVariant_Json(benchmark::State& state)
+{
+	auto values = generateValues<repo::lib::RepoCompactVariant>(state.range(0));
+	size_t length = 0;
+	for (auto _ : state) {
+		std::string s;
+		for (const auto& v : values) {
+			s.clear();
+			v.appendJson(s);
+			length += s.size();
+		}
+	}
+	benchmark::DoNotOptimize(length);
+}
+
+// Serialises metadata nodes of 100 entries each, which hold their values as
+// RepoCompactVariants
+
+static void BM_MetadataNode_Serialise(benchmark::State& state)
+{
+	auto values = generateValues<repo::lib::RepoVariant>(state.range(0));
+	std::vector<repo::core::model::MetadataNode> nodes;
+	for (size_t i = 0; i < values.size(); i += 100) {
+		std::unordered_map<std::string, repo::lib::RepoVariant> metadata;
+		for (size_t j = i; j < std::min(values.size(), i + 100); j++) {
+			metadata["Parameter " + std::to_string(j - i)] = values[j];
+		}
+		nodes.emplace_back();
+		nodes.back().setMetadata(metadata);
+	}
+
+	size_t size = 0;
+	for (auto _ : state) {
+		for (const auto& node : nodes) {
+			size += ((repo::core::model::RepoBSON)node).objsize();
+		}
+	}
+	benchmark::DoNotOptimize(size);
+}
+
+#define VARIANT_BENCHMARK(func, type) \
+	BENCHMARK_TEMPLATE(func, type) \
+		->Arg(10000000) \
+		->Iterations(1) \
+		->Unit(benchmark::kMillisecond) \
+		->UseRealTime()
+
+VARIANT_BENCHMARK(BM_Variant_Build, repo::lib::RepoVariant);
+VARIANT_BENCHMARK(BM_Variant_Build, repo::lib::RepoCompactVariant);
+VARIANT_BENCHMARK(BM_Variant_Copy, repo::lib::RepoVariant);
+VARIANT_BENCHMARK(BM_Variant_Copy, repo::lib::RepoCompactVariant);
+VARIANT_BENCHMARK(BM_Variant_String, repo::lib::RepoVariant);
+VARIANT_BENCHMARK(BM_Variant_String, repo::lib::RepoCompactVariant);
+VARIANT_BENCHMARK(BM_Variant_BSON, repo::lib::RepoVariant);
+VARIANT_BENCHMARK(BM_Variant_BSON, repo::lib::RepoCompactVariant);
+
+BENCHMARK(BM_CompactVariant_Json)
+	->Arg(10000000)
+	->Iterations(1)
+	->Unit(benchmark::kMillisecond)
+	->UseRealTime();
+
+BENCHMARK(BM_MetadataNode_Serialise)
+	->Arg(10000000)
+	->Iterations(1)
+	->Unit(benchmark::kMillisecond)
+	->UseRealTime();
@@ -0,0 +1,141 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <benchmark/benchmark.h>
+#include <repo/manipulator/modelutility/repo_maker_selection_tree.h>
+#include <repo/manipulator/modelutility/repo_selection_tree_binary.h>
+#include <repo/manipulator/modelutility/repo_scene_builder.h>
+
+#include "repo_bench_scene_generator.h"
+#include "repo_bench_utils.h"
+
+using namespace repo::bench::utils;
+
+// Measures building and serialising the selection tree of an imported scene,
+// as json, as the binary format, and rendering the json back from the binary.
+// The scene is imported once, outside the timed region.
+
+static std::string importScene(std::shared_ptr<repo::core::handler::AbstractDatabaseHandler> handler, benchmark::State& state, const repo::lib::RepoUUID& revId)
+{
+	SceneParameters parameters;
+	parameters.numMeshes = state.range(0);
+	parameters.verticesPerMesh = 30;
+	parameters.treeDepth = state.range(1);
+	parameters.metadataDensity = 1.0f;
+	SceneGenerator generator(parameters);
+
+	auto project = makeProjectName("SelectionTreeMaker");
+	{
+		repo::manipulator::modelutility::RepoSceneBuilder builder(handler, REPO_BENCH_DBNAME, project, revId);
+		generator.build(builder);
+	}
+	return project;
+}
+
+static void BM_SelectionTreeMaker(benchmark::State& state)
+{
+	auto handler = getHandler();
+	auto revId = repo::lib::RepoUUID::createUUID();
+	auto project = importScene(handler, state, revId);
+
+	repo::core::model::RepoScene scene(REPO_BENCH_DBNAME, project);
+	scene.setRevision(revId);
+
+	size_t bytes = 0;
+	for (auto _ : state) {
+		repo::manipulator::modelutility::SelectionTreeMaker treeMaker(&scene, handler.get());
+		auto buffers = treeMaker.getSelectionTreeAsBuffer();
+		bytes = 0;
+		for (const auto& buffer : buffers) {
+			bytes += buffer.second.size();
+		}
+	}
+
+	state.counters["bytes"] = bytes;
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+
+	dropProject(handler.get(), REPO_BENCH_DBNAME, project);
+}
+
+static void BM_SelectionTreeMakerBinary(benchmark::State& state)
+{
+	auto handler = getHandler();
+	auto revId = repo::lib::RepoUUID::createUUID();
+	auto project = importScene(handler, state, revId);
+
+	repo::core::model::RepoScene scene(REPO_BENCH_DBNAME, project);
+	scene.setRevision(revId);
+
+	size_t bytes = 0;
+	for (auto _ : state) {
+		repo::manipulator::modelutility::SelectionTreeMaker treeMaker(&scene, handler.get());
+		bytes = treeMaker.getSelectionTreeAsBinary().size();
+	}
+
+	state.counters["bytes"] = bytes;
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+
+	dropProject(handler.get(), REPO_BENCH_DBNAME, project);
+}
+
+static void BM_SelectionTreeBinaryRenderJson(benchmark::State& state)
+{
+	auto handler = getHandler();
+	auto revId = repo::lib::RepoUUID::createUUID();
+	auto project = importScene(handler, state, revId);
+
+	repo::core::model::RepoScene scene(REPO_BENCH_DBNAME, project);
+	scene.setRevision(revId);
+
+	repo::manipulator::modelutility::SelectionTreeMaker treeMaker(&scene, handler.get());
+	auto binary = treeMaker.getSelectionTreeAsBinary();
+
+	size_t bytes = 0;
+	for (auto _ : state) {
+		repo::manipulator::modelutility::SelectionTreeBinaryReader reader(binary);
+		bytes = 0;
+		for (const auto& name : reader.getJsonNames()) {
+			bytes += reader.renderJson(name).size();
+		}
+	}
+
+	state.counters["bytes"] = bytes;
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+
+	dropProject(handler.get(), REPO_BENCH_DBNAME, project);
+}
+
+BENCHMARK(BM_SelectionTreeMaker)
+	->Args({ 10000, 4 })
+	->Args({ 100000, 4 })
+	->Args({ 10000, 8 })
+	->Unit(benchmark::kMillisecond)
+	->UseRealTime();
+
+BENCHMARK(BM_SelectionTreeMakerBinary)
+	->Args({ 10000, 4 })
+	->Args({ 100000, 4 })
+	->Args({ 10000, 8 })
+	->Unit(benchmark::kMillisecond)
+	->UseRealTime();
+
+BENCHMARK(BM_SelectionTreeBinaryRenderJson)
+	->Args({ 10000, 4 })
+	->Args({ 100000, 4 })
+	->Args({ 10000, 8 })
+	->Unit(benchmark::kMillisecond)
+	->UseRealTime();
@@ -0,0 +1,90 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifdef ODA_SUPPORT
+
+#include <benchmark/benchmark.h>
+#include <repo/manipulator/modelconvertor/import/odaHelper/repo_mesh_builder.h>
+
+#include "repo_bench_utils.h"
+
+#include <cmath>
+
+using namespace repo::bench::utils;
+using namespace repo::manipulator::modelconvertor::odaHelper;
+
+// Streams a synthetic tessellation into a RepoMeshBuilder: a set of
+// cylinders, each delivered as independent triangles with per-face normals,
+// as the ODA vectorisers do for RVT, NWD and DGN geometry.
+
+static void BM_RepoMeshBuilder_Tessellation(benchmark::State& state)
+{
+	auto numCylinders = state.range(0);
+	auto maxVertices = state.range(1);
+	const int segments = 64;
+	const int rings = 64;
+
+	size_t numFaces = 0;
+	size_t numVertices = 0;
+	size_t numMeshes = 0;
+
+	for (auto _ : state) {
+		RepoMeshBuilder builder({}, {}, {}, maxVertices);
+		numFaces = 0;
+
+		for (int c = 0; c < numCylinders; c++) {
+			for (int r = 0; r < rings; r++) {
+				for (int s = 0; s < segments; s++) {
+					auto a0 = s * 2 * 3.14159265358979 / segments;
+					auto a1 = (s + 1) * 2 * 3.14159265358979 / segments;
+					repo::lib::RepoVector3D64 p0(c * 3 + cos(a0), sin(a0), r);
+					repo::lib::RepoVector3D64 p1(c * 3 + cos(a1), sin(a1), r);
+					repo::lib::RepoVector3D64 p2(c * 3 + cos(a1), sin(a1), r + 1);
+					repo::lib::RepoVector3D64 p3(c * 3 + cos(a0), sin(a0), r + 1);
+					builder.addFace(RepoMeshBuilder::face({ p0, p1, p2 }));
+					builder.addFace(RepoMeshBuilder::face({ p0, p2, p3 }));
+					numFaces += 2;
+				}
+			}
+		}
+
+		std::vector<repo::core::model::MeshNode> meshes;
+		builder.extractMeshes(meshes);
+
+		numMeshes = meshes.size();
+		numVertices = 0;
+		for (auto& mesh : meshes) {
+			numVertices += mesh.getNumVertices();
+		}
+	}
+
+	state.counters["faces"] = numFaces;
+	state.counters["vertices"] = numVertices;
+	state.counters["meshes"] = numMeshes;
+	state.counters["peakMemory"] = getPeakMemoryUsage();
+	state.SetItemsProcessed(state.iterations() * numFaces);
+}
+
+BENCHMARK(BM_RepoMeshBuilder_Tessellation)
+	->Args({ 100, RepoMeshBuilder::DEFAULT_MAX_VERTICES })
+	->Args({ 1000, RepoMeshBuilder::DEFAULT_MAX_VERTICES })
+	->Args({ 1000, 65536 })
+	->Iterations(1)
+	->Unit(benchmark::kMillisecond)
+	->UseRealTime();
+
+#endif
@@ -0,0 +1,196 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <benchmark/benchmark.h>
+#include <repo/core/model/bson/repo_node_mesh.h>
+#include <repo/core/model/collection/repo_scene.h>
+#include <repo/lib/repo_mesh_codec.h>
+#include <repo/manipulator/modelconvertor/import/repo_model_import_assimp.h>
+
+#include <boost/filesystem.hpp>
+#include <cstdlib>
+
+#include "repo_bench_scene_generator.h"
+#include "repo_bench_utils.h"
+
+using namespace repo::bench::utils;
+using namespace repo::lib;
+
+static std::vector<uint32_t> getFacesLevel1(const repo::core::model::MeshNode& mesh)
+{
+	std::vector<uint32_t> faces;
+	for (auto& face : mesh.getFaces()) {
+		faces.push_back(face.size());
+		faces.insert(faces.end(), face.begin(), face.end());
+	}
+	return faces;
+}
+
+static RepoBounds getBounds(const std::vector<RepoVector3D>& vertices)
+{
+	RepoBounds bounds;
+	for (auto& v : vertices) {
+		bounds.encapsulate(v);
+	}
+	return bounds;
+}
+
+static repo::core::model::MeshNode createMesh(size_t numVertices)
+{
+	SceneParameters parameters;
+	parameters.verticesPerMesh = numVertices;
+	SceneGenerator generator(parameters);
+	return generator.createMesh(0);
+}
+
+/*
+* Encodes all the streams of a mesh, reporting the size of the encoded streams
+* relative to the raw arrays MeshNode would otherwise write.
+*/
+static void BM_MeshCodec_Encode(benchmark::State& state)
+{
+	auto mesh = createMesh(state.range(0));
+	auto faces = getFacesLevel1(mesh);
+
+	RepoMeshCodec::Options options;
+	options.compressStreams = state.range(1);
+	options.grid = getBounds(mesh.getVertices());
+
+	size_t rawSize = mesh.getVertices().size() * sizeof(RepoVector3D)
+		+ mesh.getNormals().size() * sizeof(RepoVector3D)
+		+ faces.size() * sizeof(uint32_t);
+	size_t encodedSize = 0;
+
+	for (auto _ : state) {
+		auto v = RepoMeshCodec::encodePositions(mesh.getVertices(), options);
+		auto n = RepoMeshCodec::encodeNormals(mesh.getNormals(), options);
+		auto f = RepoMeshCodec::encodeFaces(faces, options);
+		encodedSize = v.size() + n.size() + f.size();
+		benchmark::DoNotOptimize(encodedSize);
+	}
+
+	state.SetBytesProcessed(state.iterations() * rawSize);
+	state.counters["ratio"] = (double)encodedSize / rawSize;
+}
+
+static void BM_MeshCodec_Decode(benchmark::State& state)
+{
+	auto mesh = createMesh(state.range(0));
+	auto faces = getFacesLevel1(mesh);
+
+	RepoMeshCodec::Options options;
+	options.compressStreams = state.range(1);
+	options.grid = getBounds(mesh.getVertices());
+
+	auto v = RepoMeshCodec::encodePositions(mesh.getVertices(), options);
+	auto n = RepoMeshCodec::encodeNormals(mesh.getNormals(), options);
+	auto f = RepoMeshCodec::encodeFaces(faces, options);
+
+	size_t rawSize = mesh.getVertices().size() * sizeof(RepoVector3D)
+		+ mesh.getNormals().size() * sizeof(RepoVector3D)
+		+ faces.size() * sizeof(uint32_t);
+
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(RepoMeshCodec::decodePositions(v));
+		benchmark::DoNotOptimize(RepoMeshCodec::decodeNormals(n));
+		benchmark::DoNotOptimize(RepoMeshCodec::decodeFaces(f));
+	}
+
+	state.SetBytesProcessed(state.iterations() * rawSize);
+}
+
+BENCHMARK(BM_MeshCodec_Encode)
+	->ArgsProduct({ { 600, 60000, 1200000 }, { 0, 1 } })
+	->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_MeshCodec_Decode)
+	->ArgsProduct({ { 600, 60000, 1200000 }, { 0, 1 } })
+	->Unit(benchmark::kMillisecond);
+
+// The models under REPO_MODEL_PATH (the test fixtures), imported in memory.
+// All the meshes of a model are encoded against the same grid, as they would
+// be by RepoSceneBuilder.
+
+static const char* fixtures[] = {
+	"cubeHierarchy.blend",
+	"3DrepoBIM.obj",
+	"AssimpModelImport/AIM4G.fbx",
+};
+
+static void BM_MeshCodec_EncodeFixture(benchmark::State& state)
+{
+	auto modelPath = getenv("REPO_MODEL_PATH");
+	if (!modelPath) {
+		state.SkipWithError("REPO_MODEL_PATH is not set");
+		return;
+	}
+
+	auto path = (boost::filesystem::path(modelPath) / fixtures[state.range(0)]).string();
+	state.SetLabel(fixtures[state.range(0)]);
+
+	// Without a database or project in the settings, the importer returns the
+	// scene rather than writing it
+
+	repo::manipulator::modelconvertor::ModelImportConfig config(repo::lib::RepoUUID::createUUID(), "", "");
+	repo::manipulator::modelconvertor::AssimpModelImport importer(config);
+	uint8_t err;
+	std::unique_ptr<repo::core::model::RepoScene> scene(importer.importModel(path, getHandler(), err));
+	if (!scene) {
+		state.SkipWithError(("Could not import " + path).c_str());
+		return;
+	}
+
+	std::vector<const repo::core::model::MeshNode*> meshes;
+	RepoBounds grid;
+	for (auto node : scene->getAllMeshes(repo::core::model::RepoScene::GraphType::DEFAULT)) {
+		auto mesh = dynamic_cast<const repo::core::model::MeshNode*>(node);
+		meshes.push_back(mesh);
+		grid.encapsulate(getBounds(mesh->getVertices()));
+	}
+
+	std::vector<std::vector<uint32_t>> faces;
+	size_t rawSize = 0;
+	for (auto mesh : meshes) {
+		faces.push_back(getFacesLevel1(*mesh));
+		rawSize += mesh->getVertices().size() * sizeof(RepoVector3D)
+			+ mesh->getNormals().size() * sizeof(RepoVector3D)
+			+ faces.back().size() * sizeof(uint32_t);
+	}
+
+	RepoMeshCodec::Options options;
+	options.compressStreams = state.range(1);
+	options.grid = grid;
+
+	size_t encodedSize = 0;
+	for (auto _ : state) {
+		encodedSize = 0;
+		for (size_t i = 0; i < meshes.size(); i++) {
+			encodedSize += RepoMeshCodec::encodePositions(meshes[i]->getVertices(), options).size();
+			encodedSize += RepoMeshCodec::encodeNormals(meshes[i]->getNormals(), options).size();
+			encodedSize += RepoMeshCodec::encodeFaces(faces[i], options).size();
+		}
+		benchmark::DoNotOptimize(encodedSize);
+	}
+
+	state.SetBytesProcessed(state.iterations() * rawSize);
+	state.counters["meshes"] = meshes.size();
+	state.counters["ratio"] = rawSize ? (double)encodedSize / rawSize : 0;
+}
+
+BENCHMARK(BM_MeshCodec_EncodeFixture)
+	->ArgsProduct({ { 0, 1, 2 }, { 0, 1 } })
+	->Unit(benchmark::kMillisecond);
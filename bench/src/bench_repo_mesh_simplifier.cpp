@@ -0,0 +1,209 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <benchmark/benchmark.h>
+#include <repo/manipulator/modeloptimizer/repo_mesh_simplifier.h>
+#include <repo/manipulator/modeloptimizer/repo_optimizer_multipart.h>
+#include <repo/manipulator/modelutility/repo_scene_builder.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <random>
+
+#include "repo_bench_scene_generator.h"
+#include "repo_bench_utils.h"
+
+using namespace repo::bench::utils;
+using namespace repo::manipulator::modeloptimizer;
+
+// Throughput is reported in input triangles per second. The error reported by
+// the simplifier, and the ratio of faces actually reached, are reported as
+// counters.
+
+struct BenchMesh
+{
+	std::vector<repo::lib::RepoVector3D> vertices;
+	std::vector<repo::lib::RepoVector3D> normals;
+	std::vector<std::vector<repo::lib::RepoVector2D>> uvChannels;
+	std::vector<repo::lib::repo_face_t> faces;
+};
+
+// A smooth UV sphere, which has error everywhere it is simplified
+
+static BenchMesh makeSphere(uint32_t segments)
+{
+	BenchMesh mesh;
+	const float pi = 3.14159265f;
+	for (uint32_t r = 0; r <= segments; r++) {
+		for (uint32_t s = 0; s <= segments * 2; s++) {
+			float theta = pi * r / segments;
+			float phi = pi * s / segments;
+			repo::lib::RepoVector3D n(std::sin(theta) * std::cos(phi), std::sin(theta) * std::sin(phi), std::cos(theta));
+			mesh.vertices.push_back(n);
+			mesh.normals.push_back(n);
+		}
+	}
+	uint32_t stride = segments * 2 + 1;
+	for (uint32_t r = 0; r < segments; r++) {
+		for (uint32_t s = 0; s < segments * 2; s++) {
+			uint32_t i = r * stride + s;
+			mesh.faces.push_back({ i, i + stride, i + 1 });
+			mesh.faces.push_back({ i + 1, i + stride, i + stride + 1 });
+		}
+	}
+	return mesh;
+}
+
+// An n by n heightfield with noise, with uvs, and an open boundary
+
+static BenchMesh makeTerrain(uint32_t n)
+{
+	std::mt19937 rng(0);
+	std::uniform_real_distribution<float> noise(-0.05f, 0.05f);
+	BenchMesh mesh;
+	mesh.uvChannels.resize(1);
+	for (uint32_t y = 0; y <= n; y++) {
+		for (uint32_t x = 0; x <= n; x++) {
+			float h = std::sin(x * 0.05f) * std::cos(y * 0.07f) * 4 + noise(rng);
+			mesh.vertices.push_back({ (float)x, (float)y, h });
+			mesh.normals.push_back({ 0, 0, 1 });
+			mesh.uvChannels[0].push_back({ (float)x / n, (float)y / n });
+		}
+	}
+	for (uint32_t y = 0; y < n; y++) {
+		for (uint32_t x = 0; x < n; x++) {
+			uint32_t i = y * (n + 1) + x;
+			mesh.faces.push_back({ i, i + 1, i + n + 2 });
+			mesh.faces.push_back({ i, i + n + 2, i + n + 1 });
+		}
+	}
+	return mesh;
+}
+
+static void runSimplify(benchmark::State& state, const BenchMesh& mesh, float ratio)
+{
+	MeshSimplifier simplifier;
+	auto target = (size_t)(mesh.faces.size() * ratio);
+	float error = 0;
+	size_t numFaces = 0;
+	for (auto _ : state) {
+		auto faces = simplifier.simplify(mesh.vertices, mesh.normals, mesh.uvChannels, mesh.faces, 0, mesh.faces.size(), target, FLT_MAX, error);
+		numFaces = faces.size();
+		benchmark::DoNotOptimize(faces.data());
+	}
+
+	state.counters["error"] = error;
+	state.counters["ratio"] = (double)numFaces / mesh.faces.size();
+	state.counters["triangles"] = benchmark::Counter(state.iterations() * mesh.faces.size(), benchmark::Counter::kIsRate);
+}
+
+static void BM_MeshSimplifier_Sphere(benchmark::State& state)
+{
+	runSimplify(state, makeSphere(state.range(0)), state.range(1) / 100.0f);
+}
+
+BENCHMARK(BM_MeshSimplifier_Sphere)
+	->Args({ 64, 25 })
+	->Args({ 256, 25 })
+	->Args({ 256, 5 })
+	->Unit(benchmark::kMillisecond);
+
+static void BM_MeshSimplifier_Terrain(benchmark::State& state)
+{
+	runSimplify(state, makeTerrain(state.range(0)), state.range(1) / 100.0f);
+}
+
+BENCHMARK(BM_MeshSimplifier_Terrain)
+	->Args({ 256, 25 })
+	->Args({ 512, 25 })
+	->Args({ 512, 5 })
+	->Unit(benchmark::kMillisecond);
+
+// Runs stash generation for a generated scene with levels of detail, for
+// different numbers of threads. The levels are simplified in parallel across
+// supermeshes, so this shows how the stage scales, and its cost relative to
+// the rest of the pipeline (with 0 levels).
+
+class LodExport : public NullModelExport
+{
+public:
+	using NullModelExport::NullModelExport;
+
+	bool supportsLods() const
+	{
+		return true;
+	}
+
+	void addSupermeshLod(repo::core::model::SupermeshNode* lod)
+	{
+		numLodFaces += lod->getNumFaces();
+		maxError = std::max(maxError, lod->getLodError());
+	}
+
+	size_t numLodFaces = 0;
+	float maxError = 0;
+};
+
+static void BM_MeshSimplifier_Stash(benchmark::State& state)
+{
+	auto handler = getHandler();
+
+	SceneParameters parameters;
+	parameters.numMeshes = state.range(0);
+	parameters.verticesPerMesh = state.range(1);
+	parameters.metadataDensity = 0;
+	SceneGenerator generator(parameters);
+
+	auto project = makeProjectName("MeshSimplifier");
+	auto revId = repo::lib::RepoUUID::createUUID();
+	{
+		repo::manipulator::modelutility::RepoSceneBuilder builder(handler, REPO_BENCH_DBNAME, project, revId);
+		generator.build(builder);
+	}
+
+	MultipartOptimizer::LodOptions options;
+	options.numLevels = state.range(2);
+
+	size_t numLodFaces = 0;
+	float maxError = 0;
+	for (auto _ : state) {
+		LodExport exporter(handler.get(), REPO_BENCH_DBNAME, project, revId);
+		MultipartOptimizer opt(state.range(3));
+		opt.setLodOptions(options);
+		if (!opt.processScene(REPO_BENCH_DBNAME, project, revId, handler.get(), &exporter)) {
+			state.SkipWithError("processScene failed");
+			break;
+		}
+		numLodFaces = exporter.numLodFaces;
+		maxError = exporter.maxError;
+	}
+
+	state.counters["lodFaces"] = numLodFaces;
+	state.counters["maxError"] = maxError;
+	state.SetItemsProcessed(state.iterations() * parameters.numMeshes);
+
+	dropProject(handler.get(), REPO_BENCH_DBNAME, project);
+}
+
+BENCHMARK(BM_MeshSimplifier_Stash)
+	->Args({ 100, 60000, 0, 0 })
+	->Args({ 100, 60000, 3, 1 })
+	->Args({ 100, 60000, 3, 4 })
+	->Args({ 100, 60000, 3, 0 })
+	->Unit(benchmark::kMillisecond)
+	->UseRealTime();
@@ -0,0 +1,88 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <benchmark/benchmark.h>
+#include <repo/manipulator/modelconvertor/import/repo_metadata_import_csv.h>
+
+#include <boost/filesystem.hpp>
+#include <fstream>
+#include <random>
+
+// Writes an asset register style csv of approximately the given size, with a
+// mix of integer, floating point, text and quoted fields. The file is kept in
+// the temporary directory and reused between runs.
+
+static std::string generateCSV(size_t size)
+{
+	auto path = boost::filesystem::temp_directory_path() / ("repoBenchMetadata" + std::to_string(size) + ".csv");
+	if (boost::filesystem::exists(path) && boost::filesystem::file_size(path) >= size) {
+		return path.string();
+	}
+
+	std::ofstream file(path.string(), std::ios::binary);
+	file << "Name,Id,Floor,Area,Volume,Manufacturer,Description,Installed,Cost\n";
+
+	std::mt19937 rng(0);
+	std::uniform_real_distribution<double> real(0, 1000);
+	std::string row;
+	size_t written = 0;
+	for (size_t i = 0; written < size; i++) {
+		row = "Asset " + std::to_string(i) + ",";
+		row += std::to_string(rng()) + ",";
+		row += std::to_string(i % 50) + ",";
+		row += std::to_string(real(rng)) + ",";
+		row += std::to_string(real(rng)) + ",";
+		row += "Manufacturer " + std::to_string(rng() % 100) + ",";
+		row += i % 4 ? "\"Fitted, serviced and inspected \"\"annually\"\"\"," : "Standard,";
+		row += "2024-0" + std::to_string(1 + i % 9) + "-1" + std::to_string(i % 10) + ",";
+		row += std::to_string(rng() % 100000) + "." + std::to_string(rng() % 100) + "\n";
+		file << row;
+		written += row.size();
+	}
+
+	return path.string();
+}
+
+// Measures the throughput of reading a large csv into metadata nodes. The
+// nodes are discarded as each batch arrives, as they would be once written
+// to the database.
+
+static void BM_MetadataImportCSV_Read(benchmark::State& state)
+{
+	auto path = generateCSV(state.range(0) * 1024 * 1024);
+	auto size = boost::filesystem::file_size(path);
+
+	size_t rows = 0;
+	for (auto _ : state) {
+		repo::manipulator::modelconvertor::MetadataImportCSV importer;
+		std::vector<std::string> headers;
+		rows = 0;
+		importer.readMetadata(path, headers, [&](std::vector<repo::core::model::MetadataNode>& batch) {
+			rows += batch.size();
+		});
+	}
+
+	state.counters["rows"] = rows;
+	state.SetBytesProcessed(state.iterations() * size);
+}
+
+BENCHMARK(BM_MetadataImportCSV_Read)
+	->Arg(64)
+	->Arg(1024)
+	->Iterations(1)
+	->Unit(benchmark::kMillisecond)
+	->UseRealTime();
@@ -0,0 +1,149 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <benchmark/benchmark.h>
+#include <repo/manipulator/modelconvertor/import/repo_model_import_3drepo.h>
+
+#include <boost/filesystem.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+#include "repo_bench_utils.h"
+
+using namespace repo::bench::utils;
+
+// Writes a BIM004 file in the style of a Revit export: a flat list of
+// elements under a root, each with a small mesh, a material and a few
+// metadata entries. The vertices are far from the origin, as for a
+// georeferenced model. The file is kept in the temporary directory and
+// reused between runs.
+
+static std::string generateBIM(size_t numElements, size_t verticesPerMesh, size_t& dataSize)
+{
+	auto path = boost::filesystem::temp_directory_path() / ("repoBenchBIM" + std::to_string(numElements) + "_" + std::to_string(verticesPerMesh) + ".bim");
+
+	std::mt19937 rng(0);
+	std::uniform_real_distribution<double> position(0, 1000);
+
+	// Each mesh is a strip of quads, so the vertices are shared between faces as
+	// they are in the exports
+
+	size_t numQuads = std::max<size_t>(1, verticesPerMesh / 2 - 1);
+	size_t numVertices = (numQuads + 1) * 2;
+
+	std::string data;
+	std::ostringstream json;
+	json << "{\"nodes\":[{\"id\":0,\"parent\":-1,\"name\":\"root\"}";
+
+	for (size_t e = 0; e < numElements; e++) {
+		repo::lib::RepoVector3D64 origin(500000 + position(rng), 200000 + position(rng), position(rng) * 0.1);
+
+		size_t verticesStart = data.size();
+		for (size_t i = 0; i < numVertices; i++) {
+			double v[3] = { origin.x + (i / 2) * 0.1, origin.y + (i % 2), origin.z };
+			data.append((const char*)v, sizeof(v));
+		}
+		size_t normalsStart = data.size();
+		for (size_t i = 0; i < numVertices; i++) {
+			float n[3] = { 0, 0, 1 };
+			data.append((const char*)n, sizeof(n));
+		}
+		size_t indicesStart = data.size();
+		for (uint32_t q = 0; q < numQuads; q++) {
+			uint32_t f[6] = { q * 2, q * 2 + 1, q * 2 + 2, q * 2 + 2, q * 2 + 1, q * 2 + 3 };
+			data.append((const char*)f, sizeof(f));
+		}
+
+		json << ",{\"id\":" << e + 1 << ",\"parent\":0,\"name\":\"Element " << e << "\"";
+		json << ",\"metadata\":{\"sCategory\":\"Walls\",\"iElementId\":" << e << ",\"dArea\":" << position(rng) << "}";
+		json << ",\"geometry\":{\"primitive\":3";
+		json << ",\"numIndices\":" << numQuads * 6 << ",\"numVertices\":" << numVertices;
+		json << ",\"vertices\":[" << verticesStart << "," << normalsStart << "]";
+		json << ",\"normals\":[" << normalsStart << "," << indicesStart << "]";
+		json << ",\"indices\":[" << indicesStart << "," << data.size() << "]";
+		json << ",\"material\":" << e % 16 << "}}";
+	}
+
+	json << "],\"materials\":[";
+	for (size_t m = 0; m < 16; m++) {
+		json << (m ? "," : "") << "{\"diffuse\":[" << (m % 4) / 4.0 << "," << (m / 4) / 4.0 << ",0.5],\"transparency\":0}";
+	}
+	json << "],\"textures\":[]}";
+
+	dataSize = data.size();
+
+	if (boost::filesystem::exists(path)) {
+		return path.string();
+	}
+
+	auto header = json.str();
+	int64_t meta[9] = { (int64_t)header.size(), (int64_t)data.size(), -1, -1, -1, -1, 1, -1, -1 };
+
+	std::ofstream file(path.string(), std::ios::binary);
+	boost::iostreams::filtering_ostream out;
+	out.push(boost::iostreams::gzip_compressor());
+	out.push(file);
+	out.write("BIM004", 6);
+	out.write((const char*)meta, sizeof(meta));
+	out.write(header.data(), header.size());
+	out.write(data.data(), data.size());
+
+	return path.string();
+}
+
+// Measures the throughput of importing a BIM file, from the compressed file
+// to committed nodes, with different numbers of decoding threads.
+
+static void BM_RepoModelImport_BIM(benchmark::State& state)
+{
+	auto handler = getHandler();
+
+	size_t numElements = state.range(0);
+	size_t dataSize = 0;
+	auto path = generateBIM(numElements, state.range(1), dataSize);
+
+	for (auto _ : state) {
+		state.PauseTiming();
+		auto project = makeProjectName("RepoModelImport");
+		repo::manipulator::modelconvertor::ModelImportConfig config(repo::lib::RepoUUID::createUUID(), REPO_BENCH_DBNAME, project);
+		config.numThreads = state.range(2);
+		state.ResumeTiming();
+
+		{
+			repo::manipulator::modelconvertor::RepoModelImport importer(config);
+			uint8_t err = 0;
+			std::unique_ptr<repo::core::model::RepoScene> scene(importer.importModel(path, handler, err));
+		}
+
+		state.PauseTiming();
+		dropProject(handler.get(), REPO_BENCH_DBNAME, project);
+		state.ResumeTiming();
+	}
+
+	state.SetBytesProcessed(state.iterations() * dataSize);
+	state.SetItemsProcessed(state.iterations() * numElements);
+}
+
+BENCHMARK(BM_RepoModelImport_BIM)
+	->ArgsProduct({ { 10000, 100000 }, { 60 }, { 1, 2, 4, 8 } })
+	->ArgsProduct({ { 10000 }, { 600 }, { 1, 8 } })
+	->Iterations(1)
+	->Unit(benchmark::kMillisecond)
+	->UseRealTime();
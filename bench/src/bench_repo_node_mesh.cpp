@@ -0,0 +1,49 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <benchmark/benchmark.h>
+#include <repo/core/model/bson/repo_node_mesh.h>
+
+#include "repo_bench_scene_generator.h"
+
+using namespace repo::bench::utils;
+
+static void BM_MeshNode_RemoveDuplicateVertices(benchmark::State& state)
+{
+	SceneParameters parameters;
+	parameters.verticesPerMesh = state.range(0);
+	SceneGenerator generator(parameters);
+
+	auto original = generator.createMesh(0);
+
+	for (auto _ : state) {
+		state.PauseTiming();
+		auto mesh = original;
+		state.ResumeTiming();
+
+		mesh.removeDuplicateVertices();
+		benchmark::DoNotOptimize(mesh.getNumVertices());
+	}
+
+	state.SetItemsProcessed(state.iterations() * parameters.verticesPerMesh);
+}
+
+BENCHMARK(BM_MeshNode_RemoveDuplicateVertices)
+	->Arg(600)
+	->Arg(60000)
+	->Arg(1200000)
+	->Unit(benchmark::kMillisecond);
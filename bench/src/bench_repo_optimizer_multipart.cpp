@@ -0,0 +1,114 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <benchmark/benchmark.h>
+#include <repo/manipulator/modeloptimizer/repo_optimizer_multipart.h>
+#include <repo/manipulator/modelutility/repo_scene_builder.h>
+
+#include "repo_bench_scene_generator.h"
+#include "repo_bench_utils.h"
+
+using namespace repo::bench::utils;
+
+// Measures stash generation (clustering and supermeshing) for a scene that has
+// already been imported. The scene is imported once, outside the timed region.
+
+static void BM_MultipartOptimizer_ProcessScene(benchmark::State& state)
+{
+	auto handler = getHandler();
+
+	SceneParameters parameters;
+	parameters.numMeshes = state.range(0);
+	parameters.verticesPerMesh = state.range(1);
+	SceneGenerator generator(parameters);
+
+	auto project = makeProjectName("MultipartOptimizer");
+	auto revId = repo::lib::RepoUUID::createUUID();
+	{
+		repo::manipulator::modelutility::RepoSceneBuilder builder(handler, REPO_BENCH_DBNAME, project, revId);
+		generator.build(builder);
+	}
+
+	size_t supermeshes = 0;
+	for (auto _ : state) {
+		NullModelExport exporter(handler.get(), REPO_BENCH_DBNAME, project, revId);
+		repo::manipulator::modeloptimizer::MultipartOptimizer opt;
+		if (!opt.processScene(REPO_BENCH_DBNAME, project, revId, handler.get(), &exporter)) {
+			state.SkipWithError("processScene failed");
+			break;
+		}
+		supermeshes = exporter.supermeshCount;
+	}
+
+	state.counters["supermeshes"] = supermeshes;
+	state.SetItemsProcessed(state.iterations() * parameters.numMeshes);
+
+	dropProject(handler.get(), REPO_BENCH_DBNAME, project);
+}
+
+BENCHMARK(BM_MultipartOptimizer_ProcessScene)
+	->Args({ 1000, 600 })
+	->Args({ 10000, 600 })
+	->Args({ 1000, 60000 })
+	->Unit(benchmark::kMillisecond)
+	->UseRealTime();
+
+// Measures the splitting of a single oversized mesh into supermeshes. The peak
+// memory counter is for the whole process, so this should be run on its own
+// (e.g. with --benchmark_filter) to attribute it to the split.
+
+static void BM_MultipartOptimizer_SplitMesh(benchmark::State& state)
+{
+	auto handler = getHandler();
+
+	SceneParameters parameters;
+	parameters.numMeshes = 1;
+	parameters.verticesPerMesh = state.range(0) * 3; // Triangle soup, so three vertices per face
+	parameters.metadataDensity = 0;
+	SceneGenerator generator(parameters);
+
+	auto project = makeProjectName("MultipartOptimizerSplit");
+	auto revId = repo::lib::RepoUUID::createUUID();
+	{
+		repo::manipulator::modelutility::RepoSceneBuilder builder(handler, REPO_BENCH_DBNAME, project, revId);
+		generator.build(builder);
+	}
+
+	size_t supermeshes = 0;
+	for (auto _ : state) {
+		NullModelExport exporter(handler.get(), REPO_BENCH_DBNAME, project, revId);
+		repo::manipulator::modeloptimizer::MultipartOptimizer opt;
+		if (!opt.processScene(REPO_BENCH_DBNAME, project, revId, handler.get(), &exporter)) {
+			state.SkipWithError("processScene failed");
+			break;
+		}
+		supermeshes = exporter.supermeshCount;
+	}
+
+	state.counters["supermeshes"] = supermeshes;
+	state.counters["peakMemoryMB"] = getPeakMemoryUsage() / (1024.0 * 1024.0);
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+
+	dropProject(handler.get(), REPO_BENCH_DBNAME, project);
+}
+
+BENCHMARK(BM_MultipartOptimizer_SplitMesh)
+	->Arg(500000)
+	->Arg(5000000)
+	->Iterations(1)
+	->Unit(benchmark::kMillisecond)
+	->UseRealTime();
@@ -0,0 +1,62 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <benchmark/benchmark.h>
+#include <repo/core/handler/fileservice/repo_file_manager.h>
+#include <repo/core/model/collection/repo_scene.h>
+#include <repo/error_codes.h>
+
+#include "repo_bench_scene_generator.h"
+#include "repo_bench_utils.h"
+
+using namespace repo::bench::utils;
+
+static void BM_RepoScene_Commit(benchmark::State& state)
+{
+	auto handler = getHandler();
+
+	SceneParameters parameters;
+	parameters.numMeshes = state.range(0);
+	parameters.verticesPerMesh = state.range(1);
+	SceneGenerator generator(parameters);
+
+	for (auto _ : state) {
+		state.PauseTiming();
+		auto project = makeProjectName("RepoScene");
+		auto scene = generator.createScene(REPO_BENCH_DBNAME, project);
+		state.ResumeTiming();
+
+		std::string errMsg;
+		auto result = scene->commit(handler.get(), handler->getFileManager().get(), errMsg, "benchmark", "", "", repo::lib::RepoUUID::createUUID());
+
+		state.PauseTiming();
+		if (result != REPOERR_OK) {
+			state.SkipWithError(errMsg.c_str());
+		}
+		delete scene;
+		dropProject(handler.get(), REPO_BENCH_DBNAME, project);
+		state.ResumeTiming();
+	}
+
+	state.SetItemsProcessed(state.iterations() * parameters.numMeshes);
+}
+
+BENCHMARK(BM_RepoScene_Commit)
+	->Args({ 1000, 600 })
+	->Args({ 10000, 600 })
+	->Unit(benchmark::kMillisecond)
+	->UseRealTime();
@@ -0,0 +1,109 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <benchmark/benchmark.h>
+#include <repo/manipulator/modelutility/repo_scene_builder.h>
+
+#include "repo_bench_scene_generator.h"
+#include "repo_bench_utils.h"
+
+using namespace repo::bench::utils;
+
+// Measures the import finalisation path: handing nodes to the builder, welding
+// and writing them through the bulk write context, and resolving parents.
+
+static void BM_RepoSceneBuilder_Import(benchmark::State& state)
+{
+	auto handler = getHandler();
+
+	SceneParameters parameters;
+	parameters.numMeshes = state.range(0);
+	parameters.verticesPerMesh = state.range(1);
+	SceneGenerator generator(parameters);
+
+	for (auto _ : state) {
+		state.PauseTiming();
+		auto project = makeProjectName("RepoSceneBuilder");
+		auto nodes = generator.createNodes();
+		state.ResumeTiming();
+
+		{
+			repo::manipulator::modelutility::RepoSceneBuilder builder(handler, REPO_BENCH_DBNAME, project, repo::lib::RepoUUID::createUUID());
+			builder.createIndexes();
+			builder.addNodes(std::move(nodes));
+			builder.finalise();
+		}
+
+		state.PauseTiming();
+		dropProject(handler.get(), REPO_BENCH_DBNAME, project);
+		state.ResumeTiming();
+	}
+
+	state.SetItemsProcessed(state.iterations() * parameters.numMeshes);
+}
+
+BENCHMARK(BM_RepoSceneBuilder_Import)
+	->Args({ 1000, 600 })
+	->Args({ 10000, 600 })
+	->Args({ 1000, 60000 })
+	->Unit(benchmark::kMillisecond)
+	->UseRealTime();
+
+// Compares creating the scene indexes before the import with deferring them to
+// finalise, for scenes with many small nodes, where index maintenance is a
+// large part of the cost of each insert. The largest scene has about 1M nodes.
+
+static void BM_RepoSceneBuilder_ImportIndexes(benchmark::State& state)
+{
+	auto handler = getHandler();
+
+	SceneParameters parameters;
+	parameters.numMeshes = state.range(0);
+	parameters.verticesPerMesh = 6;
+	parameters.treeDepth = 6;
+	SceneGenerator generator(parameters);
+	bool deferred = state.range(1);
+
+	size_t numNodes = 0;
+	for (auto _ : state) {
+		state.PauseTiming();
+		auto project = makeProjectName("RepoSceneBuilderIndexes");
+		auto nodes = generator.createNodes();
+		numNodes = nodes.size();
+		state.ResumeTiming();
+
+		{
+			repo::manipulator::modelutility::RepoSceneBuilder builder(handler, REPO_BENCH_DBNAME, project, repo::lib::RepoUUID::createUUID());
+			builder.createIndexes(deferred);
+			builder.addNodes(std::move(nodes));
+			builder.finalise();
+		}
+
+		state.PauseTiming();
+		dropProject(handler.get(), REPO_BENCH_DBNAME, project);
+		state.ResumeTiming();
+	}
+
+	state.SetItemsProcessed(state.iterations() * numNodes);
+	state.counters["nodes"] = numNodes;
+}
+
+BENCHMARK(BM_RepoSceneBuilder_ImportIndexes)
+	->ArgsProduct({ { 10000, 100000, 660000 }, { 0, 1 } })
+	->Unit(benchmark::kMillisecond)
+	->Iterations(1)
+	->UseRealTime();
@@ -0,0 +1,130 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <benchmark/benchmark.h>
+#include <repo/manipulator/modelutility/repo_sequence_frame_serialiser.h>
+
+#include <map>
+#include <random>
+#include <set>
+
+using namespace repo::manipulator::modelutility;
+
+// Generates a schedule in the style of a 4D sequence: each frame a few tasks
+// start, changing the colour, transparency or transformation of a group of
+// nodes, which then keep that state. As with the importer, each frame is a
+// snapshot of the complete accumulated state.
+
+static std::vector<SequenceFrameSnapshot> generateSchedule(size_t numNodes, size_t numFrames)
+{
+	std::mt19937 rng(0);
+
+	std::vector<repo::lib::RepoUUID> ids;
+	for (size_t i = 0; i < numNodes; i++) {
+		ids.push_back(repo::lib::RepoUUID::createUUID());
+	}
+
+	std::map<float, std::set<std::string>> transparency;
+	std::map<uint32_t, std::vector<repo::lib::RepoUUID>> colour;
+	std::map<size_t, std::vector<double>> transformation;
+	std::uniform_int_distribution<size_t> node(0, numNodes - 1);
+
+	std::vector<SequenceFrameSnapshot> schedule;
+	for (size_t f = 0; f < numFrames; f++) {
+		for (int task = 0; task < 4; task++) {
+			auto start = node(rng);
+			auto count = std::min<size_t>(numNodes - start, 50);
+			switch (rng() % 3) {
+			case 0:
+				for (size_t i = start; i < start + count; i++) {
+					transparency[(rng() % 10) * 0.1f].insert(ids[i].toString());
+				}
+				break;
+			case 1: {
+				auto& group = colour[rng() % 64];
+				group.insert(group.end(), ids.begin() + start, ids.begin() + start + count);
+				break;
+			}
+			case 2:
+				transformation[start / 50] = std::vector<double>(16, (double)f);
+				break;
+			}
+		}
+
+		SequenceFrameSnapshot snapshot;
+		for (const auto& entry : transparency) {
+			snapshot.transparency.push_back({ entry.first, std::vector<std::string>(entry.second.begin(), entry.second.end()) });
+		}
+		for (const auto& entry : colour) {
+			snapshot.colour.push_back({ { (entry.first % 4) / 4.0f, (entry.first / 4 % 4) / 4.0f, (entry.first / 16) / 4.0f }, entry.second });
+		}
+		for (const auto& entry : transformation) {
+			auto first = ids.begin() + entry.first * 50;
+			snapshot.transformation.push_back({ entry.second, std::vector<repo::lib::RepoUUID>(first, first + std::min<size_t>(50, ids.end() - first)) });
+		}
+		schedule.push_back(std::move(snapshot));
+	}
+	return schedule;
+}
+
+// Serialises a schedule. A thread count of zero writes each frame on the
+// calling thread, as the importer did before the serialiser was introduced.
+
+static void BM_SequenceFrameSerialiser(benchmark::State& state)
+{
+	auto schedule = generateSchedule(state.range(0), 100);
+	auto numThreads = state.range(1);
+
+	size_t bytes = 0;
+	for (auto _ : state) {
+		state.PauseTiming();
+		auto frames = schedule;
+		state.ResumeTiming();
+
+		std::vector<std::vector<uint8_t>> documents;
+		if (numThreads) {
+			SequenceFrameSerialiser serialiser(numThreads);
+			for (auto& frame : frames) {
+				serialiser.addFrame(std::move(frame));
+			}
+			documents = serialiser.finalise();
+		}
+		else {
+			for (const auto& frame : frames) {
+				documents.push_back(serialiseSequenceFrame(frame));
+			}
+		}
+
+		bytes = 0;
+		for (const auto& document : documents) {
+			bytes += document.size();
+		}
+	}
+
+	state.counters["bytes"] = bytes;
+	state.SetItemsProcessed(state.iterations() * schedule.size());
+}
+
+BENCHMARK(BM_SequenceFrameSerialiser)
+	->Args({ 1000, 0 })
+	->Args({ 1000, 1 })
+	->Args({ 1000, 8 })
+	->Args({ 10000, 0 })
+	->Args({ 10000, 8 })
+	->Iterations(1)
+	->Unit(benchmark::kMillisecond)
+	->UseRealTime();
@@ -0,0 +1,86 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <benchmark/benchmark.h>
+#include <repo/manipulator/modelutility/repo_texture_processor.h>
+#include <repo/lib/repo_image.h>
+
+#include <random>
+
+using namespace repo::manipulator::modelutility;
+
+// Generates a set of distinct PNG textures, with smooth gradients and some
+// noise, so they compress roughly as photographic textures do.
+
+static std::vector<std::vector<uint8_t>> generateTextures(size_t count, uint32_t size)
+{
+	std::mt19937 rng(0);
+	std::uniform_int_distribution<int> noise(0, 15);
+
+	std::vector<std::vector<uint8_t>> textures;
+	for (size_t t = 0; t < count; t++) {
+		repo::lib::RepoImage image(size, size, 3);
+		auto& pixels = image.getPixels();
+		for (uint32_t y = 0; y < size; y++) {
+			for (uint32_t x = 0; x < size; x++) {
+				auto p = &pixels[((size_t)y * size + x) * 3];
+				p[0] = (uint8_t)((x * 255 / size + t * 17) % 240 + noise(rng));
+				p[1] = (uint8_t)((y * 255 / size) % 240 + noise(rng));
+				p[2] = (uint8_t)(((x + y) * 127 / size) % 240 + noise(rng));
+			}
+		}
+		textures.push_back(image.encodePNG(1));
+	}
+	return textures;
+}
+
+// Measures the throughput of processing a batch of textures (decode, scale
+// down, generate mip levels and re-encode), with different numbers of threads.
+
+static void BM_TextureProcessor(benchmark::State& state)
+{
+	auto textures = generateTextures(32, state.range(0));
+
+	size_t bytes = 0;
+	for (auto& t : textures) {
+		bytes += t.size();
+	}
+
+	TextureProcessorOptions options;
+	options.maxDimension = 1024;
+	options.generateMipLevels = true;
+	options.numThreads = state.range(1);
+
+	for (auto _ : state) {
+		TextureProcessor processor(options);
+		std::vector<std::string> hashes;
+		for (auto& t : textures) {
+			hashes.push_back(processor.submit(t));
+		}
+		for (auto& h : hashes) {
+			benchmark::DoNotOptimize(processor.get(h));
+		}
+	}
+
+	state.SetBytesProcessed(state.iterations() * bytes);
+	state.SetItemsProcessed(state.iterations() * textures.size());
+}
+
+BENCHMARK(BM_TextureProcessor)
+	->ArgsProduct({ { 512, 2048 }, { 1, 2, 4, 8 } })
+	->Unit(benchmark::kMillisecond)
+	->UseRealTime();
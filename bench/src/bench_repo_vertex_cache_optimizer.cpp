@@ -0,0 +1,227 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <benchmark/benchmark.h>
+#include <repo/manipulator/modeloptimizer/repo_optimizer_multipart.h>
+#include <repo/manipulator/modeloptimizer/repo_vertex_cache_optimizer.h>
+#include <repo/manipulator/modelutility/repo_scene_builder.h>
+
+#include <cmath>
+#include <random>
+
+#include "repo_bench_scene_generator.h"
+#include "repo_bench_utils.h"
+
+using namespace repo::bench::utils;
+using namespace repo::manipulator::modeloptimizer;
+
+// The cache efficiency is reported as counters (ACMR: vertex transforms per
+// triangle, ATVR: transforms per distinct vertex) from a FIFO cache simulation,
+// before and after optimisation.
+
+#define REPO_BENCH_CACHE_SIZE 16
+
+struct BenchMesh
+{
+	std::vector<repo::lib::RepoVector3D> vertices;
+	std::vector<repo::lib::RepoVector3D> normals;
+	std::vector<std::vector<repo::lib::RepoVector2D>> uvChannels;
+	std::vector<repo::lib::repo_face_t> faces;
+	std::vector<repo::lib::repo_mesh_mapping_t> mapping;
+
+	void addSubmesh(size_t vertFrom, size_t triFrom)
+	{
+		repo::lib::repo_mesh_mapping_t m = {};
+		m.vertFrom = vertFrom;
+		m.vertTo = vertices.size();
+		m.triFrom = triFrom;
+		m.triTo = faces.size();
+		mapping.push_back(m);
+	}
+};
+
+// A supermesh of n by n grids, with the faces of each in a random order
+
+static BenchMesh makeGrids(size_t numGrids, uint32_t n)
+{
+	std::mt19937 rng(0);
+	BenchMesh mesh;
+	for (size_t g = 0; g < numGrids; g++) {
+		uint32_t vertFrom = mesh.vertices.size();
+		size_t triFrom = mesh.faces.size();
+		for (uint32_t y = 0; y <= n; y++) {
+			for (uint32_t x = 0; x <= n; x++) {
+				mesh.vertices.push_back({ (float)x, (float)y, (float)g });
+				mesh.normals.push_back({ 0, 0, 1 });
+			}
+		}
+		for (uint32_t y = 0; y < n; y++) {
+			for (uint32_t x = 0; x < n; x++) {
+				uint32_t i = vertFrom + y * (n + 1) + x;
+				mesh.faces.push_back({ i, i + 1, i + n + 2 });
+				mesh.faces.push_back({ i, i + n + 2, i + n + 1 });
+			}
+		}
+		std::shuffle(mesh.faces.begin() + triFrom, mesh.faces.end(), rng);
+		mesh.addSubmesh(vertFrom, triFrom);
+	}
+	return mesh;
+}
+
+// A UV sphere in the order it is tessellated, which is already fairly coherent,
+// so this shows how much there is to gain over a typical exporter's output
+
+static BenchMesh makeSphere(uint32_t segments)
+{
+	BenchMesh mesh;
+	const float pi = 3.14159265f;
+	for (uint32_t r = 0; r <= segments; r++) {
+		for (uint32_t s = 0; s <= segments * 2; s++) {
+			float theta = pi * r / segments;
+			float phi = pi * s / segments;
+			repo::lib::RepoVector3D n(std::sin(theta) * std::cos(phi), std::sin(theta) * std::sin(phi), std::cos(theta));
+			mesh.vertices.push_back(n);
+			mesh.normals.push_back(n);
+		}
+	}
+	uint32_t stride = segments * 2 + 1;
+	for (uint32_t r = 0; r < segments; r++) {
+		for (uint32_t s = 0; s < segments * 2; s++) {
+			uint32_t i = r * stride + s;
+			mesh.faces.push_back({ i, i + stride, i + 1 });
+			mesh.faces.push_back({ i + 1, i + stride, i + stride + 1 });
+		}
+	}
+	mesh.addSubmesh(0, 0);
+	return mesh;
+}
+
+static void setCounters(benchmark::State& state, const VertexCacheOptimizer::Statistics& before, const VertexCacheOptimizer::Statistics& after)
+{
+	state.counters["acmrBefore"] = before.acmr();
+	state.counters["acmrAfter"] = after.acmr();
+	state.counters["atvrBefore"] = before.atvr();
+	state.counters["atvrAfter"] = after.atvr();
+}
+
+static void runOptimise(benchmark::State& state, const BenchMesh& input)
+{
+	VertexCacheOptimizer optimizer(REPO_BENCH_CACHE_SIZE);
+	BenchMesh mesh;
+	for (auto _ : state) {
+		state.PauseTiming();
+		mesh = input;
+		state.ResumeTiming();
+		optimizer.optimise(mesh.vertices, mesh.normals, mesh.uvChannels, mesh.faces, mesh.mapping);
+	}
+
+	setCounters(state,
+		VertexCacheOptimizer::simulate(input.faces, REPO_BENCH_CACHE_SIZE),
+		VertexCacheOptimizer::simulate(mesh.faces, REPO_BENCH_CACHE_SIZE));
+	state.SetItemsProcessed(state.iterations() * input.faces.size());
+}
+
+static void BM_VertexCacheOptimizer_ShuffledGrids(benchmark::State& state)
+{
+	runOptimise(state, makeGrids(state.range(0), state.range(1)));
+}
+
+BENCHMARK(BM_VertexCacheOptimizer_ShuffledGrids)
+	->Args({ 1, 256 })
+	->Args({ 1000, 8 })
+	->Unit(benchmark::kMillisecond);
+
+static void BM_VertexCacheOptimizer_Sphere(benchmark::State& state)
+{
+	runOptimise(state, makeSphere(state.range(0)));
+}
+
+BENCHMARK(BM_VertexCacheOptimizer_Sphere)
+	->Arg(64)
+	->Arg(256)
+	->Unit(benchmark::kMillisecond);
+
+// Runs stash generation for a generated scene, with and without the vertex
+// cache stage, and simulates the cache over the supermeshes that are
+// produced. This shows the effect on the meshes as the importers and the scene
+// builder leave them, and the cost of the stage relative to the rest of the
+// pipeline.
+
+class CacheStatisticsExport : public NullModelExport
+{
+public:
+	using NullModelExport::NullModelExport;
+
+	void addSupermesh(repo::core::model::SupermeshNode* supermesh)
+	{
+		NullModelExport::addSupermesh(supermesh);
+		auto s = VertexCacheOptimizer::simulate(supermesh->getFaces(), REPO_BENCH_CACHE_SIZE);
+		statistics.numFaces += s.numFaces;
+		statistics.numVertices += s.numVertices;
+		statistics.numTransforms += s.numTransforms;
+	}
+
+	VertexCacheOptimizer::Statistics statistics;
+};
+
+static void BM_VertexCacheOptimizer_Stash(benchmark::State& state)
+{
+	auto handler = getHandler();
+
+	SceneParameters parameters;
+	parameters.numMeshes = state.range(0);
+	parameters.verticesPerMesh = state.range(1);
+	parameters.metadataDensity = 0;
+	SceneGenerator generator(parameters);
+
+	auto project = makeProjectName("VertexCacheOptimizer");
+	auto revId = repo::lib::RepoUUID::createUUID();
+	{
+		repo::manipulator::modelutility::RepoSceneBuilder builder(handler, REPO_BENCH_DBNAME, project, revId);
+		generator.build(builder);
+	}
+
+	VertexCacheOptimizer::Statistics before, after;
+	for (auto _ : state) {
+		CacheStatisticsExport exporter(handler.get(), REPO_BENCH_DBNAME, project, revId);
+		MultipartOptimizer opt(0, state.range(2));
+		if (!opt.processScene(REPO_BENCH_DBNAME, project, revId, handler.get(), &exporter)) {
+			state.SkipWithError("processScene failed");
+			break;
+		}
+		after = exporter.statistics;
+	}
+
+	{
+		CacheStatisticsExport exporter(handler.get(), REPO_BENCH_DBNAME, project, revId);
+		MultipartOptimizer(0, false).processScene(REPO_BENCH_DBNAME, project, revId, handler.get(), &exporter);
+		before = exporter.statistics;
+	}
+
+	setCounters(state, before, after);
+	state.SetItemsProcessed(state.iterations() * parameters.numMeshes);
+
+	dropProject(handler.get(), REPO_BENCH_DBNAME, project);
+}
+
+BENCHMARK(BM_VertexCacheOptimizer_Stash)
+	->Args({ 1000, 600, 0 })
+	->Args({ 1000, 600, 1 })
+	->Args({ 100, 60000, 0 })
+	->Args({ 100, 60000, 1 })
+	->Unit(benchmark::kMillisecond)
+	->UseRealTime();
@@ -0,0 +1,252 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "repo_bench_scene_generator.h"
+
+#include <array>
+#include <boost/uuid/uuid.hpp>
+#include <cmath>
+
+#include <repo/core/model/bson/repo_bson_factory.h>
+#include <repo/core/model/bson/repo_node_metadata.h>
+#include <repo/core/model/bson/repo_node_transformation.h>
+
+using namespace repo::bench::utils;
+using namespace repo::core::model;
+
+// A small palette means meshes share materials, as they would in a real model,
+// so the optimiser sees a realistic number of groups.
+static const repo::lib::repo_color3d_t PALETTE[] = {
+	{ 0.8f, 0.2f, 0.2f },
+	{ 0.2f, 0.8f, 0.2f },
+	{ 0.2f, 0.2f, 0.8f },
+	{ 0.8f, 0.8f, 0.2f },
+	{ 0.8f, 0.2f, 0.8f },
+	{ 0.2f, 0.8f, 0.8f },
+	{ 0.5f, 0.5f, 0.5f },
+	{ 0.9f, 0.9f, 0.9f },
+};
+
+SceneGenerator::SceneGenerator(const SceneParameters& parameters)
+	: parameters(parameters),
+	rng(parameters.seed)
+{
+}
+
+repo::lib::RepoUUID SceneGenerator::nextUUID()
+{
+	boost::uuids::uuid id;
+	std::uniform_int_distribution<int> byte(0, 255);
+	for (auto& b : id.data) {
+		b = (uint8_t)byte(rng);
+	}
+	return repo::lib::RepoUUID(id);
+}
+
+void SceneGenerator::setIds(RepoNode& node)
+{
+	node.setUniqueID(nextUUID());
+	node.setSharedID(nextUUID());
+}
+
+MeshNode SceneGenerator::createMesh(size_t index)
+{
+	// Each mesh has its own stream, so the geometry does not depend on what
+	// has been generated before it.
+
+	std::seed_seq seq{ parameters.seed, (uint32_t)index };
+	std::mt19937 meshRng(seq);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	// The mesh is a heightfield over an n x n grid of quads, with the meshes
+	// themselves arranged on a lattice so they have distinct bounds.
+
+	auto numFaces = std::max<size_t>(2, parameters.verticesPerMesh / 3);
+	auto n = (size_t)std::ceil(std::sqrt(numFaces / 2.0));
+	auto side = (size_t)std::ceil(std::cbrt((double)std::max<size_t>(1, parameters.numMeshes)));
+
+	repo::lib::RepoVector3D origin(
+		(float)(index % side) * 2.0f,
+		(float)((index / side) % side) * 2.0f,
+		(float)(index / (side * side)) * 2.0f
+	);
+
+	std::vector<float> heights((n + 1) * (n + 1));
+	for (auto& h : heights) {
+		h = unit(meshRng) * 0.25f;
+	}
+
+	auto height = [&](size_t i, size_t j) {
+		return heights[std::min(i, n) * (n + 1) + std::min(j, n)];
+	};
+
+	auto position = [&](size_t i, size_t j) {
+		return repo::lib::RepoVector3D(
+			origin.x + (float)i / n,
+			origin.y + height(i, j),
+			origin.z + (float)j / n
+		);
+	};
+
+	// Normals are per-grid-point so the duplicates in the soup are exact, and
+	// can be welded by removeDuplicateVertices.
+
+	auto normal = [&](size_t i, size_t j) {
+		repo::lib::RepoVector3D v(
+			(height(i > 0 ? i - 1 : 0, j) - height(i + 1, j)) * n,
+			2.0f,
+			(height(i, j > 0 ? j - 1 : 0) - height(i, j + 1)) * n
+		);
+		v.normalize();
+		return v;
+	};
+
+	std::vector<repo::lib::RepoVector3D> vertices;
+	std::vector<repo::lib::RepoVector3D> normals;
+	std::vector<repo::lib::repo_face_t> faces;
+	vertices.reserve(numFaces * 3);
+	normals.reserve(numFaces * 3);
+	faces.reserve(numFaces);
+
+	repo::lib::RepoBounds bounds;
+
+	auto addCorner = [&](size_t i, size_t j) {
+		auto p = position(i, j);
+		vertices.push_back(p);
+		normals.push_back(normal(i, j));
+		bounds.encapsulate(repo::lib::RepoVector3D64(p.x, p.y, p.z));
+	};
+
+	for (size_t q = 0; faces.size() < numFaces; q++) {
+		auto i = q % n;
+		auto j = (q / n) % n;
+
+		for (const auto& tri : { std::array<size_t, 6>{ i, j, i + 1, j, i + 1, j + 1 }, std::array<size_t, 6>{ i, j, i + 1, j + 1, i, j + 1 } }) {
+			if (faces.size() >= numFaces) {
+				break;
+			}
+			auto start = (uint32_t)vertices.size();
+			addCorner(tri[0], tri[1]);
+			addCorner(tri[2], tri[3]);
+			addCorner(tri[4], tri[5]);
+			faces.push_back({ start, start + 1, start + 2 });
+		}
+	}
+
+	auto mesh = RepoBSONFactory::makeMeshNode(vertices, faces, normals, bounds, {}, "Mesh " + std::to_string(index));
+
+	repo::lib::repo_material_t material;
+	material.diffuse = PALETTE[meshRng() % (sizeof(PALETTE) / sizeof(PALETTE[0]))];
+	material.opacity = unit(meshRng) < parameters.transparentRatio ? 0.5f : 1.0f;
+	mesh.setMaterial(material);
+
+	return mesh;
+}
+
+std::vector<std::unique_ptr<RepoNode>> SceneGenerator::createNodes()
+{
+	rng.seed(parameters.seed);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	std::vector<std::unique_ptr<RepoNode>> nodes;
+
+	auto root = std::make_unique<TransformationNode>(RepoBSONFactory::makeTransformationNode({}, "rootNode", {}));
+	setIds(*root);
+
+	std::vector<repo::lib::RepoUUID> level = { root->getSharedID() };
+	nodes.push_back(std::move(root));
+
+	for (size_t d = 1; d < parameters.treeDepth; d++) {
+		std::vector<repo::lib::RepoUUID> next;
+		for (const auto& parent : level) {
+			for (size_t b = 0; b < parameters.branchingFactor; b++) {
+				auto trans = std::make_unique<TransformationNode>(RepoBSONFactory::makeTransformationNode(
+					{}, "Transformation " + std::to_string(d) + "_" + std::to_string(next.size()), { parent }));
+				setIds(*trans);
+				next.push_back(trans->getSharedID());
+				nodes.push_back(std::move(trans));
+			}
+		}
+		if (next.size()) {
+			level = next;
+		}
+	}
+
+	for (size_t i = 0; i < parameters.numMeshes; i++) {
+		auto mesh = std::make_unique<MeshNode>(createMesh(i));
+		setIds(*mesh);
+		mesh->addParent(level[i % level.size()]);
+
+		if (unit(rng) < parameters.metadataDensity) {
+			std::unordered_map<std::string, repo::lib::RepoVariant> values;
+			for (size_t k = 0; k < parameters.metadataEntries; k++) {
+				auto key = "Property " + std::to_string(k);
+				switch (k % 4) {
+				case 0:
+					values[key] = std::string("Value ") + std::to_string(rng() % 100);
+					break;
+				case 1:
+					values[key] = (int)(rng() % 1000);
+					break;
+				case 2:
+					values[key] = (double)unit(rng) * 1000.0;
+					break;
+				case 3:
+					values[key] = (bool)(rng() % 2);
+					break;
+				}
+			}
+			auto metadata = std::make_unique<MetadataNode>(RepoBSONFactory::makeMetaDataNode(values, mesh->getName(), { mesh->getSharedID() }));
+			setIds(*metadata);
+			nodes.push_back(std::move(metadata));
+		}
+
+		nodes.push_back(std::move(mesh));
+	}
+
+	return nodes;
+}
+
+void SceneGenerator::build(repo::manipulator::modelutility::RepoSceneBuilder& builder)
+{
+	builder.addNodes(createNodes());
+	builder.finalise();
+}
+
+RepoScene* SceneGenerator::createScene(
+	const std::string& database,
+	const std::string& project)
+{
+	RepoNodeSet meshes, metadata, transformations;
+	for (auto& node : createNodes()) {
+		switch (node->getTypeAsEnum()) {
+		case NodeType::MESH:
+			meshes.insert(node.release());
+			break;
+		case NodeType::METADATA:
+			metadata.insert(node.release());
+			break;
+		case NodeType::TRANSFORMATION:
+			transformations.insert(node.release());
+			break;
+		}
+	}
+
+	auto scene = new RepoScene({}, meshes, RepoNodeSet(), metadata, RepoNodeSet(), transformations);
+	scene->setDatabaseAndProjectName(database, project);
+	return scene;
+}
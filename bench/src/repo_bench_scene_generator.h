@@ -0,0 +1,104 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+* Deterministic generator for synthetic scenes, used by the benchmarks to
+* exercise the import, commit and optimisation stages with repeatable input.
+*/
+
+#pragma once
+
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <repo/core/model/bson/repo_node.h>
+#include <repo/core/model/bson/repo_node_mesh.h>
+#include <repo/core/model/collection/repo_scene.h>
+#include <repo/manipulator/modelutility/repo_scene_builder.h>
+
+namespace repo {
+	namespace bench {
+		namespace utils {
+
+			struct SceneParameters
+			{
+				// All content, including the node Ids, is derived from the seed
+				uint32_t seed = 1;
+
+				size_t numMeshes = 1000;
+
+				// Number of vertices per mesh before welding. Meshes are emitted as
+				// triangle soups (as most importers produce them), so roughly five
+				// in six of these are duplicates.
+				size_t verticesPerMesh = 600;
+
+				// Shape of the transformation tree. Meshes are distributed evenly
+				// over the leaves.
+				size_t treeDepth = 4;
+				size_t branchingFactor = 4;
+
+				// Probability that a mesh has a metadata node, and the number of
+				// entries in each one.
+				float metadataDensity = 0.5f;
+				size_t metadataEntries = 20;
+
+				// Proportion of meshes given a transparent material
+				float transparentRatio = 0.1f;
+			};
+
+			class SceneGenerator
+			{
+			public:
+				SceneGenerator(const SceneParameters& parameters);
+
+				/*
+				* Creates all the nodes of the scene. The first node is always the root
+				* transformation. Calling this repeatedly returns identical nodes.
+				*/
+				std::vector<std::unique_ptr<repo::core::model::RepoNode>> createNodes();
+
+				/*
+				* Creates a single, unparented, mesh node. The geometry depends only on
+				* the seed and the index.
+				*/
+				repo::core::model::MeshNode createMesh(size_t index);
+
+				/*
+				* Hands the nodes from createNodes to the builder and finalises it.
+				*/
+				void build(repo::manipulator::modelutility::RepoSceneBuilder& builder);
+
+				/*
+				* Creates an uncommitted RepoScene from the nodes of createNodes. The
+				* caller takes ownership of the scene.
+				*/
+				repo::core::model::RepoScene* createScene(
+					const std::string& database,
+					const std::string& project);
+
+			private:
+				SceneParameters parameters;
+				std::mt19937 rng;
+
+				repo::lib::RepoUUID nextUUID();
+
+				void setIds(repo::core::model::RepoNode& node);
+			};
+		}
+	}
+}
@@ -0,0 +1,111 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "repo_bench_utils.h"
+
+#include <atomic>
+#include <boost/filesystem.hpp>
+
+#include <repo/core/handler/repo_database_handler_memory.h>
+#include <repo/core/handler/repo_database_handler_mongo.h>
+#include <repo/core/handler/fileservice/repo_file_manager.h>
+#include <repo/core/model/bson/repo_node_supermesh.h>
+#include <repo/lib/repo_config.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+using namespace repo::bench::utils;
+
+std::shared_ptr<repo::core::handler::AbstractDatabaseHandler> repo::bench::utils::getHandler()
+{
+	char* pathChr = getenv(REPO_BENCH_CONFIG_ENV.c_str());
+
+	auto config = pathChr ? repo::lib::RepoConfig::fromFile(pathChr) : repo::lib::RepoConfig("", "", "");
+	if (!config.getFSConfig().configured) {
+		auto dir = boost::filesystem::temp_directory_path() / "3drepobouncerBench";
+		boost::filesystem::create_directories(dir);
+		config.configureFS(dir.string());
+	}
+
+	std::shared_ptr<repo::core::handler::AbstractDatabaseHandler> handler;
+	auto dbConf = config.getDatabaseConfig();
+	if (!pathChr) {
+		handler = repo::core::handler::MemoryDatabaseHandler::getHandler();
+	}
+	else if (!dbConf.path.empty()) {
+		handler = repo::core::handler::MemoryDatabaseHandler::getHandler(dbConf.path);
+	}
+	else if (dbConf.connString.empty()) {
+		handler = repo::core::handler::MongoDatabaseHandler::getHandler(dbConf.addr, dbConf.port, dbConf.username, dbConf.password);
+	}
+	else {
+		handler = repo::core::handler::MongoDatabaseHandler::getHandler(dbConf.connString, dbConf.username, dbConf.password);
+	}
+
+	handler->setFileManager(std::make_shared<repo::core::handler::fileservice::FileManager>(config, handler));
+	return handler;
+}
+
+std::string repo::bench::utils::makeProjectName(const std::string& prefix)
+{
+	static std::atomic<size_t> counter = 0;
+	return prefix + "_" + std::to_string(counter++);
+}
+
+void repo::bench::utils::dropProject(
+	repo::core::handler::AbstractDatabaseHandler* handler,
+	const std::string& database,
+	const std::string& project)
+{
+	for (const auto& collection : handler->getCollections(database)) {
+		if (collection.rfind(project + ".", 0) == 0) {
+			handler->dropCollection(database, collection);
+		}
+	}
+}
+
+size_t repo::bench::utils::getPeakMemoryUsage()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+		return counters.PeakWorkingSetSize;
+	}
+	return 0;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage)) {
+		return 0;
+	}
+#ifdef __APPLE__
+	return usage.ru_maxrss; // Bytes on macOS
+#else
+	return usage.ru_maxrss * 1024; // Kilobytes on Linux
+#endif
+#endif
+}
+
+void NullModelExport::addSupermesh(repo::core::model::SupermeshNode* supermesh)
+{
+	supermeshCount++;
+	vertexCount += supermesh->getNumVertices();
+}
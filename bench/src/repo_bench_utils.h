@@ -0,0 +1,98 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+* Common facilities for the benchmarks, such as obtaining a database handler
+* and disposing of the collections a benchmark has written.
+*/
+
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include <repo/core/handler/repo_database_handler_abstract.h>
+#include <repo/manipulator/modelconvertor/export/repo_model_export_abstract.h>
+
+// All benchmarks write to this database. It is safe to drop it between runs.
+const static std::string REPO_BENCH_DBNAME = "benchmarks";
+
+// The configuration file is the same format as the one given to the client,
+// and is read from the path in this environment variable.
+const static std::string REPO_BENCH_CONFIG_ENV = "REPO_BENCH_CONFIG";
+
+namespace repo {
+	namespace bench {
+		namespace utils {
+
+			/*
+			* Returns a database handler with a FileManager, configured from the file
+			* in REPO_BENCH_CONFIG. If the configuration does not specify a file
+			* share, one is created in the temporary directory. If REPO_BENCH_CONFIG
+			* is not set, an in-process handler is returned, so the results measure
+			* bouncer alone.
+			*/
+			std::shared_ptr<repo::core::handler::AbstractDatabaseHandler> getHandler();
+
+			/*
+			* Returns a project name that has not been used by this process before,
+			* so each benchmark iteration writes into empty collections.
+			*/
+			std::string makeProjectName(const std::string& prefix);
+
+			/*
+			* Drops all the collections belonging to a project. File share contents
+			* are not removed.
+			*/
+			void dropProject(
+				repo::core::handler::AbstractDatabaseHandler* handler,
+				const std::string& database,
+				const std::string& project);
+
+			/*
+			* Returns the peak resident memory of this process so far, in bytes
+			*/
+			size_t getPeakMemoryUsage();
+
+			/*
+			* Exporter that accepts supermeshes and discards them, so that the
+			* optimiser benchmarks measure only the optimiser.
+			*/
+			class NullModelExport : public repo::manipulator::modelconvertor::AbstractModelExport
+			{
+			public:
+				NullModelExport(
+					repo::core::handler::AbstractDatabaseHandler* dbHandler,
+					const std::string& databaseName,
+					const std::string& projectName,
+					const repo::lib::RepoUUID& revId
+				) : AbstractModelExport(dbHandler, databaseName, projectName, revId, { 0, 0, 0 }),
+					supermeshCount(0),
+					vertexCount(0)
+				{
+				}
+
+				void addSupermesh(repo::core::model::SupermeshNode* supermesh);
+
+				void finalise() {}
+
+				size_t supermeshCount;
+				size_t vertexCount;
+			};
+		}
+	}
+}
@@ -0,0 +1,86 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "repo_bulk_upsert_context.h"
+#include "repo/core/handler/repo_database_handler_abstract.h"
+#include <repo_log.h>
+
+using namespace repo::core::handler::database;
+
+BulkUpsertContext::BulkUpsertContext(
+	AbstractDatabaseHandler* handler,
+	const std::string& database,
+	const std::string& collection,
+	const bool overwrite,
+	const size_t maxBatchSize,
+	const size_t maxBatchDocuments) :
+	handler(handler),
+	database(database),
+	collection(collection),
+	overwrite(overwrite),
+	maxBatchSize(maxBatchSize),
+	maxBatchDocuments(maxBatchDocuments),
+	batchSize(0),
+	numBatches(0)
+{
+}
+
+BulkUpsertContext::~BulkUpsertContext()
+{
+	// Destructors must not throw; callers that need to know whether the last
+	// batch succeeded should call flush() themselves.
+
+	try {
+		flush();
+	}
+	catch (const std::exception& e)
+	{
+		repoError << "Failed to write the final batch of " << collection << ": " << e.what();
+	}
+}
+
+void BulkUpsertContext::upsertDocument(const repo::core::model::RepoBSON& obj)
+{
+	batch.push_back(obj);
+	batchSize += obj.objsize();
+	if (batchSize >= maxBatchSize || batch.size() >= maxBatchDocuments)
+	{
+		flush();
+	}
+}
+
+void BulkUpsertContext::flush()
+{
+	if (batch.empty())
+	{
+		return;
+	}
+
+	// Take the batch before writing it, so that if the write throws these
+	// documents are not submitted again by a later flush.
+
+	std::vector<repo::core::model::RepoBSON> pending;
+	pending.swap(batch);
+	batchSize = 0;
+	numBatches++;
+
+	auto errors = handler->upsertManyDocuments(database, collection, pending, overwrite);
+	for (auto& error : errors)
+	{
+		failures.push_back({ pending[error.index], error.message });
+	}
+}
@@ -0,0 +1,103 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "repo/repo_bouncer_global.h"
+#include "repo/core/model/bson/repo_bson.h"
+
+#include <string>
+#include <vector>
+
+namespace repo {
+	namespace core {
+		namespace handler {
+			class AbstractDatabaseHandler;
+			namespace database {
+
+				/*
+				* Batches upserts (replace or insert, by _id) into a collection, so they
+				* are sent as a small number of unordered bulk writes instead of one round
+				* trip per document. A batch is written once it reaches maxBatchSize bytes
+				* or maxBatchDocuments documents, when flush is called, and when the
+				* context is destroyed.
+				*
+				* As the writes in a batch are unordered, a document should be upserted
+				* at most once between flushes. Documents that fail to write do not stop
+				* the rest; they are collected, with the reason, in getFailures().
+				*/
+				class REPO_API_EXPORT BulkUpsertContext
+				{
+				public:
+					struct Failure
+					{
+						repo::core::model::RepoBSON document;
+						std::string message;
+					};
+
+					/**
+					* @param overwrite if a document exists, replace it entirely instead of
+					* updating the fields the new document has
+					*/
+					BulkUpsertContext(
+						AbstractDatabaseHandler* handler,
+						const std::string& database,
+						const std::string& collection,
+						const bool overwrite,
+						const size_t maxBatchSize = 16 * 1024 * 1024,
+						const size_t maxBatchDocuments = 10000);
+
+					~BulkUpsertContext();
+
+					void upsertDocument(const repo::core::model::RepoBSON& obj);
+
+					/*
+					* Writes any outstanding documents and blocks until complete. If the
+					* write throws, the batch is discarded rather than retried.
+					*/
+					void flush();
+
+					const std::vector<Failure>& getFailures() const
+					{
+						return failures;
+					}
+
+					/*
+					* The number of bulk writes made so far
+					*/
+					size_t getNumBatches() const
+					{
+						return numBatches;
+					}
+
+				private:
+					AbstractDatabaseHandler* handler;
+					std::string database;
+					std::string collection;
+					bool overwrite;
+					size_t maxBatchSize;
+					size_t maxBatchDocuments;
+
+					std::vector<repo::core::model::RepoBSON> batch;
+					size_t batchSize;
+					size_t numBatches;
+					std::vector<Failure> failures;
+				};
+			}
+		}
+	}
+}
@@ -35,6 +35,7 @@ namespace repo {
 		}
 		namespace handler {
 			class MongoDatabaseHandler;
+			class MemoryDatabaseHandler;
 			namespace database {
 				namespace query {
 
@@ -196,6 +197,7 @@ namespace repo {
 					{
 					protected:
 						friend class repo::core::handler::MongoDatabaseHandler;
+						friend class repo::core::handler::MemoryDatabaseHandler;
 						virtual operator model::RepoBSON() const = 0;
 					};
 
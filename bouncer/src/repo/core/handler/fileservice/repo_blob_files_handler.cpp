@@ -16,6 +16,7 @@
 */
 #include "repo_blob_files_handler.h"
 #include "repo/lib/datastructure/repo_uuid.h"
+#include "repo/lib/repo_sha256.h"
 
 using namespace repo::core::handler::fileservice;
 
@@ -44,6 +45,18 @@ void BlobFilesHandler::newActiveFile() {
 }
 
 DataRef BlobFilesHandler::insertBinary(const std::vector<uint8_t> &data) {
+	std::string digest;
+	if (deduplicate) {
+		repo::lib::RepoSHA256 hash;
+		hash.update(data.data(), data.size());
+		digest = hash.hexdigest();
+
+		auto existing = insertedData.find(digest);
+		if (existing != insertedData.end()) {
+			return existing->second;
+		}
+	}
+
 	if (!activeFile || activeFile->buffer.size() + data.size() > MAX_FILE_SIZE_BYTES) {
 		// either there is no activeFile or adding this data will exceed the max size to the blob file
 		// create a new one.
@@ -52,11 +65,19 @@ DataRef BlobFilesHandler::insertBinary(const std::vector<uint8_t> &data) {
 
 	auto startPos = activeFile->buffer.size();
 	auto dataSize = data.size();
+
+	// The buffer is reserved up-front, but its pages are only touched as it is
+	// filled, so the size rather than the capacity is counted
+	activeFile->allocation.resize(startPos + dataSize);
 	activeFile->buffer.resize(startPos + dataSize);
 
 	memcpy(&(activeFile->buffer.data())[startPos], data.data(), dataSize);
 
-	return DataRef(activeFile->name, startPos, dataSize);
+	DataRef ref(activeFile->name, startPos, dataSize);
+	if (deduplicate) {
+		insertedData.emplace(digest, ref);
+	}
+	return ref;
 }
 
 std::istream BlobFilesHandler::fetchStream(const std::string &name) {
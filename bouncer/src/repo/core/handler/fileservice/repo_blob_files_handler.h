@@ -19,9 +19,11 @@
 
 #include <string>
 #include <fstream>
+#include <unordered_map>
 
 #include "repo_file_manager.h"
 #include "repo_data_ref.h"
+#include "repo/lib/repo_memory_accounting.h"
 
 namespace repo {
 	namespace core {
@@ -45,7 +47,20 @@ namespace repo {
 
 					void finished() { commitActiveFile(); }
 
+					/**
+					* Appends the data to a blob file and returns a reference to it. If
+					* deduplication is enabled and identical data has already been inserted
+					* through this handler, the reference to the existing copy is returned
+					* and nothing is written.
+					*/
 					DataRef insertBinary(const std::vector<uint8_t> &data);
+
+					/**
+					* When enabled, data inserted from here on is keyed by its SHA-256 digest,
+					* so instances of the same geometry are only stored once. This costs a
+					* hash of every buffer, so it is off by default.
+					*/
+					void setDeduplicate(bool deduplicate) { this->deduplicate = deduplicate; }
 					std::vector<uint8_t> readToBuffer(const DataRef &ref);
 
 					std::shared_ptr<FileManager> getFileManager();
@@ -55,6 +70,7 @@ namespace repo {
 					{
 						std::string name;
 						std::vector<uint8_t> buffer;
+						repo::lib::RepoMemoryAccounting::Allocation allocation{ repo::lib::RepoMemoryAccounting::Tag::BLOB };
 					};
 
 					void commitActiveFile();
@@ -68,6 +84,11 @@ namespace repo {
 					const FileManager::Metadata& metadata;
 
 					std::map<std::string, std::ifstream> readStreams;
+
+					// References to the data inserted so far, by SHA-256 digest, when
+					// deduplicating
+					bool deduplicate = false;
+					std::unordered_map<std::string, DataRef> insertedData;
 				};
 			}
 		}
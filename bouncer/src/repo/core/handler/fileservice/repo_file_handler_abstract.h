@@ -62,6 +62,18 @@ namespace repo {
 						throw repo::lib::RepoException("This function is currently not supported for ref type: " + std::to_string((int)getType()));
 					};
 
+					/**
+					* Create a new file to be written incrementally. On return, link holds
+					* the link the file will have once it is written.
+					*/
+					virtual std::ofstream createFileStream(
+						const std::string &database,
+						const std::string &collection,
+						const std::string &fileName,
+						std::string &link) {
+						throw repo::lib::RepoException("This function is currently not supported for ref type: " + std::to_string((int)getType()));
+					};
+
 					/**
 					* Gets the link as a fully qualified filename that can be
 					* passed directly into fopen or similar functions.
@@ -118,13 +118,10 @@ std::vector<std::string> FSFileHandler::determineHierachy(
 	return levelNames;
 }
 
-std::string FSFileHandler::uploadFile(
-	const std::string          &database,
-	const std::string          &collection,
-	const std::string          &keyName,
-	const std::vector<uint8_t> &bin
-)
-{
+std::filesystem::path FSFileHandler::createPath(
+	const std::string &keyName,
+	std::string &link
+) const {
 	auto hierachy = level > 0 ? determineHierachy(keyName) : std::vector<std::string>();
 
 	auto path = dirPath;
@@ -139,6 +136,34 @@ std::string FSFileHandler::uploadFile(
 
 	path /= keyName;
 	ss << keyName;
+	link = ss.str();
+	return path;
+}
+
+std::ofstream FSFileHandler::createFileStream(
+	const std::string          &database,
+	const std::string          &collection,
+	const std::string          &keyName,
+	std::string                &link
+)
+{
+	auto path = createPath(keyName, link);
+	std::ofstream stream(path.string(), std::ios::out | std::ios::binary);
+	if (!stream) {
+		throw repo::lib::RepoException("Failed to create file " + path.string());
+	}
+	return stream;
+}
+
+std::string FSFileHandler::uploadFile(
+	const std::string          &database,
+	const std::string          &collection,
+	const std::string          &keyName,
+	const std::vector<uint8_t> &bin
+)
+{
+	std::string link;
+	auto path = createPath(keyName, link);
 	int retries = 0;
 	bool failed;
 	do {
@@ -151,5 +176,5 @@ std::string FSFileHandler::uploadFile(
 		}
 	} while (failed && ++retries < 3);
 
-	return failed ? "" : ss.str();
+	return failed ? "" : link;
 }
\ No newline at end of file
@@ -93,12 +93,27 @@ namespace repo {
 						const std::string& link
 					);
 
+					/**
+					* Create a file on the FS to be written incrementally
+					*/
+					std::ofstream createFileStream(
+						const std::string &database,
+						const std::string &collection,
+						const std::string &keyName,
+						std::string &link);
+
 				private:
 					/*
 					 *	=================================== Private Fields ========================================
 					 */
 					std::vector<std::string> determineHierachy(const std::string &name) const;
 
+					/**
+					* Creates the directories for a new file, returning its full path and
+					* setting link to the path relative to the store
+					*/
+					std::filesystem::path createPath(const std::string &keyName, std::string &link) const;
+
 					const std::filesystem::path dirPath;
 					const int level;
 					const static int minChunkLength = 4;
@@ -119,6 +119,108 @@ bool FileManager::uploadFileAndCommit(
 	return success;
 }
 
+FileManager::FileStream::FileStream(
+	std::shared_ptr<AbstractFileHandler> handler,
+	const std::string& databaseName,
+	const std::string& collectionNamePrefix,
+	const Encoding& encoding,
+	size_t chunkSize)
+	:handler(handler),
+	databaseName(databaseName),
+	collectionNamePrefix(collectionNamePrefix),
+	encoding(encoding),
+	committed(false)
+{
+	file = handler->createFileStream(databaseName, collectionNamePrefix, repo::lib::RepoUUID::createUUID().toString(), link);
+
+	switch (encoding)
+	{
+	case Encoding::Gzip:
+		out.push(boost::iostreams::gzip_compressor(boost::iostreams::gzip_params(), chunkSize), chunkSize);
+		break;
+	}
+	out.push(file, chunkSize);
+}
+
+FileManager::FileStream::~FileStream()
+{
+	if (!committed) {
+		try {
+			close();
+		}
+		catch (const std::exception&) {
+			// The file is being discarded, so it doesn't matter if it is incomplete
+		}
+		if (!handler->deleteFile(databaseName, collectionNamePrefix, link)) {
+			repoError << "Failed to remove uncommitted file " << link;
+		}
+	}
+}
+
+size_t FileManager::FileStream::close()
+{
+	// Resetting the chain flushes and closes each filter in turn, so any
+	// trailing data (such as the gzip footer) is written before the file is
+	// closed.
+
+	if (!file.is_open()) {
+		throw repo::lib::RepoException("File " + link + " has already been closed");
+	}
+
+	out.reset();
+	file.flush();
+	size_t size = file.tellp();
+	file.close();
+	if (!file) {
+		throw repo::lib::RepoException("Failed to write to file " + link);
+	}
+	return size;
+}
+
+std::unique_ptr<FileManager::FileStream> FileManager::createFileStream(
+	const std::string                            &databaseName,
+	const std::string                            &collectionNamePrefix,
+	const Encoding                               &encoding,
+	size_t                                       chunkSize)
+{
+	return std::unique_ptr<FileStream>(new FileStream(fsHandler, databaseName, collectionNamePrefix, encoding, chunkSize));
+}
+
+template<typename IdType>
+bool FileManager::commitFileStream(
+	FileStream                                   &file,
+	const IdType                                 &id,
+	const Metadata                               &metadata)
+{
+	size_t size;
+	try {
+		size = file.close();
+	}
+	catch (const repo::lib::RepoException& e) {
+		repoError << e.printFull();
+		return false;
+	}
+
+	auto fileMetadata = metadata;
+	switch (file.encoding)
+	{
+	case Encoding::Gzip:
+		fileMetadata["encoding"] = std::string("gzip");
+		break;
+	}
+
+	file.committed = upsertFileRef(
+		file.databaseName,
+		file.collectionNamePrefix,
+		id,
+		file.link,
+		fsHandler->getType(),
+		size,
+		fileMetadata);
+
+	return file.committed;
+}
+
 bool FileManager::deleteFileAndRef(
 	const std::string                            &databaseName,
 	const std::string                            &collectionNamePrefix,
@@ -377,4 +479,14 @@ template bool FileManager::uploadFileAndCommit<repo::lib::RepoUUID>(
 	const repo::lib::RepoUUID&,
 	const std::vector<uint8_t>&,
 	const Metadata&,
-	const Encoding&);
\ No newline at end of file
+	const Encoding&);
+
+template bool FileManager::commitFileStream<std::string>(
+	FileStream&,
+	const std::string&,
+	const Metadata&);
+
+template bool FileManager::commitFileStream<repo::lib::RepoUUID>(
+	FileStream&,
+	const repo::lib::RepoUUID&,
+	const Metadata&);
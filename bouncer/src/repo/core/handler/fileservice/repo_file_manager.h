@@ -18,6 +18,9 @@
 #pragma once
 
 #include <string>
+#include <fstream>
+#include <memory>
+#include <boost/iostreams/filtering_stream.hpp>
 
 #include "repo_file_handler_abstract.h"
 #include "repo/core/model/bson/repo_bson_ref.h"
@@ -55,6 +58,46 @@ namespace repo {
 						Gzip = 1
 					};
 
+					/*
+					* A file being written to the store incrementally. Data written to
+					* stream() is encoded and written out in chunks as it arrives, so the
+					* contents never have to be held in memory. The file is only
+					* referenced once passed to commitFileStream; if it is not, it is
+					* deleted when this object is destroyed.
+					*/
+					class FileStream
+					{
+					public:
+						~FileStream();
+
+						std::ostream& stream()
+						{
+							return out;
+						}
+
+					private:
+						friend class FileManager;
+
+						FileStream(
+							std::shared_ptr<AbstractFileHandler> handler,
+							const std::string& databaseName,
+							const std::string& collectionNamePrefix,
+							const Encoding& encoding,
+							size_t chunkSize);
+
+						std::shared_ptr<AbstractFileHandler> handler;
+						std::string databaseName;
+						std::string collectionNamePrefix;
+						std::string link;
+						Encoding encoding;
+						std::ofstream file;
+						boost::iostreams::filtering_ostream out;
+						bool committed;
+
+						// Completes encoding and closes the file, returning its size
+						size_t close();
+					};
+
 					/**
 					 * Upload file and commit ref entry to database. id will be the member
 					 * by which the ref node is keyed. It can be a std::string or RepoUUID.
@@ -69,6 +112,29 @@ namespace repo {
 						const Encoding                               &encoding = Encoding::None
 					);
 
+					/**
+					 * Create a file to be written incrementally, and committed with
+					 * commitFileStream once complete. The encoded data is written to the
+					 * store in chunks of chunkSize.
+					 */
+					std::unique_ptr<FileStream> createFileStream(
+						const std::string                            &databaseName,
+						const std::string                            &collectionNamePrefix,
+						const Encoding                               &encoding = Encoding::None,
+						size_t                                       chunkSize = 1024 * 1024
+					);
+
+					/**
+					 * Finish writing a file created with createFileStream, and commit
+					 * the ref entry to the database, as uploadFileAndCommit.
+					 */
+					template<typename IdType>
+					bool commitFileStream(
+						FileStream                                   &file,
+						const IdType                                 &id,
+						const repo::core::model::RepoRef::Metadata   &metadata = {}
+					);
+
 					/**
 					 * Get the file base on the the ref entry in database
 					 */
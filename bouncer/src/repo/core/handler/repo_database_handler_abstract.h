@@ -78,6 +78,16 @@ namespace repo {
 
 				using CursorPtr = std::unique_ptr<repo::core::handler::database::Cursor>;
 
+				/*
+				* Describes a document in a bulk write that could not be written. The
+				* index is the position of the document in the vector given to the write.
+				*/
+				struct WriteError
+				{
+					size_t index;
+					std::string message;
+				};
+
 				/*
 				* An object that provides write access to a collection from a specific
 				* thread, that may be different to the one that owns the database handler.
@@ -101,6 +111,14 @@ namespace repo {
 					*/
 					virtual void flush() = 0;
 
+					/*
+					* If enabled, binary members inserted from here on that are identical to
+					* ones already written through this context refer to the same data, rather
+					* than being stored again. This is off by default, as it requires hashing
+					* every binary.
+					*/
+					virtual void setDeduplicateBinaries(bool deduplicate) = 0;
+
 					// Make the destructor virtual to ensure unique_ptr calls the destructor
 					// on any subclasses.
 					virtual ~BulkWriteContext() { }
@@ -218,6 +236,22 @@ namespace repo {
 					const repo::core::model::RepoBSON &obj,
 					const bool        &overwrite) = 0;
 
+				/**
+				* Update/insert multiple documents in database.collection, matching them
+				* by their _id, in one unordered bulk write. A document that cannot be
+				* written does not prevent the others from being written.
+				* @param database name
+				* @param collection name
+				* @param documents to upsert
+				* @param if it is an update, overwrites the document instead of updating the fields it has
+				* @return returns the documents that failed, if any
+				*/
+				virtual std::vector<database::WriteError> upsertManyDocuments(
+					const std::string &database,
+					const std::string &collection,
+					const std::vector<repo::core::model::RepoBSON> &obj,
+					const bool        &overwrite) = 0;
+
 				/**
 				* Remove a collection from the database
 				* @param database the database the collection resides in
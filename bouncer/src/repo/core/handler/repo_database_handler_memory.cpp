@@ -0,0 +1,1552 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+*  In-process database handler
+*/
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+
+#include <repo_log.h>
+#include "repo_database_handler_memory.h"
+#include "fileservice/repo_file_manager.h"
+#include "fileservice/repo_blob_files_handler.h"
+#include "repo/core/model/bson/repo_bson_builder.h"
+#include "repo/core/model/repo_model_global.h"
+#include "repo/error_codes.h"
+#include "repo/lib/repo_exception.h"
+#include "database/repo_query.h"
+
+#include <bsoncxx/builder/basic/document.hpp>
+#include <bsoncxx/builder/basic/kvp.hpp>
+#include <bsoncxx/document/view.hpp>
+#include <bsoncxx/types/bson_value/view.hpp>
+
+using namespace repo::core::handler;
+using namespace repo::core::handler::database;
+using namespace bsoncxx::builder::basic;
+
+// Same limit as Mongo, so documents that work here will work there
+static uint64_t MAX_MEMORY_BSON_SIZE = 16777216L;
+
+static const char MEMORY_DB_MAGIC[] = "3DREPOMEMDB";
+static const uint32_t MEMORY_DB_VERSION = 1;
+
+class MemoryDatabaseHandler::MemoryDatabaseHandlerException : public repo::lib::RepoException
+{
+public:
+	MemoryDatabaseHandlerException(const std::string& method, const std::string& db, const std::string collection)
+		: RepoException("MemoryDatabaseHandler exception: in " + method + " on: " + db + "." + collection)
+	{
+		errorCode = REPOERR_AUTH_FAILED; // As with Mongo, signal this is a database operation problem if no outer exception sets the code
+	}
+
+	MemoryDatabaseHandlerException(const std::string& msg)
+		: RepoException("MemoryDatabaseHandler exception: " + msg)
+	{
+		errorCode = REPOERR_AUTH_FAILED;
+	}
+};
+
+/*
+* The following functions implement the subset of Mongo's comparison semantics
+* that the RepoQuery types require. Numbers compare by value regardless of
+* their width, and all other types compare by type and then content.
+*/
+
+static bool isNumeric(const bsoncxx::type& t)
+{
+	return t == bsoncxx::type::k_int32 || t == bsoncxx::type::k_int64 || t == bsoncxx::type::k_double;
+}
+
+static double getNumber(const bsoncxx::types::bson_value::view& v)
+{
+	switch (v.type())
+	{
+	case bsoncxx::type::k_int32:
+		return v.get_int32().value;
+	case bsoncxx::type::k_int64:
+		return (double)v.get_int64().value;
+	default:
+		return v.get_double().value;
+	}
+}
+
+static bool valuesEqual(const bsoncxx::types::bson_value::view& a, const bsoncxx::types::bson_value::view& b)
+{
+	if (isNumeric(a.type()) && isNumeric(b.type()))
+	{
+		if (a.type() != bsoncxx::type::k_double && b.type() != bsoncxx::type::k_double)
+		{
+			int64_t x = a.type() == bsoncxx::type::k_int32 ? a.get_int32().value : a.get_int64().value;
+			int64_t y = b.type() == bsoncxx::type::k_int32 ? b.get_int32().value : b.get_int64().value;
+			return x == y;
+		}
+		return getNumber(a) == getNumber(b);
+	}
+	return a == b;
+}
+
+static int compareValues(const bsoncxx::types::bson_value::view& a, const bsoncxx::types::bson_value::view& b)
+{
+	if (isNumeric(a.type()) && isNumeric(b.type()))
+	{
+		auto x = getNumber(a);
+		auto y = getNumber(b);
+		return x < y ? -1 : (x > y ? 1 : 0);
+	}
+
+	if (a.type() != b.type())
+	{
+		return a.type() < b.type() ? -1 : 1;
+	}
+
+	switch (a.type())
+	{
+	case bsoncxx::type::k_string:
+		return a.get_string().value.compare(b.get_string().value);
+	case bsoncxx::type::k_date:
+	{
+		auto x = a.get_date().to_int64();
+		auto y = b.get_date().to_int64();
+		return x < y ? -1 : (x > y ? 1 : 0);
+	}
+	case bsoncxx::type::k_bool:
+		return (int)a.get_bool().value - (int)b.get_bool().value;
+	default:
+		return 0;
+	}
+}
+
+/*
+* Returns a key for the value that is the same for any two values that are
+* equal under valuesEqual.
+*/
+static std::string makeValueKey(const bsoncxx::types::bson_value::view& v)
+{
+	if (isNumeric(v.type()))
+	{
+		auto d = make_document(kvp("", getNumber(v)));
+		return std::string((const char*)d.view().data(), d.view().length());
+	}
+	auto d = make_document(kvp("", v));
+	return std::string((const char*)d.view().data(), d.view().length());
+}
+
+/*
+* Collects the values at the (possibly dotted) path. As with Mongo, when a path
+* passes through an array, the remainder of the path is resolved against each
+* document in the array.
+*/
+static void getValues(
+	const bsoncxx::document::view& doc,
+	const std::string& path,
+	std::vector<bsoncxx::types::bson_value::view>& values)
+{
+	auto dot = path.find('.');
+	auto it = doc.find(path.substr(0, dot));
+	if (it == doc.end())
+	{
+		return;
+	}
+
+	auto value = it->get_value();
+	if (dot == std::string::npos)
+	{
+		values.push_back(value);
+		return;
+	}
+
+	auto remainder = path.substr(dot + 1);
+	if (value.type() == bsoncxx::type::k_document)
+	{
+		getValues(value.get_document().value, remainder, values);
+	}
+	else if (value.type() == bsoncxx::type::k_array)
+	{
+		for (const auto& e : value.get_array().value)
+		{
+			if (e.type() == bsoncxx::type::k_document)
+			{
+				getValues(e.get_document().value, remainder, values);
+			}
+		}
+	}
+}
+
+/*
+* As getValues, but arrays at the end of the path are replaced by their
+* elements, which is how equality matching and multikey indexes treat them.
+*/
+static void getLeafValues(
+	const bsoncxx::document::view& doc,
+	const std::string& path,
+	std::vector<bsoncxx::types::bson_value::view>& values)
+{
+	std::vector<bsoncxx::types::bson_value::view> found;
+	getValues(doc, path, found);
+	for (const auto& v : found)
+	{
+		if (v.type() == bsoncxx::type::k_array)
+		{
+			for (const auto& e : v.get_array().value)
+			{
+				values.push_back(e.get_value());
+			}
+		}
+		else
+		{
+			values.push_back(v);
+		}
+	}
+}
+
+/*
+* A Collection holds its documents in insertion order, keyed by a sequence
+* number that never changes for the lifetime of the document. The _id field is
+* always indexed; further single field indexes map the value keys of a field to
+* the sequence numbers of the documents that hold them.
+*/
+class MemoryDatabaseHandler::Collection
+{
+public:
+	using Index = std::unordered_map<std::string, std::set<uint64_t>>;
+
+	std::map<uint64_t, repo::core::model::RepoBSON> documents;
+	std::unordered_map<std::string, uint64_t> ids;
+	std::map<std::string, Index> indexes;
+
+	// Number of times each document has been inserted or replaced, by _id
+	std::unordered_map<std::string, size_t> writes;
+
+	Collection() : next(0)
+	{
+	}
+
+	const repo::core::model::RepoBSON* findById(const bsoncxx::types::bson_value::view& id, uint64_t* seq = nullptr) const
+	{
+		auto it = ids.find(makeValueKey(id));
+		if (it == ids.end())
+		{
+			return nullptr;
+		}
+		if (seq)
+		{
+			*seq = it->second;
+		}
+		return &documents.at(it->second);
+	}
+
+	void insert(const repo::core::model::RepoBSON& obj)
+	{
+		auto view = obj.view();
+		auto id = view.find(REPO_LABEL_ID);
+		if (id == view.end())
+		{
+			throw repo::lib::RepoException("Documents must have an _id field");
+		}
+
+		auto key = makeValueKey(id->get_value());
+		if (ids.find(key) != ids.end())
+		{
+			throw repo::lib::RepoException("Duplicate key error on _id");
+		}
+
+		auto seq = next++;
+		documents.emplace(seq, repo::core::model::RepoBSON(view));
+		ids[key] = seq;
+		writes[key]++;
+		addToIndexes(seq, view);
+	}
+
+	void replace(uint64_t seq, const repo::core::model::RepoBSON& obj)
+	{
+		removeFromIndexes(seq, documents.at(seq).view());
+		documents.erase(seq);
+		documents.emplace(seq, repo::core::model::RepoBSON(obj.view()));
+		auto view = documents.at(seq).view();
+		writes[makeValueKey(view.find(REPO_LABEL_ID)->get_value())]++;
+		addToIndexes(seq, view);
+	}
+
+	void erase(uint64_t seq)
+	{
+		auto view = documents.at(seq).view();
+		ids.erase(makeValueKey(view.find(REPO_LABEL_ID)->get_value()));
+		removeFromIndexes(seq, view);
+		documents.erase(seq);
+	}
+
+	void createIndex(const std::string& field)
+	{
+		if (field == REPO_LABEL_ID || indexes.find(field) != indexes.end())
+		{
+			return;
+		}
+
+		auto& index = indexes[field];
+		for (const auto& d : documents)
+		{
+			addToIndex(index, field, d.first, d.second.view());
+		}
+	}
+
+	/*
+	* Returns the sequence numbers of the documents that have any of the values
+	* in the field, if the field is indexed. Returns false if it is not.
+	*/
+	bool lookup(
+		const std::string& field,
+		const std::vector<bsoncxx::types::bson_value::view>& values,
+		std::set<uint64_t>& results) const
+	{
+		if (field == REPO_LABEL_ID)
+		{
+			for (const auto& v : values)
+			{
+				auto it = ids.find(makeValueKey(v));
+				if (it != ids.end())
+				{
+					results.insert(it->second);
+				}
+			}
+			return true;
+		}
+
+		auto index = indexes.find(field);
+		if (index == indexes.end())
+		{
+			return false;
+		}
+
+		for (const auto& v : values)
+		{
+			auto it = index->second.find(makeValueKey(v));
+			if (it != index->second.end())
+			{
+				results.insert(it->second.begin(), it->second.end());
+			}
+		}
+		return true;
+	}
+
+private:
+	uint64_t next;
+
+	void addToIndex(Index& index, const std::string& field, uint64_t seq, const bsoncxx::document::view& view)
+	{
+		std::vector<bsoncxx::types::bson_value::view> values;
+		getLeafValues(view, field, values);
+		for (const auto& v : values)
+		{
+			index[makeValueKey(v)].insert(seq);
+		}
+	}
+
+	void addToIndexes(uint64_t seq, const bsoncxx::document::view& view)
+	{
+		for (auto& index : indexes)
+		{
+			addToIndex(index.second, index.first, seq, view);
+		}
+	}
+
+	void removeFromIndexes(uint64_t seq, const bsoncxx::document::view& view)
+	{
+		for (auto& index : indexes)
+		{
+			std::vector<bsoncxx::types::bson_value::view> values;
+			getLeafValues(view, index.first, values);
+			for (const auto& v : values)
+			{
+				auto it = index.second.find(makeValueKey(v));
+				if (it != index.second.end())
+				{
+					it->second.erase(seq);
+					if (it->second.empty())
+					{
+						index.second.erase(it);
+					}
+				}
+			}
+		}
+	}
+};
+
+/*
+* QueryMatcher compiles a RepoQuery into a tree of predicates that can be
+* evaluated against documents directly. The values of Eq expressions are
+* converted to bson once, when the matcher is created.
+*/
+class MemoryDatabaseHandler::QueryMatcher
+{
+public:
+	QueryMatcher(const query::RepoQuery& query)
+		:root(std::visit(Compiler(), query))
+	{
+	}
+
+	/*
+	* Mirrors MongoDatabaseHandler, which will not return any documents for
+	* a filter that does not build any operators.
+	*/
+	bool isEmpty() const
+	{
+		return isEmpty(root);
+	}
+
+	bool operator()(const bsoncxx::document::view& doc) const
+	{
+		return match(root, doc);
+	}
+
+	/*
+	* Uses the indexes of the collection to find a superset of the documents that
+	* could match. Returns false if the query cannot be answered by an index, in
+	* which case the whole collection should be scanned.
+	*/
+	bool getCandidates(const Collection& collection, std::set<uint64_t>& candidates) const
+	{
+		// Empty Eq expressions are ignored by match (as they are by Mongo), so
+		// they cannot narrow down the candidates either
+
+		if (root.type == Node::EQ)
+		{
+			return root.targets.size() && collection.lookup(root.field, root.targets, candidates);
+		}
+		if (root.type == Node::AND)
+		{
+			for (const auto& c : root.children)
+			{
+				if (c.type == Node::EQ && c.targets.size() && collection.lookup(c.field, c.targets, candidates))
+				{
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+private:
+	struct Node
+	{
+		enum Type { EQ, EXISTS, AND, OR, NONE } type;
+		std::string field;
+		bool exists;
+		std::shared_ptr<repo::core::model::RepoBSON> values; // Owns the memory the targets point to
+		std::vector<bsoncxx::types::bson_value::view> targets;
+		std::vector<Node> children;
+	};
+
+	struct Compiler
+	{
+		Node operator() (const query::Eq& n) const
+		{
+			Node node;
+			node.type = Node::EQ;
+			node.field = n.field;
+
+			repo::core::model::RepoBSONBuilder builder;
+			builder.appendArray("v", n.values);
+			node.values = std::make_shared<repo::core::model::RepoBSON>(builder.obj());
+			for (const auto& e : node.values->view()["v"].get_array().value)
+			{
+				node.targets.push_back(e.get_value());
+			}
+			return node;
+		}
+
+		Node operator() (const query::Exists& n) const
+		{
+			Node node;
+			node.type = Node::EXISTS;
+			node.field = n.field;
+			node.exists = n.exists;
+			return node;
+		}
+
+		Node operator() (const query::Or& n) const
+		{
+			Node node;
+			node.type = Node::OR;
+			for (const auto& q : n.conditions)
+			{
+				node.children.push_back(std::visit(*this, q));
+			}
+			return node;
+		}
+
+		Node operator() (const query::RepoQueryBuilder& n) const
+		{
+			Node node;
+			node.type = Node::AND;
+			for (const auto& q : n.conditions)
+			{
+				node.children.push_back(std::visit(*this, q));
+			}
+			return node;
+		}
+
+		Node operator() (const query::RepoProjectionBuilder& n) const
+		{
+			Node node;
+			node.type = Node::NONE;
+			return node;
+		}
+	};
+
+	Node root;
+
+	static bool isEmpty(const Node& node)
+	{
+		switch (node.type)
+		{
+		case Node::EQ:
+			return node.targets.empty();
+		case Node::EXISTS:
+			return false;
+		case Node::AND:
+			return std::all_of(node.children.begin(), node.children.end(), [](const Node& c) { return isEmpty(c); });
+		case Node::OR:
+			return node.children.empty();
+		default:
+			return true;
+		}
+	}
+
+	static bool match(const Node& node, const bsoncxx::document::view& doc)
+	{
+		switch (node.type)
+		{
+		case Node::EQ:
+		{
+			if (node.targets.empty())
+			{
+				return true; // Mongo ignores empty Eq expressions
+			}
+			std::vector<bsoncxx::types::bson_value::view> values;
+			getLeafValues(doc, node.field, values);
+			for (const auto& v : values)
+			{
+				for (const auto& t : node.targets)
+				{
+					if (valuesEqual(v, t))
+					{
+						return true;
+					}
+				}
+			}
+			return false;
+		}
+		case Node::EXISTS:
+		{
+			std::vector<bsoncxx::types::bson_value::view> values;
+			getValues(doc, node.field, values);
+			return values.empty() != node.exists;
+		}
+		case Node::AND:
+			for (const auto& c : node.children)
+			{
+				if (!match(c, doc))
+				{
+					return false;
+				}
+			}
+			return true;
+		case Node::OR:
+			for (const auto& c : node.children)
+			{
+				if (match(c, doc))
+				{
+					return true;
+				}
+			}
+			return false;
+		default:
+			return true;
+		}
+	}
+};
+
+/*
+* Applies a RepoProjectionBuilder to a document. Projections operate on the top
+* level fields; a dotted path includes or excludes the whole of its top level
+* field. As with Mongo, _id is returned unless it is explicitly excluded.
+*/
+static repo::core::model::RepoBSON project(
+	const bsoncxx::document::view& doc,
+	const query::RepoQuery& projection)
+{
+	auto builder = std::get_if<query::RepoProjectionBuilder>(&projection);
+	if (!builder || (builder->includedFields.empty() && builder->excludedFields.empty()))
+	{
+		return repo::core::model::RepoBSON(doc);
+	}
+
+	auto topLevel = [](const std::string& field) {
+		return field.substr(0, field.find('.'));
+	};
+
+	std::set<std::string> included, excluded;
+	for (const auto& f : builder->includedFields)
+	{
+		included.insert(topLevel(f));
+	}
+	for (const auto& f : builder->excludedFields)
+	{
+		if (f.find('.') == std::string::npos)
+		{
+			excluded.insert(f);
+		}
+	}
+
+	document result;
+	for (const auto& e : doc)
+	{
+		std::string key(e.key());
+		bool keep = included.size() ? (included.count(key) || key == REPO_LABEL_ID) : true;
+		if (keep && !excluded.count(key))
+		{
+			result.append(kvp(key, e.get_value()));
+		}
+	}
+	return repo::core::model::RepoBSON(result.view());
+}
+
+/*
+* The cursor for this handler holds a snapshot of the results, so it remains
+* valid regardless of what happens to the collection while it is being read.
+*/
+class MemoryDatabaseHandler::MemoryCursor : public database::Cursor
+{
+public:
+	class MemoryIteratorImpl : public database::Cursor::Iterator::Impl
+	{
+	public:
+		MemoryIteratorImpl(MemoryCursor* cursor, size_t position)
+			:cursor(cursor),
+			position(position)
+		{
+		}
+
+		virtual const repo::core::model::RepoBSON operator*()
+		{
+			return cursor->documents[position];
+		}
+
+		virtual void operator++()
+		{
+			position++;
+		}
+
+		virtual bool operator!=(const database::Cursor::Iterator::Impl* other)
+		{
+			return position != ((const MemoryIteratorImpl*)other)->position;
+		}
+
+		MemoryCursor* cursor;
+		size_t position;
+	};
+
+	MemoryCursor(std::vector<repo::core::model::RepoBSON>&& documents)
+		:documents(std::move(documents)),
+		_begin(this, 0),
+		_end(this, this->documents.size())
+	{
+	}
+
+	virtual database::Cursor::Iterator begin()
+	{
+		return database::Cursor::Iterator(&_begin);
+	}
+
+	virtual database::Cursor::Iterator end()
+	{
+		return database::Cursor::Iterator(&_end);
+	}
+
+private:
+	std::vector<repo::core::model::RepoBSON> documents;
+	MemoryIteratorImpl _begin;
+	MemoryIteratorImpl _end;
+};
+
+/*
+* Implements the BulkWriteContext. Writes are applied immediately, as there is
+* no round trip to amortise; the context exists to own the BlobFilesHandler
+* that holds the binary members until they are flushed.
+*/
+class MemoryDatabaseHandler::MemoryWriteContext : public database::BulkWriteContext
+{
+	MemoryDatabaseHandler* handler;
+	std::string database;
+	std::string collection;
+
+	// The blob files handler takes a reference to the metadata map, so it must
+	// be declared (and constructed) first
+	repo::core::handler::fileservice::FileManager::Metadata fileMetadata;
+	fileservice::BlobFilesHandler blobHandler;
+
+public:
+	MemoryWriteContext(
+		MemoryDatabaseHandler* handler,
+		const std::string& database,
+		const std::string& collection) :
+		handler(handler),
+		database(database),
+		collection(collection),
+		blobHandler(handler->fileManager, database, collection, fileMetadata)
+	{
+	}
+
+	~MemoryWriteContext()
+	{
+		flush();
+	}
+
+	void insertDocument(repo::core::model::RepoBSON obj) override
+	{
+		try {
+			auto data = obj.getBinariesAsBuffer();
+			if (data.second.size()) {
+				if (!handler->fileManager) {
+					throw repo::lib::RepoException("A FileManager must be set to store documents with binary members");
+				}
+				auto ref = blobHandler.insertBinary(data.second);
+				obj.replaceBinaryWithReference(ref.serialise(), data.first);
+			}
+			handler->insert(database, collection, obj);
+		}
+		catch (...)
+		{
+			std::throw_with_nested(MemoryDatabaseHandlerException("MemoryWriteContext::insertDocument", database, collection));
+		}
+	}
+
+	void updateDocument(const database::query::RepoUpdate& update) override
+	{
+		try {
+			handler->update(database, collection, update);
+		}
+		catch (...)
+		{
+			std::throw_with_nested(MemoryDatabaseHandlerException("MemoryWriteContext::updateDocument", database, collection));
+		}
+	}
+
+	void flush() override
+	{
+		blobHandler.finished();
+	}
+
+	void setDeduplicateBinaries(bool deduplicate) override
+	{
+		blobHandler.setDeduplicate(deduplicate);
+	}
+};
+
+MemoryDatabaseHandler::MemoryDatabaseHandler(const std::string& path) :
+	AbstractDatabaseHandler(MAX_MEMORY_BSON_SIZE),
+	path(path)
+{
+	if (!path.empty())
+	{
+		load();
+	}
+}
+
+MemoryDatabaseHandler::~MemoryDatabaseHandler()
+{
+	try
+	{
+		save();
+	}
+	catch (const std::exception& e)
+	{
+		repoError << "Failed to save in-process database to " << path << ": " << e.what();
+	}
+}
+
+std::shared_ptr<MemoryDatabaseHandler> MemoryDatabaseHandler::getHandler(const std::string& path)
+{
+	if (path.empty())
+	{
+		return std::make_shared<MemoryDatabaseHandler>();
+	}
+
+	// Handlers backed by the same file are shared, otherwise each would
+	// overwrite the others' changes when saving.
+
+	static std::mutex handlersMutex;
+	static std::unordered_map<std::string, std::weak_ptr<MemoryDatabaseHandler>> handlers;
+
+	std::lock_guard<std::mutex> lock(handlersMutex);
+	auto handler = handlers[path].lock();
+	if (!handler)
+	{
+		handler = std::make_shared<MemoryDatabaseHandler>(path);
+		handlers[path] = handler;
+	}
+	return handler;
+}
+
+void MemoryDatabaseHandler::setFileManager(std::shared_ptr<fileservice::FileManager> manager)
+{
+	this->fileManager = manager;
+}
+
+std::shared_ptr<fileservice::FileManager> MemoryDatabaseHandler::getFileManager()
+{
+	return this->fileManager;
+}
+
+MemoryDatabaseHandler::Collection* MemoryDatabaseHandler::getCollection(
+	const std::string& database,
+	const std::string& collection,
+	bool create)
+{
+	// The caller must hold the mutex (exclusively if create is true)
+
+	auto db = databases.find(database);
+	if (db == databases.end())
+	{
+		if (!create)
+		{
+			return nullptr;
+		}
+		db = databases.emplace(database, std::map<std::string, std::unique_ptr<Collection>>()).first;
+	}
+
+	auto col = db->second.find(collection);
+	if (col == db->second.end())
+	{
+		if (!create)
+		{
+			return nullptr;
+		}
+		col = db->second.emplace(collection, std::make_unique<Collection>()).first;
+	}
+
+	return col->second.get();
+}
+
+std::vector<repo::core::model::RepoBSON> MemoryDatabaseHandler::find(
+	const std::string& database,
+	const std::string& collection,
+	const database::query::RepoQuery& filter,
+	const database::query::RepoQuery& projection,
+	size_t limit,
+	const std::string& sortField,
+	int sortOrder)
+{
+	std::vector<repo::core::model::RepoBSON> results;
+
+	QueryMatcher matcher(filter);
+	if (matcher.isEmpty() || database.empty() || collection.empty())
+	{
+		return results;
+	}
+
+	std::shared_lock lock(mutex);
+
+	auto col = getCollection(database, collection, false);
+	if (!col)
+	{
+		return results;
+	}
+
+	std::vector<const repo::core::model::RepoBSON*> matches;
+
+	std::set<uint64_t> candidates;
+	if (matcher.getCandidates(*col, candidates))
+	{
+		for (auto seq : candidates)
+		{
+			auto& doc = col->documents.at(seq);
+			if (matcher(doc.view()))
+			{
+				matches.push_back(&doc);
+			}
+		}
+	}
+	else
+	{
+		for (const auto& d : col->documents)
+		{
+			if (matcher(d.second.view()))
+			{
+				matches.push_back(&d.second);
+			}
+		}
+	}
+
+	if (!sortField.empty())
+	{
+		std::stable_sort(matches.begin(), matches.end(), [&](const repo::core::model::RepoBSON* a, const repo::core::model::RepoBSON* b) {
+			std::vector<bsoncxx::types::bson_value::view> x, y;
+			getValues(a->view(), sortField, x);
+			getValues(b->view(), sortField, y);
+			if (x.empty() || y.empty())
+			{
+				return sortOrder < 0 ? x.size() > y.size() : x.size() < y.size(); // Missing fields sort first in ascending order
+			}
+			auto c = compareValues(x[0], y[0]);
+			return sortOrder < 0 ? c > 0 : c < 0;
+		});
+	}
+
+	if (limit && matches.size() > limit)
+	{
+		matches.resize(limit);
+	}
+
+	results.reserve(matches.size());
+	for (auto doc : matches)
+	{
+		results.push_back(project(doc->view(), projection));
+	}
+
+	return results;
+}
+
+void MemoryDatabaseHandler::insert(
+	const std::string& database,
+	const std::string& collection,
+	const repo::core::model::RepoBSON& obj)
+{
+	if (database.empty() || collection.empty())
+	{
+		throw repo::lib::RepoException("Database and collection names must not be empty");
+	}
+
+	if (obj.objsize() > maxDocumentSize)
+	{
+		throw repo::lib::RepoException("Document exceeds maxBsonObjectSize");
+	}
+
+	std::unique_lock lock(mutex);
+	getCollection(database, collection, true)->insert(obj);
+}
+
+void MemoryDatabaseHandler::update(
+	const std::string& database,
+	const std::string& collection,
+	const database::query::RepoUpdate& update)
+{
+	auto addParent = std::get_if<query::AddParent>(&update);
+	if (!addParent)
+	{
+		throw repo::lib::RepoException("Unsupported update type");
+	}
+
+	// Build the id as bson for the lookup
+	repo::core::model::RepoBSONBuilder idBuilder;
+	idBuilder.append(REPO_LABEL_ID, addParent->uniqueId);
+	auto idObj = idBuilder.obj();
+
+	std::unique_lock lock(mutex);
+
+	auto col = getCollection(database, collection, false);
+	uint64_t seq;
+	const repo::core::model::RepoBSON* existing = col ? col->findById(idObj.view()[REPO_LABEL_ID].get_value(), &seq) : nullptr;
+	if (!existing)
+	{
+		return; // As with Mongo, an update that matches nothing is not an error
+	}
+
+	// $addToSet semantics: new parents are appended, if not already present
+
+	auto parents = existing->getUUIDFieldArray(REPO_NODE_LABEL_PARENTS);
+	for (const auto& p : addParent->parentIds)
+	{
+		if (std::find(parents.begin(), parents.end(), p) == parents.end())
+		{
+			parents.push_back(p);
+		}
+	}
+
+	repo::core::model::RepoBSONBuilder builder;
+	builder.append(REPO_NODE_LABEL_PARENTS, parents);
+	builder.appendElementsUnique(*existing);
+	col->replace(seq, builder.obj());
+}
+
+void MemoryDatabaseHandler::createIndex(const std::string& database, const std::string& collection, const database::index::RepoIndex& index)
+{
+	createIndex(database, collection, index, false);
+}
+
+void MemoryDatabaseHandler::createIndex(const std::string& database, const std::string& collection, const database::index::RepoIndex& index, bool sparse)
+{
+	try
+	{
+		if (!(database.empty() || collection.empty()))
+		{
+			auto obj = (repo::core::model::RepoBSON)index;
+
+			// Only the first field of compound indexes is used. This is sufficient
+			// to narrow down the candidates for all the indexes bouncer creates.
+
+			auto view = obj.view();
+			if (view.begin() != view.end())
+			{
+				std::unique_lock lock(mutex);
+				getCollection(database, collection, true)->createIndex(std::string(view.begin()->key()));
+			}
+		}
+	}
+	catch (...)
+	{
+		std::throw_with_nested(MemoryDatabaseHandlerException("createIndex", database, collection));
+	}
+}
+
+void MemoryDatabaseHandler::dropCollection(
+	const std::string &database,
+	const std::string &collection)
+{
+	std::unique_lock lock(mutex);
+	auto db = databases.find(database);
+	if (db != databases.end())
+	{
+		db->second.erase(collection);
+	}
+}
+
+void MemoryDatabaseHandler::dropDocument(
+	const repo::core::model::RepoBSON bson,
+	const std::string &database,
+	const std::string &collection)
+{
+	try
+	{
+		if (database.empty() || collection.empty())
+		{
+			return;
+		}
+
+		auto id = bson.view().find(REPO_LABEL_ID);
+		if (id == bson.view().end())
+		{
+			throw repo::lib::RepoException("Cannot drop a document without an _id field");
+		}
+
+		std::unique_lock lock(mutex);
+		auto col = getCollection(database, collection, false);
+		uint64_t seq;
+		if (col && col->findById(id->get_value(), &seq))
+		{
+			col->erase(seq);
+		}
+	}
+	catch (...)
+	{
+		std::throw_with_nested(MemoryDatabaseHandlerException("dropDocument", database, collection));
+	}
+}
+
+std::vector<repo::core::model::RepoBSON> MemoryDatabaseHandler::findAllByCriteria(
+	const std::string& database,
+	const std::string& collection,
+	const database::query::RepoQuery& filter,
+	const bool loadBinaries/* = false*/)
+{
+	return findAllByCriteria(database, collection, filter, database::query::RepoProjectionBuilder{}, loadBinaries);
+}
+
+std::vector<repo::core::model::RepoBSON> MemoryDatabaseHandler::findAllByCriteria(
+	const std::string& database,
+	const std::string& collection,
+	const database::query::RepoQuery& filter,
+	const database::query::RepoQuery& projection,
+	const bool loadBinaries/* = false*/)
+{
+	try
+	{
+		auto results = find(database, collection, filter, projection, 0, {}, 0);
+		if (loadBinaries)
+		{
+			fileservice::BlobFilesHandler blobHandler(fileManager, database, collection);
+			for (auto& bson : results)
+			{
+				if (bson.hasFileReference()) {
+					auto ref = bson.getBinaryReference();
+					auto buffer = blobHandler.readToBuffer(fileservice::DataRef::deserialise(ref));
+					bson.initBinaryBuffer(buffer);
+				}
+			}
+		}
+		return results;
+	}
+	catch (...)
+	{
+		std::throw_with_nested(MemoryDatabaseHandlerException("findAllByCriteria", database, collection));
+	}
+}
+
+std::unique_ptr<Cursor> MemoryDatabaseHandler::findCursorByCriteria(
+	const std::string& database,
+	const std::string& collection,
+	const database::query::RepoQuery& criteria)
+{
+	return findCursorByCriteria(database, collection, criteria, database::query::RepoProjectionBuilder{});
+}
+
+std::unique_ptr<Cursor> MemoryDatabaseHandler::findCursorByCriteria(
+	const std::string& database,
+	const std::string& collection,
+	const database::query::RepoQuery& filter,
+	const database::query::RepoQuery& projection)
+{
+	try
+	{
+		if (QueryMatcher(filter).isEmpty() || database.empty() || collection.empty())
+		{
+			return nullptr;
+		}
+		return std::make_unique<MemoryCursor>(find(database, collection, filter, projection, 0, {}, 0));
+	}
+	catch (...)
+	{
+		std::throw_with_nested(MemoryDatabaseHandlerException("findCursorByCriteria", database, collection));
+	}
+}
+
+repo::core::model::RepoBSON MemoryDatabaseHandler::findOneByCriteria(
+	const std::string& database,
+	const std::string& collection,
+	const database::query::RepoQuery& filter,
+	const std::string& sortField)
+{
+	try
+	{
+		auto results = find(database, collection, filter, database::query::RepoProjectionBuilder{}, 1, sortField, -1);
+		return results.size() ? results[0] : repo::core::model::RepoBSON();
+	}
+	catch (...)
+	{
+		std::throw_with_nested(MemoryDatabaseHandlerException("findOneByCriteria", database, collection));
+	}
+}
+
+repo::core::model::RepoBSON MemoryDatabaseHandler::findOneBySharedID(
+	const std::string& database,
+	const std::string& collection,
+	const repo::lib::RepoUUID& uuid,
+	const std::string& sortField)
+{
+	return findOneByCriteria(database, collection, database::query::Eq(std::string(REPO_NODE_LABEL_SHARED_ID), uuid), sortField);
+}
+
+repo::core::model::RepoBSON MemoryDatabaseHandler::findOneByUniqueID(
+	const std::string& database,
+	const std::string& collection,
+	const repo::lib::RepoUUID& id)
+{
+	return findOneByCriteria(database, collection, database::query::Eq(REPO_LABEL_ID, id));
+}
+
+repo::core::model::RepoBSON MemoryDatabaseHandler::findOneByUniqueID(
+	const std::string& database,
+	const std::string& collection,
+	const std::string& id)
+{
+	return findOneByCriteria(database, collection, database::query::Eq(REPO_LABEL_ID, id));
+}
+
+std::vector<repo::core::model::RepoBSON> MemoryDatabaseHandler::getAllFromCollectionTailable(
+	const std::string                             &database,
+	const std::string                             &collection,
+	const uint64_t                                &skip,
+	const uint32_t                                &limit,
+	const std::list<std::string>				  &fields,
+	const std::string							  &sortField,
+	const int									  &sortOrder)
+{
+	try
+	{
+		query::RepoProjectionBuilder projection;
+		for (const auto& f : fields)
+		{
+			projection.includeField(f);
+		}
+
+		// A filter that matches every document
+		auto all = find(database, collection, query::Or(query::Exists(REPO_LABEL_ID, true)), projection, 0, sortField, sortOrder);
+
+		std::vector<repo::core::model::RepoBSON> results;
+		for (size_t i = skip; i < all.size() && (!limit || results.size() < limit); i++)
+		{
+			results.push_back(all[i]);
+		}
+		return results;
+	}
+	catch (...)
+	{
+		std::throw_with_nested(MemoryDatabaseHandlerException("getAllFromCollectionTailable", database, collection));
+	}
+}
+
+std::list<std::string> MemoryDatabaseHandler::getCollections(
+	const std::string &database)
+{
+	std::shared_lock lock(mutex);
+	std::list<std::string> collections;
+	auto db = databases.find(database);
+	if (db != databases.end())
+	{
+		for (const auto& c : db->second)
+		{
+			collections.push_back(c.first);
+		}
+	}
+	return collections;
+}
+
+void MemoryDatabaseHandler::insertDocument(
+	const std::string &database,
+	const std::string &collection,
+	const repo::core::model::RepoBSON &obj)
+{
+	try
+	{
+		if (obj.hasOversizeFiles())
+		{
+			throw repo::lib::RepoException("insertDocument cannot be used with BSONs holding binary files. Use insertManyDocuments instead.");
+		}
+		insert(database, collection, obj);
+	}
+	catch (...)
+	{
+		std::throw_with_nested(MemoryDatabaseHandlerException("insertDocument", database, collection));
+	}
+}
+
+void MemoryDatabaseHandler::insertManyDocuments(
+	const std::string &database,
+	const std::string &collection,
+	const std::vector<repo::core::model::RepoBSON> &objs,
+	const Metadata& binaryStorageMetadata)
+{
+	try
+	{
+		fileservice::BlobFilesHandler blobHandler(fileManager, database, collection, binaryStorageMetadata);
+
+		for (auto node : objs) {
+			auto data = node.getBinariesAsBuffer();
+			if (data.second.size()) {
+				if (!fileManager) {
+					throw repo::lib::RepoException("A FileManager must be set to store documents with binary members");
+				}
+				auto ref = blobHandler.insertBinary(data.second);
+				node.replaceBinaryWithReference(ref.serialise(), data.first);
+			}
+			insert(database, collection, node);
+		}
+
+		blobHandler.finished();
+	}
+	catch (...)
+	{
+		std::throw_with_nested(MemoryDatabaseHandlerException("insertManyDocuments", database, collection));
+	}
+}
+
+void MemoryDatabaseHandler::upsertDocument(
+	const std::string &database,
+	const std::string &collection,
+	const repo::core::model::RepoBSON &obj,
+	const bool        &overwrite)
+{
+	try
+	{
+		if (obj.hasOversizeFiles())
+		{
+			throw repo::lib::RepoException("upsertDocument cannot be used with BSONs holding binary files.");
+		}
+
+		auto id = obj.view().find(REPO_LABEL_ID);
+		if (id == obj.view().end())
+		{
+			throw repo::lib::RepoException("Cannot upsert a document without an _id field");
+		}
+
+		std::unique_lock lock(mutex);
+
+		auto col = getCollection(database, collection, true);
+		uint64_t seq;
+		auto existing = col->findById(id->get_value(), &seq);
+		if (!existing)
+		{
+			col->insert(obj);
+		}
+		else if (overwrite)
+		{
+			col->replace(seq, obj);
+		}
+		else
+		{
+			// Equivalent to Mongo's $set; fields in obj replace those in the
+			// existing document in place, and new fields are appended.
+
+			auto existingView = existing->view();
+			auto objView = obj.view();
+
+			document merged;
+			for (const auto& e : existingView)
+			{
+				auto replacement = objView.find(e.key());
+				merged.append(kvp(e.key(), replacement != objView.end() ? replacement->get_value() : e.get_value()));
+			}
+			for (const auto& e : objView)
+			{
+				if (existingView.find(e.key()) == existingView.end())
+				{
+					merged.append(kvp(e.key(), e.get_value()));
+				}
+			}
+			col->replace(seq, repo::core::model::RepoBSON(merged.view()));
+		}
+	}
+	catch (...)
+	{
+		std::throw_with_nested(MemoryDatabaseHandlerException("upsertDocument", database, collection));
+	}
+}
+
+std::vector<database::WriteError> MemoryDatabaseHandler::upsertManyDocuments(
+	const std::string &database,
+	const std::string &collection,
+	const std::vector<repo::core::model::RepoBSON> &obj,
+	const bool        &overwrite)
+{
+	// There is no round trip to save, so each document is upserted in turn,
+	// reporting failures in the same way as an unordered bulk write would.
+
+	std::vector<database::WriteError> errors;
+	for (size_t i = 0; i < obj.size(); i++)
+	{
+		try
+		{
+			upsertDocument(database, collection, obj[i], overwrite);
+		}
+		catch (const repo::lib::RepoException& e)
+		{
+			errors.push_back({ i, e.printFull() });
+		}
+	}
+	return errors;
+}
+
+size_t MemoryDatabaseHandler::count(
+	const std::string& database,
+	const std::string& collection,
+	const database::query::RepoQuery& criteria)
+{
+	return find(database, collection, criteria, database::query::RepoProjectionBuilder{}, 0, {}, 0).size();
+}
+
+size_t MemoryDatabaseHandler::getNumWrites(
+	const std::string& database,
+	const std::string& collection,
+	const repo::lib::RepoUUID& id)
+{
+	repo::core::model::RepoBSONBuilder idBuilder;
+	idBuilder.append(REPO_LABEL_ID, id);
+	auto idObj = idBuilder.obj();
+
+	std::shared_lock lock(mutex);
+	auto col = getCollection(database, collection, false);
+	if (!col)
+	{
+		return 0;
+	}
+	auto it = col->writes.find(makeValueKey(idObj.view()[REPO_LABEL_ID].get_value()));
+	return it != col->writes.end() ? it->second : 0;
+}
+
+std::vector<std::string> MemoryDatabaseHandler::getIndexes(
+	const std::string& database,
+	const std::string& collection)
+{
+	std::shared_lock lock(mutex);
+	std::vector<std::string> fields;
+	auto col = getCollection(database, collection, false);
+	if (col)
+	{
+		for (const auto& index : col->indexes)
+		{
+			fields.push_back(index.first);
+		}
+	}
+	return fields;
+}
+
+std::unique_ptr<database::BulkWriteContext> MemoryDatabaseHandler::getBulkWriteContext(
+	const std::string& database,
+	const std::string& collection)
+{
+	return std::make_unique<MemoryWriteContext>(this, database, collection);
+}
+
+/*
+* The persistence format is a header, followed by each database, collection,
+* the first fields of its indexes, and its documents as raw bson. Strings are
+* prefixed with their length.
+*/
+
+static void writeString(std::ofstream& stream, const std::string& s)
+{
+	uint32_t size = s.size();
+	stream.write((const char*)&size, sizeof(size));
+	stream.write(s.data(), size);
+}
+
+static std::string readString(std::ifstream& stream)
+{
+	uint32_t size = 0;
+	stream.read((char*)&size, sizeof(size));
+	std::string s(size, '\0');
+	stream.read(s.data(), size);
+	return s;
+}
+
+template<typename T>
+static void writeValue(std::ofstream& stream, const T& v)
+{
+	stream.write((const char*)&v, sizeof(v));
+}
+
+template<typename T>
+static T readValue(std::ifstream& stream)
+{
+	T v = {};
+	stream.read((char*)&v, sizeof(v));
+	return v;
+}
+
+void MemoryDatabaseHandler::save()
+{
+	if (path.empty())
+	{
+		return;
+	}
+
+	std::shared_lock lock(mutex);
+
+	std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+	if (!stream)
+	{
+		throw MemoryDatabaseHandlerException("Cannot open " + path + " for writing");
+	}
+
+	writeString(stream, MEMORY_DB_MAGIC);
+	writeValue(stream, MEMORY_DB_VERSION);
+
+	writeValue(stream, (uint32_t)databases.size());
+	for (const auto& db : databases)
+	{
+		writeString(stream, db.first);
+		writeValue(stream, (uint32_t)db.second.size());
+		for (const auto& col : db.second)
+		{
+			writeString(stream, col.first);
+			writeValue(stream, (uint32_t)col.second->indexes.size());
+			for (const auto& index : col.second->indexes)
+			{
+				writeString(stream, index.first);
+			}
+			writeValue(stream, (uint64_t)col.second->documents.size());
+			for (const auto& doc : col.second->documents)
+			{
+				auto view = doc.second.view();
+				stream.write((const char*)view.data(), view.length());
+			}
+		}
+	}
+
+	if (!stream)
+	{
+		throw MemoryDatabaseHandlerException("Failed writing to " + path);
+	}
+}
+
+void MemoryDatabaseHandler::load()
+{
+	std::ifstream stream(path, std::ios::binary);
+	if (!stream)
+	{
+		return; // This is a new database
+	}
+
+	try
+	{
+		if (readString(stream) != MEMORY_DB_MAGIC || readValue<uint32_t>(stream) != MEMORY_DB_VERSION)
+		{
+			throw repo::lib::RepoException("Unrecognised file format");
+		}
+
+		std::unique_lock lock(mutex);
+
+		auto numDatabases = readValue<uint32_t>(stream);
+		for (uint32_t i = 0; i < numDatabases; i++)
+		{
+			auto database = readString(stream);
+			auto numCollections = readValue<uint32_t>(stream);
+			for (uint32_t j = 0; j < numCollections; j++)
+			{
+				auto col = getCollection(database, readString(stream), true);
+
+				auto numIndexes = readValue<uint32_t>(stream);
+				for (uint32_t k = 0; k < numIndexes; k++)
+				{
+					col->createIndex(readString(stream));
+				}
+
+				auto numDocuments = readValue<uint64_t>(stream);
+				std::vector<uint8_t> buffer;
+				for (uint64_t k = 0; k < numDocuments; k++)
+				{
+					// Bson documents begin with their total length as an int32
+
+					auto length = readValue<int32_t>(stream);
+					if (length < 5 || !stream)
+					{
+						throw repo::lib::RepoException("Corrupt document");
+					}
+					buffer.resize(length);
+					memcpy(buffer.data(), &length, sizeof(length));
+					stream.read((char*)buffer.data() + sizeof(length), length - sizeof(length));
+					col->insert(repo::core::model::RepoBSON(bsoncxx::document::view(buffer.data(), buffer.size())));
+				}
+				col->writes.clear(); // Loading does not count as writing
+			}
+		}
+
+		if (!stream)
+		{
+			throw repo::lib::RepoException("Unexpected end of file");
+		}
+	}
+	catch (...)
+	{
+		std::throw_with_nested(MemoryDatabaseHandlerException("Failed to load in-process database from " + path));
+	}
+}
@@ -0,0 +1,274 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+*  In-process database handler
+*/
+
+#pragma once
+
+#include <map>
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "repo_database_handler_abstract.h"
+
+namespace repo {
+	namespace core {
+		namespace model {
+			class RepoBSON;
+		}
+		namespace handler {
+			namespace fileservice {
+				class FileManager;
+			}
+
+			/*
+			* An implementation of AbstractDatabaseHandler that keeps all collections in
+			* the memory of the current process. It supports the same query, update and
+			* bulk write operations as MongoDatabaseHandler, so pipelines can be run
+			* without a database server, e.g. for offline processing or to measure the
+			* cost of bouncer separately from the cost of the database.
+			*
+			* Binary members are stored through the FileManager in the same way as
+			* MongoDatabaseHandler, so one must be set before inserting nodes that have
+			* them.
+			*
+			* If a path is given, the collections are read from that file on
+			* construction and written back to it by save() and on destruction.
+			*/
+			class REPO_API_EXPORT MemoryDatabaseHandler : public AbstractDatabaseHandler {
+			public:
+
+				/**
+				* @param path file to load the database from and persist it to (optional)
+				*/
+				MemoryDatabaseHandler(const std::string& path = std::string());
+
+				~MemoryDatabaseHandler();
+
+				/**
+				* Returns an instance of MemoryDatabaseHandler. Without a path, this is
+				* always a new, empty instance. With a path, the same instance is returned
+				* for as long as any caller holds it.
+				* @param path file to load the database from and persist it to (optional)
+				*/
+				static std::shared_ptr<MemoryDatabaseHandler> getHandler(const std::string& path = std::string());
+
+				/*
+				*	------------- Database info lookup --------------
+				*/
+
+				std::vector<repo::core::model::RepoBSON>
+					getAllFromCollectionTailable(
+						const std::string                             &database,
+						const std::string                             &collection,
+						const uint64_t                                &skip = 0,
+						const uint32_t								  &limit = 0,
+						const std::list<std::string>				  &fields = std::list<std::string>(),
+						const std::string							  &sortField = std::string(),
+						const int									  &sortOrder = -1);
+
+				std::list<std::string> getCollections(const std::string &database);
+
+				/*
+				*	------------- Database operations (insert/delete/update) --------------
+				*/
+
+				/**
+				* Creates an index on the first field of the given index. Queries that
+				* test equality on an indexed field only visit the matching documents.
+				*/
+				void createIndex(const std::string &database, const std::string &collection, const database::index::RepoIndex& index);
+
+				void createIndex(const std::string& database, const std::string& collection, const database::index::RepoIndex& index, bool sparse);
+
+				void dropCollection(
+					const std::string &database,
+					const std::string &collection);
+
+				void dropDocument(
+					const repo::core::model::RepoBSON bson,
+					const std::string &database,
+					const std::string &collection);
+
+				void insertDocument(
+					const std::string &database,
+					const std::string &collection,
+					const repo::core::model::RepoBSON &obj);
+
+				void insertManyDocuments(
+					const std::string &database,
+					const std::string &collection,
+					const std::vector<repo::core::model::RepoBSON> &obj,
+					const Metadata& metadata = {});
+
+				void upsertDocument(
+					const std::string &database,
+					const std::string &collection,
+					const repo::core::model::RepoBSON &obj,
+					const bool        &overwrite);
+
+				std::vector<database::WriteError> upsertManyDocuments(
+					const std::string &database,
+					const std::string &collection,
+					const std::vector<repo::core::model::RepoBSON> &obj,
+					const bool        &overwrite);
+
+				/*
+				*	------------- Query operations --------------
+				*/
+
+				std::vector<repo::core::model::RepoBSON> findAllByCriteria(
+					const std::string& database,
+					const std::string& collection,
+					const database::query::RepoQuery& criteria,
+					const bool loadBinaries = false);
+
+				std::vector<repo::core::model::RepoBSON> findAllByCriteria(
+					const std::string& database,
+					const std::string& collection,
+					const database::query::RepoQuery& filter,
+					const database::query::RepoQuery& projection,
+					const bool loadBinaries = false);
+
+				/**
+				* The cursor holds a snapshot of the matching documents, taken when this
+				* method is called.
+				*/
+				std::unique_ptr<database::Cursor> findCursorByCriteria(
+					const std::string& database,
+					const std::string& collection,
+					const database::query::RepoQuery& criteria);
+
+				std::unique_ptr<database::Cursor> findCursorByCriteria(
+					const std::string& database,
+					const std::string& collection,
+					const database::query::RepoQuery& filter,
+					const database::query::RepoQuery& projection);
+
+				repo::core::model::RepoBSON findOneByCriteria(
+					const std::string& database,
+					const std::string& collection,
+					const database::query::RepoQuery& criteria,
+					const std::string& sortField = ""
+				);
+
+				repo::core::model::RepoBSON findOneBySharedID(
+					const std::string& database,
+					const std::string& collection,
+					const repo::lib::RepoUUID& uuid,
+					const std::string& sortField);
+
+				repo::core::model::RepoBSON findOneByUniqueID(
+					const std::string& database,
+					const std::string& collection,
+					const repo::lib::RepoUUID& uuid);
+
+				repo::core::model::RepoBSON findOneByUniqueID(
+					const std::string& database,
+					const std::string& collection,
+					const std::string& id);
+
+				size_t count(
+					const std::string& database,
+					const std::string& collection,
+					const database::query::RepoQuery& criteria);
+
+				std::unique_ptr<database::BulkWriteContext> getBulkWriteContext(
+					const std::string& database,
+					const std::string& collection);
+
+				void setFileManager(std::shared_ptr<repo::core::handler::fileservice::FileManager> manager);
+
+				/**
+				* Returns how many times the document with the given _id has been written
+				* (inserted, replaced or updated) since its collection was created or
+				* loaded. This is used to measure how many round trips a pipeline would
+				* make to a real database for each document.
+				*/
+				size_t getNumWrites(
+					const std::string& database,
+					const std::string& collection,
+					const repo::lib::RepoUUID& id);
+
+				/**
+				* Returns the fields indexed in the collection (the first field of each
+				* index given to createIndex), in alphabetical order. The _id index is
+				* not included.
+				*/
+				std::vector<std::string> getIndexes(
+					const std::string& database,
+					const std::string& collection);
+
+				std::shared_ptr<repo::core::handler::fileservice::FileManager> getFileManager();
+
+				/**
+				* Writes all collections to the file given on construction. Does nothing
+				* if no file was given.
+				*/
+				void save();
+
+			private:
+
+				class Collection;
+				class QueryMatcher;
+				class MemoryCursor;
+				class MemoryWriteContext;
+				class MemoryDatabaseHandlerException;
+
+				// Collections by database, then collection name. Collection objects are
+				// never moved once created, so pointers to them remain valid until they
+				// are dropped.
+				std::map<std::string, std::map<std::string, std::unique_ptr<Collection>>> databases;
+
+				// Guards the databases map and the contents of all collections. Reads
+				// take a shared lock, so queries from different threads can proceed
+				// concurrently.
+				std::shared_mutex mutex;
+
+				std::string path;
+
+				Collection* getCollection(const std::string& database, const std::string& collection, bool create);
+
+				std::vector<repo::core::model::RepoBSON> find(
+					const std::string& database,
+					const std::string& collection,
+					const database::query::RepoQuery& filter,
+					const database::query::RepoQuery& projection,
+					size_t limit,
+					const std::string& sortField,
+					int sortOrder);
+
+				void insert(
+					const std::string& database,
+					const std::string& collection,
+					const repo::core::model::RepoBSON& obj);
+
+				void update(
+					const std::string& database,
+					const std::string& collection,
+					const database::query::RepoUpdate& update);
+
+				void load();
+			};
+		} /* namespace handler */
+	}
+}
@@ -19,6 +19,7 @@
 *  Mongo database handler
 */
 
+#include <algorithm>
 #include <regex>
 #include <unordered_map>
 
@@ -729,6 +730,33 @@ void MongoDatabaseHandler::insertManyDocuments(
 	}
 }
 
+// Makes the update document for an upsert that doesn't overwrite, which
+// consists of a command to set all mutable fields, and set the immutable _id
+// field only when performing an insert.
+
+static bsoncxx::document::value makeUpsertUpdate(const bsoncxx::document::view& obj, const std::string& id)
+{
+	bsoncxx::builder::basic::document set;
+	bsoncxx::builder::basic::document setOnInsert;
+
+	for (const auto& e : obj)
+	{
+		if (e.key() == id)
+		{
+			setOnInsert.append(kvp(e.key(), e.get_value()));
+		}
+		else
+		{
+			set.append(kvp(e.key(), e.get_value()));
+		}
+	}
+
+	return make_document(
+		kvp("$set", set.view()),
+		kvp("$setOnInsert", setOnInsert.view())
+	);
+}
+
 void MongoDatabaseHandler::upsertDocument(
 	const std::string &database,
 	const std::string &collection,
@@ -747,11 +775,10 @@ void MongoDatabaseHandler::upsertDocument(
 		auto col = db.collection(collection);
 
 		bsoncxx::builder::basic::document query;
+		query.append(kvp(ID, obj.find(ID)->get_value()));
 
 		if (overwrite)
 		{
-			query.append(kvp(ID, obj.find(ID)->get_value()));
-
 			mongocxx::options::replace options{};
 			options.upsert(true);
 
@@ -763,37 +790,12 @@ void MongoDatabaseHandler::upsertDocument(
 		}
 		else
 		{
-			// The following snippet makes the update document, which consists of
-			// a command to set all mutable fields, and set the immutable _id field
-			// only when performing an insert.
-
-			bsoncxx::builder::basic::document set;
-			bsoncxx::builder::basic::document setOnInsert;
-
-			for (const auto& e : obj)
-			{
-				if (e.key() == ID)
-				{
-					query.append(kvp(e.key(), e.get_value()));
-					setOnInsert.append(kvp(e.key(), e.get_value()));
-				}
-				else
-				{
-					set.append(kvp(e.key(), e.get_value()));
-				}
-			}
-
-			auto update = make_document(
-				kvp("$set", set.view()),
-				kvp("$setOnInsert", setOnInsert.view())
-			);
-
 			mongocxx::options::update options{};
 			options.upsert(true);
 
 			col.update_one(
 				query.view(),
-				update.view(),
+				makeUpsertUpdate(obj.view(), ID).view(),
 				options
 			);
 		}
@@ -804,6 +806,102 @@ void MongoDatabaseHandler::upsertDocument(
 	}
 }
 
+std::vector<database::WriteError> MongoDatabaseHandler::upsertManyDocuments(
+	const std::string &database,
+	const std::string &collection,
+	const std::vector<repo::core::model::RepoBSON> &objs,
+	const bool        &overwrite)
+{
+	std::vector<database::WriteError> errors;
+	try
+	{
+		auto client = clientPool->acquire();
+		auto db = client->database(database);
+		auto col = db.collection(collection);
+
+		// Documents that cannot be upserted are reported without being sent, so
+		// the index of each operation in the bulk write is kept to map the errors
+		// the server returns back to the documents.
+
+		mongocxx::options::bulk_write options;
+		options.ordered(false);
+		auto bulk = col.create_bulk_write(options);
+		std::vector<size_t> operations;
+
+		for (size_t i = 0; i < objs.size(); i++)
+		{
+			const auto& obj = objs[i];
+			if (obj.hasOversizeFiles())
+			{
+				errors.push_back({ i, "upsertManyDocuments cannot be used with BSONs holding binary files." });
+				continue;
+			}
+
+			auto id = obj.find(ID);
+			if (id == obj.end())
+			{
+				errors.push_back({ i, "Cannot upsert a document without an _id field" });
+				continue;
+			}
+
+			auto query = make_document(kvp(ID, id->get_value()));
+			if (overwrite)
+			{
+				mongocxx::model::replace_one op{ query.view(), obj.view() };
+				op.upsert(true);
+				bulk.append(op);
+			}
+			else
+			{
+				auto update = makeUpsertUpdate(obj.view(), ID);
+				mongocxx::model::update_one op{ query.view(), update.view() };
+				op.upsert(true);
+				bulk.append(op);
+			}
+			operations.push_back(i);
+		}
+
+		if (operations.size())
+		{
+			try
+			{
+				bulk.execute();
+			}
+			catch (const mongocxx::bulk_write_exception& e)
+			{
+				// As the write is unordered the server will have attempted every
+				// operation, and the reply lists each one that failed.
+
+				if (!e.raw_server_error())
+				{
+					throw;
+				}
+				auto writeErrors = e.raw_server_error()->view()["writeErrors"];
+				if (!writeErrors || writeErrors.type() != bsoncxx::type::k_array)
+				{
+					throw;
+				}
+				for (const auto& error : writeErrors.get_array().value)
+				{
+					errors.push_back({
+						operations[error["index"].get_int32().value],
+						std::string(error["errmsg"].get_string().value)
+					});
+				}
+			}
+		}
+	}
+	catch (...)
+	{
+		std::throw_with_nested(MongoDatabaseHandlerException(*this, "upsertManyDocuments", database, collection));
+	}
+
+	std::sort(errors.begin(), errors.end(), [](const database::WriteError& a, const database::WriteError& b) {
+		return a.index < b.index;
+	});
+	return errors;
+}
+
 size_t MongoDatabaseHandler::count(
 	const std::string& database,
 	const std::string& collection,
@@ -1011,6 +1109,11 @@ public:
 		blobHandler.finished();
 	}
 
+	void setDeduplicateBinaries(bool deduplicate) override
+	{
+		blobHandler.setDeduplicate(deduplicate);
+	}
+
 private:
 
 	void checkBulkWrite()
@@ -241,6 +241,21 @@ namespace repo {
 					const repo::core::model::RepoBSON &obj,
 					const bool        &overwrite);
 
+				/**
+				* Update/insert multiple documents in database.collection, as one
+				* unordered bulk write
+				* @param database name
+				* @param collection name
+				* @param documents to upsert
+				* @param if it is an update, overwrites the document instead of updating the fields it has
+				* @return returns the documents that failed, if any
+				*/
+				std::vector<database::WriteError> upsertManyDocuments(
+					const std::string &database,
+					const std::string &collection,
+					const std::vector<repo::core::model::RepoBSON> &obj,
+					const bool        &overwrite);
+
 				/*
 				*	------------- Query operations --------------
 				*/
@@ -37,6 +37,8 @@ RepoBSON::RepoBSON(const RepoBSON &obj,
 			bigFiles[pair.first] = pair.second;
 		}
 	}
+
+	updateBinariesAllocation();
 }
 
 RepoBSON::RepoBSON(
@@ -45,6 +47,7 @@ RepoBSON::RepoBSON(
 	: bsoncxx::document::value(obj),
 	bigFiles(binMapping)
 {
+	updateBinariesAllocation();
 }
 
 RepoBSON::RepoBSON()
@@ -184,6 +187,7 @@ RepoBSON& RepoBSON::operator=(RepoBSON otherCopy)
 {
 	bsoncxx::document::value::reset(otherCopy.view());
 	bigFiles = otherCopy.bigFiles;
+	binariesAllocation = otherCopy.binariesAllocation;
 	return *this;
 }
 
@@ -239,6 +243,7 @@ void RepoBSON::replaceBinaryWithReference(
 	*this = builder.obj();
 
 	this->bigFiles.clear();
+	updateBinariesAllocation();
 }
 
 repo::lib::RepoUUID RepoBSON::getUUIDField(const std::string &label) const
@@ -341,7 +346,17 @@ void RepoBSON::initBinaryBuffer(const std::vector<uint8_t> &buffer)
 
 			bigFiles[elem] = std::vector<uint8_t>(buffer.begin() + start, buffer.begin() + start + size);
 		}
+		updateBinariesAllocation();
+	}
+}
+
+void RepoBSON::updateBinariesAllocation()
+{
+	size_t size = 0;
+	for (const auto& entry : bigFiles) {
+		size += entry.second.size();
 	}
+	binariesAllocation.resize(size);
 }
 
 bool RepoBSON::hasBinField(const std::string &label) const
@@ -36,6 +36,7 @@
 #include "repo/lib/datastructure/repo_matrix.h"
 #include "repo/lib/datastructure/repo_bounds.h"
 #include "repo/lib/repo_exception.h"
+#include "repo/lib/repo_memory_accounting.h"
 #include "repo/core/model/bson/repo_bson_element.h"
 #include "repo/lib/datastructure/repo_structs.h"
 
@@ -47,6 +48,7 @@ namespace repo {
 	namespace core {
 		namespace handler {
 			class MongoDatabaseHandler;
+			class MemoryDatabaseHandler;
 		}
 
 		namespace model {
@@ -54,6 +56,7 @@ namespace repo {
 			{
 				friend class RepoBSONBuilder;
 				friend class repo::core::handler::MongoDatabaseHandler;
+				friend class repo::core::handler::MemoryDatabaseHandler;
 
 			public:
 
@@ -253,7 +256,14 @@ namespace repo {
 				*/
 				void swap(RepoBSON otherCopy);
 
+				/*
+				* Updates the size of bigFiles counted by RepoMemoryAccounting. Must be
+				* called whenever bigFiles is modified.
+				*/
+				void updateBinariesAllocation();
+
 				BinMapping bigFiles;
+				repo::lib::RepoMemoryAccounting::Allocation binariesAllocation{ repo::lib::RepoMemoryAccounting::Tag::BINARY };
 			}; // end
 		}// end namespace model
 	} // end namespace core
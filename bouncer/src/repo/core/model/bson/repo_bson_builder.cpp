@@ -49,6 +49,12 @@ void repo::core::model::RepoBSONBuilder::appendRepoVariant(const std::string& la
 	append(item);
 }
 
+void repo::core::model::RepoBSONBuilder::appendRepoVariant(const std::string& label, const repo::lib::RepoCompactVariant& item)
+{
+	key_owned(label);
+	append(item);
+}
+
 RepoBSON RepoBSONBuilder::obj()
 {
 	return RepoBSON(core::extract_document(), binMapping);
@@ -146,6 +152,42 @@ void repo::core::model::RepoBSONBuilder::append(const repo::lib::RepoVariant& v)
 	boost::apply_visitor(AppendVisitor(*this), v);
 }
 
+void repo::core::model::RepoBSONBuilder::append(const repo::lib::RepoCompactVariant& v)
+{
+	// Written directly from the alternatives, so no temporaries are created for
+	// dates or UUIDs. The results are the same as the equivalent RepoVariant.
+
+	if (auto b = v.get<bool>()) {
+		append(*b);
+	}
+	else if (auto i = v.get<int>()) {
+		append(*i);
+	}
+	else if (auto ll = v.get<int64_t>()) {
+		append(*ll);
+	}
+	else if (auto d = v.get<double>()) {
+		append(*d);
+	}
+	else if (auto s = v.get<std::string>()) {
+		append(*s);
+	}
+	else if (auto t = v.get<repo::lib::RepoTimestamp>()) {
+		append(bsoncxx::types::b_date(std::chrono::milliseconds(t->milliseconds)));
+	}
+	else if (auto u = v.get<repo::lib::RepoUUID>()) {
+		const auto& id = u->getInternalID();
+		append(bsoncxx::types::b_binary{
+			bsoncxx::binary_sub_type::k_uuid_deprecated,
+			(uint32_t)id.size(),
+			id.data
+		});
+	}
+	else {
+		append(bsoncxx::types::b_null{});
+	}
+}
+
 void RepoBSONBuilder::appendVector3DObject(
 	const std::string& label,
 	const repo::lib::RepoVector3D& vec
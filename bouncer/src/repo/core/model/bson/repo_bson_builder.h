@@ -28,6 +28,7 @@
 #include "repo/lib/datastructure/repo_uuid.h"
 #include "repo/lib/datastructure/repo_bounds.h"
 #include "repo/lib/datastructure/repo_variant.h"
+#include "repo/lib/datastructure/repo_compact_variant.h"
 #include "repo/lib/datastructure/repo_structs.h"
 #include <boost/variant/static_visitor.hpp>
 #include <string>
@@ -119,6 +120,10 @@ namespace repo {
 					const std::string& label,
 					const repo::lib::RepoVariant& item);
 
+				void appendRepoVariant(
+					const std::string& label,
+					const repo::lib::RepoCompactVariant& item);
+
 				void appendElements(RepoBSON bson);
 
 				void appendElementsUnique(RepoBSON bson);
@@ -185,6 +190,8 @@ namespace repo {
 
 				void append(const repo::lib::RepoVariant& variant);
 
+				void append(const repo::lib::RepoCompactVariant& variant);
+
 				void append(const RepoBSON& obj);
 
 				/**
@@ -130,6 +130,29 @@ repo::lib::RepoVariant RepoBSONElement::repoVariant() const
 	return v;
 }
 
+repo::lib::RepoCompactVariant RepoBSONElement::repoCompactVariant() const
+{
+	switch (type())
+	{
+	case ElementType::BOOL:
+		return Bool();
+	case ElementType::DATE:
+		return repo::lib::RepoTimestamp{ element::get_date().value.count() };
+	case ElementType::INT:
+		return Int();
+	case ElementType::LONG:
+		return Long();
+	case ElementType::DOUBLE:
+		return Double();
+	case ElementType::STRING:
+		return String();
+	case ElementType::UUID:
+		return UUID();
+	default:
+		return repo::lib::RepoCompactVariant();
+	}
+}
+
 std::string RepoBSONElement::String() const
 {
 	const auto& b = element::get_string();
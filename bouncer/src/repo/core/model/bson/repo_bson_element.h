@@ -25,6 +25,7 @@
 #include "repo_log.h"
 #include "repo/repo_bouncer_global.h"
 #include "repo/lib/datastructure/repo_variant.h"
+#include "repo/lib/datastructure/repo_compact_variant.h"
 
 #include <bsoncxx/document/element.hpp>
 
@@ -82,6 +83,13 @@ namespace repo {
 
 				repo::lib::RepoVariant repoVariant() const;
 
+				/**
+				* As repoVariant(), but dates keep their millisecond precision, UUIDs
+				* are supported, and types that cannot be held result in an empty
+				* variant instead of an exception.
+				*/
+				repo::lib::RepoCompactVariant repoCompactVariant() const;
+
 				bool operator==(const RepoBSONElement& other) const;
 
 				bool operator!=(const RepoBSONElement& other) const;
@@ -51,6 +51,11 @@ void RepoSequence::setRevision(const repo::lib::RepoUUID& rid)
 	this->revisionId = rid;
 }
 
+void RepoSequence::setCacheIndex(const std::string& index)
+{
+	this->cacheIndex = index;
+}
+
 RepoSequence::operator RepoBSON() const
 {
 	RepoBSONBuilder builder;
@@ -63,6 +68,10 @@ RepoSequence::operator RepoBSON() const
 	{
 		builder.append(REPO_SEQUENCE_LABEL_REV_ID, revisionId);
 	}
+	if (!cacheIndex.empty())
+	{
+		builder.append(REPO_SEQUENCE_LABEL_CACHE, cacheIndex);
+	}
 
 	std::vector<RepoBSON> frames;
 
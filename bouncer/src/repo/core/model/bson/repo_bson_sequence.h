@@ -39,6 +39,7 @@ namespace repo {
 #define REPO_SEQUENCE_LABEL_START_DATE "startDate"
 #define REPO_SEQUENCE_LABEL_END_DATE "endDate"
 #define REPO_SEQUENCE_LABEL_STATE "state"
+#define REPO_SEQUENCE_LABEL_CACHE "cache"
 
 			class RepoBSON;
 
@@ -77,6 +78,13 @@ namespace repo {
 
 				void setRevision(const repo::lib::RepoUUID& rid);
 
+				/**
+				* Sets the name of the index file of a binary frame state cache (see
+				* SequenceCacheWriter). If set, the state of each frame is the name of
+				* the cache file holding its record, rather than a JSON document.
+				*/
+				void setCacheIndex(const std::string& index);
+
 				~RepoSequence() {}
 
 				operator RepoBSON() const;
@@ -96,6 +104,7 @@ namespace repo {
 				std::string name;
 				int64_t firstFrame;
 				int64_t lastFrame;
+				std::string cacheIndex;
 			};
 		}// end namespace model
 	} // end namespace core
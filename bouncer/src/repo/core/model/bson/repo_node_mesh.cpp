@@ -22,6 +22,10 @@
 #include <repo_log.h>
 #include "repo_node_mesh.h"
 #include "repo_bson_builder.h"
+#include "repo/lib/repo_sha256.h"
+#include "repo/lib/repo_exception.h"
+
+using repo::lib::RepoMeshCodec;
 
 using namespace repo::core::model;
 
@@ -44,6 +48,22 @@ MeshNode::~MeshNode()
 
 void MeshNode::deserialise(RepoBSON& bson)
 {
+	// Meshes written with RepoMeshCodec hold encoded streams in their own
+	// fields, in place of the raw arrays
+
+	bool encoded = bson.hasField(REPO_NODE_MESH_LABEL_GEOMETRY_CODEC);
+	if (encoded) {
+		auto version = bson.getIntField(REPO_NODE_MESH_LABEL_GEOMETRY_CODEC);
+		if (version > RepoMeshCodec::VERSION) {
+			throw repo::lib::RepoException("Mesh node " + getUniqueID().toString() + " has geometry encoded with an unsupported codec version (" + std::to_string(version) + ")");
+		}
+	}
+
+	auto facesLabel = encoded ? REPO_NODE_MESH_LABEL_ENCODED_FACES : REPO_NODE_MESH_LABEL_FACES;
+	auto verticesLabel = encoded ? REPO_NODE_MESH_LABEL_ENCODED_VERTICES : REPO_NODE_MESH_LABEL_VERTICES;
+	auto normalsLabel = encoded ? REPO_NODE_MESH_LABEL_ENCODED_NORMALS : REPO_NODE_MESH_LABEL_NORMALS;
+	auto uvChannelsLabel = encoded ? REPO_NODE_MESH_LABEL_ENCODED_UV_CHANNELS : REPO_NODE_MESH_LABEL_UV_CHANNELS;
+
 	grouping = "";
 	if (bson.hasField(REPO_NODE_MESH_LABEL_GROUPING))
 		grouping = bson.getStringField(REPO_NODE_MESH_LABEL_GROUPING);
@@ -58,13 +78,18 @@ void MeshNode::deserialise(RepoBSON& bson)
 
 	boundingBox = bson.getBoundsField(REPO_NODE_MESH_LABEL_BOUNDING_BOX);
 
-	if (bson.hasBinField(REPO_NODE_MESH_LABEL_FACES) && bson.hasField(REPO_NODE_MESH_LABEL_FACES_COUNT))
+	if (bson.hasBinField(facesLabel) && bson.hasField(REPO_NODE_MESH_LABEL_FACES_COUNT))
 	{
 		std::vector <uint32_t> serializedFaces = std::vector<uint32_t>();
 		int32_t facesCount = bson.getIntField(REPO_NODE_MESH_LABEL_FACES_COUNT);
 		faces.reserve(facesCount);
 
-		bson.getBinaryFieldAsVector(REPO_NODE_MESH_LABEL_FACES, serializedFaces);
+		if (encoded) {
+			serializedFaces = RepoMeshCodec::decodeFaces(bson.getBinary(facesLabel));
+		}
+		else {
+			bson.getBinaryFieldAsVector(REPO_NODE_MESH_LABEL_FACES, serializedFaces);
+		}
 
 		// Retrieve numbers of vertices for each face and subsequent
 		// indices into the vertex array.
@@ -91,25 +116,40 @@ void MeshNode::deserialise(RepoBSON& bson)
 		}
 	}
 
-	if (bson.hasBinField(REPO_NODE_MESH_LABEL_VERTICES))
+	if (bson.hasBinField(verticesLabel))
 	{
-		bson.getBinaryFieldAsVector(REPO_NODE_MESH_LABEL_VERTICES, vertices);
+		if (encoded) {
+			vertices = RepoMeshCodec::decodePositions(bson.getBinary(verticesLabel));
+		}
+		else {
+			bson.getBinaryFieldAsVector(REPO_NODE_MESH_LABEL_VERTICES, vertices);
+		}
 	}
 	else
 	{
 		repoWarning << "Could not find any vertices within mesh node (" << getUniqueID() << ")";
 	}
 
-	if (bson.hasBinField(REPO_NODE_MESH_LABEL_NORMALS))
+	if (bson.hasBinField(normalsLabel))
 	{
-		bson.getBinaryFieldAsVector(REPO_NODE_MESH_LABEL_NORMALS, normals);
+		if (encoded) {
+			normals = RepoMeshCodec::decodeNormals(bson.getBinary(normalsLabel));
+		}
+		else {
+			bson.getBinaryFieldAsVector(REPO_NODE_MESH_LABEL_NORMALS, normals);
+		}
 	}
 
 
-	if (bson.hasField(REPO_NODE_MESH_LABEL_UV_CHANNELS_COUNT) && bson.hasBinField(REPO_NODE_MESH_LABEL_UV_CHANNELS))
+	if (bson.hasField(REPO_NODE_MESH_LABEL_UV_CHANNELS_COUNT) && bson.hasBinField(uvChannelsLabel))
 	{
 		std::vector<repo::lib::RepoVector2D> serialisedChannels;
-		bson.getBinaryFieldAsVector(REPO_NODE_MESH_LABEL_UV_CHANNELS, serialisedChannels);
+		if (encoded) {
+			serialisedChannels = RepoMeshCodec::decodeUVs(bson.getBinary(uvChannelsLabel));
+		}
+		else {
+			bson.getBinaryFieldAsVector(REPO_NODE_MESH_LABEL_UV_CHANNELS, serialisedChannels);
+		}
 
 		if (serialisedChannels.size())
 		{
@@ -128,6 +168,7 @@ void MeshNode::deserialise(RepoBSON& bson)
 			}
 		}
 	}
+	geometryChanged();
 }
 
 void appendBounds(RepoBSONBuilder& builder, const repo::lib::RepoBounds& boundingBox)
@@ -135,16 +176,21 @@ void appendBounds(RepoBSONBuilder& builder, const repo::lib::RepoBounds& boundin
 	builder.append(REPO_NODE_MESH_LABEL_BOUNDING_BOX, boundingBox);
 }
 
-void appendVertices(RepoBSONBuilder& builder, const std::vector<repo::lib::RepoVector3D>& vertices)
+void appendVertices(RepoBSONBuilder& builder, const std::vector<repo::lib::RepoVector3D>& vertices, const std::optional<RepoMeshCodec::Options>& codec)
 {
 	if (vertices.size() > 0)
 	{
 		builder.append(REPO_NODE_MESH_LABEL_VERTICES_COUNT, (int32_t)(vertices.size()));
-		builder.appendLargeArray(REPO_NODE_MESH_LABEL_VERTICES, vertices);
+		if (codec) {
+			builder.appendLargeArray(REPO_NODE_MESH_LABEL_ENCODED_VERTICES, RepoMeshCodec::encodePositions(vertices, *codec));
+		}
+		else {
+			builder.appendLargeArray(REPO_NODE_MESH_LABEL_VERTICES, vertices);
+		}
 	}
 }
 
-void appendFaces(RepoBSONBuilder& builder, const std::vector<repo::lib::repo_face_t>& faces)
+void appendFaces(RepoBSONBuilder& builder, const std::vector<repo::lib::repo_face_t>& faces, const std::optional<RepoMeshCodec::Options>& codec)
 {
 	if (faces.size() > 0)
 	{
@@ -191,19 +237,29 @@ void appendFaces(RepoBSONBuilder& builder, const std::vector<repo::lib::repo_fac
 
 		builder.append(REPO_NODE_MESH_LABEL_PRIMITIVE, static_cast<int>(primitive));
 
-		builder.appendLargeArray(REPO_NODE_MESH_LABEL_FACES, facesLevel1);
+		if (codec) {
+			builder.appendLargeArray(REPO_NODE_MESH_LABEL_ENCODED_FACES, RepoMeshCodec::encodeFaces(facesLevel1, *codec));
+		}
+		else {
+			builder.appendLargeArray(REPO_NODE_MESH_LABEL_FACES, facesLevel1);
+		}
 	}
 }
 
-void appendNormals(RepoBSONBuilder& builder, const std::vector<repo::lib::RepoVector3D>& normals)
+void appendNormals(RepoBSONBuilder& builder, const std::vector<repo::lib::RepoVector3D>& normals, const std::optional<RepoMeshCodec::Options>& codec)
 {
 	if (normals.size() > 0)
 	{
-		builder.appendLargeArray(REPO_NODE_MESH_LABEL_NORMALS, normals);
+		if (codec) {
+			builder.appendLargeArray(REPO_NODE_MESH_LABEL_ENCODED_NORMALS, RepoMeshCodec::encodeNormals(normals, *codec));
+		}
+		else {
+			builder.appendLargeArray(REPO_NODE_MESH_LABEL_NORMALS, normals);
+		}
 	}
 }
 
-void appendUVChannels(RepoBSONBuilder& builder, size_t numChannels, const std::vector<repo::lib::RepoVector2D> concatenated)
+void appendUVChannels(RepoBSONBuilder& builder, size_t numChannels, const std::vector<repo::lib::RepoVector2D> concatenated, const std::optional<RepoMeshCodec::Options>& codec)
 {
 	if (concatenated.size() > 0)
 	{
@@ -211,7 +267,12 @@ void appendUVChannels(RepoBSONBuilder& builder, size_t numChannels, const std::v
 		{
 			// Could be unsigned __int64 if BSON had such construct (the closest is only __int64)
 			builder.append(REPO_NODE_MESH_LABEL_UV_CHANNELS_COUNT, (int32_t)numChannels);
-			builder.appendLargeArray(REPO_NODE_MESH_LABEL_UV_CHANNELS, concatenated);
+			if (codec) {
+				builder.appendLargeArray(REPO_NODE_MESH_LABEL_ENCODED_UV_CHANNELS, RepoMeshCodec::encodeUVs(concatenated, *codec));
+			}
+			else {
+				builder.appendLargeArray(REPO_NODE_MESH_LABEL_UV_CHANNELS, concatenated);
+			}
 		}
 	}
 }
@@ -263,13 +324,21 @@ void MeshNode::serialise(repo::core::model::RepoBSONBuilder& builder) const
 {
 	RepoNode::serialise(builder);
 	appendBounds(builder, boundingBox);
-	appendVertices(builder, vertices);
-	appendFaces(builder, faces);
-	appendNormals(builder, normals);
-	appendUVChannels(builder, channels.size(), getUVChannelsSerialised());
+	appendVertices(builder, vertices, geometryCodec);
+	appendFaces(builder, faces, geometryCodec);
+	appendNormals(builder, normals, geometryCodec);
+	appendUVChannels(builder, channels.size(), getUVChannelsSerialised(), geometryCodec);
+
+	if (geometryCodec) {
+		builder.append(REPO_NODE_MESH_LABEL_GEOMETRY_CODEC, RepoMeshCodec::VERSION);
+	}
 
 	auto matProps = determineMaterialProperties(material, textureId, getNumUVChannels());
-	appendFilterTags(builder, grouping, matProps, textureId);	
+	appendFilterTags(builder, grouping, matProps, textureId);
+
+	if (vertices.size()) {
+		builder.append(REPO_NODE_MESH_LABEL_SHA256, getSHA256());
+	}
 }
 
 MeshNode::MaterialProperties repo::core::model::MeshNode::getMaterialProperties() const
@@ -298,6 +367,7 @@ void MeshNode::setUVChannel(size_t channel, std::vector<repo::lib::RepoVector2D>
 	{
 		channels.resize(std::max(channels.size(), channel + 1));
 		channels[channel] = std::vector<repo::lib::RepoVector2D>(uvs.begin(), uvs.end());
+		geometryChanged();
 	}
 }
 
@@ -346,6 +416,8 @@ void MeshNode::applyTransformation(
 				n.normalize();
 			}
 		}
+
+		sha256.clear();
 	}
 }
 
@@ -445,6 +517,45 @@ size_t MeshNode::getSize() const
 	return size;
 }
 
+void MeshNode::geometryChanged()
+{
+	geometryAllocation.resize(getSize() - sizeof(*this));
+	sha256.clear();
+}
+
+std::string MeshNode::getSHA256() const
+{
+	if (sha256.size()) {
+		return sha256;
+	}
+
+	repo::lib::RepoSHA256 hash;
+	hash.update(static_cast<int32_t>(primitive));
+	hash.update(vertices);
+	hash.update(normals);
+
+	// Faces are hashed by member, as repo_face_t contains padding
+
+	hash.update((uint64_t)faces.size());
+	for (const auto& face : faces) {
+		hash.update(face.sides);
+		for (const auto& index : face) {
+			hash.update(index);
+		}
+	}
+
+	hash.update((uint64_t)channels.size());
+	for (const auto& channel : channels) {
+		hash.update(channel);
+	}
+
+	hash.update(material);
+	hash.update(grouping);
+
+	sha256 = hash.hexdigest();
+	return sha256;
+}
+
 // Common constant used to get good hash scattering
 #define GOLDEN_RATIO 0x9e3779b9
 
@@ -558,4 +669,6 @@ void MeshNode::removeDuplicateVertices()
 	if (useUvs) {
 		channels[0] = uvs;
 	}
+
+	geometryChanged();
 }
@@ -23,6 +23,10 @@
 #include "repo/repo_bouncer_global.h"
 #include "repo/lib/datastructure/repo_structs.h"
 #include "repo/lib/datastructure/repo_bounds.h"
+#include "repo/lib/repo_mesh_codec.h"
+#include "repo/lib/repo_memory_accounting.h"
+
+#include <optional>
 
 namespace repo {
 	namespace core {
@@ -48,6 +52,13 @@ namespace repo {
 #define REPO_NODE_MESH_LABEL_UV_CHANNELS_COUNT		"uv_channels_count"
 #define REPO_NODE_MESH_LABEL_UV_CHANNELS_BYTE_COUNT	"uv_channels_byte_count"
 #define REPO_NODE_MESH_LABEL_SHA256                  "sha256"
+#define REPO_NODE_MESH_LABEL_GEOMETRY_CODEC          "geometry_codec" //!< RepoMeshCodec version, if the geometry is encoded
+			// Meshes written with RepoMeshCodec hold their geometry in these fields instead,
+			// so readers that do not know the codec never mistake a stream for an array
+#define REPO_NODE_MESH_LABEL_ENCODED_VERTICES        "encoded_vertices"
+#define REPO_NODE_MESH_LABEL_ENCODED_FACES           "encoded_faces"
+#define REPO_NODE_MESH_LABEL_ENCODED_NORMALS         "encoded_normals"
+#define REPO_NODE_MESH_LABEL_ENCODED_UV_CHANNELS     "encoded_uv_channels"
 #define REPO_NODE_MESH_LABEL_COLORS                  "colors"
 #define REPO_NODE_MESH_LABEL_SUBMESH_IDS                     "submeshIds"
 			//------------------------------------------------------------------------------
@@ -147,6 +158,20 @@ namespace repo {
 				// Material struct
 				repo::lib::repo_material_t material;
 
+				// If set, the geometry is written with RepoMeshCodec
+				std::optional<repo::lib::RepoMeshCodec::Options> geometryCodec;
+
+				// The size of the geometry arrays, as counted by RepoMemoryAccounting
+				repo::lib::RepoMemoryAccounting::Allocation geometryAllocation{ repo::lib::RepoMemoryAccounting::Tag::MESH };
+
+				// The digest returned by getSHA256, or empty if it has not been computed
+				// since the mesh was last changed
+				mutable std::string sha256;
+
+				// Must be called whenever the geometry arrays change, to update the memory
+				// accounting and drop the cached digest
+				void geometryChanged();
+
 			public:
 				/**
 				* Get the mesh primitive type (points, lines, triangles, quads) (triangles if not set).
@@ -192,13 +217,25 @@ namespace repo {
 				void applyTransformation(
 					const repo::lib::RepoMatrix& matrix);
 
+				/*
+				* Sets whether the geometry buffers should be encoded with RepoMeshCodec
+				* when this node is serialised. Meshes read back are always decoded, so
+				* this only affects writing.
+				*/
+				void setGeometryCodec(const std::optional<repo::lib::RepoMeshCodec::Options>& options)
+				{
+					geometryCodec = options;
+				}
+
 				void setGrouping(const std::string& grouping)
 				{
 					this->grouping = grouping;
+					sha256.clear();
 				}
 
 				void setMaterial(const repo::lib::repo_material_t& m) {
 					this->material = m;
+					sha256.clear();
 				}
 
 				const repo::lib::repo_material_t& getMaterial() {
@@ -245,6 +282,7 @@ namespace repo {
 					if (this->faces.size()) {
 						primitive = (Primitive)this->faces[0].size();
 					}
+					geometryChanged();
 				}
 
 				// get specific grouping for mesh batching (empty string if not specified)
@@ -267,6 +305,7 @@ namespace repo {
 				void setNormals(const std::vector<repo::lib::RepoVector3D>& normals)
 				{
 					this->normals = normals;
+					geometryChanged();
 				}
 
 				std::vector<repo::lib::RepoVector2D> getUVChannelsSerialised() const;
@@ -295,6 +334,7 @@ namespace repo {
 					if (updateBoundingBox) {
 						this->updateBoundingBox();
 					}
+					geometryChanged();
 				}
 
 				std::uint32_t getNumFaces() const
@@ -314,6 +354,15 @@ namespace repo {
 
 				size_t getSize() const;
 
+				/*
+				* Returns a SHA-256 digest of the geometry, material and grouping of this
+				* mesh, as a hex string. Meshes with the same digest produce identical
+				* geometry in the stash. Unique and shared ids are not included, so
+				* the digest may be compared between revisions. The digest is computed on
+				* the first call, and cached until the mesh is changed.
+				*/
+				std::string getSHA256() const;
+
 				void updateBoundingBox();
 
 				/*
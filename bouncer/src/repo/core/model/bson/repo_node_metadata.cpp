@@ -19,6 +19,7 @@
 *  Metadata node
 */
 
+#include <repo_log.h>
 #include "repo_node_metadata.h"
 #include "repo_bson_builder.h"
 
@@ -45,7 +46,10 @@ void MetadataNode::deserialise(RepoBSON& bson)
 		auto metadata = bson.getObjectArray(REPO_NODE_LABEL_METADATA);
 		for (auto& field : metadata) {
 			auto key = field.getStringField(REPO_NODE_LABEL_META_KEY);
-			metadataMap[key] = field.getField(REPO_NODE_LABEL_META_VALUE).repoVariant();
+			auto value = field.getField(REPO_NODE_LABEL_META_VALUE).repoCompactVariant();
+			if (!value.isEmpty()) {
+				metadataMap[key] = std::move(value);
+			}
 		}
 	}
 }
@@ -68,8 +72,8 @@ void MetadataNode::serialise(repo::core::model::RepoBSONBuilder& builder) const
 
 	std::vector<RepoBSON> metaEntries;
 	for (const auto& entry : metadataMap) {
-		std::string key = entry.first;
-		repo::lib::RepoVariant value = entry.second;
+		const auto& key = entry.first;
+		const auto& value = entry.second;
 		if (!key.empty())
 		{
 			RepoBSONBuilder metaEntryBuilder;
@@ -83,22 +87,27 @@ void MetadataNode::serialise(repo::core::model::RepoBSONBuilder& builder) const
 	builder.appendArray(REPO_NODE_LABEL_METADATA, metaEntries);
 }
 
-void MetadataNode::setMetadata(const std::unordered_map<std::string, repo::lib::RepoVariant>& map)
+std::unordered_map<std::string, repo::lib::RepoVariant> MetadataNode::getAllMetadata() const
 {
-	for (const auto& pair : map) {
-		auto key = sanitiseKey(pair.first);
-		auto value = pair.second;
-		metadataMap[key] = value;
+	std::unordered_map<std::string, repo::lib::RepoVariant> map;
+	map.reserve(metadataMap.size());
+	for (const auto& pair : metadataMap) {
+		map[pair.first] = pair.second.toRepoVariant();
 	}
+	return map;
 }
 
-/* Define the equality operator for tm, for sEqual below.
- * This static definition is only for this object.
- */
-
-static bool operator== (tm a, tm b)
+void MetadataNode::setMetadata(const std::unordered_map<std::string, repo::lib::RepoVariant>& map)
 {
-	return memcmp(&a, &b, sizeof(tm)) == 0;
+	metadataMap.reserve(metadataMap.size() + map.size());
+	for (const auto& pair : map) {
+		auto value = repo::lib::RepoCompactVariant::fromRepoVariant(pair.second);
+		if (value.isEmpty()) {
+			repoWarning << "Ignoring the metadata value of " << pair.first << " as its date cannot be converted";
+			continue;
+		}
+		metadataMap[sanitiseKey(pair.first)] = std::move(value);
+	}
 }
 
 bool MetadataNode::sEqual(const RepoNode &other) const
@@ -108,7 +117,7 @@ bool MetadataNode::sEqual(const RepoNode &other) const
 		return false;
 	}
 
-	auto o = dynamic_cast<const MetadataNode&>(other);
+	const auto& o = dynamic_cast<const MetadataNode&>(other);
 
 	if (metadataMap.size() != o.metadataMap.size())
 	{
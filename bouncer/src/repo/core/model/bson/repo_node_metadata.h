@@ -21,6 +21,7 @@
 #pragma once
 #include "repo_node.h"
 #include "repo/lib/datastructure/repo_variant.h"
+#include "repo/lib/datastructure/repo_compact_variant.h"
 #include "repo/core/model/repo_model_global.h"
 #include <unordered_map>
 
@@ -58,18 +59,32 @@ namespace repo {
 				~MetadataNode();
 
 			protected:
-				std::unordered_map<std::string, repo::lib::RepoVariant> metadataMap;
+				// Held as compact variants, as scenes may have millions of values, and
+				// written to BSON directly from them
+				std::unordered_map<std::string, repo::lib::RepoCompactVariant> metadataMap;
 
 			protected:
 				virtual void deserialise(RepoBSON&);
 				virtual void serialise(class RepoBSONBuilder&) const;
 
 			public:
-				const std::unordered_map<std::string, repo::lib::RepoVariant>& getAllMetadata() const
+				/**
+				* Returns a copy of the metadata as RepoVariants. Dates are held as
+				* timestamps, so are returned as UTC tms, as they would be after the
+				* node is read back from the database.
+				*/
+				std::unordered_map<std::string, repo::lib::RepoVariant> getAllMetadata() const;
+
+				const std::unordered_map<std::string, repo::lib::RepoCompactVariant>& getAllCompactMetadata() const
 				{
 					return metadataMap;
 				}
 
+				/**
+				* Adds the values to the metadata, replacing those with the same keys.
+				* Dates that cannot be converted to timestamps are dropped with a
+				* warning.
+				*/
 				void setMetadata(const std::unordered_map<std::string, repo::lib::RepoVariant>&);
 
 				/**
@@ -16,6 +16,7 @@
 */
 
 #include "repo_node_streaming_mesh.h"
+#include "repo/lib/repo_exception.h"
 
 repo::core::model::StreamingMeshNode::SupermeshingData::SupermeshingData(const repo::core::model::RepoBSON& bson, const std::vector<uint8_t>& buffer, const bool ignoreUVs)
 {
@@ -51,24 +52,34 @@ void repo::core::model::StreamingMeshNode::SupermeshingData::deserialise(const r
 	auto blobRefBson = bson.getObjectField(REPO_LABEL_BINARY_REFERENCE);
 	auto elementsBson = blobRefBson.getObjectField(REPO_LABEL_BINARY_ELEMENTS);
 
-	if (elementsBson.hasField(REPO_NODE_MESH_LABEL_VERTICES)) {
-		auto vertBson = elementsBson.getObjectField(REPO_NODE_MESH_LABEL_VERTICES);
-		deserialiseVector(vertBson, buffer, vertices);
+	bool encoded = bson.hasField(REPO_NODE_MESH_LABEL_GEOMETRY_CODEC);
+	if (encoded && bson.getIntField(REPO_NODE_MESH_LABEL_GEOMETRY_CODEC) > repo::lib::RepoMeshCodec::VERSION) {
+		throw repo::lib::RepoException("Mesh node " + uniqueId.toString() + " has geometry encoded with an unsupported codec version");
 	}
 
-	if (elementsBson.hasField(REPO_NODE_MESH_LABEL_NORMALS)) {
-		auto normBson = elementsBson.getObjectField(REPO_NODE_MESH_LABEL_NORMALS);
-		deserialiseVector(normBson, buffer, normals);
+	auto verticesLabel = encoded ? REPO_NODE_MESH_LABEL_ENCODED_VERTICES : REPO_NODE_MESH_LABEL_VERTICES;
+	auto normalsLabel = encoded ? REPO_NODE_MESH_LABEL_ENCODED_NORMALS : REPO_NODE_MESH_LABEL_NORMALS;
+	auto facesLabel = encoded ? REPO_NODE_MESH_LABEL_ENCODED_FACES : REPO_NODE_MESH_LABEL_FACES;
+	auto uvChannelsLabel = encoded ? REPO_NODE_MESH_LABEL_ENCODED_UV_CHANNELS : REPO_NODE_MESH_LABEL_UV_CHANNELS;
+
+	if (elementsBson.hasField(verticesLabel)) {
+		auto vertBson = elementsBson.getObjectField(verticesLabel);
+		deserialiseVector(vertBson, buffer, vertices, encoded, repo::lib::RepoMeshCodec::decodePositions);
+	}
+
+	if (elementsBson.hasField(normalsLabel)) {
+		auto normBson = elementsBson.getObjectField(normalsLabel);
+		deserialiseVector(normBson, buffer, normals, encoded, repo::lib::RepoMeshCodec::decodeNormals);
 	}
 
-	if (elementsBson.hasField(REPO_NODE_MESH_LABEL_FACES)) {
+	if (elementsBson.hasField(facesLabel)) {
 
 		int32_t faceCount = bson.getIntField(REPO_NODE_MESH_LABEL_FACES_COUNT);
 		faces.reserve(faceCount);
 
 		std::vector<uint32_t> serialisedFaces = std::vector<uint32_t>();
-		auto faceBson = elementsBson.getObjectField(REPO_NODE_MESH_LABEL_FACES);
-		deserialiseVector(faceBson, buffer, serialisedFaces);
+		auto faceBson = elementsBson.getObjectField(facesLabel);
+		deserialiseVector(faceBson, buffer, serialisedFaces, encoded, repo::lib::RepoMeshCodec::decodeFaces);
 
 		// Retrieve numbers of vertices for each face and subsequent
 		// indices into the vertex array.
@@ -96,10 +107,10 @@ void repo::core::model::StreamingMeshNode::SupermeshingData::deserialise(const r
 
 	}
 
-	if (!ignoreUVs && elementsBson.hasField(REPO_NODE_MESH_LABEL_UV_CHANNELS)) {
+	if (!ignoreUVs && elementsBson.hasField(uvChannelsLabel)) {
 		std::vector<repo::lib::RepoVector2D> serialisedChannels;
-		auto uvBson = elementsBson.getObjectField(REPO_NODE_MESH_LABEL_UV_CHANNELS);
-		deserialiseVector(uvBson, buffer, serialisedChannels);
+		auto uvBson = elementsBson.getObjectField(uvChannelsLabel);
+		deserialiseVector(uvBson, buffer, serialisedChannels, encoded, repo::lib::RepoMeshCodec::decodeUVs);
 
 		if (serialisedChannels.size())
 		{
@@ -122,9 +133,15 @@ void repo::core::model::StreamingMeshNode::SupermeshingData::deserialise(const r
 
 repo::core::model::StreamingMeshNode::StreamingMeshNode(const repo::core::model::RepoBSON& bson)
 {
+	if (bson.hasField(REPO_NODE_LABEL_ID)) {
+		uniqueId = bson.getUUIDField(REPO_NODE_LABEL_ID);
+	}
 	if (bson.hasField(REPO_NODE_LABEL_SHARED_ID)) {
 		sharedId = bson.getUUIDField(REPO_NODE_LABEL_SHARED_ID);
 	}
+	if (bson.hasField(REPO_NODE_MESH_LABEL_SHA256)) {
+		sha256 = bson.getStringField(REPO_NODE_MESH_LABEL_SHA256);
+	}
 	if (bson.hasField(REPO_NODE_MESH_LABEL_VERTICES_COUNT)) {
 		numVertices = bson.getIntField(REPO_NODE_MESH_LABEL_VERTICES_COUNT);
 	}
@@ -160,6 +177,9 @@ const repo::lib::RepoUUID repo::core::model::StreamingMeshNode::getUniqueId()
 	if (supermeshingDataLoaded()) {
 		return supermeshingData->getUniqueId();
 	}
+	else if (!uniqueId.isDefaultValue()) {
+		return uniqueId;
+	}
 	else {
 		repoError << "Tried to access supermesh geometry of StreamingMeshNode without loading geometry first. Empty returned.";
 		return repo::lib::RepoUUID();
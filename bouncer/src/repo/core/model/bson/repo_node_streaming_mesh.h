@@ -93,9 +93,34 @@ namespace repo {
 						vec.resize(size / sizeof(T));
 						memcpy(vec.data(), buffer.data() + (sizeof(uint8_t) * start), size);
 					}
+
+					/*
+					* As above, but if encoded is set, the slice holds a RepoMeshCodec stream
+					* which is decoded with decode.
+					*/
+					template <class T>
+					void deserialiseVector(
+						const repo::core::model::RepoBSON& bson,
+						const std::vector<uint8_t>& buffer,
+						std::vector<T>& vec,
+						bool encoded,
+						std::vector<T>(*decode)(const uint8_t*, size_t))
+					{
+						if (!encoded) {
+							deserialiseVector(bson, buffer, vec);
+							return;
+						}
+
+						auto start = bson.getLongField(REPO_LABEL_BINARY_START);
+						auto size = bson.getLongField(REPO_LABEL_BINARY_SIZE);
+
+						vec = decode(buffer.data() + start, size);
+					}
 				};
 
+				repo::lib::RepoUUID uniqueId;
 				repo::lib::RepoUUID sharedId;
+				std::string sha256;
 				std::uint32_t numVertices = 0;
 				repo::lib::RepoUUID parent;
 				repo::lib::RepoBounds bounds;
@@ -137,6 +162,15 @@ namespace repo {
 					return numVertices;
 				}
 
+				/*
+				* The content digest of the MeshNode (see MeshNode::getSHA256()), or an
+				* empty string if the node was written without one.
+				*/
+				const std::string& getSHA256() const
+				{
+					return sha256;
+				}
+
 				const repo::lib::RepoBounds getBoundingBox() const
 				{
 					return bounds;
@@ -149,7 +183,8 @@ namespace repo {
 
 				void transformBounds(const repo::lib::RepoMatrix& transform);
 
-				// Requiring the supermeshing data to be loaded
+				// Requiring the supermeshing data to be loaded, unless the unique id was
+				// included when the node was constructed
 
 				const repo::lib::RepoUUID getUniqueId();
 
@@ -31,6 +31,9 @@ namespace repo {
 			protected:
 				std::vector<repo::lib::repo_mesh_mapping_t> mappings;
 				std::vector<float> submeshIds;
+				uint32_t lodLevel = 0;
+				float lodError = 0;
+				repo::lib::RepoUUID lodSource;
 
 			protected:
 				virtual void deserialise(RepoBSON&);
@@ -57,6 +60,42 @@ namespace repo {
 				{
 					this->submeshIds = ids;
 				}
+
+				/**
+				* Level of detail. Level 0 is the original geometry. Higher levels are
+				* simplified versions of the supermesh given by getLodSource(), with the
+				* same mesh mapping entries, but fewer faces.
+				*/
+				uint32_t getLodLevel() const
+				{
+					return lodLevel;
+				}
+
+				/**
+				* The greatest distance, in model units, from a vertex of the level 0
+				* supermesh to the faces of the same submesh in this level, as measured
+				* by MeshSimplifier. It never decreases from one level to the next. These
+				* fields are held for exporters only; supermeshes are not serialised.
+				*/
+				float getLodError() const
+				{
+					return lodError;
+				}
+
+				/**
+				* Unique id of the level 0 supermesh this was simplified from
+				*/
+				const repo::lib::RepoUUID& getLodSource() const
+				{
+					return lodSource;
+				}
+
+				void setLod(uint32_t level, float error, const repo::lib::RepoUUID& source)
+				{
+					this->lodLevel = level;
+					this->lodError = error;
+					this->lodSource = source;
+				}
 			};
 		}
 	}
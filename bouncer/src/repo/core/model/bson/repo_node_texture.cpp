@@ -23,6 +23,7 @@
 #include <repo_log.h>
 #include <boost/filesystem.hpp>
 #include "repo_bson_builder.h"
+#include "repo/lib/repo_sha256.h"
 
 using namespace repo::core::model;
 
@@ -66,6 +67,20 @@ void TextureNode::deserialise(RepoBSON& bson)
 	{
 		extension = bson.getStringField(REPO_NODE_LABEL_EXTENSION);
 	}
+	if (bson.hasField(REPO_NODE_LABEL_MIP_LEVELS))
+	{
+		auto levels = bson.getObjectArray(REPO_NODE_LABEL_MIP_LEVELS);
+		for (size_t i = 0; i < levels.size(); i++)
+		{
+			MipLevel level;
+			level.width = levels[i].getIntField(REPO_LABEL_WIDTH);
+			level.height = levels[i].getIntField(REPO_LABEL_HEIGHT);
+			bson.getBinaryFieldAsVector(REPO_NODE_LABEL_MIP_LEVEL_DATA + std::to_string(i + 1), level.data);
+			mipLevels.push_back(std::move(level));
+		}
+	}
+
+	updateDataAllocation();
 }
 
 void TextureNode::serialise(repo::core::model::RepoBSONBuilder& builder) const
@@ -87,6 +102,22 @@ void TextureNode::serialise(repo::core::model::RepoBSONBuilder& builder) const
 	{
 		repoWarning << " Creating a texture node with no texture!";
 	}
+
+	builder.append(REPO_NODE_TEXTURE_LABEL_SHA256, getSHA256());
+
+	if (mipLevels.size())
+	{
+		std::vector<RepoBSON> levels;
+		for (size_t i = 0; i < mipLevels.size(); i++)
+		{
+			RepoBSONBuilder level;
+			level.append(REPO_LABEL_WIDTH, (int32_t)mipLevels[i].width);
+			level.append(REPO_LABEL_HEIGHT, (int32_t)mipLevels[i].height);
+			levels.push_back(level.obj());
+			builder.appendLargeArray(REPO_NODE_LABEL_MIP_LEVEL_DATA + std::to_string(i + 1), mipLevels[i].data);
+		}
+		builder.appendArray(REPO_NODE_LABEL_MIP_LEVELS, levels);
+	}
 }
 
 bool TextureNode::sEqual(const RepoNode &other) const
@@ -110,4 +141,28 @@ bool TextureNode::sEqual(const RepoNode &other) const
 bool TextureNode::isEmpty() const
 {
 	return !data.size();
-}
\ No newline at end of file
+}
+
+size_t TextureNode::getSize() const
+{
+	size_t size = sizeof(*this) + data.size();
+	for (auto& level : mipLevels) {
+		size += level.data.size();
+	}
+	return size;
+}
+
+void TextureNode::updateDataAllocation()
+{
+	dataAllocation.resize(getSize() - sizeof(*this));
+}
+
+std::string TextureNode::getSHA256() const
+{
+	repo::lib::RepoSHA256 hash;
+	hash.update(width);
+	hash.update(height);
+	hash.update(extension);
+	hash.update(data);
+	return hash.hexdigest();
+}
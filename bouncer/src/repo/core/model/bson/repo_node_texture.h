@@ -21,6 +21,7 @@
 #pragma once
 #include "repo_node.h"
 #include "repo/core/model/repo_model_global.h"
+#include "repo/lib/repo_memory_accounting.h"
 
 namespace repo {
 	namespace core {
@@ -31,12 +32,27 @@ namespace repo {
 			//
 			//------------------------------------------------------------------------------
 #define REPO_NODE_TYPE_TEXTURE				"texture"
+#define REPO_NODE_LABEL_MIP_LEVELS			"mipLevels"
+#define REPO_NODE_LABEL_MIP_LEVEL_DATA		"mipLevel" // Followed by the index of the level, from 1
+#define REPO_NODE_TEXTURE_LABEL_SHA256		"sha256"
 			//------------------------------------------------------------------------------
 
 			class REPO_API_EXPORT TextureNode : public RepoNode
 			{
 			public:
 
+				/*
+				* A reduced copy of the texture, encoded in the same way as the data
+				*/
+				struct MipLevel
+				{
+					uint32_t width;
+					uint32_t height;
+					std::vector<uint8_t> data;
+
+					bool operator==(const MipLevel& other) const = default;
+				};
+
 				/**
 				* Default constructor
 				*/
@@ -95,6 +111,12 @@ namespace repo {
 				std::string extension;
 				uint32_t width;
 				uint32_t height;
+				std::vector<MipLevel> mipLevels;
+
+				// The size of the image and mip levels, as counted by RepoMemoryAccounting
+				repo::lib::RepoMemoryAccounting::Allocation dataAllocation{ repo::lib::RepoMemoryAccounting::Tag::TEXTURE };
+
+				void updateDataAllocation();
 
 			public:
 				/**
@@ -123,12 +145,37 @@ namespace repo {
 
 				bool isEmpty() const;
 
+				size_t getSize() const;
+
+				/*
+				* Returns a SHA-256 digest of the image and its dimensions, as a hex
+				* string. Ids are not included, so the digest may be compared between
+				* revisions.
+				*/
+				std::string getSHA256() const;
+
 				void setData(const std::vector<uint8_t>& data, size_t width, size_t height, std::string extension = "")
 				{
 					this->data = data;
 					this->width = width;
 					this->height = height;
 					this->extension = extension;
+					updateDataAllocation();
+				}
+
+				/*
+				* The mip levels below the full size image, largest first. These are
+				* optional; most textures have none.
+				*/
+				const std::vector<MipLevel>& getMipLevels() const
+				{
+					return mipLevels;
+				}
+
+				void setMipLevels(std::vector<MipLevel> mipLevels)
+				{
+					this->mipLevels = std::move(mipLevels);
+					updateDataAllocation();
 				}
 			};
 		} //namespace model
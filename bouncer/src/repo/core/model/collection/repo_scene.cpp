@@ -23,7 +23,11 @@
 #include <boost/filesystem.hpp>
 #include <boost/range/adaptor/map.hpp>
 #include <boost/range/algorithm/copy.hpp>
+#include <atomic>
+#include <exception>
 #include <fstream>
+#include <mutex>
+#include <thread>
 
 #include <repo_log.h>
 #include "repo/error_codes.h"
@@ -32,6 +36,7 @@
 #include "repo/core/model/bson/repo_bson_factory.h"
 #include "repo/core/model/bson/repo_bson_project_settings.h"
 #include "repo/core/handler/database/repo_query.h"
+#include "repo/core/handler/database/repo_bulk_upsert_context.h"
 
 using namespace repo::core::model;
 
@@ -47,6 +52,7 @@ const std::vector<std::string> RepoScene::collectionsInProject = {
 	"stash.src",
 	"stash.src.files",
 	"stash.src.chunks",
+	"stash.clusters",
 	"history",
 	"history.files",
 	"history.chunks",
@@ -797,7 +803,18 @@ bool RepoScene::commitNodes(
 		nodes.push_back(*node);
 	}
 
-	handler->insertManyDocuments(databaseName, projectName + "." + ext, nodes);
+	if (deduplicateBinaries) {
+		// The write contexts can share identical binaries between documents
+		auto context = handler->getBulkWriteContext(databaseName, projectName + "." + ext);
+		context->setDeduplicateBinaries(true);
+		for (auto& node : nodes) {
+			context->insertDocument(node);
+		}
+		context->flush();
+	}
+	else {
+		handler->insertManyDocuments(databaseName, projectName + "." + ext, nodes);
+	}
 
 	return true;
 }
@@ -823,10 +840,21 @@ bool RepoScene::commitSceneChanges(
 	if (newModified.size()) {
 		repoInfo << "Updating " << newModified.size() << " nodes...";
 
+		repo::core::handler::database::BulkUpsertContext context(handler, databaseName, projectName + "." + REPO_COLLECTION_SCENE, false);
 		for (auto& id : newModified) {
 			auto node = graph.nodesByUniqueID[graph.sharedIDtoUniqueID[id]];
 			node->setRevision(revId);
-			handler->upsertDocument(databaseName, projectName + "." + REPO_COLLECTION_SCENE, *node, false);
+			context.upsertDocument(*node);
+		}
+		context.flush();
+
+		for (auto& failure : context.getFailures()) {
+			repoError << "Failed to update node " << failure.document.getUUIDField(REPO_NODE_LABEL_ID).toString() << ": " << failure.message;
+		}
+
+		if (context.getFailures().size()) {
+			errMsg += "Failed to update " + std::to_string(context.getFailures().size()) + " of " + std::to_string(newModified.size()) + " nodes";
+			return false;
 		}
 	}
 
@@ -976,11 +1004,10 @@ void RepoScene::getSceneBoundingBoxInternal(
 		}
 		case NodeType::REFERENCE:
 		{
-			repoGraphInstance g = gType == GraphType::DEFAULT ? graph : stashGraph;
 			auto refSceneIt = graph.referenceToScene.find(node->getSharedID());
 			if (refSceneIt != graph.referenceToScene.end())
 			{
-				const RepoScene *refScene = refSceneIt->second;
+				const RepoScene *refScene = refSceneIt->second.get();
 				bbox.encapsulate(refScene->getSceneBoundingBox());
 			}
 			break;
@@ -1135,6 +1162,10 @@ bool RepoScene::loadScene(
 		if (!loadRevision(handler, errMsg)) return false;
 	}
 
+	if (referencesOnly) {
+		return loadSceneReferences(handler, errMsg);
+	}
+
 	std::vector<RepoBSON> nodes = handler->findAllByCriteria(
 		databaseName, projectName + "." + REPO_COLLECTION_SCENE, core::handler::database::query::Eq(REPO_NODE_STASH_REF, revNode->getUniqueID()), true
 	);
@@ -1144,6 +1175,59 @@ bool RepoScene::loadScene(
 	return populate(GraphType::DEFAULT, handler, nodes, errMsg);
 }
 
+bool RepoScene::loadSceneReferences(
+	repo::core::handler::AbstractDatabaseHandler *handler,
+	std::string &errMsg)
+{
+	using namespace repo::core::handler::database;
+
+	auto collection = projectName + "." + REPO_COLLECTION_SCENE;
+
+	query::RepoQueryBuilder filter;
+	filter.append(query::Eq(REPO_NODE_STASH_REF, revNode->getUniqueID()));
+	filter.append(query::Or(
+		query::Exists(REPO_NODE_LABEL_PARENTS, false),
+		query::Eq(REPO_NODE_LABEL_TYPE, std::string(REPO_NODE_TYPE_REFERENCE))
+	));
+	std::vector<RepoBSON> nodes = handler->findAllByCriteria(databaseName, collection, filter);
+
+	// The nodes between the references and the root are needed to position the
+	// reference scenes. These are fetched a level at a time.
+
+	std::set<repo::lib::RepoUUID> loaded;
+	std::vector<repo::lib::RepoUUID> parents;
+	size_t start = 0;
+	while (start < nodes.size()) {
+		for (; start < nodes.size(); start++) {
+			loaded.insert(nodes[start].getUUIDField(REPO_NODE_LABEL_SHARED_ID));
+			for (auto& parent : nodes[start].getUUIDFieldArray(REPO_NODE_LABEL_PARENTS)) {
+				parents.push_back(parent);
+			}
+		}
+
+		std::vector<repo::lib::RepoUUID> missing;
+		for (auto& parent : parents) {
+			if (loaded.insert(parent).second) {
+				missing.push_back(parent);
+			}
+		}
+		parents.clear();
+
+		if (missing.size()) {
+			query::RepoQueryBuilder ancestors;
+			ancestors.append(query::Eq(REPO_NODE_STASH_REF, revNode->getUniqueID()));
+			ancestors.append(query::Eq(REPO_NODE_LABEL_SHARED_ID, missing));
+			for (auto& bson : handler->findAllByCriteria(databaseName, collection, ancestors)) {
+				nodes.push_back(bson);
+			}
+		}
+	}
+
+	repoInfo << "# of nodes loaded from this unoptimised scene = " << nodes.size() << " (references only)";
+
+	return populate(GraphType::DEFAULT, handler, nodes, errMsg);
+}
+
 bool RepoScene::loadStash(
 	repo::core::handler::AbstractDatabaseHandler *handler,
 	std::string &errMsg) {
@@ -1224,9 +1308,7 @@ void RepoScene::removeNode(
 		case NodeType::REFERENCE:
 		{
 			g.references.erase(node);
-			//Since it's reference node, also delete the referenced scene
-			RepoScene *s = g.referenceToScene[sharedID];
-			delete s;
+			//Since it's reference node, also release the referenced scene
 			g.referenceToScene.erase(sharedID);
 		}
 		break;
@@ -1322,35 +1404,14 @@ bool RepoScene::populate(
 	if (g.references.size()) worldOffset.clear();
 	if (!ignoreReferenceNodes)
 	{
+		loadReferenceScenes(handler, g);
+
 		for (const auto &node : g.references)
 		{
-			ReferenceNode* reference = (ReferenceNode*)node;
-
-			//construct a new RepoScene with the information from reference node and append this g to the Scene
-			std::string spDbName = reference->getDatabaseName();
-			if (spDbName.empty()) spDbName = databaseName;
-			RepoScene *refg = new RepoScene(spDbName, reference->getProjectId());
-			if (reference->useSpecificRevision())
-				refg->setRevision(reference->getProjectRevision());
-			else
-				refg->setBranch(reference->getProjectRevision());
-
-			if (!loadExtFiles) {
-				refg->skipLoadingExtFiles();
-			}
-
-			//Try to load the stash first, if fail, try scene.
-			if (loadExtFiles && refg->loadStash(handler, errMsg) || refg->loadScene(handler, errMsg))
+			auto refScene = g.referenceToScene.find(node->getSharedID());
+			if (refScene != g.referenceToScene.end() && !worldOffset.size())
 			{
-				g.referenceToScene[reference->getSharedID()] = refg;
-				auto refOffset = refg->getWorldOffset();
-				if (!worldOffset.size())
-				{
-					worldOffset = refOffset;
-				}
-			}
-			else {
-				repoWarning << "Failed to load reference node for ref ID " << reference->getUniqueID() << ": " << errMsg;
+				worldOffset = refScene->second->getWorldOffset();
 			}
 		}
 	}
@@ -1361,10 +1422,10 @@ bool RepoScene::populate(
 	{
 		ReferenceNode* reference = (ReferenceNode*)node;
 		auto parent = reference->getParentIDs().at(0);
-		auto refScene = g.referenceToScene[reference->getSharedID()];
-		if (refScene)
+		auto refSceneIt = g.referenceToScene.find(reference->getSharedID());
+		if (refSceneIt != g.referenceToScene.end())
 		{
-			auto refOffset = refScene->getWorldOffset();
+			auto refOffset = refSceneIt->second->getWorldOffset();
 			//Back to world coord of subProject
 			std::vector<std::vector<float>> backToSubWorld =
 			{ { 1., 0., 0., (float)refOffset[0] },
@@ -1400,6 +1461,125 @@ bool RepoScene::populate(
 	return success;
 }
 
+void RepoScene::loadReferenceScenes(
+	repo::core::handler::AbstractDatabaseHandler *handler,
+	repoGraphInstance &g)
+{
+	struct ReferenceLoad
+	{
+		std::shared_ptr<RepoScene> scene;
+		std::string errMsg;
+		bool success = false;
+	};
+
+	// Federations may reference the same revision more than once (e.g. under
+	// different groups), so references are first grouped by what they point to
+
+	std::vector<ReferenceLoad> loads;
+	std::unordered_map<std::string, size_t> keyToLoad;
+	std::unordered_map<repo::lib::RepoUUID, size_t, repo::lib::RepoUUIDHasher> referenceToLoad;
+
+	for (const auto &node : g.references)
+	{
+		ReferenceNode* reference = (ReferenceNode*)node;
+
+		std::string spDbName = reference->getDatabaseName();
+		if (spDbName.empty()) spDbName = databaseName;
+
+		auto key = spDbName + "." + reference->getProjectId() + "." +
+			(reference->useSpecificRevision() ? "rev." : "branch.") + reference->getProjectRevision().toString();
+
+		auto it = keyToLoad.find(key);
+		if (it == keyToLoad.end())
+		{
+			//construct a new RepoScene with the information from reference node and append this g to the Scene
+			ReferenceLoad load;
+			load.scene = std::make_shared<RepoScene>(spDbName, reference->getProjectId());
+			if (reference->useSpecificRevision())
+				load.scene->setRevision(reference->getProjectRevision());
+			else
+				load.scene->setBranch(reference->getProjectRevision());
+
+			if (!loadExtFiles) {
+				load.scene->skipLoadingExtFiles();
+			}
+
+			it = keyToLoad.insert({ key, loads.size() }).first;
+			loads.push_back(load);
+		}
+		referenceToLoad[reference->getSharedID()] = it->second;
+	}
+
+	if (loads.size() < g.references.size())
+	{
+		repoInfo << "Loading " << loads.size() << " referenced scenes for " << g.references.size() << " reference nodes";
+	}
+
+	// Each scene is independent, so they are loaded by a small pool of workers,
+	// which take the next outstanding scene until there are none left. The
+	// handler is shared, so the database connections are too.
+
+	size_t numThreads = referenceLoadThreads ? referenceLoadThreads : std::thread::hardware_concurrency();
+	numThreads = std::max<size_t>(1, std::min(numThreads, loads.size()));
+
+	std::atomic<size_t> next(0);
+	std::exception_ptr exception;
+	std::mutex exceptionMutex;
+
+	auto worker = [&]() {
+		size_t i;
+		while ((i = next++) < loads.size())
+		{
+			auto& load = loads[i];
+			try
+			{
+				//Try to load the stash first, if fail, try scene.
+				load.success = loadExtFiles && load.scene->loadStash(handler, load.errMsg) || load.scene->loadScene(handler, load.errMsg);
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock(exceptionMutex);
+				if (!exception) {
+					exception = std::current_exception();
+				}
+				next = loads.size();
+			}
+		}
+	};
+
+	if (numThreads > 1)
+	{
+		std::vector<std::thread> threads;
+		for (size_t i = 0; i < numThreads; i++) {
+			threads.push_back(std::thread(worker));
+		}
+		for (auto& t : threads) {
+			t.join();
+		}
+	}
+	else
+	{
+		worker();
+	}
+
+	if (exception) {
+		std::rethrow_exception(exception);
+	}
+
+	for (const auto &node : g.references)
+	{
+		auto& load = loads[referenceToLoad[node->getSharedID()]];
+		if (load.success)
+		{
+			g.referenceToScene[node->getSharedID()] = load.scene;
+		}
+		else
+		{
+			repoWarning << "Failed to load reference node for ref ID " << node->getUniqueID() << ": " << load.errMsg;
+		}
+	}
+}
+
 void RepoScene::populateAndUpdate(
 	const GraphType   &gType,
 	const RepoNodeSet &meshes,
@@ -21,6 +21,7 @@
 
 #pragma once
 
+#include <memory>
 #include <unordered_map>
 
 #include "repo/core/handler/repo_database_handler_abstract.h"
@@ -55,7 +56,7 @@ namespace repo {
 					std::unordered_map<repo::lib::RepoUUID, RepoNode*, repo::lib::RepoUUIDHasher> nodesByUniqueID;
 					std::unordered_map<repo::lib::RepoUUID, repo::lib::RepoUUID, repo::lib::RepoUUIDHasher> sharedIDtoUniqueID; //** mapping of shared ID to Unique ID
 					ParentMap parentToChildren; //** mapping of shared id to its children's shared id
-					std::unordered_map<repo::lib::RepoUUID, RepoScene*, repo::lib::RepoUUIDHasher> referenceToScene; //** mapping of reference ID to it's scene graph
+					std::unordered_map<repo::lib::RepoUUID, std::shared_ptr<RepoScene>, repo::lib::RepoUUIDHasher> referenceToScene; //** mapping of reference ID to it's scene graph (references to the same revision share a scene)
 				};
 
 				static const std::vector<std::string> collectionsInProject;
@@ -140,6 +141,27 @@ namespace repo {
 					loadExtFiles = false;
 				}
 
+				/**
+				* If set, loadScene only fetches the root, the reference nodes and the
+				* nodes above them, which is enough to load the reference scenes of a
+				* federation. This is for processes that read the rest of the scene
+				* from the database themselves, such as stash and selection tree
+				* generation.
+				*/
+				void loadReferencesOnly() {
+					referencesOnly = true;
+				}
+
+				/**
+				* Set the number of threads used to load the scenes of reference nodes.
+				* The threads share the connections of the database handler, so the
+				* number of concurrent queries remains bounded by the handler.
+				* @param numThreads number of threads (0 for the number of cores)
+				*/
+				void setReferenceLoadThreads(const size_t numThreads) {
+					referenceLoadThreads = numThreads;
+				}
+
 				/**
 				* Check if default scene graph is missing texture
 				* @return returns true if missing textures
@@ -167,6 +189,15 @@ namespace repo {
 					status |= REPO_SCENE_ENTITIES_BIT;
 				}
 
+				/**
+				* If set, nodes committed by this scene whose binaries are identical to
+				* those of another node refer to the same stored data. This is for
+				* importers that keep instanced geometry in local space.
+				*/
+				void setDeduplicateBinaries(bool deduplicate) {
+					deduplicateBinaries = deduplicate;
+				}
+
 				/**
 				* Add metadata that has a matching name as the transformation into the scene
 				* @param metadata set of metadata to attach
@@ -605,9 +636,9 @@ namespace repo {
 					const repoGraphInstance &g = gType == GraphType::OPTIMIZED ? stashGraph : graph;
 					RepoScene* refScene = nullptr;
 
-					std::unordered_map<repo::lib::RepoUUID, RepoScene*, repo::lib::RepoUUIDHasher >::const_iterator it = g.referenceToScene.find(reference);
+					auto it = g.referenceToScene.find(reference);
 					if (it != g.referenceToScene.end())
-						refScene = it->second;
+						refScene = it->second.get();
 					return refScene;
 				}
 
@@ -979,6 +1010,17 @@ namespace repo {
 					std::vector<RepoBSON> nodes,
 					std::string &errMsg);
 
+				/**
+				* Load the scenes of the given reference nodes into referenceToScene.
+				* The scenes are loaded concurrently, and references to the same
+				* revision (or branch) of the same project are only loaded once.
+				* @param handler database handler to load the scenes with
+				* @param g graph instance the references belong to
+				*/
+				void loadReferenceScenes(
+					repo::core::handler::AbstractDatabaseHandler *handler,
+					repoGraphInstance &g);
+
 				/**
 				* Populate the collections with the given node sets
 				* This populates the scene graph information and also track the nodes that are added.
@@ -1030,6 +1072,7 @@ namespace repo {
 				std::string commitMsg;
 				bool headRevision;
 				bool unRevisioned;       /*! Flag to indicate if the scene graph is revisioned (true for scene graphs from model convertor)*/
+				bool deduplicateBinaries = false; /*! Flag to indicate that identical binaries should only be stored once */
 				std::string databaseName;/*! name of the database */
 				std::string projectName; /*! name of the project */
 				ModelRevisionNode		 *revNode;
@@ -1055,6 +1098,12 @@ namespace repo {
 				uint16_t status = 0; //health of the scene, 0 denotes healthy
 				bool ignoreReferenceNodes = false;
 				bool loadExtFiles = true;
+				size_t referenceLoadThreads = 0;
+				bool referencesOnly = false;
+
+				bool loadSceneReferences(
+					repo::core::handler::AbstractDatabaseHandler *handler,
+					std::string &errMsg);
 			};
 		}//namespace graph
 	}//namespace manipulator
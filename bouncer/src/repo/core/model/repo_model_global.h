@@ -107,6 +107,7 @@
 #define REPO_COLLECTION_STASH_JSON      "stash.json_mpc"
 #define REPO_COLLECTION_STASH_UNITY     "stash.unity3d" // This collection is no longer used but may still exist in the database
 #define REPO_COLLECTION_STASH_BUNDLE    "stash.repobundles"
+#define REPO_COLLECTION_STASH_CLUSTERS  "stash.clusters"
 #define REPO_COLLECTION_EXT_REF         "ref"
 #define REPO_COLLECTION_SEQUENCE        "sequences"
 #define REPO_COLLECTION_TASK            "activities"
@@ -237,3 +238,4 @@
 #define REPO_FILTER_TAG_TRANSPARENT		"materialProperties.isTransparent"
 #define REPO_FILTER_TAG_TEXTURE_ID		"materialProperties.textureId"
 #define REPO_FILTER_TAG_NORMALS			"_blobRef.elements.normals"
+#define REPO_FILTER_TAG_ENCODED_NORMALS	"_blobRef.elements.encoded_normals"
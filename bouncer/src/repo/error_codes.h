@@ -97,3 +97,5 @@
 #define REPOERR_FILE_IFC_UNSUPPORTED_SCHEMA 39
 //The specified view was found, but it is not a 3D view
 #define REPOERR_VIEW_NOT_3D 40
+//A stage of the process would have exceeded the memory budget
+#define REPOERR_MEMORY_BUDGET_EXCEEDED 41
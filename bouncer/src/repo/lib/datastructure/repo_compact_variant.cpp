@@ -0,0 +1,256 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "repo_compact_variant.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+
+using namespace repo::lib;
+
+std::optional<RepoTimestamp> RepoTimestamp::fromTm(const tm& t)
+{
+	tm tmCpy = t; // Copy because mktime can alter the struct
+	auto time = mktime(&tmCpy);
+	if (time == -1) {
+		return std::nullopt;
+	}
+	return RepoTimestamp{ static_cast<int64_t>(time) * 1000 };
+}
+
+tm RepoTimestamp::toTm() const
+{
+	// Round towards negative infinity, so times before the epoch are not moved
+	// forward by a second
+
+	auto seconds = milliseconds / 1000;
+	if (milliseconds % 1000 < 0) {
+		seconds--;
+	}
+	time_t time = static_cast<time_t>(seconds);
+
+	tm buf = {};
+#ifdef _WIN32
+	gmtime_s(&buf, &time);
+#else
+	gmtime_r(&time, &buf);
+#endif
+	return buf;
+}
+
+namespace {
+	struct FromRepoVariantVisitor : public boost::static_visitor<RepoCompactVariant>
+	{
+		template<typename T>
+		RepoCompactVariant operator()(const T& v) const {
+			return RepoCompactVariant(v);
+		}
+
+		RepoCompactVariant operator()(const tm& t) const {
+			auto timestamp = RepoTimestamp::fromTm(t);
+			if (timestamp) {
+				return RepoCompactVariant(*timestamp);
+			}
+			return RepoCompactVariant();
+		}
+	};
+
+	template<typename T>
+	void appendInteger(std::string& out, T v)
+	{
+		char buffer[24];
+		auto result = std::to_chars(buffer, buffer + sizeof(buffer), v);
+		out.append(buffer, result.ptr);
+	}
+
+	void appendUUID(std::string& out, const RepoUUID& uuid)
+	{
+		// The same format as boost::uuids::to_string, without the temporary
+
+		static const char* hex = "0123456789abcdef";
+		const auto& id = uuid.getInternalID();
+		for (size_t i = 0; i < id.size(); i++) {
+			if (i == 4 || i == 6 || i == 8 || i == 10) {
+				out.push_back('-');
+			}
+			out.push_back(hex[id.data[i] >> 4]);
+			out.push_back(hex[id.data[i] & 0xF]);
+		}
+	}
+
+	void appendJsonString(std::string& out, const std::string& s)
+	{
+		static const char* hex = "0123456789abcdef";
+		out.push_back('"');
+		for (unsigned char c : s) {
+			switch (c) {
+			case '"':
+				out.append("\\\"");
+				break;
+			case '\\':
+				out.append("\\\\");
+				break;
+			case '\b':
+				out.append("\\b");
+				break;
+			case '\f':
+				out.append("\\f");
+				break;
+			case '\n':
+				out.append("\\n");
+				break;
+			case '\r':
+				out.append("\\r");
+				break;
+			case '\t':
+				out.append("\\t");
+				break;
+			default:
+				if (c < 0x20) {
+					out.append("\\u00");
+					out.push_back(hex[c >> 4]);
+					out.push_back(hex[c & 0xF]);
+				}
+				else {
+					out.push_back(c);
+				}
+			}
+		}
+		out.push_back('"');
+	}
+}
+
+RepoCompactVariant RepoCompactVariant::fromRepoVariant(const RepoVariant& v)
+{
+	return boost::apply_visitor(FromRepoVariantVisitor(), v);
+}
+
+RepoVariant RepoCompactVariant::toRepoVariant() const
+{
+	switch (value.index()) {
+	case 1:
+		return *std::get_if<bool>(&value);
+	case 2:
+		return *std::get_if<int>(&value);
+	case 3:
+		return *std::get_if<int64_t>(&value);
+	case 4:
+		return *std::get_if<double>(&value);
+	case 5:
+		return *std::get_if<std::string>(&value);
+	case 6:
+		return std::get_if<RepoTimestamp>(&value)->toTm();
+	case 7:
+		return *std::get_if<RepoUUID>(&value);
+	default:
+		return std::string();
+	}
+}
+
+void RepoCompactVariant::appendString(std::string& out) const
+{
+	switch (value.index()) {
+	case 1:
+		out.push_back(*std::get_if<bool>(&value) ? '1' : '0');
+		break;
+	case 2:
+		appendInteger(out, *std::get_if<int>(&value));
+		break;
+	case 3:
+		appendInteger(out, *std::get_if<int64_t>(&value));
+		break;
+	case 4:
+	{
+		// std::to_string formats doubles with %f, which can be up to 317
+		// characters for the largest values
+
+		char buffer[320];
+		auto n = snprintf(buffer, sizeof(buffer), "%f", *std::get_if<double>(&value));
+		if (n > 0) {
+			out.append(buffer, std::min<size_t>(n, sizeof(buffer) - 1));
+		}
+		break;
+	}
+	case 5:
+		out.append(*std::get_if<std::string>(&value));
+		break;
+	case 6:
+	{
+		auto t = std::get_if<RepoTimestamp>(&value)->toTm();
+		char buffer[80];
+		auto n = strftime(buffer, sizeof(buffer), "%d-%m-%Y %H-%M-%S", &t);
+		out.append(buffer, n);
+		break;
+	}
+	case 7:
+		appendUUID(out, *std::get_if<RepoUUID>(&value));
+		break;
+	default:
+		break;
+	}
+}
+
+std::string RepoCompactVariant::toString() const
+{
+	std::string s;
+	appendString(s);
+	return s;
+}
+
+void RepoCompactVariant::appendJson(std::string& out) const
+{
+	switch (value.index()) {
+	case 1:
+		out.append(*std::get_if<bool>(&value) ? "true" : "false");
+		break;
+	case 2:
+		appendInteger(out, *std::get_if<int>(&value));
+		break;
+	case 3:
+		appendInteger(out, *std::get_if<int64_t>(&value));
+		break;
+	case 4:
+	{
+		auto d = *std::get_if<double>(&value);
+		if (std::isfinite(d)) {
+			char buffer[32];
+			auto result = std::to_chars(buffer, buffer + sizeof(buffer), d);
+			out.append(buffer, result.ptr);
+		}
+		else {
+			out.append("null");
+		}
+		break;
+	}
+	case 5:
+		appendJsonString(out, *std::get_if<std::string>(&value));
+		break;
+	case 6:
+		appendInteger(out, std::get_if<RepoTimestamp>(&value)->milliseconds);
+		break;
+	case 7:
+		out.push_back('"');
+		appendUUID(out, *std::get_if<RepoUUID>(&value));
+		out.push_back('"');
+		break;
+	default:
+		out.append("null");
+		break;
+	}
+}
@@ -0,0 +1,136 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+* A compact alternative to RepoVariant for holding large numbers of metadata
+* values. It is built on std::variant, and stores dates as milliseconds since
+* the unix epoch, instead of a tm (which makes up most of the size of a
+* RepoVariant). Values can be read without exceptions, and written to BSON or
+* JSON without intermediate strings.
+*/
+
+#pragma once
+
+#include "repo/repo_bouncer_global.h"
+#include "repo_uuid.h"
+#include "repo_variant.h"
+
+#include <cstdint>
+#include <ctime>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <variant>
+
+namespace repo {
+	namespace lib {
+
+		struct REPO_API_EXPORT RepoTimestamp
+		{
+			int64_t milliseconds = 0; // Since the unix epoch (UTC)
+
+			/**
+			* Interprets the tm as local time, in the same way as RepoBSONBuilder
+			* does when writing a tm. Returns nothing if the tm cannot be converted.
+			*/
+			static std::optional<RepoTimestamp> fromTm(const tm& t);
+
+			/**
+			* Returns the time as a UTC tm, in the same way as RepoBSONElement::Tm
+			*/
+			tm toTm() const;
+
+			bool operator==(const RepoTimestamp& other) const = default;
+		};
+
+		class REPO_API_EXPORT RepoCompactVariant
+		{
+		public:
+			using Value = std::variant<std::monostate, bool, int, int64_t, double, std::string, RepoTimestamp, RepoUUID>;
+
+			RepoCompactVariant() = default;
+
+			template<typename T,
+				typename = std::enable_if_t<!std::is_same_v<std::decay_t<T>, RepoCompactVariant> && std::is_constructible_v<Value, T&&>>>
+			RepoCompactVariant(T&& v) : value(std::forward<T>(v))
+			{
+			}
+
+			/**
+			* Converts a RepoVariant. Dates that cannot be represented (see
+			* RepoTimestamp::fromTm) result in an empty variant.
+			*/
+			static RepoCompactVariant fromRepoVariant(const RepoVariant& v);
+
+			/**
+			* Converts back to a RepoVariant. Timestamps become UTC tms. Empty
+			* variants become empty strings.
+			*/
+			RepoVariant toRepoVariant() const;
+
+			bool isEmpty() const noexcept
+			{
+				return value.index() == 0;
+			}
+
+			size_t index() const noexcept
+			{
+				return value.index();
+			}
+
+			template<typename T>
+			bool holds() const noexcept
+			{
+				return std::holds_alternative<T>(value);
+			}
+
+			/**
+			* Returns a pointer to the value if it holds a T, or nullptr otherwise
+			*/
+			template<typename T>
+			const T* get() const noexcept
+			{
+				return std::get_if<T>(&value);
+			}
+
+			const Value& getValue() const noexcept
+			{
+				return value;
+			}
+
+			/**
+			* Appends the value, formatted in the same way as StringConversionVisitor,
+			* to the string. Empty variants append nothing.
+			*/
+			void appendString(std::string& out) const;
+
+			std::string toString() const;
+
+			/**
+			* Appends the value as a JSON value to the string. Timestamps are written
+			* as milliseconds since the epoch, empty variants and non-finite numbers
+			* as null.
+			*/
+			void appendJson(std::string& out) const;
+
+			bool operator==(const RepoCompactVariant& other) const = default;
+
+		private:
+			Value value;
+		};
+	}
+}
@@ -97,7 +97,10 @@ RepoUUID::RepoUUID(const std::string &stringRep)
 
 RepoUUID RepoUUID::createUUID()
 {
-	static boost::uuids::random_generator gen;
+	// The generator holds state, so each thread has its own, allowing nodes to
+	// be created from worker threads
+
+	thread_local boost::uuids::random_generator gen;
 	return RepoUUID(gen());
 }
 
@@ -35,6 +35,9 @@ namespace repo {
 
 			RepoUUID(const std::string &stringRep = defaultValue);
 
+			/**
+			* Creates a random (version 4) UUID. This is safe to call from any thread.
+			*/
 			static RepoUUID createUUID();
 
 			/**
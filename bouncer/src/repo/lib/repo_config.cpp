@@ -89,13 +89,15 @@ RepoConfig RepoConfig::fromFile(const std::string &filePath) {
 		auto dbConn = dbTree->get<std::string>("connectionString", "");
 		auto username = dbTree->get<std::string>("username", "");
 		auto password = dbTree->get<std::string>("password", "");
+		auto dbPath = dbTree->get<std::string>("path", "");
 
 		auto useHostAndPort = !dbAddr.empty() && dbPort > 0;
-		if (!useHostAndPort && dbConn.empty()) {
+		if (!useHostAndPort && dbConn.empty() && dbPath.empty()) {
 			throw RepoException("Database address and port not specified within configuration file.");
 		}
 
 		repo::lib::RepoConfig config = useHostAndPort ? RepoConfig(dbAddr, dbPort, username, password) : RepoConfig(dbConn, username, password);
+		config.dbConf.path = dbPath;
 
 		auto useAsDefault = jsonTree.get<std::string>("defaultStorage", "");
 
@@ -118,7 +120,7 @@ RepoConfig RepoConfig::fromFile(const std::string &filePath) {
 }
 
 bool RepoConfig::validate() const {
-	const bool validDBConn = !dbConf.connString.empty() || (!dbConf.addr.empty() && dbConf.port > 0);
+	const bool validDBConn = !dbConf.connString.empty() || (!dbConf.addr.empty() && dbConf.port > 0) || !dbConf.path.empty();
 	const bool dbOk = validDBConn && (dbConf.username.empty() == dbConf.password.empty());
 	const bool fsOk = !fsConf.configured || (!fsConf.dir.empty() && fsConf.nLevel >= 0);
 
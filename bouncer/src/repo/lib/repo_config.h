@@ -33,6 +33,7 @@ namespace repo {
 				std::string connString;
 				std::string username;
 				std::string password;
+				std::string path; // If set, collections are kept in this file by an in-process handler instead of a database server
 			};
 
 			struct fs_config_t {
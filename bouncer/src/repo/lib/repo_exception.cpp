@@ -105,4 +105,10 @@ RepoImporterUnavailable::RepoImporterUnavailable(const std::string& msg, int cod
 	: RepoException(msg)
 {
 	errorCode = code;
+}
+
+RepoMemoryBudgetException::RepoMemoryBudgetException(const std::string& msg)
+	: RepoException(msg)
+{
+	errorCode = REPOERR_MEMORY_BUDGET_EXCEEDED;
 }
\ No newline at end of file
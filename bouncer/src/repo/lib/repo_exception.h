@@ -75,6 +75,11 @@ namespace repo {
 			RepoImporterUnavailable(const std::string& message, int code);
 		};
 
+		REPO_API_EXPORT class RepoMemoryBudgetException : public RepoException {
+		public:
+			RepoMemoryBudgetException(const std::string& msg);
+		};
+
 		REPO_API_EXPORT class RepoBSONException : public RepoException {
 		public:
 			RepoBSONException(const std::string& msg);
@@ -0,0 +1,692 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "repo_image.h"
+#include "repo_exception.h"
+
+#include <boost/crc.hpp>
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+using namespace repo::lib;
+
+namespace {
+
+	const uint8_t PNG_SIGNATURE[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+
+	uint32_t readU32BE(const uint8_t* p)
+	{
+		return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+	}
+
+	uint32_t readU32LE(const uint8_t* p)
+	{
+		return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+	}
+
+	uint16_t readU16LE(const uint8_t* p)
+	{
+		return (uint16_t)(p[0] | (p[1] << 8));
+	}
+
+	void writeU32BE(std::vector<uint8_t>& out, uint32_t v)
+	{
+		out.push_back((uint8_t)(v >> 24));
+		out.push_back((uint8_t)(v >> 16));
+		out.push_back((uint8_t)(v >> 8));
+		out.push_back((uint8_t)v);
+	}
+
+	void checkSize(uint64_t width, uint64_t height, uint64_t channels)
+	{
+		// Guards against headers that would have us allocate absurd amounts of
+		// memory before finding out the file is corrupt
+
+		if (!width || !height || width * height * channels > (1ull << 30)) {
+			throw RepoException("Image dimensions are invalid");
+		}
+	}
+
+	uint8_t paeth(uint8_t a, uint8_t b, uint8_t c)
+	{
+		int p = (int)a + b - c;
+		int pa = std::abs(p - a);
+		int pb = std::abs(p - b);
+		int pc = std::abs(p - c);
+		if (pa <= pb && pa <= pc) {
+			return a;
+		}
+		else if (pb <= pc) {
+			return b;
+		}
+		return c;
+	}
+
+	std::optional<RepoImage> decodePNG(const std::vector<uint8_t>& file)
+	{
+		uint32_t width = 0, height = 0;
+		uint8_t bitDepth = 0, colourType = 0, interlace = 0;
+		std::vector<uint8_t> palette;
+		std::vector<uint8_t> paletteAlpha;
+		std::vector<uint8_t> idat;
+
+		size_t p = sizeof(PNG_SIGNATURE);
+		while (p + 12 <= file.size()) {
+			auto length = readU32BE(&file[p]);
+			std::string type((const char*)&file[p + 4], 4);
+			if (p + 12 + (size_t)length > file.size()) {
+				throw RepoException("PNG chunk " + type + " is truncated");
+			}
+			auto data = &file[p + 8];
+			if (type == "IHDR" && length >= 13) {
+				width = readU32BE(data);
+				height = readU32BE(data + 4);
+				bitDepth = data[8];
+				colourType = data[9];
+				interlace = data[12];
+			}
+			else if (type == "PLTE") {
+				palette.assign(data, data + length);
+			}
+			else if (type == "tRNS") {
+				paletteAlpha.assign(data, data + length);
+			}
+			else if (type == "IDAT") {
+				idat.insert(idat.end(), data, data + length);
+			}
+			else if (type == "IEND") {
+				break;
+			}
+			p += 12 + (size_t)length;
+		}
+
+		uint8_t fileChannels;
+		switch (colourType) {
+		case 0: fileChannels = 1; break;
+		case 2: fileChannels = 3; break;
+		case 3: fileChannels = 1; break;
+		case 4: fileChannels = 2; break;
+		case 6: fileChannels = 4; break;
+		default:
+			throw RepoException("PNG has an invalid colour type");
+		}
+
+		bool validDepth = bitDepth == 8 || (bitDepth == 16 && colourType != 3) || ((bitDepth == 1 || bitDepth == 2 || bitDepth == 4) && (colourType == 0 || colourType == 3));
+		if (!validDepth) {
+			throw RepoException("PNG has an invalid bit depth");
+		}
+
+		// Interlaced images are rare for textures, so are left as they are
+
+		if (interlace) {
+			return {};
+		}
+
+		checkSize(width, height, 4);
+
+		size_t rowBytes = ((size_t)width * fileChannels * bitDepth + 7) / 8;
+		size_t bpp = std::max<size_t>(1, fileChannels * bitDepth / 8);
+		size_t expected = (rowBytes + 1) * height;
+
+		std::vector<uint8_t> raw(expected);
+		try {
+			boost::iostreams::filtering_istream in;
+			in.push(boost::iostreams::zlib_decompressor());
+			in.push(boost::iostreams::array_source((const char*)idat.data(), idat.size()));
+			in.read((char*)raw.data(), expected);
+			if ((size_t)in.gcount() != expected) {
+				throw RepoException("PNG image data is truncated");
+			}
+		}
+		catch (const boost::iostreams::zlib_error& e) {
+			throw RepoException(std::string("PNG image data is corrupt: ") + e.what());
+		}
+
+		// Undo the filter of each row in place. The filtered rows are preceded by
+		// their filter type byte.
+
+		std::vector<uint8_t> previous(rowBytes, 0);
+		for (size_t y = 0; y < height; y++) {
+			auto filter = raw[y * (rowBytes + 1)];
+			auto row = &raw[y * (rowBytes + 1) + 1];
+			for (size_t i = 0; i < rowBytes; i++) {
+				uint8_t a = i >= bpp ? row[i - bpp] : 0;
+				uint8_t b = previous[i];
+				uint8_t c = i >= bpp ? previous[i - bpp] : 0;
+				switch (filter) {
+				case 0: break;
+				case 1: row[i] += a; break;
+				case 2: row[i] += b; break;
+				case 3: row[i] += (uint8_t)(((int)a + b) / 2); break;
+				case 4: row[i] += paeth(a, b, c); break;
+				default:
+					throw RepoException("PNG row has an invalid filter type");
+				}
+			}
+			std::memcpy(previous.data(), row, rowBytes);
+		}
+
+		// Convert to 8 bits per channel, expanding palettes
+
+		uint8_t channels = fileChannels;
+		if (colourType == 3) {
+			channels = paletteAlpha.size() ? 4 : 3;
+		}
+
+		RepoImage image(width, height, channels);
+		auto& pixels = image.getPixels();
+
+		for (size_t y = 0; y < height; y++) {
+			auto row = &raw[y * (rowBytes + 1) + 1];
+			auto out = &pixels[y * width * channels];
+			if (bitDepth == 8 && colourType != 3) {
+				std::memcpy(out, row, rowBytes);
+			}
+			else if (bitDepth == 16) {
+				for (size_t i = 0; i < (size_t)width * channels; i++) {
+					out[i] = row[i * 2];
+				}
+			}
+			else {
+				// Palettes or low bit depth greyscale
+				uint8_t mask = (uint8_t)((1 << bitDepth) - 1);
+				for (size_t x = 0; x < width; x++) {
+					auto bit = x * bitDepth;
+					uint8_t v = (row[bit / 8] >> (8 - bitDepth - (bit % 8))) & mask;
+					if (colourType == 3) {
+						if ((size_t)v * 3 + 2 >= palette.size()) {
+							throw RepoException("PNG palette index is out of range");
+						}
+						out[x * channels] = palette[v * 3];
+						out[x * channels + 1] = palette[v * 3 + 1];
+						out[x * channels + 2] = palette[v * 3 + 2];
+						if (channels == 4) {
+							out[x * channels + 3] = v < paletteAlpha.size() ? paletteAlpha[v] : 255;
+						}
+					}
+					else {
+						out[x] = (uint8_t)(v * 255 / mask);
+					}
+				}
+			}
+		}
+
+		return image;
+	}
+
+	std::optional<RepoImage> decodeBMP(const std::vector<uint8_t>& file)
+	{
+		if (file.size() < 54) {
+			throw RepoException("BMP header is truncated");
+		}
+
+		auto dataOffset = readU32LE(&file[10]);
+		auto headerSize = readU32LE(&file[14]);
+		int32_t width = (int32_t)readU32LE(&file[18]);
+		int32_t height = (int32_t)readU32LE(&file[22]);
+		auto bpp = readU16LE(&file[28]);
+		auto compression = readU32LE(&file[30]);
+		auto coloursUsed = readU32LE(&file[46]);
+
+		// Only uncompressed images are supported (BI_BITFIELDS is treated as
+		// the usual BGRA layout)
+
+		if ((compression != 0 && compression != 3) || (bpp != 8 && bpp != 24 && bpp != 32)) {
+			return {};
+		}
+
+		bool topDown = height < 0;
+		uint32_t w = (uint32_t)std::abs(width);
+		uint32_t h = (uint32_t)std::abs(height);
+		checkSize(w, h, 4);
+
+		size_t stride = (((size_t)bpp * w + 31) / 32) * 4;
+		if ((size_t)dataOffset + stride * h > file.size()) {
+			throw RepoException("BMP pixel data is truncated");
+		}
+
+		std::vector<uint8_t> palette;
+		if (bpp == 8) {
+			size_t count = coloursUsed ? coloursUsed : 256;
+			size_t start = 14 + (size_t)headerSize;
+			if (start + count * 4 > file.size()) {
+				throw RepoException("BMP palette is truncated");
+			}
+			palette.assign(file.begin() + start, file.begin() + start + count * 4);
+		}
+
+		// 32 bit images often leave the alpha channel as zero, in which case
+		// it is not really an alpha channel
+
+		bool hasAlpha = false;
+		if (bpp == 32) {
+			for (size_t y = 0; y < h && !hasAlpha; y++) {
+				auto row = &file[dataOffset + y * stride];
+				for (size_t x = 0; x < w; x++) {
+					if (row[x * 4 + 3]) {
+						hasAlpha = true;
+						break;
+					}
+				}
+			}
+		}
+
+		RepoImage image(w, h, hasAlpha ? 4 : 3);
+		auto& pixels = image.getPixels();
+		auto channels = image.getChannels();
+
+		for (size_t y = 0; y < h; y++) {
+			auto row = &file[dataOffset + (topDown ? y : h - 1 - y) * stride];
+			auto out = &pixels[y * w * channels];
+			for (size_t x = 0; x < w; x++) {
+				const uint8_t* bgr;
+				if (bpp == 8) {
+					if ((size_t)row[x] * 4 + 3 >= palette.size()) {
+						throw RepoException("BMP palette index is out of range");
+					}
+					bgr = &palette[row[x] * 4];
+				}
+				else {
+					bgr = &row[x * (bpp / 8)];
+				}
+				out[x * channels] = bgr[2];
+				out[x * channels + 1] = bgr[1];
+				out[x * channels + 2] = bgr[0];
+				if (hasAlpha) {
+					out[x * channels + 3] = bgr[3];
+				}
+			}
+		}
+
+		return image;
+	}
+
+	std::optional<RepoImage> decodeTGA(const std::vector<uint8_t>& file)
+	{
+		auto idLength = file[0];
+		auto colourMapType = file[1];
+		auto imageType = file[2];
+		uint32_t width = readU16LE(&file[12]);
+		uint32_t height = readU16LE(&file[14]);
+		auto depth = file[16];
+		auto descriptor = file[17];
+
+		bool grey = imageType == 3 || imageType == 11;
+		bool rle = imageType == 10 || imageType == 11;
+		bool valid = colourMapType == 0
+			&& (imageType == 2 || imageType == 3 || imageType == 10 || imageType == 11)
+			&& (grey ? depth == 8 : (depth == 24 || depth == 32))
+			&& width && height;
+		if (!valid) {
+			return {};
+		}
+
+		uint8_t bytesPerPixel = depth / 8;
+		uint8_t channels = grey ? 1 : bytesPerPixel;
+		checkSize(width, height, channels);
+
+		// Read the pixels in file order, then flip and swizzle them
+
+		size_t numPixels = (size_t)width * height;
+		std::vector<uint8_t> data(numPixels * bytesPerPixel);
+		size_t p = 18 + (size_t)idLength;
+		if (!rle) {
+			if (p + data.size() > file.size()) {
+				throw RepoException("TGA pixel data is truncated");
+			}
+			std::memcpy(data.data(), &file[p], data.size());
+		}
+		else {
+			size_t n = 0;
+			while (n < numPixels) {
+				if (p >= file.size()) {
+					throw RepoException("TGA pixel data is truncated");
+				}
+				auto header = file[p++];
+				size_t count = (header & 0x7F) + 1;
+				if (n + count > numPixels) {
+					throw RepoException("TGA run exceeds the image");
+				}
+				if (header & 0x80) {
+					if (p + bytesPerPixel > file.size()) {
+						throw RepoException("TGA pixel data is truncated");
+					}
+					for (size_t i = 0; i < count; i++) {
+						std::memcpy(&data[(n + i) * bytesPerPixel], &file[p], bytesPerPixel);
+					}
+					p += bytesPerPixel;
+				}
+				else {
+					if (p + count * bytesPerPixel > file.size()) {
+						throw RepoException("TGA pixel data is truncated");
+					}
+					std::memcpy(&data[n * bytesPerPixel], &file[p], count * bytesPerPixel);
+					p += count * bytesPerPixel;
+				}
+				n += count;
+			}
+		}
+
+		bool topDown = descriptor & 0x20;
+		bool rightToLeft = descriptor & 0x10;
+
+		RepoImage image(width, height, channels);
+		auto& pixels = image.getPixels();
+		for (size_t y = 0; y < height; y++) {
+			size_t sy = topDown ? y : height - 1 - y;
+			for (size_t x = 0; x < width; x++) {
+				size_t sx = rightToLeft ? width - 1 - x : x;
+				auto in = &data[(sy * width + sx) * bytesPerPixel];
+				auto out = &pixels[(y * width + x) * channels];
+				if (grey) {
+					out[0] = in[0];
+				}
+				else {
+					out[0] = in[2];
+					out[1] = in[1];
+					out[2] = in[0];
+					if (channels == 4) {
+						out[3] = in[3];
+					}
+				}
+			}
+		}
+
+		return image;
+	}
+
+	std::optional<RepoImage> decodePNM(const std::vector<uint8_t>& file)
+	{
+		uint8_t channels = file[1] == '6' ? 3 : 1;
+
+		// The header is three whitespace separated numbers, which may be
+		// interleaved with comments
+
+		size_t p = 2;
+		uint32_t values[3];
+		for (auto& v : values) {
+			while (p < file.size() && (std::isspace(file[p]) || file[p] == '#')) {
+				if (file[p] == '#') {
+					while (p < file.size() && file[p] != '\n') {
+						p++;
+					}
+				}
+				else {
+					p++;
+				}
+			}
+			if (p >= file.size() || !std::isdigit(file[p])) {
+				throw RepoException("PNM header is invalid");
+			}
+			uint64_t n = 0;
+			while (p < file.size() && std::isdigit(file[p])) {
+				n = n * 10 + (file[p++] - '0');
+				if (n > 0xFFFFFFFF) {
+					throw RepoException("PNM header is invalid");
+				}
+			}
+			v = (uint32_t)n;
+		}
+		p++; // The single whitespace character before the pixels
+
+		auto width = values[0];
+		auto height = values[1];
+		auto maxValue = values[2];
+		if (maxValue == 0 || maxValue > 255) {
+			return {};
+		}
+		checkSize(width, height, channels);
+
+		RepoImage image(width, height, channels);
+		auto& pixels = image.getPixels();
+		if (p + pixels.size() > file.size()) {
+			throw RepoException("PNM pixel data is truncated");
+		}
+		for (size_t i = 0; i < pixels.size(); i++) {
+			pixels[i] = (uint8_t)(file[p + i] * 255 / maxValue);
+		}
+
+		return image;
+	}
+
+	/*
+	* For resampling, the contribution of each input pixel to each output pixel
+	* along one axis
+	*/
+	struct Contribution
+	{
+		uint32_t first;
+		std::vector<float> weights;
+	};
+
+	std::vector<Contribution> getContributions(uint32_t from, uint32_t to)
+	{
+		std::vector<Contribution> contributions(to);
+		double scale = (double)from / to;
+		for (uint32_t i = 0; i < to; i++) {
+			double start = i * scale;
+			double end = std::min<double>(from, (i + 1) * scale);
+			auto first = (uint32_t)std::floor(start);
+			auto last = std::min<uint32_t>(from - 1, (uint32_t)std::ceil(end) - 1);
+			auto& c = contributions[i];
+			c.first = first;
+			double total = 0;
+			for (uint32_t j = first; j <= last; j++) {
+				double w = std::min<double>(end, j + 1) - std::max<double>(start, j);
+				c.weights.push_back((float)w);
+				total += w;
+			}
+			for (auto& w : c.weights) {
+				w = (float)(w / total);
+			}
+		}
+		return contributions;
+	}
+}
+
+RepoImage::RepoImage()
+	:width(0),
+	height(0),
+	channels(0)
+{
+}
+
+RepoImage::RepoImage(uint32_t width, uint32_t height, uint8_t channels)
+	:width(width),
+	height(height),
+	channels(channels),
+	pixels((size_t)width * height * channels)
+{
+}
+
+std::optional<RepoImage> RepoImage::decode(const std::vector<uint8_t>& file)
+{
+	if (file.size() >= sizeof(PNG_SIGNATURE) && std::memcmp(file.data(), PNG_SIGNATURE, sizeof(PNG_SIGNATURE)) == 0) {
+		return decodePNG(file);
+	}
+	if (file.size() >= 2 && file[0] == 'B' && file[1] == 'M') {
+		return decodeBMP(file);
+	}
+	if (file.size() >= 3 && file[0] == 'P' && (file[1] == '5' || file[1] == '6') && std::isspace(file[2])) {
+		return decodePNM(file);
+	}
+	if (file.size() >= 3 && file[0] == 0xFF && file[1] == 0xD8 && file[2] == 0xFF) {
+		return {}; // JPEG
+	}
+	if (file.size() >= 18) {
+		return decodeTGA(file); // TGA has no signature, so is tried last
+	}
+	return {};
+}
+
+std::vector<uint8_t> RepoImage::encodePNG(int compressionLevel) const
+{
+	static const uint8_t COLOUR_TYPES[5] = { 0, 0, 4, 2, 6 };
+
+	// Each row is filtered with whichever filter gives the smallest sum of
+	// absolute values, which is the heuristic recommended by the PNG
+	// specification
+
+	size_t rowBytes = (size_t)width * channels;
+	std::vector<uint8_t> filtered((rowBytes + 1) * height);
+	std::vector<uint8_t> candidate(rowBytes);
+	std::vector<uint8_t> best(rowBytes);
+	std::vector<uint8_t> zero(rowBytes, 0);
+
+	for (size_t y = 0; y < height; y++) {
+		auto row = &pixels[y * rowBytes];
+		auto previous = y ? &pixels[(y - 1) * rowBytes] : zero.data();
+		uint64_t bestSum = UINT64_MAX;
+		uint8_t bestFilter = 0;
+		for (uint8_t filter = 0; filter < 5; filter++) {
+			uint64_t sum = 0;
+			for (size_t i = 0; i < rowBytes; i++) {
+				uint8_t a = i >= channels ? row[i - channels] : 0;
+				uint8_t b = previous[i];
+				uint8_t c = i >= channels ? previous[i - channels] : 0;
+				uint8_t v = row[i];
+				switch (filter) {
+				case 1: v -= a; break;
+				case 2: v -= b; break;
+				case 3: v -= (uint8_t)(((int)a + b) / 2); break;
+				case 4: v -= paeth(a, b, c); break;
+				}
+				candidate[i] = v;
+				sum += std::abs((int8_t)v);
+			}
+			if (sum < bestSum) {
+				bestSum = sum;
+				bestFilter = filter;
+				std::swap(best, candidate);
+			}
+		}
+		filtered[y * (rowBytes + 1)] = bestFilter;
+		std::memcpy(&filtered[y * (rowBytes + 1) + 1], best.data(), rowBytes);
+	}
+
+	std::vector<char> compressed;
+	{
+		boost::iostreams::filtering_ostream out;
+		out.push(boost::iostreams::zlib_compressor(boost::iostreams::zlib_params(compressionLevel)));
+		out.push(boost::iostreams::back_inserter(compressed));
+		out.write((const char*)filtered.data(), filtered.size());
+	}
+
+	std::vector<uint8_t> file(PNG_SIGNATURE, PNG_SIGNATURE + sizeof(PNG_SIGNATURE));
+
+	auto writeChunk = [&](const char* type, const uint8_t* data, size_t length) {
+		writeU32BE(file, (uint32_t)length);
+		auto start = file.size();
+		file.insert(file.end(), type, type + 4);
+		file.insert(file.end(), data, data + length);
+		boost::crc_32_type crc;
+		crc.process_bytes(&file[start], length + 4);
+		writeU32BE(file, crc.checksum());
+	};
+
+	std::vector<uint8_t> header;
+	writeU32BE(header, width);
+	writeU32BE(header, height);
+	header.push_back(8);
+	header.push_back(COLOUR_TYPES[channels]);
+	header.push_back(0);
+	header.push_back(0);
+	header.push_back(0);
+
+	writeChunk("IHDR", header.data(), header.size());
+	writeChunk("IDAT", (const uint8_t*)compressed.data(), compressed.size());
+	writeChunk("IEND", nullptr, 0);
+
+	return file;
+}
+
+RepoImage RepoImage::resize(uint32_t width, uint32_t height) const
+{
+	if (width == this->width && height == this->height) {
+		return *this;
+	}
+
+	// Resampling is separable, so is done along the rows, then the columns
+
+	auto horizontal = getContributions(this->width, width);
+	auto vertical = getContributions(this->height, height);
+
+	std::vector<float> rows((size_t)width * this->height * channels);
+	for (size_t y = 0; y < this->height; y++) {
+		auto in = &pixels[y * this->width * channels];
+		auto out = &rows[y * width * channels];
+		for (size_t x = 0; x < width; x++) {
+			auto& c = horizontal[x];
+			for (size_t i = 0; i < c.weights.size(); i++) {
+				auto src = &in[(c.first + i) * channels];
+				for (size_t k = 0; k < channels; k++) {
+					out[x * channels + k] += src[k] * c.weights[i];
+				}
+			}
+		}
+	}
+
+	RepoImage image(width, height, channels);
+	std::vector<float> accumulator((size_t)width * channels);
+	for (size_t y = 0; y < height; y++) {
+		auto& c = vertical[y];
+		std::fill(accumulator.begin(), accumulator.end(), 0.0f);
+		for (size_t i = 0; i < c.weights.size(); i++) {
+			auto in = &rows[(c.first + i) * width * channels];
+			for (size_t k = 0; k < accumulator.size(); k++) {
+				accumulator[k] += in[k] * c.weights[i];
+			}
+		}
+		auto out = &image.pixels[y * width * channels];
+		for (size_t k = 0; k < accumulator.size(); k++) {
+			out[k] = (uint8_t)std::clamp(std::lround(accumulator[k]), 0l, 255l);
+		}
+	}
+
+	return image;
+}
+
+RepoImage RepoImage::fit(uint32_t maxDimension) const
+{
+	if (!maxDimension || (width <= maxDimension && height <= maxDimension)) {
+		return *this;
+	}
+	double scale = (double)maxDimension / std::max(width, height);
+	auto w = std::max<uint32_t>(1, (uint32_t)std::lround(width * scale));
+	auto h = std::max<uint32_t>(1, (uint32_t)std::lround(height * scale));
+	return resize(std::min(w, maxDimension), std::min(h, maxDimension));
+}
+
+std::vector<RepoImage> RepoImage::mipLevels() const
+{
+	std::vector<RepoImage> levels;
+	const RepoImage* previous = this;
+	while (previous->width > 1 || previous->height > 1) {
+		levels.push_back(previous->resize(std::max<uint32_t>(1, previous->width / 2), std::max<uint32_t>(1, previous->height / 2)));
+		previous = &levels.back();
+	}
+	return levels;
+}
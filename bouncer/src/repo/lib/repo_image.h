@@ -0,0 +1,114 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+* Decoding, resampling and encoding of 8-bit images, for processing textures
+* without any external image library. PNG, BMP, TGA and binary PPM/PGM files
+* can be decoded. Images are always encoded as PNG.
+*/
+
+#pragma once
+
+#include "repo/repo_bouncer_global.h"
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace repo {
+	namespace lib {
+
+		class REPO_API_EXPORT RepoImage
+		{
+		public:
+			RepoImage();
+
+			RepoImage(uint32_t width, uint32_t height, uint8_t channels);
+
+			/**
+			* Decodes an image file held in memory. Returns nothing if the format is
+			* not one that can be decoded (for example, JPEG). Throws a
+			* RepoException if the file is recognised but is corrupt.
+			*/
+			static std::optional<RepoImage> decode(const std::vector<uint8_t>& file);
+
+			/**
+			* Encodes the image as a PNG file. compressionLevel is the zlib level,
+			* from 1 (fastest) to 9 (smallest).
+			*/
+			std::vector<uint8_t> encodePNG(int compressionLevel = 6) const;
+
+			/**
+			* Returns the image resampled to the given size. Each output pixel is the
+			* area-weighted average of the input pixels it covers, so this is
+			* intended for reducing images.
+			*/
+			RepoImage resize(uint32_t width, uint32_t height) const;
+
+			/**
+			* Returns the image scaled down so neither dimension is over
+			* maxDimension, preserving the aspect ratio. If the image already fits,
+			* it is returned unchanged.
+			*/
+			RepoImage fit(uint32_t maxDimension) const;
+
+			/**
+			* Returns the chain of mip levels below this image, each half the size of
+			* the one before (rounding down, to a minimum of one), ending at 1x1.
+			*/
+			std::vector<RepoImage> mipLevels() const;
+
+			uint32_t getWidth() const
+			{
+				return width;
+			}
+
+			uint32_t getHeight() const
+			{
+				return height;
+			}
+
+			/*
+			* 1 (grey), 2 (grey and alpha), 3 (RGB) or 4 (RGBA)
+			*/
+			uint8_t getChannels() const
+			{
+				return channels;
+			}
+
+			/*
+			* The pixels, row by row from the top, with the channels of each pixel
+			* interleaved
+			*/
+			const std::vector<uint8_t>& getPixels() const
+			{
+				return pixels;
+			}
+
+			std::vector<uint8_t>& getPixels()
+			{
+				return pixels;
+			}
+
+		private:
+			uint32_t width;
+			uint32_t height;
+			uint8_t channels;
+			std::vector<uint8_t> pixels;
+		};
+	}
+}
@@ -0,0 +1,282 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "repo_memory_accounting.h"
+#include "repo_exception.h"
+
+#include <atomic>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+
+using namespace repo::lib;
+
+namespace {
+	struct State
+	{
+		std::atomic<size_t> budget{ 0 };
+		std::atomic<size_t> current{ 0 };
+		std::atomic<size_t> peak{ 0 };
+		std::array<std::atomic<size_t>, RepoMemoryAccounting::NUM_TAGS> tagCurrent{};
+		std::array<std::atomic<size_t>, RepoMemoryAccounting::NUM_TAGS> tagPeak{};
+		std::atomic<size_t> depth{ 0 };
+
+		std::mutex reportsMutex;
+		std::vector<RepoMemoryAccounting::StageReport> reports;
+	};
+
+	State& state()
+	{
+		static State s;
+		return s;
+	}
+
+	void updateMax(std::atomic<size_t>& max, size_t value)
+	{
+		auto previous = max.load(std::memory_order_relaxed);
+		while (previous < value && !max.compare_exchange_weak(previous, value, std::memory_order_relaxed)) {
+		}
+	}
+
+	std::string toMB(size_t bytes)
+	{
+		std::stringstream ss;
+		ss << std::fixed << std::setprecision(1) << bytes / (1024.0 * 1024.0) << "MB";
+		return ss.str();
+	}
+}
+
+const char* RepoMemoryAccounting::getTagName(Tag tag)
+{
+	switch (tag) {
+	case Tag::MESH:
+		return "mesh";
+	case Tag::BINARY:
+		return "binary";
+	case Tag::BLOB:
+		return "blob";
+	case Tag::JSON:
+		return "json";
+	case Tag::TEXTURE:
+		return "texture";
+	default:
+		return "unknown";
+	}
+}
+
+void RepoMemoryAccounting::setBudget(size_t bytes)
+{
+	state().budget = bytes;
+}
+
+size_t RepoMemoryAccounting::getBudget()
+{
+	return state().budget;
+}
+
+void RepoMemoryAccounting::allocate(Tag tag, size_t bytes)
+{
+	if (!bytes) {
+		return;
+	}
+
+	auto& s = state();
+	auto total = s.current.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+	auto budget = s.budget.load(std::memory_order_relaxed);
+	if (budget && total > budget) {
+		s.current.fetch_sub(bytes, std::memory_order_relaxed);
+		throw RepoMemoryBudgetException("Allocating " + toMB(bytes) + " of " + getTagName(tag) +
+			" data would exceed the memory budget of " + toMB(budget) + " (" + toMB(total - bytes) + " in use)");
+	}
+	updateMax(s.peak, total);
+
+	auto& t = s.tagCurrent[(size_t)tag];
+	updateMax(s.tagPeak[(size_t)tag], t.fetch_add(bytes, std::memory_order_relaxed) + bytes);
+}
+
+void RepoMemoryAccounting::release(Tag tag, size_t bytes)
+{
+	auto& s = state();
+	s.current.fetch_sub(bytes, std::memory_order_relaxed);
+	s.tagCurrent[(size_t)tag].fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+bool RepoMemoryAccounting::canAllocate(size_t bytes)
+{
+	auto budget = getBudget();
+	return !budget || getCurrent() + bytes <= budget;
+}
+
+size_t RepoMemoryAccounting::getCurrent()
+{
+	return state().current;
+}
+
+size_t RepoMemoryAccounting::getCurrent(Tag tag)
+{
+	return state().tagCurrent[(size_t)tag];
+}
+
+size_t RepoMemoryAccounting::getPeak()
+{
+	return state().peak;
+}
+
+size_t RepoMemoryAccounting::getPeak(Tag tag)
+{
+	return state().tagPeak[(size_t)tag];
+}
+
+std::vector<RepoMemoryAccounting::StageReport> RepoMemoryAccounting::getStageReports()
+{
+	auto& s = state();
+	std::lock_guard<std::mutex> lock(s.reportsMutex);
+	return s.reports;
+}
+
+std::string RepoMemoryAccounting::printReport()
+{
+	std::stringstream ss;
+	ss << "Peak tracked memory by stage:" << std::endl;
+	for (const auto& report : getStageReports()) {
+		ss << std::string(report.depth * 2, ' ') << report.name << ": " << toMB(report.peak);
+		for (size_t i = 0; i < NUM_TAGS; i++) {
+			ss << " " << getTagName((Tag)i) << " " << toMB(report.tagPeaks[i]);
+		}
+		ss << " (" << std::fixed << std::setprecision(2) << report.seconds << "s)" << std::endl;
+	}
+	ss << "Overall: " << toMB(getPeak());
+	if (getBudget()) {
+		ss << " of budget " << toMB(getBudget());
+	}
+	return ss.str();
+}
+
+void RepoMemoryAccounting::reset()
+{
+	auto& s = state();
+	s.current = 0;
+	s.peak = 0;
+	for (size_t i = 0; i < NUM_TAGS; i++) {
+		s.tagCurrent[i] = 0;
+		s.tagPeak[i] = 0;
+	}
+	std::lock_guard<std::mutex> lock(s.reportsMutex);
+	s.reports.clear();
+}
+
+RepoMemoryAccounting::Allocation::Allocation(Tag tag, size_t size) :
+	tag(tag),
+	size(0)
+{
+	resize(size);
+}
+
+RepoMemoryAccounting::Allocation::Allocation(const Allocation& other) :
+	tag(other.tag),
+	size(0)
+{
+	resize(other.size);
+}
+
+RepoMemoryAccounting::Allocation::Allocation(Allocation&& other) noexcept :
+	tag(other.tag),
+	size(other.size)
+{
+	other.size = 0;
+}
+
+RepoMemoryAccounting::Allocation::~Allocation()
+{
+	release(tag, size);
+}
+
+RepoMemoryAccounting::Allocation& RepoMemoryAccounting::Allocation::operator=(const Allocation& other)
+{
+	if (this != &other) {
+		if (tag == other.tag) {
+			resize(other.size);
+		}
+		else {
+			*this = Allocation(other);
+		}
+	}
+	return *this;
+}
+
+RepoMemoryAccounting::Allocation& RepoMemoryAccounting::Allocation::operator=(Allocation&& other) noexcept
+{
+	if (this != &other) {
+		release(tag, size);
+		tag = other.tag;
+		size = other.size;
+		other.size = 0;
+	}
+	return *this;
+}
+
+void RepoMemoryAccounting::Allocation::resize(size_t size)
+{
+	if (size == this->size) {
+		return;
+	}
+
+	if (size < this->size) {
+		release(tag, this->size - size);
+	}
+	else {
+		allocate(tag, size - this->size);
+	}
+	this->size = size;
+}
+
+RepoMemoryAccounting::Stage::Stage(const std::string& name) :
+	name(name),
+	start(std::chrono::steady_clock::now())
+{
+	auto& s = state();
+	outerPeak = s.peak.exchange(s.current);
+	for (size_t i = 0; i < NUM_TAGS; i++) {
+		outerTagPeaks[i] = s.tagPeak[i].exchange(s.tagCurrent[i]);
+	}
+	s.depth++;
+}
+
+RepoMemoryAccounting::Stage::~Stage()
+{
+	auto& s = state();
+	auto depth = --s.depth;
+
+	StageReport report;
+	report.name = name;
+	report.depth = depth;
+	report.peak = s.peak;
+	for (size_t i = 0; i < NUM_TAGS; i++) {
+		report.tagPeaks[i] = s.tagPeak[i];
+	}
+	report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	// The outer stage sees the peak of this one as part of its own
+
+	updateMax(s.peak, outerPeak);
+	for (size_t i = 0; i < NUM_TAGS; i++) {
+		updateMax(s.tagPeak[i], outerTagPeaks[i]);
+	}
+
+	std::lock_guard<std::mutex> lock(s.reportsMutex);
+	s.reports.push_back(report);
+}
@@ -0,0 +1,182 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+* Accounting of the large buffers held by the library (geometry, binaries,
+* blob files and json), so the peak memory of each stage of a process can be
+* reported, and optionally limited.
+*
+* Buffers are tracked by holding an Allocation alongside them, which is resized
+* whenever the buffer changes size. Stages are marked by RAII Stage objects,
+* which may be nested.
+*
+* Allocations are always counted, using relaxed atomics, so the report is
+* available whether or not a budget is set.
+*
+* With a budget, any Allocation that would take the total above it throws a
+* RepoMemoryBudgetException. Stages that can spill to disk should check
+* canAllocate() first, and spill instead. Releasing, moving and destroying an
+* Allocation never throw, but anything that grows one, including copies, may,
+* so buffers must not be created or grown inside OpenMP regions or noexcept
+* functions without catching the exception there.
+*/
+
+#pragma once
+
+#include "repo/repo_bouncer_global.h"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace repo {
+	namespace lib {
+
+		class REPO_API_EXPORT RepoMemoryAccounting
+		{
+		public:
+			enum class Tag
+			{
+				MESH,    // Geometry arrays of MeshNodes
+				BINARY,  // BinMappings of RepoBSONs
+				BLOB,    // Blob file buffers
+				JSON,    // Serialised json documents
+				TEXTURE, // Image data of textures, before and after processing
+				NUM_TAGS
+			};
+
+			static const size_t NUM_TAGS = (size_t)Tag::NUM_TAGS;
+
+			static const char* getTagName(Tag tag);
+
+			/*
+			* Sets the total size, in bytes, the tracked buffers may reach. Zero
+			* disables the budget (the default). The budget only decides whether
+			* allocate() throws, and what canAllocate() returns.
+			*/
+			static void setBudget(size_t bytes);
+
+			static size_t getBudget();
+
+			/*
+			* Adds to the counter of the tag, throwing RepoMemoryBudgetException if
+			* this would exceed the budget, in which case the counters are unchanged.
+			*/
+			static void allocate(Tag tag, size_t bytes);
+
+			static void release(Tag tag, size_t bytes);
+
+			/*
+			* True if the given number of bytes could be allocated without exceeding
+			* the budget.
+			*/
+			static bool canAllocate(size_t bytes);
+
+			static size_t getCurrent();
+
+			static size_t getCurrent(Tag tag);
+
+			/*
+			* The highest total since the process started, or since the innermost
+			* active Stage began.
+			*/
+			static size_t getPeak();
+
+			static size_t getPeak(Tag tag);
+
+			struct StageReport
+			{
+				std::string name;
+				size_t depth;
+				size_t peak;
+				std::array<size_t, NUM_TAGS> tagPeaks;
+				double seconds;
+			};
+
+			/*
+			* Returns the reports of all stages that have completed, in the order
+			* they completed.
+			*/
+			static std::vector<StageReport> getStageReports();
+
+			/*
+			* A human readable table of the stage reports and the overall peak
+			*/
+			static std::string printReport();
+
+			/*
+			* Clears all counters, peaks and reports. Only safe to call when no
+			* Allocations are alive, e.g. between tests.
+			*/
+			static void reset();
+
+			/*
+			* Counts a number of bytes against a tag for as long as it is alive.
+			* Copies count the same size again, as copying the owner of a buffer
+			* copies the buffer.
+			*/
+			class REPO_API_EXPORT Allocation
+			{
+			public:
+				Allocation(Tag tag, size_t size = 0);
+				Allocation(const Allocation& other);
+				Allocation(Allocation&& other) noexcept;
+				~Allocation();
+
+				Allocation& operator=(const Allocation& other);
+				Allocation& operator=(Allocation&& other) noexcept;
+
+				/*
+				* Changes the size counted. If this throws, the size is unchanged.
+				*/
+				void resize(size_t size);
+
+				size_t getSize() const
+				{
+					return size;
+				}
+
+			private:
+				Tag tag;
+				size_t size;
+			};
+
+			/*
+			* Marks a stage of the process. While the Stage is alive, the peak is
+			* measured from the total when it began. Stages should be created and
+			* destroyed on the same thread.
+			*/
+			class REPO_API_EXPORT Stage
+			{
+			public:
+				Stage(const std::string& name);
+				~Stage();
+
+				Stage(const Stage&) = delete;
+				Stage& operator=(const Stage&) = delete;
+
+			private:
+				std::string name;
+				size_t outerPeak;
+				std::array<size_t, NUM_TAGS> outerTagPeaks;
+				std::chrono::steady_clock::time_point start;
+			};
+		};
+	}
+}
@@ -0,0 +1,519 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "repo_mesh_codec.h"
+#include "repo_exception.h"
+
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+using namespace repo::lib;
+
+namespace {
+
+	enum class Encoding : uint8_t
+	{
+		FLOAT = 0,
+		GRID = 1,
+		OCTAHEDRAL = 2,
+		DELTA_VARINT = 3,
+	};
+
+	const uint8_t FLAG_DEFLATED = 0x1;
+
+	/*
+	* Every stream starts with this header. When the stream is deflated, the
+	* header remains uncompressed, and payloadSize is the size of the payload
+	* before compression.
+	*/
+	struct Header
+	{
+		Encoding encoding;
+		uint8_t flags;
+		uint8_t bits;
+		uint8_t reserved;
+		uint32_t count;
+		uint32_t payloadSize;
+	};
+
+	static_assert(sizeof(Header) == 12, "Header must be packed");
+
+	struct GridParams
+	{
+		double min[3];
+		double step;
+	};
+
+	void malformed()
+	{
+		throw RepoException("Malformed geometry stream");
+	}
+
+	class Reader
+	{
+	public:
+		Reader(const uint8_t* data, size_t size) : data(data), size(size), offset(0) {}
+
+		template<typename T>
+		T read()
+		{
+			T v;
+			if (offset + sizeof(T) > size) {
+				malformed();
+			}
+			memcpy(&v, data + offset, sizeof(T));
+			offset += sizeof(T);
+			return v;
+		}
+
+		const uint8_t* remaining(size_t& length) const
+		{
+			length = size - offset;
+			return data + offset;
+		}
+
+	private:
+		const uint8_t* data;
+		size_t size;
+		size_t offset;
+	};
+
+	template<typename T>
+	void write(std::vector<uint8_t>& out, const T& v)
+	{
+		auto p = reinterpret_cast<const uint8_t*>(&v);
+		out.insert(out.end(), p, p + sizeof(T));
+	}
+
+	// Groups the n'th bytes of each element together, which makes the slowly
+	// varying (high) bytes of numeric data considerably more compressible
+
+	std::vector<uint8_t> transpose(const std::vector<uint8_t>& in, size_t elementSize)
+	{
+		std::vector<uint8_t> out(in.size());
+		auto count = in.size() / elementSize;
+		for (size_t i = 0; i < count; i++) {
+			for (size_t b = 0; b < elementSize; b++) {
+				out[b * count + i] = in[i * elementSize + b];
+			}
+		}
+		return out;
+	}
+
+	std::vector<uint8_t> untranspose(const std::vector<uint8_t>& in, size_t elementSize)
+	{
+		std::vector<uint8_t> out(in.size());
+		auto count = in.size() / elementSize;
+		for (size_t i = 0; i < count; i++) {
+			for (size_t b = 0; b < elementSize; b++) {
+				out[i * elementSize + b] = in[b * count + i];
+			}
+		}
+		return out;
+	}
+
+	std::vector<uint8_t> deflate(const std::vector<uint8_t>& in)
+	{
+		std::vector<char> out;
+		{
+			boost::iostreams::filtering_ostream stream;
+			stream.push(boost::iostreams::zlib_compressor());
+			stream.push(boost::iostreams::back_inserter(out));
+			stream.write(reinterpret_cast<const char*>(in.data()), in.size());
+		}
+		return std::vector<uint8_t>(out.begin(), out.end());
+	}
+
+	std::vector<uint8_t> inflate(const uint8_t* data, size_t size, size_t expected)
+	{
+		// Deflate cannot do better than about 1032:1, so anything claiming more
+		// is corrupt, and shouldn't be allowed to allocate arbitrary memory
+
+		if (expected > (size + 1) * 1032) {
+			malformed();
+		}
+
+		std::vector<uint8_t> out(expected);
+		try {
+			boost::iostreams::filtering_istream stream;
+			stream.push(boost::iostreams::zlib_decompressor());
+			stream.push(boost::iostreams::array_source(reinterpret_cast<const char*>(data), size));
+			stream.read(reinterpret_cast<char*>(out.data()), expected);
+			if (stream.gcount() != (std::streamsize)expected) {
+				malformed();
+			}
+		}
+		catch (const boost::iostreams::zlib_error&) {
+			malformed();
+		}
+		return out;
+	}
+
+	/*
+	* Writes the header and payload, transposing and deflating the payload if
+	* requested
+	*/
+	std::vector<uint8_t> finish(
+		Header header,
+		const std::vector<uint8_t>& params,
+		const std::vector<uint8_t>& payload,
+		size_t elementSize,
+		bool compress)
+	{
+		header.payloadSize = payload.size();
+		header.flags = compress ? FLAG_DEFLATED : 0;
+
+		std::vector<uint8_t> out;
+		write(out, header);
+		out.insert(out.end(), params.begin(), params.end());
+		if (compress) {
+			auto deflated = deflate(elementSize > 1 ? transpose(payload, elementSize) : payload);
+			out.insert(out.end(), deflated.begin(), deflated.end());
+		}
+		else {
+			out.insert(out.end(), payload.begin(), payload.end());
+		}
+		return out;
+	}
+
+	/*
+	* Reads the payload following the header and params (already read from
+	* reader), undoing any compression
+	*/
+	std::vector<uint8_t> payload(const Header& header, const Reader& reader, size_t elementSize)
+	{
+		size_t length;
+		auto data = reader.remaining(length);
+		if (header.flags & FLAG_DEFLATED) {
+			auto inflated = inflate(data, length, header.payloadSize);
+			return elementSize > 1 ? untranspose(inflated, elementSize) : inflated;
+		}
+		if (length != header.payloadSize) {
+			malformed();
+		}
+		return std::vector<uint8_t>(data, data + length);
+	}
+
+	Header readHeader(Reader& reader, Encoding expected1, Encoding expected2)
+	{
+		auto header = reader.read<Header>();
+		if (header.encoding != expected1 && header.encoding != expected2) {
+			malformed();
+		}
+		return header;
+	}
+
+	template<typename T>
+	std::vector<uint8_t> asBytes(const std::vector<T>& v)
+	{
+		auto p = reinterpret_cast<const uint8_t*>(v.data());
+		return std::vector<uint8_t>(p, p + v.size() * sizeof(T));
+	}
+
+	template<typename T>
+	std::vector<T> fromBytes(const std::vector<uint8_t>& bytes, size_t count)
+	{
+		if (bytes.size() != count * sizeof(T)) {
+			malformed();
+		}
+		std::vector<T> v(count);
+		memcpy(v.data(), bytes.data(), bytes.size());
+		return v;
+	}
+
+	void writeVarint(std::vector<uint8_t>& out, uint64_t v)
+	{
+		while (v >= 0x80) {
+			out.push_back((uint8_t)(v | 0x80));
+			v >>= 7;
+		}
+		out.push_back((uint8_t)v);
+	}
+
+	uint64_t readVarint(const std::vector<uint8_t>& in, size_t& offset)
+	{
+		uint64_t v = 0;
+		for (int shift = 0; shift < 64; shift += 7) {
+			if (offset >= in.size()) {
+				malformed();
+			}
+			auto b = in[offset++];
+			v |= (uint64_t)(b & 0x7F) << shift;
+			if (!(b & 0x80)) {
+				return v;
+			}
+		}
+		malformed();
+		return 0;
+	}
+
+	uint64_t zigzag(int64_t v)
+	{
+		return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+	}
+
+	int64_t unzigzag(uint64_t v)
+	{
+		return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+	}
+
+	int16_t toSnorm16(float v)
+	{
+		return (int16_t)std::lround(std::clamp(v, -1.0f, 1.0f) * 32767.0f);
+	}
+
+	float fromSnorm16(int16_t v)
+	{
+		return std::max(v / 32767.0f, -1.0f);
+	}
+}
+
+std::vector<uint8_t> RepoMeshCodec::encodePositions(const std::vector<RepoVector3D>& positions, const Options& options)
+{
+	Header header = {};
+	header.count = positions.size();
+
+	if (options.positionBits <= 0 || !options.grid || !(options.grid->min().x <= options.grid->max().x)) {
+		header.encoding = Encoding::FLOAT;
+		return finish(header, {}, asBytes(positions), sizeof(float), options.compressStreams);
+	}
+
+	if (options.positionBits > 24) {
+		throw RepoException("Positions can be quantised to at most 24 bits");
+	}
+
+	header.encoding = Encoding::GRID;
+	header.bits = options.positionBits;
+
+	// The grid has the same spacing along every axis, with the longest side of
+	// the bounds divided into positionBits levels. As the origin and spacing do
+	// not depend on the mesh, any two meshes encoded with the same grid snap
+	// coincident vertices to the same point.
+
+	GridParams params;
+	auto size = options.grid->size();
+	auto longest = std::max({ size.x, size.y, size.z });
+	params.step = longest > 0 ? longest / ((1 << options.positionBits) - 1) : 1.0;
+	params.min[0] = options.grid->min().x;
+	params.min[1] = options.grid->min().y;
+	params.min[2] = options.grid->min().z;
+
+	// Each component is stored as its own plane, as the difference to the
+	// previous vertex, as neighbouring vertices tend to be close together. The
+	// grid only fixes the origin and spacing, so positions outside of the
+	// bounds are still stored correctly, if with larger differences.
+
+	std::vector<uint8_t> encoded;
+	encoded.reserve(positions.size() * 3 * 2);
+	for (int c = 0; c < 3; c++) {
+		int64_t previous = 0;
+		for (size_t i = 0; i < positions.size(); i++) {
+			auto q = std::llround(((double)(&positions[i].x)[c] - params.min[c]) / params.step);
+			writeVarint(encoded, zigzag(q - previous));
+			previous = q;
+		}
+	}
+
+	std::vector<uint8_t> paramBytes;
+	write(paramBytes, params);
+
+	return finish(header, paramBytes, encoded, 1, options.compressStreams);
+}
+
+std::vector<RepoVector3D> RepoMeshCodec::decodePositions(const uint8_t* data, size_t size)
+{
+	Reader reader(data, size);
+	auto header = readHeader(reader, Encoding::FLOAT, Encoding::GRID);
+
+	if (header.encoding == Encoding::FLOAT) {
+		return fromBytes<RepoVector3D>(payload(header, reader, sizeof(float)), header.count);
+	}
+
+	if (header.bits < 1 || header.bits > 24) {
+		malformed();
+	}
+
+	auto params = reader.read<GridParams>();
+	auto encoded = payload(header, reader, 1);
+
+	// Every value takes at least one byte
+
+	if ((size_t)header.count * 3 > encoded.size()) {
+		malformed();
+	}
+
+	std::vector<RepoVector3D> positions(header.count);
+	size_t offset = 0;
+	for (int c = 0; c < 3; c++) {
+		int64_t q = 0;
+		for (size_t i = 0; i < positions.size(); i++) {
+			q += unzigzag(readVarint(encoded, offset));
+			(&positions[i].x)[c] = (float)(params.min[c] + q * params.step);
+		}
+	}
+
+	if (offset != encoded.size()) {
+		malformed();
+	}
+
+	return positions;
+}
+
+std::vector<uint8_t> RepoMeshCodec::encodeNormals(const std::vector<RepoVector3D>& normals, const Options& options)
+{
+	Header header = {};
+	header.count = normals.size();
+
+	if (!options.octahedralNormals) {
+		header.encoding = Encoding::FLOAT;
+		return finish(header, {}, asBytes(normals), sizeof(float), options.compressStreams);
+	}
+
+	header.encoding = Encoding::OCTAHEDRAL;
+
+	// Projects the normal onto the octahedron, and unfolds the lower half onto
+	// the square, giving two coordinates in [-1, 1]
+
+	std::vector<int16_t> encoded(normals.size() * 2);
+	for (size_t i = 0; i < normals.size(); i++) {
+		const auto& n = normals[i];
+		auto l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+		float x = 0, y = 0;
+		if (l1 > 0) {
+			x = n.x / l1;
+			y = n.y / l1;
+			if (n.z < 0) {
+				auto ox = x;
+				x = (1 - std::abs(y)) * (ox >= 0 ? 1 : -1);
+				y = (1 - std::abs(ox)) * (y >= 0 ? 1 : -1);
+			}
+		}
+		encoded[i * 2] = toSnorm16(x);
+		encoded[i * 2 + 1] = toSnorm16(y);
+	}
+
+	return finish(header, {}, asBytes(encoded), sizeof(int16_t), options.compressStreams);
+}
+
+std::vector<RepoVector3D> RepoMeshCodec::decodeNormals(const uint8_t* data, size_t size)
+{
+	Reader reader(data, size);
+	auto header = readHeader(reader, Encoding::FLOAT, Encoding::OCTAHEDRAL);
+
+	if (header.encoding == Encoding::FLOAT) {
+		return fromBytes<RepoVector3D>(payload(header, reader, sizeof(float)), header.count);
+	}
+
+	auto encoded = fromBytes<int16_t>(payload(header, reader, sizeof(int16_t)), (size_t)header.count * 2);
+
+	std::vector<RepoVector3D> normals(header.count);
+	for (size_t i = 0; i < normals.size(); i++) {
+		auto x = fromSnorm16(encoded[i * 2]);
+		auto y = fromSnorm16(encoded[i * 2 + 1]);
+		auto z = 1 - std::abs(x) - std::abs(y);
+		auto t = std::max(-z, 0.0f);
+		x += x >= 0 ? -t : t;
+		y += y >= 0 ? -t : t;
+		RepoVector3D n(x, y, z);
+		n.normalize();
+		normals[i] = n;
+	}
+
+	return normals;
+}
+
+std::vector<uint8_t> RepoMeshCodec::encodeFaces(const std::vector<uint32_t>& faces, const Options& options)
+{
+	Header header = {};
+	header.count = faces.size();
+	header.encoding = Encoding::DELTA_VARINT;
+
+	// The index counts are written as they are, and each index as the
+	// difference to the one before it, which for meshes with a reasonable
+	// vertex order is small
+
+	std::vector<uint8_t> encoded;
+	encoded.reserve(faces.size());
+	int64_t previous = 0;
+	size_t i = 0;
+	while (i < faces.size()) {
+		auto n = faces[i++];
+		writeVarint(encoded, n);
+		for (uint32_t j = 0; j < n && i < faces.size(); j++, i++) {
+			writeVarint(encoded, zigzag((int64_t)faces[i] - previous));
+			previous = faces[i];
+		}
+	}
+
+	return finish(header, {}, encoded, 1, options.compressStreams);
+}
+
+std::vector<uint32_t> RepoMeshCodec::decodeFaces(const uint8_t* data, size_t size)
+{
+	Reader reader(data, size);
+	auto header = readHeader(reader, Encoding::DELTA_VARINT, Encoding::DELTA_VARINT);
+	auto encoded = payload(header, reader, 1);
+
+	// Every value takes at least one byte
+
+	if (header.count > encoded.size()) {
+		malformed();
+	}
+
+	std::vector<uint32_t> faces;
+	faces.reserve(header.count);
+	int64_t previous = 0;
+	size_t offset = 0;
+	while (faces.size() < header.count) {
+		auto n = (uint32_t)readVarint(encoded, offset);
+		faces.push_back(n);
+		for (uint32_t j = 0; j < n && faces.size() < header.count; j++) {
+			previous += unzigzag(readVarint(encoded, offset));
+			faces.push_back((uint32_t)previous);
+		}
+	}
+
+	if (offset != encoded.size()) {
+		malformed();
+	}
+
+	return faces;
+}
+
+std::vector<uint8_t> RepoMeshCodec::encodeUVs(const std::vector<RepoVector2D>& uvs, const Options& options)
+{
+	// UVs may be outside of [0, 1] (e.g. tiled textures), so are kept as floats
+
+	Header header = {};
+	header.count = uvs.size();
+	header.encoding = Encoding::FLOAT;
+	return finish(header, {}, asBytes(uvs), sizeof(float), options.compressStreams);
+}
+
+std::vector<RepoVector2D> RepoMeshCodec::decodeUVs(const uint8_t* data, size_t size)
+{
+	Reader reader(data, size);
+	auto header = readHeader(reader, Encoding::FLOAT, Encoding::FLOAT);
+	return fromBytes<RepoVector2D>(payload(header, reader, sizeof(float)), header.count);
+}
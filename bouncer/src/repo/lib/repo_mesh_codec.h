@@ -0,0 +1,109 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+* Compact encodings for the geometry streams of mesh nodes.
+*
+* Positions can be quantised to a grid shared by all the meshes of a scene,
+* normals can be stored as two 16 bit octahedral coordinates, and face indices
+* are delta and variable length encoded. Each stream may then be
+* byte-transposed and deflated.
+*
+* Each encoded stream starts with a small header describing how it was
+* encoded, so streams can be decoded without any other information. The
+* VERSION is stored with the mesh, so meshes written without the codec (or by
+* a later version) can be told apart.
+*/
+
+#pragma once
+
+#include "repo/repo_bouncer_global.h"
+#include "repo/lib/datastructure/repo_vector.h"
+#include "repo/lib/datastructure/repo_bounds.h"
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace repo {
+	namespace lib {
+		class REPO_API_EXPORT RepoMeshCodec
+		{
+		public:
+			static constexpr int VERSION = 1;
+
+			struct Options
+			{
+				// Levels along the longest side of the grid, in bits (1 to 24). 0
+				// keeps the positions as floats.
+				int positionBits = 20;
+
+				// The bounds of the scene, in the same coordinates as the positions
+				// (i.e. less the world offset of the revision). Positions are
+				// quantised to a grid over these bounds, which is the same for every
+				// mesh of the scene, so vertices shared by neighbouring meshes stay
+				// together. Without a grid, positions are kept as floats.
+				std::optional<RepoBounds> grid;
+
+				bool octahedralNormals = true;
+
+				// Deflate each stream after encoding it
+				bool compressStreams = true;
+			};
+
+			static std::vector<uint8_t> encodePositions(const std::vector<RepoVector3D>& positions, const Options& options);
+
+			static std::vector<RepoVector3D> decodePositions(const uint8_t* data, size_t size);
+
+			static std::vector<uint8_t> encodeNormals(const std::vector<RepoVector3D>& normals, const Options& options);
+
+			static std::vector<RepoVector3D> decodeNormals(const uint8_t* data, size_t size);
+
+			/**
+			* Encodes faces in the API level 1 layout ([n1, v1, v2, ..., n2, v1,
+			* v2...]), as written by MeshNode
+			*/
+			static std::vector<uint8_t> encodeFaces(const std::vector<uint32_t>& faces, const Options& options);
+
+			static std::vector<uint32_t> decodeFaces(const uint8_t* data, size_t size);
+
+			static std::vector<uint8_t> encodeUVs(const std::vector<RepoVector2D>& uvs, const Options& options);
+
+			static std::vector<RepoVector2D> decodeUVs(const uint8_t* data, size_t size);
+
+			static std::vector<RepoVector3D> decodePositions(const std::vector<uint8_t>& data)
+			{
+				return decodePositions(data.data(), data.size());
+			}
+
+			static std::vector<RepoVector3D> decodeNormals(const std::vector<uint8_t>& data)
+			{
+				return decodeNormals(data.data(), data.size());
+			}
+
+			static std::vector<uint32_t> decodeFaces(const std::vector<uint8_t>& data)
+			{
+				return decodeFaces(data.data(), data.size());
+			}
+
+			static std::vector<RepoVector2D> decodeUVs(const std::vector<uint8_t>& data)
+			{
+				return decodeUVs(data.data(), data.size());
+			}
+		};
+	}
+}
@@ -0,0 +1,180 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+* SHA-256, as specified in FIPS 180-4
+*/
+
+#include "repo_sha256.h"
+#include "datastructure/repo_structs.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace repo::lib;
+
+static const uint32_t K[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static inline uint32_t rotr(uint32_t x, uint32_t n)
+{
+	return (x >> n) | (x << (32 - n));
+}
+
+RepoSHA256::RepoSHA256() :
+	state({ 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 }),
+	blockSize(0),
+	totalSize(0)
+{
+}
+
+void RepoSHA256::transform(const uint8_t* data)
+{
+	uint32_t w[64];
+	for (int i = 0; i < 16; i++) {
+		w[i] = (uint32_t)data[i * 4] << 24 | (uint32_t)data[i * 4 + 1] << 16 | (uint32_t)data[i * 4 + 2] << 8 | (uint32_t)data[i * 4 + 3];
+	}
+	for (int i = 16; i < 64; i++) {
+		auto s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+		auto s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+		w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+	}
+
+	auto a = state[0];
+	auto b = state[1];
+	auto c = state[2];
+	auto d = state[3];
+	auto e = state[4];
+	auto f = state[5];
+	auto g = state[6];
+	auto h = state[7];
+
+	for (int i = 0; i < 64; i++) {
+		auto S1 = rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25);
+		auto ch = (e & f) ^ (~e & g);
+		auto t1 = h + S1 + ch + K[i] + w[i];
+		auto S0 = rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22);
+		auto maj = (a & b) ^ (a & c) ^ (b & c);
+		auto t2 = S0 + maj;
+
+		h = g;
+		g = f;
+		f = e;
+		e = d + t1;
+		d = c;
+		c = b;
+		b = a;
+		a = t1 + t2;
+	}
+
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+	state[4] += e;
+	state[5] += f;
+	state[6] += g;
+	state[7] += h;
+}
+
+void RepoSHA256::update(const void* data, size_t length)
+{
+	auto bytes = (const uint8_t*)data;
+	totalSize += length;
+
+	// Fill any partial block first, then process whole blocks directly from the
+	// input, before keeping the remainder for the next call
+
+	if (blockSize) {
+		auto n = std::min(length, block.size() - blockSize);
+		memcpy(block.data() + blockSize, bytes, n);
+		blockSize += n;
+		bytes += n;
+		length -= n;
+		if (blockSize == block.size()) {
+			transform(block.data());
+			blockSize = 0;
+		}
+	}
+
+	while (length >= block.size()) {
+		transform(bytes);
+		bytes += block.size();
+		length -= block.size();
+	}
+
+	if (length) {
+		memcpy(block.data(), bytes, length);
+		blockSize = length;
+	}
+}
+
+void RepoSHA256::update(const std::string& s)
+{
+	uint64_t size = s.size();
+	update(&size, sizeof(size));
+	update(s.data(), s.size());
+}
+
+void RepoSHA256::update(const repo_material_t& material)
+{
+	for (auto& c : { material.ambient, material.diffuse, material.specular, material.emissive }) {
+		update(c.r);
+		update(c.g);
+		update(c.b);
+	}
+	update(material.opacity);
+	update(material.shininess);
+	update(material.shininessStrength);
+	update(material.lineWeight);
+	update(material.isWireframe);
+	update(material.isTwoSided);
+	update(material.texturePath);
+}
+
+std::string RepoSHA256::hexdigest()
+{
+	uint64_t bits = totalSize * 8;
+
+	uint8_t padding[72] = { 0x80 };
+	auto padLength = (blockSize < 56 ? 56 : 120) - blockSize;
+	update(padding, padLength);
+
+	uint8_t length[8];
+	for (int i = 0; i < 8; i++) {
+		length[i] = (uint8_t)(bits >> (56 - i * 8));
+	}
+	update(length, sizeof(length));
+
+	static const char* hex = "0123456789abcdef";
+	std::string digest;
+	digest.reserve(64);
+	for (auto v : state) {
+		for (int i = 28; i >= 0; i -= 4) {
+			digest.push_back(hex[(v >> i) & 0xF]);
+		}
+	}
+	return digest;
+}
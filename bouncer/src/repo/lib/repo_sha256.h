@@ -0,0 +1,83 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "repo/repo_bouncer_global.h"
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace repo {
+	namespace lib {
+
+		struct repo_material_t;
+
+		/*
+		* Incremental SHA-256 digest. Unlike the checksum() methods of the
+		* datastructures, the result is stable between processes and platforms, so
+		* can be stored and compared with the hashes of later revisions.
+		*/
+		class REPO_API_EXPORT RepoSHA256
+		{
+		public:
+			RepoSHA256();
+
+			void update(const void* data, size_t length);
+
+			void update(const std::string& s);
+
+			void update(const repo_material_t& material);
+
+			/*
+			* Hashes the memory of the vector directly, so T must be a plain data type
+			* without padding (e.g. RepoVector3D).
+			*/
+			template<typename T>
+			void update(const std::vector<T>& v)
+			{
+				static_assert(std::is_standard_layout<T>::value, "Only vectors of plain data types can be hashed directly");
+				uint64_t size = v.size();
+				update(&size, sizeof(size));
+				update(v.data(), v.size() * sizeof(T));
+			}
+
+			template<typename T>
+			typename std::enable_if<std::is_arithmetic<T>::value>::type update(T v)
+			{
+				update(&v, sizeof(v));
+			}
+
+			/*
+			* Completes the digest and returns it as a lowercase hex string. The object
+			* cannot be updated further after this is called.
+			*/
+			std::string hexdigest();
+
+		private:
+			std::array<uint32_t, 8> state;
+			std::array<uint8_t, 64> block;
+			size_t blockSize;
+			uint64_t totalSize;
+
+			void transform(const uint8_t* data);
+		};
+	}
+}
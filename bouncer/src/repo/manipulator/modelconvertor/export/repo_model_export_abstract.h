@@ -57,6 +57,58 @@ namespace repo{
 				*/
 				virtual void addSupermesh(repo::core::model::SupermeshNode* supermesh) = 0;
 
+				/**
+				* Returns true if the exporter can reference supermeshes exported by a
+				* previous revision (see addExistingSupermesh()). When false, the
+				* optimizer will neither look for nor record reusable supermeshes.
+				*/
+				virtual bool supportsExistingSupermeshes() const
+				{
+					return false;
+				}
+
+				/**
+				* Adds a supermesh exported by a previous revision to the ongoing export
+				* process, with a new mapping for the meshes of this revision. The geometry
+				* of the supermesh is identical to when it was first exported.
+				* This is only called if supportsExistingSupermeshes() returns true. If
+				* the supermesh cannot be referenced after all, return false, in which
+				* case it will be rebuilt and passed to addSupermesh().
+				* @param revId the revision the supermesh was originally exported with
+				* @param supermeshId the unique id of the supermesh
+				* @param mapping the mesh mapping for the current revision
+				* @return true if the supermesh was added
+				*/
+				virtual bool addExistingSupermesh(
+					const repo::lib::RepoUUID& revId,
+					const repo::lib::RepoUUID& supermeshId,
+					const std::vector<repo::lib::repo_mesh_mapping_t>& mapping)
+				{
+					return false;
+				}
+
+				/**
+				* Returns true if the exporter can store levels of detail (see
+				* addSupermeshLod()). When false, the optimizer will not build them.
+				*/
+				virtual bool supportsLods() const
+				{
+					return false;
+				}
+
+				/**
+				* Adds a simplified level of detail of a supermesh that has already been
+				* passed to addSupermesh(). The level, error and source supermesh are
+				* given by the node (see SupermeshNode::getLodLevel()). Supermeshes are
+				* not serialised, so exporters that need these must write them out
+				* themselves.
+				* This is only called if supportsLods() returns true.
+				* @param lod a pointer to the simplified supermesh
+				*/
+				virtual void addSupermeshLod(repo::core::model::SupermeshNode* lod)
+				{
+				}
+
 				/**
 				* Finalises the export by writing out the metadata and mapping information collected
 				* during the ongoing export process.
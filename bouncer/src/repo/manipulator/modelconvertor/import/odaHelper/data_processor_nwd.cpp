@@ -1020,6 +1020,9 @@ void DataProcessorNwd::process(OdNwDatabasePtr pNwDb)
 	RepoNwTraversalContext context;
 	context.sceneBuilder = this->builder;
 	context.sceneBuilder->setWorldOffset(bounds.min());
+	if (bounds.min().x <= bounds.max().x) {
+		context.sceneBuilder->setGeometryGrid(repo::lib::RepoBounds(repo::lib::RepoVector3D64(), bounds.max() - bounds.min()));
+	}
 	context.vectorizer = OdVectorizer::createObject(pNwDb);
 	context.parentNode = context.sceneBuilder->addNode(RepoBSONFactory::makeTransformationNode({}, "rootNode"));
 
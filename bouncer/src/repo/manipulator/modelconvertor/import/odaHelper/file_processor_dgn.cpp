@@ -35,6 +35,7 @@
 #include "data_processor_dgn.h"
 #include "vectorise_device_dgn.h"
 #include "helper_functions.h"
+#include "repo_ostream_buf.h"
 
 #include <DgLine.h>      // This file puts OdDgLine3d in the output file
 using namespace repo::manipulator::modelconvertor::odaHelper;
@@ -228,6 +229,9 @@ uint8_t FileProcessorDgn::readFile() {
 		pModel->getGeomExtents(vectorizedViewId, extModel);
 		if (collector) {
 			collector->setWorldOffset(toRepoVector(extModel.minPoint()));
+			if (extModel.isValidExtents()) {
+				collector->setGeometryGrid(repo::lib::RepoBounds(toRepoVector(extModel.minPoint()), toRepoVector(extModel.maxPoint())));
+			}
 		}
 
 		// Color with #255 always defines backround. The background of the active model must be considered in the device palette.
@@ -307,10 +311,17 @@ void FileProcessorDgn::importDrawing(OdDgDatabasePtr pDb, const ODCOLORREF* pPal
 	OdGsDevicePtr dev = pModule->createDevice();
 	if (!dev.isNull())
 	{
-		// This snippet sets the output of the device. Here is a memory stream
-		// but it may also be a file created with ::odrxSystemServices().
+		// This snippet sets the output of the device. This is either the
+		// collector's output stream, which the svg is written through as it is
+		// created, or a memory stream.
 
-		auto stream = OdMemoryStream::createNew();
+		OdStreamBufPtr stream;
+		if (drawingCollector->output) {
+			stream = RepoOStreamBuf::createObject(*drawingCollector->output);
+		}
+		else {
+			stream = OdMemoryStream::createNew();
+		}
 		dev->properties()->putAt("Output", stream.get());
 
 		// The Gi context exposes the database to the graphics system
@@ -368,12 +379,13 @@ void FileProcessorDgn::importDrawing(OdDgDatabasePtr pDb, const ODCOLORREF* pPal
 
 		pHelperDevice->update();
 
-		// Finally copy the contents of the stream to the collector's buffer
+		// If the svg was not streamed to the collector's output, copy the contents of
+		// the memory stream to its buffer
 
-		std::vector<uint8_t> buffer;
-		buffer.resize(stream->tell());
-		stream->seek(0, OdDb::FilerSeekType::kSeekFromStart);
-		stream->getBytes(buffer.data(), stream->length());
-		drawingCollector->data = buffer;
+		if (!drawingCollector->output) {
+			drawingCollector->data.resize(stream->tell());
+			stream->seek(0, OdDb::FilerSeekType::kSeekFromStart);
+			stream->getBytes(drawingCollector->data.data(), stream->length());
+		}
 	}
 }
\ No newline at end of file
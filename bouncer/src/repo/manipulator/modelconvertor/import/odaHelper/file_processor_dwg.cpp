@@ -35,6 +35,7 @@
 
 #include "data_processor_dwg.h"
 #include "helper_functions.h"
+#include "repo_ostream_buf.h"
 
 #include <DbObjectIterator.h>
 #include <DbBlockTable.h>
@@ -103,6 +104,9 @@ void FileProcessorDwg::importModel(OdDbDatabasePtr pDb)
 
 	collector.setUnits(determineModelUnits(pDb->getINSUNITS()));
 	collector.setWorldOffset(toRepoVector(pDb->getEXTMIN()));
+	if (pDb->getEXTMIN().x <= pDb->getEXTMAX().x) {
+		collector.setGeometryGrid(repo::lib::RepoBounds(toRepoVector(pDb->getEXTMIN()), toRepoVector(pDb->getEXTMAX())));
+	}
 
 	OdGiContextForDbDatabasePtr pDbGiContext = OdGiContextForDbDatabase::createObject();
 	pDbGiContext->setDatabase(pDb);
@@ -130,7 +134,16 @@ void FileProcessorDwg::importDrawing(OdDbDatabasePtr pDb)
 	OdGsDevicePtr dev = pModule->createDevice();
 	if (!dev.isNull())
 	{
-		auto stream = OdMemoryStream::createNew();
+		// Large drawings can produce SVGs of hundreds of MB, so if the collector
+		// has an output the exporter writes straight into it.
+
+		OdStreamBufPtr stream;
+		if (drawingCollector->output) {
+			stream = RepoOStreamBuf::createObject(*drawingCollector->output);
+		}
+		else {
+			stream = OdMemoryStream::createNew();
+		}
 		dev->properties()->putAt("Output", stream.get());
 
 		// The below follows the same logic as the Dgn Exporter, which itself
@@ -177,13 +190,14 @@ void FileProcessorDwg::importDrawing(OdDbDatabasePtr pDb)
 
 		pHelperDevice->update();
 
-		// And assign the contents to the collector's buffer
+		// If the svg was not streamed to the collector's output, copy the contents of
+		// the memory stream to its buffer
 
-		std::vector<uint8_t> buffer;
-		buffer.resize(stream->tell());
-		stream->seek(0, OdDb::FilerSeekType::kSeekFromStart);
-		stream->getBytes(buffer.data(), stream->length());
-		drawingCollector->data = buffer;
+		if (!drawingCollector->output) {
+			drawingCollector->data.resize(stream->tell());
+			stream->seek(0, OdDb::FilerSeekType::kSeekFromStart);
+			stream->getBytes(drawingCollector->data.data(), stream->length());
+		}
 	}
 }
 
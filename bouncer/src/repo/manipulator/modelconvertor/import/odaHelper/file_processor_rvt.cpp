@@ -471,6 +471,9 @@ uint8_t FileProcessorRvt::readFile()
 			auto bounds = getModelBounds(pView);
 			bounds.transformBy(modelToWorld);
 			repoSceneBuilder->setWorldOffset(toRepoVector(bounds.minPoint()));
+			if (bounds.isValidExtents()) {
+				repoSceneBuilder->setGeometryGrid(repo::lib::RepoBounds(repo::lib::RepoVector3D64(), toRepoVector(bounds.maxPoint()) - toRepoVector(bounds.minPoint())));
+			}
 
 			OdGiDefaultContextPtr pBimContext = pDbPE->createGiContext(pDb);
 			OdGsModulePtr pGsModule = ODRX_STATIC_MODULE_ENTRY_POINT(StubDeviceModuleRvt)(OD_T("StubDeviceModuleRvt"));
@@ -124,6 +124,15 @@ namespace repo {
 						sceneBuilder->setWorldOffset(offset);
 					}
 
+					/*
+					* Sets the scene bounds from the model extents, given in world space.
+					* This must be called after setWorldOffset.
+					*/
+					void setGeometryGrid(repo::lib::RepoBounds bounds) {
+						auto offset = sceneBuilder->getWorldOffset();
+						sceneBuilder->setGeometryGrid(repo::lib::RepoBounds(bounds.min() - offset, bounds.max() - offset));
+					}
+
 					void setMissingTextures() {
 						sceneBuilder->setMissingTextures();
 					}
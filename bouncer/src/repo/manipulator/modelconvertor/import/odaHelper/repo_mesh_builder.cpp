@@ -34,10 +34,11 @@ struct RepoMeshBuilder::mesh_data_t {
 	uint32_t format;
 };
 
-RepoMeshBuilder::RepoMeshBuilder(std::vector<repo::lib::RepoUUID> parents, const repo::lib::RepoVector3D64& offset, repo_material_t material)
+RepoMeshBuilder::RepoMeshBuilder(std::vector<repo::lib::RepoUUID> parents, const repo::lib::RepoVector3D64& offset, repo_material_t material, size_t maxVertices)
 	: parents(parents),
 	offset(offset),
-	material(material)
+	material(material),
+	maxVertices(maxVertices)
 {
 }
 
@@ -54,7 +55,7 @@ repo_material_t RepoMeshBuilder::getMaterial()
 RepoMeshBuilder::~RepoMeshBuilder()
 {
 	// extractMeshes *must* be called, because there is where the mesh data instances are deleted/cleaned up.
-	if (meshes.size()) {
+	if (meshes.size() || completedMeshes.size()) {
 		throw repo::lib::RepoGeometryProcessingException("RepoMeshBuilder destroyed with meshes that have not been extracted.");
 	}
 }
@@ -197,6 +198,16 @@ void RepoMeshBuilder::addFace(const face& bf)
 
 	auto meshData = startOrContinueMeshByFormat(bf.getFormat());
 
+	// Welding means a face may add fewer vertices than its size, but the budget is
+	// checked against the worst case so a mesh never exceeds it
+
+	if (meshData->vertexMap.vertices.size() + bf.getSize() > maxVertices && meshData->faces.size()) {
+		meshes.erase(meshData->format);
+		currentMesh = nullptr;
+		completedMeshes.push_back(completeMesh(meshData));
+		meshData = startOrContinueMeshByFormat(bf.getFormat());
+	}
+
 	repo_face_t face;
 	for (auto i = 0; i < bf.getSize(); ++i) {
 		auto v = bf.vertex(i) + offset;
@@ -232,61 +243,73 @@ void RepoMeshBuilder::addFace(const face& bf)
 
 void RepoMeshBuilder::extractMeshes(std::vector<MeshNode>& nodes)
 {
+	for (auto& node : completedMeshes) {
+		nodes.push_back(std::move(node));
+	}
+	completedMeshes.clear();
+
 	for (auto pair : meshes)
 	{
 		auto meshData = pair.second;
 
 		if (!meshData->vertexMap.vertices.size()) {
+			delete meshData;
 			continue;
 		}
 
-		if (meshData->vertexMap.uvs.size() && (meshData->vertexMap.uvs.size() != meshData->vertexMap.vertices.size()))
-		{
-			throw new repo::lib::RepoGeometryProcessingException("RepoMeshBuilder mesh_data_t vertices size does not match the uvs size");
-		}
+		nodes.push_back(completeMesh(meshData));
+	}
 
-		auto uvChannels = meshData->vertexMap.uvs.size() ?
-			std::vector<std::vector<repo::lib::RepoVector2D>>{meshData->vertexMap.uvs} :
-			std::vector<std::vector<repo::lib::RepoVector2D>>();
+	meshes.clear();
+	currentMesh = nullptr;
+}
 
-		std::vector<repo::lib::RepoVector3D> normals32;
+MeshNode RepoMeshBuilder::completeMesh(mesh_data_t* meshData)
+{
+	if (meshData->vertexMap.uvs.size() && (meshData->vertexMap.uvs.size() != meshData->vertexMap.vertices.size()))
+	{
+		throw new repo::lib::RepoGeometryProcessingException("RepoMeshBuilder mesh_data_t vertices size does not match the uvs size");
+	}
 
-		if (meshData->vertexMap.normals.size()) {
-			if ((meshData->vertexMap.normals.size() != meshData->vertexMap.vertices.size()))
-			{
-				throw new repo::lib::RepoGeometryProcessingException("RepoMeshBuilder mesh_data_t vertices size does not match the normals size, where normals are required.");
-			}
+	auto uvChannels = meshData->vertexMap.uvs.size() ?
+		std::vector<std::vector<repo::lib::RepoVector2D>>{meshData->vertexMap.uvs} :
+		std::vector<std::vector<repo::lib::RepoVector2D>>();
 
-			normals32.reserve(meshData->vertexMap.normals.size());
+	std::vector<repo::lib::RepoVector3D> normals32;
 
-			for (int i = 0; i < meshData->vertexMap.vertices.size(); ++i) {
-				auto& n = meshData->vertexMap.normals[i];
-				normals32.push_back({ (float)(n.x), (float)(n.y), (float)(n.z) });
-			}
+	if (meshData->vertexMap.normals.size()) {
+		if ((meshData->vertexMap.normals.size() != meshData->vertexMap.vertices.size()))
+		{
+			throw new repo::lib::RepoGeometryProcessingException("RepoMeshBuilder mesh_data_t vertices size does not match the normals size, where normals are required.");
 		}
 
-		std::vector<repo::lib::RepoVector3D> vertices32;
-		vertices32.reserve(meshData->vertexMap.vertices.size());
+		normals32.reserve(meshData->vertexMap.normals.size());
 
 		for (int i = 0; i < meshData->vertexMap.vertices.size(); ++i) {
-			auto& v = meshData->vertexMap.vertices[i];
-			vertices32.push_back({ (float)(v.x), (float)(v.y), (float)(v.z) });
+			auto& n = meshData->vertexMap.normals[i];
+			normals32.push_back({ (float)(n.x), (float)(n.y), (float)(n.z) });
 		}
+	}
 
-		auto meshNode = repo::core::model::RepoBSONFactory::makeMeshNode(
-			vertices32,
-			meshData->faces,
-			normals32,
-			meshData->boundingBox,
-			uvChannels,
-			{},
-			parents
-		);
-
-		delete meshData;
+	std::vector<repo::lib::RepoVector3D> vertices32;
+	vertices32.reserve(meshData->vertexMap.vertices.size());
 
-		nodes.push_back(meshNode);
+	for (int i = 0; i < meshData->vertexMap.vertices.size(); ++i) {
+		auto& v = meshData->vertexMap.vertices[i];
+		vertices32.push_back({ (float)(v.x), (float)(v.y), (float)(v.z) });
 	}
 
-	meshes.clear();
-}
\ No newline at end of file
+	auto meshNode = repo::core::model::RepoBSONFactory::makeMeshNode(
+		vertices32,
+		meshData->faces,
+		normals32,
+		meshData->boundingBox,
+		uvChannels,
+		{},
+		parents
+	);
+
+	delete meshData;
+
+	return meshNode;
+}
@@ -30,11 +30,17 @@ namespace repo {
 				* many meshes as there are different mesh formats (defined by the primitives).
 				* Meshes must be extracted before MeshBuilder goes out of scope, or an
 				* exception will be thrown.
+				* Vertices shared between faces are welded as the faces are added. When a
+				* mesh reaches maxVertices, it is completed and any further faces of that
+				* format start a new mesh, which bounds both the size of the nodes and the
+				* memory used for welding.
 				*/
 				class RepoMeshBuilder
 				{
 				public:
-					RepoMeshBuilder(std::vector<repo::lib::RepoUUID> parents, const repo::lib::RepoVector3D64& offset, repo::lib::repo_material_t material);
+					static const size_t DEFAULT_MAX_VERTICES = 1200000;
+
+					RepoMeshBuilder(std::vector<repo::lib::RepoUUID> parents, const repo::lib::RepoVector3D64& offset, repo::lib::repo_material_t material, size_t maxVertices = DEFAULT_MAX_VERTICES);
 
 					~RepoMeshBuilder();
 
@@ -87,12 +93,20 @@ namespace repo {
 					mesh_data_t* startOrContinueMeshByFormat(uint32_t format);
 					static uint32_t getMeshFormat(bool hasUvs, bool hasNormals, int faceSize);
 
+					// Converts the mesh to a MeshNode, and deletes the mesh data
+					repo::core::model::MeshNode completeMesh(mesh_data_t* meshData);
+
 					// This exists to cache the result of the last startOrContinueMeshByFormat
 					// call for performance reasons.
 					mesh_data_t* currentMesh = nullptr;
 
 					std::unordered_map<uint32_t, mesh_data_t*> meshes;
 
+					// Meshes that have reached maxVertices, waiting to be extracted
+					std::vector<repo::core::model::MeshNode> completedMeshes;
+
+					size_t maxVertices;
+
 					std::vector<repo::lib::RepoUUID> parents;
 
 					/*
@@ -0,0 +1,58 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "repo_ostream_buf.h"
+
+#include "repo/lib/repo_exception.h"
+
+using namespace repo::manipulator::modelconvertor::odaHelper;
+
+OdStreamBufPtr RepoOStreamBuf::createObject(std::ostream& stream)
+{
+	auto buf = OdRxObjectImpl<RepoOStreamBuf>::createObject();
+	buf->stream = &stream;
+	return buf;
+}
+
+OdUInt64 RepoOStreamBuf::tell()
+{
+	return written;
+}
+
+OdUInt64 RepoOStreamBuf::length()
+{
+	return written;
+}
+
+bool RepoOStreamBuf::isEof()
+{
+	return true;
+}
+
+void RepoOStreamBuf::putByte(OdUInt8 value)
+{
+	putBytes(&value, 1);
+}
+
+void RepoOStreamBuf::putBytes(const void* buffer, OdUInt32 numBytes)
+{
+	stream->write((const char*)buffer, numBytes);
+	if (!*stream) {
+		throw repo::lib::RepoException("Failed to write to output stream");
+	}
+	written += numBytes;
+}
@@ -0,0 +1,59 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <OdaCommon.h>
+#include <OdStreamBuf.h>
+#include <RxObjectImpl.h>
+
+#include <ostream>
+
+namespace repo {
+	namespace manipulator {
+		namespace modelconvertor {
+			namespace odaHelper {
+
+				/*
+				* Adapts a std::ostream to an OdStreamBuf, so that ODA devices, such as
+				* the SVG exporter, can write their output straight into it instead of
+				* into an OdMemoryStream. The stream is write-only and sequential; tell
+				* and length report the number of bytes written so far.
+				*/
+				class RepoOStreamBuf : public OdStreamBuf
+				{
+				public:
+					static OdStreamBufPtr createObject(std::ostream& stream);
+
+					OdUInt64 tell() override;
+					OdUInt64 length() override;
+					bool isEof() override;
+
+					void putByte(OdUInt8 value) override;
+					void putBytes(const void* buffer, OdUInt32 numBytes) override;
+
+				protected:
+					RepoOStreamBuf() : stream(nullptr), written(0) {}
+
+				private:
+					std::ostream* stream;
+					OdUInt64 written;
+				};
+			}
+		}
+	}
+}
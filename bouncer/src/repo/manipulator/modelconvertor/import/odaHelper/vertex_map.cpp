@@ -19,27 +19,72 @@
 
 using namespace repo::manipulator::modelconvertor::odaHelper;
 
+// Common constant used to get good hash scattering
+#define GOLDEN_RATIO 0x9e3779b9
+
+static void hashCombine(size_t& seed, float v)
+{
+	std::hash<float> hasher;
+	seed ^= hasher(v) + GOLDEN_RATIO + (seed << 6) + (seed >> 2);
+}
+
+bool VertexMap::Key::operator==(const Key& other) const
+{
+	return position.x == other.position.x && position.y == other.position.y && position.z == other.position.z &&
+		normal.x == other.normal.x && normal.y == other.normal.y && normal.z == other.normal.z &&
+		uv.x == other.uv.x && uv.y == other.uv.y;
+}
+
+size_t VertexMap::KeyHasher::operator()(const Key& key) const
+{
+	size_t hash = 0;
+	hashCombine(hash, key.position.x);
+	hashCombine(hash, key.position.y);
+	hashCombine(hash, key.position.z);
+	hashCombine(hash, key.normal.x);
+	hashCombine(hash, key.normal.y);
+	hashCombine(hash, key.normal.z);
+	hashCombine(hash, key.uv.x);
+	hashCombine(hash, key.uv.y);
+	return hash;
+}
+
+size_t VertexMap::find(const Key& key, bool& inserted)
+{
+	auto result = indices.try_emplace(key, vertices.size());
+	inserted = result.second;
+	return result.first->second;
+}
+
 size_t VertexMap::insert(const repo::lib::RepoVector3D64& position)
 {
-	auto idx = vertices.size();
-	vertices.push_back(position);
+	bool inserted;
+	auto idx = find({ position }, inserted);
+	if (inserted) {
+		vertices.push_back(position);
+	}
 	return idx;
 }
 
 size_t VertexMap::insert(const repo::lib::RepoVector3D64& position, const repo::lib::RepoVector3D64& normal)
 {
-	auto idx = vertices.size();
-	vertices.push_back(position);
-	normals.push_back(normal);
+	bool inserted;
+	auto idx = find({ position, normal }, inserted);
+	if (inserted) {
+		vertices.push_back(position);
+		normals.push_back(normal);
+	}
 	return idx;
 }
 
 size_t VertexMap::insert(const repo::lib::RepoVector3D64& position, const repo::lib::RepoVector3D64& normal, const repo::lib::RepoVector2D& uv)
 {
-	auto idx = vertices.size();
-	vertices.push_back(position);
-	normals.push_back(normal);
-	uvs.push_back(uv);
+	bool inserted;
+	auto idx = find({ position, normal, uv }, inserted);
+	if (inserted) {
+		vertices.push_back(position);
+		normals.push_back(normal);
+		uvs.push_back(uv);
+	}
 	return idx;
 }
-
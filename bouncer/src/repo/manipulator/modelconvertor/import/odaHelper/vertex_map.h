@@ -18,6 +18,7 @@
 #pragma once
 
 #include "repo/lib/datastructure/repo_vector.h"
+#include <unordered_map>
 #include <vector>
 
 namespace repo {
@@ -30,6 +31,12 @@ namespace repo {
 				 * do any error checking - the caller must make sure only one of its methods
 				 * is called for its entire lifetime or the attributes will become out of 
 				 * sync.
+				 *
+				 * Vertices are welded as they are inserted: if a vertex with the same
+				 * attributes has been inserted before, its index is returned instead of
+				 * adding another. Attributes are compared at the single precision they
+				 * will be stored at in the MeshNode, so this gives the same result as
+				 * MeshNode::removeDuplicateVertices.
 				 */
 				class VertexMap {
 				public:
@@ -40,6 +47,27 @@ namespace repo {
 					size_t insert(const repo::lib::RepoVector3D64& position);
 					size_t insert(const repo::lib::RepoVector3D64& position, const repo::lib::RepoVector3D64& normal);
 					size_t insert(const repo::lib::RepoVector3D64& position, const repo::lib::RepoVector3D64& normal, const repo::lib::RepoVector2D& uv);
+
+				private:
+					struct Key
+					{
+						repo::lib::RepoVector3D position;
+						repo::lib::RepoVector3D normal;
+						repo::lib::RepoVector2D uv;
+
+						bool operator==(const Key& other) const;
+					};
+
+					struct KeyHasher
+					{
+						size_t operator()(const Key& key) const;
+					};
+
+					// The map grows with the number of unique vertices, which is bounded by
+					// the owner cutting the mesh at its vertex budget
+					std::unordered_map<Key, size_t, KeyHasher> indices;
+
+					size_t find(const Key& key, bool& inserted);
 				};
 
 			}
@@ -0,0 +1,231 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "decoder.h"
+
+#include "repo/core/model/bson/repo_node_mesh.h"
+#include "repo/lib/repo_exception.h"
+#include "repo/lib/datastructure/repo_uuid.h"
+#include <repo_log.h>
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <stack>
+#include <thread>
+
+#include "parser.h"
+
+using namespace repo::manipulator::modelconvertor::repoHelper;
+
+// The size of the chunks the stream is copied to the temporary file in
+const static size_t PAYLOAD_CHUNK_SIZE = 4 * 1024 * 1024;
+
+Payload::Payload(std::istream& stream, size_t size, size_t maxMemory)
+	:length(size),
+	allocation(repo::lib::RepoMemoryAccounting::Tag::BINARY)
+{
+	if (size <= maxMemory && repo::lib::RepoMemoryAccounting::canAllocate(size))
+	{
+		allocation.resize(size);
+		memory.resize(size);
+		stream.read(memory.data(), size);
+		if ((size_t)stream.gcount() != size) {
+			throw repo::lib::RepoException("BIM data section is shorter than the ranges in its header");
+		}
+		return;
+	}
+
+	path = std::filesystem::temp_directory_path() / ("repo_payload_" + repo::lib::RepoUUID::createUUID().toString());
+	repoInfo << "Writing BIM data section of " << size << " bytes to " << path.string();
+
+	std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file) {
+		throw repo::lib::RepoException("Could not create payload file " + path.string());
+	}
+
+	std::vector<char> chunk(std::min(size, PAYLOAD_CHUNK_SIZE));
+	size_t remaining = size;
+	while (remaining) {
+		auto n = std::min(remaining, chunk.size());
+		stream.read(chunk.data(), n);
+		if ((size_t)stream.gcount() != n) {
+			throw repo::lib::RepoException("BIM data section is shorter than the ranges in its header");
+		}
+		file.write(chunk.data(), n);
+		remaining -= n;
+	}
+
+	if (!file) {
+		throw repo::lib::RepoException("Failed to write to payload file " + path.string());
+	}
+}
+
+Payload::~Payload()
+{
+	if (!path.empty()) {
+		std::error_code ec;
+		std::filesystem::remove(path, ec);
+	}
+}
+
+Payload::Reader::Reader(const Payload& payload)
+	:payload(payload)
+{
+	if (!payload.isInMemory()) {
+		file.open(payload.path, std::ios::in | std::ios::binary);
+		if (!file) {
+			throw repo::lib::RepoException("Could not open payload file " + payload.path.string());
+		}
+	}
+}
+
+const char* Payload::Reader::read(const Range& range)
+{
+	if (range.end > payload.size() || range.start > range.end) {
+		throw repo::lib::RepoException("Range is outside of the BIM data section");
+	}
+
+	if (payload.isInMemory()) {
+		return payload.memory.data() + range.start;
+	}
+
+	buffer.resize(range.size());
+	file.seekg(range.start);
+	file.read(buffer.data(), range.size());
+	if (!file) {
+		throw repo::lib::RepoException("Failed to read from payload file " + payload.path.string());
+	}
+	return buffer.data();
+}
+
+/*
+* A contiguous set of ranges being decoded by a set of threads. The threads
+* take the next range from a shared counter, so large and small blocks are
+* balanced between them.
+*/
+class PayloadDecoder::Batch
+{
+public:
+	Batch(const Payload& payload,
+		const std::vector<Range>& ranges,
+		size_t begin,
+		size_t end,
+		size_t numThreads,
+		const std::function<void(size_t, const char*)>& decode)
+		:begin(begin),
+		end(end),
+		next(begin),
+		failed(false)
+	{
+		numThreads = std::max<size_t>(1, std::min(numThreads, end - begin));
+		for (size_t t = 0; t < numThreads; t++) {
+			threads.emplace_back([this, &payload, &ranges, &decode]() {
+				try {
+					Payload::Reader reader(payload);
+					size_t i;
+					while (!failed && (i = next++) < this->end) {
+						decode(i, reader.read(ranges[i]));
+					}
+				}
+				catch (...) {
+					failed = true;
+					std::lock_guard<std::mutex> lock(mutex);
+					if (!error) {
+						error = std::current_exception();
+					}
+				}
+			});
+		}
+	}
+
+	~Batch()
+	{
+		join();
+	}
+
+	/*
+	* Waits for the threads to finish, and rethrows the first exception any of
+	* them encountered.
+	*/
+	void wait()
+	{
+		join();
+		if (error) {
+			std::rethrow_exception(error);
+		}
+	}
+
+	const size_t begin;
+	const size_t end;
+
+private:
+	std::vector<std::thread> threads;
+	std::atomic<size_t> next;
+	std::atomic<bool> failed;
+	std::mutex mutex;
+	std::exception_ptr error;
+
+	void join()
+	{
+		for (auto& t : threads) {
+			if (t.joinable()) {
+				t.join();
+			}
+		}
+	}
+};
+
+PayloadDecoder::PayloadDecoder(const Payload& payload, size_t numThreads, size_t maxBatchSize)
+	:payload(payload),
+	numThreads(numThreads ? numThreads : std::max(1u, std::thread::hardware_concurrency())),
+	maxBatchSize(maxBatchSize)
+{
+}
+
+void PayloadDecoder::run(
+	const std::vector<Range>& ranges,
+	std::function<void(size_t index, const char* data)> decode,
+	std::function<void(size_t index)> apply)
+{
+	auto startBatch = [&](size_t begin) -> std::unique_ptr<Batch> {
+		if (begin >= ranges.size()) {
+			return nullptr;
+		}
+		size_t end = begin;
+		size_t bytes = 0;
+		do {
+			bytes += ranges[end++].size();
+		} while (end < ranges.size() && bytes + ranges[end].size() <= maxBatchSize);
+		return std::make_unique<Batch>(payload, ranges, begin, end, numThreads, decode);
+	};
+
+	// The next batch is decoded while the current one is applied, so the
+	// workers are kept busy while this thread hands the results on
+
+	auto current = startBatch(0);
+	while (current) {
+		current->wait();
+		auto next = startBatch(current->end);
+		for (size_t i = current->begin; i < current->end; i++) {
+			apply(i);
+		}
+		current = std::move(next);
+	}
+}
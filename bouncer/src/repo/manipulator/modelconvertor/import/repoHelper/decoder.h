@@ -0,0 +1,135 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+* The decoding engine for the data section of .bim files.
+*
+* The data section is decompressed once into a Payload, which can be read at
+* random. The blocks referenced by the header (vertices, indices, textures,
+* etc) are then decoded on a pool of threads by a PayloadDecoder, which hands
+* the results back to the calling thread in a fixed order, so the scene
+* produced does not depend on the number of threads.
+*/
+
+#pragma once
+
+#include "repo/repo_bouncer_global.h"
+#include "repo/lib/repo_memory_accounting.h"
+
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <istream>
+#include <vector>
+
+namespace repo {
+	namespace manipulator {
+		namespace modelconvertor {
+			namespace repoHelper {
+
+				struct Range; // parser.h
+
+				class REPO_API_EXPORT Payload
+				{
+				public:
+					static const size_t DEFAULT_MAX_MEMORY = 512 * 1024 * 1024;
+
+					/**
+					* Reads size bytes from the (decompressing) stream. If size is over
+					* maxMemory, or holding it would exceed the memory budget, the bytes
+					* are written to a temporary file instead of being kept in memory.
+					*/
+					Payload(std::istream& stream, size_t size, size_t maxMemory = DEFAULT_MAX_MEMORY);
+					~Payload();
+
+					Payload(const Payload&) = delete;
+					Payload& operator=(const Payload&) = delete;
+
+					size_t size() const
+					{
+						return length;
+					}
+
+					bool isInMemory() const
+					{
+						return path.empty();
+					}
+
+					/*
+					* Reads ranges of a Payload. A Payload may be read by any number of
+					* threads at once, but each should have its own Reader.
+					*/
+					class REPO_API_EXPORT Reader
+					{
+					public:
+						Reader(const Payload& payload);
+
+						/**
+						* Returns a pointer to the bytes of the range. The pointer is valid
+						* until the next call to read.
+						*/
+						const char* read(const Range& range);
+
+					private:
+						const Payload& payload;
+						std::ifstream file;
+						std::vector<char> buffer;
+					};
+
+				private:
+					size_t length;
+					std::vector<char> memory;
+					repo::lib::RepoMemoryAccounting::Allocation allocation;
+					std::filesystem::path path;
+				};
+
+				class REPO_API_EXPORT PayloadDecoder
+				{
+				public:
+					static const size_t DEFAULT_MAX_BATCH_SIZE = 64 * 1024 * 1024;
+
+					/**
+					* @param numThreads threads to decode with (0 for the number of cores)
+					* @param maxBatchSize the number of bytes of the payload decoded by each
+					* batch. One batch is decoded while the previous one is applied, so this
+					* bounds the amount of decoded data held at once.
+					*/
+					PayloadDecoder(const Payload& payload, size_t numThreads = 0, size_t maxBatchSize = DEFAULT_MAX_BATCH_SIZE);
+
+					/**
+					* Calls decode for each range on the worker threads, then apply for each
+					* range on this thread, in the order of the ranges. decode must be safe
+					* to call concurrently for different indices. If a call to decode
+					* throws, the exception is rethrown from run, and no further ranges are
+					* applied.
+					*/
+					void run(
+						const std::vector<Range>& ranges,
+						std::function<void(size_t index, const char* data)> decode,
+						std::function<void(size_t index)> apply);
+
+				private:
+					const Payload& payload;
+					size_t numThreads;
+					size_t maxBatchSize;
+
+					class Batch;
+				};
+			}
+		}
+	}
+}
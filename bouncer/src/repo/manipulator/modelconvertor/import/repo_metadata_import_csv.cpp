@@ -17,66 +17,227 @@
 
 #include "repo_metadata_import_csv.h"
 #include <repo_log.h>
-#include <fstream>
+
+#include <boost/filesystem.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <thread>
 
 using namespace repo::manipulator::modelconvertor;
 
-MetadataImportCSV::MetadataImportCSV()
-{
+#define REPO_CSV_DEFAULT_BATCH_SIZE 10000
+#define REPO_CSV_DEFAULT_CHUNK_SIZE (4 * 1024 * 1024)
+
+namespace {
+
+	/*
+	* A record of the file, with its fields already converted
+	*/
+	struct Row
+	{
+		std::string name;
+		std::vector<repo::lib::RepoVariant> values;
+	};
+
+	/*
+	* Calls fn(i) for each i in [0, n), each on its own thread
+	*/
+	template<typename Fn>
+	void parallelFor(size_t n, Fn fn)
+	{
+		std::vector<std::thread> threads;
+		for (size_t i = 1; i < n; i++) {
+			threads.emplace_back(fn, i);
+		}
+		fn(0);
+		for (auto& t : threads) {
+			t.join();
+		}
+	}
+
+	/*
+	* Whether a position is inside a quoted field. Closing is the state after a
+	* quote inside a quoted field, which either ends the field or, if another
+	* quote follows, is an escaped quote.
+	*/
+	enum class QuoteState : uint8_t
+	{
+		Outside,
+		Inside,
+		Closing
+	};
+
+	/*
+	* Returns the state after the quote at p. Outside of a quoted field, a quote
+	* only opens one if it is the first character of the field (e.g. the inch
+	* mark in 12" is a literal). recordStart is a position known to begin a
+	* record, so p[-1] is only read for positions after it.
+	*/
+	QuoteState afterQuote(QuoteState state, const char* p, const char* recordStart, char delimiter)
+	{
+		switch (state) {
+		case QuoteState::Inside:
+			return QuoteState::Closing;
+		case QuoteState::Closing:
+			return QuoteState::Inside;
+		default:
+			if (p == recordStart || p[-1] == delimiter || p[-1] == '\n' || p[-1] == '\r') {
+				return QuoteState::Inside;
+			}
+			return QuoteState::Outside;
+		}
+	}
+
+	/*
+	* Returns the state at end for each possible state at p (indexed by
+	* QuoteState), so ranges can be scanned before the state they begin in is
+	* known. Only the quotes, and the character after each, can change it.
+	*/
+	std::array<QuoteState, 3> scanQuotes(const char* p, const char* end, const char* recordStart, char delimiter)
+	{
+		std::array<QuoteState, 3> states = { QuoteState::Outside, QuoteState::Inside, QuoteState::Closing };
+		while (p < end) {
+			auto q = std::find(p, end, '"');
+			if (q != p) {
+				for (auto& state : states) {
+					if (state == QuoteState::Closing) {
+						state = QuoteState::Outside;
+					}
+				}
+			}
+			if (q == end) {
+				break;
+			}
+			for (auto& state : states) {
+				state = afterQuote(state, q, recordStart, delimiter);
+			}
+			p = q + 1;
+		}
+		return states;
+	}
+
+	/*
+	* Returns the position after the first line ending that is outside quotes,
+	* at or after p, or end if there is none.
+	*/
+	const char* findRecordStart(const char* p, const char* end, QuoteState state, const char* recordStart, char delimiter)
+	{
+		for (; p < end; p++) {
+			if (*p == '"') {
+				state = afterQuote(state, p, recordStart, delimiter);
+			}
+			else if (state != QuoteState::Inside) {
+				if (*p == '\n') {
+					return p + 1;
+				}
+				state = QuoteState::Outside;
+			}
+		}
+		return end;
+	}
+
+	/*
+	* Splits the record starting at p into fields, and returns the position after
+	* its line ending. Quoted fields may contain the delimiter, line endings and
+	* doubled quotes. A quote that does not begin a field is kept as a literal.
+	* A line with no content returns no fields.
+	*/
+	const char* parseRecord(const char* p, const char* end, char delimiter, std::vector<std::string>& fields)
+	{
+		fields.clear();
+		std::string field;
+		bool inQuotes = false;
+		bool fieldStart = true;
+		bool empty = true;
+
+		while (p < end) {
+			char c = *p++;
+			if (inQuotes) {
+				if (c == '"') {
+					if (p < end && *p == '"') {
+						field.push_back('"');
+						p++;
+					}
+					else {
+						inQuotes = false;
+					}
+				}
+				else {
+					field.push_back(c);
+				}
+			}
+			else if (c == '"' && fieldStart) {
+				inQuotes = true;
+				fieldStart = false;
+				empty = false;
+			}
+			else if (c == delimiter) {
+				fields.push_back(std::move(field));
+				field.clear();
+				fieldStart = true;
+				empty = false;
+			}
+			else if (c == '\n' || c == '\r') {
+				if (c == '\r' && p < end && *p == '\n') {
+					p++;
+				}
+				break;
+			}
+			else {
+				field.push_back(c);
+				fieldStart = false;
+				empty = false;
+			}
+		}
+
+		if (!empty) {
+			fields.push_back(std::move(field));
+		}
+
+		return p;
+	}
 }
 
-MetadataImportCSV::~MetadataImportCSV()
+MetadataImportCSV::MetadataImportCSV() :
+	delimiter(','),
+	numThreads(0),
+	batchSize(REPO_CSV_DEFAULT_BATCH_SIZE),
+	chunkSize(REPO_CSV_DEFAULT_CHUNK_SIZE)
 {
 }
 
-std::istream& MetadataImportCSV::readLine(
-	std::istream &stream,
-	std::vector<std::string>& tokenizedLine)
+MetadataImportCSV::~MetadataImportCSV()
 {
-	tokenizedLine.clear();
-	std::string line;
-	getline(stream, line);
-	std::stringstream ss(line);
-	std::string field;
-	while (std::getline(ss, field, delimiter))
-		tokenizedLine.push_back(field);
-
-	//FIXME: remove trailing white spaces!
-	return stream;
 }
 
-std::vector<repo::lib::RepoVariant> repo::manipulator::modelconvertor::MetadataImportCSV::convertToVariants(std::vector<std::string> tokens)
+repo::lib::RepoVariant MetadataImportCSV::convertToVariant(const std::string& token)
 {
-	std::vector<repo::lib::RepoVariant> metaData;
-
-	for (auto& value : tokens) {
-		repo::lib::RepoVariant v;
+	// Guess-cast into the variant. from_chars does not accept a leading '+', so
+	// it is skipped here.
 
-		// Guess-cast into the variant
+	auto first = token.data();
+	auto last = token.data() + token.size();
+	if (token.size() > 1 && *first == '+' && first[1] != '-') {
+		first++;
+	}
 
-		//Check if it is a number, if it is, store it as a number
-		try {
-			v = boost::lexical_cast<int64_t>(value);
+	if (first != last) {
+		int64_t i;
+		auto result = std::from_chars(first, last, i);
+		if (result.ec == std::errc() && result.ptr == last) {
+			return i;
 		}
-		catch (boost::bad_lexical_cast&)
-		{
-			//not an int, try a double
 
-			try {
-				v = boost::lexical_cast<double>(value);
-			}
-			catch (boost::bad_lexical_cast&)
-			{
-				//not an int or float, store as string
-				v = value;
-			}
+		double d;
+		result = std::from_chars(first, last, d);
+		if (result.ec == std::errc() && result.ptr == last) {
+			return d;
 		}
-
-		// Store the variant
-		metaData.push_back(v);
 	}
 
-	return metaData;
+	return token;
 }
 
 repo::core::model::RepoNodeSet MetadataImportCSV::readMetadata(
@@ -85,30 +246,130 @@ repo::core::model::RepoNodeSet MetadataImportCSV::readMetadata(
 	const char               &delimiter)
 {
 	repo::core::model::RepoNodeSet metadata;
-	std::ifstream file(path);
+	readMetadata(path, headers, [&](std::vector<repo::core::model::MetadataNode>& nodes) {
+		for (auto& node : nodes) {
+			metadata.insert(new repo::core::model::MetadataNode(std::move(node)));
+		}
+	}, delimiter);
+	return metadata;
+}
 
+bool MetadataImportCSV::readMetadata(
+	const std::string        &path,
+	std::vector<std::string> &headers,
+	const std::function<void(std::vector<repo::core::model::MetadataNode>&)> &onBatch,
+	const char               &delimiter)
+{
 	setDelimiter(delimiter);
 
-	if (file.is_open())
+	boost::iostreams::mapped_file_source file;
+	try
 	{
-		std::vector<std::string> tokens;
-		while (file.good() && readLine(file, tokens))
-		{
-			if (headers.empty())
-				headers = tokens;
-			else if (!tokens.empty())
-			{
-				repo::core::model::MetadataNode meta =
-					repo::core::model::RepoBSONFactory::makeMetaDataNode(headers, convertToVariants(tokens), tokens[0]);
-				metadata.insert(new repo::core::model::MetadataNode(meta));
-			}
+		// Empty files cannot be mapped, but are valid (if pointless)
+		if (boost::filesystem::file_size(path) == 0) {
+			return true;
 		}
-		file.close();
+		file.open(path);
 	}
-	else
+	catch (const std::exception& e)
 	{
-		repoError << "Error opening file: " << path;
+		repoError << "Error opening file: " << path << " (" << e.what() << ")";
+		return false;
 	}
 
-	return metadata;
-}
\ No newline at end of file
+	const char* pos = file.data();
+	const char* end = file.data() + file.size();
+
+	// Skip the UTF-8 byte order mark, if present
+	if (file.size() >= 3 && std::equal(pos, pos + 3, "\xEF\xBB\xBF")) {
+		pos += 3;
+	}
+
+	std::vector<std::string> fields;
+	while (headers.empty() && pos < end) {
+		pos = parseRecord(pos, end, delimiter, fields);
+		headers = fields;
+	}
+
+	// The file is processed in windows of one chunk per thread. Each chunk is
+	// moved forward to the start of a record, which requires knowing whether it
+	// begins inside a quoted field. Each chunk is scanned in parallel for the
+	// state it would end in given each state it could begin in, then as the
+	// window starts at the start of a record, outside of any quotes, these are
+	// chained to give the state at the start of every chunk.
+
+	const size_t n = std::max<size_t>(1, numThreads ? numThreads : std::thread::hardware_concurrency());
+	std::vector<std::vector<Row>> rows(n);
+	std::vector<repo::core::model::MetadataNode> batch;
+
+	while (pos < end)
+	{
+		auto windowSize = std::min<size_t>(end - pos, n * chunkSize);
+
+		std::vector<const char*> bounds(n + 1);
+		for (size_t k = 0; k < n; k++) {
+			bounds[k] = pos + (windowSize * k) / n;
+		}
+		bounds[n] = pos + windowSize;
+
+		std::vector<std::array<QuoteState, 3>> transitions(n);
+		parallelFor(n, [&](size_t k) {
+			transitions[k] = scanQuotes(bounds[k], bounds[k + 1], pos, delimiter);
+		});
+
+		std::vector<QuoteState> states(n + 1);
+		states[0] = QuoteState::Outside;
+		for (size_t k = 0; k < n; k++) {
+			states[k + 1] = transitions[k][(size_t)states[k]];
+		}
+
+		// The last chunk may extend past the window, to complete the record the
+		// window boundary falls in.
+
+		std::vector<const char*> starts(n + 1);
+		starts[0] = pos;
+		parallelFor(n, [&](size_t k) {
+			starts[k + 1] = findRecordStart(bounds[k + 1], end, states[k + 1], pos, delimiter);
+		});
+
+		parallelFor(n, [&](size_t k) {
+			rows[k].clear();
+			std::vector<std::string> fields;
+			auto p = starts[k];
+			while (p < starts[k + 1]) {
+				p = parseRecord(p, starts[k + 1], delimiter, fields);
+				if (!fields.empty()) {
+					Row row;
+					row.name = fields[0];
+					row.values.reserve(fields.size());
+					for (const auto& field : fields) {
+						row.values.push_back(convertToVariant(field));
+					}
+					rows[k].push_back(std::move(row));
+				}
+			}
+		});
+
+		// The nodes are created on this thread, so the batches are filled in the
+		// order of the file
+
+		for (auto& chunk : rows) {
+			for (auto& row : chunk) {
+				batch.push_back(repo::core::model::RepoBSONFactory::makeMetaDataNode(headers, row.values, row.name));
+				if (batch.size() >= batchSize) {
+					onBatch(batch);
+					batch.clear();
+				}
+			}
+			chunk.clear();
+		}
+
+		pos = starts[n];
+	}
+
+	if (batch.size()) {
+		onBatch(batch);
+	}
+
+	return true;
+}
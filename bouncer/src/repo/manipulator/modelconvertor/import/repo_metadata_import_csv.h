@@ -22,7 +22,10 @@
 #pragma once
 
 #include "../../../core/model/bson/repo_bson_factory.h"
-#include "boost/lexical_cast.hpp"
+
+#include <functional>
+#include <string>
+#include <vector>
 
 namespace repo{
 	namespace manipulator{
@@ -51,22 +54,47 @@ namespace repo{
 					std::vector<std::string> &headers,
 					const char               &delimiter = ',');
 
+				/**
+				* Reads a csv file, passing the metadata to onBatch in batches of up to
+				* batchSize nodes, in the order of the rows in the file. The file is
+				* memory mapped and tokenised in parallel, a window of chunkSize bytes per
+				* thread at a time, so only the rows of one window are held in memory,
+				* regardless of the size of the file.
+				* @param filePath path to the file
+				* @param headers vector of headers names (if empty, take the first line as headers)
+				* @param onBatch called with each batch of nodes, on the calling thread
+				* @param delimiter symbol that separates the fields
+				* @return returns false if the file could not be read
+				*/
+				bool readMetadata(
+					const std::string        &filePath,
+					std::vector<std::string> &headers,
+					const std::function<void(std::vector<repo::core::model::MetadataNode>&)> &onBatch,
+					const char               &delimiter = ',');
+
 				//! Sets the delimiter
 				void setDelimiter(char delimiter) { this->delimiter = delimiter; }
 
-			private:
+				//! Sets the number of threads to tokenise with (0 for the number of cores)
+				void setNumThreads(size_t numThreads) { this->numThreads = numThreads; }
+
+				//! Sets the maximum number of nodes passed to each call of onBatch
+				void setBatchSize(size_t batchSize) { this->batchSize = batchSize; }
+
+				//! Sets the number of bytes each thread tokenises at a time
+				void setChunkSize(size_t chunkSize) { this->chunkSize = chunkSize; }
+
 				/**
-				* Reads a single line. Same as operator>> but with class members access.
-				* @param stream stream to read from
-				* @param tokenizedLine the returning results of the line read, tokenized by the delimiter
-				* @return returns the stream after the operation
+				* Guesses the type of a field: a whole number is stored as an integer,
+				* other numbers as doubles, and anything else as a string.
 				*/
-				std::istream& readLine(
-					std::istream             &stream,
-					std::vector<std::string> &tokenizedLine);
-				char delimiter;
+				static repo::lib::RepoVariant convertToVariant(const std::string& token);
 
-				std::vector<repo::lib::RepoVariant> convertToVariants(std::vector<std::string> tokens);
+			private:
+				char delimiter;
+				size_t numThreads;
+				size_t batchSize;
+				size_t chunkSize;
 			};
 		} //namespace modelconvertor
 	} //namespace manipulator
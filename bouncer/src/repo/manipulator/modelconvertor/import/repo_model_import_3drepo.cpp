@@ -35,8 +35,10 @@
 #include "repo/core/model/bson/repo_node_transformation.h"
 #include "repo/core/model/bson/repo_node_texture.h"
 #include "repo/error_codes.h"
+#include "repo/lib/repo_memory_accounting.h"
 #include <repo_log.h>
 #include "repoHelper/parser.h"
+#include "repoHelper/decoder.h"
 
 using namespace repo::core::model;
 using namespace repo::manipulator::modelconvertor;
@@ -66,11 +68,19 @@ struct View
 	{
 	}
 
-	size_t size()
+	size_t size() const
 	{
 		return end - begin;
 	}
 
+	Range range() const
+	{
+		Range r;
+		r.start = begin;
+		r.end = end;
+		return r;
+	}
+
 	virtual ~View() = default; // Required for the subclass destructors to be called and so to release the shared pointers.
 };
 
@@ -84,7 +94,7 @@ struct MeshAttributeView : public View
 		node(node)
 	{}
 
-	virtual std::vector<T> vector(char* data)
+	virtual std::vector<T> vector(const char* data) const
 	{
 		std::vector<T> vector;
 		vector.resize(size() / sizeof(T));
@@ -103,7 +113,7 @@ struct TransformedAttributeView : public MeshAttributeView<T>
 		matrix(matrix)
 	{}
 
-	std::vector<T> vector(char* data) override
+	std::vector<T> vector(const char* data) const override
 	{
 		auto vector = MeshAttributeView<T>::vector(data);
 		for (auto& v : vector) {
@@ -116,13 +126,16 @@ struct TransformedAttributeView : public MeshAttributeView<T>
 struct VerticesView : public TransformedAttributeView<repo::lib::RepoVector3D64>
 {
 	using TransformedAttributeView::TransformedAttributeView;
+
+	std::vector<repo::lib::RepoVector3D> vertices;
+	repo::lib::RepoBounds bounds;
 };
 
 struct NormalsView : public TransformedAttributeView<repo::lib::RepoVector3D>
 {
 	using TransformedAttributeView::TransformedAttributeView;
 
-	std::vector<repo::lib::RepoVector3D> vector(char* data) override
+	std::vector<repo::lib::RepoVector3D> vector(const char* data) const override
 	{
 		auto vector = TransformedAttributeView<repo::lib::RepoVector3D>::vector(data);
 		for (auto& v : vector) {
@@ -130,11 +143,15 @@ struct NormalsView : public TransformedAttributeView<repo::lib::RepoVector3D>
 		}
 		return vector;
 	}
+
+	std::vector<repo::lib::RepoVector3D> normals;
 };
 
 struct UvsView : public MeshAttributeView<repo::lib::RepoVector2D>
 {
 	using MeshAttributeView::MeshAttributeView;
+
+	std::vector<repo::lib::RepoVector2D> uvs;
 };
 
 struct TextureView : public View
@@ -146,6 +163,8 @@ struct TextureView : public View
 		record(record)
 	{
 	}
+
+	std::vector<char> bytes;
 };
 
 struct IndicesView : public MeshAttributeView<uint32_t>
@@ -156,6 +175,8 @@ struct IndicesView : public MeshAttributeView<uint32_t>
 		primitive(primitive)
 	{
 	}
+
+	std::vector<repo::lib::repo_face_t> faces;
 };
 
 /*
@@ -170,8 +191,8 @@ public:
 		const std::string& project,
 		const repo::lib::RepoUUID& revisionId) :
 		RepoSceneBuilder(handler, database, project, revisionId),
-		minBufferSize(0),
-		numMaterials(0)
+		numMaterials(0),
+		payloadSize(0)
 	{
 		createIndexes();
 	}
@@ -195,7 +216,7 @@ public:
 	std::unordered_map<repo::lib::RepoUUID, std::vector<std::shared_ptr<repo::core::model::MeshNode>>, repo::lib::RepoUUIDHasher> matToMeshNodes;	
 	size_t numMaterials;
 	std::vector<View*> dataMap;
-	size_t minBufferSize;
+	size_t payloadSize; // The extent of the data section referenced by the views
 	repo::lib::RepoVector3D64 offset; // Applied to the vertex data
 
 	/* 
@@ -338,9 +359,9 @@ public:
 	{
 		std::ranges::sort(dataMap, {}, &View::begin);
 
-		minBufferSize = 0;
+		payloadSize = 0;
 		for (auto view : dataMap) {
-			minBufferSize = std::max(minBufferSize, view->size());
+			payloadSize = std::max(payloadSize, view->end);
 		}
 
 		// Release all node references in the map for the material properties.
@@ -349,43 +370,73 @@ public:
 		matToMeshNodes.clear();
 	}
 
-	void readView(View* v, char* buffer)
+	/*
+	* Decodes the block of a view into the view itself. This does not touch the
+	* builder or the node, so may be called for different views concurrently.
+	*/
+	void decodeView(View* v, const char* data) const
 	{
 		if (auto view = dynamic_cast<VerticesView*>(v))
 		{
-			auto vertices64 = view->vector(buffer);
-			std::vector<repo::lib::RepoVector3D> vertices32(vertices64.size());
-			for (auto i = 0; i < vertices32.size(); i++) {
-				vertices32[i] = vertices64[i] - offset;
+			auto vertices64 = view->vector(data);
+			view->vertices.resize(vertices64.size());
+			for (auto i = 0; i < vertices64.size(); i++) {
+				view->vertices[i] = vertices64[i] - offset;
 			}
-			view->node->setVertices(vertices32, true);
 		}
 		else if (auto view = dynamic_cast<IndicesView*>(v))
 		{
-			auto indices = view->vector(buffer);
-			std::vector<repo::lib::repo_face_t> faces(indices.size() / (int)view->primitive);
+			auto indices = view->vector(data);
+			view->faces.resize(indices.size() / (int)view->primitive);
 			auto idx = 0;
-			for (auto& f : faces) {
+			for (auto& f : view->faces) {
 				for (auto i = 0; i < (int)view->primitive; i++) {
 					f.push_back(indices[idx++]);
 				}
 			}
-			view->node->setFaces(faces);
 		}
 		else if (auto view = dynamic_cast<NormalsView*>(v))
 		{
-			view->node->setNormals(view->vector(buffer));
+			view->normals = view->vector(data);
+		}
+		else if (auto view = dynamic_cast<UvsView*>(v))
+		{
+			view->uvs = view->vector(data);
+		}
+		else if (auto view = dynamic_cast<TextureView*>(v))
+		{
+			view->bytes.assign(data, data + view->size());
+		}
+	}
+
+	/*
+	* Moves the decoded data of a view into its node. This must be called on the
+	* importing thread, in the order of the data map.
+	*/
+	void applyView(View* v)
+	{
+		if (auto view = dynamic_cast<VerticesView*>(v))
+		{
+			view->node->setVertices(view->vertices, true);
+		}
+		else if (auto view = dynamic_cast<IndicesView*>(v))
+		{
+			view->node->setFaces(view->faces);
+		}
+		else if (auto view = dynamic_cast<NormalsView*>(v))
+		{
+			view->node->setNormals(view->normals);
 		}
 		else if (auto view = dynamic_cast<UvsView*>(v))
 		{
-			view->node->setUVChannel(0, view->vector(buffer));
+			view->node->setUVChannel(0, view->uvs);
 		}
 		else if (auto view = dynamic_cast<TextureView*>(v))
 		{
 			auto n = repo::core::model::RepoBSONFactory::makeTextureNode(
 				view->record.filename,
-				buffer,
-				view->size(),
+				view->bytes.data(),
+				view->bytes.size(),
 				view->record.width,
 				view->record.height,
 				{}
@@ -397,26 +448,29 @@ public:
 		}
 	}
 
-	void readData(std::istream* fin)
+	/*
+	* Decodes all the views in the data map and hands the results to the
+	* builder. Deleting each view once applied releases its reference to the
+	* node, so nodes are committed as soon as all their views are read.
+	*/
+	void readData(const Payload& payload, size_t numThreads)
 	{
-		auto buffer = new char[minBufferSize];
-
-		size_t position = 0;
-		for (auto view : dataMap)
-		{
-			auto skip = view->begin - position;
-			fin->ignore(skip);
-			position += skip;
-
-			fin->read(buffer, view->size());
-			position += view->size();
-
-			readView(view, buffer);
-
-			delete view;
+		std::vector<Range> ranges;
+		for (auto view : dataMap) {
+			ranges.push_back(view->range());
 		}
 
-		delete[] buffer;
+		PayloadDecoder decoder(payload, numThreads);
+		decoder.run(ranges,
+			[&](size_t i, const char* data) {
+				decodeView(dataMap[i], data);
+			},
+			[&](size_t i) {
+				applyView(dataMap[i]);
+				delete dataMap[i];
+				dataMap[i] = nullptr;
+			}
+		);
 
 		dataMap.clear();
 	}
@@ -426,29 +480,30 @@ public:
 	* changing the data map - this is used to get the scene bounds for BIM004
 	* and below, which are not set in the nodes.
 	*/
-	repo::lib::RepoBounds readBoundsFromData(std::istream* fin)
+	repo::lib::RepoBounds readBoundsFromData(const Payload& payload, size_t numThreads)
 	{
-		auto buffer = new char[minBufferSize];
-		repo::lib::RepoBounds bounds;
-
-		size_t position = 0;
-		for (auto v : dataMap)
-		{
+		std::vector<VerticesView*> views;
+		std::vector<Range> ranges;
+		for (auto v : dataMap) {
 			if (auto view = dynamic_cast<VerticesView*>(v)) {
-				auto skip = view->begin - position;
-				fin->ignore(skip);
-				position += skip;
+				views.push_back(view);
+				ranges.push_back(view->range());
+			}
+		}
 
-				fin->read(buffer, view->size());
-				position += view->size();
+		repo::lib::RepoBounds bounds;
 
-				for (auto& v : view->vector(buffer)) {
-					bounds.encapsulate(v);
+		PayloadDecoder decoder(payload, numThreads);
+		decoder.run(ranges,
+			[&](size_t i, const char* data) {
+				for (auto& v : views[i]->vector(data)) {
+					views[i]->bounds.encapsulate(v);
 				}
+			},
+			[&](size_t i) {
+				bounds.encapsulate(views[i]->bounds);
 			}
-		}
-
-		delete[] buffer;
+		);
 
 		return bounds;
 	}
@@ -466,6 +521,9 @@ public:
 	{
 		return RepoSceneBuilder::hasMissingTextures();
 	}
+
+	using RepoSceneBuilder::setGeometryCodec;
+	using RepoSceneBuilder::setGeometryGrid;
 };
 
 
@@ -526,53 +584,59 @@ repo::core::model::RepoScene* RepoModelImport::importModel(std::string filePath,
 			settings.getProjectName(),
 			settings.getRevisionId()
 		);
+		if (settings.shouldCompressGeometry()) {
+			builder->setGeometryCodec(repo::lib::RepoMeshCodec::Options());
+		}
 
 		repoInfo << "Reading Json header...";
 
 		// Stream in Json tree
 
-		char* jsonBuf = new char[file_meta.jsonSize + 1];
-		inbuf->read(jsonBuf, file_meta.jsonSize);
-		jsonBuf[file_meta.jsonSize] = '\0';
+		{
+			repo::lib::RepoMemoryAccounting::Allocation jsonAllocation(repo::lib::RepoMemoryAccounting::Tag::JSON, file_meta.jsonSize + 1);
+			std::vector<char> jsonBuf(file_meta.jsonSize + 1);
+			inbuf->read(jsonBuf.data(), file_meta.jsonSize);
+			jsonBuf[file_meta.jsonSize] = '\0';
 
-		TreeParser::ParseJson(jsonBuf, builder);
+			TreeParser::ParseJson(jsonBuf.data(), builder);
+		}
 
 		builder->prepareDataMap();
 		
+		// The data section is decompressed once, and the blocks referenced by
+		// the header are then decoded from it in parallel
+
+		repoInfo << "Reading data buffer...";
+
+		auto payload = std::make_unique<Payload>(*inbuf, builder->payloadSize);
+
+		delete inbuf;
+
+		size_t numThreads = std::max(0, settings.getNumThreads());
+
 		repoInfo << "Pre-processing scene bounds (BIM004 and below)...";
 
 		// Get offset
 
 		// In BIM004 and below, the bounds are not set, meaning we need to get
-		// them from the geometry directly. We do this by reading the data section
-		// once then resetting the stream.
+		// them from the geometry directly, before any of the vertices are
+		// written.
 
 		// For BIM005, we should introduce instancing, and along with that, the
 		// primary offset applied at the root node transform.
 		// https://github.com/3drepo/3D-Repo-Product-Team/issues/794
 
-		auto bounds = builder->readBoundsFromData(inbuf);
+		auto bounds = builder->readBoundsFromData(*payload, numThreads);
 		builder->offset = bounds.min();
+		if (bounds.min().x <= bounds.max().x) {
+			builder->setGeometryGrid(repo::lib::RepoBounds(bounds.min() - builder->offset, bounds.max() - builder->offset));
+		}
 
-		// Now reset the file stream for the actual data read
-
-		delete inbuf;
-
-		finCompressed.seekg(0, std::ios::beg);
-		
-		inbuf = new boost::iostreams::filtering_istream();
-		inbuf->push(boost::iostreams::gzip_decompressor());
-		inbuf->push(finCompressed);
-
-		inbuf->ignore(REPO_VERSION_LENGTH);
-		inbuf->ignore(metaSize);
-		inbuf->ignore(file_meta.jsonSize);
-
-		repoInfo << "Reading data buffer...";
+		repoInfo << "Decoding data buffer...";
 
-		builder->readData(inbuf);
+		builder->readData(*payload, numThreads);
 
-		delete inbuf;
+		payload.reset();
 
 		repoInfo << "Create scene";
 
@@ -31,6 +31,7 @@
 #include "repo/core/model/bson/repo_node_mesh.h"
 #include "repo/core/model/bson/repo_bson_factory.h"
 #include "repo/lib/repo_utils.h"
+#include "repo/manipulator/modelutility/repo_texture_processor.h"
 #include "repo/error_codes.h"
 #include "repo_model_import_config_default_values.h"
 
@@ -287,16 +288,11 @@ float AssimpModelImport::normaliseShininess(const float &rawValue) const {
 	return value;
 }
 
-repo::core::model::MaterialNode* AssimpModelImport::createMaterialRepoNode(
-	const aiMaterial *material,
-	const std::string &name,
-	const std::unordered_map<std::string, repo::core::model::RepoNode *> &nameToTexture)
+repo::lib::repo_material_t AssimpModelImport::createMaterial(const aiMaterial *material)
 {
-	repo::core::model::MaterialNode *materialNode = nullptr;
+	repo::lib::repo_material_t repo_material = repo::lib::repo_material_t::DefaultMaterial();
 
 	if (material) {
-		repo::lib::repo_material_t repo_material = repo::lib::repo_material_t::DefaultMaterial();
-
 		aiColor3D tempColor;
 		auto tempFloat = tempColor.b;
 
@@ -362,85 +358,90 @@ repo::core::model::MaterialNode* AssimpModelImport::createMaterialRepoNode(
 		else
 			repo_material.shininessStrength = std::numeric_limits<float>::quiet_NaN();
 
-		materialNode = new repo::core::model::MaterialNode(
-			repo::core::model::RepoBSONFactory::makeMaterialNode(repo_material, name));
-
 		//--------------------------------------------------------------------------
 		// Texture (one diffuse for the moment)
-		// Textures are uniquely referenced by their name
+		// Textures are uniquely referenced by their path. The texture nodes are
+		// created when the first mesh using the material is added.
 		aiString texPath; // contains a filename of a texture
-		/*repoTrace << " #None Texture:" << material->GetTextureCount(aiTextureType_NONE);
-		repoTrace << " #Diffuse Texture:" << material->GetTextureCount(aiTextureType_DIFFUSE);
-		repoTrace << " #Spec Texture:" << material->GetTextureCount(aiTextureType_SPECULAR);
-		repoTrace << " #Ambient Texture:" << material->GetTextureCount(aiTextureType_AMBIENT);
-		repoTrace << " #Emissive Texture:" << material->GetTextureCount(aiTextureType_EMISSIVE);
-		repoTrace << " #Height Texture:" << material->GetTextureCount(aiTextureType_HEIGHT);
-		repoTrace << " #Normal Texture:" << material->GetTextureCount(aiTextureType_NORMALS);
-		repoTrace << " #Shiniess Texture:" << material->GetTextureCount(aiTextureType_SHININESS);
-		repoTrace << " #Opac Texture:" << material->GetTextureCount(aiTextureType_OPACITY);
-		repoTrace << " #Disp Texture:" << material->GetTextureCount(aiTextureType_DISPLACEMENT);
-		repoTrace << " #LightM Texture:" << material->GetTextureCount(aiTextureType_LIGHTMAP);
-		repoTrace << " #Reflection Texture:" << material->GetTextureCount(aiTextureType_REFLECTION);
-		repoTrace << " #Unknown Texture:" << material->GetTextureCount(aiTextureType_UNKNOWN);
-		*/
-
 		if (AI_SUCCESS == material->GetTexture(aiTextureType_DIFFUSE, 0, &texPath))
 		{
-			std::unordered_map<std::string, repo::core::model::RepoNode *>::const_iterator it = nameToTexture.find(texPath.data);
+			std::string texName(texPath.data);
+			repoTrace << "texture name: " << texName;
 
-			if (nameToTexture.end() != it)
+			if (texName.empty())
+			{
+				repoWarning << "Texture name is empty!";
+			}
+			else if (auto texture = assimpScene->GetEmbeddedTexture(texName.c_str()))
 			{
-				repo::core::model::RepoNode * nodeAddr = it->second;
-				nodeAddr->addParent(materialNode->getSharedID());
+				repoTrace << "Embedded texture name: " << texName;
+				repo_material.texturePath = texName;
+
+				if (embeddedTextures.find(texName) == embeddedTextures.end())
+				{
+					embeddedTextures[texName] = texture;
+					if (builder)
+					{
+						// Compressed textures have a height of zero, and a width of their size
+						// in bytes
+						auto data = (const char*)texture->pcData;
+						size_t size = texture->mHeight ? texture->mWidth * texture->mHeight * sizeof(aiTexel) : texture->mWidth;
+						builder->addTextureData(texName, std::vector<char>(data, data + size), texture->mWidth, texture->mHeight);
+					}
+				}
 			}
 			else
 			{
-				repoError << "Could not find related texture mapping";
+				repoTrace << "External texture name: " << texName;
+				repo_material.texturePath = (std::filesystem::u8path(orgFile).parent_path() / std::filesystem::u8path(texName)).string();
 			}
 		}
 	}
 
-	return materialNode;
+	return repo_material;
 }
 
-repo::core::model::MeshNode AssimpModelImport::createMeshRepoNode(
+std::unique_ptr<repo::core::model::MeshNode> AssimpModelImport::createMeshRepoNode(
 	const aiMesh *assimpMesh,
-	const std::vector<repo::core::model::RepoNode *> &materials,
-	std::unordered_map < repo::core::model::RepoNode*, std::vector<repo::lib::RepoUUID>> &matMap,
-	const bool hasTexture,
-	const repo::lib::RepoUUID& texId,
-	const std::vector<double> &offset)
+	const std::vector<repo::lib::RepoUUID> &parents)
 {
-	repo::core::model::MeshNode meshNode;
-
 	//Avoid using assimp objects everywhere -> converting assimp objects into repo structs
 	std::vector<repo::lib::RepoVector3D> vertices;
 	std::vector<repo::lib::repo_face_t> faces;
 	std::vector<repo::lib::RepoVector3D> normals;
 	std::vector<std::vector<repo::lib::RepoVector2D>> uvChannels;
 
+	repo::lib::repo_material_t material = repo::lib::repo_material_t::DefaultMaterial();
+	if (assimpMesh->mMaterialIndex < materials.size())
+	{
+		material = materials[assimpMesh->mMaterialIndex];
+	}
+
 	/*
 	 *--------------------- Vertices (always present) -----------------------------
 	 */
-	aiVector3D offsetVec = offset.size() ? aiVector3D(offset[0], offset[1], offset[2]) : aiVector3D(0, 0, 0);
-	aiVector3D firstV = assimpMesh->mVertices[0];
-	firstV -= offsetVec;
-	repo::lib::RepoVector3D minVertex = { (float)firstV.x, (float)firstV.y, (float)firstV.z };
-	repo::lib::RepoVector3D maxVertex = minVertex;
-
+	vertices.reserve(assimpMesh->mNumVertices);
 	for (uint32_t i = 0; i < assimpMesh->mNumVertices; i++)
 	{
 		auto aiVertex = assimpMesh->mVertices[i];
-		aiVertex -= offsetVec;
-		vertices.push_back({ (float)aiVertex.x, (float)aiVertex.y, (float)aiVertex.z });
+		vertices.push_back({
+			(float)(aiVertex.x - worldOffset.x),
+			(float)(aiVertex.y - worldOffset.y),
+			(float)(aiVertex.z - worldOffset.z)
+		});
+	}
 
-		minVertex.x = minVertex.x < aiVertex.x ? minVertex.x : aiVertex.x;
-		minVertex.y = minVertex.y < aiVertex.y ? minVertex.y : aiVertex.y;
-		minVertex.z = minVertex.z < aiVertex.z ? minVertex.z : aiVertex.z;
+	repo::lib::RepoVector3D minVertex = vertices[0];
+	repo::lib::RepoVector3D maxVertex = vertices[0];
+	for (const auto& v : vertices)
+	{
+		minVertex.x = std::min(minVertex.x, v.x);
+		minVertex.y = std::min(minVertex.y, v.y);
+		minVertex.z = std::min(minVertex.z, v.z);
 
-		maxVertex.x = maxVertex.x > aiVertex.x ? maxVertex.x : aiVertex.x;
-		maxVertex.y = maxVertex.y > aiVertex.y ? maxVertex.y : aiVertex.y;
-		maxVertex.z = maxVertex.z > aiVertex.z ? maxVertex.z : aiVertex.z;
+		maxVertex.x = std::max(maxVertex.x, v.x);
+		maxVertex.y = std::max(maxVertex.y, v.y);
+		maxVertex.z = std::max(maxVertex.z, v.z);
 	}
 
 	/*
@@ -452,6 +453,7 @@ repo::core::model::MeshNode AssimpModelImport::createMeshRepoNode(
 	*/
 	if (assimpMesh->HasFaces())
 	{
+		faces.reserve(assimpMesh->mNumFaces);
 		for (uint32_t i = 0; i < assimpMesh->mNumFaces; i++)
 		{
 			faces.push_back(repo::lib::repo_face_t(assimpMesh->mFaces[i].mIndices,
@@ -467,6 +469,7 @@ repo::core::model::MeshNode AssimpModelImport::createMeshRepoNode(
 	*/
 	if (assimpMesh->HasNormals())
 	{
+		normals.reserve(assimpMesh->mNumVertices);
 		for (uint32_t i = 0; i < assimpMesh->mNumVertices; i++)
 		{
 			normals.push_back({ (float)assimpMesh->mNormals[i].x, (float)assimpMesh->mNormals[i].y, (float)assimpMesh->mNormals[i].z });
@@ -477,18 +480,18 @@ repo::core::model::MeshNode AssimpModelImport::createMeshRepoNode(
 	*------------------------------ UV Channels ----------------------------------
 	*/
 	// Copies only the very first UV channel over
-	// TODO: make sure enough memory can be allocated
 	// TODO: add support for all UV channels.
 	if (assimpMesh->HasTextureCoords(0))
 	{
 		std::vector<repo::lib::RepoVector2D> channelVector;
+		channelVector.reserve(assimpMesh->mNumVertices);
 		for (uint32_t i = 0; i < assimpMesh->mNumVertices; i++)
 		{
 			channelVector.push_back({ (float)assimpMesh->mTextureCoords[0][i].x, (float)assimpMesh->mTextureCoords[0][i].y });
 		}
 		uvChannels.push_back(channelVector);
 	}
-	else if (hasTexture)
+	else if (material.hasTexture())
 	{
 		//Has texture but no UV coordinates, attempt to fabricate some
 		std::vector<repo::lib::RepoVector2D> channelVector;
@@ -509,41 +512,22 @@ repo::core::model::MeshNode AssimpModelImport::createMeshRepoNode(
 
 	repo::lib::RepoBounds boundingBox(minVertex, maxVertex);
 
-	meshNode = repo::core::model::RepoBSONFactory::makeMeshNode(
-		vertices, faces, normals, boundingBox, uvChannels, std::string(assimpMesh->mName.data));
-
-	///*
-	//*------------------------------ setParents ----------------------------------
-	//*/
-
-	if (assimpMesh->mMaterialIndex < materials.size())
-	{
-		repo::core::model::RepoNode *materialNode = materials[assimpMesh->mMaterialIndex];
-		matMap[materialNode].push_back(meshNode.getSharedID());
-
-		// Shim to enable the new multipart optimiser to read Assimp models until this importer
-		// is refactored to use the scene builder.
-		auto matNode = ((repo::core::model::MaterialNode*)materialNode);
-		auto material = matNode->getMaterialStruct();
-		meshNode.setMaterial(material);
-				
-		if(hasTexture)
-			meshNode.setTextureId(texId);		
-	}
+	auto meshNode = std::make_unique<repo::core::model::MeshNode>(repo::core::model::RepoBSONFactory::makeMeshNode(
+		vertices, faces, normals, boundingBox, uvChannels, std::string(assimpMesh->mName.data), parents));
 
-	///*
-	//*-----------------------------------------------------------------------------
-	//*/
+	// The material and texture nodes are created from the material struct by
+	// RepoSceneBuilder (or createMaterialNodes), and the texture id set then.
+	meshNode->setMaterial(material);
 
 	return meshNode;
 }
 
-repo::core::model::MetadataNode* AssimpModelImport::createMetadataRepoNode(
+std::unique_ptr<repo::core::model::MetadataNode> AssimpModelImport::createMetadataRepoNode(
 	const aiMetadata             *assimpMeta,
 	const std::string            &metadataName,
 	const std::vector<repo::lib::RepoUUID> &parents)
 {
-	repo::core::model::MetadataNode *metaNode = 0;
+	std::unique_ptr<repo::core::model::MetadataNode> metaNode;
 	if (assimpMeta)
 	{
 		std::unordered_map<std::string, repo::lib::RepoVariant> metaEntries;
@@ -577,353 +561,290 @@ repo::core::model::MetadataNode* AssimpModelImport::createMetadataRepoNode(
 			}
 		}
 
-		metaNode = new repo::core::model::MetadataNode(
+		metaNode = std::make_unique<repo::core::model::MetadataNode>(
 			repo::core::model::RepoBSONFactory::makeMetaDataNode(metaEntries, metadataName, parents));
 	}//if(assimpMeta)
 
 	return metaNode;
 }
 
-repo::core::model::RepoNodeSet AssimpModelImport::createTransformationNodesRecursive(
-	const aiNode                                                     *assimpNode,
-	const std::vector<repo::core::model::MeshNode>           &originalMeshes,
-	const std::unordered_map<repo::lib::RepoUUID, repo::core::model::RepoNode *, repo::lib::RepoUUIDHasher>    &meshToMat,
-	std::unordered_map<repo::core::model::RepoNode *, std::vector<repo::lib::RepoUUID>> &matParents,
-	repo::core::model::RepoNodeSet			                 &newMeshes,
-	repo::core::model::RepoNodeSet						     &metadata,
-	uint32_t                                               &count,
-	const std::vector<double>                                &worldOffset,
+void AssimpModelImport::createTransformationNodesRecursive(
+	const aiNode                                             *assimpNode,
 	std::vector<repo::lib::RepoUUID>						parents
 )
 {
-	repo::core::model::RepoNodeSet transNodes;
+	if (!assimpNode) {
+		return;
+	}
 
-	if (assimpNode) {
-		std::string transName(assimpNode->mName.data);
-		if (count % 1000 == 0)
-			repoInfo << "Constructing transformation #" << count;
+	std::string transName(assimpNode->mName.data);
+	if (nodeCount++ % 1000 == 0)
+		repoInfo << "Constructing transformation #" << nodeCount;
 
-		//create a 4 by 4 vector
-		std::vector < std::vector<float> > transMat;
+	//create a 4 by 4 vector
+	std::vector < std::vector<float> > transMat;
 
-		for (int i = 0; i < 4; i++) {
-			std::vector<float> rows;
-			for (int j = 0; j < 4; j++) {
-				rows.push_back(assimpNode->mTransformation[i][j]);
-			}
-			transMat.push_back(rows);
+	for (int i = 0; i < 4; i++) {
+		std::vector<float> rows;
+		for (int j = 0; j < 4; j++) {
+			rows.push_back(assimpNode->mTransformation[i][j]);
 		}
+		transMat.push_back(rows);
+	}
 
-		//We need to update the translation vector with the worldOffset
-		if (worldOffset.size())
-		{
-			for (int i = 0; i < 3; ++i)
-			{
-				double extraOffset = worldOffset[0] * transMat[i][0] + transMat[i][1] * worldOffset[1]
-					+ worldOffset[2] * transMat[i][2] - worldOffset[i];
-				transMat[i][3] += extraOffset;
-			}
-		}
+	//We need to update the translation vector with the worldOffset
+	std::vector<double> offset = worldOffset;
+	for (int i = 0; i < 3; ++i)
+	{
+		double extraOffset = offset[0] * transMat[i][0] + transMat[i][1] * offset[1]
+			+ offset[2] * transMat[i][2] - offset[i];
+		transMat[i][3] += extraOffset;
+	}
+
+	repo::lib::RepoMatrix transform(transMat);
 
-		repo::lib::RepoMatrix transform(transMat);
+	// If this transform is a leaf node, we can skip the transform node entirely and
+	// give the mesh(es) its transformation, in its place.
 
-		// If this transform is a leaf node, we can skip the transform node entirely and
-		// give the mesh(es) its transformation, in its place.
+	bool absorbTransform = !assimpNode->mNumChildren && assimpNode->mNumMeshes == 1 && parents.size();
 
-		bool absorbTransform = !assimpNode->mNumChildren && assimpNode->mNumMeshes == 1 && parents.size();
+	// When instancing, a mesh referenced by more than one node keeps its local
+	// vertices, so all the instances share the same geometry
 
-		if (!absorbTransform)
+	if (absorbTransform && settings.shouldInstanceGeometry())
+	{
+		auto meshIndex = assimpNode->mMeshes[0];
+		if (meshIndex < meshReferenceCounts.size() && meshReferenceCounts[meshIndex] > 1)
 		{
-			repo::core::model::TransformationNode* transNode =
-				new repo::core::model::TransformationNode(
-					repo::core::model::RepoBSONFactory::makeTransformationNode(transform, transName, parents));
+			absorbTransform = false;
+		}
+	}
 
-			transNodes.insert(transNode);
+	if (!absorbTransform)
+	{
+		auto transNode = std::make_unique<repo::core::model::TransformationNode>(
+			repo::core::model::RepoBSONFactory::makeTransformationNode(transform, transName, parents));
+		parents = { transNode->getSharedID() };
+		addNode(std::move(transNode));
+	}
 
-			parents = { transNode->getSharedID() };
+	//--------------------------------------------------------------------------
+	// Register meshes as children of this transformation if any. Each reference
+	// to an assimp mesh creates a new mesh node.
+	for (unsigned int i = 0; i < assimpNode->mNumMeshes; ++i)
+	{
+		unsigned int meshIndex = assimpNode->mMeshes[i];
+		if (meshIndex >= assimpScene->mNumMeshes)
+		{
+			continue;
 		}
 
-		//--------------------------------------------------------------------------
-		// Register meshes as children of this transformation if any
-		for (unsigned int i = 0; i < assimpNode->mNumMeshes; ++i)
+		auto assimpMesh = assimpScene->mMeshes[meshIndex];
+		if (assimpMesh && assimpMesh->mNumVertices)
 		{
-			unsigned int meshIndex = assimpNode->mMeshes[i];
-			if (meshIndex < originalMeshes.size())
-			{
-				auto& mesh = originalMeshes[meshIndex];
-				if (mesh.getNumVertices())
-				{
-					auto instance = duplicateMesh(parents, mesh, meshToMat, matParents);
-					newMeshes.insert(instance);
+			auto mesh = createMeshRepoNode(assimpMesh, parents);
+			bool hasName = assimpMesh->mName.length;
 
-					if (absorbTransform)
-					{
-						instance->applyTransformation(transform);
-						instance->changeName(transName);
-						parents = { instance->getSharedID() }; // (For the metadata - there will be no other further child nodes)
-					}
-					else if (assimpNode->mNumChildren && mesh.getName().empty())
-					{
-						instance->changeName(!transName.empty() ? transName : "Unnamed Mesh"); // If we are setting the name because there's siblings, make sure it cannot be empty
-					}
-					else if (!assimpNode->mNumChildren && !mesh.getName().empty())
-					{
-						instance->changeName({});
-					}
-				}
+			if (absorbTransform)
+			{
+				mesh->applyTransformation(transform);
+				mesh->changeName(transName);
+				parents = { mesh->getSharedID() }; // (For the metadata - there will be no other further child nodes)
+			}
+			else if (assimpNode->mNumChildren && !hasName)
+			{
+				mesh->changeName(!transName.empty() ? transName : "Unnamed Mesh"); // If we are setting the name because there's siblings, make sure it cannot be empty
+			}
+			else if (!assimpNode->mNumChildren && hasName)
+			{
+				mesh->changeName({});
 			}
-		}
 
-		//--------------------------------------------------------------------------
-		// Collect metadata and add as a child
+			addNode(std::move(mesh));
+		}
 
-		if (keepMetadata && assimpNode->mMetaData)
-		{
-			std::string metadataName = assimpNode->mName.data;
-			if (metadataName == "<transformation>")
-				metadataName = "<metadata>";
+		releaseMesh(meshIndex);
+	}
 
-			repo::core::model::MetadataNode* metachild = createMetadataRepoNode(assimpNode->mMetaData, metadataName, parents);
-			metadata.insert(metachild);
-		}
+	//--------------------------------------------------------------------------
+	// Collect metadata and add as a child
 
-		//--------------------------------------------------------------------------
-		// Register child transformations as children if any
-		for (unsigned int i = 0; i < assimpNode->mNumChildren; ++i)
-		{
-			repo::core::model::RepoNodeSet childMetadata;
-			repo::core::model::RepoNodeSet childSet = createTransformationNodesRecursive(assimpNode->mChildren[i],
-				originalMeshes, meshToMat, matParents, newMeshes, childMetadata, ++count, worldOffset, parents);
+	if (keepMetadata && assimpNode->mMetaData)
+	{
+		std::string metadataName = assimpNode->mName.data;
+		if (metadataName == "<transformation>")
+			metadataName = "<metadata>";
 
-			transNodes.insert(childSet.begin(), childSet.end());
-			metadata.insert(childMetadata.begin(), childMetadata.end());
-		}
-	} //if assimpNode
+		addNode(createMetadataRepoNode(assimpNode->mMetaData, metadataName, parents));
+	}
 
-	return transNodes;
+	//--------------------------------------------------------------------------
+	// Register child transformations as children if any
+	for (unsigned int i = 0; i < assimpNode->mNumChildren; ++i)
+	{
+		createTransformationNodesRecursive(assimpNode->mChildren[i], parents);
+	}
 }
 
-repo::core::model::RepoScene* AssimpModelImport::convertAiSceneToRepoScene()
+void AssimpModelImport::addNode(std::unique_ptr<repo::core::model::RepoNode> node)
 {
-	repo::core::model::RepoScene *scenePtr = nullptr;
+	if (builder)
+	{
+		builder->addNode(std::move(node));
+		return;
+	}
 
-	if (assimpScene)
+	switch (node->getTypeAsEnum())
 	{
-		//Turn everything into repoNodes and construct a scene
-		repo::core::model::RepoNodeSet meshes; //!< Meshes
-		repo::core::model::RepoNodeSet materials; //!< Materials
-		repo::core::model::RepoNodeSet metadata; //!< Metadata
-		repo::core::model::RepoNodeSet transformations; //!< Transformations
-		repo::core::model::RepoNodeSet textures;
-
-		std::vector<repo::core::model::RepoNode *> originalOrderMaterial; //vector that keeps track original order for assimp indices
-		std::unordered_map<repo::core::model::RepoNode *, std::vector<repo::lib::RepoUUID>> matParents;//Tracks material parents
-		std::unordered_map<repo::lib::RepoUUID, repo::core::model::RepoNode*, repo::lib::RepoUUIDHasher> meshToMat;
-		std::vector<repo::core::model::MeshNode> originalOrderMesh; //vector that keeps track original order for assimp indices
-		std::unordered_map<std::string, repo::core::model::RepoNode *> nameToTexture;
-
-		std::vector<std::vector<double>> sceneBbox = getSceneBoundingBox();
-		//-------------------------------------------------------------------------
-		// Textures
+	case repo::core::model::NodeType::MESH:
+		meshes.insert(node.release());
+		break;
+	case repo::core::model::NodeType::METADATA:
+		metadata.insert(node.release());
+		break;
+	case repo::core::model::NodeType::TRANSFORMATION:
+		transformations.insert(node.release());
+		break;
+	default:
+		repoError << "Unexpected node type in Assimp Model Convertor";
+	}
+}
+
+void AssimpModelImport::releaseMesh(unsigned int meshIndex)
+{
+	if (meshIndex < meshReferencesRemaining.size() && meshReferencesRemaining[meshIndex] && !--meshReferencesRemaining[meshIndex])
+	{
+		// The array of mesh pointers belongs to the scene, but the meshes
+		// themselves may be deleted early, as the scene ignores null entries
+		delete assimpScene->mMeshes[meshIndex];
+		assimpScene->mMeshes[meshIndex] = nullptr;
+	}
+}
+
+void AssimpModelImport::createMaterialNodes()
+{
+	std::unordered_map<size_t, repo::core::model::MaterialNode*> materialsByChecksum;
+	std::unordered_map<std::string, repo::core::model::TextureNode*> texturesByPath;
 
-		repoInfo << "Constructing Texture Nodes...";
-		bool missingTextures = false;
+	for (auto node : meshes)
+	{
+		auto mesh = dynamic_cast<repo::core::model::MeshNode*>(node);
+		auto material = mesh->getMaterial();
 
-		for (uint32_t m = 0; m < assimpScene->mNumMaterials; ++m)
+		auto key = material.checksum();
+		auto it = materialsByChecksum.find(key);
+		if (it == materialsByChecksum.end())
 		{
-			int texIndex = 0;
-			aiReturn texFound = AI_SUCCESS;
-			const aiMaterial *material = assimpScene->mMaterials[m];
+			auto materialNode = new repo::core::model::MaterialNode(
+				repo::core::model::RepoBSONFactory::makeMaterialNode(material, {}, { mesh->getSharedID() }));
+			materialNodes.insert(materialNode);
+			materialsByChecksum[key] = materialNode;
 
-			uint32_t nTex = material->GetTextureCount(aiTextureType_DIFFUSE);
-			for (uint32_t iTex = 0; iTex < nTex; ++iTex)
+			if (material.hasTexture())
 			{
-				aiString path;	// filename
-				if (AI_SUCCESS == material->GetTexture(aiTextureType_DIFFUSE, iTex, &path))
+				auto texture = texturesByPath.find(material.texturePath);
+				if (texture == texturesByPath.end())
 				{
-					std::string texName(path.data);
-					repoTrace << "texture name: " << texName;
-
-					if (!texName.empty())
-					{
-						repo::core::model::RepoNode *textureNode = nullptr;
-
-						const aiTexture* texture = nullptr;
-						if (texture = assimpScene->GetEmbeddedTexture(texName.c_str()))
-						{
-							repoTrace << "Embedded texture name: " << texName;
-							//---------------------------------------------------------
-							// Embedded texture
-							char *memblock = (char*)malloc(texture->mWidth);
-							memcpy(memblock, texture->pcData, texture->mWidth);
-
-							auto size = texture->mWidth * (texture->mHeight == 0 ? 1 : texture->mHeight);
-							textureNode = new repo::core::model::TextureNode(repo::core::model::RepoBSONFactory::makeTextureNode(
-								texName,
-								(char*)texture->pcData,
-								size,
-								texture->mWidth,
-								texture->mHeight));
-
-							free(memblock);
-						}
-						else
-						{
-							repoTrace << "External texture name: " << texName;
-							//External texture
-							std::ifstream::pos_type size;
-							auto filePath = std::filesystem::u8path(orgFile).parent_path() / std::filesystem::u8path(texName);
-							std::ifstream file(filePath, std::ios::in | std::ios::binary | std::ios::ate);
-							char *memblock = nullptr;
-							if (!file.is_open())
-							{
-								repoError << "Could not open texture: " << filePath;
-								missingTextures = true;
-							}
-							else
-							{
-								size = file.tellg();
-								memblock = new char[size];
-								file.seekg(0, std::ios::beg);
-								file.read(memblock, size);
-								file.close();
-							}
-
-							textureNode = new repo::core::model::TextureNode(repo::core::model::RepoBSONFactory::makeTextureNode(
-								texName,
-								memblock,
-								size,
-								size,
-								0));
-
-							if (memblock)delete[] memblock;
-						}
-
-						if (textureNode)
-						{
-							textures.insert(textureNode);
-							nameToTexture[texName] = textureNode;
-							repoTrace << "Added texture :" << texName;
-						}
-					}
-					else
+					auto textureNode = createTextureRepoNode(material.texturePath);
+					if (textureNode)
 					{
-						repoWarning << "Texture name is empty!";
+						textures.insert(textureNode.get());
 					}
+					texture = texturesByPath.insert({ material.texturePath, textureNode.release() }).first;
 				}
-				else
+				if (texture->second)
 				{
-					repoWarning << "Unable to get texture from material.";
+					texture->second->addParent(materialNode->getSharedID());
 				}
 			}
 		}
-		repoInfo << "Constructing Material Nodes...";
-		/*
-		* ------------- Material Nodes -----------------
-		*/
-		// Warning: Default material might not be attached to anything,
-		// hence it would not be returned by a call to getNodes().
-		if (assimpScene->HasMaterials())
+		else
 		{
-			for (uint32_t i = 0; i < assimpScene->mNumMaterials; ++i)
-			{
-				if (i % 100 == 0 || i == assimpScene->mNumMaterials - 1)
-				{
-					repoInfo << "Constructing " << i << " of " << assimpScene->mNumMaterials;
-				}
-				aiString name;
-				assimpScene->mMaterials[i]->Get(AI_MATKEY_NAME, name);
+			it->second->addParent(mesh->getSharedID());
+		}
+
+		if (material.hasTexture() && texturesByPath[material.texturePath])
+		{
+			mesh->setTextureId(texturesByPath[material.texturePath]->getUniqueID());
+		}
+	}
+}
 
-				repo::core::model::RepoNode* material = createMaterialRepoNode(
-					assimpScene->mMaterials[i],
-					name.data, nameToTexture);
+std::unique_ptr<repo::core::model::TextureNode> AssimpModelImport::createTextureRepoNode(const std::string &texturePath)
+{
+	std::unique_ptr<repo::core::model::TextureNode> textureNode;
 
-				if (!material)
-					repoError << "Unable to construct material node in Assimp Model Convertor!";
-				else
-				{
-					materials.insert(material);
-				}
+	auto embedded = embeddedTextures.find(texturePath);
+	if (embedded != embeddedTextures.end())
+	{
+		auto texture = embedded->second;
+		size_t size = texture->mHeight ? texture->mWidth * texture->mHeight * sizeof(aiTexel) : texture->mWidth;
+		textureNode = std::make_unique<repo::core::model::TextureNode>(repo::core::model::RepoBSONFactory::makeTextureNode(
+			texturePath,
+			(const char*)texture->pcData,
+			size,
+			texture->mWidth,
+			texture->mHeight));
+		return textureNode;
+	}
 
-				originalOrderMaterial.push_back(material);
-				std::pair<repo::core::model::RepoNode *, std::vector<repo::lib::RepoUUID>> a;
-				a.first = material;
-				a.second = std::vector<repo::lib::RepoUUID>();
-				matParents.insert(a);
-			}
-		}
+	std::ifstream file(std::filesystem::u8path(texturePath), std::ios::in | std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+	{
+		repoError << "Could not open texture: " << texturePath;
+		missingTextures = true;
+		return textureNode;
+	}
 
-		/*
-		* ---------------------------------------------
-		*/
+	std::vector<char> memblock(file.tellg());
+	file.seekg(0, std::ios::beg);
+	file.read(memblock.data(), memblock.size());
 
-		repoInfo << "Constructing Mesh Nodes...";
-		if (sceneBbox.size())
-			repoInfo << "Scene offset : {" << sceneBbox[0][0] << "," << sceneBbox[0][1] << "," << sceneBbox[0][2] << "}";
-		else
-		{
-			repoError << "Could not calculate scene offset, num.Meshes = " << assimpScene->mNumMeshes;
-			sceneBbox.push_back({ 0, 0, 0 });
-			sceneBbox.push_back({ 0, 0, 0 });
-		}
-		/*
-		* --------------- Mesh Nodes ------------------
-		*/
-		if (assimpScene->HasMeshes())
-		{
-			for (unsigned int i = 0; i < assimpScene->mNumMeshes; ++i)
-			{
-				if (i % 500 == 0 || i == assimpScene->mNumMeshes - 1)
-				{
-					repoInfo << "Constructing " << i << " of " << assimpScene->mNumMeshes;
-				}
+	textureNode = std::make_unique<repo::core::model::TextureNode>(repo::core::model::RepoBSONFactory::makeTextureNode(
+		texturePath,
+		memblock.data(),
+		memblock.size(),
+		memblock.size(),
+		0));
 
-				auto aiMaterial = assimpScene->mMaterials[assimpScene->mMeshes[i]->mMaterialIndex];
-				int numTextures = aiMaterial->GetTextureCount(aiTextureType_DIFFUSE);
+	return textureNode;
+}
 
-				repo::lib::RepoUUID texId;
-				if (numTextures > 0) {
-					aiString texPath;
-					aiMaterial->GetTexture(aiTextureType_DIFFUSE, 0, &texPath);
-					auto texture = nameToTexture.find(texPath.data);
+repo::core::model::RepoScene* AssimpModelImport::convertAiSceneToRepoScene(
+	std::shared_ptr<repo::core::handler::AbstractDatabaseHandler> handler)
+{
+	repo::core::model::RepoScene *scenePtr = nullptr;
 
-					if (nameToTexture.end() != texture)
-					{
-						texId = texture->second->getUniqueID();
-					}
-				}
-				
-				auto mesh = createMeshRepoNode(
-					assimpScene->mMeshes[i],
-					originalOrderMaterial,
-					matParents, numTextures > 0,
-					texId,
-					sceneBbox.size() ? sceneBbox[0] : std::vector<double>());
-
-				if (!mesh.getNumVertices())
-				{
-					repoError << "Unable to construct mesh node in Assimp Model Convertor!";
-				}
-				else
-				{
-					originalOrderMesh.push_back(mesh);
-				}
-			}
+	if (assimpScene)
+	{
+		// The world offset must be known before the first mesh is created, so the
+		// bounds (along with the mesh reference counts) are found up front, with a
+		// pass over the hierarchy that does not create any nodes.
 
-			//Update material parents
-			for (const auto &matPair : matParents)
+		auto sceneBbox = scanScene();
+		if (sceneBbox.min().x <= sceneBbox.max().x)
+		{
+			worldOffset = sceneBbox.min();
+			repoInfo << "Scene offset : {" << worldOffset.x << "," << worldOffset.y << "," << worldOffset.z << "}";
+			if (builder)
 			{
-				for (const auto meshId : matPair.second) {
-					matPair.first->addParents(matPair.second);
-					meshToMat[meshId] = matPair.first;
-				}
+				builder->setGeometryGrid(repo::lib::RepoBounds(sceneBbox.min() - worldOffset, sceneBbox.max() - worldOffset));
 			}
-			matParents.clear();
+		}
+		else
+		{
+			repoError << "Could not calculate scene offset, num.Meshes = " << assimpScene->mNumMeshes;
+			worldOffset = repo::lib::RepoVector3D64(0, 0, 0);
+		}
+
+		repoInfo << "Constructing Materials...";
+
+		materials.clear();
+		for (uint32_t i = 0; i < assimpScene->mNumMaterials; ++i)
+		{
+			materials.push_back(createMaterial(assimpScene->mMaterials[i]));
 		}
 
-		/*
-		* ---------------------------------------------
-		*/
 		//--------------------------------------------------------------------------
 		// TODO: Animations
 		//if (assimpScene->HasAnimations())
@@ -938,42 +859,61 @@ repo::core::model::RepoScene* AssimpModelImport::convertAiSceneToRepoScene()
 
 		// TODO: Bones
 
-		repoInfo << "Constructing Transformation Nodes...";
+		repoInfo << "Constructing Nodes...";
 		/*
 		* ----------- Transformation Nodes ------------
 		*/
 		// Recursively converts aiNode and all of its children to a hierarchy
-		// of RepoNodeTransformations. Call with root node of aiScene.
-		// RootNode will be the first entry in transformations vector.
+		// of RepoNodeTransformations, along with their meshes and metadata. Call
+		// with root node of aiScene.
 
-		uint32_t count = 0;
-		transformations = createTransformationNodesRecursive(assimpScene->mRootNode,
-			originalOrderMesh, meshToMat, matParents, meshes, metadata, count, sceneBbox[0]);
+		createTransformationNodesRecursive(assimpScene->mRootNode);
 
-		repoInfo << "Node Construction completed. (#transformations: " << transformations.size() << ", #Metadata" << metadata.size() << ")";
+		repoInfo << "Node Construction completed. (#transformations: " << nodeCount << ")";
 
-		//Update material parents
-		for (const auto &matPair : matParents)
+		if (builder)
 		{
-			if (matPair.second.size() > 0)
+			builder->setWorldOffset(worldOffset);
+			builder->finalise();
+
+			scenePtr = new repo::core::model::RepoScene(
+				settings.getDatabaseName(),
+				settings.getProjectName()
+			);
+			scenePtr->setRevision(settings.getRevisionId());
+			scenePtr->setOriginalFiles({ orgFile });
+			scenePtr->loadRootNode(handler.get());
+			scenePtr->setWorldOffset(builder->getWorldOffset());
+
+			if (builder->hasMissingTextures())
 			{
-				matPair.first->addParents(matPair.second);
+				scenePtr->setMissingTexture();
 			}
-		}
-
-		/*
-		* ---------------------------------------------
-		*/
 
-		std::vector<std::string> fileVect;
-		if (!orgFile.empty())
-			fileVect.push_back(orgFile);
-		scenePtr = new repo::core::model::RepoScene(fileVect, meshes, materials, metadata, textures, transformations);
-		if (missingTextures)
+			builder.reset();
+		}
+		else
 		{
-			scenePtr->setMissingTexture();
+			createMaterialNodes();
+
+			std::vector<std::string> fileVect;
+			if (!orgFile.empty())
+				fileVect.push_back(orgFile);
+			scenePtr = new repo::core::model::RepoScene(fileVect, meshes, materialNodes, metadata, textures, transformations);
+			if (missingTextures)
+			{
+				scenePtr->setMissingTexture();
+			}
+			scenePtr->setWorldOffset(worldOffset);
+			scenePtr->setDeduplicateBinaries(settings.shouldInstanceGeometry());
+
+			// The scene owns the nodes now
+			meshes.clear();
+			materialNodes.clear();
+			metadata.clear();
+			textures.clear();
+			transformations.clear();
 		}
-		scenePtr->setWorldOffset(sceneBbox[0]);
 	}
 	else
 	{
@@ -983,128 +923,72 @@ repo::core::model::RepoScene* AssimpModelImport::convertAiSceneToRepoScene()
 	return scenePtr;
 }
 
-repo::core::model::RepoNode* AssimpModelImport::duplicateMesh(
-	const std::vector<repo::lib::RepoUUID>& newParent,
-	const repo::core::model::MeshNode &mesh,
-	const std::unordered_map<repo::lib::RepoUUID, repo::core::model::RepoNode *, repo::lib::RepoUUIDHasher>    &meshToMat,
-	std::unordered_map<repo::core::model::RepoNode *, std::vector<repo::lib::RepoUUID>> &matParents)
+repo::lib::RepoBounds AssimpModelImport::scanScene()
 {
-	auto newMesh = new repo::core::model::MeshNode(mesh);
-	newMesh->setUniqueID(repo::lib::RepoUUID::createUUID());
-	newMesh->setSharedID(repo::lib::RepoUUID::createUUID());
-	newMesh->setParents( newParent );
-
-	auto it = meshToMat.find(mesh.getSharedID());
-	if (it != meshToMat.end() && it->second)
+	std::vector<repo::lib::RepoBounds> meshBounds(assimpScene->mNumMeshes);
+	for (unsigned int i = 0; i < assimpScene->mNumMeshes; ++i)
 	{
-		if (matParents.find(it->second) == matParents.end())
-			matParents[it->second] = std::vector<repo::lib::RepoUUID>();
-
-		matParents[it->second].push_back(newMesh->getSharedID());
+		auto mesh = assimpScene->mMeshes[i];
+		if (!mesh->mNumVertices)
+		{
+			repoWarning << "Mesh with no vertices found!";
+		}
+		for (unsigned int v = 0; v < mesh->mNumVertices; ++v)
+		{
+			meshBounds[i].encapsulate(repo::lib::RepoVector3D64(mesh->mVertices[v].x, mesh->mVertices[v].y, mesh->mVertices[v].z));
+		}
 	}
-	return newMesh;
-}
 
+	meshReferenceCounts.assign(assimpScene->mNumMeshes, 0);
 
-std::vector<std::vector<double>> AssimpModelImport::getSceneBoundingBox() const
-{
-	std::vector<std::vector<double>> bbox;
-	if (assimpScene)
-	{
-		//default constructor is identity
-		const aiMatrix4x4 identity;
+	repo::lib::RepoBounds bounds;
+	scanSceneRecursive(assimpScene->mRootNode, aiMatrix4x4(), meshBounds, bounds);
 
-		getSceneBoundingBoxInternal(assimpScene->mRootNode, identity, bbox);
-	}
+	meshReferencesRemaining = meshReferenceCounts;
 
-	return bbox;
+	return bounds;
 }
 
-void AssimpModelImport::getSceneBoundingBoxInternal(
-	const aiNode                     *node,
-	const aiMatrix4x4                &mat,
-	std::vector<std::vector<double>> &bbox) const
+void AssimpModelImport::scanSceneRecursive(
+	const aiNode                          *node,
+	const aiMatrix4x4                     &mat,
+	const std::vector<repo::lib::RepoBounds> &meshBounds,
+	repo::lib::RepoBounds                 &bounds)
 {
 	const aiMatrix4x4 transformation = mat * node->mTransformation;
 
-	if (node->mNumMeshes)
+	for (unsigned int i = 0; i < node->mNumMeshes; ++i)
 	{
-		for (size_t meshIdx = 0; meshIdx < node->mNumMeshes; ++meshIdx)
+		auto meshIndex = node->mMeshes[i];
+		if (meshIndex >= meshBounds.size())
 		{
-			std::vector<std::vector<double>> meshBbox = getAiMeshBoundingBox(assimpScene->mMeshes[meshIdx]);
-			if (meshBbox.size() == 2)
-			{
-				aiVector3D vectorMin(meshBbox[0][0], meshBbox[0][1], meshBbox[0][2]);
-				aiVector3D scaledBoundaryMin = transformation * vectorMin;
-
-				aiVector3D vectorMax(meshBbox[1][0], meshBbox[1][1], meshBbox[1][2]);
-				aiVector3D scaledBoundaryMax = transformation * vectorMax;
-
-				if (bbox.size())
-				{
-					if (scaledBoundaryMin.x < bbox[0][0])
-						bbox[0][0] = scaledBoundaryMin.x;
-					if (scaledBoundaryMin.y < bbox[0][1])
-						bbox[0][1] = scaledBoundaryMin.y;
-					if (scaledBoundaryMin.z < bbox[0][2])
-						bbox[0][2] = scaledBoundaryMin.z;
-
-					if (scaledBoundaryMax.x > bbox[1][0])
-						bbox[1][0] = scaledBoundaryMax.x;
-					if (scaledBoundaryMax.y > bbox[1][1])
-						bbox[1][1] = scaledBoundaryMax.y;
-					if (scaledBoundaryMax.z > bbox[1][2])
-						bbox[1][2] = scaledBoundaryMax.z;
-				}
-				else
-				{
-					bbox.push_back({ scaledBoundaryMin.x, scaledBoundaryMin.y, scaledBoundaryMin.z });
-					bbox.push_back({ scaledBoundaryMax.x, scaledBoundaryMax.y, scaledBoundaryMax.z });
-				}
-			}
+			continue;
 		}
-	}
 
-	for (size_t childIdx = 0; childIdx < node->mNumChildren; ++childIdx)
-	{
-		getSceneBoundingBoxInternal(node->mChildren[childIdx], transformation, bbox);
-	}
-}
+		meshReferenceCounts[meshIndex]++;
 
-std::vector<std::vector<double>> AssimpModelImport::getAiMeshBoundingBox(
-	const aiMesh *mesh) const
-{
-	std::vector<std::vector<double>> bbox;
-	if (mesh->mNumVertices)
-	{
-		bbox.push_back({ mesh->mVertices[0].x, mesh->mVertices[0].y, mesh->mVertices[0].z });
-		bbox.push_back({ mesh->mVertices[0].x, mesh->mVertices[0].y, mesh->mVertices[0].z });
+		// All eight corners are transformed, so the bounds remain conservative
+		// under rotation
 
-		for (size_t vIdx = 1; vIdx < mesh->mNumVertices; ++vIdx)
+		auto& meshBbox = meshBounds[meshIndex];
+		if (meshBbox.min().x <= meshBbox.max().x)
 		{
-			auto currentV = mesh->mVertices[vIdx];
-
-			if (bbox[0][0] < currentV.x)
-				bbox[0][0] = currentV.x;
-			if (bbox[0][1] < currentV.y)
-				bbox[0][1] = currentV.y;
-			if (bbox[0][2] < currentV.z)
-				bbox[0][2] = currentV.z;
-
-			if (bbox[1][0] > currentV.x)
-				bbox[1][0] = currentV.x;
-			if (bbox[1][1] > currentV.y)
-				bbox[1][1] = currentV.y;
-			if (bbox[1][2] > currentV.z)
-				bbox[1][2] = currentV.z;
+			for (int c = 0; c < 8; ++c)
+			{
+				aiVector3D corner(
+					(c & 1) ? meshBbox.max().x : meshBbox.min().x,
+					(c & 2) ? meshBbox.max().y : meshBbox.min().y,
+					(c & 4) ? meshBbox.max().z : meshBbox.min().z);
+				corner = transformation * corner;
+				bounds.encapsulate(repo::lib::RepoVector3D64(corner.x, corner.y, corner.z));
+			}
 		}
 	}
-	else
+
+	for (unsigned int i = 0; i < node->mNumChildren; ++i)
 	{
-		repoWarning << "Mesh with no vertices found!";
+		scanSceneRecursive(node->mChildren[i], transformation, meshBounds, bounds);
 	}
-
-	return bbox;
 }
 
 std::string AssimpModelImport::getFileExtension(const std::string &filePath) const {
@@ -1185,10 +1069,38 @@ repo::core::model::RepoScene* AssimpModelImport::importModel(std::string filePat
 			repoWarning << "Bouncer library is compiled against a 32bit assimp library. Results may be sub-optimal.";
 		}
 
+		// If the settings name a project, the nodes are written as they are
+		// converted, rather than held until the whole scene has been built.
+		// Otherwise an in-memory scene is returned, to be committed later.
+
+		if (!settings.getDatabaseName().empty() && !settings.getProjectName().empty())
+		{
+			builder = std::make_unique<repo::manipulator::modelutility::RepoSceneBuilder>(
+				handler,
+				settings.getDatabaseName(),
+				settings.getProjectName(),
+				settings.getRevisionId()
+			);
+			builder->createIndexes();
+			if (settings.shouldCompressGeometry()) {
+				builder->setGeometryCodec(repo::lib::RepoMeshCodec::Options());
+			}
+			if (settings.shouldInstanceGeometry()) {
+				builder->setDeduplicateBinaries(true);
+			}
+			if (settings.shouldProcessTextures()) {
+				repo::manipulator::modelutility::TextureProcessorOptions textureOptions;
+				textureOptions.maxDimension = std::max(settings.getMaxTextureSize(), 0);
+				textureOptions.generateMipLevels = settings.shouldGenerateTextureMipLevels();
+				textureOptions.numThreads = std::max(settings.getNumThreads(), 0);
+				builder->setTextureProcessing(textureOptions);
+			}
+		}
+
 		//This will generate the non optimised scene
 		repoTrace << "Converting AiScene to repoScene";
 		importer.ApplyPostProcessing(composeAssimpPostProcessingFlags());
-		scene = convertAiSceneToRepoScene();
+		scene = convertAiSceneToRepoScene(handler);
 
 		return scene;
 	}
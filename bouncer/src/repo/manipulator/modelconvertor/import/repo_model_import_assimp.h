@@ -36,8 +36,11 @@
 #include "repo/core/model/bson/repo_node_material.h"
 #include "repo/core/model/bson/repo_node_mesh.h"
 #include "repo/core/model/bson/repo_node_metadata.h"
+#include "repo/core/model/bson/repo_node_texture.h"
 #include "repo/core/model/bson/repo_node_transformation.h"
+#include "repo/manipulator/modelutility/repo_scene_builder.h"
 
+#include "repo/lib/datastructure/repo_bounds.h"
 #include "repo/lib/datastructure/repo_variant.h"
 
 namespace repo {
@@ -84,39 +87,34 @@ namespace repo {
 			private:
 
 				/**
-				* Convert the assimp scene into Repo Scene
-				* @param errMsg error message if an error occured
+				* Convert the assimp scene into Repo Scene. If a RepoSceneBuilder has been
+				* created the nodes are written as they are converted, and the returned
+				* scene holds only the root node.
+				* @param handler database handler the builder writes to
 				* @return return a pointer to the scene
 				*/
-				repo::core::model::RepoScene* convertAiSceneToRepoScene();
+				repo::core::model::RepoScene* convertAiSceneToRepoScene(
+					std::shared_ptr<repo::core::handler::AbstractDatabaseHandler> handler);
 
 				/**
-				* Create a Material Node given the information in ASSIMP objects
-				* NOTE: textures must've been populated at this point to populate references
+				* Create the material struct given the information in ASSIMP objects. If
+				* the material has a diffuse texture, texturePath is set to the file it
+				* should be read from, or the name of the embedded texture.
 				* @param material assimp material object
-				* @param name name of the material
-				* @param nameToTexture a mapping of texture name to texture node
-				* @return returns the created material node
+				* @return returns the material
 				*/
-				repo::core::model::MaterialNode* createMaterialRepoNode(
-					const aiMaterial *material,
-					const std::string &name,
-					const std::unordered_map<std::string, repo::core::model::RepoNode *> &nameToTexture);
+				repo::lib::repo_material_t createMaterial(const aiMaterial *material);
 
 				/**
-				* Create a Mesh Node given the information in ASSIMP objects
-				* NOTE: materials must've been populated at this point to populate references
+				* Create a Mesh Node given the information in ASSIMP objects. The vertices
+				* are made relative to the world offset.
 				* @param assimpMesh assimp mesh object
-				* @param materials RepoNodeSet of material objects (to add reference)
+				* @param parents parents of the new node
 				* @return returns the created Mesh Node
 				*/
-				repo::core::model::MeshNode createMeshRepoNode(
+				std::unique_ptr<repo::core::model::MeshNode> createMeshRepoNode(
 					const aiMesh *assimpMesh,
-					const std::vector<repo::core::model::RepoNode *> &materials,
-					std::unordered_map < repo::core::model::RepoNode*, std::vector<repo::lib::RepoUUID>> &matMap,
-					const bool hasTexture,
-					const repo::lib::RepoUUID& texId,
-					const std::vector<double> &offset);
+					const std::vector<repo::lib::RepoUUID> &parents);
 
 				/**
 				* Create a Metadata Node given the information in ASSIMP objects
@@ -125,51 +123,46 @@ namespace repo {
 				* @param parent vector of node ID of parents (optional)
 				* @return returns the created Metadata Node
 				*/
-				repo::core::model::MetadataNode* createMetadataRepoNode(
+				std::unique_ptr<repo::core::model::MetadataNode> createMetadataRepoNode(
 					const aiMetadata             *assimpMeta,
 					const std::string            &metadataName,
 					const std::vector<repo::lib::RepoUUID> &parents = std::vector<repo::lib::RepoUUID>());
 
 				/**
-				* Create a Transformation Node given the information in ASSIMP objects
-				* @param assimpNode assimp Transformation object
-				* @param cameras a map of camera name to camera objects
-				* @param meshes A vector fo mesh nodes in its original ASSIMP object order
-				* @param newMeshes newly produced meshes based on original ordered meshes
-				* @param metadata a RepoNode Set to store metadata nodes generated within this function
-				* @param map keeps track of the mapping between assimp pointer and repoNode
-				* @param parent a vector of parents to this node (optional)
-				* @return returns the created Metadata Node
+				* Create the Transformation Node for the assimp node, and the mesh and
+				* metadata nodes below it, then recurse into its children. Each assimp
+				* mesh is released once the last node referencing it has been converted.
+				* @param assimpNode assimp node
+				* @param parents a vector of parents to this node (optional)
 				*/
-				repo::core::model::RepoNodeSet createTransformationNodesRecursive(
+				void createTransformationNodesRecursive(
 					const aiNode                                                         *assimpNode,
-					const std::vector<repo::core::model::MeshNode >                      &originalMeshes,
-					const std::unordered_map<repo::lib::RepoUUID, repo::core::model::RepoNode *, repo::lib::RepoUUIDHasher>    &meshToMat,
-					std::unordered_map<repo::core::model::RepoNode *, std::vector<repo::lib::RepoUUID>> &matParents,
-					repo::core::model::RepoNodeSet                                       &newMeshes,
-					repo::core::model::RepoNodeSet						                 &metadata,
-					uint32_t                                                             &count,
-					const std::vector<double>                                            &worldOffset,
 					std::vector<repo::lib::RepoUUID>						             parents = std::vector<repo::lib::RepoUUID>()
 				);
 
 				/**
-				* Duplicate the given mesh and assign a new parent
-				* Also create a new unique ID and shared ID for the mesh
-				* @return returns a pointer to the newly constructed mesh
+				* Hands the node to the RepoSceneBuilder, or keeps it for the in-memory
+				* scene if there isn't one
 				*/
-				repo::core::model::RepoNode* duplicateMesh(
-					const std::vector<repo::lib::RepoUUID>& newParent,
-					const repo::core::model::MeshNode &mesh,
-					const std::unordered_map<repo::lib::RepoUUID, repo::core::model::RepoNode *, repo::lib::RepoUUIDHasher>    &meshToMat,
-					std::unordered_map<repo::core::model::RepoNode *, std::vector<repo::lib::RepoUUID>> &matParents);
+				void addNode(std::unique_ptr<repo::core::model::RepoNode> node);
 
 				/**
-				* Get bounding box of the aimesh
-				* @return returns the bounding box
+				* For in-memory scenes, creates the material and texture nodes for the
+				* materials of the meshes, in the same way RepoSceneBuilder would
+				*/
+				void createMaterialNodes();
+
+				/**
+				* Create a Texture Node from an embedded texture or file, for in-memory
+				* scenes. Returns nullptr if the texture could not be read.
+				*/
+				std::unique_ptr<repo::core::model::TextureNode> createTextureRepoNode(const std::string &texturePath);
+
+				/**
+				* Frees the assimp mesh once all the nodes that reference it have been
+				* converted
 				*/
-				std::vector<std::vector<double>> getAiMeshBoundingBox(
-					const aiMesh *mesh) const;
+				void releaseMesh(unsigned int meshIndex);
 
 				/**
 				* Get file extension(in caps) of the given filePath
@@ -177,15 +170,19 @@ namespace repo {
 				std::string getFileExtension(const std::string &filePath) const;
 
 				/**
-				* Get bounding box of the aiscene
+				* Counts how many times each assimp mesh is referenced by the nodes, into
+				* meshReferenceCounts, and gets the bounding box of the scene. This runs
+				* before any nodes are created, as the world offset must be known before
+				* the first mesh is written.
 				* @return returns the bounding box
 				*/
-				std::vector<std::vector<double>> getSceneBoundingBox() const;
+				repo::lib::RepoBounds scanScene();
 
-				void getSceneBoundingBoxInternal(
-					const aiNode                     *node,
-					const aiMatrix4x4                &mat,
-					std::vector<std::vector<double>> &bbox) const;
+				void scanSceneRecursive(
+					const aiNode                          *node,
+					const aiMatrix4x4                     &mat,
+					const std::vector<repo::lib::RepoBounds> &meshBounds,
+					repo::lib::RepoBounds                 &bounds);
 
 				/**
 				* Normalise shininess value base on source file type
@@ -215,10 +212,27 @@ namespace repo {
 				bool SetRootOrientationFromMetadata();
 
 				Assimp::Importer importer;  /*! Stores ASSIMP related settings for model import */
-				const aiScene *assimpScene; /*! ASSIMP scene representation of the model */
+				const aiScene *assimpScene = nullptr; /*! ASSIMP scene representation of the model */
 				std::string orgFile; /*! orgFileName */
 				bool keepMetadata;
 				bool requiresOrientation = false;
+				bool missingTextures = false;
+				std::vector<uint32_t> meshReferenceCounts; /*! Number of nodes referencing each mesh */
+				std::vector<uint32_t> meshReferencesRemaining; /*! Number of nodes still to convert that reference each mesh */
+				std::vector<repo::lib::repo_material_t> materials; /*! Materials in assimp order */
+				std::unordered_map<std::string, const aiTexture*> embeddedTextures; /*! Embedded textures by texturePath */
+				repo::lib::RepoVector3D64 worldOffset;
+				uint32_t nodeCount = 0;
+
+				/*! Writes the nodes to the database as they are created, if the settings name a project */
+				std::unique_ptr<repo::manipulator::modelutility::RepoSceneBuilder> builder;
+
+				/*! Nodes of the in-memory scene, if there is no builder */
+				repo::core::model::RepoNodeSet meshes;
+				repo::core::model::RepoNodeSet materialNodes;
+				repo::core::model::RepoNodeSet metadata;
+				repo::core::model::RepoNodeSet textures;
+				repo::core::model::RepoNodeSet transformations;
 			};
 		} //namespace AssimpModelImport
 	} //namespace manipulator
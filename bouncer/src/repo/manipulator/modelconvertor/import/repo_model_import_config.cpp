@@ -30,7 +30,13 @@ ModelImportConfig::ModelImportConfig() :
 	targetUnits(ModelUnits::UNKNOWN),
 	revisionId(repo::lib::RepoUUID::defaultValue),
 	lod(0),
-	numThreads(0)
+	numThreads(0),
+	instanceGeometry(false),
+	binarySequenceCache(false),
+	compressGeometry(false),
+	processTextures(false),
+	maxTextureSize(0),
+	textureMipLevels(false)
 {}
 
 ModelImportConfig::ModelImportConfig(
@@ -73,5 +79,11 @@ std::string ModelImportConfig::prettyPrint()
 		+ " revisionId: " + revisionId.toString()
 		+ " num threads: " + std::to_string(numThreads)
 		+ " view name: " + (viewName.empty() ? "NONE" : viewName)
+		+ " instance geometry: " + (instanceGeometry ? "true" : "false")
+		+ " binary sequence cache: " + (binarySequenceCache ? "true" : "false")
+		+ " compress geometry: " + (compressGeometry ? "true" : "false")
+		+ " process textures: " + (processTextures ? "true" : "false")
+		+ " max texture size: " + std::to_string(maxTextureSize)
+		+ " texture mip levels: " + (textureMipLevels ? "true" : "false")
 	);
 }
\ No newline at end of file
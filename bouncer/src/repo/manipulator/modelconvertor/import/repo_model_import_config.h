@@ -46,6 +46,12 @@ namespace repo {
 				int numThreads;
 				std::string viewName;
 				std::string viewStyle;
+				bool instanceGeometry;
+				bool binarySequenceCache;
+				bool compressGeometry;
+				bool processTextures;
+				int maxTextureSize; // When processing textures, 0 for no limit
+				bool textureMipLevels;
 
 				ModelImportConfig();
 
@@ -74,6 +80,12 @@ namespace repo {
 				std::string getProjectName() const { return projectName; }
 				int getNumThreads() const { return numThreads; }
 				std::string getViewName() const { return viewName; }
+				bool shouldInstanceGeometry() const { return instanceGeometry; }
+				bool shouldUseBinarySequenceCache() const { return binarySequenceCache; }
+				bool shouldCompressGeometry() const { return compressGeometry; }
+				bool shouldProcessTextures() const { return processTextures; }
+				int getMaxTextureSize() const { return maxTextureSize; }
+				bool shouldGenerateTextureMipLevels() const { return textureMipLevels; }
 
 				std::string prettyPrint();
 			};
@@ -51,6 +51,9 @@ repo::core::model::RepoScene* IFCModelImport::importModel(std::string filePath,
 		settings.getRevisionId()
 		);
 	sceneBuilder->createIndexes();
+	if (settings.shouldCompressGeometry()) {
+		sceneBuilder->setGeometryCodec(repo::lib::RepoMeshCodec::Options());
+	}
 
 	auto serialiser = ifcUtils::IfcUtils::CreateSerialiser(filePath);
 
@@ -18,6 +18,7 @@
 #include "repo_model_import_oda.h"
 #include "repo/core/model/bson/repo_bson_factory.h"
 #include "repo/error_codes.h"
+#include "repo/manipulator/modelutility/repo_texture_processor.h"
 
 #ifdef ODA_SUPPORT
 #include <OdaCommon.h>
@@ -61,6 +62,16 @@ repo::core::model::RepoScene* OdaModelImport::importModel(std::string filePath,
 		settings.getRevisionId()
 	);
 	sceneBuilder->createIndexes();
+	if (settings.shouldCompressGeometry()) {
+		sceneBuilder->setGeometryCodec(repo::lib::RepoMeshCodec::Options());
+	}
+	if (settings.shouldProcessTextures()) {
+		repo::manipulator::modelutility::TextureProcessorOptions textureOptions;
+		textureOptions.maxDimension = std::max(settings.getMaxTextureSize(), 0);
+		textureOptions.generateMipLevels = settings.shouldGenerateTextureMipLevels();
+		textureOptions.numThreads = std::max(settings.getNumThreads(), 0);
+		sceneBuilder->setTextureProcessing(textureOptions);
+	}
 
 	odaProcessor = odaHelper::FileProcessor::getFileProcessor(filePath, sceneBuilder.get(), settings);
 	auto result = odaProcessor->readFile();
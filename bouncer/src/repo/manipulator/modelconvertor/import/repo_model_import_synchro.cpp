@@ -30,20 +30,6 @@ using namespace repo::manipulator::modelconvertor;
 const std::string RESOURCE_ID_NAME = "Resource ID";
 const std::string DEFAULT_SEQUENCE_NAME = "Unnamed Sequence";
 
-const static std::string SEQ_CACHE_LABEL_TRANSPARENCY = "transparency";
-const static std::string SEQ_CACHE_LABEL_COLOR = "color";
-const static std::string SEQ_CACHE_LABEL_TRANSFORMATION = "transformation";
-const static std::string SEQ_CACHE_LABEL_CLIP = "clip";
-const static std::string SEQ_CACHE_LABEL_VALUE = "value";
-const static std::string SEQ_CACHE_LABEL_SHARED_IDS = "shared_ids";
-const static std::string SEQ_CACHE_LABEL_CAMERA = "camera";
-const static std::string SEQ_CACHE_LABEL_POSITION = "position";
-const static std::string SEQ_CACHE_LABEL_DIRECTION = "direction";
-const static std::string SEQ_CACHE_LABEL_FORWARD = "forward";
-const static std::string SEQ_CACHE_LABEL_UP = "up";
-const static std::string SEQ_CACHE_LABEL_FOV = "fov";
-const static std::string SEQ_CACHE_LABEL_PERSPECTIVE = "perspective";
-
 class SynchroModelImport::CameraChange {
 public:
 	CameraChange(
@@ -201,13 +187,8 @@ std::unordered_map<std::string, repo::core::model::MeshNode> SynchroModelImport:
 repo::core::model::MeshNode* SynchroModelImport::createMeshNode(
 	const repo::core::model::MeshNode &templateMesh,
 	const std::vector<double> &transformation,
-	const std::vector<double> &offset,
 	const repo::lib::RepoUUID &parentID) {
-	auto trans = transformation;
-	//trans[3] -= offset[0];
-	//trans[7] -= offset[1];
-	//trans[11] -= offset[2];
-	auto matrix = repo::lib::RepoMatrix(trans);
+	auto matrix = repo::lib::RepoMatrix(transformation);
 	auto instance = templateMesh.cloneAndApplyTransformation(matrix);
 	instance.addParent(parentID);
 	instance.setUniqueID(repo::lib::RepoUUID::createUUID());
@@ -319,7 +300,21 @@ repo::core::model::RepoScene* SynchroModelImport::constructScene(
 	auto meshNodeTemplates = createMeshTemplateNodes();
 	std::vector<synchro_reader::Vector3D> bbox;
 	repoInfo << "Reading entities ";
-	for (const auto entity : reader->getEntities(bbox)) {
+	auto entities = reader->getEntities(bbox);
+
+	// When instancing, templates used by more than one entity keep their local
+	// geometry (see below), so count how many times each is used
+
+	std::unordered_map<std::string, size_t> templateReferences;
+	if (settings.shouldInstanceGeometry()) {
+		for (const auto& entity : entities) {
+			for (const auto& meshEntry : entity.second.meshes) {
+				templateReferences[meshEntry.geoId]++;
+			}
+		}
+	}
+
+	for (const auto& entity : entities) {
 		auto trans = createTransNode(identity, entity.second.name);
 		auto resourceID = entity.second.resourceID;
 		transNodes.insert(trans);
@@ -355,8 +350,20 @@ repo::core::model::RepoScene* SynchroModelImport::constructScene(
 				continue;
 			}
 
-			auto mesh = createMeshNode(meshNodeTemplates[meshID],
-				meshEntry.transformation, { bbox[0].x, bbox[0].y, bbox[0].z }, trans->getSharedID());
+			repo::core::model::MeshNode* mesh;
+			if (templateReferences[meshID] > 1) {
+				// Keep the geometry in the template's local space, under a transformation
+				// holding the instance matrix, so all instances of a template share the
+				// same vertex data (which the blob store then writes only once).
+				auto instance = createTransNode(repo::lib::RepoMatrix(meshEntry.transformation), {}, { trans->getSharedID() });
+				transNodes.insert(instance);
+				mesh = createMeshNode(meshNodeTemplates[meshID],
+					repo::lib::RepoMatrix64().getData(), instance->getSharedID());
+			}
+			else {
+				mesh = createMeshNode(meshNodeTemplates[meshID],
+					meshEntry.transformation, trans->getSharedID());
+			}
 
 			auto matNode = repoIDToNode[synchroIDToRepoID[matID]];
 			auto matNodeID = matNode->getUniqueID();
@@ -411,6 +418,7 @@ repo::core::model::RepoScene* SynchroModelImport::constructScene(
 		<< textNodes.size() << " textures, "
 		<< metaNodes.size() << " metadata ";
 	auto scene = new repo::core::model::RepoScene({ orgFile }, meshNodes, matNodes, metaNodes, textNodes, transNodes);
+	scene->setDeduplicateBinaries(settings.shouldInstanceGeometry());
 	auto origin = reader->getGlobalOffset();
 
 	/*std::vector<double> offset = { origin.x + bbox[0].x, origin.y + bbox[0].y, origin.z + bbox[0].z };*/
@@ -438,87 +446,85 @@ std::vector<float> SynchroModelImport::colourFrom32Bit(const uint32_t &color) co
 	return{ (float)colorArr[0] / 255.f, (float)colorArr[1] / 255.f, (float)colorArr[2] / 255.f };
 }
 
-std::string SynchroModelImport::generateCache(
+repo::manipulator::modelutility::SequenceFrameSnapshot SynchroModelImport::generateSnapshot(
 	const std::unordered_map<std::string, std::vector<repo::lib::RepoUUID>> &resourceIDsToSharedIDs,
 	const std::unordered_map<float, std::set<std::string>> &alphaValueToIDs,
 	const std::unordered_map<repo::lib::RepoUUID, std::pair<uint32_t, std::vector<float>>, repo::lib::RepoUUIDHasher> &meshColourState,
 	const std::unordered_map<std::string, std::vector<double>> &resourceIDTransState,
 	const std::unordered_map<repo::lib::RepoUUID, std::pair<repo::lib::RepoVector3D64, repo::lib::RepoVector3D64>, repo::lib::RepoUUIDHasher> &clipState,
-	const std::shared_ptr<CameraChange> &cam,
-	std::unordered_map<std::string, std::vector<uint8_t>> &stateBuffers) {
-	std::vector<repo::lib::PropertyTree> transparencyStates, colourStates, transformationStates, clipPlaneStates;
-	std::unordered_map<float, std::vector<std::string>> transToIDs;
-	std::unordered_map<uint32_t, std::vector<std::string>> colorToIDs;
+	const std::shared_ptr<CameraChange> &cam) {
+	repo::manipulator::modelutility::SequenceFrameSnapshot snapshot;
 
+	// The entries are taken in the iteration order of the state maps, so the
+	// serialised documents are the same as when they were written directly from
+	// the state.
+
+	std::unordered_map<uint32_t, std::vector<repo::lib::RepoUUID>> colorToIDs;
 	for (const auto &entry : meshColourState) {
 		if (!entry.second.second.size()) continue;
 		auto value = colourIn32Bit(entry.second.second);
 		if (value != entry.second.first) {
-			if (colorToIDs.find(value) == colorToIDs.end()) {
-				colorToIDs[value] = { entry.first.toString() };
-			}
-			else {
-				colorToIDs[value].push_back(entry.first.toString());
-			}
+			colorToIDs[value].push_back(entry.first);
 		}
 	}
+	for (auto &entry : colorToIDs) {
+		snapshot.colour.push_back({ colourFrom32Bit(entry.first), std::move(entry.second) });
+	}
+
 	if (settings.shouldImportAnimations()) {
 		for (const auto &entry : resourceIDTransState) {
-			if (resourceIDsToSharedIDs.find(entry.first) != resourceIDsToSharedIDs.end()
-				&& resourceIDsToSharedIDs.at(entry.first).size()) {
-				repo::lib::PropertyTree transformTree;
-				transformTree.addToTree(SEQ_CACHE_LABEL_VALUE, entry.second);
-				std::vector<repo::lib::RepoUUID> idArr = resourceIDsToSharedIDs.at(entry.first);
-				transformTree.addToTree(SEQ_CACHE_LABEL_SHARED_IDS, idArr);
-				transformationStates.push_back(transformTree);
+			auto ids = resourceIDsToSharedIDs.find(entry.first);
+			if (ids != resourceIDsToSharedIDs.end() && ids->second.size()) {
+				snapshot.transformation.push_back({ entry.second, ids->second });
 			}
 		}
 	}
 
-	for (const auto &entry : clipState) {
-		repo::lib::PropertyTree clipTree, valueTree;
-		valueTree.addToTree(SEQ_CACHE_LABEL_POSITION, entry.second.first);
-		valueTree.addToTree(SEQ_CACHE_LABEL_DIRECTION, entry.second.second);
-		clipTree.mergeSubTree(SEQ_CACHE_LABEL_VALUE, valueTree);
-		std::vector<repo::lib::RepoUUID> idArr = { entry.first };
-		clipTree.addToTree(SEQ_CACHE_LABEL_SHARED_IDS, idArr);
-		clipPlaneStates.push_back(clipTree);
-	}
+	snapshot.clip.assign(clipState.begin(), clipState.end());
 
 	for (const auto &entry : alphaValueToIDs) {
 		if (!entry.second.size()) continue;
-		repo::lib::PropertyTree transTree;
-		transTree.addToTree(SEQ_CACHE_LABEL_VALUE, entry.first);
-		transTree.addToTree(SEQ_CACHE_LABEL_SHARED_IDS, entry.second);
-		transparencyStates.push_back(transTree);
+		snapshot.transparency.push_back({ entry.first, std::vector<std::string>(entry.second.begin(), entry.second.end()) });
 	}
 
-	for (const auto &entry : colorToIDs) {
-		repo::lib::PropertyTree colTree;
-		colTree.addToTree(SEQ_CACHE_LABEL_VALUE, colourFrom32Bit(entry.first));
-		colTree.addToTree(SEQ_CACHE_LABEL_SHARED_IDS, entry.second);
-		colourStates.push_back(colTree);
+	if (cam) {
+		snapshot.camera = repo::manipulator::modelutility::SequenceFrameState::Camera{
+			cam->position, cam->forward, cam->up, cam->fov, cam->isPerspective
+		};
 	}
-	repo::lib::PropertyTree bufferTree;
-	if (transparencyStates.size()) bufferTree.addArrayObjects(SEQ_CACHE_LABEL_TRANSPARENCY, transparencyStates);
-	if (colourStates.size()) bufferTree.addArrayObjects(SEQ_CACHE_LABEL_COLOR, colourStates);
-	if (transformationStates.size()) bufferTree.addArrayObjects(SEQ_CACHE_LABEL_TRANSFORMATION, transformationStates);
-	if (clipPlaneStates.size()) bufferTree.addArrayObjects(SEQ_CACHE_LABEL_CLIP, clipPlaneStates);
 
-	if (cam) {
-		repo::lib::PropertyTree camTree;
-		camTree.addToTree(SEQ_CACHE_LABEL_POSITION, cam->position);
-		camTree.addToTree(SEQ_CACHE_LABEL_FORWARD, cam->forward);
-		camTree.addToTree(SEQ_CACHE_LABEL_UP, cam->up);
-		camTree.addToTree(SEQ_CACHE_LABEL_PERSPECTIVE, cam->isPerspective ? "true" : "false");
-		camTree.addToTree(SEQ_CACHE_LABEL_FOV, cam->fov);
-		bufferTree.mergeSubTree(SEQ_CACHE_LABEL_CAMERA, camTree);
+	return snapshot;
+}
+
+repo::manipulator::modelutility::SequenceFrameState SynchroModelImport::generateFrameState(
+	const repo::manipulator::modelutility::SequenceFrameSnapshot &snapshot) {
+	repo::manipulator::modelutility::SequenceFrameState state;
+
+	for (const auto &entry : snapshot.colour) {
+		for (const auto &id : entry.second) {
+			state.colour[id] = { entry.first[0], entry.first[1], entry.first[2] };
+		}
 	}
 
-	auto id = repo::lib::RepoUUID::createUUID().toString();
+	for (const auto &entry : snapshot.transformation) {
+		for (const auto &id : entry.second) {
+			state.transformation[id] = entry.first;
+		}
+	}
 
-	stateBuffers[id] = bufferTree.writeJsonToBuffer();
-	return id;
+	for (const auto &entry : snapshot.clip) {
+		state.clip[entry.first] = entry.second;
+	}
+
+	for (const auto &entry : snapshot.transparency) {
+		for (const auto &id : entry.second) {
+			state.transparency[repo::lib::RepoUUID(id)] = entry.first;
+		}
+	}
+
+	state.camera = snapshot.camera;
+
+	return state;
 }
 
 repo::lib::RepoMatrix64 SynchroModelImport::convertMatrixTo3DRepoWorld(
@@ -877,14 +883,43 @@ repo::core::model::RepoScene* SynchroModelImport::generateRepoScene(uint8_t &err
 		auto total = animation.frames.size();
 		int step = total > 10 ? total / 10 : 1;
 
+		// The binary cache stores the frames as deltas packed into a few files, and
+		// is referenced from the sequence by its index. Otherwise each frame is a
+		// separate JSON document.
+
+		std::unique_ptr<repo::manipulator::modelutility::SequenceCacheWriter> cacheWriter;
+		if (settings.shouldUseBinarySequenceCache()) {
+			cacheWriter = std::make_unique<repo::manipulator::modelutility::SequenceCacheWriter>(64, 32 * 1024 * 1024, settings.getNumThreads());
+		}
+
+		// Otherwise, only advancing the state has to happen in order. Each frame is
+		// snapshotted here and its document written on the serialiser's threads.
+
+		std::unique_ptr<repo::manipulator::modelutility::SequenceFrameSerialiser> serialiser;
+		if (!cacheWriter) {
+			serialiser = std::make_unique<repo::manipulator::modelutility::SequenceFrameSerialiser>(settings.getNumThreads());
+		}
+
+		auto addFrame = [&](uint64_t timestamp) {
+			repo::core::model::RepoSequence::FrameData data;
+			data.timestamp = timestamp;
+			if (cacheWriter) {
+				auto state = generateFrameState(generateSnapshot(resourceIDsToSharedIDs, alphaValueToIDs, meshColourState, resourceIDTransState, clipState, cam));
+				state.timestamp = timestamp;
+				cacheWriter->addFrame(state);
+			}
+			else {
+				data.ref = repo::lib::RepoUUID::createUUID().toString();
+				serialiser->addFrame(generateSnapshot(resourceIDsToSharedIDs, alphaValueToIDs, meshColourState, resourceIDTransState, clipState, cam));
+			}
+			frameData.push_back(data);
+		};
+
 		if (animation.frames.begin()->first > firstFrame &&
 			resourceIDTransState.size()) {
 			//First animation frame is bigger than the task frame
 			//And we have animations... need to reset the state of the transforms.
-			repo::core::model::RepoSequence::FrameData data;
-			data.ref = generateCache(resourceIDsToSharedIDs, alphaValueToIDs, meshColourState, resourceIDTransState, clipState, cam, stateBuffers);
-			data.timestamp = firstFrame;
-			frameData.push_back(data);
+			addFrame(firstFrame);
 		}
 
 		for (const auto &currentFrame : animation.frames) {
@@ -893,10 +928,7 @@ repo::core::model::RepoScene* SynchroModelImport::generateRepoScene(uint8_t &err
 			lastFrame = std::max(lastFrame, currentTime * 1000);
 
 			updateFrameState(currentFrame.second, resourceIDsToSharedIDs, resourceIDLastTrans, alphaValueToIDs, meshAlphaState, meshColourState, resourceIDTransState, clipState, cam, transformingResources, offset);
-			repo::core::model::RepoSequence::FrameData data;
-			data.ref = generateCache(resourceIDsToSharedIDs, alphaValueToIDs, meshColourState, resourceIDTransState, clipState, cam, stateBuffers);
-			data.timestamp = currentTime;
-			frameData.push_back(data);
+			addFrame(currentTime);
 			if (++count % step == 0) {
 				repoInfo << "Processed " << count << " of " << total << " frames";
 			};
@@ -912,8 +944,28 @@ repo::core::model::RepoScene* SynchroModelImport::generateRepoScene(uint8_t &err
 			}
 		}
 
+		if (cacheWriter) {
+			auto files = cacheWriter->finalise();
+			for (size_t i = 0; i < frameData.size(); i++) {
+				frameData[i].ref = cacheWriter->getFileName(i);
+			}
+			repoInfo << "Binary sequence cache written to " << files.size() << " files";
+			for (auto &file : files) {
+				stateBuffers[file.first] = std::move(file.second);
+			}
+		}
+		else {
+			auto documents = serialiser->finalise();
+			for (size_t i = 0; i < frameData.size(); i++) {
+				stateBuffers[frameData[i].ref] = std::move(documents[i]);
+			}
+		}
+
 		std::string animationName = animation.name.empty() ? DEFAULT_SEQUENCE_NAME : animation.name;
 		auto sequence = repo::core::model::RepoBSONFactory::makeSequence(frameData, animationName, sequenceID, firstFrame, lastFrame);
+		if (cacheWriter) {
+			sequence.setCacheIndex(cacheWriter->getIndexName());
+		}
 
 		if (!sequence.isSizeOK()) {
 			errMsg = REPOERR_SYNCHRO_SEQUENCE_TOO_BIG;
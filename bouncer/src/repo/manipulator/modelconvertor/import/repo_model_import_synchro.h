@@ -32,6 +32,8 @@
 #include "../../../core/model/bson/repo_node_transformation.h"
 #include "../../../core/model/bson/repo_node_texture.h"
 #include "../../../lib/repo_property_tree.h"
+#include "../../modelutility/repo_sequence_cache.h"
+#include "../../modelutility/repo_sequence_frame_serialiser.h"
 #include "../../../error_codes.h"
 
 namespace repo {
@@ -118,7 +120,6 @@ namespace repo {
 				repo::core::model::MeshNode* createMeshNode(
 					const repo::core::model::MeshNode &templateMesh,
 					const std::vector<double> &transformation,
-					const std::vector<double> &offset,
 					const repo::lib::RepoUUID &parentID);
 
 				repo::core::model::RepoScene* constructScene(
@@ -129,14 +130,24 @@ namespace repo {
 
 				std::vector<float> colourFrom32Bit(const uint32_t &color) const;
 
-				std::string generateCache(
+				/**
+				* Captures the state of the current frame, to be written as a JSON
+				* document by a SequenceFrameSerialiser
+				*/
+				repo::manipulator::modelutility::SequenceFrameSnapshot generateSnapshot(
 					const std::unordered_map<std::string, std::vector<repo::lib::RepoUUID>> &resourceIDsToSharedIDs,
 					const std::unordered_map<float, std::set<std::string>> &alphaValueToIDs,
 					const std::unordered_map<repo::lib::RepoUUID, std::pair<uint32_t, std::vector<float>>, repo::lib::RepoUUIDHasher> &meshColourState,
 					const std::unordered_map<std::string, std::vector<double>> &resourceIDTransState,
 					const std::unordered_map<repo::lib::RepoUUID, std::pair<repo::lib::RepoVector3D64, repo::lib::RepoVector3D64>, repo::lib::RepoUUIDHasher> &clipState,
-					const std::shared_ptr<CameraChange> &cam,
-					std::unordered_map<std::string, std::vector<uint8_t>> &stateBuffers);
+					const std::shared_ptr<CameraChange> &cam);
+
+				/**
+				* Converts a snapshot from generateSnapshot into the per-id state used
+				* by the binary sequence cache
+				*/
+				repo::manipulator::modelutility::SequenceFrameState generateFrameState(
+					const repo::manipulator::modelutility::SequenceFrameSnapshot &snapshot);
 
 				void updateFrameState(
 					const std::vector<std::shared_ptr<synchro_reader::AnimationTask>> &tasks,
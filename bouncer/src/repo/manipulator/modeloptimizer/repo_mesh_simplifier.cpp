@@ -0,0 +1,1232 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "repo_mesh_simplifier.h"
+
+#include "repo/core/model/bson/repo_bson_factory.h"
+#include "repo/core/model/bson/repo_node_supermesh.h"
+#include "repo/lib/datastructure/repo_bounds.h"
+
+#include <repo_log.h>
+
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+using namespace repo::manipulator::modeloptimizer;
+using namespace repo::lib;
+
+// Collapses that rotate the normal of a face by more than this (as the cosine
+// of the angle) are rejected, so the simplified surface doesn't fold over.
+#define REPO_SIMPLIFIER_MIN_FACE_ROTATION 0.25
+
+// Within each pass, collapses are made in order of priority until they reach
+// this factor of the priority at which the target would be met. Beyond that
+// the priorities are likely to have changed, so they are evaluated again in
+// the next pass.
+#define REPO_SIMPLIFIER_PASS_LIMIT 1.5f
+
+// Each pass rebuilds the adjacency of the remaining faces, so the number of
+// passes is limited in case collapses run out very slowly.
+#define REPO_SIMPLIFIER_MAX_PASSES 100
+
+namespace {
+
+	static const uint32_t INVALID = UINT32_MAX;
+
+	struct Quadric
+	{
+		double a2 = 0, ab = 0, ac = 0, ad = 0;
+		double b2 = 0, bc = 0, bd = 0;
+		double c2 = 0, cd = 0;
+		double d2 = 0;
+
+		// Adds the squared distance to the plane ax + by + cz + d = 0, where
+		// (a, b, c) is a unit vector
+		void addPlane(double a, double b, double c, double d, double w)
+		{
+			a2 += w * a * a;
+			ab += w * a * b;
+			ac += w * a * c;
+			ad += w * a * d;
+			b2 += w * b * b;
+			bc += w * b * c;
+			bd += w * b * d;
+			c2 += w * c * c;
+			cd += w * c * d;
+			d2 += w * d * d;
+		}
+
+		Quadric& operator+=(const Quadric& q)
+		{
+			a2 += q.a2;
+			ab += q.ab;
+			ac += q.ac;
+			ad += q.ad;
+			b2 += q.b2;
+			bc += q.bc;
+			bd += q.bd;
+			c2 += q.c2;
+			cd += q.cd;
+			d2 += q.d2;
+			return *this;
+		}
+
+		double error(const RepoVector3D& p) const
+		{
+			double x = p.x, y = p.y, z = p.z;
+			auto e = a2 * x * x + b2 * y * y + c2 * z * z +
+				2 * (ab * x * y + ac * x * z + bc * y * z) +
+				2 * (ad * x + bd * y + cd * z) +
+				d2;
+			return std::max(e, 0.0); // May be slightly negative due to rounding
+		}
+	};
+
+	size_t hashPosition(const RepoVector3D& v)
+	{
+		uint32_t bits[3];
+		std::memcpy(bits, &v.x, sizeof(float));
+		std::memcpy(bits + 1, &v.y, sizeof(float));
+		std::memcpy(bits + 2, &v.z, sizeof(float));
+		uint64_t h = bits[0];
+		h = h * 0x9E3779B97F4A7C15ull ^ bits[1];
+		h = h * 0x9E3779B97F4A7C15ull ^ bits[2];
+		return (size_t)(h ^ (h >> 29));
+	}
+
+	enum class Kind : uint8_t
+	{
+		Manifold, // Interior vertex with one set of attributes; may collapse anywhere
+		Border, // On an open boundary; may only collapse along the boundary
+		Seam, // Has two sets of attributes; may only collapse along the seam
+		Locked // Corners of seams and boundaries, and non-manifold vertices
+	};
+
+	struct Collapse
+	{
+		uint32_t from;
+		uint32_t to;
+		double error;
+		double priority;
+	};
+
+	/*
+	* The state of the simplification of one range of faces. Vertices of the
+	* original buffer are referred to as wedges, and the topology is built on
+	* positions, each of which has one or more wedges.
+	*/
+	class Simplification
+	{
+	public:
+		Simplification(
+			const MeshSimplifier::Options& options,
+			const std::vector<RepoVector3D>& vertices,
+			const std::vector<RepoVector3D>& normals,
+			const std::vector<std::vector<RepoVector2D>>& uvChannels,
+			const std::vector<repo_face_t>& faces,
+			size_t begin,
+			size_t end) :
+			options(options),
+			vertices(vertices),
+			normals(normals),
+			uvChannels(uvChannels),
+			faces(faces),
+			begin(begin),
+			end(end)
+		{
+			weld();
+			initialiseQuadrics();
+		}
+
+		void run(size_t targetFaces, double maxError)
+		{
+			auto limit = maxError * maxError + epsilon;
+			for (int pass = 0; pass < REPO_SIMPLIFIER_MAX_PASSES && numLiveFaces > targetFaces; pass++)
+			{
+				buildAdjacency();
+				classify();
+				auto collapses = findCollapses(limit);
+				if (!collapses.size()) {
+					break;
+				}
+				if (!applyCollapses(collapses, targetFaces)) {
+					break;
+				}
+			}
+		}
+
+		std::vector<repo_face_t> getFaces() const
+		{
+			std::vector<repo_face_t> result;
+			result.reserve(numLiveFaces + (end - begin - triangles.size()));
+			size_t t = 0;
+			for (size_t i = begin; i < end; i++) {
+				if (faces[i].size() == 3) {
+					if (live[t]) {
+						repo_face_t face;
+						for (int k = 0; k < 3; k++) {
+							face.push_back(wedgeVertex[corners[t][k]]);
+						}
+						result.push_back(face);
+					}
+					t++;
+				}
+				else {
+					result.push_back(faces[i]); // Other primitives are passed through
+				}
+			}
+			return result;
+		}
+
+	private:
+		const MeshSimplifier::Options& options;
+		const std::vector<RepoVector3D>& vertices;
+		const std::vector<RepoVector3D>& normals;
+		const std::vector<std::vector<RepoVector2D>>& uvChannels;
+		const std::vector<repo_face_t>& faces;
+		size_t begin;
+		size_t end;
+
+		// Wedges; indices into the original vertex buffer, and the position of each
+		std::vector<uint32_t> wedgeVertex;
+		std::vector<uint32_t> wedgePosition;
+		std::vector<uint32_t> nextWedge; // Linked list of the wedges of each position
+
+		// Positions
+		std::vector<RepoVector3D> positions;
+		std::vector<uint32_t> firstWedge;
+		std::vector<uint32_t> numWedges;
+		std::vector<Quadric> quadrics;
+		std::vector<Kind> kinds;
+		std::vector<uint8_t> touched;
+
+		// Triangles; the positions and wedges of each corner
+		std::vector<std::array<uint32_t, 3>> triangles;
+		std::vector<std::array<uint32_t, 3>> corners;
+		std::vector<uint8_t> live;
+		size_t numLiveFaces = 0;
+
+		// Adjacency from positions to live triangles, rebuilt each pass
+		std::vector<uint32_t> adjacencyOffsets;
+		std::vector<uint32_t> adjacency;
+
+		// Scratch space for the link condition
+		std::vector<uint32_t> marks;
+		uint32_t stamp = 0;
+
+		double attributeScale = 0;
+		double epsilon = 0;
+
+		void weld()
+		{
+			uint32_t minVertex = UINT32_MAX, maxVertex = 0;
+			for (size_t i = begin; i < end; i++) {
+				if (faces[i].size() == 3) {
+					for (int k = 0; k < 3; k++) {
+						minVertex = std::min(minVertex, faces[i][k]);
+						maxVertex = std::max(maxVertex, faces[i][k]);
+					}
+				}
+			}
+			if (minVertex > maxVertex) {
+				return;
+			}
+
+			std::vector<uint32_t> vertexWedge(maxVertex - minVertex + 1, INVALID);
+
+			// Positions are welded with an open addressing hash table, at most
+			// half full, of indices into positions
+
+			size_t tableSize = 1;
+			while (tableSize < (maxVertex - minVertex + 1) * 2) {
+				tableSize *= 2;
+			}
+			std::vector<uint32_t> table(tableSize, INVALID);
+
+			RepoBounds bounds;
+
+			auto getWedge = [&](uint32_t vertex) {
+				auto& w = vertexWedge[vertex - minVertex];
+				if (w != INVALID) {
+					return w;
+				}
+
+				auto p = vertices[vertex];
+				p.x += 0.0f; // Treat -0 as 0
+				p.y += 0.0f;
+				p.z += 0.0f;
+
+				auto slot = hashPosition(p) & (tableSize - 1);
+				while (table[slot] != INVALID && !(positions[table[slot]] == p)) {
+					slot = (slot + 1) & (tableSize - 1);
+				}
+
+				auto position = table[slot];
+				if (position == INVALID) {
+					position = positions.size();
+					table[slot] = position;
+					positions.push_back(p);
+					firstWedge.push_back(INVALID);
+					numWedges.push_back(0);
+					bounds.encapsulate(RepoVector3D64(p.x, p.y, p.z));
+				}
+
+				// Vertices with identical attributes at the same position are
+				// treated as one, so they don't form a seam
+
+				for (auto o = firstWedge[position]; o != INVALID; o = nextWedge[o]) {
+					if (attributeDistance(wedgeVertex[o], vertex, 1, 1) == 0) {
+						w = o;
+						return w;
+					}
+				}
+
+				w = wedgeVertex.size();
+				wedgeVertex.push_back(vertex);
+				wedgePosition.push_back(position);
+				nextWedge.push_back(firstWedge[position]);
+				firstWedge[position] = w;
+				numWedges[position]++;
+				return w;
+			};
+
+			for (size_t i = begin; i < end; i++) {
+				if (faces[i].size() != 3) {
+					continue;
+				}
+				std::array<uint32_t, 3> c;
+				std::array<uint32_t, 3> t;
+				for (int k = 0; k < 3; k++) {
+					c[k] = getWedge(faces[i][k]);
+					t[k] = wedgePosition[c[k]];
+				}
+				corners.push_back(c);
+				triangles.push_back(t);
+
+				// Triangles that have collapsed to a line or point already are
+				// invisible, so are dropped straight away
+
+				bool degenerate = t[0] == t[1] || t[1] == t[2] || t[2] == t[0];
+				live.push_back(!degenerate);
+				numLiveFaces += !degenerate;
+			}
+
+			auto diagonal = positions.size() ? bounds.size().norm() : 0;
+			attributeScale = diagonal * diagonal;
+			epsilon = attributeScale * 1e-12;
+
+			quadrics.resize(positions.size());
+			kinds.resize(positions.size());
+			touched.resize(positions.size());
+			marks.resize(positions.size());
+		}
+
+		double attributeDistance(uint32_t a, uint32_t b, double normalWeight, double uvWeight) const
+		{
+			double d = 0;
+			if (normals.size() == vertices.size()) {
+				auto n = normals[a] - normals[b];
+				d += normalWeight * (n.x * n.x + n.y * n.y + n.z * n.z);
+			}
+			for (const auto& uvs : uvChannels) {
+				if (uvs.size() == vertices.size()) {
+					double u = uvs[a].x - uvs[b].x;
+					double v = uvs[a].y - uvs[b].y;
+					d += uvWeight * (u * u + v * v);
+				}
+			}
+			return d;
+		}
+
+		RepoVector3D faceNormal(const RepoVector3D& a, const RepoVector3D& b, const RepoVector3D& c) const
+		{
+			auto ab = b - a;
+			auto ac = c - a;
+			return ab.crossProduct(ac);
+		}
+
+		void initialiseQuadrics()
+		{
+			buildAdjacency();
+
+			for (size_t t = 0; t < triangles.size(); t++) {
+				if (!live[t]) {
+					continue;
+				}
+				const auto& tri = triangles[t];
+				auto n = faceNormal(positions[tri[0]], positions[tri[1]], positions[tri[2]]);
+				if (n.norm() <= 0) {
+					continue; // Degenerate triangles have no plane
+				}
+				n.normalize();
+
+				Quadric q;
+				q.addPlane(n.x, n.y, n.z, -n.dotProduct(positions[tri[0]]), 1);
+				for (int k = 0; k < 3; k++) {
+					quadrics[tri[k]] += q;
+				}
+
+				// Edges with only one face are on the boundary, and get a plane
+				// perpendicular to the face to keep them in place
+
+				for (int k = 0; k < 3; k++) {
+					auto a = tri[k];
+					auto b = tri[(k + 1) % 3];
+					if (countSharedFaces(a, b) != 1) {
+						continue;
+					}
+					auto e = positions[b] - positions[a];
+					auto m = e.crossProduct(n);
+					if (m.norm() <= 0) {
+						continue;
+					}
+					m.normalize();
+					Quadric bq;
+					bq.addPlane(m.x, m.y, m.z, -m.dotProduct(positions[a]), options.boundaryWeight);
+					quadrics[a] += bq;
+					quadrics[b] += bq;
+				}
+			}
+		}
+
+		void buildAdjacency()
+		{
+			adjacencyOffsets.assign(positions.size() + 1, 0);
+			for (size_t t = 0; t < triangles.size(); t++) {
+				if (live[t]) {
+					for (int k = 0; k < 3; k++) {
+						adjacencyOffsets[triangles[t][k] + 1]++;
+					}
+				}
+			}
+			for (size_t p = 0; p < positions.size(); p++) {
+				adjacencyOffsets[p + 1] += adjacencyOffsets[p];
+			}
+			adjacency.resize(adjacencyOffsets.back());
+			std::vector<uint32_t> cursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (size_t t = 0; t < triangles.size(); t++) {
+				if (live[t]) {
+					for (int k = 0; k < 3; k++) {
+						adjacency[cursor[triangles[t][k]]++] = t;
+					}
+				}
+			}
+		}
+
+		template<typename F>
+		void forEachFace(uint32_t position, F f) const
+		{
+			for (auto i = adjacencyOffsets[position]; i < adjacencyOffsets[position + 1]; i++) {
+				if (live[adjacency[i]]) {
+					f(adjacency[i]);
+				}
+			}
+		}
+
+		bool contains(uint32_t t, uint32_t position) const
+		{
+			const auto& tri = triangles[t];
+			return tri[0] == position || tri[1] == position || tri[2] == position;
+		}
+
+		int cornerOf(uint32_t t, uint32_t position) const
+		{
+			const auto& tri = triangles[t];
+			return tri[0] == position ? 0 : (tri[1] == position ? 1 : 2);
+		}
+
+		size_t countSharedFaces(uint32_t a, uint32_t b) const
+		{
+			size_t count = 0;
+			forEachFace(a, [&](uint32_t t) {
+				count += contains(t, b);
+			});
+			return count;
+		}
+
+		void classify()
+		{
+			std::vector<uint32_t> next, prev;
+			for (uint32_t p = 0; p < positions.size(); p++) {
+				touched[p] = false;
+
+				// A vertex is on a boundary if its outgoing and incoming edges
+				// don't pair up, and non-manifold if any edge appears twice
+
+				next.clear();
+				prev.clear();
+				forEachFace(p, [&](uint32_t t) {
+					auto k = cornerOf(t, p);
+					next.push_back(triangles[t][(k + 1) % 3]);
+					prev.push_back(triangles[t][(k + 2) % 3]);
+				});
+				std::sort(next.begin(), next.end());
+				std::sort(prev.begin(), prev.end());
+
+				bool manifold = std::adjacent_find(next.begin(), next.end()) == next.end() &&
+					std::adjacent_find(prev.begin(), prev.end()) == prev.end();
+				bool border = next != prev;
+				auto wedges = numWedges[p];
+
+				if (!manifold || wedges > 2 || (border && wedges > 1)) {
+					kinds[p] = Kind::Locked;
+				}
+				else if (border) {
+					kinds[p] = Kind::Border;
+				}
+				else if (wedges > 1) {
+					kinds[p] = Kind::Seam;
+				}
+				else {
+					kinds[p] = Kind::Manifold;
+				}
+			}
+		}
+
+		// Returns the wedge of a position with the attributes closest to those
+		// of the given wedge
+		uint32_t closestWedge(uint32_t wedge, uint32_t position, double& distance) const
+		{
+			auto best = firstWedge[position];
+			distance = DBL_MAX;
+			for (auto w = firstWedge[position]; w != INVALID; w = nextWedge[w]) {
+				auto d = attributeDistance(wedgeVertex[wedge], wedgeVertex[w], options.normalWeight, options.uvWeight);
+				if (d < distance) {
+					distance = d;
+					best = w;
+				}
+			}
+			return best;
+		}
+
+		bool evaluate(uint32_t from, uint32_t to, double limit, Collapse& collapse) const
+		{
+			if (kinds[from] == Kind::Locked) {
+				return false;
+			}
+			if (kinds[from] == Kind::Seam && numWedges[to] < 2) {
+				return false;
+			}
+
+			collapse.from = from;
+			collapse.to = to;
+			collapse.error = quadrics[from].error(positions[to]) + quadrics[to].error(positions[to]);
+			if (collapse.error > limit) {
+				return false;
+			}
+
+			// Away from seams, each end has one set of attributes, so there is no
+			// need to look at the faces
+
+			double attributes = 0;
+			if (numWedges[from] == 1 && numWedges[to] == 1) {
+				attributes = attributeDistance(wedgeVertex[firstWedge[from]], wedgeVertex[firstWedge[to]], options.normalWeight, options.uvWeight);
+			}
+			else {
+				forEachFace(from, [&](uint32_t t) {
+					if (!contains(t, to)) {
+						double d;
+						closestWedge(corners[t][cornerOf(t, from)], to, d);
+						attributes = std::max(attributes, d);
+					}
+				});
+			}
+			collapse.priority = collapse.error + attributes * attributeScale;
+
+			return true;
+		}
+
+		std::vector<Collapse> findCollapses(double limit) const
+		{
+			std::vector<Collapse> collapses;
+			for (size_t t = 0; t < triangles.size(); t++) {
+				if (!live[t]) {
+					continue;
+				}
+				for (int k = 0; k < 3; k++) {
+					auto a = triangles[t][k];
+					auto b = triangles[t][(k + 1) % 3];
+
+					// Interior edges are shared by two faces in opposite directions,
+					// so are only considered from one of them
+
+					bool boundary = kinds[a] == Kind::Border || kinds[b] == Kind::Border;
+					if (a > b && !boundary) {
+						continue;
+					}
+
+					Collapse ab, ba;
+					bool validAb = evaluate(a, b, limit, ab);
+					bool validBa = evaluate(b, a, limit, ba);
+					if (validAb && (!validBa || ab.priority <= ba.priority)) {
+						collapses.push_back(ab);
+					}
+					else if (validBa) {
+						collapses.push_back(ba);
+					}
+				}
+			}
+			return collapses;
+		}
+
+		// Checks the collapse against the current state of the mesh, as the
+		// neighbourhood may have changed since it was evaluated
+		bool isValid(const Collapse& c)
+		{
+			auto from = c.from;
+			auto to = c.to;
+
+			std::array<uint32_t, 2> shared;
+			size_t numShared = 0;
+			forEachFace(from, [&](uint32_t t) {
+				if (contains(t, to)) {
+					if (numShared < 2) {
+						shared[numShared] = t;
+					}
+					numShared++;
+				}
+			});
+
+			// Boundaries and seams must collapse along themselves
+
+			if (kinds[from] == Kind::Border && numShared != 1) {
+				return false;
+			}
+			if (kinds[from] != Kind::Border && numShared != 2) {
+				return false;
+			}
+			if (kinds[from] == Kind::Seam &&
+				corners[shared[0]][cornerOf(shared[0], from)] == corners[shared[1]][cornerOf(shared[1], from)]) {
+				return false;
+			}
+
+			// The link condition: the only vertices adjacent to both ends of the
+			// edge must be the opposite corners of the faces that share it. The
+			// neighbours of one end are marked, then counted from the other,
+			// with each marked again as it is counted so it is only counted once.
+
+			if (stamp > UINT32_MAX - 2) {
+				std::fill(marks.begin(), marks.end(), 0);
+				stamp = 0;
+			}
+			auto neighbour = ++stamp;
+			auto counted = ++stamp;
+
+			forEachFace(to, [&](uint32_t t) {
+				for (auto p : triangles[t]) {
+					marks[p] = neighbour;
+				}
+			});
+			marks[from] = 0;
+			marks[to] = 0;
+
+			size_t common = 0;
+			forEachFace(from, [&](uint32_t t) {
+				for (auto p : triangles[t]) {
+					if (marks[p] == neighbour) {
+						marks[p] = counted;
+						common++;
+					}
+				}
+			});
+			if (common != numShared) {
+				return false;
+			}
+
+			// The faces that remain must not flip or become degenerate
+
+			bool valid = true;
+			forEachFace(from, [&](uint32_t t) {
+				if (!valid || contains(t, to)) {
+					return;
+				}
+				const auto& tri = triangles[t];
+				auto k = cornerOf(t, from);
+				auto before = faceNormal(positions[tri[0]], positions[tri[1]], positions[tri[2]]);
+				auto beforeLength = before.norm();
+				if (beforeLength <= 0) {
+					return;
+				}
+				std::array<RepoVector3D, 3> p = { positions[tri[0]], positions[tri[1]], positions[tri[2]] };
+				p[k] = positions[to];
+				auto after = faceNormal(p[0], p[1], p[2]);
+				if (before.dotProduct(after) <= REPO_SIMPLIFIER_MIN_FACE_ROTATION * beforeLength * after.norm()) {
+					valid = false;
+				}
+			});
+
+			return valid;
+		}
+
+		void apply(const Collapse& c)
+		{
+			forEachFace(c.from, [&](uint32_t t) {
+				if (contains(t, c.to)) {
+					live[t] = false;
+					numLiveFaces--;
+				}
+				else {
+					auto k = cornerOf(t, c.from);
+					double d;
+					triangles[t][k] = c.to;
+					corners[t][k] = closestWedge(corners[t][k], c.to, d);
+				}
+			});
+			quadrics[c.to] += quadrics[c.from];
+			touched[c.from] = true;
+			touched[c.to] = true;
+		}
+
+		bool applyCollapses(std::vector<Collapse>& collapses, size_t targetFaces)
+		{
+			auto byPriority = [](const Collapse& a, const Collapse& b) {
+				return a.priority < b.priority;
+			};
+
+			// Most collapses remove two faces. Only the collapses within the limit
+			// for this pass need to be sorted.
+
+			auto goal = std::min((numLiveFaces - targetFaces) / 2, collapses.size() - 1);
+			std::nth_element(collapses.begin(), collapses.begin() + goal, collapses.end(), byPriority);
+			auto passLimit = collapses[goal].priority * REPO_SIMPLIFIER_PASS_LIMIT + epsilon;
+
+			auto end = std::partition(collapses.begin() + goal, collapses.end(), [&](const Collapse& c) {
+				return c.priority <= passLimit;
+			});
+			collapses.erase(end, collapses.end());
+			std::sort(collapses.begin(), collapses.end(), byPriority);
+
+			size_t applied = 0;
+			for (const auto& c : collapses) {
+				if (numLiveFaces <= targetFaces || c.priority > passLimit) {
+					break;
+				}
+				if (touched[c.from] || touched[c.to]) {
+					continue;
+				}
+				if (!isValid(c)) {
+					continue;
+				}
+				apply(c);
+				applied++;
+			}
+			return applied > 0;
+		}
+	};
+
+	double closestPointDistance(const RepoVector3D64& p, RepoVector3D64 a, RepoVector3D64 b, RepoVector3D64 c)
+	{
+		// Closest point on a triangle, from Ericson, Real-Time Collision Detection
+
+		auto ab = b - a;
+		auto ac = c - a;
+		auto ap = p - a;
+		double d1 = ab.dotProduct(ap);
+		double d2 = ac.dotProduct(ap);
+		if (d1 <= 0 && d2 <= 0) {
+			return ap.norm();
+		}
+		auto bp = p - b;
+		double d3 = ab.dotProduct(bp);
+		double d4 = ac.dotProduct(bp);
+		if (d3 >= 0 && d4 <= d3) {
+			return bp.norm();
+		}
+		auto cp = p - c;
+		double d5 = ab.dotProduct(cp);
+		double d6 = ac.dotProduct(cp);
+		if (d6 >= 0 && d5 <= d6) {
+			return cp.norm();
+		}
+
+		auto along = [&](const RepoVector3D64& o, const RepoVector3D64& e, double t) {
+			return (p - (o + RepoVector3D64(e.x * t, e.y * t, e.z * t))).norm();
+		};
+
+		double vc = d1 * d4 - d3 * d2;
+		if (vc <= 0 && d1 >= 0 && d3 <= 0) {
+			return along(a, ab, d1 / (d1 - d3));
+		}
+		double vb = d5 * d2 - d1 * d6;
+		if (vb <= 0 && d2 >= 0 && d6 <= 0) {
+			return along(a, ac, d2 / (d2 - d6));
+		}
+		double va = d3 * d6 - d5 * d4;
+		if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0) {
+			return along(b, c - b, (d4 - d3) / ((d4 - d3) + (d5 - d6)));
+		}
+		double v = vb / (va + vb + vc);
+		double w = vc / (va + vb + vc);
+		auto q = a + RepoVector3D64(ab.x * v + ac.x * w, ab.y * v + ac.y * w, ab.z * v + ac.z * w);
+		return (p - q).norm();
+	}
+
+	/*
+	* A uniform grid over the triangles in a range of faces, for finding the
+	* distance from a point to the closest of them. The cells are sized for
+	* surfaces, with a few triangles in each.
+	*/
+	class TriangleGrid
+	{
+	public:
+		TriangleGrid(
+			const std::vector<RepoVector3D>& vertices,
+			const std::vector<repo_face_t>& faces,
+			size_t begin,
+			size_t end) :
+			vertices(vertices)
+		{
+			RepoBounds bounds;
+			double area = 0;
+			for (size_t i = begin; i < end; i++) {
+				if (faces[i].size() == 3) {
+					triangles.push_back({ faces[i][0], faces[i][1], faces[i][2] });
+					RepoVector3D64 a = vertices[faces[i][0]];
+					RepoVector3D64 b = vertices[faces[i][1]];
+					RepoVector3D64 c = vertices[faces[i][2]];
+					area += (b - a).crossProduct(c - a).norm() / 2;
+					bounds.encapsulate(a);
+					bounds.encapsulate(b);
+					bounds.encapsulate(c);
+				}
+			}
+			if (!triangles.size()) {
+				return;
+			}
+
+			// Cells are sized to hold a few triangles of the average area, unless
+			// that would make too many of them for the bounds
+
+			origin = bounds.min();
+			auto size = bounds.size();
+			auto n = (double)triangles.size();
+			cellSize = std::max({ std::sqrt(area / n) * 2, size.norm() / 1024, DBL_MIN });
+			while (true) {
+				dims[0] = (size_t)(size.x / cellSize) + 1;
+				dims[1] = (size_t)(size.y / cellSize) + 1;
+				dims[2] = (size_t)(size.z / cellSize) + 1;
+				if ((double)dims[0] * dims[1] * dims[2] <= n * 4 + 8) {
+					break;
+				}
+				cellSize *= 1.5;
+			}
+
+			// Each triangle is added to every cell its bounds overlap
+
+			offsets.assign(dims[0] * dims[1] * dims[2] + 1, 0);
+			forEachCell([&](size_t cell, uint32_t t) {
+				offsets[cell + 1]++;
+			});
+			for (size_t c = 1; c < offsets.size(); c++) {
+				offsets[c] += offsets[c - 1];
+			}
+			cells.resize(offsets.back());
+			std::vector<size_t> cursor(offsets.begin(), offsets.end() - 1);
+			forEachCell([&](size_t cell, uint32_t t) {
+				cells[cursor[cell]++] = t;
+			});
+
+			visited.assign(triangles.size(), 0);
+		}
+
+		/*
+		* Returns the distance from p to the closest triangle, searching the
+		* cells in shells around that of p until no closer triangle is possible
+		*/
+		double distance(const RepoVector3D64& p)
+		{
+			if (!triangles.size()) {
+				return DBL_MAX;
+			}
+
+			query++;
+			std::array<int64_t, 3> centre;
+			for (int i = 0; i < 3; i++) {
+				centre[i] = cellOf(p, i);
+			}
+
+			double best = DBL_MAX;
+			auto maxShell = (int64_t)std::max({ dims[0], dims[1], dims[2] });
+			for (int64_t shell = 0; shell <= maxShell; shell++) {
+				for (int64_t z = centre[2] - shell; z <= centre[2] + shell; z++) {
+					for (int64_t y = centre[1] - shell; y <= centre[1] + shell; y++) {
+
+						// Within the shell, only the cells on its surface are new
+
+						auto onSurface = std::abs(z - centre[2]) == shell || std::abs(y - centre[1]) == shell;
+						auto step = onSurface || !shell ? 1 : shell * 2;
+						for (int64_t x = centre[0] - shell; x <= centre[0] + shell; x += step) {
+							if (x < 0 || y < 0 || z < 0 || x >= (int64_t)dims[0] || y >= (int64_t)dims[1] || z >= (int64_t)dims[2]) {
+								continue;
+							}
+							auto cell = ((size_t)z * dims[1] + (size_t)y) * dims[0] + (size_t)x;
+							for (auto i = offsets[cell]; i < offsets[cell + 1]; i++) {
+								auto t = cells[i];
+								if (visited[t] == query) {
+									continue;
+								}
+								visited[t] = query;
+								const auto& tri = triangles[t];
+								best = std::min(best, closestPointDistance(p, vertices[tri[0]], vertices[tri[1]], vertices[tri[2]]));
+							}
+						}
+					}
+				}
+
+				// Triangles in the cells beyond this shell are at least as far away as
+				// the nearest side of it that has cells beyond it
+
+				double bound = DBL_MAX;
+				for (int i = 0; i < 3; i++) {
+					auto v = i == 0 ? p.x - origin.x : (i == 1 ? p.y - origin.y : p.z - origin.z);
+					if (centre[i] - shell > 0) {
+						bound = std::min(bound, v - (centre[i] - shell) * cellSize);
+					}
+					if (centre[i] + shell + 1 < (int64_t)dims[i]) {
+						bound = std::min(bound, (centre[i] + shell + 1) * cellSize - v);
+					}
+				}
+				if (best <= bound) {
+					break;
+				}
+			}
+			return best;
+		}
+
+	private:
+		const std::vector<RepoVector3D>& vertices;
+		std::vector<std::array<uint32_t, 3>> triangles;
+		RepoVector3D64 origin;
+		double cellSize = 1;
+		std::array<size_t, 3> dims = { 1, 1, 1 };
+		std::vector<size_t> offsets;
+		std::vector<uint32_t> cells;
+		std::vector<uint32_t> visited;
+		uint32_t query = 0;
+
+		int64_t cellOf(const RepoVector3D64& p, int axis) const
+		{
+			auto v = axis == 0 ? p.x - origin.x : (axis == 1 ? p.y - origin.y : p.z - origin.z);
+			auto cell = (int64_t)std::floor(v / cellSize);
+			return std::clamp<int64_t>(cell, 0, dims[axis] - 1);
+		}
+
+		template<typename F>
+		void forEachCell(F f) const
+		{
+			for (uint32_t t = 0; t < triangles.size(); t++) {
+				std::array<int64_t, 3> lo = { INT64_MAX, INT64_MAX, INT64_MAX };
+				std::array<int64_t, 3> hi = { 0, 0, 0 };
+				for (auto v : triangles[t]) {
+					RepoVector3D64 p(vertices[v].x, vertices[v].y, vertices[v].z);
+					for (int i = 0; i < 3; i++) {
+						lo[i] = std::min(lo[i], cellOf(p, i));
+						hi[i] = std::max(hi[i], cellOf(p, i));
+					}
+				}
+				for (auto z = lo[2]; z <= hi[2]; z++) {
+					for (auto y = lo[1]; y <= hi[1]; y++) {
+						for (auto x = lo[0]; x <= hi[0]; x++) {
+							f(((size_t)z * dims[1] + (size_t)y) * dims[0] + (size_t)x, t);
+						}
+					}
+				}
+			}
+		}
+	};
+
+	/*
+	* Returns the greatest distance from a vertex of the triangles in
+	* [fromBegin, fromEnd) of fromFaces, to the closest of the triangles in
+	* [toBegin, toEnd) of toFaces. This is the one-sided Hausdorff distance
+	* between the two, sampled at the vertices of the first.
+	*/
+	double measureDistance(
+		const std::vector<RepoVector3D>& fromVertices,
+		const std::vector<repo_face_t>& fromFaces,
+		size_t fromBegin,
+		size_t fromEnd,
+		const std::vector<RepoVector3D>& toVertices,
+		const std::vector<repo_face_t>& toFaces,
+		size_t toBegin,
+		size_t toEnd)
+	{
+		uint32_t minVertex = UINT32_MAX, maxVertex = 0;
+		for (size_t i = fromBegin; i < fromEnd; i++) {
+			if (fromFaces[i].size() == 3) {
+				for (int k = 0; k < 3; k++) {
+					minVertex = std::min(minVertex, fromFaces[i][k]);
+					maxVertex = std::max(maxVertex, fromFaces[i][k]);
+				}
+			}
+		}
+		if (minVertex > maxVertex) {
+			return 0;
+		}
+
+		TriangleGrid grid(toVertices, toFaces, toBegin, toEnd);
+
+		double distance = 0;
+		std::vector<uint8_t> measured(maxVertex - minVertex + 1, false);
+		for (size_t i = fromBegin; i < fromEnd; i++) {
+			if (fromFaces[i].size() != 3) {
+				continue;
+			}
+			for (int k = 0; k < 3; k++) {
+				auto v = fromFaces[i][k];
+				if (measured[v - minVertex]) {
+					continue;
+				}
+				measured[v - minVertex] = true;
+				const auto& p = fromVertices[v];
+				distance = std::max(distance, grid.distance(RepoVector3D64(p.x, p.y, p.z)));
+			}
+		}
+		return distance;
+	}
+}
+
+MeshSimplifier::MeshSimplifier() :
+	options()
+{
+}
+
+MeshSimplifier::MeshSimplifier(const Options& options) :
+	options(options)
+{
+}
+
+std::vector<repo_face_t> MeshSimplifier::simplify(
+	const std::vector<RepoVector3D>& vertices,
+	const std::vector<RepoVector3D>& normals,
+	const std::vector<std::vector<RepoVector2D>>& uvChannels,
+	const std::vector<repo_face_t>& faces,
+	size_t begin,
+	size_t end,
+	size_t targetFaces,
+	float maxError,
+	float& error) const
+{
+	Simplification simplification(options, vertices, normals, uvChannels, faces, begin, end);
+	simplification.run(targetFaces, maxError);
+	auto result = simplification.getFaces();
+	error = (float)measureDistance(vertices, faces, begin, end, vertices, result, 0, result.size());
+	return result;
+}
+
+std::optional<MeshSimplifier::Level> MeshSimplifier::simplifyGeometry(
+	const repo::core::model::SupermeshNode& supermesh,
+	float ratio,
+	float maxError) const
+{
+	auto faces = supermesh.getFaces();
+	return simplifyGeometry(
+		supermesh.getVertices(),
+		supermesh.getNormals(),
+		supermesh.getUVChannelsSeparated(),
+		supermesh.getSubmeshIds(),
+		faces,
+		supermesh.getMeshMapping(),
+		supermesh.getVertices(),
+		faces,
+		supermesh.getMeshMapping(),
+		ratio,
+		maxError);
+}
+
+std::optional<MeshSimplifier::Level> MeshSimplifier::simplifyGeometry(
+	const Level& level,
+	const repo::core::model::SupermeshNode& original,
+	float ratio,
+	float maxError) const
+{
+	return simplifyGeometry(
+		level.vertices,
+		level.normals,
+		level.uvChannels,
+		level.submeshIds,
+		level.faces,
+		level.mapping,
+		original.getVertices(),
+		original.getFaces(),
+		original.getMeshMapping(),
+		ratio,
+		maxError);
+}
+
+std::optional<MeshSimplifier::Level> MeshSimplifier::simplifyGeometry(
+	const std::vector<RepoVector3D>& vertices,
+	const std::vector<RepoVector3D>& normals,
+	const std::vector<std::vector<RepoVector2D>>& uvChannels,
+	const std::vector<float>& submeshIds,
+	const std::vector<repo_face_t>& faces,
+	const std::vector<repo_mesh_mapping_t>& mapping,
+	const std::vector<RepoVector3D>& originalVertices,
+	const std::vector<repo_face_t>& originalFaces,
+	const std::vector<repo_mesh_mapping_t>& originalMapping,
+	float ratio,
+	float maxError) const
+{
+	if (originalMapping.size() != mapping.size()) {
+		repoWarning << "Cannot simplify supermesh as its mapping does not match that of the original";
+		return std::nullopt;
+	}
+
+	Level lod;
+	lod.uvChannels.resize(uvChannels.size());
+
+	bool hasTriangles = false;
+
+	for (size_t s = 0; s < mapping.size(); s++)
+	{
+		auto m = mapping[s];
+		const auto& o = originalMapping[s];
+		if (o.mesh_id != m.mesh_id || o.triFrom < 0 || o.triFrom > o.triTo || (size_t)o.triTo > originalFaces.size()) {
+			repoWarning << "Cannot simplify supermesh as the mapping of " << m.mesh_id << " does not match that of the original";
+			return std::nullopt;
+		}
+
+		if (m.triFrom < 0 || m.triFrom > m.triTo || (size_t)m.triTo > faces.size() ||
+			m.vertFrom < 0 || m.vertFrom > m.vertTo || (size_t)m.vertTo > vertices.size()) {
+			repoWarning << "Cannot simplify supermesh as the mapping of " << m.mesh_id << " is outside the supermesh";
+			return std::nullopt;
+		}
+
+		bool triangles = m.triTo > m.triFrom;
+		for (auto f = m.triFrom; f < m.triTo && triangles; f++) {
+			triangles &= faces[f].size() == 3;
+		}
+
+		std::vector<repo_face_t> submesh;
+		if (triangles) {
+			hasTriangles = true;
+			auto target = (size_t)std::ceil((m.triTo - m.triFrom) * ratio);
+			Simplification simplification(options, vertices, normals, uvChannels, faces, m.triFrom, m.triTo);
+			simplification.run(target, maxError);
+			submesh = simplification.getFaces();
+
+			// The error is always measured from the original, so it is a bound on
+			// the distance of its vertices however many levels this is from it
+
+			auto distance = measureDistance(originalVertices, originalFaces, o.triFrom, o.triTo, vertices, submesh, 0, submesh.size());
+			lod.error = std::max(lod.error, (float)distance);
+		}
+		else {
+			submesh.assign(faces.begin() + m.triFrom, faces.begin() + m.triTo);
+		}
+
+		// Copy the vertices still referenced by the submesh, in the order they
+		// were in the original range
+
+		std::vector<uint32_t> remap(m.vertTo - m.vertFrom, INVALID);
+		for (auto& face : submesh) {
+			for (size_t i = 0; i < face.size(); i++) {
+				if (face[i] < (uint32_t)m.vertFrom || face[i] >= (uint32_t)m.vertTo) {
+					repoWarning << "Cannot simplify supermesh as " << m.mesh_id << " references vertices outside its range";
+					return std::nullopt;
+				}
+				remap[face[i] - m.vertFrom] = 0;
+			}
+		}
+
+		uint32_t vertFrom = lod.vertices.size();
+		for (uint32_t v = m.vertFrom; v < (uint32_t)m.vertTo; v++) {
+			auto& r = remap[v - m.vertFrom];
+			if (r == INVALID) {
+				continue;
+			}
+			r = lod.vertices.size();
+			lod.vertices.push_back(vertices[v]);
+			if (normals.size() == vertices.size()) {
+				lod.normals.push_back(normals[v]);
+			}
+			if (submeshIds.size() == vertices.size()) {
+				lod.submeshIds.push_back(submeshIds[v]);
+			}
+			for (size_t c = 0; c < uvChannels.size(); c++) {
+				if (uvChannels[c].size() == vertices.size()) {
+					lod.uvChannels[c].push_back(uvChannels[c][v]);
+				}
+			}
+		}
+
+		for (auto& face : submesh) {
+			for (size_t i = 0; i < face.size(); i++) {
+				face[i] = remap[face[i] - m.vertFrom];
+			}
+		}
+
+		m.vertFrom = vertFrom;
+		m.vertTo = lod.vertices.size();
+		m.triFrom = lod.faces.size();
+		lod.faces.insert(lod.faces.end(), submesh.begin(), submesh.end());
+		m.triTo = lod.faces.size();
+		lod.mapping.push_back(m);
+	}
+
+	if (!hasTriangles) {
+		return std::nullopt;
+	}
+
+	return lod;
+}
+
+std::unique_ptr<repo::core::model::SupermeshNode> MeshSimplifier::makeLevelOfDetail(
+	const repo::core::model::SupermeshNode& previous,
+	Level level)
+{
+	auto lod = repo::core::model::RepoBSONFactory::makeSupermeshNode(
+		level.vertices,
+		level.faces,
+		level.normals,
+		previous.getBoundingBox(),
+		level.uvChannels,
+		previous.getName(),
+		level.mapping);
+	lod->setSubmeshIds(level.submeshIds);
+
+	// The error of each level is measured from the original. Coarser levels are
+	// almost always further from it, but the error is kept from decreasing so
+	// exporters can rely on it when choosing between levels.
+
+	lod->setLod(
+		previous.getLodLevel() + 1,
+		std::max(previous.getLodError(), level.error),
+		previous.getLodLevel() ? previous.getLodSource() : previous.getUniqueID());
+
+	return lod;
+}
+
+std::unique_ptr<repo::core::model::SupermeshNode> MeshSimplifier::simplify(
+	const repo::core::model::SupermeshNode& supermesh,
+	float ratio,
+	float maxError) const
+{
+	if (supermesh.getLodLevel()) {
+		repoWarning << "Cannot simplify a level of detail without the original; use simplifyGeometry with the original instead";
+		return nullptr;
+	}
+
+	auto level = simplifyGeometry(supermesh, ratio, maxError);
+	if (!level) {
+		return nullptr;
+	}
+	return makeLevelOfDetail(supermesh, std::move(*level));
+}
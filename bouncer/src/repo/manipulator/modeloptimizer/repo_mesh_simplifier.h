@@ -0,0 +1,202 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+* Builds simplified levels of detail of supermeshes.
+*
+* This is an edge collapse simplifier driven by quadric error metrics (after
+* Garland & Heckbert). Each collapse moves one vertex onto a neighbour, so
+* no new vertices are created and the simplified faces index the original
+* vertex buffer. The quadrics are unweighted sums of the planes of the faces
+* around each vertex, so the square root of the error of a collapse is an
+* upper bound on the distance between the surviving vertex and the planes of
+* the faces it originally belonged to. This is what maxError limits.
+*
+* The error reported to callers is measured once the simplification is done:
+* it is the one-sided Hausdorff distance from the vertices of the original
+* triangles to the simplified triangles, in model units. Every vertex of the
+* original is within that distance of the simplified surface. As no new
+* vertices are created, the simplified vertices are all on the original
+* surface.
+*
+* Vertices are welded by position for the purposes of topology, so meshes with
+* hard edges or uv seams, which have multiple vertices at the same position,
+* are simplified as one surface. Along such seams:
+*
+* 1. Vertices may only collapse along the seam, so the seam is kept.
+* 2. Each face keeps the vertex at the new position with the closest attributes,
+*    so faces don't take on the normals or uvs from the other side of a seam.
+* 3. The difference in attributes is added to the priority of the collapse,
+*    so smooth regions are simplified first.
+*
+* Open boundaries get additional planes perpendicular to their faces, and
+* boundary vertices may only collapse along the boundary, so the outlines of
+* surfaces are kept. Collapses that would fold over faces or make the mesh
+* non-manifold are rejected.
+*/
+
+#pragma once
+
+#include "repo/repo_bouncer_global.h"
+#include "repo/lib/datastructure/repo_structs.h"
+#include "repo/lib/datastructure/repo_vector.h"
+
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace repo {
+	namespace core {
+		namespace model {
+			class SupermeshNode;
+		}
+	}
+
+	namespace manipulator {
+		namespace modeloptimizer {
+
+			class REPO_API_EXPORT MeshSimplifier
+			{
+			public:
+				struct Options
+				{
+					/*
+					* How much differences in the normals and uvs of the vertices
+					* count towards the priority of a collapse. Attribute distances
+					* are scaled by the size of the submesh, so a weight of 0.01 puts
+					* a 0.1 change in a normal on par with moving a vertex 1% of the
+					* diagonal of the bounds.
+					*/
+					float normalWeight = 0.01f;
+					float uvWeight = 0.01f;
+
+					/*
+					* The weight of the planes along open boundaries, relative to the
+					* planes of the faces.
+					*/
+					float boundaryWeight = 10.0f;
+				};
+
+				/*
+				* The geometry of one level of detail of a supermesh
+				*/
+				struct Level
+				{
+					std::vector<repo::lib::RepoVector3D> vertices;
+					std::vector<repo::lib::RepoVector3D> normals;
+					std::vector<std::vector<repo::lib::RepoVector2D>> uvChannels;
+					std::vector<float> submeshIds;
+					std::vector<repo::lib::repo_face_t> faces;
+					std::vector<repo::lib::repo_mesh_mapping_t> mapping;
+
+					// The greatest distance from a vertex of the level 0 supermesh to
+					// the faces of the same submesh in this level
+					float error = 0;
+				};
+
+				MeshSimplifier();
+
+				MeshSimplifier(const Options& options);
+
+				/**
+				* Simplifies the triangles in the range [begin, end) of faces, until
+				* there are no more than targetFaces left or no collapse is possible
+				* with an error below maxError. The returned faces reference the same
+				* vertices as the originals, some of which will no longer be used.
+				* @param normals the normals of the vertices, or empty
+				* @param uvChannels the uvs of the vertices, or empty
+				* @param error set to the greatest distance from a vertex of the
+				* triangles in the range to the simplified triangles
+				* @return the simplified faces
+				*/
+				std::vector<repo::lib::repo_face_t> simplify(
+					const std::vector<repo::lib::RepoVector3D>& vertices,
+					const std::vector<repo::lib::RepoVector3D>& normals,
+					const std::vector<std::vector<repo::lib::RepoVector2D>>& uvChannels,
+					const std::vector<repo::lib::repo_face_t>& faces,
+					size_t begin,
+					size_t end,
+					size_t targetFaces,
+					float maxError,
+					float& error) const;
+
+				/**
+				* Simplifies each submesh in the mapping of a supermesh separately to
+				* the given ratio of its faces. The vertex buffers are compacted and the
+				* mapping ranges updated to match, so the level of detail can be used in
+				* place of the original. The error of the level is measured against the
+				* supermesh. Returns nothing if the supermesh has no triangles. This
+				* only builds the geometry, so it may be called from any number of
+				* threads at once.
+				*/
+				std::optional<Level> simplifyGeometry(
+					const repo::core::model::SupermeshNode& supermesh,
+					float ratio,
+					float maxError) const;
+
+				/**
+				* As above, for a level of detail that has already been simplified from
+				* original. The error is measured against original, rather than the
+				* level, so it does not compound.
+				*/
+				std::optional<Level> simplifyGeometry(
+					const Level& level,
+					const repo::core::model::SupermeshNode& original,
+					float ratio,
+					float maxError) const;
+
+				/**
+				* Creates the supermesh of the level of detail after previous. Its level
+				* and source are set from those of previous. Its error is that of the
+				* level, or of previous if greater, so errors never decrease from one
+				* level to the next. This creates new ids, so it should not be called
+				* from more than one thread at a time.
+				*/
+				static std::unique_ptr<repo::core::model::SupermeshNode> makeLevelOfDetail(
+					const repo::core::model::SupermeshNode& previous,
+					Level level);
+
+				/**
+				* Creates the first level of detail of a level 0 supermesh with
+				* simplifyGeometry and makeLevelOfDetail. Returns nullptr if the
+				* supermesh has no triangles, or is itself a level of detail, as the
+				* error could not be measured against the original.
+				*/
+				std::unique_ptr<repo::core::model::SupermeshNode> simplify(
+					const repo::core::model::SupermeshNode& supermesh,
+					float ratio,
+					float maxError) const;
+
+			private:
+				Options options;
+
+				std::optional<Level> simplifyGeometry(
+					const std::vector<repo::lib::RepoVector3D>& vertices,
+					const std::vector<repo::lib::RepoVector3D>& normals,
+					const std::vector<std::vector<repo::lib::RepoVector2D>>& uvChannels,
+					const std::vector<float>& submeshIds,
+					const std::vector<repo::lib::repo_face_t>& faces,
+					const std::vector<repo::lib::repo_mesh_mapping_t>& mapping,
+					const std::vector<repo::lib::RepoVector3D>& originalVertices,
+					const std::vector<repo::lib::repo_face_t>& originalFaces,
+					const std::vector<repo::lib::repo_mesh_mapping_t>& originalMapping,
+					float ratio,
+					float maxError) const;
+			};
+		}
+	}
+}
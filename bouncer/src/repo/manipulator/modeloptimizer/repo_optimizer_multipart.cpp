@@ -25,14 +25,84 @@
 #include "bvh/sweep_sah_builder.hpp"
 
 #include "repo_optimizer_multipart.h"
+#include "repo_vertex_cache_optimizer.h"
 #include "repo/core/model/bson/repo_bson_factory.h"
+#include "repo/core/model/bson/repo_bson_builder.h"
+#include "repo/lib/repo_sha256.h"
 
 #include <algorithm>
 #include <chrono>
+#include <exception>
+#include <numeric>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 using namespace repo::lib;
 using namespace repo::manipulator::modeloptimizer;
 
+// Below this many primitives, the bounds are computed on the calling thread,
+// as starting the parallel region would cost more than it saves.
+#define REPO_BVH_PARALLEL_THRESHOLD 10000
+
+namespace {
+
+	// Sets the number of threads that the parallel regions started by the bvh
+	// builders use, restoring the previous value when it goes out of scope.
+	// The SweepSahBuilder sorts with a stable radix sort and its splits depend
+	// only on the primitive bounds, so the topology of the tree is the same for
+	// any number of threads; only the order the nodes are allocated in differs.
+	// All traversals of the trees in this class follow the node children, so
+	// the clusters built from them are the same too.
+	struct ScopedBvhThreads
+	{
+#ifdef _OPENMP
+		int previous;
+
+		ScopedBvhThreads(int numThreads) :
+			previous(omp_get_max_threads())
+		{
+			if (numThreads > 0) {
+				omp_set_num_threads(numThreads);
+			}
+		}
+
+		~ScopedBvhThreads()
+		{
+			omp_set_num_threads(previous);
+		}
+#else
+		ScopedBvhThreads(int numThreads)
+		{
+		}
+#endif
+	};
+
+	int getBvhThreads(int numThreads)
+	{
+#ifdef _OPENMP
+		return numThreads > 0 ? numThreads : omp_get_max_threads();
+#else
+		return 1;
+#endif
+	}
+
+	// Meshes written with RepoMeshCodec hold their normals under a different
+	// name, so either counts as having normals
+	void appendNormalsFilter(repo::core::handler::database::query::RepoQueryBuilder& filter, bool hasNormals)
+	{
+		using namespace repo::core::handler::database::query;
+		if (hasNormals) {
+			filter.append(Or(Exists(REPO_FILTER_TAG_NORMALS, true), Exists(REPO_FILTER_TAG_ENCODED_NORMALS, true)));
+		}
+		else {
+			filter.append(Exists(REPO_FILTER_TAG_NORMALS, false));
+			filter.append(Exists(REPO_FILTER_TAG_ENCODED_NORMALS, false));
+		}
+	}
+}
+
 auto defaultGraph = repo::core::model::RepoScene::GraphType::DEFAULT;
 
 // The vertex count is used as a rough approximation of the total geometry size.
@@ -43,9 +113,21 @@ static const size_t REPO_MP_MAX_VERTEX_COUNT = 1200000;
 // supermesh UV resolution falling below the quantisation noise floor.
 static const size_t REPO_MP_MAX_MESHES_IN_SUPERMESH = 5000;
 
+// Levels of detail that keep more than this fraction of the faces of the level
+// before are not worth storing, and neither would the ones after them be.
+static const float REPO_MP_LOD_MIN_REDUCTION = 0.9f;
+
 static const size_t REPO_BVH_MAX_LEAF_SIZE = 16;
 static const size_t REPO_MODEL_LOW_CLUSTERING_RATIO = 0.2f;
 
+// Labels of the documents in the stash clusters collection
+#define REPO_STASH_CLUSTER_LABEL_JOB            "job"
+#define REPO_STASH_CLUSTER_LABEL_MEMBERS        "members"
+#define REPO_STASH_CLUSTER_LABEL_SUPERMESHES    "supermeshes"
+#define REPO_STASH_CLUSTER_LABEL_MAPPING        "mapping"
+#define REPO_STASH_CLUSTER_LABEL_MEMBER         "member"
+#define REPO_STASH_CLUSTER_LABEL_SOURCE         "source"
+
 #define CHRONO_DURATION(start) std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start).count()
 
 bool MultipartOptimizer::processScene(
@@ -55,6 +137,24 @@ bool MultipartOptimizer::processScene(
 	repo::core::handler::AbstractDatabaseHandler *handler,
 	repo::manipulator::modelconvertor::AbstractModelExport* exporter)
 {
+	currentRevId = revId;
+	clusterRecords.clear();
+	previousClusterRecords.clear();
+	previousClusterRevId = repo::lib::RepoUUID();
+	reuseSupported = exporter->supportsExistingSupermeshes();
+	numReusedClusters = 0;
+	lodsSupported = lodOptions.numLevels && exporter->supportsLods();
+	pendingLods.clear();
+
+	// Getting the clusters of the previous revision, so supermeshes of geometry
+	// that has not changed can be reused
+	auto previousRevId = reuseSupported ? getPreviousRevision(handler, database, collection, revId) : repo::lib::RepoUUID();
+	if (!previousRevId.isDefaultValue()) {
+		repoInfo << "Getting Clusters of revision " << previousRevId.toString();
+		previousClusterRecords = getClusterRecords(handler, database, collection, previousRevId, previousClusterRevId);
+		repoInfo << "Found " << previousClusterRecords.size() << " clusters";
+	}
+
 	// Getting Transforms
 	repoInfo << "Getting Transforms";
 	auto transformMap = getAllTransforms(handler, database, collection, revId);
@@ -115,31 +215,35 @@ bool MultipartOptimizer::processScene(
 
 		// Get Texture IDs
 		repoInfo << "Getting all texture Ids for grouping " << grouping;
-		auto texIds = getAllTextureIds(handler, database, collection, revId, grouping);
+		auto textures = getAllTextureIds(handler, database, collection, revId, grouping);
 
 		// Create jobs for each texture group
-		for (auto texId : texIds) {
+		for (auto& [texId, texDigest] : textures) {
+
+			// Texture ids change with each import, so clusters are matched between
+			// revisions by the content of the texture instead
+			auto texKey = texDigest.empty() ? texId.toString() : texDigest;
 
 			// Jobs for textured, prim 2
 			// One cannot map a texture to a line, however, customers can assign materials with textures to lines
 			// so we need to be able to process them.
 			{
 				std::string description = "Grouping: " + grouping + ", Textured " + texId.toString() + " , Primitive 2, No Normals";
-				jobs.push_back(createTexturedJob(description, revId, 2, grouping, false, texId));
+				jobs.push_back(createTexturedJob(description, revId, 2, grouping, false, texId, texKey));
 			}
 			{
 				std::string description = "Grouping: " + grouping + ", Textured " + texId.toString() + " , Primitive 2, Normals";
-				jobs.push_back(createTexturedJob(description, revId, 2, grouping, true, texId));
+				jobs.push_back(createTexturedJob(description, revId, 2, grouping, true, texId, texKey));
 			}
 
 			// Job for textured, prim 3
 			{
 				std::string description = "Grouping: " + grouping + ", Textured " + texId.toString() + " , Primitive 3, No Normals";
-				jobs.push_back(createTexturedJob(description, revId, 3, grouping, false, texId));
+				jobs.push_back(createTexturedJob(description, revId, 3, grouping, false, texId, texKey));
 			}
 			{
 				std::string description = "Grouping: " + grouping + ", Textured " + texId.toString() + " , Primitive 3, Normals";
-				jobs.push_back(createTexturedJob(description, revId, 3, grouping, true, texId));
+				jobs.push_back(createTexturedJob(description, revId, 3, grouping, true, texId, texKey));
 			}
 		}
 	}
@@ -158,12 +262,299 @@ bool MultipartOptimizer::processScene(
 			job);
 	}
 
+	createLods(exporter);
+
 	// Finalise export
 	exporter->finalise();
 
+	// The records are only of use to exporters that can reuse supermeshes
+	if (reuseSupported) {
+		storeClusterRecords(handler, database, collection, revId);
+	}
+
 	return true;
 }
 
+repo::lib::RepoUUID MultipartOptimizer::getPreviousRevision(
+	repo::core::handler::AbstractDatabaseHandler* handler,
+	const std::string& database,
+	const std::string& collection,
+	const repo::lib::RepoUUID& revId)
+{
+	try {
+		auto historyCollection = collection + "." + REPO_COLLECTION_HISTORY;
+		auto revision = handler->findOneByUniqueID(database, historyCollection, revId);
+		if (!revision.isEmpty() && revision.hasField(REPO_NODE_LABEL_PARENTS)) {
+			auto parents = revision.getUUIDFieldArray(REPO_NODE_LABEL_PARENTS);
+			if (parents.size()) {
+				return parents[0];
+			}
+		}
+	}
+	catch (const std::exception& e) {
+		repoWarning << "getPreviousRevision; failed to get revision " << revId.toString() << ": " << e.what() << "; all supermeshes will be rebuilt";
+	}
+	return repo::lib::RepoUUID();
+}
+
+std::vector<MultipartOptimizer::cluster_record_t> MultipartOptimizer::getClusterRecords(
+	repo::core::handler::AbstractDatabaseHandler* handler,
+	const std::string& database,
+	const std::string& collection,
+	const repo::lib::RepoUUID& revId,
+	repo::lib::RepoUUID& sourceRevId)
+{
+	std::vector<cluster_record_t> records;
+	sourceRevId = revId;
+
+	auto clustersCollection = collection + "." + REPO_COLLECTION_STASH_CLUSTERS;
+	auto filter = repo::core::handler::database::query::Eq(REPO_NODE_REVISION_ID, revId);
+
+	try {
+		auto cursor = handler->findCursorByCriteria(database, clustersCollection, filter);
+		if (cursor) {
+			for (auto bson : (*cursor)) {
+				if (bson.hasField(REPO_STASH_CLUSTER_LABEL_SOURCE)) {
+					auto source = bson.getUUIDField(REPO_STASH_CLUSTER_LABEL_SOURCE);
+					if (source != revId) {
+						return getClusterRecords(handler, database, collection, source, sourceRevId);
+					}
+					continue;
+				}
+
+				cluster_record_t record;
+				record.job = bson.getStringField(REPO_STASH_CLUSTER_LABEL_JOB);
+				record.members = bson.getStringArray(REPO_STASH_CLUSTER_LABEL_MEMBERS);
+				for (auto& supermeshBson : bson.getObjectArray(REPO_STASH_CLUSTER_LABEL_SUPERMESHES)) {
+					cluster_record_t::supermesh_t supermesh;
+					supermesh.revId = supermeshBson.getUUIDField(REPO_NODE_REVISION_ID);
+					supermesh.id = supermeshBson.getUUIDField(REPO_NODE_LABEL_ID);
+					for (auto& mappingBson : supermeshBson.getObjectArray(REPO_STASH_CLUSTER_LABEL_MAPPING)) {
+						repo_mesh_mapping_t mapping;
+						auto bounds = mappingBson.getBoundsField(REPO_NODE_MESH_LABEL_BOUNDING_BOX);
+						mapping.min = (repo::lib::RepoVector3D)bounds.min();
+						mapping.max = (repo::lib::RepoVector3D)bounds.max();
+						mapping.vertFrom = mappingBson.getIntField(REPO_NODE_MESH_LABEL_VERTEX_FROM);
+						mapping.vertTo = mappingBson.getIntField(REPO_NODE_MESH_LABEL_VERTEX_TO);
+						mapping.triFrom = mappingBson.getIntField(REPO_NODE_MESH_LABEL_TRIANGLE_FROM);
+						mapping.triTo = mappingBson.getIntField(REPO_NODE_MESH_LABEL_TRIANGLE_TO);
+						supermesh.mapping.push_back({ mappingBson.getIntField(REPO_STASH_CLUSTER_LABEL_MEMBER), mapping });
+					}
+					record.supermeshes.push_back(supermesh);
+				}
+				records.push_back(record);
+			}
+		}
+	}
+	catch (const std::exception& e) {
+		repoWarning << "getClusterRecords; failed to read clusters of revision " << revId.toString() << ": " << e.what() << "; all supermeshes will be rebuilt";
+		records.clear();
+	}
+
+	return records;
+}
+
+void MultipartOptimizer::storeClusterRecords(
+	repo::core::handler::AbstractDatabaseHandler* handler,
+	const std::string& database,
+	const std::string& collection,
+	const repo::lib::RepoUUID& revId)
+{
+	std::vector<repo::core::model::RepoBSON> documents;
+
+	// If nothing has changed since the previous revision, the records would be
+	// identical, so refer to them instead of writing them out again
+
+	bool unchanged = numReusedClusters &&
+		numReusedClusters == clusterRecords.size() &&
+		numReusedClusters == previousClusterRecords.size();
+
+	if (unchanged) {
+		repo::core::model::RepoBSONBuilder builder;
+		builder.append(REPO_NODE_LABEL_ID, repo::lib::RepoUUID::createUUID());
+		builder.append(REPO_NODE_REVISION_ID, revId);
+		builder.append(REPO_STASH_CLUSTER_LABEL_SOURCE, previousClusterRevId);
+		documents.push_back(builder.obj());
+	}
+	else {
+		for (const auto& record : clusterRecords) {
+			std::vector<repo::core::model::RepoBSON> supermeshes;
+			for (const auto& supermesh : record.supermeshes) {
+				std::vector<repo::core::model::RepoBSON> mappings;
+				for (const auto& [member, mapping] : supermesh.mapping) {
+					repo::core::model::RepoBSONBuilder builder;
+					builder.append(REPO_STASH_CLUSTER_LABEL_MEMBER, member);
+					builder.append(REPO_NODE_MESH_LABEL_BOUNDING_BOX, repo::lib::RepoBounds(mapping.min, mapping.max));
+					builder.append(REPO_NODE_MESH_LABEL_VERTEX_FROM, mapping.vertFrom);
+					builder.append(REPO_NODE_MESH_LABEL_VERTEX_TO, mapping.vertTo);
+					builder.append(REPO_NODE_MESH_LABEL_TRIANGLE_FROM, mapping.triFrom);
+					builder.append(REPO_NODE_MESH_LABEL_TRIANGLE_TO, mapping.triTo);
+					mappings.push_back(builder.obj());
+				}
+
+				repo::core::model::RepoBSONBuilder builder;
+				builder.append(REPO_NODE_REVISION_ID, supermesh.revId);
+				builder.append(REPO_NODE_LABEL_ID, supermesh.id);
+				builder.appendArray(REPO_STASH_CLUSTER_LABEL_MAPPING, mappings);
+				supermeshes.push_back(builder.obj());
+			}
+
+			repo::core::model::RepoBSONBuilder builder;
+			builder.append(REPO_NODE_LABEL_ID, repo::lib::RepoUUID::createUUID());
+			builder.append(REPO_NODE_REVISION_ID, revId);
+			builder.append(REPO_STASH_CLUSTER_LABEL_JOB, record.job);
+			builder.appendArray(REPO_STASH_CLUSTER_LABEL_MEMBERS, record.members);
+			builder.appendArray(REPO_STASH_CLUSTER_LABEL_SUPERMESHES, supermeshes);
+			documents.push_back(builder.obj());
+		}
+	}
+
+	if (!documents.size()) {
+		return;
+	}
+
+	// The records only allow later revisions to skip work, so failing to store
+	// them does not fail the export
+
+	try {
+		auto clustersCollection = collection + "." + REPO_COLLECTION_STASH_CLUSTERS;
+		handler->insertManyDocuments(database, clustersCollection, documents);
+
+		// getClusterRecords looks the records up by revision. Creating an index that
+		// already exists does nothing.
+		handler->createIndex(database, clustersCollection, repo::core::handler::database::index::Ascending({ REPO_NODE_REVISION_ID }));
+	}
+	catch (const std::exception& e) {
+		repoWarning << "storeClusterRecords; failed to store clusters for revision " << revId.toString() << ": " << e.what();
+	}
+}
+
+std::string MultipartOptimizer::getContentKey(
+	const repo::core::model::StreamingMeshNode& node,
+	const TransformMap& transformMap,
+	const MaterialPropMap& matPropMap)
+{
+	auto& sha256 = node.getSHA256();
+	if (sha256.empty() || !transformMap.contains(node.getParent()) || !matPropMap.contains(node.getSharedId())) {
+		return std::string();
+	}
+
+	repo::lib::RepoSHA256 hash;
+	hash.update(sha256);
+	hash.update(transformMap.at(node.getParent()).getData());
+	hash.update(matPropMap.at(node.getSharedId())->getMaterialStruct());
+	return hash.hexdigest();
+}
+
+std::vector<bool> MultipartOptimizer::reuseClusters(
+	repo::manipulator::modelconvertor::AbstractModelExport* exporter,
+	const MaterialPropMap& matPropMap,
+	std::vector<repo::core::model::StreamingMeshNode>& nodes,
+	const std::vector<std::string>& keys,
+	const ProcessingJob& job)
+{
+	std::vector<bool> reused(nodes.size(), false);
+
+	if (!reuseSupported || !previousClusterRecords.size()) {
+		return reused;
+	}
+
+	// Nodes that are not yet part of a cluster, by content key. More than one
+	// node may have the same key if they overlap exactly.
+
+	std::unordered_map<std::string, std::vector<int>> available;
+	for (int i = nodes.size() - 1; i >= 0; i--) {
+		if (!keys[i].empty()) {
+			available[keys[i]].push_back(i);
+		}
+	}
+
+	size_t numClusters = 0;
+	size_t numSupermeshes = 0;
+
+	for (const auto& previous : previousClusterRecords) {
+		if (previous.job != job.key) {
+			continue;
+		}
+
+		// A cluster can only be reused if all of its members are unchanged
+
+		std::vector<int> members;
+		for (const auto& key : previous.members) {
+			auto it = available.find(key);
+			if (it == available.end() || !it->second.size()) {
+				break;
+			}
+			members.push_back(it->second.back());
+			it->second.pop_back();
+		}
+
+		bool added = members.size() == previous.members.size();
+
+		cluster_record_t record{ previous.job, previous.members, {} };
+		for (size_t i = 0; added && i < previous.supermeshes.size(); i++) {
+			auto& supermesh = previous.supermeshes[i];
+
+			std::vector<repo_mesh_mapping_t> mapping;
+			for (const auto& [member, range] : supermesh.mapping) {
+				auto& node = nodes[members[member]];
+				auto matNode = matPropMap.at(node.getSharedId());
+
+				repo_mesh_mapping_t meshMap = range;
+				meshMap.mesh_id = node.getUniqueId();
+				meshMap.shared_id = node.getSharedId();
+				meshMap.material_id = matNode->getUniqueID();
+				meshMap.material = matNode->getMaterialStruct();
+				if (job.isTexturedJob()) {
+					meshMap.texture_id = job.texId;
+				}
+				mapping.push_back(meshMap);
+			}
+
+			added = exporter->addExistingSupermesh(supermesh.revId, supermesh.id, mapping);
+			if (added) {
+				record.supermeshes.push_back(supermesh);
+			}
+			else if (i == 0) {
+				repoInfo << "The exporter cannot reuse supermeshes of previous revisions; all supermeshes will be rebuilt";
+				reuseSupported = false;
+			}
+			else {
+				// The exporter should accept all supermeshes or none. If it stops part
+				// way through a cluster, keep what was added, as it cannot be undone.
+				repoError << "Exporter rejected a supermesh of a partially reused cluster; the geometry of this cluster may be incomplete.";
+				added = true;
+				break;
+			}
+		}
+
+		if (added) {
+			for (auto member : members) {
+				reused[member] = true;
+			}
+			numClusters++;
+			numReusedClusters++;
+			numSupermeshes += record.supermeshes.size();
+			clusterRecords.push_back(record);
+		}
+		else {
+			for (size_t i = 0; i < members.size(); i++) {
+				available[previous.members[i]].push_back(members[i]);
+			}
+		}
+
+		if (!reuseSupported) {
+			break;
+		}
+	}
+
+	if (numClusters) {
+		repoInfo << "Reused " << numSupermeshes << " supermeshes from " << numClusters << " unchanged clusters";
+	}
+
+	return reused;
+}
+
 std::unordered_map<repo::lib::RepoUUID, repo::lib::RepoMatrix, repo::lib::RepoUUIDHasher> MultipartOptimizer::getAllTransforms(
 	repo::core::handler::AbstractDatabaseHandler *handler,
 	const std::string &database,
@@ -333,7 +724,7 @@ std::set<std::string> MultipartOptimizer::getAllGroupings(
 	return groupings;
 }
 
-std::vector<repo::lib::RepoUUID> MultipartOptimizer::getAllTextureIds(
+std::vector<std::pair<repo::lib::RepoUUID, std::string>> MultipartOptimizer::getAllTextureIds(
 	repo::core::handler::AbstractDatabaseHandler *handler,
 	const std::string &database,
 	const std::string &collection,
@@ -351,8 +742,9 @@ std::vector<repo::lib::RepoUUID> MultipartOptimizer::getAllTextureIds(
 
 	repo::core::handler::database::query::RepoProjectionBuilder projection;
 	projection.includeField(REPO_NODE_LABEL_ID);
+	projection.includeField(REPO_NODE_TEXTURE_LABEL_SHA256);
 
-	std::vector<repo::lib::RepoUUID> texIds;
+	std::vector<std::pair<repo::lib::RepoUUID, std::string>> texIds;
 
 	auto sceneCollection = collection + "." + REPO_COLLECTION_SCENE;
 	auto cursor = handler->findCursorByCriteria(database, sceneCollection, filter, projection);
@@ -360,7 +752,8 @@ std::vector<repo::lib::RepoUUID> MultipartOptimizer::getAllTextureIds(
 	if (cursor) {
 		for (auto document : (*cursor)) {
 			auto bson = repo::core::model::RepoBSON(document);
-			texIds.push_back(bson.getUUIDField(REPO_NODE_LABEL_ID));
+			auto digest = bson.hasField(REPO_NODE_TEXTURE_LABEL_SHA256) ? bson.getStringField(REPO_NODE_TEXTURE_LABEL_SHA256) : std::string();
+			texIds.push_back({ bson.getUUIDField(REPO_NODE_LABEL_ID), digest });
 		}
 	}
 	else {
@@ -390,10 +783,10 @@ MultipartOptimizer::ProcessingJob repo::manipulator::modeloptimizer::MultipartOp
 		filter.append(repo::core::handler::database::query::Eq(REPO_FILTER_TAG_OPAQUE, true));
 	else
 		filter.append(repo::core::handler::database::query::Eq(REPO_FILTER_TAG_TRANSPARENT, true));
-	filter.append(repo::core::handler::database::query::Exists(REPO_FILTER_TAG_NORMALS, hasNormals));
+	appendNormalsFilter(filter, hasNormals);
 
 	// Create job
-	return ProcessingJob({ description, filter, {} });
+	return ProcessingJob({ description, description, filter, {} });
 }
 
 MultipartOptimizer::ProcessingJob repo::manipulator::modeloptimizer::MultipartOptimizer::createTexturedJob(
@@ -402,7 +795,8 @@ MultipartOptimizer::ProcessingJob repo::manipulator::modeloptimizer::MultipartOp
 	const int primitive,
 	const std::string &grouping,
 	const bool hasNormals,
-	const repo::lib::RepoUUID &texId)
+	const repo::lib::RepoUUID &texId,
+	const std::string &texKey)
 {
 	// Create filter
 	repo::core::handler::database::query::RepoQueryBuilder filter;
@@ -413,10 +807,11 @@ MultipartOptimizer::ProcessingJob repo::manipulator::modeloptimizer::MultipartOp
 		filter.append(repo::core::handler::database::query::Eq(REPO_NODE_MESH_LABEL_GROUPING, grouping));
 	else
 		filter.append(repo::core::handler::database::query::Exists(REPO_NODE_MESH_LABEL_GROUPING, false));
-	filter.append(repo::core::handler::database::query::Exists(REPO_FILTER_TAG_NORMALS, hasNormals));
+	appendNormalsFilter(filter, hasNormals);
 
 	// Create job
-	return ProcessingJob({ description, filter, texId });
+	auto key = "Grouping: " + grouping + ", Textured " + texKey + ", Primitive " + std::to_string(primitive) + (hasNormals ? ", Normals" : ", No Normals");
+	return ProcessingJob({ description, key, filter, texId });
 }
 
 void MultipartOptimizer::clusterAndSupermesh(
@@ -432,11 +827,12 @@ void MultipartOptimizer::clusterAndSupermesh(
 
 	// Create projection
 	repo::core::handler::database::query::RepoProjectionBuilder projection;
-	projection.excludeField(REPO_NODE_LABEL_ID);
+	projection.includeField(REPO_NODE_LABEL_ID);
 	projection.includeField(REPO_NODE_LABEL_SHARED_ID);
 	projection.includeField(REPO_NODE_MESH_LABEL_BOUNDING_BOX);
 	projection.includeField(REPO_NODE_MESH_LABEL_VERTICES_COUNT);
 	projection.includeField(REPO_NODE_LABEL_PARENTS);
+	projection.includeField(REPO_NODE_MESH_LABEL_SHA256);
 
 	// Get cursor
 	auto sceneCollection = collection + "." + REPO_COLLECTION_SCENE;
@@ -475,14 +871,38 @@ void MultipartOptimizer::clusterAndSupermesh(
 		}
 	}
 
+	// Reuse the supermeshes of any clusters that are unchanged since the
+	// previous revision, and remove their nodes from further processing
+	std::vector<std::string> keys;
+	for (const auto& node : nodes) {
+		keys.push_back(getContentKey(node, transformMap, matPropMap));
+	}
+
+	auto reused = reuseClusters(exporter, matPropMap, nodes, keys, job);
+
+	size_t numRemaining = 0;
+	for (size_t i = 0; i < nodes.size(); i++) {
+		if (!reused[i]) {
+			nodes[numRemaining] = std::move(nodes[i]);
+			keys[numRemaining] = std::move(keys[i]);
+			numRemaining++;
+		}
+	}
+	nodes.resize(numRemaining);
+	keys.resize(numRemaining);
+
+	if (nodes.size() == 0) {
+		repoInfo << "All nodes in this group reused from the previous revision. Returning.";
+		return;
+	}
+
 	// Cluster the mesh nodes
 	repoInfo << "Clustering Nodes";
 	auto clusters = clusterMeshNodes(nodes);
 
 	// Create Supermeshes from the clusters
 	repoInfo << "Creating Supermeshes from clustered Nodes";
-	auto texId = job.isTexturedJob() ? job.texId : repo::lib::RepoUUID();
-	createSuperMeshes(database, collection, handler, exporter, transformMap, matPropMap, nodes, clusters, texId);
+	createSuperMeshes(database, collection, handler, exporter, transformMap, matPropMap, nodes, keys, clusters, job);
 }
 
 void repo::manipulator::modeloptimizer::MultipartOptimizer::createSuperMeshes(
@@ -493,9 +913,12 @@ void repo::manipulator::modeloptimizer::MultipartOptimizer::createSuperMeshes(
 	const TransformMap& transformMap,
 	const MaterialPropMap& matPropMap,
 	std::vector<repo::core::model::StreamingMeshNode>& meshNodes,
+	const std::vector<std::string>& keys,
 	const std::vector<std::vector<int>>& clusters,
-	const repo::lib::RepoUUID &texId)
+	const ProcessingJob &job)
 {
+	auto texId = job.isTexturedJob() ? job.texId : repo::lib::RepoUUID();
+
 	// Get blobHandler
 	auto sceneCollection = collection + "." + REPO_COLLECTION_SCENE;
 	repo::core::handler::fileservice::BlobFilesHandler blobHandler(handler->getFileManager(), database, sceneCollection);
@@ -512,6 +935,22 @@ void repo::manipulator::modeloptimizer::MultipartOptimizer::createSuperMeshes(
 			sharedIdsInCluster.push_back(sharedId);
 		}
 
+		// Clusters can only be reused by later revisions if every member can be
+		// matched by content, so only record those.
+
+		cluster_record_t record;
+		record.job = job.key;
+		activeClusterMembers.clear();
+		for (auto& index : cluster) {
+			if (keys[index].empty()) {
+				activeClusterMembers.clear();
+				break;
+			}
+			activeClusterMembers.insert({ meshNodes[index].getSharedId(), (int)record.members.size() });
+			record.members.push_back(keys[index]);
+		}
+		activeClusterRecord = activeClusterMembers.size() ? &record : nullptr;
+
 		// Create filter
 		auto filter = repo::core::handler::database::query::Eq(REPO_NODE_LABEL_SHARED_ID, sharedIdsInCluster);
 
@@ -523,6 +962,7 @@ void repo::manipulator::modeloptimizer::MultipartOptimizer::createSuperMeshes(
 		projection.includeField(REPO_NODE_MESH_LABEL_FACES_COUNT);
 		projection.includeField(REPO_NODE_MESH_LABEL_UV_CHANNELS_COUNT);
 		projection.includeField(REPO_NODE_MESH_LABEL_PRIMITIVE);
+		projection.includeField(REPO_NODE_MESH_LABEL_GEOMETRY_CODEC);
 		projection.includeField(REPO_LABEL_BINARY_REFERENCE);
 
 		auto binNodes = handler->findAllByCriteria(database, sceneCollection, filter, projection);
@@ -591,17 +1031,134 @@ void repo::manipulator::modeloptimizer::MultipartOptimizer::createSuperMeshes(
 		if (currentSupermesh.vertices.size()) {
 			createSuperMesh(exporter, currentSupermesh);
 		}
+
+		if (activeClusterRecord) {
+			clusterRecords.push_back(record);
+			activeClusterRecord = nullptr;
+		}
 	}
 }
 
 void MultipartOptimizer::createSuperMesh(
 	repo::manipulator::modelconvertor::AbstractModelExport *exporter,
-	const mapped_mesh_t& mappedMesh)
+	mapped_mesh_t& mappedMesh)
 {
+	if (optimiseVertexCache) {
+		VertexCacheOptimizer().optimise(
+			mappedMesh.vertices,
+			mappedMesh.normals,
+			mappedMesh.uvChannels,
+			mappedMesh.faces,
+			mappedMesh.meshMapping);
+	}
+
 	// Create supermesh node
 	auto supermeshNode = createSupermeshNode(mappedMesh);
 
 	exporter->addSupermesh(supermeshNode.get());
+
+	if (activeClusterRecord) {
+		cluster_record_t::supermesh_t supermesh;
+		supermesh.revId = currentRevId;
+		supermesh.id = supermeshNode->getUniqueID();
+		for (const auto& mapping : mappedMesh.meshMapping) {
+			supermesh.mapping.push_back({ activeClusterMembers.at(mapping.shared_id), mapping });
+		}
+		activeClusterRecord->supermeshes.push_back(supermesh);
+	}
+
+	if (supermeshNode && lodsSupported) {
+		pendingLods.push_back(std::move(supermeshNode));
+		if (pendingLods.size() >= (size_t)getBvhThreads(numThreads)) {
+			createLods(exporter);
+		}
+	}
+}
+
+void MultipartOptimizer::createLods(
+	repo::manipulator::modelconvertor::AbstractModelExport *exporter)
+{
+	if (!pendingLods.size()) {
+		return;
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	// Supermeshes vary a lot in size, so they are handed out one at a time.
+	// Only the geometry is built in parallel; the nodes, and their ids, are
+	// created on this thread afterwards.
+
+	const int64_t numSupermeshes = pendingLods.size();
+	std::vector<std::vector<MeshSimplifier::Level>> lods(numSupermeshes);
+
+	// Exceptions (such as exceeding the memory budget) cannot leave an OpenMP
+	// region, so they are caught in each iteration and the first rethrown once
+	// all the threads have finished
+
+	std::vector<std::exception_ptr> errors(numSupermeshes);
+
+	#pragma omp parallel for num_threads(getBvhThreads(numThreads)) schedule(dynamic, 1)
+	for (int64_t i = 0; i < numSupermeshes; i++) {
+		try {
+			lods[i] = simplifySupermesh(*pendingLods[i]);
+		}
+		catch (...) {
+			errors[i] = std::current_exception();
+		}
+	}
+
+	for (auto& error : errors) {
+		if (error) {
+			pendingLods.clear();
+			std::rethrow_exception(error);
+		}
+	}
+
+	// The levels are exported in the same order as the supermeshes were
+
+	size_t numFaces = 0;
+	for (int64_t i = 0; i < numSupermeshes; i++) {
+		numFaces += pendingLods[i]->getNumFaces();
+		auto previous = std::move(pendingLods[i]);
+		for (auto& level : lods[i]) {
+			auto lod = MeshSimplifier::makeLevelOfDetail(*previous, std::move(level));
+			exporter->addSupermeshLod(lod.get());
+			previous = std::move(lod);
+		}
+	}
+	pendingLods.clear();
+
+	repoInfo << "Built levels of detail for " << numSupermeshes << " supermeshes (" << numFaces << " faces) in " << CHRONO_DURATION(start) << " ms";
+}
+
+std::vector<MeshSimplifier::Level> MultipartOptimizer::simplifySupermesh(
+	const repo::core::model::SupermeshNode& supermesh) const
+{
+	std::vector<MeshSimplifier::Level> levels;
+
+	MeshSimplifier simplifier;
+	auto maxError = lodOptions.maxError * supermesh.getBoundingBox().size().norm();
+
+	size_t numFaces = supermesh.getNumFaces();
+	for (size_t i = 0; i < lodOptions.numLevels; i++)
+	{
+		auto lod = levels.size() ?
+			simplifier.simplifyGeometry(levels.back(), supermesh, lodOptions.ratio, (float)maxError) :
+			simplifier.simplifyGeometry(supermesh, lodOptions.ratio, (float)maxError);
+		if (!lod || lod->faces.size() > numFaces * REPO_MP_LOD_MIN_REDUCTION) {
+			break;
+		}
+
+		if (optimiseVertexCache) {
+			VertexCacheOptimizer().optimise(lod->vertices, lod->normals, lod->uvChannels, lod->faces, lod->mapping);
+		}
+
+		numFaces = lod->faces.size();
+		levels.push_back(std::move(*lod));
+		maxError *= 2;
+	}
+
+	return levels;
 }
 
 void MultipartOptimizer::appendMesh(
@@ -693,13 +1250,19 @@ MultipartOptimizer::Bvh MultipartOptimizer::buildFacesBvh(
 	// mesh.
 	// The BVH builder expects a set of bounding boxes and centers to work with.
 
-	auto faces = node.getLoadedFaces();
-	auto vertices = node.getLoadedVertices();
-	auto boundingBoxes = std::vector<bvh::BoundingBox<Scalar>>();
-	auto centers = std::vector<BvhVector3>();
+	auto& faces = node.getLoadedFaces();
+	auto& vertices = node.getLoadedVertices();
+	auto boundingBoxes = std::vector<bvh::BoundingBox<Scalar>>(faces.size());
+	auto centers = std::vector<BvhVector3>(faces.size());
 
-	for (const auto& face : faces)
+	// Each face is independent, so this can be computed in parallel with the
+	// same result
+
+	const int64_t numFaces = faces.size();
+	#pragma omp parallel for num_threads(getBvhThreads(numThreads)) if(numFaces > REPO_BVH_PARALLEL_THRESHOLD)
+	for (int64_t f = 0; f < numFaces; f++)
 	{
+		auto& face = faces[f];
 		auto v = vertices[face[0]];
 		auto b = bvh::BoundingBox<Scalar>(BvhVector3(v.x, v.y, v.z));
 
@@ -709,8 +1272,8 @@ MultipartOptimizer::Bvh MultipartOptimizer::buildFacesBvh(
 			b.extend(BvhVector3(v.x, v.y, v.z));
 		}
 
-		boundingBoxes.push_back(b);
-		centers.push_back(b.center());
+		boundingBoxes[f] = b;
+		centers[f] = b.center();
 	}
 
 	auto globalBounds = bvh::compute_bounding_boxes_union(boundingBoxes.data(), boundingBoxes.size());
@@ -720,7 +1283,10 @@ MultipartOptimizer::Bvh MultipartOptimizer::buildFacesBvh(
 	Bvh bvh;
 	bvh::SweepSahBuilder<Bvh> builder(bvh);
 	builder.max_leaf_size = REPO_BVH_MAX_LEAF_SIZE;
-	builder.build(globalBounds, boundingBoxes.data(), centers.data(), boundingBoxes.size());
+	{
+		ScopedBvhThreads threads(numThreads);
+		builder.build(globalBounds, boundingBoxes.data(), centers.data(), boundingBoxes.size());
+	}
 
 	return bvh;
 }
@@ -790,56 +1356,115 @@ std::vector<size_t> MultipartOptimizer::getBranchPrimitives(
 	return primitives;
 }
 
-// For each node in the Bvh, return a list of unique vertex Ids that are
+// For each node in the Bvh, return the number of unique vertex Ids that are
 // referenced by the faces (primitives) in that node.
-
-std::vector<std::set<uint32_t>> MultipartOptimizer::getUniqueVertices(
+//
+// Building a set of vertex Ids for every node is prohibitively expensive for
+// large meshes, as each Id is duplicated in every node above it. Instead, the
+// faces are laid out in depth first order, so every node covers a contiguous
+// range of the vertex references, and the distinct elements in all ranges are
+// counted in one sweep using a Fenwick tree. Only the most recent reference
+// to each vertex is counted in the tree, so the sum over any range that ends
+// at the sweep position is the number of distinct vertices in that range.
+
+std::vector<size_t> MultipartOptimizer::getUniqueVertexCounts(
 	const Bvh& bvh,
 	const std::vector<repo_face_t>& primitives // The primitives in this tree are faces
 )
 {
-	// Before starting to accumulate the indices, we need to split the tree into
-	// leaf and branch nodes, so we can update the vertices for all the nodes
-	// from the bottom up...
-	// We can do this by peforming a breadth first traversal.
+	// Get the vertex references in depth first order, and the range of them
+	// under each node
 
-	std::vector<size_t> leaves;
-	std::vector<size_t> branches;
-	flattenBvh(bvh, leaves, branches);
+	std::vector<uint32_t> references;
+	std::vector<std::pair<size_t, size_t>> ranges(bvh.node_count);
+	uint32_t numVertices = 0;
 
-	// Next get the unique vertex indices for each leaf node...
+	std::stack<std::pair<size_t, bool>> nodeStack;
+	nodeStack.push({ 0, false });
+	do
+	{
+		auto [index, visited] = nodeStack.top();
+		nodeStack.pop();
 
-	std::vector<std::set<uint32_t>> uniqueVerticesByNode;
-	uniqueVerticesByNode.resize(bvh.node_count);
+		if (visited)
+		{
+			ranges[index].second = references.size();
+			continue;
+		}
 
-	for (const auto nodeIndex : leaves)
-	{
-		auto& node = bvh.nodes[nodeIndex];
-		auto& uniqueVertices = uniqueVerticesByNode[nodeIndex];
-		for (int i = 0; i < node.primitive_count; i++)
+		auto& node = bvh.nodes[index];
+		ranges[index].first = references.size();
+		if (node.is_leaf())
 		{
-			auto primitiveIndex = bvh.primitive_indices[node.first_child_or_primitive + i];
-			auto& face = primitives[primitiveIndex];
-			std::copy(face.begin(), face.end(), std::inserter(uniqueVertices, uniqueVertices.end()));
+			for (int i = 0; i < node.primitive_count; i++)
+			{
+				auto& face = primitives[bvh.primitive_indices[node.first_child_or_primitive + i]];
+				for (const auto v : face)
+				{
+					references.push_back(v);
+					numVertices = std::max(numVertices, v + 1);
+				}
+			}
+			ranges[index].second = references.size();
 		}
-	}
+		else
+		{
+			nodeStack.push({ index, true });
+			nodeStack.push({ node.first_child_or_primitive + 1, false });
+			nodeStack.push({ node.first_child_or_primitive, false });
+		}
+	} while (!nodeStack.empty());
+
+	// Answer the queries in order of where their ranges end
 
-	// ...and extend these into each branch node
+	std::vector<size_t> queries(bvh.node_count);
+	std::iota(queries.begin(), queries.end(), 0);
+	std::sort(queries.begin(), queries.end(), [&](size_t a, size_t b) {
+		return ranges[a].second < ranges[b].second;
+	});
+
+	std::vector<int32_t> tree(references.size() + 1, 0);
+	auto add = [&](size_t position, int32_t value) {
+		for (auto i = position + 1; i < tree.size(); i += i & (~i + 1))
+		{
+			tree[i] += value;
+		}
+	};
+	auto sum = [&](size_t end) { // Sum of [0, end)
+		int64_t total = 0;
+		for (auto i = end; i > 0; i -= i & (~i + 1))
+		{
+			total += tree[i];
+		}
+		return total;
+	};
 
-	std::reverse(branches.begin(), branches.end());
+	const uint32_t none = std::numeric_limits<uint32_t>::max();
+	std::vector<uint32_t> lastReference(numVertices, none);
+	std::vector<size_t> counts(bvh.node_count, 0);
 
-	for (const auto nodeIndex : branches)
+	auto query = queries.begin();
+	for (size_t position = 0; position <= references.size(); position++)
 	{
-		auto& node = bvh.nodes[nodeIndex];
-		auto& uniqueVertices = uniqueVerticesByNode[nodeIndex];
-		auto& left = uniqueVerticesByNode[node.first_child_or_primitive];
-		auto& right = uniqueVerticesByNode[node.first_child_or_primitive + 1];
+		while (query != queries.end() && ranges[*query].second == position)
+		{
+			counts[*query] = sum(position) - sum(ranges[*query].first);
+			query++;
+		}
 
-		std::copy(left.begin(), left.end(), std::inserter(uniqueVertices, uniqueVertices.end()));
-		std::copy(right.begin(), right.end(), std::inserter(uniqueVertices, uniqueVertices.end()));
+		if (position < references.size())
+		{
+			auto v = references[position];
+			if (lastReference[v] != none)
+			{
+				add(lastReference[v], -1);
+			}
+			add(position, 1);
+			lastReference[v] = position;
+		}
 	}
 
-	return uniqueVerticesByNode;
+	return counts;
 }
 
 // Gets the branch nodes that contain fewer than REPO_MP_MAX_VERTEX_COUNT beneath
@@ -901,13 +1526,7 @@ void MultipartOptimizer::splitMesh(
 	// by the node(s), which will be used in the re-indexing.
 
 	auto faces = node.getLoadedFaces();
-	auto uniqueVerticesByNode = getUniqueVertices(bvh, faces);
-
-	auto vertexCounts = std::vector<size_t>();
-	for (const auto set : uniqueVerticesByNode)
-	{
-		vertexCounts.push_back(set.size());
-	}
+	auto vertexCounts = getUniqueVertexCounts(bvh, faces);
 
 	// Next, traverse the tree again, but this time depth first, cutting the tree
 	// at nodes where the vertex count drops below the target threshold.
@@ -943,6 +1562,8 @@ void MultipartOptimizer::splitMesh(
 	auto normals = node.getLoadedNormals();
 	auto uvChannels = node.getLoadedUVChannelsSeparated();
 
+	std::vector<uint32_t> globalToLocalIndex(vertices.size());
+
 	for (const auto head : branchNodes)
 	{
 		// Get all the faces, from all the leaf nodes within the branch
@@ -955,13 +1576,19 @@ void MultipartOptimizer::splitMesh(
 		// done through a reverse lookup into the set of unique vertices
 		// referenced by all the faces in the new mesh (i.e. at the branch node).
 
-		auto& meshGlobalIndicesSet = uniqueVerticesByNode[head];
-		std::vector<size_t> globalVertexIndices(meshGlobalIndicesSet.begin(), meshGlobalIndicesSet.end()); // An array of indices into the gloabl vertex array, for this submesh
-		std::map<size_t, size_t> globalToLocalIndex;
+		std::vector<uint32_t> globalVertexIndices; // An array of indices into the gloabl vertex array, for this submesh
+		for (const auto faceIndex : primitives)
+		{
+			auto& face = faces[faceIndex];
+			globalVertexIndices.insert(globalVertexIndices.end(), face.begin(), face.end());
+		}
+		std::sort(globalVertexIndices.begin(), globalVertexIndices.end());
+		globalVertexIndices.erase(std::unique(globalVertexIndices.begin(), globalVertexIndices.end()), globalVertexIndices.end());
 
-		// Create the inverse lookup table for the re-indexing
+		// Create the inverse lookup table for the re-indexing. The table is shared
+		// between submeshes; only the entries for this one are valid.
 
-		for (auto i = 0; i < globalVertexIndices.size(); i++)
+		for (uint32_t i = 0; i < globalVertexIndices.size(); i++)
 		{
 			globalToLocalIndex[globalVertexIndices[i]] = i;
 		}
@@ -1081,20 +1708,19 @@ MultipartOptimizer::Bvh MultipartOptimizer::buildBoundsBvh(
 	// refer to entries in this list, and so the entries in meshes, if the order
 	// is the same (which it is).
 
-	auto boundingBoxes = std::vector<bvh::BoundingBox<Scalar>>();
-	for (const int index : binIndexes)
+	const int64_t numMeshes = binIndexes.size();
+	auto boundingBoxes = std::vector<bvh::BoundingBox<Scalar>>(numMeshes);
+	auto centers = std::vector<BvhVector3>(numMeshes);
+
+	#pragma omp parallel for num_threads(getBvhThreads(numThreads)) if(numMeshes > REPO_BVH_PARALLEL_THRESHOLD)
+	for (int64_t i = 0; i < numMeshes; i++)
 	{
-		auto& node = meshes[index];
+		auto& node = meshes[binIndexes[i]];
 		auto bounds = node.getBoundingBox();
 		auto min = BvhVector3(bounds.min().x, bounds.min().y, bounds.min().z);
 		auto max = BvhVector3(bounds.max().x, bounds.max().y, bounds.max().z);
-		boundingBoxes.push_back(bvh::BoundingBox<Scalar>(min, max));
-	}
-
-	auto centers = std::vector<BvhVector3>();
-	for (const auto& bounds : boundingBoxes)
-	{
-		centers.push_back(bounds.center());
+		boundingBoxes[i] = bvh::BoundingBox<Scalar>(min, max);
+		centers[i] = boundingBoxes[i].center();
 	}
 
 	auto globalBounds = bvh::compute_bounding_boxes_union(boundingBoxes.data(), boundingBoxes.size());
@@ -1103,7 +1729,10 @@ MultipartOptimizer::Bvh MultipartOptimizer::buildBoundsBvh(
 
 	Bvh bvh;
 	bvh::SweepSahBuilder<Bvh> builder(bvh);
-	builder.build(globalBounds, boundingBoxes.data(), centers.data(), boundingBoxes.size());
+	{
+		ScopedBvhThreads threads(numThreads);
+		builder.build(globalBounds, boundingBoxes.data(), centers.data(), boundingBoxes.size());
+	}
 
 	return bvh;
 }
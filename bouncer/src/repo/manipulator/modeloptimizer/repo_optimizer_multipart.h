@@ -30,6 +30,7 @@
 #include "../../lib/datastructure/repo_structs.h"
 #include "bvh/bvh.hpp"
 #include "bvh/sweep_sah_builder.hpp"
+#include "repo_mesh_simplifier.h"
 #include <repo/manipulator/modelconvertor/export/repo_model_export_abstract.h>
 #include <repo/core/model/bson/repo_bson.h>
 #include <repo/core/model/bson/repo_node_streaming_mesh.h>
@@ -45,7 +46,38 @@ namespace repo {
 				typedef bvh::Vector3<Scalar> BvhVector3;
 
 			public:
-				
+
+				/**
+				* @param numThreads the number of threads to build the BVHs with. 0 uses
+				* the OpenMP default (usually the number of cores). The clusters are the
+				* same regardless of the number of threads.
+				* @param optimiseVertexCache whether to reorder the faces and vertices of
+				* each supermesh for the GPU (see VertexCacheOptimizer). This changes
+				* only the order of the buffers, not their contents or mapping ranges.
+				*/
+				MultipartOptimizer(int numThreads = 0, bool optimiseVertexCache = true) :
+					numThreads(numThreads),
+					optimiseVertexCache(optimiseVertexCache)
+				{
+				}
+
+				/**
+				* Controls the simplified levels of detail built for each supermesh
+				* (see MeshSimplifier). Each level is simplified from the one before,
+				* and passed to the exporter with addSupermeshLod().
+				*/
+				struct LodOptions
+				{
+					size_t numLevels = 0; // 0 disables level of detail generation
+					float ratio = 0.25f; // The fraction of the faces of the previous level to keep
+					float maxError = 0.01f; // The error allowed for the first level, relative to the diagonal of the supermesh bounds. Doubles with each level.
+				};
+
+				void setLodOptions(const LodOptions& options)
+				{
+					lodOptions = options;
+				}
+
 				bool processScene(
 					std::string database,
 					std::string collection,
@@ -70,14 +102,67 @@ namespace repo {
 
 				struct ProcessingJob {
 					std::string description;
+					std::string key; // Identifies the job between revisions, for matching clusters
 					repo::core::handler::database::query::RepoQuery filter;
 					repo::lib::RepoUUID texId;
 
 					bool isTexturedJob() const {
 						return !texId.isDefaultValue();
 					}
-				};							
-				
+				};
+
+				/**
+				* A cluster of meshes and the supermeshes that were built from it, as
+				* stored in the stash clusters collection. Members are identified by their
+				* content keys rather than their ids, as ids are regenerated for each
+				* revision, so clusters can be matched between revisions.
+				*/
+				struct cluster_record_t {
+					struct supermesh_t {
+						repo::lib::RepoUUID revId; // The revision the supermesh was exported with
+						repo::lib::RepoUUID id;
+						std::vector<std::pair<int, repo::lib::repo_mesh_mapping_t>> mapping; // Index into members, and the ranges/bounds of that member
+					};
+
+					std::string job;
+					std::vector<std::string> members;
+					std::vector<supermesh_t> supermeshes;
+				};
+
+				int numThreads;
+				bool optimiseVertexCache;
+				LodOptions lodOptions;
+
+				// The revision being processed
+				repo::lib::RepoUUID currentRevId;
+
+				// The clusters of the previous revision, that may be reused by this one,
+				// and the revision they were stored under
+				std::vector<cluster_record_t> previousClusterRecords;
+				repo::lib::RepoUUID previousClusterRevId;
+
+				// The clusters of the current revision, to be stored once the export is done
+				std::vector<cluster_record_t> clusterRecords;
+
+				// The record of the cluster currently being turned into supermeshes, and a
+				// lookup of the member index of each mesh in it (by shared id)
+				cluster_record_t* activeClusterRecord = nullptr;
+				std::unordered_map<repo::lib::RepoUUID, int, repo::lib::RepoUUIDHasher> activeClusterMembers;
+
+				// Set to false when the exporter does not support reusing supermeshes
+				bool reuseSupported = true;
+
+				// The number of clusters of the current revision that were reused
+				size_t numReusedClusters = 0;
+
+				// Supermeshes waiting to have their levels of detail built. These are
+				// processed in batches, so the simplification can run in parallel.
+				std::vector<std::unique_ptr<repo::core::model::SupermeshNode>> pendingLods;
+
+				// Whether levels of detail are built for this export, which requires
+				// them to be enabled and the exporter to support them
+				bool lodsSupported = false;
+
 
 				typedef std::unordered_map <repo::lib::RepoUUID, std::shared_ptr<repo::core::model::MaterialNode>, repo::lib::RepoUUIDHasher> MaterialPropMap;
 				typedef std::unordered_map<repo::lib::RepoUUID, repo::lib::RepoMatrix, repo::lib::RepoUUIDHasher> TransformMap;
@@ -108,7 +193,12 @@ namespace repo {
 					const repo::lib::RepoUUID& revId
 				);
 
-				std::vector < repo::lib::RepoUUID> getAllTextureIds(
+				/**
+				* Returns the ids of the textures of a grouping, with a digest of each
+				* texture (empty if the node has none) that can be compared between
+				* revisions.
+				*/
+				std::vector<std::pair<repo::lib::RepoUUID, std::string>> getAllTextureIds(
 					repo::core::handler::AbstractDatabaseHandler *handler,
 					const std::string &database,
 					const std::string &collection,
@@ -116,6 +206,63 @@ namespace repo {
 					const std::string& grouping
 				);
 
+				repo::lib::RepoUUID getPreviousRevision(
+					repo::core::handler::AbstractDatabaseHandler* handler,
+					const std::string& database,
+					const std::string& collection,
+					const repo::lib::RepoUUID& revId
+				);
+
+				/**
+				* Returns the cluster records of a revision. If the revision shares the
+				* records of an earlier one, those are returned instead, and the revision
+				* they were stored under is written to sourceRevId.
+				*/
+				std::vector<cluster_record_t> getClusterRecords(
+					repo::core::handler::AbstractDatabaseHandler* handler,
+					const std::string& database,
+					const std::string& collection,
+					const repo::lib::RepoUUID& revId,
+					repo::lib::RepoUUID& sourceRevId
+				);
+
+				/**
+				* Stores the cluster records of the current revision. If every cluster
+				* of the previous revision was reused and no new ones were built, only a
+				* reference to the records of the previous revision is stored.
+				*/
+				void storeClusterRecords(
+					repo::core::handler::AbstractDatabaseHandler* handler,
+					const std::string& database,
+					const std::string& collection,
+					const repo::lib::RepoUUID& revId
+				);
+
+				/**
+				* Returns a digest of the geometry, world transform and material of a
+				* node, which is identical for two nodes only if they would contribute the
+				* same geometry to a supermesh. Returns an empty string if the node has
+				* no geometry digest.
+				*/
+				std::string getContentKey(
+					const repo::core::model::StreamingMeshNode& node,
+					const TransformMap& transformMap,
+					const MaterialPropMap& matPropMap
+				);
+
+				/**
+				* Passes the supermeshes of any clusters from the previous revision, whose
+				* members all have a matching node in nodes, to the exporter. Returns a
+				* flag for each node indicating whether it has been exported this way.
+				*/
+				std::vector<bool> reuseClusters(
+					repo::manipulator::modelconvertor::AbstractModelExport* exporter,
+					const MaterialPropMap& matPropMap,
+					std::vector<repo::core::model::StreamingMeshNode>& nodes,
+					const std::vector<std::string>& keys,
+					const ProcessingJob& job
+				);
+
 				ProcessingJob createUntexturedJob(
 					const std::string &description,
 					const repo::lib::RepoUUID &revId,
@@ -131,7 +278,8 @@ namespace repo {
 					const int primitive,
 					const std::string &grouping,
 					const bool hasNormals,
-					const repo::lib::RepoUUID &texId
+					const repo::lib::RepoUUID &texId,
+					const std::string &texKey
 				);
 
 				void clusterAndSupermesh(
@@ -152,15 +300,39 @@ namespace repo {
 					const TransformMap& transformMap,
 					const MaterialPropMap& matPropMap,
 					std::vector<repo::core::model::StreamingMeshNode>& meshNodes,
+					const std::vector<std::string>& keys,
 					const std::vector<std::vector<int>>& clusters,
-					const repo::lib::RepoUUID &texId
+					const ProcessingJob &job
 				);
 
+				/*
+				* Passes the mapped mesh to the exporter as a supermesh. The buffers of
+				* the mapped mesh may be reordered first.
+				*/
 				void createSuperMesh(
 					repo::manipulator::modelconvertor::AbstractModelExport *exporter,
-					const mapped_mesh_t& mappedMesh
+					mapped_mesh_t& mappedMesh
+				);
+
+				/*
+				* Builds the geometry of the levels of detail of the pending supermeshes
+				* in parallel, then creates their nodes and passes them to the exporter
+				* on the calling thread.
+				*/
+				void createLods(
+					repo::manipulator::modelconvertor::AbstractModelExport *exporter
 				);
 
+				/*
+				* Returns the geometry of the levels of detail of one supermesh, from the
+				* most to the least detailed. There may be fewer than requested, if the
+				* supermesh cannot be simplified any further within the error allowed.
+				* This does not create any nodes, so may run on any thread.
+				*/
+				std::vector<MeshSimplifier::Level> simplifySupermesh(
+					const repo::core::model::SupermeshNode& supermesh
+				) const;
+
 				void appendMesh(					
 					repo::core::model::StreamingMeshNode &node,
 					const MaterialPropMap &matPropMap,
@@ -183,7 +355,11 @@ namespace repo {
 					size_t head
 				);
 
-				std::vector<std::set<uint32_t>> getUniqueVertices(
+				/*
+				* Returns, for each node in the Bvh, the number of distinct vertices
+				* referenced by the faces beneath it
+				*/
+				std::vector<size_t> getUniqueVertexCounts(
 					const Bvh& bvh,
 					const std::vector<repo::lib::repo_face_t>& primitives // The primitives in this tree are faces
 				);
@@ -0,0 +1,532 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "repo_vertex_cache_optimizer.h"
+
+#include <repo_log.h>
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <type_traits>
+
+using namespace repo::manipulator::modeloptimizer;
+using namespace repo::lib;
+
+// The scoring parameters of Forsyth's algorithm. The cache modelled for scoring
+// is an LRU cache, which is larger than the FIFO cache being optimised for, so
+// the algorithm prefers to reuse vertices however recently they were used.
+
+#define REPO_VCO_SCORE_CACHE_SIZE 32
+#define REPO_VCO_CACHE_DECAY_POWER 1.5f
+#define REPO_VCO_LAST_TRI_SCORE 0.75f
+#define REPO_VCO_VALENCE_BOOST_SCALE 2.0f
+#define REPO_VCO_VALENCE_BOOST_POWER 0.5f
+
+namespace {
+	struct ScoreTables
+	{
+		float cache[REPO_VCO_SCORE_CACHE_SIZE];
+		float valence[64];
+
+		ScoreTables()
+		{
+			for (int i = 0; i < REPO_VCO_SCORE_CACHE_SIZE; i++) {
+				if (i < 3) {
+					// The vertices of the last triangle get a fixed score, so the
+					// algorithm doesn't just pick the triangle that shares an edge
+					cache[i] = REPO_VCO_LAST_TRI_SCORE;
+				}
+				else {
+					auto scale = 1.0f - (float)(i - 3) / (REPO_VCO_SCORE_CACHE_SIZE - 3);
+					cache[i] = std::pow(scale, REPO_VCO_CACHE_DECAY_POWER);
+				}
+			}
+			for (int i = 0; i < 64; i++) {
+				valence[i] = valenceScore(i);
+			}
+		}
+
+		static float valenceScore(uint32_t remaining)
+		{
+			// Vertices with only a few triangles left are boosted, so the algorithm
+			// finishes off regions rather than leaving isolated triangles behind
+
+			return remaining ? REPO_VCO_VALENCE_BOOST_SCALE * std::pow((float)remaining, -REPO_VCO_VALENCE_BOOST_POWER) : 0;
+		}
+
+		float score(int cachePosition, uint32_t remaining) const
+		{
+			if (!remaining) {
+				return -1;
+			}
+			auto s = remaining < 64 ? valence[remaining] : valenceScore(remaining);
+			if (cachePosition >= 0) {
+				s += cache[cachePosition];
+			}
+			return s;
+		}
+	};
+
+	const ScoreTables& getScoreTables()
+	{
+		static ScoreTables tables;
+		return tables;
+	}
+
+	bool isTriangles(const std::vector<repo_face_t>& faces, size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++) {
+			if (faces[i].size() != 3) {
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+VertexCacheOptimizer::VertexCacheOptimizer(
+	size_t cacheSize,
+	float overdrawThreshold) :
+	cacheSize(std::max<size_t>(cacheSize, 3)),
+	overdrawThreshold(overdrawThreshold)
+{
+}
+
+void VertexCacheOptimizer::optimise(
+	std::vector<RepoVector3D>& vertices,
+	std::vector<RepoVector3D>& normals,
+	std::vector<std::vector<RepoVector2D>>& uvChannels,
+	std::vector<repo_face_t>& faces,
+	const std::vector<repo_mesh_mapping_t>& mapping) const
+{
+	for (const auto& m : mapping)
+	{
+		if (m.triFrom < 0 || m.triFrom > m.triTo || (size_t)m.triTo > faces.size() ||
+			m.vertFrom < 0 || m.vertFrom > m.vertTo || (size_t)m.vertTo > vertices.size()) {
+			repoWarning << "Not optimising submesh " << m.mesh_id << " as its mapping is outside the supermesh";
+			continue;
+		}
+
+		// The submeshes must be self contained for the vertices to be reordered
+		// without affecting the others
+
+		bool contained = true;
+		for (auto f = m.triFrom; f < m.triTo && contained; f++) {
+			for (size_t i = 0; i < faces[f].size(); i++) {
+				contained &= faces[f][i] >= (uint32_t)m.vertFrom && faces[f][i] < (uint32_t)m.vertTo;
+			}
+		}
+		if (!contained) {
+			repoWarning << "Not optimising submesh " << m.mesh_id << " as it references vertices outside its range";
+			continue;
+		}
+
+		if (isTriangles(faces, m.triFrom, m.triTo)) {
+			optimiseFaces(faces, m.triFrom, m.triTo, vertices);
+		}
+
+		auto remap = optimiseVertexFetch(faces, m.triFrom, m.triTo, m.vertFrom, m.vertTo);
+
+		auto apply = [&](auto& attribute) {
+			if (attribute.size() != vertices.size()) {
+				return;
+			}
+			std::vector<typename std::decay_t<decltype(attribute)>::value_type> original(attribute.begin() + m.vertFrom, attribute.begin() + m.vertTo);
+			for (size_t i = 0; i < original.size(); i++) {
+				attribute[remap[i]] = original[i];
+			}
+		};
+
+		apply(vertices);
+		apply(normals);
+		for (auto& uvs : uvChannels) {
+			apply(uvs);
+		}
+	}
+}
+
+void VertexCacheOptimizer::optimiseFaces(
+	std::vector<repo_face_t>& faces,
+	size_t begin,
+	size_t end,
+	const std::vector<RepoVector3D>& vertices) const
+{
+	end = std::min(end, faces.size());
+	if (end <= begin + 1 || !isTriangles(faces, begin, end)) {
+		return;
+	}
+
+	const auto& tables = getScoreTables();
+	const size_t numTriangles = end - begin;
+
+	// Work with indices local to the range, so the tables below are only as
+	// large as the submesh
+
+	uint32_t minIndex = UINT32_MAX, maxIndex = 0;
+	for (size_t f = begin; f < end; f++) {
+		for (size_t i = 0; i < 3; i++) {
+			minIndex = std::min(minIndex, faces[f][i]);
+			maxIndex = std::max(maxIndex, faces[f][i]);
+		}
+	}
+	const size_t numVertices = (size_t)maxIndex - minIndex + 1;
+
+	// Adjacency of vertices to triangles, in compressed rows. The live entries
+	// for each vertex are the first remaining[v] of its row.
+
+	std::vector<uint32_t> remaining(numVertices, 0);
+	for (size_t f = begin; f < end; f++) {
+		for (size_t i = 0; i < 3; i++) {
+			remaining[faces[f][i] - minIndex]++;
+		}
+	}
+
+	std::vector<uint32_t> offsets(numVertices + 1, 0);
+	for (size_t v = 0; v < numVertices; v++) {
+		offsets[v + 1] = offsets[v] + remaining[v];
+	}
+
+	std::vector<uint32_t> adjacency(offsets.back());
+	{
+		std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+		for (size_t t = 0; t < numTriangles; t++) {
+			for (size_t i = 0; i < 3; i++) {
+				adjacency[fill[faces[begin + t][i] - minIndex]++] = t;
+			}
+		}
+	}
+
+	auto vertex = [&](size_t t, size_t i) {
+		return faces[begin + t][i] - minIndex;
+	};
+
+	std::vector<int> cachePosition(numVertices, -1);
+	std::vector<float> vertexScores(numVertices);
+	for (size_t v = 0; v < numVertices; v++) {
+		vertexScores[v] = tables.score(-1, remaining[v]);
+	}
+
+	auto triangleScore = [&](size_t t) {
+		return vertexScores[vertex(t, 0)] + vertexScores[vertex(t, 1)] + vertexScores[vertex(t, 2)];
+	};
+
+	std::vector<bool> emitted(numTriangles, false);
+	int64_t best = -1;
+	float bestScore = -1;
+	for (size_t t = 0; t < numTriangles; t++) {
+		auto score = triangleScore(t);
+		if (score > bestScore) {
+			bestScore = score;
+			best = t;
+		}
+	}
+
+	std::vector<repo_face_t> ordered;
+	ordered.reserve(numTriangles);
+
+	std::vector<uint32_t> cache, newCache;
+	cache.reserve(REPO_VCO_SCORE_CACHE_SIZE + 3);
+	newCache.reserve(REPO_VCO_SCORE_CACHE_SIZE + 3);
+
+	size_t cursor = 0; // Where to look for a new start when the cache has nothing left
+	while (ordered.size() < numTriangles)
+	{
+		if (best < 0) {
+			while (emitted[cursor]) {
+				cursor++;
+			}
+			best = cursor;
+		}
+
+		ordered.push_back(faces[begin + best]);
+		emitted[best] = true;
+
+		// Remove the triangle from the adjacency of its vertices, and put them at
+		// the front of the cache
+
+		newCache.clear();
+		for (size_t i = 0; i < 3; i++) {
+			auto v = vertex(best, i);
+			auto row = adjacency.begin() + offsets[v];
+			auto it = std::find(row, row + remaining[v], (uint32_t)best);
+			if (it != row + remaining[v]) {
+				std::iter_swap(it, row + remaining[v] - 1);
+				remaining[v]--;
+			}
+			if (std::find(newCache.begin(), newCache.end(), v) == newCache.end()) {
+				newCache.push_back(v);
+			}
+		}
+		auto numNew = newCache.size();
+		for (auto v : cache) {
+			if (std::find(newCache.begin(), newCache.begin() + numNew, v) == newCache.begin() + numNew) {
+				newCache.push_back(v);
+			}
+		}
+
+		// Update the scores of everything in the cache, and anything that has just
+		// dropped out of it
+
+		for (size_t i = 0; i < newCache.size(); i++) {
+			auto v = newCache[i];
+			cachePosition[v] = i < REPO_VCO_SCORE_CACHE_SIZE ? (int)i : -1;
+			vertexScores[v] = tables.score(cachePosition[v], remaining[v]);
+		}
+
+		best = -1;
+		bestScore = -1;
+		for (auto v : newCache) {
+			for (size_t j = 0; j < remaining[v]; j++) {
+				auto t = adjacency[offsets[v] + j];
+				auto score = triangleScore(t);
+				if (score > bestScore) {
+					bestScore = score;
+					best = t;
+				}
+			}
+		}
+
+		if (newCache.size() > REPO_VCO_SCORE_CACHE_SIZE) {
+			newCache.resize(REPO_VCO_SCORE_CACHE_SIZE);
+		}
+		std::swap(cache, newCache);
+	}
+
+	std::copy(ordered.begin(), ordered.end(), faces.begin() + begin);
+
+	if (overdrawThreshold > 0 && vertices.size() > maxIndex) {
+		optimiseOverdraw(faces, begin, end, vertices);
+	}
+}
+
+bool VertexCacheOptimizer::optimiseOverdraw(
+	std::vector<repo_face_t>& faces,
+	size_t begin,
+	size_t end,
+	const std::vector<RepoVector3D>& vertices) const
+{
+	uint32_t minIndex = UINT32_MAX, maxIndex = 0;
+	for (size_t f = begin; f < end; f++) {
+		for (size_t i = 0; i < 3; i++) {
+			minIndex = std::min(minIndex, faces[f][i]);
+			maxIndex = std::max(maxIndex, faces[f][i]);
+		}
+	}
+
+	// A FIFO cache as in simulate(). Moving the clock forward by more than the
+	// size of the cache empties it.
+
+	std::vector<size_t> timestamps((size_t)maxIndex - minIndex + 1, 0);
+	size_t timestamp = cacheSize + 1;
+	auto draw = [&](const repo_face_t& face) {
+		int misses = 0;
+		for (size_t i = 0; i < 3; i++) {
+			auto& t = timestamps[face[i] - minIndex];
+			if (timestamp - t > cacheSize) {
+				t = timestamp++;
+				misses++;
+			}
+		}
+		return misses;
+	};
+
+	// Split the faces into clusters at the points where the cache starts over -
+	// where a triangle has to transform all three of its vertices. Clusters can
+	// be reordered with each other at little cost to the cache.
+
+	std::vector<size_t> hard;
+	for (size_t f = begin; f < end; f++) {
+		if (draw(faces[f]) == 3 || f == begin) {
+			hard.push_back(f);
+		}
+	}
+	hard.push_back(end);
+
+	// These are usually too coarse to be worth sorting, so each is split further
+	// wherever the faces drawn since the last split, starting with an empty
+	// cache, would have an ACMR within the threshold of the whole cluster.
+
+	std::vector<size_t> clusters;
+	for (size_t h = 0; h + 1 < hard.size(); h++) {
+		auto limit = simulate(faces, cacheSize, hard[h], hard[h + 1]).acmr() * overdrawThreshold;
+
+		clusters.push_back(hard[h]);
+		timestamp += cacheSize + 1;
+		size_t start = hard[h];
+		size_t misses = 0;
+		for (size_t f = hard[h]; f < hard[h + 1]; f++) {
+			misses += draw(faces[f]);
+			if (f + 1 < hard[h + 1] && misses <= limit * (f + 1 - start)) {
+				clusters.push_back(f + 1);
+				timestamp += cacheSize + 1;
+				start = f + 1;
+				misses = 0;
+			}
+		}
+	}
+
+	if (clusters.size() < 2) {
+		return false;
+	}
+	clusters.push_back(end);
+
+	// Draw the clusters that face out from the centre of the mesh first, as
+	// these are the most likely to occlude the others
+
+	struct Cluster
+	{
+		size_t begin;
+		size_t end;
+		RepoVector3D centroid;
+		RepoVector3D normal;
+		float area = 0;
+		float sortKey = 0;
+	};
+
+	std::vector<Cluster> sorted(clusters.size() - 1);
+	RepoVector3D meshCentroid;
+	float meshArea = 0;
+	for (size_t c = 0; c < sorted.size(); c++) {
+		auto& cluster = sorted[c];
+		cluster.begin = clusters[c];
+		cluster.end = clusters[c + 1];
+		for (size_t f = cluster.begin; f < cluster.end; f++) {
+			auto a = vertices[faces[f][0]];
+			auto b = vertices[faces[f][1]];
+			auto c = vertices[faces[f][2]];
+			auto cross = (b - a).crossProduct(c - a);
+			auto area = cross.norm() * 0.5f;
+			auto centre = a + b + c;
+			cluster.centroid = cluster.centroid + RepoVector3D(centre.x * area, centre.y * area, centre.z * area);
+			cluster.normal = cluster.normal + cross;
+			cluster.area += area;
+		}
+		meshCentroid = meshCentroid + cluster.centroid;
+		meshArea += cluster.area;
+	}
+
+	if (meshArea <= 0) {
+		return false;
+	}
+
+	meshCentroid = RepoVector3D(meshCentroid.x / (meshArea * 3), meshCentroid.y / (meshArea * 3), meshCentroid.z / (meshArea * 3));
+	for (auto& cluster : sorted) {
+		if (cluster.area > 0) {
+			auto scale = 1.0f / (cluster.area * 3);
+			auto centroid = RepoVector3D(cluster.centroid.x * scale, cluster.centroid.y * scale, cluster.centroid.z * scale);
+			cluster.normal.normalize();
+			cluster.sortKey = (centroid - meshCentroid).dotProduct(cluster.normal);
+		}
+	}
+
+	std::stable_sort(sorted.begin(), sorted.end(), [](const Cluster& a, const Cluster& b) {
+		return a.sortKey > b.sortKey;
+	});
+
+	std::vector<repo_face_t> ordered;
+	ordered.reserve(end - begin);
+	for (const auto& cluster : sorted) {
+		ordered.insert(ordered.end(), faces.begin() + cluster.begin, faces.begin() + cluster.end);
+	}
+
+	auto before = simulate(faces, cacheSize, begin, end).acmr();
+	std::vector<repo_face_t> original(faces.begin() + begin, faces.begin() + end);
+	std::copy(ordered.begin(), ordered.end(), faces.begin() + begin);
+	auto after = simulate(faces, cacheSize, begin, end).acmr();
+
+	if (after > before * overdrawThreshold) {
+		std::copy(original.begin(), original.end(), faces.begin() + begin);
+		return false;
+	}
+
+	return true;
+}
+
+std::vector<uint32_t> VertexCacheOptimizer::optimiseVertexFetch(
+	std::vector<repo_face_t>& faces,
+	size_t begin,
+	size_t end,
+	uint32_t vertFrom,
+	uint32_t vertTo)
+{
+	end = std::min(end, faces.size());
+
+	std::vector<uint32_t> remap(vertTo - vertFrom, UINT32_MAX);
+	uint32_t next = vertFrom;
+	for (size_t f = begin; f < end; f++) {
+		auto& face = faces[f];
+		for (size_t i = 0; i < face.size(); i++) {
+			auto& index = remap[face[i] - vertFrom];
+			if (index == UINT32_MAX) {
+				index = next++;
+			}
+			face[i] = index;
+		}
+	}
+
+	for (auto& index : remap) {
+		if (index == UINT32_MAX) {
+			index = next++;
+		}
+	}
+
+	return remap;
+}
+
+VertexCacheOptimizer::Statistics VertexCacheOptimizer::simulate(
+	const std::vector<repo_face_t>& faces,
+	size_t cacheSize,
+	size_t begin,
+	size_t end)
+{
+	end = std::min(end, faces.size());
+
+	Statistics statistics;
+	if (begin >= end) {
+		return statistics;
+	}
+
+	uint32_t maxIndex = 0;
+	for (size_t f = begin; f < end; f++) {
+		for (size_t i = 0; i < faces[f].size(); i++) {
+			maxIndex = std::max(maxIndex, faces[f][i]);
+		}
+	}
+
+	// A FIFO cache, where each vertex is stamped with the time it entered the
+	// cache. It is still in the cache if fewer than cacheSize others have
+	// entered since.
+
+	std::vector<size_t> timestamps((size_t)maxIndex + 1, SIZE_MAX);
+	size_t timestamp = cacheSize + 1;
+	for (size_t f = begin; f < end; f++) {
+		for (size_t i = 0; i < faces[f].size(); i++) {
+			auto& t = timestamps[faces[f][i]];
+			if (t == SIZE_MAX) {
+				statistics.numVertices++;
+			}
+			if (t == SIZE_MAX || timestamp - t > cacheSize) {
+				t = timestamp++;
+				statistics.numTransforms++;
+			}
+		}
+	}
+	statistics.numFaces = end - begin;
+
+	return statistics;
+}
@@ -0,0 +1,151 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+* Reorders the buffers of supermeshes for the GPU.
+*
+* Supermeshes are built by concatenating the geometry of their submeshes in
+* the order they are visited, so the faces are in whatever order the importer
+* wrote them, and the vertices in whatever order the faces happen to reference
+* them. This class reorders, within the ranges of each submesh:
+*
+* 1. The faces, so consecutive faces share vertices, and those vertices are
+*    still in the post-transform cache when they are reused. This uses the
+*    greedy scoring of Forsyth's linear-speed vertex cache optimisation.
+* 2. Optionally, clusters of those faces, so outward facing parts of the mesh
+*    are drawn first and occlude the rest, as long as this costs no more than
+*    a given fraction of the cache efficiency (after Sander et al.).
+* 3. The vertices, into the order the faces first reference them, so vertex
+*    fetches walk through memory linearly.
+*
+* The mapping ranges are not changed, so submeshes can still be picked out of
+* the supermesh as before.
+*/
+
+#pragma once
+
+#include "repo/repo_bouncer_global.h"
+#include "repo/lib/datastructure/repo_structs.h"
+#include "repo/lib/datastructure/repo_vector.h"
+
+#include <vector>
+
+namespace repo {
+	namespace manipulator {
+		namespace modeloptimizer {
+
+			class REPO_API_EXPORT VertexCacheOptimizer
+			{
+			public:
+				struct Statistics
+				{
+					size_t numFaces = 0;
+					size_t numVertices = 0; // Distinct vertices referenced by the faces
+					size_t numTransforms = 0; // Cache misses
+
+					/*
+					* Average cache miss ratio - vertex transforms per face. 3 is the
+					* worst case for triangles; about 0.5 is the best possible for a
+					* regular grid.
+					*/
+					double acmr() const
+					{
+						return numFaces ? (double)numTransforms / numFaces : 0;
+					}
+
+					/*
+					* Average transform to vertex ratio - 1 is optimal.
+					*/
+					double atvr() const
+					{
+						return numVertices ? (double)numTransforms / numVertices : 0;
+					}
+				};
+
+				/**
+				* @param cacheSize the size of the FIFO cache to optimise for. Most
+				* hardware has a cache of at least 16 entries.
+				* @param overdrawThreshold how much higher the ACMR is allowed to become
+				* in return for less overdraw, as a ratio. 0 disables the overdraw stage.
+				*/
+				VertexCacheOptimizer(
+					size_t cacheSize = 16,
+					float overdrawThreshold = 1.05f);
+
+				/**
+				* Reorders the faces and vertices of each submesh in the mapping. The
+				* normals and uv channels are reordered along with the vertices. Only
+				* triangles are reordered, but the vertices of all primitive types are.
+				*/
+				void optimise(
+					std::vector<repo::lib::RepoVector3D>& vertices,
+					std::vector<repo::lib::RepoVector3D>& normals,
+					std::vector<std::vector<repo::lib::RepoVector2D>>& uvChannels,
+					std::vector<repo::lib::repo_face_t>& faces,
+					const std::vector<repo::lib::repo_mesh_mapping_t>& mapping) const;
+
+				/**
+				* Reorders the triangles in the range [begin, end) for the cache and,
+				* if the vertices are given and the threshold allows, for overdraw.
+				*/
+				void optimiseFaces(
+					std::vector<repo::lib::repo_face_t>& faces,
+					size_t begin,
+					size_t end,
+					const std::vector<repo::lib::RepoVector3D>& vertices = {}) const;
+
+				/**
+				* Returns the new index of each vertex in the range [vertFrom, vertTo),
+				* such that the vertices are in the order they are first referenced by
+				* the faces in [begin, end). Unreferenced vertices are moved to the end
+				* of the range. The faces are updated to use the new indices.
+				*/
+				static std::vector<uint32_t> optimiseVertexFetch(
+					std::vector<repo::lib::repo_face_t>& faces,
+					size_t begin,
+					size_t end,
+					uint32_t vertFrom,
+					uint32_t vertTo);
+
+				/**
+				* Simulates a FIFO post-transform cache of the given size drawing the
+				* faces in the range [begin, end).
+				*/
+				static Statistics simulate(
+					const std::vector<repo::lib::repo_face_t>& faces,
+					size_t cacheSize,
+					size_t begin = 0,
+					size_t end = SIZE_MAX);
+
+			private:
+				size_t cacheSize;
+				float overdrawThreshold;
+
+				/*
+				* Reorders clusters of the (cache optimised) faces to reduce overdraw,
+				* returning false, and leaving the faces as they are, if the cache
+				* efficiency would drop by more than the threshold.
+				*/
+				bool optimiseOverdraw(
+					std::vector<repo::lib::repo_face_t>& faces,
+					size_t begin,
+					size_t end,
+					const std::vector<repo::lib::RepoVector3D>& vertices) const;
+			};
+		}
+	}
+}
@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <ostream>
 #include <string>
 #include <vector>
 #include "repo/lib/datastructure/repo_vector.h"
@@ -45,6 +46,7 @@ namespace repo {
 			{
 				std::string name; // The name of the original file (e.g. "Floor1.DWG")
 				std::vector<uint8_t> data; // The drawing in svg format
+				std::ostream* output = nullptr; // If set, the svg is written to this stream as it is created, instead of to data
 				DrawingCalibration calibration;
 			};
 		}
@@ -34,34 +34,86 @@ DrawingRevisionNode DrawingManager::fetchRevision(
 	);
 }
 
-uint8_t DrawingManager::commitImage(
-	repo::core::handler::AbstractDatabaseHandler* handler,
-	repo::core::handler::fileservice::FileManager* fileManager,
-	const std::string& teamspace,
+repo::core::handler::fileservice::FileManager::Metadata DrawingManager::getImageMetadata(
 	DrawingRevisionNode& revision,
 	const DrawingImageInfo& drawing
 )
 {
-	auto drawingRefNodeId = repo::lib::RepoUUID::createUUID();
 	auto name = drawing.name.substr(0, drawing.name.size() - 3) + "svg"; // The name should be the drawing's original name with an updated extension
 
-	repo::core::handler::AbstractDatabaseHandler::Metadata metadata;
-	auto revId = revision.getUniqueID();
+	repo::core::handler::fileservice::FileManager::Metadata metadata;
 	metadata[REPO_NODE_LABEL_NAME] = name;
 	metadata[REPO_LABEL_MEDIA_TYPE] = std::string(REPO_MEDIA_TYPE_SVG);
 	metadata[REPO_LABEL_PROJECT] = revision.getProject();
 	metadata[REPO_LABEL_MODEL] = revision.getModel();
-	metadata[REPO_NODE_REVISION_ID] = revId;
+	metadata[REPO_NODE_REVISION_ID] = revision.getUniqueID();
+	return metadata;
+}
+
+uint8_t DrawingManager::commitImage(
+	repo::core::handler::AbstractDatabaseHandler* handler,
+	repo::core::handler::fileservice::FileManager* fileManager,
+	const std::string& teamspace,
+	DrawingRevisionNode& revision,
+	const DrawingImageInfo& drawing
+)
+{
+	auto drawingRefNodeId = repo::lib::RepoUUID::createUUID();
 
 	fileManager->uploadFileAndCommit(
 		teamspace,
 		REPO_COLLECTION_DRAWINGS,
 		drawingRefNodeId,
 		drawing.data,
-		metadata,
+		getImageMetadata(revision, drawing),
+		repo::core::handler::fileservice::FileManager::Encoding::Gzip
+	);
+
+	updateRevision(handler, teamspace, revision, drawing, drawingRefNodeId);
+
+	return REPOERR_OK;
+}
+
+std::unique_ptr<repo::core::handler::fileservice::FileManager::FileStream> DrawingManager::createImageStream(
+	repo::core::handler::fileservice::FileManager* fileManager,
+	const std::string& teamspace
+)
+{
+	return fileManager->createFileStream(
+		teamspace,
+		REPO_COLLECTION_DRAWINGS,
 		repo::core::handler::fileservice::FileManager::Encoding::Gzip
 	);
+}
+
+uint8_t DrawingManager::commitImage(
+	repo::core::handler::AbstractDatabaseHandler* handler,
+	repo::core::handler::fileservice::FileManager* fileManager,
+	const std::string& teamspace,
+	DrawingRevisionNode& revision,
+	const DrawingImageInfo& drawing,
+	repo::core::handler::fileservice::FileManager::FileStream& image
+)
+{
+	auto drawingRefNodeId = repo::lib::RepoUUID::createUUID();
+
+	if (!fileManager->commitFileStream(image, drawingRefNodeId, getImageMetadata(revision, drawing))) {
+		return REPOERR_UPLOAD_FAILED;
+	}
+
+	updateRevision(handler, teamspace, revision, drawing, drawingRefNodeId);
 
+	return REPOERR_OK;
+}
+
+void DrawingManager::updateRevision(
+	repo::core::handler::AbstractDatabaseHandler* handler,
+	const std::string& teamspace,
+	DrawingRevisionNode& revision,
+	const DrawingImageInfo& drawing,
+	const repo::lib::RepoUUID& drawingRefNodeId
+)
+{
 	revision.addImage(drawingRefNodeId);
 
 	handler->upsertDocument(teamspace, REPO_COLLECTION_DRAWINGS, revision, false);
@@ -75,7 +127,7 @@ uint8_t DrawingManager::commitImage(
 		auto calibrationBSON = repo::core::model::RepoBSONFactory::makeRepoCalibration(
 			revision.getProject(),
 			revision.getModel(),
-			revId,
+			revision.getUniqueID(),
 			calibration.horizontalCalibration3d,
 			calibration.horizontalCalibration2d,
 			calibration.units
@@ -83,6 +135,4 @@ uint8_t DrawingManager::commitImage(
 
 		handler->insertDocument(teamspace, REPO_COLLECTION_CALIBRATIONS, calibrationBSON);
 	}
-
-	return REPOERR_OK;
-}
\ No newline at end of file
+}
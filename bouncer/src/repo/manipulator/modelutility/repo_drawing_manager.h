@@ -56,6 +56,46 @@ namespace repo {
 					DrawingRevisionNode& revision,
 					const DrawingImageInfo& drawing
 				);
+
+				/**
+				* Creates a file in the drawings collection that an svg can be written
+				* into as it is created (e.g. by setting it as the DrawingImageInfo's
+				* output). The svg is compressed as it is written.
+				*/
+				std::unique_ptr<repo::core::handler::fileservice::FileManager::FileStream> createImageStream(
+					repo::core::handler::fileservice::FileManager* fileManager,
+					const std::string& teamspace
+				);
+
+				/**
+				* As commitImage, but for a drawing whose svg has been written to image,
+				* instead of held in the DrawingImageInfo.
+				*/
+				uint8_t commitImage(
+					repo::core::handler::AbstractDatabaseHandler* handler,
+					repo::core::handler::fileservice::FileManager* fileManager,
+					const std::string& teamspace,
+					DrawingRevisionNode& revision,
+					const DrawingImageInfo& drawing,
+					repo::core::handler::fileservice::FileManager::FileStream& image
+				);
+
+			private:
+				repo::core::handler::fileservice::FileManager::Metadata getImageMetadata(
+					DrawingRevisionNode& revision,
+					const DrawingImageInfo& drawing
+				);
+
+				/**
+				* Points the revision to the committed image, and stores the calibration
+				*/
+				void updateRevision(
+					repo::core::handler::AbstractDatabaseHandler* handler,
+					const std::string& teamspace,
+					DrawingRevisionNode& revision,
+					const DrawingImageInfo& drawing,
+					const repo::lib::RepoUUID& drawingRefNodeId
+				);
 			};
 		}
 	}
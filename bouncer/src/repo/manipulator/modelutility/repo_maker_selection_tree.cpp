@@ -15,6 +15,7 @@
 *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include "repo_maker_selection_tree.h"
+#include "repo_selection_tree_binary.h"
 #include "repo/core/model/bson/repo_node_reference.h"
 
 #define RAPIDJSON_HAS_STDSTRING 1
@@ -25,6 +26,7 @@
 #include "repo/manipulator/modelutility/rapidjson/stringbuffer.h"
 #include "repo/core/handler/database/repo_query.h"
 #include "repo/core/model/bson/repo_bson.h"
+#include "repo/lib/repo_memory_accounting.h"
 
 using namespace repo::manipulator::modelutility;
 
@@ -44,7 +46,7 @@ SelectionTreeMaker::SelectionTreeMaker(
 	generateSelectionTrees();
 }
 
-static std::string nodeTypeToString(repo::core::model::NodeType type)
+std::string SelectionTree::typeToString(repo::core::model::NodeType type)
 {
 	switch (type) {
 	case repo::core::model::NodeType::MESH:
@@ -66,7 +68,7 @@ static std::string nodeTypeToString(repo::core::model::NodeType type)
 	}
 }
 
-static std::string childPathToString(const SelectionTree::ChildPath& path)
+std::string SelectionTree::pathToString(const ChildPath& path)
 {
 	std::string result;
 	for (size_t i = 0; i < path.size(); ++i) {
@@ -78,7 +80,7 @@ static std::string childPathToString(const SelectionTree::ChildPath& path)
 	return result;
 }
 
-static std::string toggleStateToString(SelectionTree::Node::ToggleState state)
+std::string SelectionTree::toggleStateToString(Node::ToggleState state)
 {
 	switch (state) {
 	case SelectionTree::Node::ToggleState::SHOW:
@@ -268,13 +270,13 @@ static void writePropertyTree(const SelectionTree::Node& node, const SelectionTr
 	writer.Key("account");	writer.String(tree.container.account);
 	writer.Key("project");	writer.String(tree.container.project);
 
-	writer.Key("type");	writer.String(nodeTypeToString(node.type));
+	writer.Key("type");	writer.String(SelectionTree::typeToString(node.type));
 
 	if (!node.name.empty()) {
 		writer.Key("name"); writer.String(node.name);
 	}
 
-	writer.Key("path");	writer.String(childPathToString(node.path));
+	writer.Key("path");	writer.String(SelectionTree::pathToString(node.path));
 	writer.Key("_id");	writer.String(node._id.toString());	
 	writer.Key("shared_id"); writer.String(node.shared_id.toString());
 
@@ -297,7 +299,7 @@ static void writePropertyTree(const SelectionTree::Node& node, const SelectionTr
 		writer.EndArray();
 	}
 
-	writer.Key("toggleState");	writer.String(toggleStateToString(node.toggleState));
+	writer.Key("toggleState");	writer.String(SelectionTree::toggleStateToString(node.toggleState));
 
 	writer.EndObject();
 }
@@ -338,7 +340,7 @@ std::map<std::string, std::string> serialiseSelectionTreesToJson(const Selection
 		writer.StartObject();
 		for (auto& p : trees.idToPath) {
 			writer.Key(p.first.toString());
-			writer.String(childPathToString(p.second));
+			writer.String(SelectionTree::pathToString(p.second));
 		}
 		writer.EndObject();
 
@@ -412,6 +414,13 @@ std::map<std::string, std::string> serialiseSelectionTreesToJson(const Selection
 std::map<std::string, std::vector<uint8_t>> SelectionTreeMaker::getSelectionTreeAsBuffer() const
 {
 	auto maps = serialiseSelectionTreesToJson(trees);
+
+	// Both the json strings and their copies are held until this returns
+	repo::lib::RepoMemoryAccounting::Allocation allocation(repo::lib::RepoMemoryAccounting::Tag::JSON);
+	for (const auto& map : maps) {
+		allocation.resize(allocation.getSize() + map.second.size());
+	}
+
 	std::map<std::string, std::vector<uint8_t>> buffer;
 	for (const auto& map : maps)
 	{
@@ -419,6 +428,7 @@ std::map<std::string, std::vector<uint8_t>> SelectionTreeMaker::getSelectionTree
 		if (!jsonString.empty())
 		{
 			size_t byteLength = jsonString.size() * sizeof(*jsonString.data());
+			allocation.resize(allocation.getSize() + byteLength);
 			buffer[map.first] = std::vector<uint8_t>();
 			buffer[map.first].resize(byteLength);
 			memcpy(buffer[map.first].data(), jsonString.data(), byteLength);
@@ -431,6 +441,11 @@ std::map<std::string, std::vector<uint8_t>> SelectionTreeMaker::getSelectionTree
 	return buffer;
 }
 
+std::vector<uint8_t> SelectionTreeMaker::getSelectionTreeAsBinary() const
+{
+	return serialiseSelectionTreesToBinary(trees);
+}
+
 SelectionTreeMaker::~SelectionTreeMaker()
 {
 }
@@ -60,6 +60,12 @@ namespace repo{
 				std::vector<Node> nodes; // This vector holds the memory containing the actual nodes
 
 				using ChildPath = std::vector<repo::lib::RepoUUID>;
+
+				// The string representations used in the json files
+
+				static std::string typeToString(repo::core::model::NodeType type);
+				static std::string pathToString(const ChildPath& path);
+				static std::string toggleStateToString(Node::ToggleState state);
 			};
 
 			using IdToName = std::unordered_map<repo::lib::RepoUUID, std::string, repo::lib::RepoUUIDHasher>;
@@ -106,6 +112,13 @@ namespace repo{
 				*/
 				std::map<std::string, std::vector<uint8_t>> getSelectionTreeAsBuffer() const;
 
+				/**
+				* Returns the selection trees in the binary format of
+				* repo_selection_tree_binary.h, from which any of the json files in
+				* getSelectionTreeAsBuffer can be rendered.
+				*/
+				std::vector<uint8_t> getSelectionTreeAsBinary() const;
+
 			private:
 				const repo::core::model::RepoScene *scene;
 				repo::core::handler::AbstractDatabaseHandler* handler;
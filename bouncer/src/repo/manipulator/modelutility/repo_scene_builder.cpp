@@ -25,9 +25,15 @@
 #include "repo/core/model/bson/repo_bson.h"
 #include "repo/core/model/bson/repo_bson_factory.h"
 #include "repo/core/handler/database/repo_query.h"
+#include "repo/lib/repo_exception.h"
+#include "repo/lib/repo_memory_accounting.h"
+#include "repo_texture_processor.h"
 
+#include <filesystem>
+#include <fstream>
 #include <variant>
 #include <semaphore>
+#include <set>
 #include <thread>
 #include "spscqueue/readerwriterqueue.h"
 
@@ -37,6 +43,9 @@ using namespace repo::core::model;
 // 500 Mb
 #define DEFAULT_THRESHOLD 1024*1024*500
 
+// 64 Mb
+#define DEFAULT_STAGING_THRESHOLD 1024*1024*64
+
 /*
 * The async worker of RepoSceneBuilder is responsible for the multithreaded
 * writes. It's public API is expected to be called from the same thread as
@@ -62,6 +71,12 @@ public:
 	void push(repo::core::model::RepoNode* node);
 	void push(repo::core::handler::database::query::AddParent*);
 
+	/*
+	* Sets whether identical binaries of the nodes pushed from here on are only
+	* written once.
+	*/
+	void setDeduplicateBinaries(bool deduplicate);
+
 private:
 	/*
 	* The implementation of the consumer uses a visitor that belongs to the worker
@@ -80,11 +95,16 @@ private:
 	struct Notify { // Passing this object instructs the worker to release the semaphore
 	};
 
+	struct DeduplicateBinaries { // Passing this object sets whether the worker deduplicates binaries
+		bool enabled;
+	};
+
 	using Consumables = std::variant<
 		repo::core::model::RepoNode*,
 		repo::core::handler::database::query::AddParent*,
 		Close,
-		Notify
+		Notify,
+		DeduplicateBinaries
 	>;
 
 	struct Consumable {
@@ -105,6 +125,7 @@ private:
 		bool operator() (const repo::core::handler::database::query::AddParent* n) const;
 		bool operator() (const  Close& n) const;
 		bool operator() (const  Notify& n) const;
+		bool operator() (const  DeduplicateBinaries& n) const;
 	};
 
 	/* This will run as a member function */
@@ -136,6 +157,151 @@ private:
 	std::exception_ptr consumerException;
 };
 
+/*
+* Holds staged nodes on disk until the builder is finalised. Each node is
+* written once as its bson document followed by its binaries. Parents added
+* after that are kept in memory, and applied when the node is read back.
+*/
+class RepoSceneBuilder::StagingFile
+{
+public:
+	StagingFile()
+	{
+		path = std::filesystem::temp_directory_path() / ("repo_staging_" + repo::lib::RepoUUID::createUUID().toString());
+		file.open(path, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!file) {
+			throw repo::lib::RepoException("Could not create staging file " + path.string());
+		}
+	}
+
+	~StagingFile()
+	{
+		file.close();
+		std::error_code ec;
+		std::filesystem::remove(path, ec);
+	}
+
+	void write(const RepoNode& node)
+	{
+		RepoBSON bson = node;
+
+		Entry entry;
+		entry.type = node.getTypeAsEnum();
+		entry.offset = end;
+
+		file.seekp(end);
+		writeValue<uint32_t>(bson.objsize());
+		file.write((const char*)bson.view().data(), bson.objsize());
+
+		auto& binaries = bson.getFilesMapping();
+		writeValue<uint32_t>(binaries.size());
+		for (auto& b : binaries) {
+			writeValue<uint32_t>(b.first.size());
+			file.write(b.first.data(), b.first.size());
+			writeValue<uint64_t>(b.second.size());
+			file.write((const char*)b.second.data(), b.second.size());
+		}
+
+		if (!file) {
+			throw repo::lib::RepoException("Failed to write to staging file " + path.string());
+		}
+
+		end = file.tellp();
+		entries[node.getUniqueID()] = entry;
+	}
+
+	/*
+	* Adds the parent to the node if it is in this file, returning false if it
+	* is not.
+	*/
+	bool addParent(const repo::lib::RepoUUID& uniqueId, const repo::lib::RepoUUID& parent)
+	{
+		auto it = entries.find(uniqueId);
+		if (it == entries.end()) {
+			return false;
+		}
+		it->second.parents.insert(parent);
+		return true;
+	}
+
+	/*
+	* Reads back each node, with any parents added since, and passes it to the
+	* callback
+	*/
+	template<typename Callback>
+	void forEach(Callback callback)
+	{
+		std::vector<uint8_t> document;
+		for (auto& e : entries) {
+			file.seekg(e.second.offset);
+
+			document.resize(readValue<uint32_t>());
+			file.read((char*)document.data(), document.size());
+
+			RepoBSON::BinMapping binaries;
+			auto numBinaries = readValue<uint32_t>();
+			for (uint32_t i = 0; i < numBinaries; i++) {
+				std::string name(readValue<uint32_t>(), '\0');
+				file.read(name.data(), name.size());
+				auto& data = binaries[name];
+				data.resize(readValue<uint64_t>());
+				file.read((char*)data.data(), data.size());
+			}
+
+			if (!file) {
+				throw repo::lib::RepoException("Failed to read from staging file " + path.string());
+			}
+
+			RepoBSON bson(bsoncxx::document::view(document.data(), document.size()), binaries);
+
+			std::unique_ptr<RepoNode> node;
+			switch (e.second.type) {
+			case NodeType::MATERIAL:
+				node = std::make_unique<MaterialNode>(bson);
+				break;
+			case NodeType::TEXTURE:
+				node = std::make_unique<TextureNode>(bson);
+				break;
+			default:
+				throw repo::lib::RepoException("Unsupported node type in staging file");
+			}
+
+			for (auto& p : e.second.parents) {
+				node->addParent(p);
+			}
+
+			callback(std::move(node));
+		}
+	}
+
+private:
+	struct Entry
+	{
+		NodeType type;
+		std::streamoff offset;
+		std::set<repo::lib::RepoUUID> parents;
+	};
+
+	std::filesystem::path path;
+	std::fstream file;
+	std::streamoff end = 0;
+	RepoUUIDMap<Entry> entries;
+
+	template<typename T>
+	void writeValue(T v)
+	{
+		file.write((const char*)&v, sizeof(v));
+	}
+
+	template<typename T>
+	T readValue()
+	{
+		T v = 0;
+		file.read((char*)&v, sizeof(v));
+		return v;
+	}
+};
+
 struct RepoSceneBuilder::Deleter
 {
 	RepoSceneBuilder* builder;
@@ -157,7 +323,10 @@ RepoSceneBuilder::RepoSceneBuilder(
 	revisionId(revisionId),
 	referenceCounter(0),
 	nodeCount(0),
+	stagedSize(0),
+	stagingThreshold(DEFAULT_STAGING_THRESHOLD),
 	isMissingTextures(false),
+	deduplicateBinaries(false),
 	offset({}),
 	units(repo::manipulator::modelconvertor::ModelUnits::UNKNOWN),
 	impl(std::make_unique<AsyncImpl>(this))
@@ -172,7 +341,7 @@ RepoSceneBuilder::~RepoSceneBuilder()
 			throw std::runtime_error("RepoSceneBuilder is being destroyed with outstanding RepoNode references. Make sure all RepoNodes have gone out of scope before RepoSceneBuilder.");
 		}
 
-		if (parentUpdates.size())
+		if (parentUpdates.size() || staged.size() || stagingFile || pendingTextures.size())
 		{
 			throw std::runtime_error("RepoSceneBuilder is being destroyed with outstanding updates. Make sure to call finalise before letting RepoSceneBuilder go out of scope.");
 		}
@@ -203,10 +372,23 @@ void RepoSceneBuilder::addNode(std::unique_ptr<repo::core::model::RepoNode> node
 			if(textureToUniqueId.find(material.texturePath) != textureToUniqueId.end())
 				meshNode->setTextureId(textureToUniqueId[material.texturePath]);
 		}
+
+		meshNode->setGeometryCodec(geometryCodec);
+
+		if (pendingTextures.size()) {
+			stageCompletedTextures();
+		}
 	}
 
 	node->setRevision(revisionId);
-	queueNode(node.release());
+
+	auto type = node->getTypeAsEnum();
+	if (type == NodeType::MATERIAL || type == NodeType::TEXTURE) {
+		stageNode(node.release());
+	}
+	else {
+		queueNode(node.release());
+	}
 }
 
 void RepoSceneBuilder::addNodes(std::vector<std::unique_ptr<repo::core::model::RepoNode>> nodes)
@@ -226,6 +408,45 @@ void RepoSceneBuilder::queueNode(RepoNode* node)
 	}
 }
 
+void RepoSceneBuilder::stageNode(RepoNode* node)
+{
+	stagedSize += node->getSize();
+	staged[node->getUniqueID()] = std::unique_ptr<RepoNode>(node);
+
+	// Materials are small, so in practice it is textures that are moved out, and
+	// these are the least likely to gain further parents anyway. Nodes are also
+	// moved out when the process comes within stagedSize of its memory budget,
+	// so the budget is not exceeded by holding them.
+
+	while (staged.size() && (stagedSize > stagingThreshold || !repo::lib::RepoMemoryAccounting::canAllocate(stagedSize))) {
+		auto largest = std::max_element(staged.begin(), staged.end(), [](auto& a, auto& b) {
+			return a.second->getSize() < b.second->getSize();
+		});
+		if (!stagingFile) {
+			stagingFile = std::make_unique<StagingFile>();
+		}
+		stagingFile->write(*largest->second);
+		stagedSize -= largest->second->getSize();
+		staged.erase(largest);
+	}
+}
+
+void RepoSceneBuilder::commitStaged()
+{
+	for (auto& s : staged) {
+		queueNode(s.second.release());
+	}
+	staged.clear();
+	stagedSize = 0;
+
+	if (stagingFile) {
+		stagingFile->forEach([&](std::unique_ptr<RepoNode> node) {
+			queueNode(node.release());
+		});
+		stagingFile.reset();
+	}
+}
+
 std::string RepoSceneBuilder::getSceneCollectionName()
 {
 	return projectName + "." + REPO_COLLECTION_SCENE;
@@ -241,8 +462,21 @@ void RepoSceneBuilder::commit()
 
 void RepoSceneBuilder::finalise()
 {
+	resolveTextures();
+	commitStaged();
 	commit();
 	impl = std::make_unique<AsyncImpl>(this); // Destroying the AsyncImpl will flush everything to the database
+	if (deduplicateBinaries) {
+		impl->setDeduplicateBinaries(true);
+	}
+
+	if (deferredIndexes.size()) {
+		repoInfo << "Creating " << deferredIndexes.size() << " indexes...";
+		for (auto& createIndex : deferredIndexes) {
+			createIndex();
+		}
+		deferredIndexes.clear();
+	}
 }
 
 repo::lib::RepoVector3D64 RepoSceneBuilder::getWorldOffset()
@@ -276,49 +510,167 @@ void RepoSceneBuilder::addMaterialReference(const repo::lib::repo_material_t& m,
 
 void RepoSceneBuilder::addTextureReference(std::string texture, repo::lib::RepoUUID parentId)
 {
-	if (textureToUniqueId.find(texture) == textureToUniqueId.end()) {
+	if (textureToUniqueId.find(texture) != textureToUniqueId.end()) {
+		addParent(textureToUniqueId[texture], parentId);
+		return;
+	}
+
+	if (!textureOptions) {
 		auto node = createTextureNode(texture);
 		if (node) {
 			node->addParent(parentId);
 			textureToUniqueId[texture] = node->getUniqueID();
 			addNode(std::move(node));
 		}
+		return;
 	}
-	else
-	{
-		addParent(textureToUniqueId[texture], parentId);
+
+	// When processing textures, the content is read and hashed here, because
+	// the id must be known immediately to give to the meshes. Everything else
+	// happens in the background, until finalise.
+
+	std::vector<uint8_t> data;
+	uint32_t width, height;
+	if (!readTextureData(texture, data, width, height)) {
+		return;
+	}
+
+	if (!textureProcessor) {
+		textureProcessor = std::make_unique<TextureProcessor>(*textureOptions);
+	}
+	auto hash = textureProcessor->submit(std::move(data));
+
+	auto existing = contentToUniqueId.find(hash);
+	if (existing != contentToUniqueId.end()) {
+		textureToUniqueId[texture] = existing->second;
+		addParent(existing->second, parentId);
+		return;
 	}
+
+	auto node = std::make_unique<repo::core::model::TextureNode>(repo::core::model::RepoBSONFactory::makeTextureNode(
+		texture,
+		nullptr,
+		0,
+		width,
+		height,
+		{ parentId }
+	));
+	node->setRevision(revisionId);
+	textureToUniqueId[texture] = node->getUniqueID();
+	contentToUniqueId[hash] = node->getUniqueID();
+	pendingTextures[node->getUniqueID()] = { hash, std::move(node) };
 }
 
-std::unique_ptr<repo::core::model::TextureNode> RepoSceneBuilder::createTextureNode(const std::string& texturePath)
+void RepoSceneBuilder::setTextureProcessing(const TextureProcessorOptions& options)
+{
+	textureOptions = std::make_unique<TextureProcessorOptions>(options);
+}
+
+void RepoSceneBuilder::completeTexture(PendingTexture& pending, const ProcessedTexture& texture)
+{
+	auto node = dynamic_cast<repo::core::model::TextureNode*>(pending.node.get());
+	node->setData(
+		texture.data,
+		texture.width ? texture.width : node->getWidth(),
+		texture.height ? texture.height : node->getHeight(),
+		texture.extension.size() ? texture.extension : node->getFileExtension()
+	);
+	node->setMipLevels(texture.mipLevels);
+	stageNode(pending.node.release());
+}
+
+void RepoSceneBuilder::stageCompletedTextures()
+{
+	if (!textureProcessor) {
+		return;
+	}
+
+	// Each result is taken from the processor, so once its node is staged (and
+	// perhaps moved out to the staging file) the memory is released
+
+	for (auto& hash : textureProcessor->takeCompleted()) {
+		auto id = contentToUniqueId.find(hash);
+		if (id == contentToUniqueId.end()) {
+			continue;
+		}
+		auto pending = pendingTextures.find(id->second);
+		if (pending == pendingTextures.end()) {
+			continue;
+		}
+		completeTexture(pending->second, *textureProcessor->take(hash));
+		pendingTextures.erase(pending);
+	}
+}
+
+void RepoSceneBuilder::resolveTextures()
+{
+	stageCompletedTextures();
+
+	if (pendingTextures.size()) {
+		repoInfo << "Waiting for " << pendingTextures.size() << " textures to be processed...";
+	}
+
+	for (auto& p : pendingTextures) {
+		completeTexture(p.second, *textureProcessor->take(p.second.hash));
+	}
+	pendingTextures.clear();
+
+	// Textures added after this will start a new processor
+
+	textureProcessor.reset();
+	contentToUniqueId.clear();
+}
+
+void RepoSceneBuilder::addTextureData(const std::string& texturePath, std::vector<char> data, uint32_t width, uint32_t height)
+{
+	textureData[texturePath] = { std::move(data), width, height };
+}
+
+bool RepoSceneBuilder::readTextureData(const std::string& texturePath, std::vector<uint8_t>& data, uint32_t& width, uint32_t& height)
 {
-	std::unique_ptr<repo::core::model::TextureNode> node;
-	std::ifstream::pos_type size;
+	auto embedded = textureData.find(texturePath);
+	if (embedded != textureData.end())
+	{
+		data.assign(embedded->second.data.begin(), embedded->second.data.end());
+		width = embedded->second.width;
+		height = embedded->second.height;
+		textureData.erase(embedded);
+		return true;
+	}
+
 	std::ifstream file(texturePath, std::ios::in | std::ios::binary | std::ios::ate);
-	char* memblock = nullptr;
 	if (!file.is_open())
 	{
 		setMissingTextures();
-		return node;
+		return false;
 	}
 
-	size = file.tellg();
-	memblock = new char[size];
+	data.resize(file.tellg());
 	file.seekg(0, std::ios::beg);
-	file.read(memblock, size);
+	file.read((char*)data.data(), data.size());
 	file.close();
 
-	node = std::make_unique<repo::core::model::TextureNode>(repo::core::model::RepoBSONFactory::makeTextureNode(
-		texturePath,
-		(const char*)memblock,
-		size,
-		1,
-		0
-	));
+	width = 1;
+	height = 0;
+	return true;
+}
 
-	delete[] memblock;
+std::unique_ptr<repo::core::model::TextureNode> RepoSceneBuilder::createTextureNode(const std::string& texturePath)
+{
+	std::vector<uint8_t> data;
+	uint32_t width, height;
+	if (!readTextureData(texturePath, data, width, height))
+	{
+		return {};
+	}
 
-	return node;
+	return std::make_unique<repo::core::model::TextureNode>(repo::core::model::RepoBSONFactory::makeTextureNode(
+		texturePath,
+		(const char*)data.data(),
+		data.size(),
+		width,
+		height
+	));
 }
 
 void RepoSceneBuilder::addParent(repo::lib::RepoUUID nodeUniqueId, repo::lib::RepoUUID parentSharedId)
@@ -330,6 +682,27 @@ void RepoSceneBuilder::addParent(repo::lib::RepoUUID nodeUniqueId, repo::lib::Re
 
 	using namespace repo::core::handler::database;
 
+	// Staged nodes have not been written yet, so can be changed directly
+
+	auto s = staged.find(nodeUniqueId);
+	if (s != staged.end())
+	{
+		s->second->addParent(parentSharedId);
+		return;
+	}
+
+	auto pending = pendingTextures.find(nodeUniqueId);
+	if (pending != pendingTextures.end())
+	{
+		pending->second.node->addParent(parentSharedId);
+		return;
+	}
+
+	if (stagingFile && stagingFile->addParent(nodeUniqueId, parentSharedId))
+	{
+		return;
+	}
+
 	if (parentUpdates.find(nodeUniqueId) != parentUpdates.end())
 	{
 		parentUpdates[nodeUniqueId]->parentIds.insert(parentSharedId);
@@ -350,6 +723,12 @@ void RepoSceneBuilder::setMissingTextures()
 	this->isMissingTextures = true;
 }
 
+void RepoSceneBuilder::setDeduplicateBinaries(bool deduplicate)
+{
+	deduplicateBinaries = deduplicate;
+	impl->setDeduplicateBinaries(deduplicate);
+}
+
 bool RepoSceneBuilder::hasMissingTextures()
 {
 	return isMissingTextures;
@@ -365,17 +744,34 @@ repo::manipulator::modelconvertor::ModelUnits RepoSceneBuilder::getUnits()
 	return this->units;
 }
 
-void RepoSceneBuilder::createIndexes()
+void RepoSceneBuilder::createIndexes(bool deferred)
 {
 	using namespace repo::core::handler::database::index;
 	auto historyCollection = projectName + "." + REPO_COLLECTION_HISTORY;
 	auto sceneCollection = projectName + "." + REPO_COLLECTION_SCENE;
 
+	// The history collection is not written by the builder, so there is no
+	// reason to wait
+
 	handler->createIndex(databaseName, historyCollection, Descending({ REPO_NODE_REVISION_LABEL_TIMESTAMP }));
-	handler->createIndex(databaseName, sceneCollection, Ascending({ REPO_NODE_REVISION_ID, "metadata.key", "metadata.value" }));
-	handler->createIndex(databaseName, sceneCollection, Ascending({ "metadata.key", "metadata.value" }));
-	handler->createIndex(databaseName, sceneCollection, Ascending({ REPO_NODE_REVISION_ID, REPO_NODE_LABEL_SHARED_ID, REPO_LABEL_TYPE }));
-	handler->createIndex(databaseName, sceneCollection, Ascending({ REPO_NODE_LABEL_SHARED_ID }));	
+
+	std::vector<Ascending> sceneIndexes = {
+		Ascending({ REPO_NODE_REVISION_ID, "metadata.key", "metadata.value" }),
+		Ascending({ "metadata.key", "metadata.value" }),
+		Ascending({ REPO_NODE_REVISION_ID, REPO_NODE_LABEL_SHARED_ID, REPO_LABEL_TYPE }),
+		Ascending({ REPO_NODE_LABEL_SHARED_ID }),
+	};
+
+	for (auto& index : sceneIndexes) {
+		if (deferred) {
+			deferredIndexes.push_back([this, sceneCollection, index]() {
+				handler->createIndex(databaseName, sceneCollection, index);
+			});
+		}
+		else {
+			handler->createIndex(databaseName, sceneCollection, index);
+		}
+	}
 }
 
 RepoSceneBuilder::AsyncImpl::AsyncImpl(RepoSceneBuilder* builder):
@@ -395,6 +791,11 @@ RepoSceneBuilder::AsyncImpl::~AsyncImpl()
 	}
 }
 
+void RepoSceneBuilder::AsyncImpl::setDeduplicateBinaries(bool deduplicate)
+{
+	push({ Consumables(DeduplicateBinaries{ deduplicate }), 0 });
+}
+
 void RepoSceneBuilder::AsyncImpl::push(repo::core::handler::database::query::AddParent* u)
 {
 	push({ Consumables(u), 100 }); // Update operations have a fixed approximate cost
@@ -477,6 +878,12 @@ bool RepoSceneBuilder::AsyncImpl::Consumer::operator() (const Notify& n) const
 	return true;
 }
 
+bool RepoSceneBuilder::AsyncImpl::Consumer::operator() (const DeduplicateBinaries& n) const
+{
+	collection->setDeduplicateBinaries(n.enabled);
+	return true;
+}
+
 void RepoSceneBuilder::AsyncImpl::consumerFunction()
 {
 	try {
@@ -24,9 +24,12 @@
 #include "repo/core/handler/fileservice/repo_file_handler_abstract.h"
 #include "repo/lib/datastructure/repo_structs.h"
 #include "repo/lib/datastructure/repo_variant.h"
+#include "repo/lib/repo_mesh_codec.h"
 #include "repo/manipulator/modelconvertor/import/repo_model_units.h"
 
+#include <functional>
 #include <memory>
+#include <optional>
 #include <vector>
 #include <type_traits>
 
@@ -40,6 +43,13 @@ namespace repo {
 			class TextureNode;
 		}
 	}
+	namespace manipulator {
+		namespace modelutility {
+			class TextureProcessor;
+			struct TextureProcessorOptions;
+			struct ProcessedTexture;
+		}
+	}
 }
 
 namespace repo {
@@ -89,6 +99,8 @@ namespace repo {
 				/**
 				* Adds the provided sharedId as a parent to the node with the given uniqueId.
 				* Nodes must already have been added with addNode.
+				* If the node is still staged (see setStagingThreshold) the parent is added
+				* to it directly, otherwise an update is sent to the database.
 				*/
 				void addParent(repo::lib::RepoUUID nodeUniqueId, repo::lib::RepoUUID parentSharedId);
 
@@ -107,15 +119,85 @@ namespace repo {
 				void setMissingTextures();
 				bool hasMissingTextures();
 
+				/*
+				* Provides the contents of a texture that cannot be read from the
+				* filesystem, such as one embedded in the model file. Materials with this
+				* texturePath will use this data instead. As with other textures, the node
+				* is only created once a material refers to it.
+				*/
+				void addTextureData(const std::string& texturePath, std::vector<char> data, uint32_t width, uint32_t height);
+
+				/*
+				* If set, the geometry of all mesh nodes added from here on is written
+				* with RepoMeshCodec, using these options.
+				*/
+				void setGeometryCodec(const std::optional<repo::lib::RepoMeshCodec::Options>& options)
+				{
+					geometryCodec = options;
+					if (geometryCodec && !geometryCodec->grid) {
+						geometryCodec->grid = geometryGrid;
+					}
+				}
+
+				/*
+				* Sets the bounds of the scene, in the same coordinates as the vertices
+				* of the meshes that will be added (i.e. less the world offset). If the
+				* geometry codec quantises positions, it does so to a grid over these
+				* bounds, so all the meshes of the revision share the same grid. This
+				* should be called before the first mesh is added.
+				*/
+				void setGeometryGrid(const repo::lib::RepoBounds& bounds)
+				{
+					geometryGrid = bounds;
+					if (geometryCodec) {
+						geometryCodec->grid = bounds;
+					}
+				}
+
+				/*
+				* If set, nodes added from here on whose binaries (e.g. geometry) are
+				* identical to those of an earlier node refer to the same stored data,
+				* instead of writing it again. This is for importers that keep instanced
+				* geometry in local space.
+				*/
+				void setDeduplicateBinaries(bool deduplicate);
+
+				/*
+				* Material and texture nodes are shared between many other nodes, and gain
+				* a parent each time they are reused. Rather than writing them immediately
+				* and updating them for each new parent, they are staged and written once,
+				* with all their parents, when the builder is finalised. When the staged
+				* nodes exceed this many bytes, the largest are moved to a temporary file
+				* until then.
+				*/
+				void setStagingThreshold(size_t bytes)
+				{
+					stagingThreshold = bytes;
+				}
+
+				/*
+				* If set, textures added from here on are processed in the background by a
+				* TextureProcessor with these options (scaled down, re-encoded and given
+				* mip levels), and textures with identical content share one node. Each
+				* node is staged as soon as its texture has been processed; finalise
+				* waits for the rest.
+				*/
+				void setTextureProcessing(const TextureProcessorOptions& options);
+
 				void setUnits(repo::manipulator::modelconvertor::ModelUnits units);
 				repo::manipulator::modelconvertor::ModelUnits getUnits();
 
 				/*
-				* Creates a common set of indices prior to import, to avoid Mongo having to build
-				* an index on a large number of nodes at the end.
+				* Creates the common set of indices on the history and scene collections.
 				* Some of the indexes this creats could be moved to .io in the future.
+				*
+				* The builder only ever looks up nodes by _id, so by default the scene
+				* indexes are not created until finalise, once all the nodes have been
+				* written. This means the inserts don't pay to maintain them, and each
+				* index is built in one pass. If deferred is false, they are created
+				* immediately (e.g. if something will query the collection during import).
 				*/
-				void createIndexes();
+				void createIndexes(bool deferred = true);
 
 			private:
 
@@ -124,6 +206,7 @@ namespace repo {
 
 				void addTextureReference(std::string texture, repo::lib::RepoUUID parentId);
 				std::unique_ptr<repo::core::model::TextureNode> createTextureNode(const std::string& texturePath);
+				bool readTextureData(const std::string& texturePath, std::vector<uint8_t>& data, uint32_t& width, uint32_t& height);
 
 				// All nodes will be committed with this as the revision id
 				repo::lib::RepoUUID revisionId;
@@ -149,6 +232,11 @@ namespace repo {
 				// to pass onto Scene - this flag doesn't do anything to RepoSceneBuilder.
 				bool isMissingTextures;
 
+				bool deduplicateBinaries;
+
+				std::optional<repo::lib::RepoMeshCodec::Options> geometryCodec;
+				std::optional<repo::lib::RepoBounds> geometryGrid;
+
 				std::shared_ptr<repo::core::handler::AbstractDatabaseHandler> handler;
 
 				// These lookups are for use by the addMaterialReference method, which will
@@ -157,15 +245,67 @@ namespace repo {
 				std::unordered_map<size_t, repo::lib::RepoUUID> materialToUniqueId;
 				std::unordered_map<std::string, repo::lib::RepoUUID> textureToUniqueId;
 
+				struct TextureData
+				{
+					std::vector<char> data;
+					uint32_t width;
+					uint32_t height;
+				};
+
+				std::unordered_map<std::string, TextureData> textureData;
+
+				// The options given to setTextureProcessing. The processor is created
+				// when the first texture is added, and released by finalise.
+				std::unique_ptr<TextureProcessorOptions> textureOptions;
+				std::unique_ptr<TextureProcessor> textureProcessor;
+
+				// Texture nodes waiting for their data from the textureProcessor, along
+				// with the hash of their content
+				struct PendingTexture
+				{
+					std::string hash;
+					std::unique_ptr<repo::core::model::RepoNode> node;
+				};
+
+				RepoUUIDMap<PendingTexture> pendingTextures;
+				std::unordered_map<std::string, repo::lib::RepoUUID> contentToUniqueId;
+
+				// Completes the pending textures and stages them
+				void resolveTextures();
+
+				// Completes and stages the pending textures that have finished
+				// processing, without waiting for the others
+				void stageCompletedTextures();
+
+				// Gives the node the processed texture, and stages it
+				void completeTexture(PendingTexture& pending, const ProcessedTexture& texture);
+
 				// We have to use raw pointers here because the std containers' interaction
 				// with smart pointers requires the classes must be fully defined.
 
 				RepoUUIDMap<repo::core::handler::database::query::AddParent*> parentUpdates;
 
+				// Nodes held back until finalise, because they may still gain parents
+				RepoUUIDMap<std::unique_ptr<repo::core::model::RepoNode>> staged;
+				size_t stagedSize;
+				size_t stagingThreshold;
+
+				// Staged nodes that have been moved out of memory
+				class StagingFile;
+				std::unique_ptr<StagingFile> stagingFile;
+
+				void stageNode(repo::core::model::RepoNode* node);
+
+				// Queues all staged nodes (including those in the staging file) for commit
+				void commitStaged();
+
 				// Commits everything that might be outstanding, such as remaining updates,
 				// to the async writer object.
 				void commit();
 
+				// Indexes to create once all nodes have been written
+				std::vector<std::function<void()>> deferredIndexes;
+
 				// Schedule a node to be comitted to the database. Once queued, the node
 				// becomes immutable and must no longer be accessible outside the builder.
 				void queueNode(repo::core::model::RepoNode* node);
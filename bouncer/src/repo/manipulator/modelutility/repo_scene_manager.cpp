@@ -19,6 +19,7 @@
 #include "repo/core/model/bson/repo_bson_ref.h"
 #include "repo/core/model/bson/repo_bson_teamspace.h"
 #include "../../error_codes.h"
+#include "../../lib/repo_memory_accounting.h"
 #include "../modeloptimizer/repo_optimizer_multipart.h"
 #include "../modelutility/repo_maker_selection_tree.h"
 
@@ -37,13 +38,17 @@ uint8_t SceneManager::commitScene(
 	const std::string												&desc,
 	const repo::lib::RepoUUID										&revId,
 	repo::core::handler::AbstractDatabaseHandler					*handler,
-	repo::core::handler::fileservice::FileManager					*fileManager
+	repo::core::handler::fileservice::FileManager					*fileManager,
+	const int														numThreads
 ) {
 	uint8_t errCode = REPOERR_UPLOAD_FAILED;
 	std::string msg;
 	if (handler && scene)
 	{
-		errCode = scene->commit(handler, fileManager, msg, owner, desc, tag, revId);
+		{
+			repo::lib::RepoMemoryAccounting::Stage stage("commit");
+			errCode = scene->commit(handler, fileManager, msg, owner, desc, tag, revId);
+		}
 		if (errCode == REPOERR_OK) {
 			repoInfo << "Scene successfully committed to the database";
 			bool success = true;
@@ -51,6 +56,7 @@ uint8_t SceneManager::commitScene(
 
 			if (success)
 			{
+				repo::lib::RepoMemoryAccounting::Stage stage("selection tree");
 				repoInfo << "Generating Selection Tree JSON...";
 				scene->updateRevisionStatus(handler, repo::core::model::ModelRevisionNode::UploadStatus::GEN_SEL_TREE);
 				if (generateAndCommitSelectionTree(scene, handler))
@@ -61,9 +67,10 @@ uint8_t SceneManager::commitScene(
 
 			if (success && !isFederation)
 			{
+				repo::lib::RepoMemoryAccounting::Stage stage("stash");
 				repoInfo << "Generating Repo Bundles...";
 				scene->updateRevisionStatus(handler, repo::core::model::ModelRevisionNode::UploadStatus::GEN_WEB_STASH);
-				if (success = generateWebViewBuffers(scene, repo::manipulator::modelconvertor::ExportType::REPO, handler))
+				if (success = generateWebViewBuffers(scene, repo::manipulator::modelconvertor::ExportType::REPO, handler, numThreads))
 					repoInfo << "Repo Bundles for Stash stored into the database";
 				else
 					repoError << "failed to commit Repo Bundles";
@@ -104,7 +111,8 @@ repo::core::model::RepoScene* SceneManager::fetchScene(
 	const bool                                    &headRevision,
 	const bool                                    &ignoreRefScenes,
 	const bool                                    &skeletonFetch,
-	const std::vector<repo::core::model::ModelRevisionNode::UploadStatus> &includeStatus)
+	const std::vector<repo::core::model::ModelRevisionNode::UploadStatus> &includeStatus,
+	const bool                                    &referencesOnly)
 {
 	repo::core::model::RepoScene* scene = nullptr;
 	if (handler)
@@ -118,6 +126,8 @@ repo::core::model::RepoScene* SceneManager::fetchScene(
 				scene->skipLoadingExtFiles();
 			if (ignoreRefScenes)
 				scene->ignoreReferenceScene();
+			if (referencesOnly)
+				scene->loadReferencesOnly();
 			if (headRevision)
 				scene->setBranch(uuid);
 			else
@@ -203,7 +213,8 @@ void SceneManager::fetchScene(
 bool SceneManager::generateWebViewBuffers(
 	repo::core::model::RepoScene									*scene,
 	const repo::manipulator::modelconvertor::ExportType				&exType,
-	repo::core::handler::AbstractDatabaseHandler					*handler)
+	repo::core::handler::AbstractDatabaseHandler					*handler,
+	const int														numThreads)
 {
 	bool validScene =
 		scene
@@ -251,7 +262,14 @@ bool SceneManager::generateWebViewBuffers(
 			return false;
 		}
 
-		repo::manipulator::modeloptimizer::MultipartOptimizer mpOpt;
+		repo::manipulator::modeloptimizer::MultipartOptimizer mpOpt(numThreads);
+
+		// Three levels, each with a quarter of the faces of the one before. These
+		// are only built if the exporter supports them (see supportsLods()).
+		repo::manipulator::modeloptimizer::MultipartOptimizer::LodOptions lodOptions;
+		lodOptions.numLevels = 3;
+		mpOpt.setLodOptions(lodOptions);
+
 		return mpOpt.processScene(
 			scene->getDatabaseName(),
 			scene->getProjectName(),
@@ -36,7 +36,8 @@ namespace repo {
 					const std::string												&desc,
 					const repo::lib::RepoUUID										&revId,
 					repo::core::handler::AbstractDatabaseHandler					*handler,
-					repo::core::handler::fileservice::FileManager					*fileManager
+					repo::core::handler::fileservice::FileManager					*fileManager,
+					const int														numThreads = 0
 				);
 
 				/**
@@ -47,6 +48,8 @@ namespace repo {
 				* @param uuid if headRevision, uuid represents the branch id,
 				*              otherwise the unique id of the revision branch
 				* @param headRevision true if retrieving head revision
+				* @param referencesOnly only load the root, and the references with the
+				*              nodes above them, into the default graph
 				* @return returns a pointer to a repoScene.
 				*/
 				repo::core::model::RepoScene* fetchScene(
@@ -57,7 +60,8 @@ namespace repo {
 					const bool                                    &headRevision = true,
 					const bool                                    &ignoreRefScenes = false,
 					const bool                                    &skeletonFetch = false,
-					const std::vector<repo::core::model::ModelRevisionNode::UploadStatus> &includeStatus = {});
+					const std::vector<repo::core::model::ModelRevisionNode::UploadStatus> &includeStatus = {},
+					const bool                                    &referencesOnly = false);
 
 				repo::core::model::RepoScene* fetchScene(
 					repo::core::handler::AbstractDatabaseHandler  *handler,
@@ -111,12 +115,14 @@ namespace repo {
 				* This requires the repo stash to have been generated already
 				* @param scene the scene to generate the src encoding from
 				* @param exType the type of export it is
+				* @param numThreads threads to build the stash with (0 for the number of cores)
 				* @return returns repo_web_buffers upon success
 				*/
 				bool generateWebViewBuffers(
 					repo::core::model::RepoScene									*scene,
 					const repo::manipulator::modelconvertor::ExportType				&exType,
-					repo::core::handler::AbstractDatabaseHandler					*handler = nullptr);
+					repo::core::handler::AbstractDatabaseHandler					*handler = nullptr,
+					const int														numThreads = 0);
 
 				/**
 				* Remove stash graph entry for the given scene
@@ -0,0 +1,467 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "repo_selection_tree_binary.h"
+
+#define RAPIDJSON_HAS_STDSTRING 1
+
+#include "repo/manipulator/modelutility/rapidjson/rapidjson.h"
+#include "repo/manipulator/modelutility/rapidjson/writer.h"
+#include "repo/manipulator/modelutility/rapidjson/stringbuffer.h"
+#include "repo/lib/repo_exception.h"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+using namespace repo::manipulator::modelutility;
+
+/*
+* Layout (all values little endian):
+*	magic (u32), version (u32)
+*	account and project, each as a length (u32) and the characters
+*	number of ids (u32), then each id (16 bytes)
+*	number of nodes (u32), then the node table in depth-first order, as the
+*	columns: type (u8), toggle state (u8), id index (u32), shared id index
+*	(u32), parent node index (u32), name offset (u32, one extra for the end)
+*	and meta offset (u32, one extra for the end)
+*	the names, as a length (u32) and the characters
+*	number of meta entries (u32), then the id index of each (u32)
+*/
+
+static const uint32_t SELECTION_TREE_MAGIC = 0x42545352; // RSTB
+static const uint32_t SELECTION_TREE_VERSION = 1;
+
+template<typename T>
+static void writeValue(std::vector<uint8_t>& buffer, const T& value)
+{
+	auto p = (const uint8_t*)&value;
+	buffer.insert(buffer.end(), p, p + sizeof(T));
+}
+
+template<typename T>
+static void writeColumn(std::vector<uint8_t>& buffer, const std::vector<T>& column)
+{
+	auto p = (const uint8_t*)column.data();
+	buffer.insert(buffer.end(), p, p + column.size() * sizeof(T));
+}
+
+static void writeString(std::vector<uint8_t>& buffer, const std::string& s)
+{
+	writeValue(buffer, (uint32_t)s.size());
+	buffer.insert(buffer.end(), s.begin(), s.end());
+}
+
+namespace {
+	class BufferReader
+	{
+	public:
+		BufferReader(const uint8_t* data, size_t size) :
+			data(data),
+			size(size),
+			position(0)
+		{
+		}
+
+		template<typename T>
+		T read()
+		{
+			T value;
+			memcpy(&value, advance(sizeof(T)), sizeof(T));
+			return value;
+		}
+
+		template<typename T>
+		void readColumn(std::vector<T>& column, size_t count)
+		{
+			if (count > size / sizeof(T)) {
+				throw repo::lib::RepoException("Unexpected end of selection tree data");
+			}
+			column.resize(count);
+			memcpy(column.data(), advance(count * sizeof(T)), count * sizeof(T));
+		}
+
+		std::string readString()
+		{
+			auto length = read<uint32_t>();
+			auto p = advance(length);
+			return std::string((const char*)p, length);
+		}
+
+	private:
+		const uint8_t* data;
+		size_t size;
+		size_t position;
+
+		const uint8_t* advance(size_t n)
+		{
+			if (n > size - position) {
+				throw repo::lib::RepoException("Unexpected end of selection tree data");
+			}
+			auto p = data + position;
+			position += n;
+			return p;
+		}
+	};
+
+	class UUIDTable
+	{
+	public:
+		uint32_t intern(const repo::lib::RepoUUID& id)
+		{
+			auto it = indices.find(id);
+			if (it != indices.end()) {
+				return it->second;
+			}
+			uint32_t index = (uint32_t)ids.size();
+			indices[id] = index;
+			ids.push_back(id);
+			return index;
+		}
+
+		std::vector<repo::lib::RepoUUID> ids;
+
+	private:
+		std::unordered_map<repo::lib::RepoUUID, uint32_t, repo::lib::RepoUUIDHasher> indices;
+	};
+}
+
+std::vector<uint8_t> repo::manipulator::modelutility::serialiseSelectionTreesToBinary(const SelectionTreesSet& trees)
+{
+	UUIDTable uuids;
+	std::vector<uint8_t> types;
+	std::vector<uint8_t> toggleStates;
+	std::vector<uint32_t> ids;
+	std::vector<uint32_t> sharedIds;
+	std::vector<uint32_t> parents;
+	std::vector<uint32_t> nameOffsets;
+	std::vector<uint32_t> metaOffsets;
+	std::string names;
+	std::vector<uint32_t> meta;
+
+	// Depth first, with the children in the order of the tree, so the reader
+	// can rebuild the children in the same order from the parents alone
+
+	std::vector<std::pair<const SelectionTree::Node*, uint32_t>> stack;
+	if (trees.fullTree.root) {
+		stack.push_back({ trees.fullTree.root, SelectionTreeBinaryReader::NO_PARENT });
+	}
+	while (stack.size()) {
+		auto [node, parent] = stack.back();
+		stack.pop_back();
+
+		uint32_t index = (uint32_t)types.size();
+		types.push_back((uint8_t)node->type);
+		toggleStates.push_back((uint8_t)node->toggleState);
+		ids.push_back(uuids.intern(node->_id));
+		sharedIds.push_back(uuids.intern(node->shared_id));
+		parents.push_back(parent);
+		nameOffsets.push_back((uint32_t)names.size());
+		names += node->name;
+		metaOffsets.push_back((uint32_t)meta.size());
+		for (const auto& m : node->meta) {
+			meta.push_back(uuids.intern(m));
+		}
+
+		for (auto it = node->children.rbegin(); it != node->children.rend(); it++) {
+			stack.push_back({ *it, index });
+		}
+	}
+	nameOffsets.push_back((uint32_t)names.size());
+	metaOffsets.push_back((uint32_t)meta.size());
+
+	std::vector<uint8_t> buffer;
+	writeValue(buffer, SELECTION_TREE_MAGIC);
+	writeValue(buffer, SELECTION_TREE_VERSION);
+	writeString(buffer, trees.fullTree.container.account);
+	writeString(buffer, trees.fullTree.container.project);
+
+	writeValue(buffer, (uint32_t)uuids.ids.size());
+	for (const auto& id : uuids.ids) {
+		auto& data = id.getInternalID();
+		buffer.insert(buffer.end(), data.begin(), data.end());
+	}
+
+	writeValue(buffer, (uint32_t)types.size());
+	writeColumn(buffer, types);
+	writeColumn(buffer, toggleStates);
+	writeColumn(buffer, ids);
+	writeColumn(buffer, sharedIds);
+	writeColumn(buffer, parents);
+	writeColumn(buffer, nameOffsets);
+	writeColumn(buffer, metaOffsets);
+	writeString(buffer, names);
+	writeValue(buffer, (uint32_t)meta.size());
+	writeColumn(buffer, meta);
+
+	return buffer;
+}
+
+SelectionTreeBinaryReader::SelectionTreeBinaryReader(const std::vector<uint8_t>& buffer)
+{
+	BufferReader reader(buffer.data(), buffer.size());
+	if (reader.read<uint32_t>() != SELECTION_TREE_MAGIC) {
+		throw repo::lib::RepoException("Buffer is not a selection tree");
+	}
+	auto version = reader.read<uint32_t>();
+	if (version > SELECTION_TREE_VERSION) {
+		throw repo::lib::RepoException("Unsupported selection tree version " + std::to_string(version));
+	}
+
+	account = reader.readString();
+	project = reader.readString();
+
+	std::vector<boost::uuids::uuid> rawIds;
+	reader.readColumn(rawIds, reader.read<uint32_t>());
+	uuids.reserve(rawIds.size());
+	for (const auto& id : rawIds) {
+		uuids.push_back(repo::lib::RepoUUID(id));
+	}
+
+	auto numNodes = reader.read<uint32_t>();
+	reader.readColumn(types, numNodes);
+	reader.readColumn(toggleStates, numNodes);
+	reader.readColumn(ids, numNodes);
+	reader.readColumn(sharedIds, numNodes);
+	reader.readColumn(parents, numNodes);
+	reader.readColumn(nameOffsets, numNodes + 1);
+	reader.readColumn(metaOffsets, numNodes + 1);
+	names = reader.readString();
+	reader.readColumn(meta, reader.read<uint32_t>());
+
+	// Validate everything that is used as an index, so the accessors don't need
+	// to check
+
+	children.resize(numNodes);
+	for (uint32_t i = 0; i < numNodes; i++) {
+		if (ids[i] >= uuids.size() || sharedIds[i] >= uuids.size() ||
+			nameOffsets[i] > nameOffsets[i + 1] || metaOffsets[i] > metaOffsets[i + 1] ||
+			toggleStates[i] > SelectionTree::Node::ToggleState::HALF_HIDDEN ||
+			types[i] > (uint8_t)repo::core::model::NodeType::UNKNOWN) {
+			throw repo::lib::RepoException("Selection tree node " + std::to_string(i) + " is malformed");
+		}
+		if (parents[i] == NO_PARENT) {
+			if (i != 0) {
+				throw repo::lib::RepoException("Selection tree has more than one root");
+			}
+		}
+		else if (parents[i] >= i) {
+			throw repo::lib::RepoException("Selection tree node " + std::to_string(i) + " does not follow its parent");
+		}
+		else {
+			children[parents[i]].push_back(i);
+		}
+	}
+	if (numNodes && (nameOffsets[numNodes] > names.size() || metaOffsets[numNodes] > meta.size())) {
+		throw repo::lib::RepoException("Selection tree node table is malformed");
+	}
+	for (auto m : meta) {
+		if (m >= uuids.size()) {
+			throw repo::lib::RepoException("Selection tree metadata is malformed");
+		}
+	}
+}
+
+SelectionTree::ChildPath SelectionTreeBinaryReader::getPath(uint32_t node) const
+{
+	SelectionTree::ChildPath path;
+	for (auto n = node; n != NO_PARENT; n = parents[n]) {
+		path.push_back(getUniqueId(n));
+	}
+	std::reverse(path.begin(), path.end());
+	return path;
+}
+
+void SelectionTreeBinaryReader::getMeshes(uint32_t node, std::vector<repo::lib::RepoUUID>& meshes) const
+{
+	for (auto child : children[node]) {
+		getMeshes(child, meshes);
+	}
+	if (getType(node) == repo::core::model::NodeType::MESH) {
+		meshes.push_back(getUniqueId(node));
+	}
+}
+
+std::vector<repo::lib::RepoUUID> SelectionTreeBinaryReader::getMeshes(uint32_t node) const
+{
+	std::vector<repo::lib::RepoUUID> meshes;
+	getMeshes(node, meshes);
+	return meshes;
+}
+
+std::vector<uint32_t> SelectionTreeBinaryReader::getPostOrder() const
+{
+	std::vector<uint32_t> order;
+	order.reserve(getNumNodes());
+	std::vector<std::pair<uint32_t, size_t>> stack;
+	if (getNumNodes()) {
+		stack.push_back({ 0, 0 });
+	}
+	while (stack.size()) {
+		auto& [node, next] = stack.back();
+		if (next < children[node].size()) {
+			stack.push_back({ children[node][next++], 0 });
+		}
+		else {
+			order.push_back(node);
+			stack.pop_back();
+		}
+	}
+	return order;
+}
+
+std::vector<std::string> SelectionTreeBinaryReader::getJsonNames() const
+{
+	std::vector<std::string> jsonNames = { "fulltree.json", "tree_path.json", "idMap.json", "idToMeshes.json" };
+	for (auto state : toggleStates) {
+		if (state == SelectionTree::Node::ToggleState::HIDDEN) {
+			jsonNames.push_back("modelProperties.json");
+			break;
+		}
+	}
+	return jsonNames;
+}
+
+std::string SelectionTreeBinaryReader::renderJson(const std::string& name) const
+{
+	rapidjson::StringBuffer buffer;
+	rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+
+	// The objects keyed by id are written in depth-first order. The maker writes
+	// them in the order of its hash maps, so the order is not meaningful.
+
+	if (name == "fulltree.json") {
+		std::vector<std::string> paths(getNumNodes());
+
+		// The children are written inside their parent's object, so it is only
+		// closed (with the fields that follow the children) once the next node
+		// is not one of its descendants
+
+		auto close = [&](uint32_t n) {
+			if (children[n].size()) {
+				writer.EndArray();
+			}
+			if (metaOffsets[n + 1] > metaOffsets[n]) {
+				writer.Key("meta");
+				writer.StartArray();
+				for (auto m = metaOffsets[n]; m < metaOffsets[n + 1]; m++) {
+					writer.String(uuids[meta[m]].toString());
+				}
+				writer.EndArray();
+			}
+			writer.Key("toggleState"); writer.String(SelectionTree::toggleStateToString(getToggleState(n)));
+			writer.EndObject();
+		};
+
+		writer.StartObject();
+		writer.Key("nodes");
+		if (!getNumNodes()) {
+			writer.Null();
+		}
+		std::vector<uint32_t> open;
+		for (uint32_t i = 0; i < getNumNodes(); i++) {
+			while (open.size() && open.back() != parents[i]) {
+				close(open.back());
+				open.pop_back();
+			}
+
+			paths[i] = (parents[i] == NO_PARENT ? "" : paths[parents[i]] + "__") + getUniqueId(i).toString();
+
+			writer.StartObject();
+			writer.Key("account"); writer.String(account);
+			writer.Key("project"); writer.String(project);
+			writer.Key("type"); writer.String(SelectionTree::typeToString(getType(i)));
+			if (nameOffsets[i + 1] > nameOffsets[i]) {
+				writer.Key("name"); writer.String(names.data() + nameOffsets[i], nameOffsets[i + 1] - nameOffsets[i]);
+			}
+			writer.Key("path"); writer.String(paths[i]);
+			writer.Key("_id"); writer.String(getUniqueId(i).toString());
+			writer.Key("shared_id"); writer.String(getSharedId(i).toString());
+			if (children[i].size()) {
+				writer.Key("children");
+				writer.StartArray();
+			}
+			open.push_back(i);
+		}
+		while (open.size()) {
+			close(open.back());
+			open.pop_back();
+		}
+
+		writer.Key("idToName");
+		writer.StartObject();
+		for (uint32_t i = 0; i < getNumNodes(); i++) {
+			writer.Key(getUniqueId(i).toString());
+			writer.String(names.data() + nameOffsets[i], nameOffsets[i + 1] - nameOffsets[i]);
+		}
+		writer.EndObject();
+		writer.EndObject();
+	}
+	else if (name == "tree_path.json") {
+		writer.StartObject();
+		writer.Key("idToPath");
+		writer.StartObject();
+		std::vector<std::string> paths(getNumNodes());
+		for (uint32_t i = 0; i < getNumNodes(); i++) {
+			paths[i] = (parents[i] == NO_PARENT ? "" : paths[parents[i]] + "__") + getUniqueId(i).toString();
+			writer.Key(getUniqueId(i).toString());
+			writer.String(paths[i]);
+		}
+		writer.EndObject();
+		writer.EndObject();
+	}
+	else if (name == "idMap.json") {
+		writer.StartObject();
+		writer.Key("idMap");
+		writer.StartObject();
+		for (uint32_t i = 0; i < getNumNodes(); i++) {
+			writer.Key(getUniqueId(i).toString());
+			writer.String(getSharedId(i).toString());
+		}
+		writer.EndObject();
+		writer.EndObject();
+	}
+	else if (name == "idToMeshes.json") {
+		writer.StartObject();
+		for (uint32_t i = 0; i < getNumNodes(); i++) {
+			writer.Key(getUniqueId(i).toString());
+			writer.StartArray();
+			for (const auto& mesh : getMeshes(i)) {
+				writer.String(mesh.toString());
+			}
+			writer.EndArray();
+		}
+		writer.EndObject();
+	}
+	else if (name == "modelProperties.json") {
+		writer.StartObject();
+		writer.Key("hiddenNodes");
+		writer.StartArray();
+		for (auto n : getPostOrder()) {
+			if (getToggleState(n) == SelectionTree::Node::ToggleState::HIDDEN) {
+				writer.String(getUniqueId(n).toString());
+			}
+		}
+		writer.EndArray();
+		writer.EndObject();
+	}
+	else {
+		throw repo::lib::RepoException("Unknown selection tree file " + name);
+	}
+
+	return std::string(buffer.GetString(), buffer.GetSize());
+}
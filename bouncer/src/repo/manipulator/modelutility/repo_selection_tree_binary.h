@@ -0,0 +1,149 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+* Compact binary encoding of the selection trees.
+*
+* The json selection tree files repeat each id as a string many times. The
+* binary format stores each id once, in a table, and the tree as a flat table
+* of nodes in depth-first order, with one column per property. Paths and the
+* meshes under each node are not stored at all, but recovered from the parent
+* column.
+*
+* SelectionTreeBinaryReader can render any of the json files from the binary
+* form on demand, so it can be stored in place of them.
+*/
+
+#pragma once
+
+#include "repo/repo_bouncer_global.h"
+#include "repo_maker_selection_tree.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace repo {
+	namespace manipulator {
+		namespace modelutility {
+
+			/*
+			* Encodes the trees reachable from the root of the full tree
+			*/
+			REPO_API_EXPORT std::vector<uint8_t> serialiseSelectionTreesToBinary(const SelectionTreesSet& trees);
+
+			class REPO_API_EXPORT SelectionTreeBinaryReader
+			{
+			public:
+				static const uint32_t NO_PARENT = 0xFFFFFFFF;
+
+				/**
+				* Throws a RepoException if the buffer is not a valid selection tree.
+				*/
+				SelectionTreeBinaryReader(const std::vector<uint8_t>& buffer);
+
+				size_t getNumNodes() const
+				{
+					return types.size();
+				}
+
+				/**
+				* The names of the json files that can be rendered. modelProperties.json
+				* is only present if any nodes are hidden, as with SelectionTreeMaker.
+				*/
+				std::vector<std::string> getJsonNames() const;
+
+				/**
+				* Renders one of the files written by SelectionTreeMaker, by name (e.g.
+				* "fulltree.json"). Throws a RepoException if the name is not known.
+				*/
+				std::string renderJson(const std::string& name) const;
+
+				repo::core::model::NodeType getType(uint32_t node) const
+				{
+					return (repo::core::model::NodeType)types[node];
+				}
+
+				SelectionTree::Node::ToggleState getToggleState(uint32_t node) const
+				{
+					return (SelectionTree::Node::ToggleState)toggleStates[node];
+				}
+
+				const repo::lib::RepoUUID& getUniqueId(uint32_t node) const
+				{
+					return uuids[ids[node]];
+				}
+
+				const repo::lib::RepoUUID& getSharedId(uint32_t node) const
+				{
+					return uuids[sharedIds[node]];
+				}
+
+				std::string getName(uint32_t node) const
+				{
+					return names.substr(nameOffsets[node], nameOffsets[node + 1] - nameOffsets[node]);
+				}
+
+				uint32_t getParent(uint32_t node) const
+				{
+					return parents[node];
+				}
+
+				const std::vector<uint32_t>& getChildren(uint32_t node) const
+				{
+					return children[node];
+				}
+
+				/**
+				* The unique ids of the node's ancestors, from the root, followed by
+				* its own.
+				*/
+				SelectionTree::ChildPath getPath(uint32_t node) const;
+
+				/**
+				* The unique ids of the meshes at or below the node, in the same order
+				* as SelectionTreeMaker.
+				*/
+				std::vector<repo::lib::RepoUUID> getMeshes(uint32_t node) const;
+
+			private:
+				std::string account;
+				std::string project;
+				std::vector<repo::lib::RepoUUID> uuids;
+
+				// Node table columns
+				std::vector<uint8_t> types;
+				std::vector<uint8_t> toggleStates;
+				std::vector<uint32_t> ids;
+				std::vector<uint32_t> sharedIds;
+				std::vector<uint32_t> parents;
+				std::vector<uint32_t> nameOffsets;
+				std::vector<uint32_t> metaOffsets;
+				std::string names;
+				std::vector<uint32_t> meta;
+
+				std::vector<std::vector<uint32_t>> children;
+
+				void getMeshes(uint32_t node, std::vector<repo::lib::RepoUUID>& meshes) const;
+
+				// The order of the nodes in the post-order traversal SelectionTreeMaker
+				// uses, e.g. for the hidden nodes
+				std::vector<uint32_t> getPostOrder() const;
+			};
+		}
+	}
+}
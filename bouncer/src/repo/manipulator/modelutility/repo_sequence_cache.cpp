@@ -0,0 +1,490 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "repo_sequence_cache.h"
+
+#include "repo/lib/repo_exception.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <tuple>
+
+using namespace repo::manipulator::modelutility;
+using namespace repo::manipulator::modelutility::sequencecache;
+
+/*
+* Layout of the index file (all values little endian):
+*	magic (u32), version (u32), keyframe interval (u32)
+*	number of files (u32), then for each, name length (u32) and name
+*	number of ids (u32), then each id (16 bytes)
+*	number of frames (u32), then for each, timestamp (u64), file (u32),
+*	offset (u64) and size (u32) of its record
+*
+* Layout of a record:
+*	flags (u8) - 1 if the record is a keyframe
+*	for each channel, the number of set entries (varint), then for each the
+*	id index as a delta from the previous entry (varint) and the values; then
+*	the number of removed entries (varint), and their delta coded id indices.
+*/
+
+static const uint32_t SEQUENCE_CACHE_MAGIC = 0x51455352; // RSEQ
+static const uint32_t SEQUENCE_CACHE_VERSION = 1;
+static const size_t SEQUENCE_CACHE_BATCH_SIZE = 256;
+
+enum ChannelType {
+	TRANSPARENCY = 0,
+	COLOUR,
+	TRANSFORMATION,
+	CLIP,
+	CAMERA
+};
+
+static const size_t CHANNEL_WIDTH[] = { 1, 3, 16, 6, 11 };
+
+// Channels that are stored in single precision. The values of these originate
+// as floats, so they are restored exactly.
+static const bool CHANNEL_SINGLE_PRECISION[] = { true, true, false, false, false };
+
+static_assert(sizeof(CHANNEL_WIDTH) / sizeof(CHANNEL_WIDTH[0]) == std::tuple_size<State>::value, "Every channel must have a width");
+
+template<typename T>
+static void writeValue(std::vector<uint8_t>& buffer, const T& value)
+{
+	auto p = (const uint8_t*)&value;
+	buffer.insert(buffer.end(), p, p + sizeof(T));
+}
+
+static void writeVarint(std::vector<uint8_t>& buffer, uint64_t value)
+{
+	while (value >= 0x80) {
+		buffer.push_back((uint8_t)(value | 0x80));
+		value >>= 7;
+	}
+	buffer.push_back((uint8_t)value);
+}
+
+static void writeString(std::vector<uint8_t>& buffer, const std::string& s)
+{
+	writeValue(buffer, (uint32_t)s.size());
+	buffer.insert(buffer.end(), s.begin(), s.end());
+}
+
+class BufferReader
+{
+public:
+	BufferReader(const uint8_t* data, size_t size) :
+		data(data),
+		size(size),
+		position(0)
+	{
+	}
+
+	template<typename T>
+	T read()
+	{
+		T value;
+		memcpy(&value, advance(sizeof(T)), sizeof(T));
+		return value;
+	}
+
+	uint64_t readVarint()
+	{
+		uint64_t value = 0;
+		for (int shift = 0; shift < 64; shift += 7) {
+			auto b = *advance(1);
+			value |= (uint64_t)(b & 0x7F) << shift;
+			if (!(b & 0x80)) {
+				return value;
+			}
+		}
+		throw repo::lib::RepoException("Malformed varint in sequence cache");
+	}
+
+	std::string readString()
+	{
+		auto length = read<uint32_t>();
+		auto p = advance(length);
+		return std::string((const char*)p, length);
+	}
+
+private:
+	const uint8_t* data;
+	size_t size;
+	size_t position;
+
+	const uint8_t* advance(size_t n)
+	{
+		if (position + n > size) {
+			throw repo::lib::RepoException("Unexpected end of sequence cache data");
+		}
+		auto p = data + position;
+		position += n;
+		return p;
+	}
+};
+
+static void writeIndices(std::vector<uint8_t>& buffer, const std::vector<uint32_t>& indices)
+{
+	writeVarint(buffer, indices.size());
+	uint32_t last = 0;
+	for (auto i : indices) {
+		writeVarint(buffer, i - last);
+		last = i;
+	}
+}
+
+static std::vector<uint8_t> encodeRecord(const State& previous, const State& current, bool keyframe)
+{
+	std::vector<uint8_t> buffer;
+	buffer.push_back(keyframe ? 1 : 0);
+
+	for (size_t c = 0; c < current.size(); c++) {
+		std::vector<uint32_t> set, removed;
+		for (const auto& entry : current[c]) {
+			if (keyframe) {
+				set.push_back(entry.first);
+			}
+			else {
+				auto it = previous[c].find(entry.first);
+				if (it == previous[c].end() || it->second != entry.second) {
+					set.push_back(entry.first);
+				}
+			}
+		}
+		if (!keyframe) {
+			for (const auto& entry : previous[c]) {
+				if (!current[c].count(entry.first)) {
+					removed.push_back(entry.first);
+				}
+			}
+		}
+
+		writeVarint(buffer, set.size());
+		uint32_t last = 0;
+		for (auto i : set) {
+			writeVarint(buffer, i - last);
+			last = i;
+			for (auto v : current[c].at(i)) {
+				if (CHANNEL_SINGLE_PRECISION[c]) {
+					writeValue(buffer, (float)v);
+				}
+				else {
+					writeValue(buffer, v);
+				}
+			}
+		}
+
+		writeIndices(buffer, removed);
+	}
+
+	return buffer;
+}
+
+static void decodeRecord(BufferReader& reader, State& state, size_t numIds)
+{
+	auto flags = reader.read<uint8_t>();
+	if (flags & 1) {
+		for (auto& c : state) {
+			c.clear();
+		}
+	}
+
+	for (size_t c = 0; c < state.size(); c++) {
+		auto numSet = reader.readVarint();
+		uint64_t index = 0;
+		for (uint64_t i = 0; i < numSet; i++) {
+			index += reader.readVarint();
+			if (c != CAMERA && index >= numIds) {
+				throw repo::lib::RepoException("Id index out of range in sequence cache");
+			}
+			std::vector<double> values(CHANNEL_WIDTH[c]);
+			for (auto& v : values) {
+				v = CHANNEL_SINGLE_PRECISION[c] ? reader.read<float>() : reader.read<double>();
+			}
+			state[c][(uint32_t)index] = std::move(values);
+		}
+
+		auto numRemoved = reader.readVarint();
+		index = 0;
+		for (uint64_t i = 0; i < numRemoved; i++) {
+			index += reader.readVarint();
+			state[c].erase((uint32_t)index);
+		}
+	}
+}
+
+SequenceCacheWriter::SequenceCacheWriter(
+	size_t keyframeInterval,
+	size_t maxFileSize,
+	size_t numThreads) :
+	keyframeInterval(std::max<size_t>(keyframeInterval, 1)),
+	maxFileSize(maxFileSize),
+	numThreads(numThreads ? numThreads : std::max(std::thread::hardware_concurrency(), 1u)),
+	indexName(repo::lib::RepoUUID::createUUID().toString())
+{
+}
+
+uint32_t SequenceCacheWriter::intern(const repo::lib::RepoUUID& id)
+{
+	auto it = idToIndex.find(id);
+	if (it != idToIndex.end()) {
+		return it->second;
+	}
+	auto index = (uint32_t)ids.size();
+	ids.push_back(id);
+	idToIndex[id] = index;
+	return index;
+}
+
+void SequenceCacheWriter::addFrame(const SequenceFrameState& frame)
+{
+	State state;
+
+	for (const auto& entry : frame.transparency) {
+		state[TRANSPARENCY][intern(entry.first)] = { entry.second };
+	}
+	for (const auto& entry : frame.colour) {
+		state[COLOUR][intern(entry.first)] = { entry.second[0], entry.second[1], entry.second[2] };
+	}
+	for (const auto& entry : frame.transformation) {
+		if (entry.second.size() != CHANNEL_WIDTH[TRANSFORMATION]) {
+			throw repo::lib::RepoException("Sequence frame transformations must be 4x4 matrices");
+		}
+		state[TRANSFORMATION][intern(entry.first)] = entry.second;
+	}
+	for (const auto& entry : frame.clip) {
+		auto& p = entry.second.first;
+		auto& d = entry.second.second;
+		state[CLIP][intern(entry.first)] = { p.x, p.y, p.z, d.x, d.y, d.z };
+	}
+	if (frame.camera) {
+		auto& cam = *frame.camera;
+		state[CAMERA][0] = {
+			cam.position.x, cam.position.y, cam.position.z,
+			cam.forward.x, cam.forward.y, cam.forward.z,
+			cam.up.x, cam.up.y, cam.up.z,
+			cam.fov,
+			cam.isPerspective ? 1.0 : 0.0
+		};
+	}
+
+	pending.push_back(std::move(state));
+	pendingTimestamps.push_back(frame.timestamp);
+
+	if (pending.size() >= std::max(SEQUENCE_CACHE_BATCH_SIZE, numThreads * 4)) {
+		flush();
+	}
+}
+
+void SequenceCacheWriter::flush()
+{
+	if (!pending.size()) {
+		return;
+	}
+
+	// Each record depends only on its own state and the one before it, so the
+	// batch can be split between threads arbitrarily
+
+	std::vector<std::vector<uint8_t>> records(pending.size());
+	auto firstFrame = frames.size();
+
+	auto encode = [&](size_t begin, size_t step) {
+		for (size_t i = begin; i < pending.size(); i += step) {
+			auto& prev = i ? pending[i - 1] : previous;
+			records[i] = encodeRecord(prev, pending[i], (firstFrame + i) % keyframeInterval == 0);
+		}
+	};
+
+	auto threads = std::min(numThreads, pending.size());
+	if (threads > 1) {
+		std::vector<std::thread> workers;
+		for (size_t t = 0; t < threads; t++) {
+			workers.push_back(std::thread(encode, t, threads));
+		}
+		for (auto& w : workers) {
+			w.join();
+		}
+	}
+	else {
+		encode(0, 1);
+	}
+
+	for (size_t i = 0; i < records.size(); i++) {
+		auto& record = records[i];
+		if (!files.size() || (files.back().size() && files.back().size() + record.size() > maxFileSize)) {
+			files.push_back({});
+			fileNames.push_back(repo::lib::RepoUUID::createUUID().toString());
+		}
+		auto& file = files.back();
+		frames.push_back({ pendingTimestamps[i], (uint32_t)(files.size() - 1), file.size(), (uint32_t)record.size() });
+		file.insert(file.end(), record.begin(), record.end());
+	}
+
+	previous = std::move(pending.back());
+	pending.clear();
+	pendingTimestamps.clear();
+}
+
+std::unordered_map<std::string, std::vector<uint8_t>> SequenceCacheWriter::finalise()
+{
+	flush();
+
+	std::vector<uint8_t> index;
+	writeValue(index, SEQUENCE_CACHE_MAGIC);
+	writeValue(index, SEQUENCE_CACHE_VERSION);
+	writeValue(index, (uint32_t)keyframeInterval);
+
+	writeValue(index, (uint32_t)fileNames.size());
+	for (const auto& name : fileNames) {
+		writeString(index, name);
+	}
+
+	writeValue(index, (uint32_t)ids.size());
+	for (const auto& id : ids) {
+		auto& uuid = id.getInternalID();
+		index.insert(index.end(), uuid.begin(), uuid.end());
+	}
+
+	writeValue(index, (uint32_t)frames.size());
+	for (const auto& frame : frames) {
+		writeValue(index, frame.timestamp);
+		writeValue(index, frame.file);
+		writeValue(index, frame.offset);
+		writeValue(index, frame.size);
+	}
+
+	std::unordered_map<std::string, std::vector<uint8_t>> results;
+	for (size_t i = 0; i < files.size(); i++) {
+		results[fileNames[i]] = std::move(files[i]);
+	}
+	files.clear();
+	results[indexName] = std::move(index);
+	return results;
+}
+
+const std::string& SequenceCacheWriter::getFileName(size_t frame) const
+{
+	return fileNames[frames.at(frame).file];
+}
+
+SequenceCacheReader::SequenceCacheReader(
+	const std::vector<uint8_t>& index,
+	std::function<std::vector<uint8_t>(const std::string&)> getFile) :
+	getFile(getFile)
+{
+	BufferReader reader(index.data(), index.size());
+	if (reader.read<uint32_t>() != SEQUENCE_CACHE_MAGIC) {
+		throw repo::lib::RepoException("Not a sequence cache index");
+	}
+	auto version = reader.read<uint32_t>();
+	if (version != SEQUENCE_CACHE_VERSION) {
+		throw repo::lib::RepoException("Unsupported sequence cache version " + std::to_string(version));
+	}
+	keyframeInterval = std::max<uint32_t>(reader.read<uint32_t>(), 1);
+
+	auto numFiles = reader.read<uint32_t>();
+	for (uint32_t i = 0; i < numFiles; i++) {
+		fileNames.push_back(reader.readString());
+	}
+
+	auto numIds = reader.read<uint32_t>();
+	ids.reserve(numIds);
+	for (uint32_t i = 0; i < numIds; i++) {
+		boost::uuids::uuid uuid;
+		for (auto& b : uuid) {
+			b = reader.read<uint8_t>();
+		}
+		ids.push_back(repo::lib::RepoUUID(uuid));
+	}
+
+	auto numFrames = reader.read<uint32_t>();
+	frames.reserve(numFrames);
+	for (uint32_t i = 0; i < numFrames; i++) {
+		FrameEntry frame;
+		frame.timestamp = reader.read<uint64_t>();
+		frame.file = reader.read<uint32_t>();
+		frame.offset = reader.read<uint64_t>();
+		frame.size = reader.read<uint32_t>();
+		if (frame.file >= fileNames.size()) {
+			throw repo::lib::RepoException("File index out of range in sequence cache");
+		}
+		frames.push_back(frame);
+	}
+}
+
+uint64_t SequenceCacheReader::getTimestamp(size_t frame) const
+{
+	return frames.at(frame).timestamp;
+}
+
+const std::vector<uint8_t>& SequenceCacheReader::loadFile(uint32_t file)
+{
+	auto it = loadedFiles.find(file);
+	if (it == loadedFiles.end()) {
+		it = loadedFiles.emplace(file, getFile(fileNames[file])).first;
+	}
+	return it->second;
+}
+
+SequenceFrameState SequenceCacheReader::getFrame(size_t frame)
+{
+	if (frame >= frames.size()) {
+		throw repo::lib::RepoException("Frame " + std::to_string(frame) + " is out of range");
+	}
+
+	State state;
+	for (auto i = frame - frame % keyframeInterval; i <= frame; i++) {
+		auto& entry = frames[i];
+		auto& file = loadFile(entry.file);
+		if (entry.offset + entry.size > file.size()) {
+			throw repo::lib::RepoException("Sequence cache record is out of range of its file");
+		}
+		BufferReader reader(file.data() + entry.offset, entry.size);
+		decodeRecord(reader, state, ids.size());
+	}
+
+	SequenceFrameState result;
+	result.timestamp = frames[frame].timestamp;
+
+	for (const auto& entry : state[TRANSPARENCY]) {
+		result.transparency[ids[entry.first]] = (float)entry.second[0];
+	}
+	for (const auto& entry : state[COLOUR]) {
+		result.colour[ids[entry.first]] = { (float)entry.second[0], (float)entry.second[1], (float)entry.second[2] };
+	}
+	for (const auto& entry : state[TRANSFORMATION]) {
+		result.transformation[ids[entry.first]] = entry.second;
+	}
+	for (const auto& entry : state[CLIP]) {
+		auto& v = entry.second;
+		result.clip[ids[entry.first]] = { { v[0], v[1], v[2] }, { v[3], v[4], v[5] } };
+	}
+	auto cam = state[CAMERA].find(0);
+	if (cam != state[CAMERA].end()) {
+		auto& v = cam->second;
+		result.camera = SequenceFrameState::Camera{
+			{ v[0], v[1], v[2] },
+			{ (float)v[3], (float)v[4], (float)v[5] },
+			{ (float)v[6], (float)v[7], (float)v[8] },
+			(float)v[9],
+			v[10] != 0
+		};
+	}
+
+	return result;
+}
@@ -0,0 +1,199 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+* Binary cache of the states of an animation sequence.
+*
+* Instead of one JSON document per frame, the frames are written as records
+* packed into a small number of files, with an index. The ids of the nodes
+* are stored once in the index, and referred to by the records by their
+* position. Each record holds only the changes from the previous frame, except
+* for every keyframeInterval'th frame, which holds the complete state, so any
+* frame can be reconstructed by reading at most keyframeInterval records.
+*/
+
+#pragma once
+
+#include "repo/repo_bouncer_global.h"
+#include "repo/lib/datastructure/repo_uuid.h"
+#include "repo/lib/datastructure/repo_vector.h"
+
+#include <array>
+#include <functional>
+#include <map>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace repo {
+	namespace manipulator {
+		namespace modelutility {
+
+			/*
+			* The complete state of the scene at one frame of a sequence
+			*/
+			struct SequenceFrameState
+			{
+				struct Camera
+				{
+					repo::lib::RepoVector3D64 position;
+					repo::lib::RepoVector3D forward;
+					repo::lib::RepoVector3D up;
+					float fov;
+					bool isPerspective;
+
+					bool operator==(const Camera& other) const = default;
+				};
+
+				uint64_t timestamp = 0;
+				std::unordered_map<repo::lib::RepoUUID, float, repo::lib::RepoUUIDHasher> transparency;
+				std::unordered_map<repo::lib::RepoUUID, std::array<float, 3>, repo::lib::RepoUUIDHasher> colour;
+				std::unordered_map<repo::lib::RepoUUID, std::vector<double>, repo::lib::RepoUUIDHasher> transformation; // 4x4, row major
+				std::unordered_map<repo::lib::RepoUUID, std::pair<repo::lib::RepoVector3D64, repo::lib::RepoVector3D64>, repo::lib::RepoUUIDHasher> clip; // position, direction
+				std::optional<Camera> camera;
+
+				bool operator==(const SequenceFrameState& other) const = default;
+			};
+
+			namespace sequencecache {
+				// The states are kept internally as a set of channels (transparency,
+				// colour, etc), each a map of id index to the values of the property
+				using Channel = std::map<uint32_t, std::vector<double>>;
+				using State = std::array<Channel, 5>;
+			}
+
+			/*
+			* Encodes a sequence of frame states. Frames are buffered and encoded in
+			* batches, in parallel.
+			*/
+			class REPO_API_EXPORT SequenceCacheWriter
+			{
+			public:
+				/**
+				* @param keyframeInterval number of frames between complete states
+				* @param maxFileSize a new file is started when a file would exceed this size
+				* @param numThreads threads to encode with (0 for the number of cores)
+				*/
+				SequenceCacheWriter(
+					size_t keyframeInterval = 64,
+					size_t maxFileSize = 32 * 1024 * 1024,
+					size_t numThreads = 0);
+
+				/**
+				* Frames must be added in order
+				*/
+				void addFrame(const SequenceFrameState& state);
+
+				/**
+				* Encodes any remaining frames, and returns all the files that make up
+				* the cache (including the index), by name.
+				*/
+				std::unordered_map<std::string, std::vector<uint8_t>> finalise();
+
+				const std::string& getIndexName() const
+				{
+					return indexName;
+				}
+
+				/**
+				* The name of the file that holds the record for the given frame. Only
+				* valid after finalise().
+				*/
+				const std::string& getFileName(size_t frame) const;
+
+				size_t getNumFrames() const
+				{
+					return frames.size();
+				}
+
+			private:
+				struct FrameEntry
+				{
+					uint64_t timestamp;
+					uint32_t file;
+					uint64_t offset;
+					uint32_t size;
+				};
+
+				size_t keyframeInterval;
+				size_t maxFileSize;
+				size_t numThreads;
+
+				std::string indexName;
+				std::vector<repo::lib::RepoUUID> ids;
+				std::unordered_map<repo::lib::RepoUUID, uint32_t, repo::lib::RepoUUIDHasher> idToIndex;
+				std::vector<std::string> fileNames;
+				std::vector<std::vector<uint8_t>> files;
+				std::vector<FrameEntry> frames;
+
+				std::vector<sequencecache::State> pending;
+				std::vector<uint64_t> pendingTimestamps;
+				sequencecache::State previous;
+
+				uint32_t intern(const repo::lib::RepoUUID& id);
+
+				/*
+				* Encodes the pending frames and appends them to the files
+				*/
+				void flush();
+			};
+
+			/*
+			* Reconstructs frame states from a cache created by SequenceCacheWriter
+			*/
+			class REPO_API_EXPORT SequenceCacheReader
+			{
+			public:
+				/**
+				* @param index the contents of the index file
+				* @param getFile callback that returns the contents of a file by name
+				*/
+				SequenceCacheReader(
+					const std::vector<uint8_t>& index,
+					std::function<std::vector<uint8_t>(const std::string&)> getFile);
+
+				size_t getNumFrames() const
+				{
+					return frames.size();
+				}
+
+				uint64_t getTimestamp(size_t frame) const;
+
+				SequenceFrameState getFrame(size_t frame);
+
+			private:
+				struct FrameEntry
+				{
+					uint64_t timestamp;
+					uint32_t file;
+					uint64_t offset;
+					uint32_t size;
+				};
+
+				std::function<std::vector<uint8_t>(const std::string&)> getFile;
+				size_t keyframeInterval;
+				std::vector<repo::lib::RepoUUID> ids;
+				std::vector<std::string> fileNames;
+				std::vector<FrameEntry> frames;
+				std::map<uint32_t, std::vector<uint8_t>> loadedFiles;
+
+				const std::vector<uint8_t>& loadFile(uint32_t file);
+			};
+		}
+	}
+}
@@ -0,0 +1,188 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "repo_sequence_frame_serialiser.h"
+#include "repo/lib/repo_property_tree.h"
+
+#include <algorithm>
+
+using namespace repo::manipulator::modelutility;
+
+const static std::string SEQ_CACHE_LABEL_TRANSPARENCY = "transparency";
+const static std::string SEQ_CACHE_LABEL_COLOR = "color";
+const static std::string SEQ_CACHE_LABEL_TRANSFORMATION = "transformation";
+const static std::string SEQ_CACHE_LABEL_CLIP = "clip";
+const static std::string SEQ_CACHE_LABEL_VALUE = "value";
+const static std::string SEQ_CACHE_LABEL_SHARED_IDS = "shared_ids";
+const static std::string SEQ_CACHE_LABEL_CAMERA = "camera";
+const static std::string SEQ_CACHE_LABEL_POSITION = "position";
+const static std::string SEQ_CACHE_LABEL_DIRECTION = "direction";
+const static std::string SEQ_CACHE_LABEL_FORWARD = "forward";
+const static std::string SEQ_CACHE_LABEL_UP = "up";
+const static std::string SEQ_CACHE_LABEL_FOV = "fov";
+const static std::string SEQ_CACHE_LABEL_PERSPECTIVE = "perspective";
+
+std::vector<uint8_t> repo::manipulator::modelutility::serialiseSequenceFrame(const SequenceFrameSnapshot& snapshot)
+{
+	std::vector<repo::lib::PropertyTree> transparencyStates, colourStates, transformationStates, clipPlaneStates;
+
+	for (const auto& entry : snapshot.transformation) {
+		repo::lib::PropertyTree transformTree;
+		transformTree.addToTree(SEQ_CACHE_LABEL_VALUE, entry.first);
+		transformTree.addToTree(SEQ_CACHE_LABEL_SHARED_IDS, entry.second);
+		transformationStates.push_back(transformTree);
+	}
+
+	for (const auto& entry : snapshot.clip) {
+		repo::lib::PropertyTree clipTree, valueTree;
+		valueTree.addToTree(SEQ_CACHE_LABEL_POSITION, entry.second.first);
+		valueTree.addToTree(SEQ_CACHE_LABEL_DIRECTION, entry.second.second);
+		clipTree.mergeSubTree(SEQ_CACHE_LABEL_VALUE, valueTree);
+		std::vector<repo::lib::RepoUUID> idArr = { entry.first };
+		clipTree.addToTree(SEQ_CACHE_LABEL_SHARED_IDS, idArr);
+		clipPlaneStates.push_back(clipTree);
+	}
+
+	for (const auto& entry : snapshot.transparency) {
+		repo::lib::PropertyTree transTree;
+		transTree.addToTree(SEQ_CACHE_LABEL_VALUE, entry.first);
+		transTree.addToTree(SEQ_CACHE_LABEL_SHARED_IDS, entry.second);
+		transparencyStates.push_back(transTree);
+	}
+
+	for (const auto& entry : snapshot.colour) {
+		// The ids of the colour changes have always been written as strings, so
+		// are converted here rather than on the importer's thread
+
+		std::vector<std::string> ids;
+		ids.reserve(entry.second.size());
+		for (const auto& id : entry.second) {
+			ids.push_back(id.toString());
+		}
+
+		repo::lib::PropertyTree colTree;
+		colTree.addToTree(SEQ_CACHE_LABEL_VALUE, entry.first);
+		colTree.addToTree(SEQ_CACHE_LABEL_SHARED_IDS, ids);
+		colourStates.push_back(colTree);
+	}
+
+	repo::lib::PropertyTree bufferTree;
+	if (transparencyStates.size()) bufferTree.addArrayObjects(SEQ_CACHE_LABEL_TRANSPARENCY, transparencyStates);
+	if (colourStates.size()) bufferTree.addArrayObjects(SEQ_CACHE_LABEL_COLOR, colourStates);
+	if (transformationStates.size()) bufferTree.addArrayObjects(SEQ_CACHE_LABEL_TRANSFORMATION, transformationStates);
+	if (clipPlaneStates.size()) bufferTree.addArrayObjects(SEQ_CACHE_LABEL_CLIP, clipPlaneStates);
+
+	if (snapshot.camera) {
+		auto& cam = *snapshot.camera;
+		repo::lib::PropertyTree camTree;
+		camTree.addToTree(SEQ_CACHE_LABEL_POSITION, cam.position);
+		camTree.addToTree(SEQ_CACHE_LABEL_FORWARD, cam.forward);
+		camTree.addToTree(SEQ_CACHE_LABEL_UP, cam.up);
+		camTree.addToTree(SEQ_CACHE_LABEL_PERSPECTIVE, cam.isPerspective ? "true" : "false");
+		camTree.addToTree(SEQ_CACHE_LABEL_FOV, cam.fov);
+		bufferTree.mergeSubTree(SEQ_CACHE_LABEL_CAMERA, camTree);
+	}
+
+	return bufferTree.writeJsonToBuffer();
+}
+
+SequenceFrameSerialiser::SequenceFrameSerialiser(size_t numThreads, size_t maxPending) :
+	finished(false)
+{
+	numThreads = numThreads ? numThreads : std::max(std::thread::hardware_concurrency(), 1u);
+	this->maxPending = maxPending ? maxPending : numThreads * 4;
+	for (size_t i = 0; i < numThreads; i++) {
+		workers.push_back(std::thread(&SequenceFrameSerialiser::work, this));
+	}
+}
+
+SequenceFrameSerialiser::~SequenceFrameSerialiser()
+{
+	stop();
+}
+
+size_t SequenceFrameSerialiser::addFrame(SequenceFrameSnapshot&& snapshot)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	spaceAvailable.wait(lock, [&] { return pending.size() < maxPending; });
+
+	// Each worker writes directly into its frame's slot, so the documents end up
+	// in order regardless of which finishes first
+
+	auto frame = results.size();
+	results.emplace_back();
+	pending.emplace_back(frame, std::move(snapshot));
+	workAvailable.notify_one();
+	return frame;
+}
+
+std::vector<std::vector<uint8_t>> SequenceFrameSerialiser::finalise()
+{
+	stop();
+	if (error) {
+		std::rethrow_exception(error);
+	}
+	return std::move(results);
+}
+
+void SequenceFrameSerialiser::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		finished = true;
+	}
+	workAvailable.notify_all();
+	for (auto& worker : workers) {
+		worker.join();
+	}
+	workers.clear();
+}
+
+void SequenceFrameSerialiser::work()
+{
+	while (true) {
+		std::pair<size_t, SequenceFrameSnapshot> item;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			workAvailable.wait(lock, [&] { return pending.size() || finished; });
+			if (pending.empty()) {
+				return;
+			}
+			item = std::move(pending.front());
+			pending.pop_front();
+		}
+		spaceAvailable.notify_one();
+
+		std::vector<uint8_t> document;
+		try {
+			document = serialiseSequenceFrame(item.second);
+		}
+		catch (...) {
+			std::lock_guard<std::mutex> lock(mutex);
+			if (!error) {
+				error = std::current_exception();
+			}
+			continue;
+		}
+
+		// results may be reallocated by addFrame, so the slot must be written
+		// under the lock
+
+		std::lock_guard<std::mutex> lock(mutex);
+		results[item.first] = std::move(document);
+	}
+}
@@ -0,0 +1,110 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+* Serialises the states of an animation sequence to the per-frame JSON
+* documents, on a pool of worker threads.
+*
+* The importer must advance the state of the sequence one frame at a time, but
+* once the state has been captured, building and writing the documents for each
+* frame is independent. Snapshots are cheap copies of the state, taken on the
+* importer's thread, that hold just what is needed to write the document.
+*/
+
+#pragma once
+
+#include "repo/repo_bouncer_global.h"
+#include "repo/lib/datastructure/repo_uuid.h"
+#include "repo/lib/datastructure/repo_vector.h"
+#include "repo_sequence_cache.h"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace repo {
+	namespace manipulator {
+		namespace modelutility {
+
+			/*
+			* The state of one frame, with the entries of each property in the order
+			* they should appear in the document
+			*/
+			struct SequenceFrameSnapshot
+			{
+				std::vector<std::pair<float, std::vector<std::string>>> transparency;
+				std::vector<std::pair<std::vector<float>, std::vector<repo::lib::RepoUUID>>> colour;
+				std::vector<std::pair<std::vector<double>, std::vector<repo::lib::RepoUUID>>> transformation;
+				std::vector<std::pair<repo::lib::RepoUUID, std::pair<repo::lib::RepoVector3D64, repo::lib::RepoVector3D64>>> clip;
+				std::optional<SequenceFrameState::Camera> camera;
+			};
+
+			/*
+			* Writes the JSON document for a frame
+			*/
+			REPO_API_EXPORT std::vector<uint8_t> serialiseSequenceFrame(const SequenceFrameSnapshot& snapshot);
+
+			class REPO_API_EXPORT SequenceFrameSerialiser
+			{
+			public:
+				/**
+				* @param numThreads threads to serialise with (0 for the number of cores)
+				* @param maxPending addFrame blocks while this many snapshots are waiting
+				* to be serialised (0 for a few per thread), to bound memory use
+				*/
+				SequenceFrameSerialiser(size_t numThreads = 0, size_t maxPending = 0);
+
+				~SequenceFrameSerialiser();
+
+				/**
+				* Queues a snapshot to be serialised. Returns the index of the frame
+				* in the results of finalise().
+				*/
+				size_t addFrame(SequenceFrameSnapshot&& snapshot);
+
+				/**
+				* Waits for all the queued frames and returns their documents, in the
+				* order they were added. If a frame could not be serialised, the
+				* exception is rethrown here.
+				*/
+				std::vector<std::vector<uint8_t>> finalise();
+
+			private:
+				size_t maxPending;
+				std::vector<std::thread> workers;
+
+				std::mutex mutex;
+				std::condition_variable workAvailable;
+				std::condition_variable spaceAvailable;
+				std::deque<std::pair<size_t, SequenceFrameSnapshot>> pending;
+				std::vector<std::vector<uint8_t>> results;
+				std::exception_ptr error;
+				bool finished;
+
+				void work();
+
+				void stop();
+			};
+		}
+	}
+}
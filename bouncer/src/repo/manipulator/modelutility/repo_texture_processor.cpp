@@ -0,0 +1,205 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "repo_texture_processor.h"
+
+#include "repo/lib/repo_exception.h"
+#include "repo/lib/repo_image.h"
+#include "repo/lib/repo_sha256.h"
+#include <repo_log.h>
+
+using namespace repo::manipulator::modelutility;
+
+TextureProcessor::TextureProcessor(const TextureProcessorOptions& options) :
+	options(options),
+	finished(false)
+{
+	auto numThreads = options.numThreads ? options.numThreads : std::max(std::thread::hardware_concurrency(), 1u);
+	for (size_t i = 0; i < numThreads; i++) {
+		workers.push_back(std::thread(&TextureProcessor::work, this));
+	}
+}
+
+TextureProcessor::~TextureProcessor()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		finished = true;
+	}
+	workAvailable.notify_all();
+	for (auto& worker : workers) {
+		worker.join();
+	}
+}
+
+std::string TextureProcessor::hash(const std::vector<uint8_t>& data)
+{
+	repo::lib::RepoSHA256 sha;
+	sha.update(data.data(), data.size());
+	return sha.hexdigest();
+}
+
+std::string TextureProcessor::submit(std::vector<uint8_t> data)
+{
+	auto key = hash(data);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	if (entries.find(key) == entries.end()) {
+		Job job;
+		job.hash = key;
+		job.allocation.resize(data.size());
+		job.data = std::move(data);
+		entries[key] = {};
+		pending.push_back(std::move(job));
+		workAvailable.notify_one();
+	}
+	return key;
+}
+
+TextureProcessor::Entry& TextureProcessor::wait(std::unique_lock<std::mutex>& lock, const std::string& hash)
+{
+	auto it = entries.find(hash);
+	if (it == entries.end()) {
+		throw repo::lib::RepoException("No texture has been submitted with the hash " + hash);
+	}
+
+	// References to the elements of an unordered_map stay valid as others are
+	// inserted
+
+	auto& entry = it->second;
+	resultAvailable.wait(lock, [&] { return entry.done; });
+	if (entry.error) {
+		std::rethrow_exception(entry.error);
+	}
+	if (entry.taken) {
+		throw repo::lib::RepoException("The texture with the hash " + hash + " has already been taken");
+	}
+	return entry;
+}
+
+std::shared_ptr<const ProcessedTexture> TextureProcessor::get(const std::string& hash)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	return wait(lock, hash).result;
+}
+
+std::shared_ptr<const ProcessedTexture> TextureProcessor::take(const std::string& hash)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	auto& entry = wait(lock, hash);
+	entry.taken = true;
+	return std::move(entry.result);
+}
+
+std::vector<std::string> TextureProcessor::takeCompleted()
+{
+	std::vector<std::string> hashes;
+	std::lock_guard<std::mutex> lock(mutex);
+	hashes.swap(completed);
+	return hashes;
+}
+
+void TextureProcessor::work()
+{
+	while (true) {
+		Job item;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			workAvailable.wait(lock, [&] { return pending.size() || finished; });
+			if (pending.empty()) {
+				return;
+			}
+			item = std::move(pending.front());
+			pending.pop_front();
+		}
+
+		std::shared_ptr<ProcessedTexture> result;
+		std::exception_ptr error;
+		try {
+			result = std::make_shared<ProcessedTexture>(process(std::move(item.data), options));
+		}
+		catch (...) {
+			error = std::current_exception();
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			auto& entry = entries[item.hash];
+			entry.result = result;
+			entry.error = error;
+			entry.done = true;
+			completed.push_back(item.hash);
+		}
+		resultAvailable.notify_all();
+	}
+}
+
+ProcessedTexture TextureProcessor::process(std::vector<uint8_t> data, const TextureProcessorOptions& options)
+{
+	ProcessedTexture texture;
+
+	std::optional<repo::lib::RepoImage> image;
+	try {
+		image = repo::lib::RepoImage::decode(data);
+	}
+	catch (const repo::lib::RepoException& e) {
+		repoWarning << "Could not decode texture, it will be stored as it is: " << e.what();
+	}
+
+	// Images in formats that cannot be decoded, such as JPEG, are passed
+	// through unchanged
+
+	if (!image) {
+		texture.allocation.resize(data.size());
+		texture.data = std::move(data);
+		return texture;
+	}
+
+	auto fitted = image->fit(options.maxDimension);
+	bool resized = fitted.getWidth() != image->getWidth() || fitted.getHeight() != image->getHeight();
+	image.reset();
+
+	texture.width = fitted.getWidth();
+	texture.height = fitted.getHeight();
+
+	std::vector<uint8_t> encoded;
+	if (resized || options.recompress) {
+		encoded = fitted.encodePNG(options.compressionLevel);
+	}
+
+	if (resized || (encoded.size() && encoded.size() < data.size())) {
+		texture.data = std::move(encoded);
+		texture.extension = "png";
+	}
+	else {
+		texture.data = std::move(data);
+	}
+
+	if (options.generateMipLevels) {
+		for (auto& level : fitted.mipLevels()) {
+			texture.mipLevels.push_back({ level.getWidth(), level.getHeight(), level.encodePNG(options.compressionLevel) });
+		}
+	}
+
+	size_t size = texture.data.size();
+	for (auto& level : texture.mipLevels) {
+		size += level.data.size();
+	}
+	texture.allocation.resize(size);
+
+	return texture;
+}
@@ -0,0 +1,148 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+* Processes texture images on a pool of worker threads before they are stored.
+* Images that can be decoded are scaled down to a maximum size, re-encoded as
+* PNG when that is smaller, and optionally given a chain of mip levels. Images
+* are identified by a hash of their content, so identical images submitted
+* more than once are only processed once. Images waiting to be processed and
+* the results are counted under the texture tag of RepoMemoryAccounting.
+*/
+
+#pragma once
+
+#include "repo/repo_bouncer_global.h"
+#include "repo/core/model/bson/repo_node_texture.h"
+#include "repo/lib/repo_memory_accounting.h"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace repo {
+	namespace manipulator {
+		namespace modelutility {
+
+			struct TextureProcessorOptions
+			{
+				uint32_t maxDimension = 0; // Neither side of an image will be larger than this (0 for no limit)
+				bool generateMipLevels = false;
+				bool recompress = true; // Re-encode images that are not resized, if it makes them smaller
+				int compressionLevel = 6; // zlib level for PNG encoding, 1 (fastest) to 9 (smallest)
+				size_t numThreads = 0; // 0 for the number of cores
+			};
+
+			struct ProcessedTexture
+			{
+				std::vector<uint8_t> data;
+				std::string extension; // The format of data, if it has changed from the original, otherwise empty
+				uint32_t width = 0; // The dimensions are 0 if the image could not be decoded
+				uint32_t height = 0;
+				std::vector<repo::core::model::TextureNode::MipLevel> mipLevels;
+				repo::lib::RepoMemoryAccounting::Allocation allocation{ repo::lib::RepoMemoryAccounting::Tag::TEXTURE };
+			};
+
+			class REPO_API_EXPORT TextureProcessor
+			{
+			public:
+				TextureProcessor(const TextureProcessorOptions& options = {});
+				~TextureProcessor();
+
+				/**
+				* Queues an image file for processing, unless one with the same content
+				* has been submitted before. Returns the hash of the content, which
+				* identifies the result.
+				*/
+				std::string submit(std::vector<uint8_t> data);
+
+				/**
+				* Waits for the image with the given hash to be processed, and returns
+				* it. If processing failed other than because the image could not be
+				* decoded (which leaves the image as it is), the exception is rethrown
+				* here. Results are held until the processor is destroyed.
+				*/
+				std::shared_ptr<const ProcessedTexture> get(const std::string& hash);
+
+				/**
+				* As get, but the processor gives up its reference to the result, so
+				* it is freed as soon as the caller has finished with it. The result
+				* cannot be got again.
+				*/
+				std::shared_ptr<const ProcessedTexture> take(const std::string& hash);
+
+				/**
+				* Returns the hashes of the images that have finished processing since
+				* the last call, without waiting for any others.
+				*/
+				std::vector<std::string> takeCompleted();
+
+				const TextureProcessorOptions& getOptions() const
+				{
+					return options;
+				}
+
+				/**
+				* Processes an image on the calling thread
+				*/
+				static ProcessedTexture process(std::vector<uint8_t> data, const TextureProcessorOptions& options);
+
+				static std::string hash(const std::vector<uint8_t>& data);
+
+			private:
+				struct Entry
+				{
+					std::shared_ptr<const ProcessedTexture> result;
+					std::exception_ptr error;
+					bool done = false;
+					bool taken = false;
+				};
+
+				struct Job
+				{
+					std::string hash;
+					std::vector<uint8_t> data;
+					repo::lib::RepoMemoryAccounting::Allocation allocation{ repo::lib::RepoMemoryAccounting::Tag::TEXTURE };
+				};
+
+				TextureProcessorOptions options;
+				std::vector<std::thread> workers;
+				std::mutex mutex;
+				std::condition_variable workAvailable;
+				std::condition_variable resultAvailable;
+				std::deque<Job> pending;
+				std::unordered_map<std::string, Entry> entries;
+				std::vector<std::string> completed;
+				bool finished;
+
+				void work();
+
+				/**
+				* Waits for the entry with the given hash to be done, rethrowing its
+				* error if it has one. The caller must hold the lock.
+				*/
+				Entry& wait(std::unique_lock<std::mutex>& lock, const std::string& hash);
+			};
+		}
+	}
+}
@@ -24,6 +24,8 @@
 #include <boost/range/algorithm/copy.hpp>
 
 #include <repo_log.h>
+#include "repo/core/handler/repo_database_handler_memory.h"
+#include "repo/lib/repo_memory_accounting.h"
 #include "repo/core/handler/repo_database_handler_mongo.h"
 #include "repo/core/handler/fileservice/repo_file_manager.h"
 #include "repo/core/model/bson/repo_bson_factory.h"
@@ -60,14 +62,15 @@ void RepoManipulator::connectAndAuthenticateWithAdmin(
 {
 	repo::core::handler::MongoDatabaseHandler::ConnectionOptions options;
 	options.maxConnections = maxConnections;
-	dbHandler = repo::core::handler::MongoDatabaseHandler::getHandler(
+	auto mongoHandler = repo::core::handler::MongoDatabaseHandler::getHandler(
 		address,
 		port,
 		username,
 		password,
 		options
 	);
-	dbHandler->testConnection();
+	mongoHandler->testConnection();
+	dbHandler = mongoHandler;
 }
 
 void RepoManipulator::connectAndAuthenticateWithAdmin(
@@ -79,13 +82,14 @@ void RepoManipulator::connectAndAuthenticateWithAdmin(
 {
 	repo::core::handler::MongoDatabaseHandler::ConnectionOptions options;
 	options.maxConnections = maxConnections;
-	dbHandler = repo::core::handler::MongoDatabaseHandler::getHandler(
+	auto mongoHandler = repo::core::handler::MongoDatabaseHandler::getHandler(
 		connString,
 		username,
 		password,
 		options
 	);
-	dbHandler->testConnection();
+	mongoHandler->testConnection();
+	dbHandler = mongoHandler;
 }
 
 repo::core::model::RepoScene* RepoManipulator::createFederatedScene(
@@ -133,7 +137,8 @@ uint8_t RepoManipulator::commitScene(
 	const std::string& owner,
 	const std::string& tag,
 	const std::string& desc,
-	const repo::lib::RepoUUID& revId)
+	const repo::lib::RepoUUID& revId,
+	const int numThreads)
 {
 	repoLog("Manipulator: Committing model to database");
 
@@ -149,7 +154,7 @@ uint8_t RepoManipulator::commitScene(
 	}
 
 	modelutility::SceneManager sceneManager;
-	return sceneManager.commitScene(scene, projOwner, tag, desc, revId, dbHandler.get(), dbHandler->getFileManager().get());
+	return sceneManager.commitScene(scene, projOwner, tag, desc, revId, dbHandler.get(), dbHandler->getFileManager().get(), numThreads);
 }
 
 repo::core::model::RepoScene* RepoManipulator::fetchScene(
@@ -159,10 +164,11 @@ repo::core::model::RepoScene* RepoManipulator::fetchScene(
 	const bool& headRevision,
 	const bool& ignoreRefScene,
 	const bool& skeletonFetch,
-	const std::vector<repo::core::model::ModelRevisionNode::UploadStatus>& includeStatus)
+	const std::vector<repo::core::model::ModelRevisionNode::UploadStatus>& includeStatus,
+	const bool& referencesOnly)
 {
 	modelutility::SceneManager sceneManager;
-	return sceneManager.fetchScene(dbHandler.get(), database, project, uuid, headRevision, ignoreRefScene, skeletonFetch, includeStatus);
+	return sceneManager.fetchScene(dbHandler.get(), database, project, uuid, headRevision, ignoreRefScene, skeletonFetch, includeStatus, referencesOnly);
 }
 
 void RepoManipulator::fetchScene(
@@ -249,6 +255,7 @@ RepoManipulator::loadSceneFromFile(
 	uint8_t& error,
 	const repo::manipulator::modelconvertor::ModelImportConfig& config)
 {
+	repo::lib::RepoMemoryAccounting::Stage stage("import");
 	repo::manipulator::modelconvertor::ModelImportManager manager;
 	return manager.ImportFromFile(filePath, config, dbHandler, error);
 }
@@ -289,9 +296,16 @@ void RepoManipulator::processDrawingRevision(
 	// drawing, and return the contents along with calibration and any other
 	// metadata in the DrawingImageInfo.
 
+	// The svg is compressed and written to the file store as it is created, so
+	// the complete image never has to be held in memory. If the import fails,
+	// the partial file is removed when the stream goes out of scope.
+
+	auto image = manager.createImageStream(dbHandler->getFileManager().get(), teamspace);
+
 	repo::manipulator::modelconvertor::DrawingImportManager importer;
 	repo::manipulator::modelutility::DrawingImageInfo drawing;
 	drawing.name = refNode.getFileName();
+	drawing.output = &image->stream();
 	if (imagePath.empty()) {
 		importer.importFromFile(
 			drawing,
@@ -302,16 +316,12 @@ void RepoManipulator::processDrawingRevision(
 	}
 	else {
 		std::ifstream input(imagePath, std::ios::binary);
-		input.unsetf(std::ios_base::skipws);
-		std::istream_iterator<uint8_t> start(input), end;
-		std::vector<uint8_t> buffer(start, end);
-
-		drawing.data = buffer;
+		*drawing.output << input.rdbuf();
 		error = REPOERR_OK;
 	}
 
 	if (error == REPOERR_OK) {
-		error = manager.commitImage(dbHandler.get(), dbHandler->getFileManager().get(), teamspace, revisionNode, drawing);
+		error = manager.commitImage(dbHandler.get(), dbHandler->getFileManager().get(), teamspace, revisionNode, drawing, *image);
 	}
 }
 
@@ -321,7 +331,10 @@ bool RepoManipulator::init(
 	const int& nDbConnections
 ) {
 	auto dbConf = config.getDatabaseConfig();
-	if (dbConf.connString.empty()) {
+	if (!dbConf.path.empty()) {
+		dbHandler = repo::core::handler::MemoryDatabaseHandler::getHandler(dbConf.path);
+	}
+	else if (dbConf.connString.empty()) {
 		connectAndAuthenticateWithAdmin(dbConf.addr, dbConf.port, nDbConnections, dbConf.username, dbConf.password);
 	}
 	else {
@@ -35,7 +35,7 @@
 namespace repo {
 	namespace core {
 	namespace handler {
-		class MongoDatabaseHandler;
+		class AbstractDatabaseHandler;
 	namespace fileservice {
 		class FileManager;
 	}
@@ -54,6 +54,7 @@ namespace repo {
 			* @param cred user credentials in bson form
 			* @param scene scene to commit
 			* @param owner specify the owner of the scene (by default it is the user authorised to commit)
+			* @param numThreads threads to generate the stash with (0 for the number of cores)
 			*/
 			uint8_t commitScene(
 				const std::string                     &user,
@@ -61,7 +62,8 @@ namespace repo {
 				const std::string                     &owner = "",
 				const std::string                     &tag = "",
 				const std::string                     &desc = "",
-				const repo::lib::RepoUUID             &revId = repo::lib::RepoUUID::createUUID());
+				const repo::lib::RepoUUID             &revId = repo::lib::RepoUUID::createUUID(),
+				const int                             numThreads = 0);
 
 			/**
 			* Create a federated scene with the given scene collections
@@ -89,7 +91,8 @@ namespace repo {
 				const bool                                    &headRevision = false,
 				const bool                                    &ignoreRefScene = false,
 				const bool                                    &skeletonFetch = false,
-				const std::vector<repo::core::model::ModelRevisionNode::UploadStatus> &includeStatus = {});
+				const std::vector<repo::core::model::ModelRevisionNode::UploadStatus> &includeStatus = {},
+				const bool                                    &referencesOnly = false);
 
 			/**
 			* Retrieve all RepoScene representations given a partially loaded scene.
@@ -276,7 +279,7 @@ namespace repo {
 				const std::string &password
 			);
 
-			std::shared_ptr<repo::core::handler::MongoDatabaseHandler> dbHandler;
+			std::shared_ptr<repo::core::handler::AbstractDatabaseHandler> dbHandler;
 		};
 	}
 }
@@ -57,9 +57,10 @@ uint8_t RepoController::commitScene(
 	const std::string                   &owner,
 	const std::string                      &tag,
 	const std::string                      &desc,
-	const repo::lib::RepoUUID           &revId)
+	const repo::lib::RepoUUID           &revId,
+	const int                           numThreads)
 {
-	return impl->commitScene(token, scene, owner, tag, desc, revId);
+	return impl->commitScene(token, scene, owner, tag, desc, revId, numThreads);
 }
 
 void RepoController::destroyToken(RepoController::RepoToken* token)
@@ -75,9 +76,10 @@ repo::core::model::RepoScene* RepoController::fetchScene(
 	const bool           &headRevision,
 	const bool           &ignoreRefScene,
 	const bool           &skeletonFetch,
-	const std::vector<repo::core::model::ModelRevisionNode::UploadStatus> &includeStatus)
+	const std::vector<repo::core::model::ModelRevisionNode::UploadStatus> &includeStatus,
+	const bool           &referencesOnly)
 {
-	return impl->fetchScene(token, database, collection, uuid, headRevision, ignoreRefScene, skeletonFetch, includeStatus);
+	return impl->fetchScene(token, database, collection, uuid, headRevision, ignoreRefScene, skeletonFetch, includeStatus, referencesOnly);
 }
 
 bool RepoController::generateAndCommitSelectionTree(
@@ -173,7 +173,8 @@ public:
 		const bool           &headRevision = true,
 		const bool           &ignoreRefScene = false,
 		const bool           &skeletonFetch = false,
-		const std::vector<repo::core::model::ModelRevisionNode::UploadStatus> &includeStatus = {});
+		const std::vector<repo::core::model::ModelRevisionNode::UploadStatus> &includeStatus = {},
+		const bool           &referencesOnly = false);
 
 	/*
 	*	------- Database Operations (insert/delete/update) ---------
@@ -184,6 +185,7 @@ public:
 	* @param token Authentication token
 	* @param scene RepoScene to commit
 	* @param owner specify the owner of the scene (by default it is the user authorised to commit)
+	* @param numThreads threads to generate the stash with (0 for the number of cores)
 	*/
 	uint8_t commitScene(
 		const RepoToken                     *token,
@@ -191,7 +193,8 @@ public:
 		const std::string                   &owner = "",
 		const std::string                      &tag = "",
 		const std::string                      &desc = "",
-		const repo::lib::RepoUUID           &revId = repo::lib::RepoUUID::createUUID());
+		const repo::lib::RepoUUID           &revId = repo::lib::RepoUUID::createUUID(),
+		const int                           numThreads = 0);
 
 	/*
 	*	------------- Logging --------------
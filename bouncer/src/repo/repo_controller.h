@@ -163,6 +163,8 @@ namespace repo {
 		* @param uuid if headRevision, uuid represents the branch id,
 		*              otherwise the unique id of the revision branch
 		* @param headRevision true if retrieving head revision
+		* @param referencesOnly only load the root, and the references with the
+		*              nodes above them (see RepoScene::loadReferencesOnly)
 		* @return returns a pointer to a repoScene.
 		*/
 		repo::core::model::RepoScene* fetchScene(
@@ -173,7 +175,8 @@ namespace repo {
 			const bool           &headRevision = true,
 			const bool           &ignoreRefScene = false,
 			const bool           &skeletonFetch = false,
-			const std::vector<repo::core::model::ModelRevisionNode::UploadStatus> &includeStatus = {});
+			const std::vector<repo::core::model::ModelRevisionNode::UploadStatus> &includeStatus = {},
+			const bool           &referencesOnly = false);
 
 		/*
 		*	------- Database Operations (insert/delete/update) ---------
@@ -184,6 +187,7 @@ namespace repo {
 		* @param token Authentication token
 		* @param scene RepoScene to commit
 		* @param owner specify the owner of the scene (by default it is the user authorised to commit)
+		* @param numThreads threads to generate the stash with (0 for the number of cores)
 		*/
 		uint8_t commitScene(
 			const RepoToken                     *token,
@@ -191,7 +195,8 @@ namespace repo {
 			const std::string                   &owner = "",
 			const std::string                      &tag = "",
 			const std::string                      &desc = "",
-			const repo::lib::RepoUUID           &revId = repo::lib::RepoUUID::createUUID());
+			const repo::lib::RepoUUID           &revId = repo::lib::RepoUUID::createUUID(),
+			const int                           numThreads = 0);
 
 		/*
 		*	------------- Logging --------------
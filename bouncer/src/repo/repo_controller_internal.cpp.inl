@@ -66,7 +66,7 @@ RepoController::RepoToken* RepoController::_RepoControllerImpl::init(
 		worker->init(errMsg, config, numDBConnections);
 		token = new RepoController::RepoToken(config);
 		auto dbConf = config.getDatabaseConfig();
-		const std::string dbFullAd = dbConf.connString.empty() ? dbConf.addr + ":" + std::to_string(dbConf.port) : dbConf.connString;
+		const std::string dbFullAd = !dbConf.path.empty() ? dbConf.path : dbConf.connString.empty() ? dbConf.addr + ":" + std::to_string(dbConf.port) : dbConf.connString;
 		repoInfo << "Successfully connected to the " << dbFullAd;
 		if (!dbConf.username.empty())
 			repoInfo << dbConf.username << " is authenticated to " << dbFullAd;
@@ -85,7 +85,8 @@ uint8_t RepoController::_RepoControllerImpl::commitScene(
 	const std::string                   &owner,
 	const std::string                      &tag,
 	const std::string                      &desc,
-	const repo::lib::RepoUUID           &revId)
+	const repo::lib::RepoUUID           &revId,
+	const int                           numThreads)
 {
 	uint8_t errCode = REPOERR_UNKNOWN_ERR;
 	if (scene)
@@ -101,7 +102,8 @@ uint8_t RepoController::_RepoControllerImpl::commitScene(
 					owner.empty() ? "ANONYMOUS USER" : owner,
 					tag,
 					desc,
-					revId);
+					revId,
+					numThreads);
 				workerPool.push(worker);
 			}
 			else
@@ -129,7 +131,8 @@ repo::core::model::RepoScene* RepoController::_RepoControllerImpl::fetchScene(
 	const bool           &headRevision,
 	const bool           &ignoreRefScene,
 	const bool           &skeletonFetch,
-	const std::vector<repo::core::model::ModelRevisionNode::UploadStatus> &includeStatus)
+	const std::vector<repo::core::model::ModelRevisionNode::UploadStatus> &includeStatus,
+	const bool           &referencesOnly)
 {
 	repo::core::model::RepoScene* scene = 0;
 	if (token)
@@ -137,7 +140,7 @@ repo::core::model::RepoScene* RepoController::_RepoControllerImpl::fetchScene(
 		manipulator::RepoManipulator* worker = workerPool.pop();
 
 		scene = worker->fetchScene(
-			database, collection, repo::lib::RepoUUID(uuid), headRevision, ignoreRefScene, skeletonFetch, includeStatus);
+			database, collection, repo::lib::RepoUUID(uuid), headRevision, ignoreRefScene, skeletonFetch, includeStatus, referencesOnly);
 
 		workerPool.push(worker);
 	}
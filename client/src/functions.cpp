@@ -249,7 +249,11 @@ bool _generateStash(
 	const bool                   isBranch,
 	const std::string& revID) {
 	repoLog("Generating stash of type " + type + " for " + dbName + "." + project + " rev: " + revID + (isBranch ? " (branch ID)" : ""));
-	auto scene = controller->fetchScene(token, dbName, project, revID, isBranch, false, type == "tree");
+
+	// Both the stash and the selection tree read the nodes they need from the
+	// database as they go, so only the references are loaded into the scene
+
+	auto scene = controller->fetchScene(token, dbName, project, revID, isBranch, false, type == "tree", {}, true);
 	bool  success = false;
 	if (scene) {
 		if (type == "repo")
@@ -386,6 +390,12 @@ int32_t importFileAndCommit(
 				config.revisionId = repo::lib::RepoUUID(revIdStr);
 			}
 			config.numThreads = jsonTree.get<int>("numThreads", config.numThreads);
+			config.instanceGeometry = jsonTree.get<bool>("instancing", config.instanceGeometry);
+			config.binarySequenceCache = jsonTree.get<bool>("binarySequence", config.binarySequenceCache);
+			config.compressGeometry = jsonTree.get<bool>("compressGeometry", config.compressGeometry);
+			config.processTextures = jsonTree.get<bool>("processTextures", config.processTextures);
+			config.maxTextureSize = jsonTree.get<int>("maxTextureSize", config.maxTextureSize);
+			config.textureMipLevels = jsonTree.get<bool>("textureMipLevels", config.textureMipLevels);
 
 			if (config.databaseName.empty() || config.projectName.empty() || fileLoc.empty())
 			{
@@ -424,7 +434,7 @@ int32_t importFileAndCommit(
 	{
 		repoLog("Trying to commit this scene to database as " + config.getDatabaseName() + "." + config.getProjectName());
 
-		err = controller->commitScene(token, graph, owner, tag, desc, config.revisionId);
+		err = controller->commitScene(token, graph, owner, tag, desc, config.revisionId, config.getNumThreads());
 
 		if (err == REPOERR_OK)
 		{
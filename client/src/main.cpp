@@ -17,6 +17,8 @@
 
 #include <repo_log.h>
 #include <repo/lib/repo_exception.h>
+#include <repo/lib/repo_memory_accounting.h>
+#include <repo/lib/repo_utils.h>
 #include "functions.h"
 #include <locale>
 
@@ -38,6 +40,21 @@ void printHelp()
 	std::cout << "REPO_DEBUG\tEnable debug logging" << std::endl;
 	std::cout << "REPO_LOG_DIR\tSpecify the log directory (default is ./log)" << std::endl;
 	std::cout << "REPO_VERBOSE\tEnable verbose logging" << std::endl;
+	std::cout << "REPO_MEMORY_BUDGET\tFail cleanly if the tracked buffers would exceed this many MB" << std::endl;
+}
+
+void setMemoryBudget()
+{
+	std::string budget = repo::lib::getEnvString("REPO_MEMORY_BUDGET");
+	if (!budget.empty()) {
+		try {
+			repo::lib::RepoMemoryAccounting::setBudget(std::stoull(budget) * 1024 * 1024);
+			repoLog("Memory budget: " + budget + "MB");
+		}
+		catch (const std::exception&) {
+			repoLogError("Ignoring invalid REPO_MEMORY_BUDGET: " + budget);
+		}
+	}
 }
 
 std::shared_ptr<repo::RepoController> instantiateController()
@@ -80,6 +97,7 @@ int main(int argc, char* argv[]) {
 	setlocale(LC_ALL, "");
 
 	std::shared_ptr<repo::RepoController> controller = instantiateController();
+	setMemoryBudget();
 	if (argc < minArgs) {
 		if (argc == 2 && isSpecialCommand(argv[1]))
 		{
@@ -120,6 +138,7 @@ int main(int argc, char* argv[]) {
 				int32_t errcode = performOperation(controller, token, op);
 
 				controller->destroyToken(token);
+				repoLog(repo::lib::RepoMemoryAccounting::printReport());
 				repoLog("Process completed, returning with error code: " + std::to_string(errcode));
 				return errcode;
 			}
@@ -131,6 +150,7 @@ int main(int argc, char* argv[]) {
 		catch (const repo::lib::RepoException &e)
 		{
 			repoError << e.printFull();
+			repoLog(repo::lib::RepoMemoryAccounting::printReport());
 			return e.repoCode();
 		}
 		catch (const std::exception& e) // We expect all exceptions to be nested inside a RepoException, so this is only really a last ditch fallback
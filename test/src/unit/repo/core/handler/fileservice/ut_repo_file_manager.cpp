@@ -21,10 +21,39 @@
 
 #include <repo/lib/repo_exception.h>
 #include <repo/lib/repo_utils.h>
+#include <boost/filesystem.hpp>
 #include "../../../../repo_test_fileservice_info.h"
 
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
 using namespace repo::core::handler::fileservice;
 
+static size_t getPeakMemoryUsage()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+		return counters.PeakWorkingSetSize;
+	}
+	return 0;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage)) {
+		return 0;
+	}
+#ifdef __APPLE__
+	return usage.ru_maxrss;
+#else
+	return usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
 TEST(FileManager, InstantiateManager)
 {
 	auto empty = std::weak_ptr<repo::core::handler::AbstractDatabaseHandler>();
@@ -110,4 +139,98 @@ TEST(FileManager, deleteFileAndRef)
 
 	// Deleting a file a second time should not do anything, but not throw either
 	EXPECT_FALSE(manager->deleteFileAndRef(db, col, fileName));
-}
\ No newline at end of file
+}
+
+TEST(FileManager, FileStream)
+{
+	auto handler = getHandler();
+	auto manager = handler->getFileManager();
+	auto db = "testFileManager";
+	std::string col = "fileStream";
+
+	std::string expected;
+	for (int i = 0; i < 10000; i++) {
+		expected += "<path d=\"M " + std::to_string(i) + " 0 L 10 10\"/>\n";
+	}
+
+	// Small chunks so the contents are written out over several flushes
+
+	for (auto encoding : { FileManager::Encoding::None, FileManager::Encoding::Gzip }) {
+		auto id = repo::lib::RepoUUID::createUUID();
+		auto file = manager->createFileStream(db, col, encoding, 4096);
+		file->stream() << expected;
+		EXPECT_TRUE(manager->commitFileStream(*file, id));
+
+		auto actual = manager->getFile(db, col, id, encoding);
+		EXPECT_EQ(std::string(actual.begin(), actual.end()), expected);
+
+		auto ref = manager->getFileRef(db, col, id);
+		if (encoding == FileManager::Encoding::Gzip) {
+			EXPECT_LT(ref.getFileSize(), expected.size());
+		}
+		else {
+			EXPECT_EQ(ref.getFileSize(), expected.size());
+		}
+	}
+}
+
+TEST(FileManager, FileStreamPeakMemory)
+{
+	// Streams a synthetic svg of several hundred MB, in the style of a dense
+	// sheet, into the store. As the file is compressed and written in chunks,
+	// the peak memory of the process should not grow by anything near the size
+	// of the file. (The peak is the high-water mark of the whole process, so
+	// this can only detect a regression if no earlier test used more.)
+
+	// The file is written to its own directory under the temp path, rather than
+	// the test file share, and the directory is removed when the test ends.
+
+	auto dir = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("fileStreamPeakMemory%%%%%%%%");
+	boost::filesystem::create_directories(dir);
+	struct RemoveDirectory
+	{
+		boost::filesystem::path path;
+		~RemoveDirectory()
+		{
+			boost::system::error_code ec;
+			boost::filesystem::remove_all(path, ec);
+		}
+	} removeDirectory{ dir };
+
+	auto config = getConfig();
+	config.configureFS(dir.string());
+	auto handler = getHandler();
+	auto manager = std::make_shared<FileManager>(config, handler);
+	auto db = "testFileManager";
+	std::string col = "fileStream";
+
+	const size_t size = 300 * 1024 * 1024;
+
+	auto before = getPeakMemoryUsage();
+
+	auto id = repo::lib::RepoUUID::createUUID();
+	auto file = manager->createFileStream(db, col, FileManager::Encoding::Gzip);
+	file->stream() << "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"1024\" height=\"768\" viewBox=\"0 0 1024 768\">\n";
+
+	size_t written = 0;
+	uint32_t seed = 1;
+	std::string line;
+	while (written < size) {
+		seed = seed * 1664525 + 1013904223;
+		line = "<path d=\"M " + std::to_string(seed % 1024) + " " + std::to_string((seed >> 10) % 768) +
+			" L " + std::to_string((seed >> 5) % 1024) + " " + std::to_string((seed >> 15) % 768) +
+			"\" stroke=\"rgb(0,0,0)\" stroke-width=\"0.08\"/>\n";
+		file->stream() << line;
+		written += line.size();
+	}
+	file->stream() << "</svg>\n";
+
+	EXPECT_TRUE(manager->commitFileStream(*file, id));
+
+	auto after = getPeakMemoryUsage();
+	EXPECT_LT(after - before, size / 4);
+
+	auto ref = manager->getFileRef(db, col, id);
+	EXPECT_GT(ref.getFileSize(), 0);
+	EXPECT_LT(ref.getFileSize(), written);
+}
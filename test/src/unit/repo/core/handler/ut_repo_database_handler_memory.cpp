@@ -0,0 +1,463 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <repo/core/handler/repo_database_handler_memory.h>
+#include <repo/core/handler/database/repo_query.h>
+#include <repo/core/handler/database/repo_bulk_upsert_context.h>
+#include <repo/core/handler/fileservice/repo_file_manager.h>
+#include <repo/core/model/bson/repo_bson.h>
+#include <repo/core/model/bson/repo_bson_builder.h>
+#include <repo/core/model/repo_model_global.h>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest-matchers.h>
+#include "../../../repo_test_utils.h"
+#include "../../../repo_test_database_info.h"
+
+#include <boost/filesystem.hpp>
+
+using namespace repo::core::handler;
+using namespace repo::core::handler::database;
+using namespace testing;
+
+static const std::string DB = "testMemoryDatabaseHandler";
+static const std::string COL = "collection";
+
+static repo::core::model::RepoBSON makeDocument(int i)
+{
+	repo::core::model::RepoBSONBuilder builder;
+	builder.append(REPO_LABEL_ID, "doc" + std::to_string(i));
+	builder.append("counter", i);
+	builder.append("parity", i % 2 ? std::string("odd") : std::string("even"));
+	builder.append("tags", std::vector<std::string>({ "tag" + std::to_string(i % 3), "all" }));
+	if (i % 4 == 0) {
+		builder.append("optional", true);
+	}
+	return builder.obj();
+}
+
+static std::vector<std::string> getIds(const std::vector<repo::core::model::RepoBSON>& documents)
+{
+	std::vector<std::string> ids;
+	for (auto& d : documents) {
+		ids.push_back(d.getStringField(REPO_LABEL_ID));
+	}
+	return ids;
+}
+
+static std::shared_ptr<MemoryDatabaseHandler> getPopulatedHandler()
+{
+	auto handler = getMemoryHandler(DB);
+	for (int i = 0; i < 10; i++) {
+		handler->insertDocument(DB, COL, makeDocument(i));
+	}
+	return handler;
+}
+
+TEST(MemoryDatabaseHandlerTest, InsertDocument)
+{
+	auto handler = getMemoryHandler(DB);
+
+	auto id = repo::lib::RepoUUID::createUUID();
+	repo::core::model::RepoBSONBuilder builder;
+	builder.append(REPO_LABEL_ID, id);
+	builder.append("myField", "myValue");
+	auto bson = builder.obj();
+
+	handler->insertDocument(DB, COL, bson);
+
+	EXPECT_THAT(handler->findOneByUniqueID(DB, COL, id), Eq(bson));
+	EXPECT_THAT(handler->getCollections(DB), ElementsAre(COL));
+
+	// Duplicate ids are rejected, as are invalid names
+	EXPECT_THROW(handler->insertDocument(DB, COL, bson), repo::lib::RepoException);
+	EXPECT_THROW(handler->insertDocument("", COL, bson), repo::lib::RepoException);
+	EXPECT_THROW(handler->insertDocument(DB, "", bson), repo::lib::RepoException);
+}
+
+TEST(MemoryDatabaseHandlerTest, FindAllByCriteria)
+{
+	auto handler = getPopulatedHandler();
+
+	EXPECT_THAT(getIds(handler->findAllByCriteria(DB, COL, query::Eq("parity", std::string("odd")))),
+		ElementsAre("doc1", "doc3", "doc5", "doc7", "doc9"));
+
+	// Multiple values match any of them
+	EXPECT_THAT(getIds(handler->findAllByCriteria(DB, COL, query::Eq("counter", std::vector<int>({ 2, 4, 100 })))),
+		ElementsAre("doc2", "doc4"));
+
+	// Arrays match if any element matches
+	EXPECT_THAT(getIds(handler->findAllByCriteria(DB, COL, query::Eq("tags", std::string("tag1")))),
+		ElementsAre("doc1", "doc4", "doc7"));
+
+	// Numbers match regardless of their type
+	EXPECT_THAT(getIds(handler->findAllByCriteria(DB, COL, query::Eq("counter", (int64_t)3))), ElementsAre("doc3"));
+
+	EXPECT_THAT(getIds(handler->findAllByCriteria(DB, COL, query::Exists("optional", true))),
+		ElementsAre("doc0", "doc4", "doc8"));
+	EXPECT_THAT(handler->findAllByCriteria(DB, COL, query::Exists("optional", false)).size(), Eq(7));
+
+	EXPECT_THAT(getIds(handler->findAllByCriteria(DB, COL, query::Or(query::Eq("counter", 1), query::Eq("counter", 2)))),
+		ElementsAre("doc1", "doc2"));
+
+	query::RepoQueryBuilder conjunction;
+	conjunction.append(query::Eq("parity", std::string("even")));
+	conjunction.append(query::Exists("optional", true));
+	conjunction.append(query::Eq("tags", std::string("tag2")));
+	EXPECT_THAT(getIds(handler->findAllByCriteria(DB, COL, conjunction)), ElementsAre("doc8"));
+
+	// As with MongoDatabaseHandler, empty filters and invalid names return nothing
+	EXPECT_THAT(handler->findAllByCriteria(DB, COL, query::RepoQueryBuilder()), IsEmpty());
+	EXPECT_THAT(handler->findAllByCriteria("", COL, query::Eq("counter", 1)), IsEmpty());
+	EXPECT_THAT(handler->findAllByCriteria(DB, "", query::Eq("counter", 1)), IsEmpty());
+	EXPECT_THAT(handler->findCursorByCriteria(DB, COL, query::RepoQueryBuilder()), IsNull());
+
+	EXPECT_THAT(handler->count(DB, COL, query::Eq("parity", std::string("even"))), Eq(5));
+}
+
+TEST(MemoryDatabaseHandlerTest, CreateIndex)
+{
+	// Indexes should never change the results of a query, including after
+	// the documents they cover are updated or removed
+
+	auto handler = getPopulatedHandler();
+	auto filter = query::Eq("tags", std::string("tag0"));
+
+	auto expected = getIds(handler->findAllByCriteria(DB, COL, filter));
+	EXPECT_THAT(expected, ElementsAre("doc0", "doc3", "doc6", "doc9"));
+
+	handler->createIndex(DB, COL, index::Ascending({ "tags" }));
+	EXPECT_THAT(getIds(handler->findAllByCriteria(DB, COL, filter)), Eq(expected));
+
+	repo::core::model::RepoBSONBuilder builder;
+	builder.append(REPO_LABEL_ID, "doc3");
+	builder.append("tags", std::vector<std::string>({ "none" }));
+	handler->upsertDocument(DB, COL, builder.obj(), true);
+	handler->dropDocument(makeDocument(6), DB, COL);
+	handler->insertDocument(DB, COL, makeDocument(12));
+
+	EXPECT_THAT(getIds(handler->findAllByCriteria(DB, COL, filter)), ElementsAre("doc0", "doc9", "doc12"));
+}
+
+TEST(MemoryDatabaseHandlerTest, EmptyEqWithIndex)
+{
+	// Empty Eq expressions are ignored, as they are by Mongo, whether or not
+	// the field (or the id) is indexed
+
+	auto handler = getPopulatedHandler();
+
+	query::RepoQueryBuilder filter;
+	filter.append(query::Eq("tags", std::vector<std::string>()));
+	filter.append(query::Eq("parity", std::string("odd")));
+
+	query::RepoQueryBuilder byId;
+	byId.append(query::Eq(REPO_LABEL_ID, std::vector<std::string>()));
+	byId.append(query::Eq("parity", std::string("odd")));
+
+	auto expected = getIds(handler->findAllByCriteria(DB, COL, filter));
+	EXPECT_THAT(expected, ElementsAre("doc1", "doc3", "doc5", "doc7", "doc9"));
+	EXPECT_THAT(getIds(handler->findAllByCriteria(DB, COL, byId)), Eq(expected));
+
+	handler->createIndex(DB, COL, index::Ascending({ "tags" }));
+	EXPECT_THAT(getIds(handler->findAllByCriteria(DB, COL, filter)), Eq(expected));
+	EXPECT_THAT(getIds(handler->findAllByCriteria(DB, COL, byId)), Eq(expected));
+}
+
+TEST(MemoryDatabaseHandlerTest, Projection)
+{
+	auto handler = getPopulatedHandler();
+
+	query::RepoProjectionBuilder include;
+	include.includeField("counter");
+	auto doc = handler->findAllByCriteria(DB, COL, query::Eq(REPO_LABEL_ID, std::string("doc4")), include)[0];
+	EXPECT_THAT(doc.getFieldNames(), UnorderedElementsAre(REPO_LABEL_ID, "counter"));
+
+	query::RepoProjectionBuilder exclude;
+	exclude.excludeField("tags");
+	exclude.excludeField(REPO_LABEL_ID);
+	doc = handler->findAllByCriteria(DB, COL, query::Eq(REPO_LABEL_ID, std::string("doc4")), exclude)[0];
+	EXPECT_THAT(doc.getFieldNames(), UnorderedElementsAre("counter", "parity", "optional"));
+
+	std::vector<std::string> ids;
+	auto cursor = handler->findCursorByCriteria(DB, COL, query::Eq("parity", std::string("odd")), include);
+	for (auto d : (*cursor)) {
+		EXPECT_THAT(d.getFieldNames().size(), Eq(2));
+		ids.push_back(d.getStringField(REPO_LABEL_ID));
+	}
+	EXPECT_THAT(ids, ElementsAre("doc1", "doc3", "doc5", "doc7", "doc9"));
+}
+
+TEST(MemoryDatabaseHandlerTest, FindOneByCriteria)
+{
+	auto handler = getPopulatedHandler();
+
+	// The sort is descending, so this should return the highest counter
+	auto doc = handler->findOneByCriteria(DB, COL, query::Eq("parity", std::string("even")), "counter");
+	EXPECT_THAT(doc.getStringField(REPO_LABEL_ID), Eq("doc8"));
+
+	EXPECT_TRUE(handler->findOneByCriteria(DB, COL, query::Eq("parity", std::string("none"))).isEmpty());
+
+	auto all = handler->getAllFromCollectionTailable(DB, COL, 2, 3, {}, "counter", 1);
+	EXPECT_THAT(getIds(all), ElementsAre("doc2", "doc3", "doc4"));
+}
+
+TEST(MemoryDatabaseHandlerTest, UpsertDocument)
+{
+	auto handler = getMemoryHandler(DB);
+
+	auto id = repo::lib::RepoUUID::createUUID();
+
+	repo::core::model::RepoBSONBuilder builder;
+	builder.append(REPO_LABEL_ID, id);
+	builder.append("field1", "myString");
+	builder.append("field2", 0);
+	handler->insertDocument(DB, COL, builder.obj());
+
+	auto auuid = repo::lib::RepoUUID::createUUID();
+
+	repo::core::model::RepoBSONBuilder updateBuilder;
+	updateBuilder.append(REPO_LABEL_ID, id);
+	updateBuilder.append("field2", 123);
+	updateBuilder.append("field3", auuid);
+	auto update = updateBuilder.obj();
+
+	handler->upsertDocument(DB, COL, update, false);
+
+	repo::core::model::RepoBSONBuilder expectedBuilder;
+	expectedBuilder.append(REPO_LABEL_ID, id);
+	expectedBuilder.append("field1", "myString");
+	expectedBuilder.append("field2", 123);
+	expectedBuilder.append("field3", auuid);
+
+	EXPECT_THAT(handler->getAllFromCollectionTailable(DB, COL), ElementsAre(expectedBuilder.obj()));
+
+	handler->upsertDocument(DB, COL, update, true);
+	EXPECT_THAT(handler->getAllFromCollectionTailable(DB, COL), ElementsAre(update));
+
+	repo::core::model::RepoBSONBuilder binaryBuilder;
+	binaryBuilder.appendLargeArray("bin", testing::makeRandomBinary());
+	EXPECT_THROW(handler->upsertDocument(DB, COL, binaryBuilder.obj(), false), repo::lib::RepoException);
+}
+
+TEST(MemoryDatabaseHandlerTest, DropDocument)
+{
+	auto handler = getPopulatedHandler();
+
+	handler->dropDocument(makeDocument(3), DB, COL);
+	handler->dropDocument(makeDocument(3), DB, COL); // Dropping twice is a noop
+
+	EXPECT_THAT(handler->count(DB, COL, query::Exists(REPO_LABEL_ID, true)), Eq(9));
+	EXPECT_THAT(handler->findAllByCriteria(DB, COL, query::Eq(REPO_LABEL_ID, std::string("doc3"))), IsEmpty());
+
+	EXPECT_THROW(handler->dropDocument(repo::core::model::RepoBSON(), DB, COL), repo::lib::RepoException);
+
+	handler->dropCollection(DB, COL);
+	EXPECT_THAT(handler->getCollections(DB), IsEmpty());
+}
+
+TEST(MemoryDatabaseHandlerTest, BulkWriteContext)
+{
+	auto handler = getMemoryHandler(DB);
+
+	auto parent1 = repo::lib::RepoUUID::createUUID();
+	auto parent2 = repo::lib::RepoUUID::createUUID();
+	auto id = repo::lib::RepoUUID::createUUID();
+
+	{
+		auto context = handler->getBulkWriteContext(DB, COL);
+
+		repo::core::model::RepoBSONBuilder builder;
+		builder.append(REPO_LABEL_ID, id);
+		builder.append(REPO_NODE_LABEL_PARENTS, std::vector<repo::lib::RepoUUID>({ parent1 }));
+		builder.appendLargeArray("bin", testing::makeRandomBinary());
+		context->insertDocument(builder.obj());
+
+		context->updateDocument(query::AddParent(id, std::vector<repo::lib::RepoUUID>({ parent1, parent2 })));
+	}
+
+	auto doc = handler->findOneByUniqueID(DB, COL, id);
+	EXPECT_THAT(doc.getUUIDFieldArray(REPO_NODE_LABEL_PARENTS), UnorderedElementsAre(parent1, parent2));
+	EXPECT_TRUE(doc.hasFileReference());
+}
+
+TEST(MemoryDatabaseHandlerTest, BulkUpsertContext)
+{
+	auto handler = getPopulatedHandler();
+
+	auto getCounter = [&](int i) {
+		return handler->findOneByCriteria(DB, COL, query::Eq(REPO_LABEL_ID, "doc" + std::to_string(i))).getIntField("counter");
+	};
+
+	auto makeUpdate = [](int i) {
+		repo::core::model::RepoBSONBuilder builder;
+		builder.append(REPO_LABEL_ID, "doc" + std::to_string(i));
+		builder.append("counter", i + 100);
+		return builder.obj();
+	};
+
+	repo::core::model::RepoBSONBuilder invalidBuilder;
+	invalidBuilder.append("counter", -1);
+	auto invalid = invalidBuilder.obj();
+
+	{
+		BulkUpsertContext context(handler.get(), DB, COL, false, 16 * 1024 * 1024, 4);
+
+		// Nothing should be written until a batch is full
+
+		for (int i = 0; i < 3; i++) {
+			context.upsertDocument(makeUpdate(i));
+		}
+		EXPECT_THAT(context.getNumBatches(), Eq(0));
+		EXPECT_THAT(getCounter(0), Eq(0));
+
+		context.upsertDocument(invalid);
+		EXPECT_THAT(context.getNumBatches(), Eq(1));
+		EXPECT_THAT(getCounter(0), Eq(100));
+		EXPECT_THAT(getCounter(2), Eq(102));
+
+		// Existing documents are updated and new ones inserted, in the same batch
+
+		context.upsertDocument(makeUpdate(5));
+		context.upsertDocument(makeUpdate(12));
+		EXPECT_THAT(getCounter(5), Eq(5));
+
+		context.flush();
+		EXPECT_THAT(context.getNumBatches(), Eq(2));
+		EXPECT_THAT(getCounter(5), Eq(105));
+		EXPECT_THAT(getCounter(12), Eq(112));
+
+		// The failing document should not have prevented the others in its batch
+
+		ASSERT_THAT(context.getFailures().size(), Eq(1));
+		EXPECT_THAT(context.getFailures()[0].document, Eq(invalid));
+		EXPECT_THAT(context.getFailures()[0].message, Not(IsEmpty()));
+
+		context.upsertDocument(makeUpdate(13));
+	}
+
+	// Outstanding documents are written when the context is destroyed
+
+	EXPECT_THAT(getCounter(13), Eq(113));
+	EXPECT_THAT(handler->count(DB, COL, query::Exists(REPO_LABEL_ID, true)), Eq(12));
+
+	// Updates keep the fields of the existing document that are not replaced
+
+	auto doc = handler->findOneByCriteria(DB, COL, query::Eq(REPO_LABEL_ID, std::string("doc1")));
+	EXPECT_THAT(doc.getStringField("parity"), Eq("odd"));
+}
+
+TEST(MemoryDatabaseHandlerTest, InsertManyDocumentsBinary)
+{
+	auto handler = getMemoryHandler(DB);
+
+	std::vector<repo::core::model::RepoBSON> documents;
+	for (size_t i = 0; i < 10; i++)
+	{
+		repo::core::model::RepoBSONBuilder builder;
+		builder.append(REPO_LABEL_ID, repo::lib::RepoUUID::createUUID());
+		builder.appendLargeArray("bin", testing::makeRandomBinary(1000 * (i + 1)));
+		documents.push_back(builder.obj());
+	}
+
+	handler->insertManyDocuments(DB, COL, documents);
+
+	auto actual = handler->findAllByCriteria(DB, COL, query::Exists(REPO_LABEL_ID, true), true);
+	ASSERT_THAT(actual.size(), Eq(documents.size()));
+	for (size_t i = 0; i < documents.size(); i++)
+	{
+		EXPECT_THAT(actual[i].getBinariesAsBuffer().second, Eq(documents[i].getBinariesAsBuffer().second));
+	}
+
+	// Without a FileManager, documents with binaries cannot be stored
+
+	auto noFiles = MemoryDatabaseHandler::getHandler();
+	EXPECT_THROW(noFiles->insertManyDocuments(DB, COL, documents), repo::lib::RepoException);
+}
+
+TEST(MemoryDatabaseHandlerTest, DeduplicateBinaries)
+{
+	auto handler = getMemoryHandler(DB);
+
+	// Documents with identical binaries (such as instances of the same geometry)
+	// should refer to the same data in the blob files, but only when requested
+
+	auto shared = testing::makeRandomBinary(5000);
+
+	std::vector<repo::core::model::RepoBSON> documents;
+	for (size_t i = 0; i < 3; i++)
+	{
+		repo::core::model::RepoBSONBuilder builder;
+		builder.append(REPO_LABEL_ID, repo::lib::RepoUUID::createUUID());
+		builder.appendLargeArray("bin", shared);
+		documents.push_back(builder.obj());
+	}
+
+	repo::core::model::RepoBSONBuilder builder;
+	builder.append(REPO_LABEL_ID, repo::lib::RepoUUID::createUUID());
+	builder.appendLargeArray("bin", testing::makeRandomBinary(5000));
+	documents.push_back(builder.obj());
+
+	handler->insertManyDocuments(DB, COL, documents);
+
+	auto actual = handler->findAllByCriteria(DB, COL, query::Exists(REPO_LABEL_ID, true));
+	ASSERT_THAT(actual.size(), Eq(documents.size()));
+	EXPECT_FALSE(actual[1].getBinaryReference() == actual[0].getBinaryReference());
+	EXPECT_FALSE(actual[2].getBinaryReference() == actual[0].getBinaryReference());
+
+	{
+		auto context = handler->getBulkWriteContext(DB, COL + "Deduplicated");
+		context->setDeduplicateBinaries(true);
+		for (auto& document : documents) {
+			context->insertDocument(document);
+		}
+	}
+
+	actual = handler->findAllByCriteria(DB, COL + "Deduplicated", query::Exists(REPO_LABEL_ID, true));
+	ASSERT_THAT(actual.size(), Eq(documents.size()));
+	EXPECT_THAT(actual[1].getBinaryReference(), Eq(actual[0].getBinaryReference()));
+	EXPECT_THAT(actual[2].getBinaryReference(), Eq(actual[0].getBinaryReference()));
+	EXPECT_FALSE(actual[3].getBinaryReference() == actual[0].getBinaryReference());
+
+	auto loaded = handler->findAllByCriteria(DB, COL + "Deduplicated", query::Exists(REPO_LABEL_ID, true), true);
+	for (size_t i = 0; i < documents.size(); i++)
+	{
+		EXPECT_THAT(loaded[i].getBinariesAsBuffer().second, Eq(documents[i].getBinariesAsBuffer().second));
+	}
+}
+
+TEST(MemoryDatabaseHandlerTest, Persistence)
+{
+	auto path = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("%%%%%%%%.db")).string();
+
+	{
+		auto handler = getMemoryHandler(DB, path);
+		for (int i = 0; i < 10; i++) {
+			handler->insertDocument(DB, COL, makeDocument(i));
+		}
+		handler->createIndex(DB, COL, index::Ascending({ "counter" }));
+	}
+
+	{
+		auto handler = getMemoryHandler(DB, path);
+		EXPECT_THAT(handler->getCollections(DB), ElementsAre(COL));
+		EXPECT_THAT(handler->findOneByUniqueID(DB, COL, std::string("doc5")), Eq(makeDocument(5)));
+		EXPECT_THAT(getIds(handler->findAllByCriteria(DB, COL, query::Eq("counter", 7))), ElementsAre("doc7"));
+	}
+
+	boost::filesystem::remove(path);
+}
@@ -278,6 +278,47 @@ TEST(RepoBSONBuilderTest, AppendRepoVariant)
 	EXPECT_THAT(bson.getUUIDField("vUUID"), Eq(boost::get<repo::lib::RepoUUID>(vUUID)));
 }
 
+TEST(RepoBSONBuilderTest, AppendRepoCompactVariant)
+{
+	// Compact variants should produce the same fields as the equivalent
+	// RepoVariants, and read back to the same values
+
+	std::vector<repo::lib::RepoVariant> variants = {
+		false,
+		10,
+		(int64_t)101LL,
+		99.99,
+		std::string("string"),
+		std::string(""),
+		getRandomTm(),
+		repo::lib::RepoUUID::createUUID()
+	};
+
+	RepoBSONBuilder expected;
+	RepoBSONBuilder actual;
+	for (size_t i = 0; i < variants.size(); i++) {
+		auto label = "v" + std::to_string(i);
+		expected.appendRepoVariant(label, variants[i]);
+		actual.appendRepoVariant(label, repo::lib::RepoCompactVariant::fromRepoVariant(variants[i]));
+	}
+
+	RepoBSON a(actual.obj());
+	RepoBSON e(expected.obj());
+	EXPECT_THAT(a.toString(), Eq(e.toString()));
+
+	for (size_t i = 0; i < variants.size(); i++) {
+		auto label = "v" + std::to_string(i);
+		EXPECT_THAT(a.getField(label).repoCompactVariant(), Eq(repo::lib::RepoCompactVariant::fromRepoVariant(variants[i])));
+	}
+
+	RepoBSONBuilder builder;
+	builder.appendRepoVariant("empty", repo::lib::RepoCompactVariant());
+	builder.appendRepoVariant("ms", repo::lib::RepoTimestamp{ 1234567890123 });
+	RepoBSON bson(builder.obj());
+	EXPECT_THAT(bson.getField("empty").repoCompactVariant().isEmpty(), IsTrue());
+	EXPECT_THAT(bson.getField("ms").repoCompactVariant(), Eq(repo::lib::RepoCompactVariant(repo::lib::RepoTimestamp{ 1234567890123 })));
+}
+
 TEST(RepoBSONBuilderTest, AppendLargeArray)
 {
 	RepoBSONBuilder builder;
@@ -139,4 +139,15 @@ TEST(RepoSequenceTest, Revision)
 	EXPECT_THAT(((RepoBSON)sequence).hasField(REPO_SEQUENCE_LABEL_NAME), IsTrue());
 	EXPECT_THAT(((RepoBSON)sequence).getLongField(REPO_SEQUENCE_LABEL_START_DATE), Eq(0LL));
 	EXPECT_THAT(((RepoBSON)sequence).getLongField(REPO_SEQUENCE_LABEL_END_DATE), Eq(0LL));
-}
\ No newline at end of file
+}
+
+TEST(RepoSequenceTest, CacheIndex)
+{
+	RepoSequence sequence;
+
+	EXPECT_THAT(((RepoBSON)sequence).hasField(REPO_SEQUENCE_LABEL_CACHE), IsFalse());
+
+	auto index = repo::lib::RepoUUID::createUUID().toString();
+	sequence.setCacheIndex(index);
+	EXPECT_THAT(((RepoBSON)sequence).getStringField(REPO_SEQUENCE_LABEL_CACHE), Eq(index));
+}
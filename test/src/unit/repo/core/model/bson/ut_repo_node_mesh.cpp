@@ -15,6 +15,7 @@
 *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
 #include <cstdlib>
 
 #include <gtest/gtest.h>
@@ -24,6 +25,7 @@
 #include <repo/core/model/bson/repo_node_mesh.h>
 #include <repo/core/model/bson/repo_bson_builder.h>
 #include <repo/core/model/bson/repo_bson_factory.h>
+#include <repo/lib/repo_exception.h>
 
 #include "../../../../repo_test_utils.h"
 #include "../../../../repo_test_mesh_utils.h"
@@ -187,6 +189,53 @@ TEST(MeshNodeTest, Serialise)
 	EXPECT_FALSE(((RepoBSON)nodeNoUv).getObjectField(REPO_FILTER_OBJECT_NAME).hasField(REPO_FILTER_PROP_TEXTURE_ID));
 }
 
+TEST(MeshNodeTest, SerialiseEncoded)
+{
+	auto node = makeMeshNode(mesh_data(true, true, 1, 3, true, 2, 1000, "grouping"));
+	node.updateBoundingBox();
+
+	// With the codec the geometry is held in its own fields, so older readers
+	// will not mistake the streams for raw buffers, but the node read back
+	// should have the same geometry to within the quantisation error
+
+	auto raw = (RepoBSON)node;
+	EXPECT_THAT(raw.hasField(REPO_NODE_MESH_LABEL_GEOMETRY_CODEC), IsFalse());
+	EXPECT_THAT(raw.hasBinField(REPO_NODE_MESH_LABEL_ENCODED_VERTICES), IsFalse());
+
+	repo::lib::RepoMeshCodec::Options options;
+	options.grid = node.getBoundingBox();
+	node.setGeometryCodec(options);
+	auto encoded = (RepoBSON)node;
+	EXPECT_THAT(encoded.getIntField(REPO_NODE_MESH_LABEL_GEOMETRY_CODEC), Eq(repo::lib::RepoMeshCodec::VERSION));
+	EXPECT_THAT(encoded.getIntField(REPO_NODE_MESH_LABEL_VERTICES_COUNT), Eq(node.getNumVertices()));
+	EXPECT_THAT(encoded.getIntField(REPO_NODE_MESH_LABEL_FACES_COUNT), Eq(node.getNumFaces()));
+	EXPECT_THAT(encoded.hasBinField(REPO_NODE_MESH_LABEL_VERTICES), IsFalse());
+	EXPECT_THAT(encoded.hasBinField(REPO_NODE_MESH_LABEL_NORMALS), IsFalse());
+	EXPECT_THAT(encoded.hasBinField(REPO_NODE_MESH_LABEL_FACES), IsFalse());
+	EXPECT_THAT(encoded.hasBinField(REPO_NODE_MESH_LABEL_UV_CHANNELS), IsFalse());
+	EXPECT_THAT(encoded.hasBinField(REPO_NODE_MESH_LABEL_ENCODED_UV_CHANNELS), IsTrue());
+	EXPECT_THAT(encoded.getBinary(REPO_NODE_MESH_LABEL_ENCODED_VERTICES).size(), Lt(raw.getBinary(REPO_NODE_MESH_LABEL_VERTICES).size()));
+	EXPECT_THAT(encoded.getBinary(REPO_NODE_MESH_LABEL_ENCODED_NORMALS).size(), Lt(raw.getBinary(REPO_NODE_MESH_LABEL_NORMALS).size()));
+	EXPECT_THAT(encoded.getBinary(REPO_NODE_MESH_LABEL_ENCODED_FACES).size(), Lt(raw.getBinary(REPO_NODE_MESH_LABEL_FACES).size()));
+
+	MeshNode decoded(encoded);
+	EXPECT_THAT(decoded.getFaces(), ElementsAreArray(node.getFaces()));
+	EXPECT_THAT(decoded.getUVChannelsSeparated(), ElementsAreArray(node.getUVChannelsSeparated()));
+	ASSERT_THAT(decoded.getNumVertices(), Eq(node.getNumVertices()));
+	auto size = options.grid->size();
+	auto step = std::max({ size.x, size.y, size.z }) / ((1 << options.positionBits) - 1);
+	for (size_t i = 0; i < node.getNumVertices(); i++) {
+		EXPECT_THAT((decoded.getVertices()[i] - node.getVertices()[i]).norm(), Le(step + 1e-4));
+		EXPECT_THAT(decoded.getNormals()[i].dotProduct(node.getNormals()[i]), Gt(0.9999f));
+	}
+
+	// Meshes encoded with a later version of the codec cannot be read
+
+	RepoBSONBuilder builder;
+	builder.append(REPO_NODE_MESH_LABEL_GEOMETRY_CODEC, repo::lib::RepoMeshCodec::VERSION + 1);
+	EXPECT_THROW(MeshNode(builder.obj()), repo::lib::RepoException);
+}
+
 TEST(MeshNodeTest, TypeTest)
 {
 	MeshNode node;
@@ -641,4 +690,57 @@ TEST(MeshNodeTest, CopyConstructor)
 
 	e.setFaces(makeFaces(MeshNode::Primitive::TRIANGLES));
 	EXPECT_THAT(a.sEqual(e), IsFalse());
-}
\ No newline at end of file
+}
+
+TEST(MeshNodeTest, SHA256)
+{
+	// The digest should depend on the content of the mesh only, and not its ids
+
+	auto a = makeDeterministicMeshNode(3, true, 2);
+	auto b = a;
+	b.setUniqueID(repo::lib::RepoUUID::createUUID());
+	b.setSharedID(repo::lib::RepoUUID::createUUID());
+	b.addParent(repo::lib::RepoUUID::createUUID());
+	EXPECT_THAT(a.getSHA256(), Eq(b.getSHA256()));
+	EXPECT_THAT(a.getSHA256().size(), Eq(64));
+
+	EXPECT_THAT(((RepoBSON)a).getStringField(REPO_NODE_MESH_LABEL_SHA256), Eq(a.getSHA256()));
+
+	b.setFaces(makeFaces(MeshNode::Primitive::TRIANGLES));
+	EXPECT_THAT(a.getSHA256(), Ne(b.getSHA256()));
+
+	auto c = a;
+	auto vertices = c.getVertices();
+	vertices[0].x += 1;
+	c.setVertices(vertices);
+	EXPECT_THAT(a.getSHA256(), Ne(c.getSHA256()));
+
+	auto d = a;
+	auto material = repo::lib::repo_material_t::DefaultMaterial();
+	material.diffuse = { 1, 0, 0 };
+	d.setMaterial(material);
+	EXPECT_THAT(a.getSHA256(), Ne(d.getSHA256()));
+
+	auto e = a;
+	e.setGrouping("group");
+	EXPECT_THAT(a.getSHA256(), Ne(e.getSHA256()));
+
+	// The digest is cached, so the copies above start with the digest of a;
+	// every change to the geometry must replace it
+
+	auto f = a;
+	f.applyTransformation(repo::lib::RepoMatrix::translate(repo::lib::RepoVector3D(1, 0, 0)));
+	EXPECT_THAT(a.getSHA256(), Ne(f.getSHA256()));
+
+	auto g = a;
+	auto normals = g.getNormals();
+	normals[0].x += 1;
+	g.setNormals(normals);
+	EXPECT_THAT(a.getSHA256(), Ne(g.getSHA256()));
+
+	auto h = a;
+	auto uvs = h.getUVChannelsSeparated()[0];
+	uvs[0].x += 1;
+	h.setUVChannel(0, uvs);
+	EXPECT_THAT(a.getSHA256(), Ne(h.getSHA256()));
+}
@@ -292,4 +292,57 @@ TEST(MetaNodeTest, EmptyValues)
 	auto& value = metadata["myKey"];
 
 	EXPECT_THAT(value, Eq(repo::lib::RepoVariant(std::string(""))));
-}
\ No newline at end of file
+}
+TEST(MetaNodeTest, CompactStorage)
+{
+	// Values are held as RepoCompactVariants, with dates as timestamps, and
+	// written to and read back from BSON without changing their types
+
+	tm date = {};
+	date.tm_year = 124;
+	date.tm_mon = 2;
+	date.tm_mday = 14;
+	date.tm_isdst = -1;
+
+	auto uuid = repo::lib::RepoUUID::createUUID();
+
+	MetadataNode node;
+	node.setMetadata({
+		{ "bool", repo::lib::RepoVariant(true) },
+		{ "int", repo::lib::RepoVariant(3) },
+		{ "long", repo::lib::RepoVariant((int64_t)1 << 40) },
+		{ "double", repo::lib::RepoVariant(2.5) },
+		{ "string", repo::lib::RepoVariant(std::string("value")) },
+		{ "date", repo::lib::RepoVariant(date) },
+		{ "uuid", repo::lib::RepoVariant(uuid) },
+	});
+
+	const auto& compact = node.getAllCompactMetadata();
+	ASSERT_THAT(compact.size(), Eq(7));
+	EXPECT_THAT(compact.at("bool").get<bool>(), Pointee(true));
+	EXPECT_THAT(compact.at("int").get<int>(), Pointee(3));
+	EXPECT_THAT(compact.at("long").get<int64_t>(), Pointee((int64_t)1 << 40));
+	EXPECT_THAT(compact.at("double").get<double>(), Pointee(2.5));
+	EXPECT_THAT(compact.at("string").get<std::string>(), Pointee(std::string("value")));
+	EXPECT_THAT(compact.at("date").get<repo::lib::RepoTimestamp>(), Pointee(*repo::lib::RepoTimestamp::fromTm(date)));
+	EXPECT_THAT(compact.at("uuid").get<repo::lib::RepoUUID>(), Pointee(uuid));
+
+	// The BSON is the same as would be written from the RepoVariants
+
+	auto bson = (RepoBSON)node;
+	for (const auto& entry : bson.getObjectArray(REPO_NODE_LABEL_METADATA)) {
+		auto key = entry.getStringField(REPO_NODE_LABEL_META_KEY);
+		if (key == "uuid") {
+			EXPECT_THAT(entry.getUUIDField(REPO_NODE_LABEL_META_VALUE), Eq(uuid));
+			continue;
+		}
+		RepoBSONBuilder builder;
+		builder.appendRepoVariant(REPO_NODE_LABEL_META_VALUE, node.getAllMetadata().at(key));
+		auto expected = builder.obj();
+		EXPECT_THAT(entry.getField(REPO_NODE_LABEL_META_VALUE), Eq(expected.getField(REPO_NODE_LABEL_META_VALUE)));
+	}
+
+	MetadataNode read(bson);
+	EXPECT_THAT(read.getAllCompactMetadata(), Eq(compact));
+	EXPECT_THAT(read.sEqual(node), IsTrue());
+}
@@ -73,6 +73,9 @@ TEST(SupermeshNodeTest, Constructor)
 	EXPECT_THAT(MeshNode::Primitive::TRIANGLES, node.getPrimitive());
 	EXPECT_THAT(node.getMeshMapping(), IsEmpty());
 	EXPECT_THAT(node.getSubmeshIds(), IsEmpty());
+	EXPECT_THAT(node.getLodLevel(), Eq(0));
+	EXPECT_THAT(node.getLodError(), Eq(0));
+	EXPECT_TRUE(node.getLodSource().isDefaultValue());
 }
 
 // Operators declared for gtest must exist in the same namespace as the types
@@ -120,4 +123,10 @@ TEST(SupermeshNodeTest, Methods)
 	auto ids = makeSubmeshIds(1000);
 	node.setSubmeshIds(ids);
 	EXPECT_THAT(node.getSubmeshIds(), Eq(ids));
+
+	auto source = repo::lib::RepoUUID::createUUID();
+	node.setLod(2, 0.5f, source);
+	EXPECT_THAT(node.getLodLevel(), Eq(2));
+	EXPECT_THAT(node.getLodError(), Eq(0.5f));
+	EXPECT_THAT(node.getLodSource(), Eq(source));
 }
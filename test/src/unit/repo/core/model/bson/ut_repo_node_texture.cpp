@@ -143,6 +143,52 @@ TEST(TextureNodeTest, Serialise)
 	EXPECT_THAT(d2, node.getRawData());
 }
 
+TEST(TextureNodeTest, MipLevels)
+{
+	TextureNode node;
+	node.setData(makeRandomData(), 64, 32, "png");
+	EXPECT_THAT(((RepoBSON)node).hasField(REPO_NODE_LABEL_MIP_LEVELS), IsFalse());
+
+	std::vector<TextureNode::MipLevel> levels = {
+		{ 32, 16, makeRandomData() },
+		{ 16, 8, makeRandomData() },
+		{ 1, 1, makeRandomData() },
+	};
+	node.setMipLevels(levels);
+	EXPECT_THAT(node.getMipLevels(), Eq(levels));
+
+	auto bson = (RepoBSON)node;
+	EXPECT_THAT(bson.getObjectArray(REPO_NODE_LABEL_MIP_LEVELS).size(), Eq(3));
+	EXPECT_THAT(bson.hasBinField(REPO_NODE_LABEL_MIP_LEVEL_DATA "1"), IsTrue());
+
+	TextureNode copy(bson);
+	EXPECT_THAT(copy.getMipLevels(), Eq(levels));
+	EXPECT_THAT(copy.getRawData(), Eq(node.getRawData()));
+}
+
+TEST(TextureNodeTest, SHA256)
+{
+	// The digest should depend on the image only, and not the ids of the node
+
+	TextureNode a;
+	a.setData(makeRandomData(), 64, 32, "png");
+	auto b = a;
+	b.setUniqueID(repo::lib::RepoUUID::createUUID());
+	b.setSharedID(repo::lib::RepoUUID::createUUID());
+	b.changeName("name");
+	EXPECT_THAT(a.getSHA256(), Eq(b.getSHA256()));
+	EXPECT_THAT(a.getSHA256().size(), Eq(64));
+
+	EXPECT_THAT(((RepoBSON)a).getStringField(REPO_NODE_TEXTURE_LABEL_SHA256), Eq(a.getSHA256()));
+
+	b.setData(makeRandomData(), 64, 32, "png");
+	EXPECT_THAT(a.getSHA256(), Ne(b.getSHA256()));
+
+	auto c = a;
+	c.setData(a.getRawData(), 32, 64, "png");
+	EXPECT_THAT(a.getSHA256(), Ne(c.getSHA256()));
+}
+
 TEST(TextureNodeTest, Factory)
 {
 	auto data = makeRandomData();
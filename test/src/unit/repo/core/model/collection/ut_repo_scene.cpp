@@ -21,6 +21,7 @@
 #include <gmock/gmock.h>
 
 #include <repo/core/model/bson/repo_node_mesh.h>
+#include <repo/core/model/bson/repo_node_reference.h>
 #include <repo/core/model/bson/repo_node_texture.h>
 #include <repo/core/model/bson/repo_node_transformation.h>
 #include <repo/core/model/bson/repo_bson_factory.h>
@@ -567,6 +568,50 @@ TEST(RepoSceneTest, loadScene)
 	errMsg.clear();
 }
 
+TEST(RepoSceneTest, loadReferencesOnly)
+{
+	// Only the root, the reference and the nodes between them should be loaded
+
+	auto handler = getHandler();
+
+	RepoNodeSet transNodes, meshNodes, refNodes, empty;
+	auto root = new TransformationNode(makeTransformationNode("Federation"));
+	auto group = new TransformationNode(makeTransformationNode(root->getSharedID(), "group"));
+	auto subgroup = new TransformationNode(makeTransformationNode(group->getSharedID(), "subgroup"));
+	auto other = new TransformationNode(makeTransformationNode(root->getSharedID(), "other"));
+	auto mesh = new MeshNode(makeMeshNode(other->getSharedID()));
+	auto ref = new ReferenceNode(RepoBSONFactory::makeReferenceNode(REPO_GTEST_DBNAME1, REPO_GTEST_DBNAME1_PROJ));
+	ref->addParent(subgroup->getSharedID());
+	transNodes.insert({ root, group, subgroup, other });
+	meshNodes.insert(mesh);
+	refNodes.insert(ref);
+
+	RepoScene fed(std::vector<std::string>(), meshNodes, empty, empty, empty, transNodes, refNodes);
+	auto project = "fedReferencesOnly_" + repo::lib::RepoUUID::createUUID().toString();
+	fed.setDatabaseAndProjectName("sceneCommit", project);
+	std::string errMsg;
+	ASSERT_EQ(REPOERR_OK, fed.commit(handler.get(), handler->getFileManager().get(), errMsg, "user"));
+
+	RepoScene scene("sceneCommit", project);
+	scene.loadReferencesOnly();
+	ASSERT_TRUE(scene.loadScene(handler.get(), errMsg));
+	EXPECT_TRUE(errMsg.empty());
+
+	ASSERT_TRUE(scene.getRoot(defaultG));
+	EXPECT_THAT(scene.getRoot(defaultG)->getSharedID(), Eq(root->getSharedID()));
+
+	std::set<repo::lib::RepoUUID> loaded;
+	for (auto node : scene.getAllTransformations(defaultG)) {
+		loaded.insert(node->getSharedID());
+	}
+	EXPECT_THAT(loaded, UnorderedElementsAre(root->getSharedID(), group->getSharedID(), subgroup->getSharedID()));
+	EXPECT_THAT(scene.getAllMeshes(defaultG), IsEmpty());
+
+	auto references = scene.getAllReferences(defaultG);
+	ASSERT_THAT(references.size(), Eq(1));
+	EXPECT_TRUE(scene.getSceneFromReference(defaultG, (*references.begin())->getSharedID()));
+}
+
 TEST(RepoSceneTest, loadStash)
 {
 	auto handler = getHandler();
@@ -748,6 +793,53 @@ TEST(RepoSceneTest, getSceneFromReference)
 	EXPECT_FALSE(scene.getSceneFromReference(defaultG, repo::lib::RepoUUID::createUUID()));
 }
 
+TEST(RepoSceneTest, LoadReferencesConcurrently)
+{
+	// A federation with the same model referenced twice, and another model,
+	// should load each referenced revision only once, regardless of the number
+	// of threads
+
+	auto handler = getHandler();
+
+	RepoNodeSet transNodes, refNodes, empty;
+	auto root = new TransformationNode(makeTransformationNode("Federation"));
+	transNodes.insert(root);
+	for (auto model : { REPO_GTEST_DBNAME1_PROJ, REPO_GTEST_DBNAME1_PROJ, REPO_GTEST_DBNAME2_PROJ }) {
+		auto group = new TransformationNode(makeTransformationNode(root->getSharedID(), model));
+		transNodes.insert(group);
+		auto database = model == REPO_GTEST_DBNAME1_PROJ ? REPO_GTEST_DBNAME1 : REPO_GTEST_DBNAME2;
+		auto ref = new ReferenceNode(RepoBSONFactory::makeReferenceNode(database, model));
+		ref->addParent(group->getSharedID());
+		refNodes.insert(ref);
+	}
+
+	RepoScene fed(std::vector<std::string>(), empty, empty, empty, empty, empty, transNodes, refNodes);
+	auto project = "fedDuplicateRefs_" + repo::lib::RepoUUID::createUUID().toString();
+	fed.setDatabaseAndProjectName("sceneCommit", project);
+	std::string errMsg;
+	ASSERT_EQ(REPOERR_OK, fed.commit(handler.get(), handler->getFileManager().get(), errMsg, "user"));
+
+	for (auto numThreads : { 1, 4 }) {
+		RepoScene scene("sceneCommit", project);
+		scene.setReferenceLoadThreads(numThreads);
+		ASSERT_TRUE(scene.loadScene(handler.get(), errMsg));
+
+		std::set<RepoScene*> scenes;
+		std::map<std::string, RepoScene*> projectToScene;
+		auto references = scene.getAllReferences(defaultG);
+		ASSERT_EQ(3, references.size());
+		for (const auto& ref : references) {
+			auto refScene = scene.getSceneFromReference(defaultG, ref->getSharedID());
+			ASSERT_TRUE(refScene);
+			EXPECT_TRUE(refScene->hasRoot(RepoScene::GraphType::DEFAULT) || refScene->hasRoot(RepoScene::GraphType::OPTIMIZED));
+			scenes.insert(refScene);
+			projectToScene[refScene->getProjectName()] = refScene;
+		}
+		EXPECT_EQ(2, scenes.size());
+		EXPECT_EQ(2, projectToScene.size());
+	}
+}
+
 TEST(RepoSceneTest, getTextureIDForMesh)
 {
 	RepoScene scene;
@@ -0,0 +1,183 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cmath>
+#include <limits>
+#include <repo/lib/datastructure/repo_compact_variant.h>
+#include <repo/lib/datastructure/repo_variant_utils.h>
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+using namespace repo::lib;
+using namespace testing;
+
+TEST(RepoCompactVariantTest, Size)
+{
+	EXPECT_THAT(sizeof(RepoCompactVariant), Lt(sizeof(RepoVariant)));
+}
+
+TEST(RepoCompactVariantTest, Get)
+{
+	RepoCompactVariant empty;
+	EXPECT_TRUE(empty.isEmpty());
+	EXPECT_THAT(empty.get<int>(), IsNull());
+
+	RepoCompactVariant i = 24;
+	EXPECT_FALSE(i.isEmpty());
+	EXPECT_TRUE(i.holds<int>());
+	EXPECT_THAT(*i.get<int>(), Eq(24));
+	EXPECT_THAT(i.get<int64_t>(), IsNull());
+	EXPECT_THAT(i.get<double>(), IsNull());
+
+	RepoCompactVariant ll = (int64_t)9223372036854775806ll;
+	EXPECT_THAT(*ll.get<int64_t>(), Eq(9223372036854775806ll));
+	EXPECT_THAT(ll.get<int>(), IsNull());
+
+	RepoCompactVariant s = std::string("3d Repo");
+	EXPECT_THAT(*s.get<std::string>(), Eq("3d Repo"));
+	EXPECT_THAT(s.get<bool>(), IsNull());
+
+	RepoCompactVariant b = true;
+	EXPECT_THAT(*b.get<bool>(), IsTrue());
+
+	auto uuid = RepoUUID::createUUID();
+	RepoCompactVariant u = uuid;
+	EXPECT_THAT(*u.get<RepoUUID>(), Eq(uuid));
+
+	RepoCompactVariant t = RepoTimestamp{ 1000 };
+	EXPECT_THAT(t.get<RepoTimestamp>()->milliseconds, Eq(1000));
+
+	// Different types should never be equal, even if their values are
+
+	EXPECT_THAT(RepoCompactVariant(1), Eq(RepoCompactVariant(1)));
+	EXPECT_THAT(RepoCompactVariant(1), Ne(RepoCompactVariant((int64_t)1)));
+	EXPECT_THAT(RepoCompactVariant(1), Ne(RepoCompactVariant(1.0)));
+}
+
+TEST(RepoCompactVariantTest, Timestamp)
+{
+	tm t = {};
+	t.tm_year = 124;
+	t.tm_mon = 2;
+	t.tm_mday = 4;
+	t.tm_hour = 5;
+	t.tm_min = 6;
+	t.tm_sec = 7;
+	t.tm_isdst = -1;
+
+	tm cpy = t;
+	auto expected = (int64_t)mktime(&cpy) * 1000;
+
+	auto timestamp = RepoTimestamp::fromTm(t);
+	ASSERT_TRUE(timestamp);
+	EXPECT_THAT(timestamp->milliseconds, Eq(expected));
+
+	auto utc = RepoTimestamp{ 1709528767000 }.toTm(); // 2024-03-04 05:06:07 UTC
+	EXPECT_THAT(utc.tm_year, Eq(124));
+	EXPECT_THAT(utc.tm_mon, Eq(2));
+	EXPECT_THAT(utc.tm_mday, Eq(4));
+	EXPECT_THAT(utc.tm_hour, Eq(5));
+	EXPECT_THAT(utc.tm_min, Eq(6));
+	EXPECT_THAT(utc.tm_sec, Eq(7));
+
+	auto before = RepoTimestamp{ -1 }.toTm(); // One millisecond before the epoch
+	EXPECT_THAT(before.tm_year, Eq(69));
+	EXPECT_THAT(before.tm_sec, Eq(59));
+}
+
+TEST(RepoCompactVariantTest, RepoVariant)
+{
+	std::vector<RepoVariant> variants = {
+		true,
+		-12,
+		(int64_t)-9223372036854775806ll,
+		24.24,
+		std::string("string"),
+		std::string(),
+		RepoUUID::createUUID()
+	};
+
+	for (const auto& v : variants) {
+		auto c = RepoCompactVariant::fromRepoVariant(v);
+		EXPECT_FALSE(c.isEmpty());
+		EXPECT_TRUE(boost::apply_visitor(DuplicationVisitor(), v, c.toRepoVariant()));
+	}
+
+	tm t = {};
+	t.tm_year = 100;
+	t.tm_mday = 1;
+	t.tm_isdst = -1;
+	auto c = RepoCompactVariant::fromRepoVariant(t);
+	ASSERT_TRUE(c.holds<RepoTimestamp>());
+	EXPECT_THAT(c.get<RepoTimestamp>()->milliseconds, Eq(RepoTimestamp::fromTm(t)->milliseconds));
+}
+
+TEST(RepoCompactVariantTest, ToString)
+{
+	// Strings should be the same as those of the equivalent RepoVariant
+
+	std::vector<RepoCompactVariant> variants = {
+		true,
+		false,
+		0,
+		std::numeric_limits<int>::min(),
+		std::numeric_limits<int64_t>::max(),
+		24.24,
+		-0.000001,
+		1e300,
+		std::string("3d Repo"),
+		std::string(),
+		RepoTimestamp{ 1709528767000 },
+		RepoUUID::createUUID()
+	};
+
+	for (const auto& v : variants) {
+		EXPECT_THAT(v.toString(), Eq(boost::apply_visitor(StringConversionVisitor(), v.toRepoVariant())));
+	}
+
+	// Strings should be appended to, not replaced
+
+	std::string s = "a";
+	RepoCompactVariant(1).appendString(s);
+	RepoCompactVariant().appendString(s);
+	EXPECT_THAT(s, Eq("a1"));
+}
+
+TEST(RepoCompactVariantTest, Json)
+{
+	auto json = [](const RepoCompactVariant& v) {
+		std::string s;
+		v.appendJson(s);
+		return s;
+	};
+
+	EXPECT_THAT(json(RepoCompactVariant()), Eq("null"));
+	EXPECT_THAT(json(true), Eq("true"));
+	EXPECT_THAT(json(false), Eq("false"));
+	EXPECT_THAT(json(-24), Eq("-24"));
+	EXPECT_THAT(json((int64_t)9223372036854775806ll), Eq("9223372036854775806"));
+	EXPECT_THAT(json(0.1), Eq("0.1"));
+	EXPECT_THAT(json(-2.5e-20), Eq("-2.5e-20"));
+	EXPECT_THAT(json(std::numeric_limits<double>::quiet_NaN()), Eq("null"));
+	EXPECT_THAT(json(std::numeric_limits<double>::infinity()), Eq("null"));
+	EXPECT_THAT(json(std::string("plain")), Eq("\"plain\""));
+	EXPECT_THAT(json(std::string("\"quoted\"\\ \n\t\x01 \xc3\xa9")), Eq("\"\\\"quoted\\\"\\\\ \\n\\t\\u0001 \xc3\xa9\""));
+	EXPECT_THAT(json(RepoTimestamp{ 1709528767123 }), Eq("1709528767123"));
+
+	auto uuid = RepoUUID::createUUID();
+	EXPECT_THAT(json(uuid), Eq("\"" + uuid.toString() + "\""));
+}
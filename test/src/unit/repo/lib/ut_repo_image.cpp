@@ -0,0 +1,173 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <repo/lib/repo_image.h>
+#include <repo/lib/repo_exception.h>
+
+using namespace repo::lib;
+using namespace testing;
+
+static RepoImage makeImage(uint32_t width, uint32_t height, uint8_t channels)
+{
+	RepoImage image(width, height, channels);
+	auto& pixels = image.getPixels();
+	for (size_t i = 0; i < pixels.size(); i++) {
+		pixels[i] = (uint8_t)((i * 31) ^ (i >> 7));
+	}
+	return image;
+}
+
+TEST(RepoImage, PNGRoundTrip)
+{
+	for (uint8_t channels = 1; channels <= 4; channels++) {
+		auto image = makeImage(67, 41, channels);
+		auto png = image.encodePNG();
+
+		EXPECT_THAT(std::vector<uint8_t>(png.begin(), png.begin() + 8), ElementsAre(0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'));
+
+		auto decoded = RepoImage::decode(png);
+		ASSERT_TRUE(decoded.has_value());
+		EXPECT_THAT(decoded->getWidth(), Eq(67));
+		EXPECT_THAT(decoded->getHeight(), Eq(41));
+		EXPECT_THAT(decoded->getChannels(), Eq(channels));
+		EXPECT_THAT(decoded->getPixels(), Eq(image.getPixels()));
+	}
+}
+
+TEST(RepoImage, BMP)
+{
+	// A 2x2 24 bit BMP, stored bottom up with rows padded to four bytes
+
+	std::vector<uint8_t> bmp = {
+		'B', 'M', 70, 0, 0, 0, 0, 0, 0, 0, 54, 0, 0, 0,
+		40, 0, 0, 0, 2, 0, 0, 0, 2, 0, 0, 0, 1, 0, 24, 0, 0, 0, 0, 0, 16, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		255, 0, 0, 0, 255, 0, 0, 0, // Bottom row: blue, green (BGR)
+		0, 0, 255, 255, 255, 255, 0, 0, // Top row: red, white
+	};
+
+	auto image = RepoImage::decode(bmp);
+	ASSERT_TRUE(image.has_value());
+	EXPECT_THAT(image->getWidth(), Eq(2));
+	EXPECT_THAT(image->getHeight(), Eq(2));
+	EXPECT_THAT(image->getChannels(), Eq(3));
+	EXPECT_THAT(image->getPixels(), ElementsAre(
+		255, 0, 0, 255, 255, 255,
+		0, 0, 255, 0, 255, 0
+	));
+}
+
+TEST(RepoImage, TGA)
+{
+	// A 2x1 RLE compressed 32 bit TGA, with one run packet
+
+	std::vector<uint8_t> tga = {
+		0, 0, 10, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 1, 0, 32, 0x28,
+		0x81, 10, 20, 30, 40,
+	};
+
+	auto image = RepoImage::decode(tga);
+	ASSERT_TRUE(image.has_value());
+	EXPECT_THAT(image->getWidth(), Eq(2));
+	EXPECT_THAT(image->getHeight(), Eq(1));
+	EXPECT_THAT(image->getChannels(), Eq(4));
+	EXPECT_THAT(image->getPixels(), ElementsAre(30, 20, 10, 40, 30, 20, 10, 40));
+}
+
+TEST(RepoImage, PPM)
+{
+	std::string ppm = "P6\n# comment\n2 1\n255\n";
+	ppm += std::string("\x01\x02\x03\x04\x05\x06", 6);
+
+	auto image = RepoImage::decode(std::vector<uint8_t>(ppm.begin(), ppm.end()));
+	ASSERT_TRUE(image.has_value());
+	EXPECT_THAT(image->getChannels(), Eq(3));
+	EXPECT_THAT(image->getPixels(), ElementsAre(1, 2, 3, 4, 5, 6));
+}
+
+TEST(RepoImage, UnsupportedFormats)
+{
+	// Formats that are not decoded, such as JPEG, are reported by an empty
+	// result rather than an exception, so they can be passed through
+
+	std::vector<uint8_t> jpeg = { 0xFF, 0xD8, 0xFF, 0xE0, 0, 16, 'J', 'F', 'I', 'F', 0 };
+	EXPECT_FALSE(RepoImage::decode(jpeg).has_value());
+	EXPECT_FALSE(RepoImage::decode({}).has_value());
+}
+
+TEST(RepoImage, Corrupt)
+{
+	auto png = makeImage(32, 32, 3).encodePNG();
+
+	auto truncated = png;
+	truncated.resize(png.size() / 2);
+	EXPECT_THROW(RepoImage::decode(truncated), RepoException);
+
+	auto corrupted = png;
+	corrupted[png.size() / 2] ^= 0xFF;
+	EXPECT_THROW(RepoImage::decode(corrupted), RepoException);
+}
+
+TEST(RepoImage, Resize)
+{
+	// Downsampling averages the pixels that fall within each output pixel
+
+	RepoImage image(4, 2, 1);
+	image.getPixels() = {
+		0, 100, 10, 10,
+		100, 0, 30, 30,
+	};
+
+	auto half = image.resize(2, 1);
+	EXPECT_THAT(half.getPixels(), ElementsAre(50, 20));
+
+	auto same = image.resize(4, 2);
+	EXPECT_THAT(same.getPixels(), Eq(image.getPixels()));
+}
+
+TEST(RepoImage, Fit)
+{
+	auto image = makeImage(400, 100, 3);
+
+	auto fitted = image.fit(200);
+	EXPECT_THAT(fitted.getWidth(), Eq(200));
+	EXPECT_THAT(fitted.getHeight(), Eq(50));
+
+	// Images are never scaled up, and 0 means there is no limit
+
+	EXPECT_THAT(image.fit(1000).getWidth(), Eq(400));
+	EXPECT_THAT(image.fit(0).getWidth(), Eq(400));
+}
+
+TEST(RepoImage, MipLevels)
+{
+	auto image = makeImage(64, 16, 4);
+	auto levels = image.mipLevels();
+
+	ASSERT_THAT(levels.size(), Eq(6));
+	EXPECT_THAT(levels[0].getWidth(), Eq(32));
+	EXPECT_THAT(levels[0].getHeight(), Eq(8));
+	EXPECT_THAT(levels[4].getWidth(), Eq(2));
+	EXPECT_THAT(levels[4].getHeight(), Eq(1));
+	EXPECT_THAT(levels[5].getWidth(), Eq(1));
+	EXPECT_THAT(levels[5].getHeight(), Eq(1));
+	for (auto& level : levels) {
+		EXPECT_THAT(level.getChannels(), Eq(4));
+	}
+}
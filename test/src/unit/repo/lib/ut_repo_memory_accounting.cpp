@@ -0,0 +1,195 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <repo/lib/repo_memory_accounting.h>
+#include <repo/lib/repo_exception.h>
+
+#include <limits>
+
+using namespace repo::lib;
+using namespace testing;
+
+using Tag = RepoMemoryAccounting::Tag;
+
+class MemoryAccounting : public Test
+{
+protected:
+	void SetUp() override
+	{
+		RepoMemoryAccounting::reset();
+		RepoMemoryAccounting::setBudget(0);
+	}
+
+	void TearDown() override
+	{
+		RepoMemoryAccounting::setBudget(0);
+	}
+};
+
+TEST_F(MemoryAccounting, Allocation)
+{
+	{
+		RepoMemoryAccounting::Allocation a(Tag::MESH, 100);
+		RepoMemoryAccounting::Allocation b(Tag::BINARY, 50);
+		EXPECT_THAT(RepoMemoryAccounting::getCurrent(), Eq(150));
+		EXPECT_THAT(RepoMemoryAccounting::getCurrent(Tag::MESH), Eq(100));
+		EXPECT_THAT(RepoMemoryAccounting::getCurrent(Tag::BINARY), Eq(50));
+
+		a.resize(20);
+		EXPECT_THAT(RepoMemoryAccounting::getCurrent(Tag::MESH), Eq(20));
+
+		// Copies count again, moves do not
+
+		auto c = b;
+		EXPECT_THAT(RepoMemoryAccounting::getCurrent(Tag::BINARY), Eq(100));
+
+		auto d = std::move(c);
+		EXPECT_THAT(RepoMemoryAccounting::getCurrent(Tag::BINARY), Eq(100));
+
+		c = a;
+		EXPECT_THAT(RepoMemoryAccounting::getCurrent(Tag::MESH), Eq(40));
+		EXPECT_THAT(RepoMemoryAccounting::getCurrent(), Eq(140));
+
+		// Resizing to the same size changes nothing
+
+		a.resize(20);
+		EXPECT_THAT(RepoMemoryAccounting::getCurrent(), Eq(140));
+	}
+
+	EXPECT_THAT(RepoMemoryAccounting::getCurrent(), Eq(0));
+	EXPECT_THAT(RepoMemoryAccounting::getPeak(), Eq(150));
+	EXPECT_THAT(RepoMemoryAccounting::getPeak(Tag::MESH), Eq(100));
+	EXPECT_THAT(RepoMemoryAccounting::getPeak(Tag::BINARY), Eq(100));
+}
+
+TEST_F(MemoryAccounting, Stages)
+{
+	RepoMemoryAccounting::Allocation a(Tag::MESH, 1000);
+	{
+		RepoMemoryAccounting::Stage outer("outer");
+		{
+			RepoMemoryAccounting::Stage inner("inner");
+			RepoMemoryAccounting::Allocation b(Tag::JSON, 500);
+		}
+		{
+			RepoMemoryAccounting::Stage inner("inner2");
+			RepoMemoryAccounting::Allocation b(Tag::BLOB, 200);
+		}
+	}
+
+	auto reports = RepoMemoryAccounting::getStageReports();
+	ASSERT_THAT(reports.size(), Eq(3));
+
+	EXPECT_THAT(reports[0].name, Eq("inner"));
+	EXPECT_THAT(reports[0].depth, Eq(1));
+	EXPECT_THAT(reports[0].peak, Eq(1500));
+	EXPECT_THAT(reports[0].tagPeaks[(size_t)Tag::JSON], Eq(500));
+	EXPECT_THAT(reports[0].tagPeaks[(size_t)Tag::BLOB], Eq(0));
+
+	EXPECT_THAT(reports[1].name, Eq("inner2"));
+	EXPECT_THAT(reports[1].peak, Eq(1200));
+	EXPECT_THAT(reports[1].tagPeaks[(size_t)Tag::JSON], Eq(0));
+	EXPECT_THAT(reports[1].tagPeaks[(size_t)Tag::BLOB], Eq(200));
+
+	EXPECT_THAT(reports[2].name, Eq("outer"));
+	EXPECT_THAT(reports[2].depth, Eq(0));
+	EXPECT_THAT(reports[2].peak, Eq(1500));
+	EXPECT_THAT(reports[2].tagPeaks[(size_t)Tag::MESH], Eq(1000));
+
+	// A later stage measures its peak from where it starts, but the overall peak
+	// is kept
+
+	{
+		RepoMemoryAccounting::Stage stage("later");
+	}
+	EXPECT_THAT(RepoMemoryAccounting::getStageReports().back().peak, Eq(1000));
+	EXPECT_THAT(RepoMemoryAccounting::getPeak(), Eq(1500));
+
+	EXPECT_THAT(RepoMemoryAccounting::printReport(), HasSubstr("inner2"));
+}
+
+TEST_F(MemoryAccounting, Budget)
+{
+	RepoMemoryAccounting::setBudget(1000);
+
+	RepoMemoryAccounting::Allocation a(Tag::MESH, 600);
+	EXPECT_TRUE(RepoMemoryAccounting::canAllocate(400));
+	EXPECT_FALSE(RepoMemoryAccounting::canAllocate(401));
+
+	try {
+		RepoMemoryAccounting::Allocation b(Tag::BINARY, 500);
+		FAIL() << "Expected the allocation to exceed the budget";
+	}
+	catch (const RepoException& e) {
+		EXPECT_THAT(e.repoCode(), Eq(REPOERR_MEMORY_BUDGET_EXCEEDED));
+	}
+
+	// Failed allocations leave the counters and sizes unchanged
+
+	EXPECT_THAT(RepoMemoryAccounting::getCurrent(), Eq(600));
+	EXPECT_THROW(a.resize(1001), RepoMemoryBudgetException);
+	EXPECT_THAT(a.getSize(), Eq(600));
+	EXPECT_THAT(RepoMemoryAccounting::getCurrent(), Eq(600));
+
+	a.resize(1000);
+	EXPECT_THAT(RepoMemoryAccounting::getCurrent(), Eq(1000));
+
+	RepoMemoryAccounting::setBudget(0);
+	RepoMemoryAccounting::Allocation c(Tag::BINARY, 5000);
+	EXPECT_THAT(RepoMemoryAccounting::getCurrent(), Eq(6000));
+}
+
+TEST_F(MemoryAccounting, NoBudget)
+{
+	// The budget only limits allocations; everything is counted without one, so
+	// the stages still report their real peaks
+
+	const size_t MB = 1024 * 1024;
+
+	ASSERT_THAT(RepoMemoryAccounting::getBudget(), Eq(0));
+
+	RepoMemoryAccounting::Allocation a(Tag::MESH, 6 * MB);
+	{
+		RepoMemoryAccounting::Stage stage("import");
+		RepoMemoryAccounting::Allocation b(Tag::TEXTURE, 5 * MB);
+		EXPECT_THAT(b.getSize(), Eq(5 * MB));
+		EXPECT_THAT(RepoMemoryAccounting::getCurrent(), Eq(11 * MB));
+		EXPECT_TRUE(RepoMemoryAccounting::canAllocate(std::numeric_limits<size_t>::max()));
+
+		a.resize(8 * MB);
+		EXPECT_THAT(RepoMemoryAccounting::getCurrent(), Eq(13 * MB));
+
+		a.resize(1 * MB);
+		auto c = a;
+		EXPECT_THAT(RepoMemoryAccounting::getCurrent(), Eq(7 * MB));
+	}
+	EXPECT_THAT(RepoMemoryAccounting::getCurrent(), Eq(1 * MB));
+
+	auto reports = RepoMemoryAccounting::getStageReports();
+	ASSERT_THAT(reports.size(), Eq(1));
+	EXPECT_THAT(reports[0].peak, Eq(13 * MB));
+	EXPECT_THAT(reports[0].tagPeaks[(size_t)Tag::MESH], Eq(8 * MB));
+	EXPECT_THAT(reports[0].tagPeaks[(size_t)Tag::TEXTURE], Eq(5 * MB));
+	EXPECT_THAT(RepoMemoryAccounting::getPeak(), Eq(13 * MB));
+
+	auto report = RepoMemoryAccounting::printReport();
+	EXPECT_THAT(report, HasSubstr("import: 13.0MB"));
+	EXPECT_THAT(report, HasSubstr("Overall: 13.0MB"));
+	EXPECT_THAT(report, Not(HasSubstr("budget")));
+}
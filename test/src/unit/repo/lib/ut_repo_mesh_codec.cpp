@@ -0,0 +1,246 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <repo/lib/repo_mesh_codec.h>
+#include <repo/lib/repo_exception.h>
+
+#include <algorithm>
+#include <random>
+
+using namespace repo::lib;
+using namespace testing;
+
+static std::vector<RepoVector3D> makePositions(size_t count, float scale)
+{
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<float> dist(-scale, scale);
+	std::vector<RepoVector3D> positions;
+	for (size_t i = 0; i < count; i++) {
+		positions.push_back({ dist(rng), dist(rng) * 0.5f, dist(rng) + 100.0f });
+	}
+	return positions;
+}
+
+static std::vector<RepoVector3D> makeNormals(size_t count)
+{
+	std::mt19937 rng(2);
+	std::uniform_real_distribution<float> dist(-1, 1);
+	std::vector<RepoVector3D> normals;
+	for (size_t i = 0; i < count; i++) {
+		RepoVector3D n(dist(rng), dist(rng), dist(rng));
+		n.normalize();
+		normals.push_back(n);
+	}
+	normals.push_back({ 0, 0, 1 });
+	normals.push_back({ 0, 0, -1 });
+	normals.push_back({ 1, 0, 0 });
+	normals.push_back({ 0, -1, 0 });
+	return normals;
+}
+
+static RepoBounds boundsOf(const std::vector<RepoVector3D>& positions)
+{
+	RepoBounds bounds;
+	for (auto& p : positions) {
+		bounds.encapsulate(p);
+	}
+	return bounds;
+}
+
+TEST(RepoMeshCodec, Positions)
+{
+	auto positions = makePositions(10000, 50.0f);
+
+	for (auto bits : { 24, 20, 12, 8 }) {
+		RepoMeshCodec::Options options;
+		options.positionBits = bits;
+		options.grid = boundsOf(positions);
+		auto decoded = RepoMeshCodec::decodePositions(RepoMeshCodec::encodePositions(positions, options));
+		ASSERT_THAT(decoded.size(), Eq(positions.size()));
+
+		// The error of each component is at most half a step of the grid, which
+		// divides the longest side of the bounds into 2^bits - 1 steps
+
+		auto size = options.grid->size();
+		auto step = std::max({ size.x, size.y, size.z }) / ((1 << bits) - 1);
+		for (size_t i = 0; i < positions.size(); i++) {
+			for (int c = 0; c < 3; c++) {
+				EXPECT_THAT((&decoded[i].x)[c], FloatNear((&positions[i].x)[c], step * 0.5 + 1e-4));
+			}
+		}
+	}
+
+	// Without a grid, or with the quantisation disabled, the positions are kept
+	// exactly
+
+	EXPECT_THAT(RepoMeshCodec::decodePositions(RepoMeshCodec::encodePositions(positions, {})), ElementsAreArray(positions));
+
+	RepoMeshCodec::Options options;
+	options.positionBits = 0;
+	options.grid = boundsOf(positions);
+	EXPECT_THAT(RepoMeshCodec::decodePositions(RepoMeshCodec::encodePositions(positions, options)), ElementsAreArray(positions));
+
+	options.positionBits = 25;
+	EXPECT_THROW(RepoMeshCodec::encodePositions(positions, options), RepoException);
+}
+
+TEST(RepoMeshCodec, FlatPositions)
+{
+	// Bounds with no extent along some (or all) axes should not cause a
+	// division by zero
+
+	std::vector<RepoVector3D> positions = { { 1, 2, 3 }, { 4, 2, 3 }, { 1, 2, 5 } };
+	RepoMeshCodec::Options options;
+	options.grid = boundsOf(positions);
+	auto decoded = RepoMeshCodec::decodePositions(RepoMeshCodec::encodePositions(positions, options));
+	ASSERT_THAT(decoded.size(), Eq(3));
+	for (size_t i = 0; i < positions.size(); i++) {
+		EXPECT_THAT(decoded[i].x, FloatNear(positions[i].x, 1e-4));
+		EXPECT_THAT(decoded[i].y, FloatEq(positions[i].y));
+		EXPECT_THAT(decoded[i].z, FloatNear(positions[i].z, 1e-4));
+	}
+
+	std::vector<RepoVector3D> point = { { 1, 2, 3 } };
+	options.grid = boundsOf(point);
+	EXPECT_THAT(RepoMeshCodec::decodePositions(RepoMeshCodec::encodePositions(point, options)), ElementsAreArray(point));
+}
+
+TEST(RepoMeshCodec, SharedGrid)
+{
+	// Two meshes that share an edge, but have different bounds of their own,
+	// should decode the shared vertices to exactly the same points, so no
+	// cracks open up between them
+
+	std::vector<RepoVector3D> a = { { 0, 0, 0 }, { 1.2345678f, 0, 0 }, { 0.61f, 0.333333f, 0 } };
+	std::vector<RepoVector3D> b = { { 1.2345678f, 0, 0 }, { 0.61f, 0.333333f, 0 }, { 7.77f, 3.1f, 2.9f } };
+
+	RepoMeshCodec::Options options;
+	options.positionBits = 8;
+	options.grid = RepoBounds(RepoVector3D64(-10, -10, -10), RepoVector3D64(10, 10, 10));
+
+	auto decodedA = RepoMeshCodec::decodePositions(RepoMeshCodec::encodePositions(a, options));
+	auto decodedB = RepoMeshCodec::decodePositions(RepoMeshCodec::encodePositions(b, options));
+	EXPECT_THAT(decodedA[1], Eq(decodedB[0]));
+	EXPECT_THAT(decodedA[2], Eq(decodedB[1]));
+
+	// The grid only sets the origin and spacing, so positions outside of its
+	// bounds are still encoded correctly
+
+	std::vector<RepoVector3D> outside = { { -100, 0, 0 }, { 250, -1000, 40 } };
+	options.positionBits = 20;
+	auto decoded = RepoMeshCodec::decodePositions(RepoMeshCodec::encodePositions(outside, options));
+	auto step = 20.0 / ((1 << 20) - 1);
+	for (size_t i = 0; i < outside.size(); i++) {
+		for (int c = 0; c < 3; c++) {
+			EXPECT_THAT((&decoded[i].x)[c], FloatNear((&outside[i].x)[c], step * 0.5 + 1e-4));
+		}
+	}
+}
+
+TEST(RepoMeshCodec, Normals)
+{
+	auto normals = makeNormals(10000);
+	auto decoded = RepoMeshCodec::decodeNormals(RepoMeshCodec::encodeNormals(normals, {}));
+	ASSERT_THAT(decoded.size(), Eq(normals.size()));
+
+	// 16 bit octahedral normals should be within a few thousandths of a degree
+
+	for (size_t i = 0; i < normals.size(); i++) {
+		EXPECT_THAT(decoded[i].norm(), FloatNear(1.0f, 1e-5));
+		EXPECT_THAT(decoded[i].dotProduct(normals[i]), Gt(0.999999f));
+	}
+
+	RepoMeshCodec::Options options;
+	options.octahedralNormals = false;
+	EXPECT_THAT(RepoMeshCodec::decodeNormals(RepoMeshCodec::encodeNormals(normals, options)), ElementsAreArray(normals));
+}
+
+TEST(RepoMeshCodec, Faces)
+{
+	// Faces are always lossless, including mixed primitives and large jumps
+	// between indices
+
+	std::vector<uint32_t> faces = { 3, 0, 1, 2, 3, 2, 1, 3, 2, 4000000000, 5, 1, 7, 0 };
+	for (uint32_t i = 0; i < 10000; i++) {
+		faces.insert(faces.end(), { 3, i, i + 1, i + 2 });
+	}
+
+	for (auto compress : { true, false }) {
+		RepoMeshCodec::Options options;
+		options.compressStreams = compress;
+		auto encoded = RepoMeshCodec::encodeFaces(faces, options);
+		EXPECT_THAT(RepoMeshCodec::decodeFaces(encoded), ElementsAreArray(faces));
+		EXPECT_THAT(encoded.size(), Lt(faces.size() * sizeof(uint32_t) / 2));
+	}
+}
+
+TEST(RepoMeshCodec, UVs)
+{
+	std::vector<RepoVector2D> uvs = { { 0, 0 }, { 1, 1 }, { -3.5f, 12.25f } };
+	EXPECT_THAT(RepoMeshCodec::decodeUVs(RepoMeshCodec::encodeUVs(uvs, {})), ElementsAreArray(uvs));
+}
+
+TEST(RepoMeshCodec, Compact)
+{
+	auto positions = makePositions(10000, 50.0f);
+	RepoMeshCodec::Options options;
+	options.positionBits = 16;
+	options.grid = boundsOf(positions);
+	auto encoded = RepoMeshCodec::encodePositions(positions, options);
+	EXPECT_THAT(encoded.size(), Lt(positions.size() * sizeof(RepoVector3D) * 3 / 4));
+
+	auto normals = makeNormals(10000);
+	EXPECT_THAT(RepoMeshCodec::encodeNormals(normals, {}).size(), Lt(normals.size() * sizeof(RepoVector3D) / 2));
+}
+
+TEST(RepoMeshCodec, Empty)
+{
+	EXPECT_THAT(RepoMeshCodec::decodePositions(RepoMeshCodec::encodePositions({}, {})), IsEmpty());
+	EXPECT_THAT(RepoMeshCodec::decodeNormals(RepoMeshCodec::encodeNormals({}, {})), IsEmpty());
+	EXPECT_THAT(RepoMeshCodec::decodeFaces(RepoMeshCodec::encodeFaces({}, {})), IsEmpty());
+	EXPECT_THAT(RepoMeshCodec::decodeUVs(RepoMeshCodec::encodeUVs({}, {})), IsEmpty());
+}
+
+TEST(RepoMeshCodec, Malformed)
+{
+	RepoMeshCodec::Options options;
+	options.grid = RepoBounds(RepoVector3D64(-1, -1, -1), RepoVector3D64(1, 1, 1));
+	auto positions = RepoMeshCodec::encodePositions(makePositions(100, 1.0f), options);
+	auto faces = RepoMeshCodec::encodeFaces({ 3, 0, 1, 2 }, {});
+
+	EXPECT_THROW(RepoMeshCodec::decodePositions(std::vector<uint8_t>()), RepoException);
+	EXPECT_THROW(RepoMeshCodec::decodePositions(std::vector<uint8_t>(positions.begin(), positions.begin() + 20)), RepoException);
+	EXPECT_THROW(RepoMeshCodec::decodeFaces(positions), RepoException); // Wrong stream type
+
+	// The uncompressed size in the header is larger than the payload could be
+
+	auto corrupt = positions;
+	corrupt[11] = 0x7F;
+	EXPECT_THROW(RepoMeshCodec::decodePositions(corrupt), RepoException);
+
+	corrupt = faces;
+	corrupt[4] = 0xFF;
+	EXPECT_THROW(RepoMeshCodec::decodeFaces(corrupt), RepoException);
+
+	RepoMeshCodec::Options raw;
+	raw.compressStreams = false;
+	auto truncated = RepoMeshCodec::encodeFaces({ 3, 0, 1, 2 }, raw);
+	truncated.pop_back();
+	EXPECT_THROW(RepoMeshCodec::decodeFaces(truncated), RepoException);
+}
@@ -0,0 +1,72 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+#include <repo/lib/repo_sha256.h>
+#include <repo/lib/datastructure/repo_structs.h>
+
+using namespace repo::lib;
+
+static std::string digest(const std::string& message)
+{
+	RepoSHA256 hash;
+	hash.update(message.data(), message.size());
+	return hash.hexdigest();
+}
+
+TEST(RepoSHA256Test, KnownVectors)
+{
+	// Test vectors from FIPS 180-4 examples
+
+	EXPECT_EQ(digest(""), "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+	EXPECT_EQ(digest("abc"), "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+	EXPECT_EQ(digest("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"), "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+}
+
+TEST(RepoSHA256Test, Incremental)
+{
+	// The digest should not depend on how the input is divided between calls
+
+	std::string message(1000000, 'a');
+
+	RepoSHA256 hash;
+	for (size_t i = 0; i < message.size(); i += 777) {
+		hash.update(message.data() + i, std::min<size_t>(777, message.size() - i));
+	}
+	EXPECT_EQ(hash.hexdigest(), "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+	EXPECT_EQ(digest(message), "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+}
+
+TEST(RepoSHA256Test, Material)
+{
+	auto a = repo_material_t::DefaultMaterial();
+	auto b = repo_material_t::DefaultMaterial();
+
+	RepoSHA256 hashA;
+	hashA.update(a);
+	RepoSHA256 hashB;
+	hashB.update(b);
+	EXPECT_EQ(hashA.hexdigest(), hashB.hexdigest());
+
+	b.opacity = 0.5;
+
+	RepoSHA256 hashC;
+	hashC.update(a);
+	RepoSHA256 hashD;
+	hashD.update(b);
+	EXPECT_NE(hashC.hexdigest(), hashD.hexdigest());
+}
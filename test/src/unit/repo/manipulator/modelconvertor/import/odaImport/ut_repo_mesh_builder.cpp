@@ -0,0 +1,100 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <repo/manipulator/modelconvertor/import/odaHelper/repo_mesh_builder.h>
+
+using namespace repo::manipulator::modelconvertor::odaHelper;
+using namespace testing;
+
+// Adds a flat grid of n x n quads as separate triangles, the way the ODA
+// tessellation delivers them, so every interior vertex arrives six times
+
+static void addGrid(RepoMeshBuilder& builder, int n, double z = 0)
+{
+	for (int y = 0; y < n; y++) {
+		for (int x = 0; x < n; x++) {
+			repo::lib::RepoVector3D64 a(x, y, z), b(x + 1, y, z), c(x + 1, y + 1, z), d(x, y + 1, z);
+			builder.addFace(RepoMeshBuilder::face({ a, b, c }));
+			builder.addFace(RepoMeshBuilder::face({ a, c, d }));
+		}
+	}
+}
+
+TEST(RepoMeshBuilder, WeldsSharedVertices)
+{
+	RepoMeshBuilder builder({}, {}, {});
+	addGrid(builder, 20);
+
+	std::vector<repo::core::model::MeshNode> meshes;
+	builder.extractMeshes(meshes);
+
+	ASSERT_THAT(meshes.size(), Eq(1));
+	EXPECT_THAT(meshes[0].getNumFaces(), Eq(20 * 20 * 2));
+	EXPECT_THAT(meshes[0].getNumVertices(), Eq(21 * 21));
+	EXPECT_THAT(meshes[0].getNormals().size(), Eq(21 * 21));
+
+	// Welding should leave nothing for the writer to remove
+
+	auto copy = meshes[0];
+	copy.removeDuplicateVertices();
+	EXPECT_THAT(copy.getNumVertices(), Eq(meshes[0].getNumVertices()));
+}
+
+TEST(RepoMeshBuilder, KeepsDistinctNormals)
+{
+	// Vertices at the same position but on faces with different normals must not
+	// be welded, so hard edges are preserved
+
+	RepoMeshBuilder builder({}, {}, {});
+	builder.addFace(RepoMeshBuilder::face({ { 0, 0, 0 }, { 1, 0, 0 }, { 0, 1, 0 } }));
+	builder.addFace(RepoMeshBuilder::face({ { 0, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } }));
+
+	std::vector<repo::core::model::MeshNode> meshes;
+	builder.extractMeshes(meshes);
+
+	ASSERT_THAT(meshes.size(), Eq(1));
+	EXPECT_THAT(meshes[0].getNumVertices(), Eq(6));
+}
+
+TEST(RepoMeshBuilder, VertexBudget)
+{
+	RepoMeshBuilder builder({}, {}, {}, 100);
+	addGrid(builder, 30);
+	addGrid(builder, 30, 1);
+
+	std::vector<repo::core::model::MeshNode> meshes;
+	builder.extractMeshes(meshes);
+
+	EXPECT_THAT(meshes.size(), Gt(2));
+
+	size_t numFaces = 0;
+	for (auto& mesh : meshes) {
+		EXPECT_THAT(mesh.getNumVertices(), Le(100));
+		numFaces += mesh.getNumFaces();
+
+		// Each mesh should have its own bounds, rather than those of the whole grid
+
+		repo::lib::RepoBounds bounds;
+		for (auto& v : mesh.getVertices()) {
+			bounds.encapsulate(repo::lib::RepoVector3D64(v.x, v.y, v.z));
+		}
+		EXPECT_THAT(mesh.getBoundingBox() == bounds, IsTrue());
+	}
+	EXPECT_THAT(numFaces, Eq(30 * 30 * 2 * 2));
+}
@@ -0,0 +1,160 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <unit/repo_test_utils.h>
+
+#include <repo/manipulator/modelconvertor/import/repo_metadata_import_csv.h>
+#include <boost/filesystem.hpp>
+#include <fstream>
+
+using namespace repo::lib;
+using namespace repo::manipulator::modelconvertor;
+using namespace testing;
+
+static std::string writeCSV(const std::string& name, const std::string& contents)
+{
+	auto path = boost::filesystem::temp_directory_path() / name;
+	std::ofstream file(path.string(), std::ios::binary);
+	file << contents;
+	return path.string();
+}
+
+TEST(MetadataImportCSV, ConvertToVariant)
+{
+	EXPECT_EQ(boost::get<int64_t>(MetadataImportCSV::convertToVariant("12")), 12);
+	EXPECT_EQ(boost::get<int64_t>(MetadataImportCSV::convertToVariant("-3")), -3);
+	EXPECT_EQ(boost::get<int64_t>(MetadataImportCSV::convertToVariant("+7")), 7);
+	EXPECT_EQ(boost::get<double>(MetadataImportCSV::convertToVariant("2.5")), 2.5);
+	EXPECT_EQ(boost::get<double>(MetadataImportCSV::convertToVariant("1e3")), 1000.0);
+	EXPECT_EQ(boost::get<double>(MetadataImportCSV::convertToVariant("99999999999999999999")), 1e20);
+	EXPECT_EQ(boost::get<std::string>(MetadataImportCSV::convertToVariant("abc")), "abc");
+	EXPECT_EQ(boost::get<std::string>(MetadataImportCSV::convertToVariant("12abc")), "12abc");
+	EXPECT_EQ(boost::get<std::string>(MetadataImportCSV::convertToVariant("")), "");
+	EXPECT_EQ(boost::get<std::string>(MetadataImportCSV::convertToVariant("+-1")), "+-1");
+}
+
+TEST(MetadataImportCSV, QuotedFields)
+{
+	auto path = writeCSV("metadataImportQuoted.csv",
+		"Name,Value,Comment\r\n"
+		"A,1,\"hello, world\"\r\n"
+		"\r\n"
+		"B,2.5,\"multi\nline \"\"quoted\"\"\"\n"
+		"\"C,D\",-3,plain\n");
+
+	MetadataImportCSV importer;
+	std::vector<std::string> headers;
+	std::vector<repo::core::model::MetadataNode> nodes;
+	EXPECT_TRUE(importer.readMetadata(path, headers, [&](std::vector<repo::core::model::MetadataNode>& batch) {
+		nodes.insert(nodes.end(), batch.begin(), batch.end());
+	}));
+
+	EXPECT_THAT(headers, ElementsAre("Name", "Value", "Comment"));
+	ASSERT_THAT(nodes.size(), Eq(3));
+
+	EXPECT_THAT(nodes[0].getName(), Eq("A"));
+	EXPECT_EQ(boost::get<int64_t>(nodes[0].getAllMetadata().at("Value")), 1);
+	EXPECT_EQ(boost::get<std::string>(nodes[0].getAllMetadata().at("Comment")), "hello, world");
+
+	EXPECT_THAT(nodes[1].getName(), Eq("B"));
+	EXPECT_EQ(boost::get<double>(nodes[1].getAllMetadata().at("Value")), 2.5);
+	EXPECT_EQ(boost::get<std::string>(nodes[1].getAllMetadata().at("Comment")), "multi\nline \"quoted\"");
+
+	EXPECT_THAT(nodes[2].getName(), Eq("C,D"));
+	EXPECT_EQ(boost::get<int64_t>(nodes[2].getAllMetadata().at("Value")), -3);
+}
+
+TEST(MetadataImportCSV, UnquotedQuotes)
+{
+	// A quote that is not the first character of a field is a literal, so does
+	// not start a quoted field, even when the file is read in small chunks
+
+	std::string contents = "Name,Size,Comment\n";
+	for (int i = 0; i < 500; i++) {
+		contents += "Pipe" + std::to_string(i) + ",12\",";
+		contents += i % 2 ? "\"6' 2\"\" long\"\n" : "ends with \"\n";
+	}
+	auto path = writeCSV("metadataImportUnquotedQuotes.csv", contents);
+
+	MetadataImportCSV importer;
+	importer.setNumThreads(5);
+	importer.setChunkSize(64);
+
+	std::vector<std::string> headers;
+	std::vector<repo::core::model::MetadataNode> nodes;
+	EXPECT_TRUE(importer.readMetadata(path, headers, [&](std::vector<repo::core::model::MetadataNode>& batch) {
+		nodes.insert(nodes.end(), batch.begin(), batch.end());
+	}));
+
+	ASSERT_THAT(nodes.size(), Eq(500));
+	for (int i = 0; i < 500; i++) {
+		EXPECT_THAT(nodes[i].getName(), Eq("Pipe" + std::to_string(i)));
+		EXPECT_EQ(boost::get<std::string>(nodes[i].getAllMetadata().at("Size")), "12\"");
+		EXPECT_EQ(boost::get<std::string>(nodes[i].getAllMetadata().at("Comment")), i % 2 ? "6' 2\" long" : "ends with \"");
+	}
+}
+
+TEST(MetadataImportCSV, ParallelChunks)
+{
+	// Small chunks and many threads, so records (including quoted fields with
+	// line endings) are split across chunk and window boundaries
+
+	std::string contents = "Name,Index,Comment\n";
+	for (int i = 0; i < 2000; i++) {
+		contents += "Row" + std::to_string(i) + "," + std::to_string(i) + ",";
+		contents += i % 3 ? "\"a,\n\"\"b\"\"\"\n" : "c\n";
+	}
+	auto path = writeCSV("metadataImportParallel.csv", contents);
+
+	MetadataImportCSV importer;
+	importer.setNumThreads(7);
+	importer.setChunkSize(64);
+	importer.setBatchSize(100);
+
+	std::vector<std::string> headers;
+	std::vector<repo::core::model::MetadataNode> nodes;
+	EXPECT_TRUE(importer.readMetadata(path, headers, [&](std::vector<repo::core::model::MetadataNode>& batch) {
+		EXPECT_THAT(batch.size(), Le(100));
+		nodes.insert(nodes.end(), batch.begin(), batch.end());
+	}));
+
+	ASSERT_THAT(nodes.size(), Eq(2000));
+	for (int i = 0; i < 2000; i++) {
+		EXPECT_THAT(nodes[i].getName(), Eq("Row" + std::to_string(i)));
+		EXPECT_EQ(boost::get<int64_t>(nodes[i].getAllMetadata().at("Index")), i);
+		EXPECT_EQ(boost::get<std::string>(nodes[i].getAllMetadata().at("Comment")), i % 3 ? "a,\n\"b\"" : "c");
+	}
+
+	// The set interface should return the same nodes
+
+	headers.clear();
+	auto set = importer.readMetadata(path, headers);
+	EXPECT_THAT(set.size(), Eq(2000));
+	for (auto node : set) {
+		delete node;
+	}
+}
+
+TEST(MetadataImportCSV, MissingFile)
+{
+	MetadataImportCSV importer;
+	std::vector<std::string> headers;
+	EXPECT_FALSE(importer.readMetadata("/this/file/does/not/exist.csv", headers, [](std::vector<repo::core::model::MetadataNode>&) {}));
+	EXPECT_THAT(importer.readMetadata("/this/file/does/not/exist.csv", headers), IsEmpty());
+}
@@ -18,9 +18,14 @@
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest-matchers.h>
+#include <sstream>
+#include <stack>
 #include "repo/error_codes.h"
 #include <repo/manipulator/modelconvertor/import/repo_model_import_3drepo.h>
 #include <repo/manipulator/modelconvertor/import/repo_model_import_manager.h>
+#include <repo/manipulator/modelconvertor/import/repoHelper/parser.h>
+#include <repo/manipulator/modelconvertor/import/repoHelper/decoder.h>
+#include <repo/lib/repo_exception.h>
 #include <repo_log.h>
 #include "../../../../repo_test_utils.h"
 #include "../../../../repo_test_database_info.h"
@@ -37,7 +42,9 @@ namespace RepoModelImportUtils
 {
 	repo::core::model::RepoScene* ImportBIMFile(
 		std::string bimFilePath,
-		uint8_t& impModelErrCode)
+		uint8_t& impModelErrCode,
+		std::string collection = "BIMImportCollection",
+		int numThreads = 0)
 	{
 		ModelImportConfig config(
 			true,
@@ -46,8 +53,9 @@ namespace RepoModelImportUtils
 			0,
 			repo::lib::RepoUUID::createUUID(),
 			"BIMImportTest",
-			"BIMImportCollection"
+			collection
 		);
+		config.numThreads = numThreads;
 
 		auto handler = getHandler();
 
@@ -423,4 +431,107 @@ TEST(RepoModelImport, MetadataParents)
 		SceneUtils scene(RepoModelImportUtils::ImportBIMFile(getDataPath("RepoModelImport/metadata.bim004.bim"), errCode));
 		common::checkMetadataInheritence(scene);
 	}
-}
\ No newline at end of file
+}
+
+TEST(RepoModelImport, Threads)
+{
+	// The blocks are decoded in parallel, but the scene should be the same
+	// regardless of the number of threads
+
+	uint8_t errCode = 0;
+	SceneUtils single(RepoModelImportUtils::ImportBIMFile(getDataPath("RepoModelImport/wall_section_bim4.bim"), errCode, "BIMImportThreads1", 1));
+	EXPECT_EQ(REPOERR_OK, errCode);
+	SceneUtils multiple(RepoModelImportUtils::ImportBIMFile(getDataPath("RepoModelImport/wall_section_bim4.bim"), errCode, "BIMImportThreads8", 8));
+	EXPECT_EQ(REPOERR_OK, errCode);
+
+	EXPECT_THAT(multiple.scene->getWorldOffset(), Eq(single.scene->getWorldOffset()));
+	EXPECT_THAT(multiple.getMeshes().size(), Eq(single.getMeshes().size()));
+
+	for (auto name : { "Wall-Ext_102Bwk-75Ins-100LBlk-12P", "Model Lines" })
+	{
+		auto a = single.findLeafNode(name);
+		auto b = multiple.findLeafNode(name);
+		EXPECT_THAT(b.getPath(), Eq(a.getPath()));
+		EXPECT_THAT(b.getProjectBounds(), Eq(a.getProjectBounds()));
+		EXPECT_THAT(b.getColours(), Eq(a.getColours()));
+	}
+}
+
+TEST(RepoModelImport, PayloadDecoder)
+{
+	std::string data;
+	for (int i = 0; i < 100000; i++) {
+		data.push_back((char)(i * 7));
+	}
+
+	std::vector<repoHelper::Range> ranges;
+	for (size_t s = 0; s < data.size();) {
+		repoHelper::Range r;
+		r.start = s;
+		r.end = std::min(data.size(), s + 1 + (s % 500));
+		ranges.push_back(r);
+		s = r.end + 3;
+	}
+
+	// Payloads over the memory limit are spilled to disk, but should read back
+	// the same
+
+	for (size_t maxMemory : { data.size(), (size_t)1000 })
+	{
+		std::istringstream stream(data);
+		repoHelper::Payload payload(stream, data.size(), maxMemory);
+		EXPECT_THAT(payload.isInMemory(), Eq(maxMemory >= data.size()));
+
+		for (size_t numThreads : { 1, 3, 8 })
+		{
+			// Small batches so the work is split across many of them
+
+			repoHelper::PayloadDecoder decoder(payload, numThreads, 10000);
+
+			std::vector<std::string> decoded(ranges.size());
+			std::vector<size_t> applied;
+			decoder.run(ranges,
+				[&](size_t i, const char* bytes) {
+					decoded[i] = std::string(bytes, ranges[i].size());
+				},
+				[&](size_t i) {
+					EXPECT_THAT(decoded[i], Eq(data.substr(ranges[i].start, ranges[i].size())));
+					applied.push_back(i);
+				}
+			);
+
+			ASSERT_THAT(applied.size(), Eq(ranges.size()));
+			for (size_t i = 0; i < applied.size(); i++) {
+				EXPECT_THAT(applied[i], Eq(i));
+			}
+
+			// Errors on the workers are raised on the calling thread, and nothing
+			// after the failing block is applied
+
+			EXPECT_THROW({
+				decoder.run(ranges,
+					[&](size_t i, const char* bytes) {
+						if (i == 100) {
+							throw repo::lib::RepoException("Decode failed");
+						}
+					},
+					[&](size_t i) {
+						EXPECT_THAT(i, Lt(100));
+					}
+				);
+			}, repo::lib::RepoException);
+		}
+	}
+
+	// Ranges outside the data section, or a section that ends early, are errors
+
+	std::istringstream stream(data);
+	repoHelper::Payload payload(stream, 1000);
+	repoHelper::Range outside;
+	outside.start = 500;
+	outside.end = 2000;
+	EXPECT_THROW(repoHelper::PayloadDecoder(payload, 2).run({ outside }, [](size_t, const char*) {}, [](size_t) {}), repo::lib::RepoException);
+
+	std::istringstream truncated(data.substr(0, 10));
+	EXPECT_THROW(repoHelper::Payload(truncated, 100), repo::lib::RepoException);
+}
@@ -17,6 +17,7 @@
 
 #include <gtest/gtest.h>
 #include <repo/manipulator/modelconvertor/import/repo_model_import_assimp.h>
+#include <repo/manipulator/modelconvertor/import/repo_model_import_manager.h>
 #include <repo_log.h>
 #include "../../../../repo_test_utils.h"
 #include "../../../../repo_test_database_info.h"
@@ -26,6 +27,8 @@
 using namespace repo::manipulator::modelconvertor;
 using namespace testing;
 
+#define TESTDB "AssimpModelImportTest"
+
 namespace RepoModelImportUtils
 {
 	static std::unique_ptr<AssimpModelImport> CreateModelConvertor(
@@ -48,6 +51,35 @@ namespace RepoModelImportUtils
 		auto modelConvertor = std::unique_ptr<AssimpModelImport>(new AssimpModelImport(config));
 		return modelConvertor->importModel(filePath, handler, impModelErrCode);
 	}
+
+	static repo::core::model::RepoScene* ImportAssimpFileStreamed(
+		std::string filePath,
+		std::string collection,
+		bool instanceGeometry = false)
+	{
+		ModelImportConfig config(
+			repo::lib::RepoUUID::createUUID(),
+			TESTDB,
+			collection);
+		config.instanceGeometry = instanceGeometry;
+
+		auto handler = getHandler();
+
+		uint8_t err;
+		std::string msg;
+
+		ModelImportManager manager;
+		auto scene = manager.ImportFromFile(filePath, config, handler, err);
+
+		if (err != REPOERR_OK) {
+			throw repo::lib::RepoImportException(err);
+		}
+
+		scene->commit(handler.get(), handler->getFileManager().get(), msg, "testuser", "", "", config.getRevisionId());
+		scene->loadScene(handler.get(), msg);
+
+		return scene;
+	}
 }
 
 TEST(AssimpModelImport, MainTest)
@@ -305,3 +337,82 @@ TEST(AssimpModelImport, ZGL)
 	EXPECT_TRUE(scene.getRootNode().isLeaf());
 	EXPECT_TRUE(scene.getRootNode().getMeshes().size());
 }
+
+TEST(AssimpModelImport, Streamed)
+{
+	// When the settings name a project, the nodes are written to the database as
+	// they are converted. The scene should be the same as one built in memory.
+
+	SceneUtils memory(RepoModelImportUtils::ImportAssimpFile(getDataPath("cubeHierarchy.blend")));
+	SceneUtils streamed(RepoModelImportUtils::ImportAssimpFileStreamed(getDataPath("cubeHierarchy.blend"), "cubeHierarchy"));
+	EXPECT_TRUE(streamed.isPopulated());
+
+	EXPECT_THAT(streamed.getMeshes().size(), Eq(memory.getMeshes().size()));
+	for (auto name : { "Cube", "Cube.001", "Cube.003", "Cube.007", "Cube.008", "Cube.004", "Cube.006" })
+	{
+		auto a = memory.findLeafNode(name);
+		auto b = streamed.findLeafNode(name);
+		EXPECT_THAT(b.getPath(), Eq(a.getPath()));
+		EXPECT_THAT(b.getProjectBounds(), Eq(a.getProjectBounds()));
+		EXPECT_THAT(b.getColours(), Eq(a.getColours()));
+	}
+
+	// Textures are written along with the materials that reference them
+
+	SceneUtils textured(RepoModelImportUtils::ImportAssimpFileStreamed(getDataPath(texturedModel2), "texturedPlane"));
+	EXPECT_TRUE(textured.isPopulated());
+	EXPECT_FALSE(textured.scene->isMissingTexture());
+
+	bool hasTextures = false;
+	for (auto& mesh : textured.getMeshes()) {
+		hasTextures |= mesh.hasTextures();
+	}
+	EXPECT_TRUE(hasTextures);
+
+	SceneUtils untextured(RepoModelImportUtils::ImportAssimpFileStreamed(getDataPath(texturedModel), "texturedPlaneMissing"));
+	EXPECT_TRUE(untextured.scene->isMissingTexture());
+}
+
+TEST(AssimpModelImport, InstanceGeometry)
+{
+	// Instancing should not change the geometry in project coordinates, but
+	// nodes referencing the same mesh should share its stored vertex data
+
+	auto countBinaries = [](std::string collection) {
+		auto handler = getHandler();
+		auto meshes = handler->findAllByCriteria(TESTDB, collection + "." + REPO_COLLECTION_SCENE,
+			repo::core::handler::database::query::Eq(REPO_NODE_LABEL_TYPE, std::string(REPO_NODE_TYPE_MESH)));
+		std::set<std::string> refs;
+		for (auto& mesh : meshes) {
+			auto ref = mesh.getBinaryReference();
+			refs.insert(ref.getStringField(REPO_LABEL_BINARY_FILENAME) + ":" + std::to_string(ref.getLongField(REPO_LABEL_BINARY_START)));
+		}
+		return std::make_pair(meshes.size(), refs.size());
+	};
+
+	SceneUtils plain(RepoModelImportUtils::ImportAssimpFileStreamed(getDataPath("cubeHierarchy.blend"), "cubeHierarchyInstancingOff"));
+	SceneUtils instanced(RepoModelImportUtils::ImportAssimpFileStreamed(getDataPath("cubeHierarchy.blend"), "cubeHierarchyInstancingOn", true));
+
+	auto plainMeshes = plain.getMeshes();
+	auto instancedMeshes = instanced.getMeshes();
+	ASSERT_THAT(instancedMeshes.size(), Eq(plainMeshes.size()));
+
+	repo::lib::RepoBounds plainBounds, instancedBounds;
+	for (auto& m : plainMeshes) {
+		plainBounds.encapsulate(m.getMeshInProjectCoordinates().getBoundingBox());
+	}
+	for (auto& m : instancedMeshes) {
+		instancedBounds.encapsulate(m.getMeshInProjectCoordinates().getBoundingBox());
+	}
+	EXPECT_THAT(instancedBounds.min(), VectorNear(plainBounds.min(), 0.0001));
+	EXPECT_THAT(instancedBounds.max(), VectorNear(plainBounds.max(), 0.0001));
+
+	// Without instancing, every mesh has its own binary
+
+	auto [numPlainMeshes, numPlainBinaries] = countBinaries("cubeHierarchyInstancingOff");
+	EXPECT_THAT(numPlainBinaries, Eq(numPlainMeshes));
+
+	auto [numInstancedMeshes, numInstancedBinaries] = countBinaries("cubeHierarchyInstancingOn");
+	EXPECT_THAT(numInstancedMeshes, Eq(numPlainMeshes));
+	EXPECT_THAT(numInstancedBinaries, Le(numPlainBinaries));
+}
@@ -22,16 +22,18 @@
 #include "../../../../repo_test_utils.h"
 #include "../../../../repo_test_scene_utils.h"
 #include "../../../../repo_test_common_tests.h"
+#include "../../../../repo_test_matchers.h"
 
 using namespace repo::manipulator::modelconvertor;
 using namespace testing;
 
-repo::core::model::RepoScene* ModelImportManagerImport(std::string db, std::string path)
+repo::core::model::RepoScene* ModelImportManagerImport(std::string db, std::string path, bool instanceGeometry = false)
 {
 	auto config = ModelImportConfig();
 	config.databaseName = "SynchroTestDb";
 	config.revisionId = repo::lib::RepoUUID::createUUID();
 	config.projectName = db;
+	config.instanceGeometry = instanceGeometry;
 
 	auto handler = getHandler();
 
@@ -80,4 +82,54 @@ TEST(SynchroModelImport, MetadataParents)
 		common::checkMetadataInheritence(scene);
 	}
 
-}
\ No newline at end of file
+}
+
+TEST(SynchroModelImport, InstanceGeometry)
+{
+	// Instancing should not change the geometry in project coordinates, but
+	// meshes of the same template should share their stored vertex data
+
+	auto countBinaries = [](std::string project) {
+		auto handler = getHandler();
+		auto meshes = handler->findAllByCriteria("SynchroTestDb", project + "." + REPO_COLLECTION_SCENE,
+			repo::core::handler::database::query::Eq(REPO_NODE_LABEL_TYPE, std::string(REPO_NODE_TYPE_MESH)));
+		std::set<std::string> refs;
+		for (auto& mesh : meshes) {
+			auto ref = mesh.getBinaryReference();
+			refs.insert(ref.getStringField(REPO_LABEL_BINARY_FILENAME) + ":" + std::to_string(ref.getLongField(REPO_LABEL_BINARY_START)));
+		}
+		return std::make_pair(meshes.size(), refs.size());
+	};
+
+	SceneUtils plain(ModelImportManagerImport("SynchroInstancingOff", getDataPath(synchroVersion6_4)));
+	SceneUtils instanced(ModelImportManagerImport("SynchroInstancingOn", getDataPath(synchroVersion6_4), true));
+
+	auto plainMeshes = plain.getMeshes();
+	auto instancedMeshes = instanced.getMeshes();
+	ASSERT_THAT(instancedMeshes.size(), Eq(plainMeshes.size()));
+
+	repo::lib::RepoBounds plainBounds, instancedBounds;
+	for (auto& m : plainMeshes) {
+		plainBounds.encapsulate(m.getMeshInProjectCoordinates().getBoundingBox());
+	}
+	for (auto& m : instancedMeshes) {
+		instancedBounds.encapsulate(m.getMeshInProjectCoordinates().getBoundingBox());
+	}
+	EXPECT_THAT(instancedBounds.min(), VectorNear(plainBounds.min(), 0.001));
+	EXPECT_THAT(instancedBounds.max(), VectorNear(plainBounds.max(), 0.001));
+
+	// Without instancing, every mesh has its own binary
+
+	auto [numPlainMeshes, numPlainBinaries] = countBinaries("SynchroInstancingOff");
+	EXPECT_THAT(numPlainBinaries, Eq(numPlainMeshes));
+
+	auto [numInstancedMeshes, numInstancedBinaries] = countBinaries("SynchroInstancingOn");
+	EXPECT_THAT(numInstancedMeshes, Eq(numPlainMeshes));
+	EXPECT_THAT(numInstancedBinaries, Le(numPlainBinaries));
+
+	// Only templates used more than once are given an extra transformation. Each
+	// such template has at least two instances, which share one binary.
+
+	auto numInstances = instanced.getTransformations().size() - plain.getTransformations().size();
+	EXPECT_THAT(numInstances, Le(2 * (numInstancedMeshes - numInstancedBinaries)));
+}
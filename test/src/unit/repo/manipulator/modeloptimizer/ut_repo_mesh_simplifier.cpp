@@ -0,0 +1,506 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <repo/manipulator/modeloptimizer/repo_mesh_simplifier.h>
+#include <repo/core/model/bson/repo_bson_factory.h>
+#include <repo/core/model/bson/repo_node_supermesh.h>
+
+#include <algorithm>
+#include <cmath>
+#include <set>
+
+using namespace repo::manipulator::modeloptimizer;
+using namespace repo::lib;
+using namespace testing;
+
+struct TestMesh
+{
+	std::vector<RepoVector3D> vertices;
+	std::vector<RepoVector3D> normals;
+	std::vector<std::vector<RepoVector2D>> uvChannels;
+	std::vector<repo_face_t> faces;
+};
+
+// A unit sphere made of rings of quads, with smooth normals. The vertices at
+// the poles are repeated for each segment, so there are degenerate faces there.
+// The poles are set exactly, as sin(pi) is not quite 0 in floating point.
+
+static TestMesh createSphere(uint32_t rings)
+{
+	const float pi = 3.14159265f;
+	TestMesh mesh;
+	for (uint32_t r = 0; r <= rings; r++) {
+		for (uint32_t s = 0; s <= rings * 2; s++) {
+			float theta = pi * r / rings;
+			float phi = pi * s / rings;
+			RepoVector3D p(std::sin(theta) * std::cos(phi), std::sin(theta) * std::sin(phi), std::cos(theta));
+			if (r == 0 || r == rings) {
+				p = RepoVector3D(0, 0, r ? -1.0f : 1.0f);
+			}
+			mesh.vertices.push_back(p);
+			mesh.normals.push_back(p);
+		}
+	}
+	auto index = [&](uint32_t r, uint32_t s) { return r * (rings * 2 + 1) + s; };
+	for (uint32_t r = 0; r < rings; r++) {
+		for (uint32_t s = 0; s < rings * 2; s++) {
+			mesh.faces.push_back({ index(r, s), index(r + 1, s), index(r + 1, s + 1) });
+			mesh.faces.push_back({ index(r, s), index(r + 1, s + 1), index(r, s + 1) });
+		}
+	}
+	return mesh;
+}
+
+// A flat grid of n by n quads on the xy plane, starting at x, with uvs that
+// are unique to the grid.
+
+static void appendGrid(TestMesh& mesh, uint32_t n, float x, float u)
+{
+	uint32_t base = mesh.vertices.size();
+	mesh.uvChannels.resize(1);
+	for (uint32_t j = 0; j <= n; j++) {
+		for (uint32_t i = 0; i <= n; i++) {
+			mesh.vertices.push_back({ x + i, (float)j, 0 });
+			mesh.normals.push_back({ 0, 0, 1 });
+			mesh.uvChannels[0].push_back({ u + (float)i / n, (float)j / n });
+		}
+	}
+	for (uint32_t j = 0; j < n; j++) {
+		for (uint32_t i = 0; i < n; i++) {
+			uint32_t a = base + j * (n + 1) + i;
+			mesh.faces.push_back({ a, a + 1, a + n + 2 });
+			mesh.faces.push_back({ a, a + n + 2, a + n + 1 });
+		}
+	}
+}
+
+static double triangleArea(const RepoVector3D& a, const RepoVector3D& b, const RepoVector3D& c)
+{
+	auto ab = b - a;
+	return ab.crossProduct(c - a).norm() * 0.5;
+}
+
+static double closestPointDistance(const RepoVector3D& p, const RepoVector3D& a, const RepoVector3D& b, const RepoVector3D& c)
+{
+	// Closest point on a triangle, from Ericson, Real-Time Collision Detection
+
+	auto ab = b - a;
+	auto ac = c - a;
+	auto ap = p - a;
+	double d1 = ab.dotProduct(ap);
+	double d2 = ac.dotProduct(ap);
+	if (d1 <= 0 && d2 <= 0) {
+		return ap.norm();
+	}
+	auto bp = p - b;
+	double d3 = ab.dotProduct(bp);
+	double d4 = ac.dotProduct(bp);
+	if (d3 >= 0 && d4 <= d3) {
+		return bp.norm();
+	}
+	auto cp = p - c;
+	double d5 = ab.dotProduct(cp);
+	double d6 = ac.dotProduct(cp);
+	if (d6 >= 0 && d5 <= d6) {
+		return cp.norm();
+	}
+
+	auto at = [&](const RepoVector3D& o, const RepoVector3D& e, double t) {
+		return (p - (o + RepoVector3D(e.x * t, e.y * t, e.z * t))).norm();
+	};
+
+	double vc = d1 * d4 - d3 * d2;
+	if (vc <= 0 && d1 >= 0 && d3 <= 0) {
+		return at(a, ab, d1 / (d1 - d3));
+	}
+	double vb = d5 * d2 - d1 * d6;
+	if (vb <= 0 && d2 >= 0 && d6 <= 0) {
+		return at(a, ac, d2 / (d2 - d6));
+	}
+	double va = d3 * d6 - d5 * d4;
+	if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0) {
+		return at(b, c - b, (d4 - d3) / ((d4 - d3) + (d5 - d6)));
+	}
+	double v = vb / (va + vb + vc);
+	double w = vc / (va + vb + vc);
+	auto q = a + RepoVector3D(ab.x * v + ac.x * w, ab.y * v + ac.y * w, ab.z * v + ac.z * w);
+	return (p - q).norm();
+}
+
+// The largest distance from a vertex of the original mesh to the simplified
+// surface
+
+static double maxDistance(
+	const std::vector<RepoVector3D>& vertices,
+	const std::vector<RepoVector3D>& simplifiedVertices,
+	const std::vector<repo_face_t>& simplifiedFaces)
+{
+	double result = 0;
+	for (const auto& p : vertices) {
+		double d = DBL_MAX;
+		for (const auto& f : simplifiedFaces) {
+			d = std::min(d, closestPointDistance(p, simplifiedVertices[f[0]], simplifiedVertices[f[1]], simplifiedVertices[f[2]]));
+		}
+		result = std::max(result, d);
+	}
+	return result;
+}
+
+TEST(MeshSimplifier, FlatGrid)
+{
+	// A flat surface can be simplified to two triangles without any error, and
+	// the boundary must be kept, so the area stays the same
+
+	TestMesh mesh;
+	appendGrid(mesh, 20, 0, 0);
+
+	float error = -1;
+	auto faces = MeshSimplifier().simplify(mesh.vertices, mesh.normals, mesh.uvChannels, mesh.faces, 0, mesh.faces.size(), 0, 0, error);
+
+	EXPECT_THAT(faces.size(), Eq(2));
+	EXPECT_THAT(error, FloatNear(0, 1e-6));
+
+	double area = 0;
+	for (const auto& f : faces) {
+		area += triangleArea(mesh.vertices[f[0]], mesh.vertices[f[1]], mesh.vertices[f[2]]);
+	}
+	EXPECT_THAT(area, DoubleNear(400, 1e-3));
+}
+
+TEST(MeshSimplifier, GeometricError)
+{
+	// Regression test for the error of the simplified sphere. The reported
+	// error must be the actual distance of the original vertices from the
+	// simplified surface, and should stay within the values measured when the
+	// simplifier was written.
+
+	auto mesh = createSphere(48);
+
+	struct Expected {
+		float ratio;
+		float maxError;
+		float maxDistance;
+	};
+
+	for (auto expected : { Expected{ 0.5f, 0.016f, 0.005f }, Expected{ 0.25f, 0.025f, 0.01f }, Expected{ 0.1f, 0.08f, 0.022f } }) {
+		auto target = (size_t)(mesh.faces.size() * expected.ratio);
+		float error;
+		auto faces = MeshSimplifier().simplify(mesh.vertices, mesh.normals, mesh.uvChannels, mesh.faces, 0, mesh.faces.size(), target, 1, error);
+
+		EXPECT_THAT(faces.size(), Le(target));
+		EXPECT_THAT(faces.size(), Gt(target * 0.9));
+		EXPECT_THAT(error, Lt(expected.maxError));
+
+		auto distance = maxDistance(mesh.vertices, mesh.vertices, faces);
+		EXPECT_THAT(distance, DoubleNear(error, 1e-5));
+		EXPECT_THAT(distance, Lt(expected.maxDistance));
+
+		// Every face must still face outwards
+
+		for (const auto& f : faces) {
+			auto a = mesh.vertices[f[0]];
+			auto ab = mesh.vertices[f[1]] - a;
+			auto n = ab.crossProduct(mesh.vertices[f[2]] - a);
+			EXPECT_THAT(n.dotProduct(a), Gt(0));
+		}
+	}
+
+	// Levels built from other levels are measured against the original, so
+	// the error of each is the distance of the sphere from it, however many
+	// levels there are in between
+
+	RepoBounds bounds;
+	for (const auto& v : mesh.vertices) {
+		bounds.encapsulate(v);
+	}
+	std::vector<repo_mesh_mapping_t> mapping(1);
+	mapping[0].mesh_id = RepoUUID::createUUID();
+	mapping[0].vertFrom = 0;
+	mapping[0].vertTo = mesh.vertices.size();
+	mapping[0].triFrom = 0;
+	mapping[0].triTo = mesh.faces.size();
+	auto supermesh = repo::core::model::RepoBSONFactory::makeSupermeshNode(mesh.vertices, mesh.faces, mesh.normals, bounds, mesh.uvChannels, "", mapping);
+
+	MeshSimplifier simplifier;
+	auto level = simplifier.simplifyGeometry(*supermesh, 0.5f, 1);
+	float previous = 0;
+	for (int i = 0; i < 3; i++) {
+		ASSERT_TRUE(level.has_value());
+		auto distance = maxDistance(mesh.vertices, level->vertices, level->faces);
+		EXPECT_THAT(distance, DoubleNear(level->error, 1e-5));
+		EXPECT_THAT(level->error, Gt(previous));
+		previous = level->error;
+		level = simplifier.simplifyGeometry(*level, *supermesh, 0.5f, 1);
+	}
+}
+
+TEST(MeshSimplifier, MaxError)
+{
+	// Simplification should stop short of the target rather than exceed the
+	// error allowed
+
+	auto mesh = createSphere(32);
+
+	float error;
+	auto faces = MeshSimplifier().simplify(mesh.vertices, mesh.normals, mesh.uvChannels, mesh.faces, 0, mesh.faces.size(), 0, 0.01f, error);
+
+	EXPECT_THAT(error, Le(0.01f));
+	EXPECT_THAT(faces.size(), Lt(mesh.faces.size()));
+	EXPECT_THAT(faces.size(), Gt(100));
+	EXPECT_THAT(maxDistance(mesh.vertices, mesh.vertices, faces), Le(0.01f + 1e-5));
+}
+
+TEST(MeshSimplifier, UVSeams)
+{
+	// Two grids sharing an edge, with different uvs either side, should not
+	// have any faces spanning both once simplified
+
+	TestMesh mesh;
+	appendGrid(mesh, 10, 0, 0);
+	appendGrid(mesh, 10, 10, 5);
+	for (auto& v : mesh.vertices) {
+		v.z = std::sin(v.x * 0.5f) * std::cos(v.y * 0.3f); // So the grids don't simplify to nothing
+	}
+	auto split = mesh.vertices.size() / 2;
+
+	float error;
+	auto faces = MeshSimplifier().simplify(mesh.vertices, mesh.normals, mesh.uvChannels, mesh.faces, 0, mesh.faces.size(), mesh.faces.size() / 8, 1, error);
+
+	EXPECT_THAT(faces.size(), Lt(mesh.faces.size() / 2));
+	std::set<uint32_t> sides;
+	for (const auto& f : faces) {
+		sides.insert(f[0] < split);
+		EXPECT_THAT(f[0] < split, Eq(f[1] < split));
+		EXPECT_THAT(f[0] < split, Eq(f[2] < split));
+	}
+	EXPECT_THAT(sides.size(), Eq(2));
+}
+
+TEST(MeshSimplifier, HardEdges)
+{
+	// A flat shaded cube with subdivided sides has separate vertices for each
+	// side at the edges. It should reduce to the 12 triangles of a cube without
+	// mixing the normals of the sides.
+
+	TestMesh mesh;
+	const uint32_t n = 6;
+	for (int axis = 0; axis < 3; axis++) {
+		for (float sign : { -1.0f, 1.0f }) {
+			uint32_t base = mesh.vertices.size();
+			for (uint32_t i = 0; i <= n; i++) {
+				for (uint32_t j = 0; j <= n; j++) {
+					float p[3];
+					float normal[3] = { 0, 0, 0 };
+					p[axis] = sign;
+					p[(axis + 1) % 3] = -1 + 2.0f * i / n;
+					p[(axis + 2) % 3] = -1 + 2.0f * j / n;
+					normal[axis] = sign;
+					mesh.vertices.push_back({ p[0], p[1], p[2] });
+					mesh.normals.push_back({ normal[0], normal[1], normal[2] });
+				}
+			}
+			for (uint32_t i = 0; i < n; i++) {
+				for (uint32_t j = 0; j < n; j++) {
+					uint32_t a = base + i * (n + 1) + j;
+					if (sign > 0) {
+						mesh.faces.push_back({ a, a + n + 1, a + n + 2 });
+						mesh.faces.push_back({ a, a + n + 2, a + 1 });
+					}
+					else {
+						mesh.faces.push_back({ a, a + n + 2, a + n + 1 });
+						mesh.faces.push_back({ a, a + 1, a + n + 2 });
+					}
+				}
+			}
+		}
+	}
+
+	float error;
+	auto faces = MeshSimplifier().simplify(mesh.vertices, mesh.normals, mesh.uvChannels, mesh.faces, 0, mesh.faces.size(), 0, 0, error);
+
+	EXPECT_THAT(faces.size(), Eq(12));
+	EXPECT_THAT(error, FloatNear(0, 1e-6));
+	for (const auto& f : faces) {
+		EXPECT_THAT(mesh.normals[f[0]], Eq(mesh.normals[f[1]]));
+		EXPECT_THAT(mesh.normals[f[0]], Eq(mesh.normals[f[2]]));
+	}
+}
+
+TEST(MeshSimplifier, Range)
+{
+	// Only the faces in the range should be simplified, and the result should
+	// reference the same vertices
+
+	auto mesh = createSphere(16);
+	auto begin = mesh.faces.size();
+	appendGrid(mesh, 10, 5, 0);
+
+	float error;
+	auto faces = MeshSimplifier().simplify(mesh.vertices, mesh.normals, mesh.uvChannels, mesh.faces, begin, mesh.faces.size(), 0, 0, error);
+
+	EXPECT_THAT(faces.size(), Eq(2));
+	for (const auto& f : faces) {
+		for (uint32_t i = 0; i < 3; i++) {
+			EXPECT_THAT(f[i], Ge(mesh.faces[begin][0]));
+		}
+	}
+}
+
+TEST(MeshSimplifier, Supermesh)
+{
+	// Each submesh should be simplified separately, with the vertices compacted
+	// and the mapping ranges updated to match
+
+	auto sphere = createSphere(24);
+	TestMesh grid;
+	appendGrid(grid, 10, 5, 0);
+
+	TestMesh mesh = sphere;
+	std::vector<repo_mesh_mapping_t> mapping(3);
+	mapping[0].mesh_id = RepoUUID::createUUID();
+	mapping[0].shared_id = RepoUUID::createUUID();
+	mapping[0].vertFrom = 0;
+	mapping[0].vertTo = mesh.vertices.size();
+	mapping[0].triFrom = 0;
+	mapping[0].triTo = mesh.faces.size();
+
+	// An empty submesh, which should keep its entry
+
+	mapping[1].mesh_id = RepoUUID::createUUID();
+	mapping[1].vertFrom = mesh.vertices.size();
+	mapping[1].vertTo = mesh.vertices.size();
+	mapping[1].triFrom = mesh.faces.size();
+	mapping[1].triTo = mesh.faces.size();
+
+	mapping[2].mesh_id = RepoUUID::createUUID();
+	mapping[2].vertFrom = mesh.vertices.size();
+	mapping[2].triFrom = mesh.faces.size();
+	for (auto f : grid.faces) {
+		for (uint32_t i = 0; i < 3; i++) {
+			f[i] += mapping[2].vertFrom;
+		}
+		mesh.faces.push_back(f);
+	}
+	mesh.vertices.insert(mesh.vertices.end(), grid.vertices.begin(), grid.vertices.end());
+	mesh.normals.insert(mesh.normals.end(), grid.normals.begin(), grid.normals.end());
+	mesh.uvChannels.resize(1);
+	mesh.uvChannels[0].resize(sphere.vertices.size());
+	mesh.uvChannels[0].insert(mesh.uvChannels[0].end(), grid.uvChannels[0].begin(), grid.uvChannels[0].end());
+	mapping[2].vertTo = mesh.vertices.size();
+	mapping[2].triTo = mesh.faces.size();
+
+	RepoBounds bounds;
+	for (const auto& v : mesh.vertices) {
+		bounds.encapsulate(v);
+	}
+
+	auto supermesh = repo::core::model::RepoBSONFactory::makeSupermeshNode(mesh.vertices, mesh.faces, mesh.normals, bounds, mesh.uvChannels, "", mapping);
+
+	MeshSimplifier simplifier;
+	auto lod1 = simplifier.simplify(*supermesh, 0.25f, 1);
+	ASSERT_THAT(lod1, NotNull());
+
+	EXPECT_THAT(lod1->getLodLevel(), Eq(1u));
+	EXPECT_THAT(lod1->getLodSource(), Eq(supermesh->getUniqueID()));
+	EXPECT_THAT(lod1->getLodError(), Gt(0));
+	EXPECT_THAT(lod1->getBoundingBox(), Eq(supermesh->getBoundingBox()));
+	EXPECT_THAT(lod1->getNumFaces(), Lt(supermesh->getNumFaces() / 3));
+	EXPECT_THAT(lod1->getNumVertices(), Lt(supermesh->getNumVertices() / 3));
+	EXPECT_THAT(lod1->getNormals().size(), Eq(lod1->getNumVertices()));
+	ASSERT_THAT(lod1->getUVChannelsSeparated().size(), Eq(1));
+	EXPECT_THAT(lod1->getUVChannelsSeparated()[0].size(), Eq(lod1->getNumVertices()));
+
+	auto lodMapping = lod1->getMeshMapping();
+	ASSERT_THAT(lodMapping.size(), Eq(mapping.size()));
+	uint32_t vertices = 0, triangles = 0;
+	auto faces = lod1->getFaces();
+	for (size_t i = 0; i < mapping.size(); i++) {
+		EXPECT_THAT(lodMapping[i].mesh_id, Eq(mapping[i].mesh_id));
+		EXPECT_THAT(lodMapping[i].shared_id, Eq(mapping[i].shared_id));
+		EXPECT_THAT((uint32_t)lodMapping[i].vertFrom, Eq(vertices));
+		EXPECT_THAT((uint32_t)lodMapping[i].triFrom, Eq(triangles));
+		for (auto f = lodMapping[i].triFrom; f < lodMapping[i].triTo; f++) {
+			for (uint32_t j = 0; j < 3; j++) {
+				EXPECT_THAT(faces[f][j], AllOf(Ge((uint32_t)lodMapping[i].vertFrom), Lt((uint32_t)lodMapping[i].vertTo)));
+			}
+		}
+		vertices = lodMapping[i].vertTo;
+		triangles = lodMapping[i].triTo;
+	}
+	EXPECT_THAT(vertices, Eq(lod1->getNumVertices()));
+	EXPECT_THAT(triangles, Eq(lod1->getNumFaces()));
+	EXPECT_THAT(lodMapping[1].triTo - lodMapping[1].triFrom, Eq(0));
+	EXPECT_THAT(lodMapping[2].triTo - lodMapping[2].triFrom, AllOf(Gt(0), Le(50)));
+
+	// The geometry can be built without creating a node, from the original or
+	// from the level before it, as long as the original is given to measure
+	// the error against
+
+	auto level1 = simplifier.simplifyGeometry(*supermesh, 0.25f, 1);
+	ASSERT_TRUE(level1.has_value());
+	EXPECT_THAT(level1->faces, Eq(lod1->getFaces()));
+	EXPECT_THAT(level1->vertices, Eq(lod1->getVertices()));
+	EXPECT_THAT(level1->error, Eq(lod1->getLodError()));
+
+	auto level2 = simplifier.simplifyGeometry(*level1, *supermesh, 0.25f, 1);
+	ASSERT_TRUE(level2.has_value());
+	EXPECT_THAT(level2->faces.size(), Lt(level1->faces.size()));
+	EXPECT_THAT(level2->error, Gt(level1->error));
+
+	// Levels made from other levels refer back to the original, and their
+	// error never decreases
+
+	auto lod2 = MeshSimplifier::makeLevelOfDetail(*lod1, *level2);
+	EXPECT_THAT(lod2->getLodLevel(), Eq(2u));
+	EXPECT_THAT(lod2->getLodSource(), Eq(supermesh->getUniqueID()));
+	EXPECT_THAT(lod2->getLodError(), Eq(level2->error));
+	EXPECT_THAT(lod2->getUniqueID(), Ne(lod1->getUniqueID()));
+
+	auto lod3 = MeshSimplifier::makeLevelOfDetail(*lod2, MeshSimplifier::Level(*level1));
+	EXPECT_THAT(lod3->getLodLevel(), Eq(3u));
+	EXPECT_THAT(lod3->getLodError(), Eq(lod2->getLodError()));
+
+	// Without the original, a level cannot be simplified any further
+
+	EXPECT_THAT(simplifier.simplify(*lod1, 0.25f, 1), IsNull());
+}
+
+TEST(MeshSimplifier, NoTriangles)
+{
+	std::vector<RepoVector3D> vertices = { { 0, 0, 0 }, { 1, 0, 0 }, { 1, 1, 0 } };
+	std::vector<repo_face_t> lines = { { 0, 1 }, { 1, 2 } };
+	std::vector<repo_mesh_mapping_t> mapping(1);
+	mapping[0].vertFrom = 0;
+	mapping[0].vertTo = 3;
+	mapping[0].triFrom = 0;
+	mapping[0].triTo = 2;
+
+	auto supermesh = repo::core::model::RepoBSONFactory::makeSupermeshNode(vertices, lines, {}, RepoBounds(vertices[0], vertices[2]), {}, "", mapping);
+	EXPECT_THAT(MeshSimplifier().simplify(*supermesh, 0.5f, 1), IsNull());
+
+	// Lines within a range of triangles are passed through. The triangle cannot
+	// be removed without moving its boundary.
+
+	std::vector<repo_face_t> faces = { { 0, 1, 2 }, { 0, 2 } };
+	float error;
+	auto result = MeshSimplifier().simplify(vertices, {}, {}, faces, 0, faces.size(), 0, 0, error);
+	ASSERT_THAT(result.size(), Eq(2));
+	EXPECT_THAT(result[0].size(), Eq(3));
+	EXPECT_THAT(result[1].size(), Eq(2));
+}
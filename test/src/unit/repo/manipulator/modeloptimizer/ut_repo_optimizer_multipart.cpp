@@ -18,9 +18,12 @@
 #include <gtest/gtest.h>
 #include <cstdlib>
 #include <repo/manipulator/modeloptimizer/repo_optimizer_multipart.h>
+#include <repo/manipulator/modeloptimizer/repo_vertex_cache_optimizer.h>
 #include <limits>
+#include <random>
 #include <test/src/unit/repo_test_mesh_utils.h>
 #include <repo/core/model/bson/repo_bson_factory.h>
+#include <repo/core/model/bson/repo_bson_builder.h>
 #include <repo/manipulator/modelutility/repo_scene_builder.h>
 #include <test/src/unit/repo_test_database_info.h>
 
@@ -527,4 +530,359 @@ TEST(MultipartOptimizer, TestGroupings)
 		projectName,
 		revId,
 		mockExporter.get()));
-}
\ No newline at end of file
+}
+
+TEST(MultipartOptimizer, TestReuseUnchangedClusters)
+{
+	auto handler = getHandler();
+	std::string database = DBMULTIPARTOPTIMIZERTEST;
+	std::string projectName = "TestReuseUnchangedClusters";
+
+	auto rootNode = repo::core::model::RepoBSONFactory::makeTransformationNode({}, "rootNode", {});
+	auto rootNodeId = rootNode.getSharedID();
+
+	std::vector<repo::core::model::MeshNode> meshes;
+	for (int i = 0; i < 3; ++i) {
+		meshes.push_back(*createRandomMesh(10, false, 3, "", { rootNodeId }));
+	}
+
+	// The last mesh is textured. The texture gets a new id with each revision,
+	// as it would when imported again.
+
+	std::vector<char> image(256, 7);
+	meshes.push_back(*createRandomMesh(10, true, 3, "", { rootNodeId }));
+
+	std::vector<repo::lib::RepoUUID> texIds;
+
+	// Commits the meshes as a new revision, with new unique ids, following the
+	// previous revision (if any)
+
+	auto commitRevision = [&](const std::vector<repo::core::model::MeshNode>& meshes, repo::lib::RepoUUID previousRevId) {
+		auto revId = repo::lib::RepoUUID::createUUID();
+		auto sceneBuilder = repo::manipulator::modelutility::RepoSceneBuilder(handler, database, projectName, revId);
+
+		auto root = rootNode;
+		root.setUniqueID(repo::lib::RepoUUID::createUUID());
+		sceneBuilder.addNode(root);
+
+		auto texture = repo::core::model::RepoBSONFactory::makeTextureNode("texture", image.data(), image.size(), 8, 8, { rootNodeId });
+		sceneBuilder.addNode(texture);
+		texIds.push_back(texture.getUniqueID());
+
+		for (auto mesh : meshes) {
+			mesh.setUniqueID(repo::lib::RepoUUID::createUUID());
+			if (mesh.getNumUVChannels()) {
+				mesh.setTextureId(texture.getUniqueID());
+			}
+			sceneBuilder.addNode(mesh);
+		}
+
+		sceneBuilder.finalise();
+
+		repo::core::model::RepoBSONBuilder revision;
+		revision.append(REPO_NODE_LABEL_ID, revId);
+		if (!previousRevId.isDefaultValue()) {
+			revision.appendArray(REPO_NODE_LABEL_PARENTS, std::vector<repo::lib::RepoUUID>({ previousRevId }));
+		}
+		handler->insertDocument(database, projectName + "." + REPO_COLLECTION_HISTORY, revision.obj());
+
+		return revId;
+	};
+
+	// The first revision has nothing to reuse
+
+	auto revId1 = commitRevision(meshes, {});
+	auto exporter1 = std::make_unique<TestModelExport>(handler.get(), database, projectName, revId1, std::vector<double>({ 0, 0, 0 }));
+	exporter1->setReuseSupermeshes(true);
+	EXPECT_TRUE(MultipartOptimizer().processScene(database, projectName, revId1, handler.get(), exporter1.get()));
+	EXPECT_EQ(exporter1->getSupermeshCount(), 2);
+	EXPECT_EQ(exporter1->getExistingSupermeshes().size(), 0);
+
+	auto countClusterDocuments = [&](repo::lib::RepoUUID revId) {
+		return handler->findAllByCriteria(database, projectName + "." + REPO_COLLECTION_STASH_CLUSTERS,
+			repo::core::handler::database::query::Eq(REPO_NODE_REVISION_ID, revId)).size();
+	};
+	EXPECT_EQ(countClusterDocuments(revId1), 2);
+
+	// An identical revision should reuse the supermeshes, mapped to the new nodes
+	// and texture
+
+	auto revId2 = commitRevision(meshes, revId1);
+	auto exporter2 = std::make_unique<TestModelExport>(handler.get(), database, projectName, revId2, std::vector<double>({ 0, 0, 0 }));
+	exporter2->setReuseSupermeshes(true);
+	EXPECT_TRUE(MultipartOptimizer().processScene(database, projectName, revId2, handler.get(), exporter2.get()));
+	EXPECT_EQ(exporter2->getSupermeshCount(), 0);
+	ASSERT_EQ(exporter2->getExistingSupermeshes().size(), 2);
+
+	for (size_t s = 0; s < 2; s++) {
+		auto original = exporter1->getSupermeshes()[s].getMeshMapping();
+		auto reused = exporter2->getExistingSupermeshes()[s];
+		ASSERT_EQ(reused.size(), original.size());
+		for (size_t i = 0; i < reused.size(); i++) {
+			EXPECT_EQ(reused[i].vertFrom, original[i].vertFrom);
+			EXPECT_EQ(reused[i].vertTo, original[i].vertTo);
+			EXPECT_EQ(reused[i].triFrom, original[i].triFrom);
+			EXPECT_EQ(reused[i].triTo, original[i].triTo);
+			EXPECT_NE(reused[i].mesh_id, original[i].mesh_id);
+			EXPECT_EQ(reused[i].texture_id, original[i].texture_id.isDefaultValue() ? repo::lib::RepoUUID() : texIds[1]);
+		}
+	}
+
+	// As nothing changed, the revision refers to the clusters of the first
+	// instead of storing them again
+
+	EXPECT_EQ(countClusterDocuments(revId2), 1);
+
+	// Changing one mesh changes the membership of its cluster, so it should be
+	// rebuilt, while the textured cluster is still reused
+
+	meshes[0] = *createRandomMesh(10, false, 3, "", { rootNodeId });
+	auto revId3 = commitRevision(meshes, revId2);
+	auto exporter3 = std::make_unique<TestModelExport>(handler.get(), database, projectName, revId3, std::vector<double>({ 0, 0, 0 }));
+	exporter3->setReuseSupermeshes(true);
+	EXPECT_TRUE(MultipartOptimizer().processScene(database, projectName, revId3, handler.get(), exporter3.get()));
+	EXPECT_EQ(exporter3->getSupermeshCount(), 1);
+	EXPECT_EQ(exporter3->getExistingSupermeshes().size(), 1);
+	EXPECT_EQ(countClusterDocuments(revId3), 2);
+
+	// Exporters that don't support reuse always get the full geometry
+
+	auto revId4 = commitRevision(meshes, revId3);
+	auto exporter4 = std::make_unique<TestModelExport>(handler.get(), database, projectName, revId4, std::vector<double>({ 0, 0, 0 }));
+	EXPECT_TRUE(MultipartOptimizer().processScene(database, projectName, revId4, handler.get(), exporter4.get()));
+	EXPECT_EQ(exporter4->getSupermeshCount(), 2);
+	EXPECT_TRUE(compareMeshes(database, projectName, revId4, exporter4.get()));
+	EXPECT_EQ(countClusterDocuments(revId4), 0);
+}
+
+TEST(MultipartOptimizer, TestThreadCountDeterministic)
+{
+	// The BVHs may be built with any number of threads, but the stash should be
+	// the same whatever the number, so it remains reproducible
+
+	auto handler = getHandler();
+	std::string database = DBMULTIPARTOPTIMIZERTEST;
+	std::string projectName = "TestThreadCountDeterministic";
+	auto revId = repo::lib::RepoUUID::createUUID();
+
+	auto sceneBuilder = repo::manipulator::modelutility::RepoSceneBuilder(handler, database, projectName, revId);
+
+	auto rootNode = repo::core::model::RepoBSONFactory::makeTransformationNode({}, "rootNode", {});
+	sceneBuilder.addNode(rootNode);
+	auto rootNodeId = rootNode.getSharedID();
+
+	for (int i = 0; i < 200; i++) {
+		sceneBuilder.addNode(createRandomMesh(500, false, 3, "", { rootNodeId }));
+	}
+	sceneBuilder.addNode(createRandomMesh(128537, false, 3, "", { rootNodeId }));
+
+	sceneBuilder.finalise();
+
+	auto singleThreaded = std::make_unique<TestModelExport>(handler.get(), database, projectName, revId, std::vector<double>({ 0, 0, 0 }));
+	EXPECT_TRUE(MultipartOptimizer(1).processScene(database, projectName, revId, handler.get(), singleThreaded.get()));
+
+	auto multiThreaded = std::make_unique<TestModelExport>(handler.get(), database, projectName, revId, std::vector<double>({ 0, 0, 0 }));
+	EXPECT_TRUE(MultipartOptimizer(8).processScene(database, projectName, revId, handler.get(), multiThreaded.get()));
+
+	auto a = singleThreaded->getSupermeshes();
+	auto b = multiThreaded->getSupermeshes();
+	ASSERT_EQ(a.size(), b.size());
+	for (size_t i = 0; i < a.size(); i++) {
+		EXPECT_EQ(a[i].getVertices(), b[i].getVertices());
+		EXPECT_EQ(a[i].getFaces(), b[i].getFaces());
+
+		auto mappingA = a[i].getMeshMapping();
+		auto mappingB = b[i].getMeshMapping();
+		ASSERT_EQ(mappingA.size(), mappingB.size());
+		for (size_t j = 0; j < mappingA.size(); j++) {
+			EXPECT_EQ(mappingA[j].mesh_id, mappingB[j].mesh_id);
+			EXPECT_EQ(mappingA[j].vertFrom, mappingB[j].vertFrom);
+			EXPECT_EQ(mappingA[j].vertTo, mappingB[j].vertTo);
+			EXPECT_EQ(mappingA[j].triFrom, mappingB[j].triFrom);
+			EXPECT_EQ(mappingA[j].triTo, mappingB[j].triTo);
+		}
+	}
+
+	EXPECT_TRUE(compareMeshes(database, projectName, revId, multiThreaded.get()));
+}
+
+TEST(MultipartOptimizer, TestVertexCacheOptimisation)
+{
+	// The supermeshes should be drawn with fewer vertex transforms when the
+	// vertex cache stage is enabled, but hold the same geometry with the same
+	// mapping ranges
+
+	auto handler = getHandler();
+	std::string database = DBMULTIPARTOPTIMIZERTEST;
+	std::string projectName = "TestVertexCacheOptimisation";
+	auto revId = repo::lib::RepoUUID::createUUID();
+
+	auto sceneBuilder = repo::manipulator::modelutility::RepoSceneBuilder(handler, database, projectName, revId);
+
+	auto rootNode = repo::core::model::RepoBSONFactory::makeTransformationNode({}, "rootNode", {});
+	sceneBuilder.addNode(rootNode);
+	auto rootNodeId = rootNode.getSharedID();
+
+	// Grids with shuffled faces, as a worst case for the cache
+
+	std::mt19937 rng(0);
+	for (int m = 0; m < 10; m++) {
+		const uint32_t n = 20;
+		std::vector<repo::lib::RepoVector3D> vertices;
+		std::vector<repo::lib::repo_face_t> faces;
+		repo::lib::RepoBounds bounds;
+		for (uint32_t y = 0; y <= n; y++) {
+			for (uint32_t x = 0; x <= n; x++) {
+				vertices.push_back({ (float)x, (float)y, (float)m });
+				bounds.encapsulate(vertices.back());
+			}
+		}
+		for (uint32_t y = 0; y < n; y++) {
+			for (uint32_t x = 0; x < n; x++) {
+				uint32_t i = y * (n + 1) + x;
+				faces.push_back({ i, i + 1, i + n + 2 });
+				faces.push_back({ i, i + n + 2, i + n + 1 });
+			}
+		}
+		std::shuffle(faces.begin(), faces.end(), rng);
+		sceneBuilder.addNode(repo::core::model::RepoBSONFactory::makeMeshNode(vertices, faces, {}, bounds, {}, "", { rootNodeId }));
+	}
+
+	sceneBuilder.finalise();
+
+	auto optimised = std::make_unique<TestModelExport>(handler.get(), database, projectName, revId, std::vector<double>({ 0, 0, 0 }));
+	EXPECT_TRUE(MultipartOptimizer(0, true).processScene(database, projectName, revId, handler.get(), optimised.get()));
+
+	auto unoptimised = std::make_unique<TestModelExport>(handler.get(), database, projectName, revId, std::vector<double>({ 0, 0, 0 }));
+	EXPECT_TRUE(MultipartOptimizer(0, false).processScene(database, projectName, revId, handler.get(), unoptimised.get()));
+
+	EXPECT_TRUE(compareMeshes(database, projectName, revId, optimised.get()));
+	EXPECT_TRUE(compareMeshes(database, projectName, revId, unoptimised.get()));
+
+	auto a = optimised->getSupermeshes();
+	auto b = unoptimised->getSupermeshes();
+	ASSERT_EQ(a.size(), b.size());
+	for (size_t i = 0; i < a.size(); i++) {
+		auto mappingA = a[i].getMeshMapping();
+		auto mappingB = b[i].getMeshMapping();
+		ASSERT_EQ(mappingA.size(), mappingB.size());
+		for (size_t j = 0; j < mappingA.size(); j++) {
+			EXPECT_EQ(mappingA[j].mesh_id, mappingB[j].mesh_id);
+			EXPECT_EQ(mappingA[j].vertFrom, mappingB[j].vertFrom);
+			EXPECT_EQ(mappingA[j].vertTo, mappingB[j].vertTo);
+			EXPECT_EQ(mappingA[j].triFrom, mappingB[j].triFrom);
+			EXPECT_EQ(mappingA[j].triTo, mappingB[j].triTo);
+		}
+
+		auto acmrA = VertexCacheOptimizer::simulate(a[i].getFaces(), 16).acmr();
+		auto acmrB = VertexCacheOptimizer::simulate(b[i].getFaces(), 16).acmr();
+		EXPECT_LT(acmrA, acmrB * 0.5);
+	}
+}
+
+TEST(MultipartOptimizer, TestLods)
+{
+	// Each supermesh should have a chain of levels of detail, each with fewer
+	// faces than the one before, the same mapping entries, and an increasing
+	// error
+
+	auto handler = getHandler();
+	std::string database = DBMULTIPARTOPTIMIZERTEST;
+	std::string projectName = "TestLods";
+	auto revId = repo::lib::RepoUUID::createUUID();
+
+	auto sceneBuilder = repo::manipulator::modelutility::RepoSceneBuilder(handler, database, projectName, revId);
+
+	auto rootNode = repo::core::model::RepoBSONFactory::makeTransformationNode({}, "rootNode", {});
+	sceneBuilder.addNode(rootNode);
+	auto rootNodeId = rootNode.getSharedID();
+
+	const float pi = 3.14159265f;
+	for (int m = 0; m < 10; m++) {
+		const uint32_t n = 32;
+		std::vector<repo::lib::RepoVector3D> vertices;
+		std::vector<repo::lib::RepoVector3D> normals;
+		std::vector<repo::lib::repo_face_t> faces;
+		repo::lib::RepoBounds bounds;
+		for (uint32_t i = 0; i <= n; i++) {
+			for (uint32_t j = 0; j < 2 * n; j++) {
+				float theta = pi * i / n;
+				float phi = pi * j / n;
+				repo::lib::RepoVector3D normal(std::sin(theta) * std::cos(phi), std::sin(theta) * std::sin(phi), std::cos(theta));
+				vertices.push_back(normal + repo::lib::RepoVector3D(m * 3.0f, 0, 0));
+				normals.push_back(normal);
+				bounds.encapsulate(vertices.back());
+			}
+		}
+		for (uint32_t i = 0; i < n; i++) {
+			for (uint32_t j = 0; j < 2 * n; j++) {
+				auto a = i * 2 * n + j;
+				auto b = i * 2 * n + (j + 1) % (2 * n);
+				faces.push_back({ a, a + 2 * n, b + 2 * n });
+				faces.push_back({ a, b + 2 * n, b });
+			}
+		}
+		sceneBuilder.addNode(repo::core::model::RepoBSONFactory::makeMeshNode(vertices, faces, normals, bounds, {}, "", { rootNodeId }));
+	}
+
+	sceneBuilder.finalise();
+
+	MultipartOptimizer::LodOptions options;
+	options.numLevels = 3;
+	options.ratio = 0.25f;
+	options.maxError = 0.05f;
+
+	auto exporter = std::make_unique<TestModelExport>(handler.get(), database, projectName, revId, std::vector<double>({ 0, 0, 0 }));
+	exporter->setSupportsLods(true);
+	auto opt = MultipartOptimizer();
+	opt.setLodOptions(options);
+	EXPECT_TRUE(opt.processScene(database, projectName, revId, handler.get(), exporter.get()));
+
+	// The original geometry is unchanged
+
+	EXPECT_TRUE(compareMeshes(database, projectName, revId, exporter.get()));
+
+	auto supermeshes = exporter->getSupermeshes();
+	auto lods = exporter->getLods();
+	ASSERT_GT(lods.size(), 0);
+
+	for (const auto& supermesh : supermeshes) {
+		std::vector<repo::core::model::SupermeshNode> chain;
+		for (const auto& lod : lods) {
+			if (lod.getLodSource() == supermesh.getUniqueID()) {
+				chain.push_back(lod);
+			}
+		}
+		ASSERT_GT(chain.size(), 0);
+		ASSERT_LE(chain.size(), options.numLevels);
+
+		const repo::core::model::SupermeshNode* previous = &supermesh;
+		for (size_t level = 0; level < chain.size(); level++) {
+			const auto& lod = chain[level];
+			EXPECT_EQ(lod.getLodLevel(), level + 1);
+			EXPECT_GE(lod.getLodError(), previous->getLodError());
+			EXPECT_LT(lod.getNumFaces(), previous->getNumFaces());
+			EXPECT_GT(lod.getNumFaces(), 0);
+
+			auto mapping = lod.getMeshMapping();
+			auto originalMapping = supermesh.getMeshMapping();
+			ASSERT_EQ(mapping.size(), originalMapping.size());
+			for (size_t i = 0; i < mapping.size(); i++) {
+				EXPECT_EQ(mapping[i].mesh_id, originalMapping[i].mesh_id);
+				EXPECT_EQ(mapping[i].shared_id, originalMapping[i].shared_id);
+				EXPECT_LE((uint32_t)mapping[i].triTo, lod.getNumFaces());
+				EXPECT_LE((uint32_t)mapping[i].vertTo, lod.getNumVertices());
+			}
+
+			previous = &lod;
+		}
+	}
+
+	// Levels of detail are not built at all for exporters that don't support them
+
+	auto unsupported = std::make_unique<TestModelExport>(handler.get(), database, projectName, revId, std::vector<double>({ 0, 0, 0 }));
+	EXPECT_TRUE(opt.processScene(database, projectName, revId, handler.get(), unsupported.get()));
+	EXPECT_EQ(unsupported->getLodCallCount(), 0);
+	EXPECT_EQ(unsupported->getLods().size(), 0);
+	EXPECT_EQ(unsupported->getSupermeshCount(), exporter->getSupermeshCount());
+}
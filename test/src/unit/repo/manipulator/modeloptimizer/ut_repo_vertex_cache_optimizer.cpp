@@ -0,0 +1,315 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <repo/manipulator/modeloptimizer/repo_vertex_cache_optimizer.h>
+
+#include <algorithm>
+#include <map>
+#include <random>
+
+using namespace repo::manipulator::modeloptimizer;
+using namespace repo::lib;
+using namespace testing;
+
+struct TestMesh
+{
+	std::vector<RepoVector3D> vertices;
+	std::vector<RepoVector3D> normals;
+	std::vector<std::vector<RepoVector2D>> uvChannels;
+	std::vector<repo_face_t> faces;
+	std::vector<repo_mesh_mapping_t> mapping;
+};
+
+// Appends a regular grid of n by n quads as a submesh, with the faces shuffled,
+// as they might be after an import that doesn't preserve any order.
+
+static void appendGrid(TestMesh& mesh, int n, float offset, std::mt19937& rng)
+{
+	repo_mesh_mapping_t m = {};
+	m.vertFrom = mesh.vertices.size();
+	m.triFrom = mesh.faces.size();
+
+	for (int y = 0; y <= n; y++) {
+		for (int x = 0; x <= n; x++) {
+			mesh.vertices.push_back({ x + offset, (float)y, 0 });
+			mesh.normals.push_back({ 0, 0, 1 });
+		}
+	}
+	mesh.uvChannels.resize(1);
+	for (int y = 0; y <= n; y++) {
+		for (int x = 0; x <= n; x++) {
+			mesh.uvChannels[0].push_back({ (float)x / n, (float)y / n });
+		}
+	}
+
+	std::vector<repo_face_t> faces;
+	for (int y = 0; y < n; y++) {
+		for (int x = 0; x < n; x++) {
+			uint32_t i = m.vertFrom + y * (n + 1) + x;
+			faces.push_back({ i, i + 1, i + n + 2 });
+			faces.push_back({ i, i + n + 2, i + n + 1 });
+		}
+	}
+	std::shuffle(faces.begin(), faces.end(), rng);
+	mesh.faces.insert(mesh.faces.end(), faces.begin(), faces.end());
+
+	m.vertTo = mesh.vertices.size();
+	m.triTo = mesh.faces.size();
+	mesh.mapping.push_back(m);
+}
+
+// Returns each triangle of a submesh by the attributes of its vertices, in the
+// order they are referenced by the face, so the geometry can be compared
+// regardless of the order of the faces or vertices.
+
+static std::multiset<std::vector<float>> getTriangles(const TestMesh& mesh, const repo_mesh_mapping_t& m)
+{
+	std::multiset<std::vector<float>> triangles;
+	for (auto f = m.triFrom; f < m.triTo; f++) {
+		std::vector<float> t;
+		for (size_t i = 0; i < mesh.faces[f].size(); i++) {
+			auto v = mesh.faces[f][i];
+			t.insert(t.end(), { mesh.vertices[v].x, mesh.vertices[v].y, mesh.vertices[v].z });
+			t.insert(t.end(), { mesh.normals[v].x, mesh.normals[v].y, mesh.normals[v].z });
+			t.insert(t.end(), { mesh.uvChannels[0][v].x, mesh.uvChannels[0][v].y });
+		}
+		triangles.insert(t);
+	}
+	return triangles;
+}
+
+TEST(VertexCacheOptimizer, Simulate)
+{
+	std::vector<repo_face_t> faces = {
+		{ 0, 1, 2 },
+		{ 2, 1, 3 },
+		{ 4, 5, 6 },
+		{ 0, 1, 2 },
+	};
+
+	auto s = VertexCacheOptimizer::simulate(faces, 16, 0, 1);
+	EXPECT_THAT(s.numTransforms, Eq(3));
+	EXPECT_THAT(s.acmr(), DoubleEq(3));
+	EXPECT_THAT(s.atvr(), DoubleEq(1));
+
+	s = VertexCacheOptimizer::simulate(faces, 16, 0, 2);
+	EXPECT_THAT(s.numTransforms, Eq(4));
+	EXPECT_THAT(s.numVertices, Eq(4));
+
+	// With a cache of 4, the vertices of the first triangle will have been evicted
+	// by the time it is drawn again
+
+	s = VertexCacheOptimizer::simulate(faces, 16);
+	EXPECT_THAT(s.numTransforms, Eq(7));
+	EXPECT_THAT(s.numVertices, Eq(7));
+
+	s = VertexCacheOptimizer::simulate(faces, 4);
+	EXPECT_THAT(s.numTransforms, Eq(10));
+	EXPECT_THAT(s.atvr(), DoubleEq(10.0 / 7.0));
+
+	EXPECT_THAT(VertexCacheOptimizer::simulate({}, 16).acmr(), Eq(0));
+}
+
+TEST(VertexCacheOptimizer, ImprovesCacheEfficiency)
+{
+	std::mt19937 rng(1);
+	TestMesh mesh;
+	appendGrid(mesh, 64, 0, rng);
+
+	auto before = VertexCacheOptimizer::simulate(mesh.faces, 16);
+
+	VertexCacheOptimizer(16, 0).optimiseFaces(mesh.faces, 0, mesh.faces.size());
+
+	auto after = VertexCacheOptimizer::simulate(mesh.faces, 16);
+
+	// A shuffled grid transforms nearly every vertex of every triangle, where an
+	// ideal order would transform each vertex of the grid about once
+
+	EXPECT_THAT(before.acmr(), Gt(2.5));
+	EXPECT_THAT(after.acmr(), Lt(0.8));
+	EXPECT_THAT(after.atvr(), Lt(1.6));
+	EXPECT_THAT(after.numFaces, Eq(before.numFaces));
+}
+
+TEST(VertexCacheOptimizer, PreservesGeometryAndMapping)
+{
+	std::mt19937 rng(2);
+	TestMesh mesh;
+	appendGrid(mesh, 10, 0, rng);
+	appendGrid(mesh, 30, 100, rng);
+	appendGrid(mesh, 1, 200, rng);
+
+	std::vector<std::multiset<std::vector<float>>> triangles;
+	for (auto& m : mesh.mapping) {
+		triangles.push_back(getTriangles(mesh, m));
+	}
+	auto numVertices = mesh.vertices.size();
+	auto numFaces = mesh.faces.size();
+
+	VertexCacheOptimizer().optimise(mesh.vertices, mesh.normals, mesh.uvChannels, mesh.faces, mesh.mapping);
+
+	ASSERT_THAT(mesh.vertices.size(), Eq(numVertices));
+	ASSERT_THAT(mesh.normals.size(), Eq(numVertices));
+	ASSERT_THAT(mesh.uvChannels[0].size(), Eq(numVertices));
+	ASSERT_THAT(mesh.faces.size(), Eq(numFaces));
+
+	for (size_t i = 0; i < mesh.mapping.size(); i++) {
+		auto& m = mesh.mapping[i];
+
+		// Each submesh should still be drawn from its own ranges, with the same
+		// triangles as before
+
+		for (auto f = m.triFrom; f < m.triTo; f++) {
+			for (size_t j = 0; j < 3; j++) {
+				EXPECT_THAT(mesh.faces[f][j], AllOf(Ge(m.vertFrom), Lt(m.vertTo)));
+			}
+		}
+		EXPECT_THAT(getTriangles(mesh, m), Eq(triangles[i]));
+
+		// And the vertices should be in the order they are first used
+
+		uint32_t next = m.vertFrom;
+		for (auto f = m.triFrom; f < m.triTo; f++) {
+			for (size_t j = 0; j < 3; j++) {
+				EXPECT_THAT(mesh.faces[f][j], Le(next));
+				if (mesh.faces[f][j] == next) {
+					next++;
+				}
+			}
+		}
+		EXPECT_THAT(next, Eq(m.vertTo));
+	}
+}
+
+TEST(VertexCacheOptimizer, UnreferencedVertices)
+{
+	std::vector<repo_face_t> faces = {
+		{ 14, 12, 10 },
+		{ 12, 14, 13 },
+	};
+
+	auto remap = VertexCacheOptimizer::optimiseVertexFetch(faces, 0, faces.size(), 10, 16);
+
+	EXPECT_THAT(faces[0], Eq(repo_face_t({ 10, 11, 12 })));
+	EXPECT_THAT(faces[1], Eq(repo_face_t({ 11, 10, 13 })));
+
+	// Unused vertices are kept, after the used ones, in their original order
+
+	EXPECT_THAT(remap, ElementsAre(12, 14, 11, 13, 10, 15));
+}
+
+TEST(VertexCacheOptimizer, OtherPrimitives)
+{
+	// Lines are not reordered, but their vertices are
+
+	TestMesh mesh;
+	for (int i = 0; i < 5; i++) {
+		mesh.vertices.push_back({ (float)i, 0, 0 });
+	}
+	mesh.faces = { { 4, 3 }, { 3, 1 }, { 1, 0 } };
+	repo_mesh_mapping_t m = {};
+	m.vertFrom = 0;
+	m.vertTo = 5;
+	m.triFrom = 0;
+	m.triTo = 3;
+	mesh.mapping.push_back(m);
+
+	VertexCacheOptimizer().optimise(mesh.vertices, mesh.normals, mesh.uvChannels, mesh.faces, mesh.mapping);
+
+	EXPECT_THAT(mesh.faces, ElementsAre(repo_face_t({ 0, 1 }), repo_face_t({ 1, 2 }), repo_face_t({ 2, 3 })));
+	EXPECT_THAT(mesh.vertices, ElementsAre(
+		RepoVector3D(4, 0, 0),
+		RepoVector3D(3, 0, 0),
+		RepoVector3D(1, 0, 0),
+		RepoVector3D(0, 0, 0),
+		RepoVector3D(2, 0, 0)
+	));
+}
+
+TEST(VertexCacheOptimizer, InvalidMapping)
+{
+	// A submesh that references vertices of another must be left as it is
+
+	TestMesh mesh;
+	std::mt19937 rng(3);
+	appendGrid(mesh, 4, 0, rng);
+	mesh.faces[0][0] = mesh.vertices.size();
+	mesh.vertices.push_back({});
+	mesh.normals.push_back({});
+	mesh.uvChannels[0].push_back({});
+
+	auto original = mesh.faces;
+	VertexCacheOptimizer().optimise(mesh.vertices, mesh.normals, mesh.uvChannels, mesh.faces, mesh.mapping);
+	EXPECT_THAT(mesh.faces, Eq(original));
+
+	mesh.mapping[0].triTo = mesh.faces.size() + 1;
+	VertexCacheOptimizer().optimise(mesh.vertices, mesh.normals, mesh.uvChannels, mesh.faces, mesh.mapping);
+	EXPECT_THAT(mesh.faces, Eq(original));
+}
+
+TEST(VertexCacheOptimizer, OverdrawThreshold)
+{
+	// A closed box of grids, so there are clusters facing in all directions to
+	// sort. Whatever order the clusters end up in, the cache efficiency must stay
+	// within the threshold.
+
+	std::mt19937 rng(4);
+	std::vector<RepoVector3D> vertices;
+	std::vector<repo_face_t> faces;
+	const int n = 16;
+	for (int side = 0; side < 6; side++) {
+		auto base = vertices.size();
+		auto axis = side / 2;
+		float d = side % 2 ? n : 0;
+		for (int y = 0; y <= n; y++) {
+			for (int x = 0; x <= n; x++) {
+				float p[3];
+				p[axis] = d;
+				p[(axis + 1) % 3] = x;
+				p[(axis + 2) % 3] = y;
+				vertices.push_back({ p[0], p[1], p[2] });
+			}
+		}
+		for (int y = 0; y < n; y++) {
+			for (int x = 0; x < n; x++) {
+				uint32_t i = base + y * (n + 1) + x;
+				faces.push_back({ i, i + 1, i + n + 2 });
+				faces.push_back({ i, i + n + 2, i + n + 1 });
+			}
+		}
+	}
+	std::shuffle(faces.begin(), faces.end(), rng);
+
+	auto cacheOnly = faces;
+	VertexCacheOptimizer(16, 0).optimiseFaces(cacheOnly, 0, cacheOnly.size(), vertices);
+
+	auto withOverdraw = faces;
+	VertexCacheOptimizer(16, 1.05f).optimiseFaces(withOverdraw, 0, withOverdraw.size(), vertices);
+
+	auto a = VertexCacheOptimizer::simulate(cacheOnly, 16).acmr();
+	auto b = VertexCacheOptimizer::simulate(withOverdraw, 16).acmr();
+	EXPECT_THAT(b, Le(a * 1.05 + 1e-6));
+	EXPECT_THAT(withOverdraw, Ne(cacheOnly));
+
+	// The same triangles should be drawn either way
+
+	std::sort(cacheOnly.begin(), cacheOnly.end(), [](auto& x, auto& y) { return std::lexicographical_compare(x.indices, x.indices + 3, y.indices, y.indices + 3); });
+	std::sort(withOverdraw.begin(), withOverdraw.end(), [](auto& x, auto& y) { return std::lexicographical_compare(x.indices, x.indices + 3, y.indices, y.indices + 3); });
+	EXPECT_THAT(withOverdraw, Eq(cacheOnly));
+}
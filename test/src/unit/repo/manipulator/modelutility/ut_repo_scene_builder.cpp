@@ -0,0 +1,249 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <repo/core/handler/repo_database_handler_memory.h>
+#include <repo/core/handler/database/repo_query.h>
+#include <repo/core/handler/fileservice/repo_file_manager.h>
+#include <repo/core/model/bson/repo_bson_factory.h>
+#include <repo/core/model/bson/repo_node_mesh.h>
+#include <repo/core/model/bson/repo_node_texture.h>
+#include <repo/manipulator/modelutility/repo_scene_builder.h>
+#include <repo/manipulator/modelutility/repo_texture_processor.h>
+#include <repo/lib/repo_image.h>
+#include <test/src/unit/repo_test_mesh_utils.h>
+#include <test/src/unit/repo_test_database_info.h>
+
+#include <boost/filesystem.hpp>
+#include <fstream>
+
+using namespace repo::core::handler;
+using namespace repo::core::model;
+using namespace repo::manipulator::modelutility;
+using namespace repo::test::utils::mesh;
+using namespace testing;
+
+#define DBSCENEBUILDERTEST "sceneBuilderTest"
+
+static std::string makeTextureFile()
+{
+	auto path = boost::filesystem::temp_directory_path() / DBSCENEBUILDERTEST / "texture.png";
+	std::ofstream file(path.string(), std::ios::binary);
+	for (int i = 0; i < 1024; i++) {
+		file.put((char)i);
+	}
+	return path.string();
+}
+
+/*
+* Imports a scene where many meshes share a few materials, one of which has a
+* texture, and checks every document was written exactly once, with all its
+* parents.
+*/
+static void testSharedMaterials(size_t stagingThreshold)
+{
+	auto handler = getMemoryHandler(DBSCENEBUILDERTEST);
+	auto revId = repo::lib::RepoUUID::createUUID();
+	auto project = "SharedMaterials" + std::to_string(stagingThreshold);
+	auto texture = makeTextureFile();
+
+	std::vector<repo::lib::repo_material_t> materials(4, repo::lib::repo_material_t::DefaultMaterial());
+	for (size_t i = 0; i < materials.size(); i++) {
+		materials[i].diffuse = { i * 0.1f, 0.5f, 0.5f };
+	}
+	materials[3].texturePath = texture;
+
+	std::vector<repo::lib::RepoUUID> meshIds;
+	{
+		RepoSceneBuilder builder(handler, DBSCENEBUILDERTEST, project, revId);
+		builder.setStagingThreshold(stagingThreshold);
+
+		auto root = RepoBSONFactory::makeTransformationNode({}, "root", {});
+		builder.addNode(root);
+
+		for (int i = 0; i < 200; i++) {
+			auto mesh = createRandomMesh(30, true, 3, "", { root.getSharedID() });
+			mesh->setMaterial(materials[i % materials.size()]);
+			meshIds.push_back(mesh->getSharedID());
+			builder.addNode(std::move(mesh));
+		}
+
+		builder.finalise();
+	}
+
+	auto collection = project + "." + REPO_COLLECTION_SCENE;
+	auto documents = handler->getAllFromCollectionTailable(DBSCENEBUILDERTEST, collection);
+	EXPECT_THAT(documents.size(), Eq(1 + 200 + materials.size() + 1));
+
+	size_t numMaterials = 0, numTextures = 0;
+	for (auto& d : documents) {
+		auto id = d.getUUIDField(REPO_NODE_LABEL_ID);
+		EXPECT_THAT(handler->getNumWrites(DBSCENEBUILDERTEST, collection, id), Eq(1));
+
+		auto type = d.getStringField(REPO_NODE_LABEL_TYPE);
+		if (type == REPO_NODE_TYPE_MATERIAL) {
+			EXPECT_THAT(d.getUUIDFieldArray(REPO_NODE_LABEL_PARENTS).size(), Eq(200 / materials.size()));
+			numMaterials++;
+		}
+		else if (type == REPO_NODE_TYPE_TEXTURE) {
+			EXPECT_THAT(d.getUUIDFieldArray(REPO_NODE_LABEL_PARENTS).size(), Eq(1));
+			numTextures++;
+		}
+	}
+
+	EXPECT_THAT(numMaterials, Eq(materials.size()));
+	EXPECT_THAT(numTextures, Eq(1));
+}
+
+TEST(RepoSceneBuilderTest, SharedMaterialsWrittenOnce)
+{
+	testSharedMaterials(1024 * 1024 * 64);
+}
+
+TEST(RepoSceneBuilderTest, SharedMaterialsWrittenOnceFromStagingFile)
+{
+	// With no memory for staging, every material and texture node goes through
+	// the staging file
+
+	testSharedMaterials(0);
+}
+
+TEST(RepoSceneBuilderTest, DeferredIndexes)
+{
+	// The scene indexes are only created at finalise, which should not change
+	// what can be found afterwards. The history index is not deferred.
+
+	auto handler = getMemoryHandler(DBSCENEBUILDERTEST);
+	auto revId = repo::lib::RepoUUID::createUUID();
+	std::string project = "DeferredIndexes";
+
+	auto collection = project + "." + REPO_COLLECTION_SCENE;
+	auto history = project + "." + REPO_COLLECTION_HISTORY;
+
+	std::vector<repo::lib::RepoUUID> sharedIds;
+	{
+		RepoSceneBuilder builder(handler, DBSCENEBUILDERTEST, project, revId);
+		builder.createIndexes();
+		EXPECT_THAT(handler->getIndexes(DBSCENEBUILDERTEST, history), ElementsAre(REPO_NODE_REVISION_LABEL_TIMESTAMP));
+
+		auto root = RepoBSONFactory::makeTransformationNode({}, "root", {});
+		builder.addNode(root);
+		for (int i = 0; i < 100; i++) {
+			auto mesh = createRandomMesh(30, false, 3, "", { root.getSharedID() });
+			sharedIds.push_back(mesh->getSharedID());
+			builder.addNode(std::move(mesh));
+		}
+
+		EXPECT_THAT(handler->getIndexes(DBSCENEBUILDERTEST, collection), IsEmpty());
+
+		builder.finalise();
+	}
+
+	EXPECT_THAT(handler->getIndexes(DBSCENEBUILDERTEST, collection), ElementsAre("metadata.key", REPO_NODE_REVISION_ID, REPO_NODE_LABEL_SHARED_ID));
+
+	for (auto& id : sharedIds) {
+		auto found = handler->findAllByCriteria(DBSCENEBUILDERTEST, collection, repo::core::handler::database::query::Eq(REPO_NODE_LABEL_SHARED_ID, id));
+		EXPECT_THAT(found.size(), Eq(1));
+	}
+}
+
+TEST(RepoSceneBuilderTest, TextureProcessing)
+{
+	// Two texture files with the same content should share one node, and large
+	// textures should be scaled down and given mip levels
+
+	auto handler = getMemoryHandler(DBSCENEBUILDERTEST);
+	auto revId = repo::lib::RepoUUID::createUUID();
+	std::string project = "TextureProcessing";
+
+	repo::lib::RepoImage image(300, 100, 3);
+	for (size_t i = 0; i < image.getPixels().size(); i++) {
+		image.getPixels()[i] = (uint8_t)(i % 253);
+	}
+	auto png = image.encodePNG();
+
+	std::vector<std::string> paths;
+	for (auto name : { "a.png", "b.png" }) {
+		auto path = boost::filesystem::temp_directory_path() / DBSCENEBUILDERTEST / name;
+		std::ofstream file(path.string(), std::ios::binary);
+		file.write((const char*)png.data(), png.size());
+		paths.push_back(path.string());
+	}
+	paths.push_back(makeTextureFile()); // Not a real image, so stored as it is
+
+	std::vector<repo::lib::RepoUUID> meshIds;
+	{
+		RepoSceneBuilder builder(handler, DBSCENEBUILDERTEST, project, revId);
+		TextureProcessorOptions options;
+		options.maxDimension = 64;
+		options.generateMipLevels = true;
+		builder.setTextureProcessing(options);
+
+		auto root = RepoBSONFactory::makeTransformationNode({}, "root", {});
+		builder.addNode(root);
+
+		for (size_t i = 0; i < paths.size(); i++) {
+			auto material = repo::lib::repo_material_t::DefaultMaterial();
+			material.diffuse = { i * 0.1f, 0.5f, 0.5f };
+			material.texturePath = paths[i];
+			auto mesh = createRandomMesh(30, true, 3, "", { root.getSharedID() });
+			mesh->setMaterial(material);
+			meshIds.push_back(mesh->getSharedID());
+			builder.addNode(std::move(mesh));
+		}
+
+		builder.finalise();
+	}
+
+	auto collection = project + "." + REPO_COLLECTION_SCENE;
+	std::vector<TextureNode> textures;
+	std::unordered_map<repo::lib::RepoUUID, repo::lib::RepoUUID, repo::lib::RepoUUIDHasher> meshTextures;
+	for (auto& d : handler->getAllFromCollectionTailable(DBSCENEBUILDERTEST, collection)) {
+		auto type = d.getStringField(REPO_NODE_LABEL_TYPE);
+		if (type == REPO_NODE_TYPE_TEXTURE) {
+			textures.push_back(TextureNode(d));
+		}
+		else if (type == REPO_NODE_TYPE_MESH) {
+			MeshNode mesh(d);
+			meshTextures[mesh.getSharedID()] = mesh.getTextureId();
+		}
+	}
+
+	ASSERT_THAT(textures.size(), Eq(2));
+	EXPECT_THAT(meshTextures[meshIds[0]], Eq(meshTextures[meshIds[1]]));
+	EXPECT_THAT(meshTextures[meshIds[0]], Ne(meshTextures[meshIds[2]]));
+
+	for (auto& texture : textures) {
+		if (texture.getUniqueID() == meshTextures[meshIds[0]]) {
+			EXPECT_THAT(texture.getParentIDs().size(), Eq(2));
+			EXPECT_THAT(texture.getWidth(), Eq(64));
+			EXPECT_THAT(texture.getHeight(), Eq(21));
+			EXPECT_THAT(texture.getFileExtension(), Eq("png"));
+			EXPECT_THAT(texture.getMipLevels().size(), Eq(6));
+			auto decoded = repo::lib::RepoImage::decode(texture.getRawData());
+			ASSERT_TRUE(decoded.has_value());
+			EXPECT_THAT(decoded->getWidth(), Eq(64));
+		}
+		else {
+			EXPECT_THAT(texture.getParentIDs().size(), Eq(1));
+			EXPECT_THAT(texture.getRawData().size(), Eq(1024));
+			EXPECT_THAT(texture.getFileExtension(), Eq("png"));
+			EXPECT_THAT(texture.getMipLevels(), IsEmpty());
+		}
+	}
+}
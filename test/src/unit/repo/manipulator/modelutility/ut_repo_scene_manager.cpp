@@ -0,0 +1,147 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <repo/core/model/bson/repo_bson_factory.h>
+#include <repo/manipulator/modeloptimizer/repo_optimizer_multipart.h>
+#include <repo/manipulator/modelutility/repo_scene_builder.h>
+#include <repo/manipulator/modelutility/repo_scene_manager.h>
+
+#include "../../../repo_test_database_info.h"
+#include "../../../repo_test_mesh_utils.h"
+
+#include <fstream>
+#include <string>
+
+using namespace repo::core::model;
+using namespace repo::manipulator::modeloptimizer;
+using namespace repo::manipulator::modelutility;
+using namespace repo::test::utils::mesh;
+using namespace testing;
+
+#define DBSCENEMANAGERTEST "SceneManagerTest"
+
+#ifdef __linux__
+
+// Reads a size, in kB, from /proc/self/status, and returns it in bytes
+static size_t getStatusSize(const std::string& key)
+{
+	std::ifstream status("/proc/self/status");
+	std::string line;
+	while (std::getline(status, line)) {
+		if (line.rfind(key + ":", 0) == 0) {
+			return std::stoull(line.substr(key.size() + 1)) * 1024;
+		}
+	}
+	return 0;
+}
+
+// Resets the peak resident size (VmHWM) to the current resident size
+static bool resetPeakResidentSize()
+{
+	std::ofstream clearRefs("/proc/self/clear_refs");
+	clearRefs << "5";
+	clearRefs.close();
+	return !clearRefs.fail();
+}
+
+#endif
+
+namespace {
+
+	// Counts the supermeshes, but does not keep them, so the exporter does not
+	// add to the memory of the process
+
+	class DiscardingModelExport : public TestModelExport
+	{
+	public:
+		using TestModelExport::TestModelExport;
+
+		void addSupermesh(SupermeshNode* supermesh) override
+		{
+			numSupermeshes++;
+		}
+
+		int numSupermeshes = 0;
+	};
+}
+
+TEST(SceneManager, PeakResidentSize)
+{
+	// Stash and selection tree generation read the nodes from the database as
+	// they need them, so the resident size of the process should never grow by
+	// anything near the size of the scene.
+
+#ifndef __linux__
+	GTEST_SKIP() << "The peak resident size can only be measured on Linux";
+#else
+	auto handler = getHandler();
+	std::string database = DBSCENEMANAGERTEST;
+	std::string project = "PeakResidentSize";
+	auto revId = repo::lib::RepoUUID::createUUID();
+
+	size_t sceneSize = 0;
+	{
+		RepoSceneBuilder builder(handler, database, project, revId);
+		auto root = RepoBSONFactory::makeTransformationNode({}, "root", {});
+		builder.addNode(root);
+		for (int i = 0; i < 48; i++) {
+			auto mesh = createRandomMesh(100000, false, 3, "", { root.getSharedID() });
+			sceneSize += mesh->getSize();
+			builder.addNode(std::move(mesh));
+		}
+		builder.finalise();
+	}
+
+	handler->insertDocument(
+		database,
+		project + "." + REPO_COLLECTION_HISTORY,
+		RepoBSONFactory::makeRevisionNode("user", repo::lib::RepoUUID(REPO_HISTORY_MASTER_BRANCH), revId)
+	);
+
+	if (!resetPeakResidentSize()) {
+		GTEST_SKIP() << "The peak resident size cannot be reset on this kernel";
+	}
+
+	// Selection tree generation does not read the binaries at all
+
+	auto baseline = getStatusSize("VmRSS");
+	{
+		SceneManager manager;
+		std::unique_ptr<RepoScene> scene(manager.fetchScene(handler.get(), database, project, revId, false, false, true, {}, true));
+		ASSERT_TRUE(scene);
+		EXPECT_THAT(scene->getAllMeshes(RepoScene::GraphType::DEFAULT), IsEmpty());
+		EXPECT_TRUE(manager.generateAndCommitSelectionTree(scene.get(), handler.get()));
+	}
+	EXPECT_THAT(getStatusSize("VmHWM") - baseline, Lt(sceneSize / 8));
+
+	// The stash is built a supermesh at a time. With one thread, no more than a
+	// couple should be in memory at once, which is much less than the scene.
+
+	ASSERT_TRUE(resetPeakResidentSize());
+	baseline = getStatusSize("VmRSS");
+	{
+		DiscardingModelExport exporter(handler.get(), database, project, revId, { 0, 0, 0 });
+		MultipartOptimizer optimizer(1);
+		EXPECT_TRUE(optimizer.processScene(database, project, revId, handler.get(), &exporter));
+		EXPECT_THAT(exporter.numSupermeshes, Gt(1));
+	}
+	EXPECT_THAT(getStatusSize("VmHWM") - baseline, Lt(sceneSize / 2));
+#endif
+}
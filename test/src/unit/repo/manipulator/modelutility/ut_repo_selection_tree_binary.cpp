@@ -0,0 +1,180 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <repo/core/handler/repo_database_handler_memory.h>
+#include <repo/core/handler/fileservice/repo_file_manager.h>
+#include <repo/core/model/bson/repo_bson_factory.h>
+#include <repo/manipulator/modelutility/repo_scene_builder.h>
+#include <repo/manipulator/modelutility/repo_maker_selection_tree.h>
+#include <repo/manipulator/modelutility/repo_selection_tree_binary.h>
+#include <repo/lib/repo_exception.h>
+#include <test/src/unit/repo_test_mesh_utils.h>
+#include <test/src/unit/repo_test_database_info.h>
+
+// As in ut_repo_maker_selection_tree.cpp, keep our copy of rapidjson in its
+// own namespace
+
+#define RAPIDJSON_NAMESPACE repo::rapidjson
+#define RAPIDJSON_NAMESPACE_BEGIN namespace repo { namespace rapidjson {
+#define RAPIDJSON_NAMESPACE_END } }
+
+#include <repo/manipulator/modelutility/rapidjson/rapidjson.h>
+#include <repo/manipulator/modelutility/rapidjson/document.h>
+
+#include <boost/filesystem.hpp>
+
+using namespace repo::core::handler;
+using namespace repo::core::model;
+using namespace repo::manipulator::modelutility;
+using namespace repo::test::utils::mesh;
+using namespace testing;
+
+#define DBSELECTIONTREEBINARYTEST "selectionTreeBinaryTest"
+
+/*
+* Builds a tree of transformations and meshes, with metadata shared between
+* nodes, and some IFC spaces so that there are hidden nodes
+*/
+static void buildScene(std::shared_ptr<MemoryDatabaseHandler> handler, const std::string& project, const repo::lib::RepoUUID& revId)
+{
+	RepoSceneBuilder builder(handler, DBSELECTIONTREEBINARYTEST, project, revId);
+
+	auto root = RepoBSONFactory::makeTransformationNode({}, "root", {});
+	builder.addNode(root);
+
+	for (int i = 0; i < 10; i++) {
+		auto group = RepoBSONFactory::makeTransformationNode({}, "group" + std::to_string(i), { root.getSharedID() });
+		builder.addNode(group);
+
+		std::vector<repo::lib::RepoUUID> meshes;
+		for (int j = 0; j < 5; j++) {
+			auto mesh = createRandomMesh(10, false, 3, "", { group.getSharedID() });
+			mesh->changeName(j == 0 ? "Room (IFC Space)" : "");
+			meshes.push_back(mesh->getSharedID());
+			builder.addNode(std::move(mesh));
+		}
+
+		auto metadata = RepoBSONFactory::makeMetaDataNode({ "key" }, { std::string("value") }, "metadata", { group.getSharedID(), meshes[1] });
+		builder.addNode(metadata);
+	}
+
+	builder.finalise();
+}
+
+TEST(SelectionTreeBinary, RendersJson)
+{
+	auto handler = getMemoryHandler(DBSELECTIONTREEBINARYTEST);
+	auto revId = repo::lib::RepoUUID::createUUID();
+	std::string project = "RendersJson";
+	buildScene(handler, project, revId);
+
+	RepoScene scene(DBSELECTIONTREEBINARYTEST, project);
+	scene.setRevision(revId);
+
+	SelectionTreeMaker maker(&scene, handler.get());
+	auto files = maker.getSelectionTreeAsBuffer();
+	auto binary = maker.getSelectionTreeAsBinary();
+
+	SelectionTreeBinaryReader reader(binary);
+	EXPECT_THAT(reader.getNumNodes(), Eq(1 + 10 + 50));
+
+	// Every file the maker writes can be rendered from the binary, and is the
+	// same document, though the members of objects keyed by id may be in a
+	// different order
+
+	auto names = reader.getJsonNames();
+	EXPECT_THAT(names.size(), Eq(files.size()));
+	for (const auto& name : names) {
+		ASSERT_THAT(files.count(name), Eq(1));
+
+		repo::rapidjson::Document expected;
+		expected.Parse((const char*)files[name].data(), files[name].size());
+
+		auto json = reader.renderJson(name);
+		repo::rapidjson::Document actual;
+		actual.Parse(json.c_str());
+
+		EXPECT_FALSE(actual.HasParseError());
+		EXPECT_TRUE(actual == expected) << name;
+	}
+
+	EXPECT_THROW(reader.renderJson("unknown.json"), repo::lib::RepoException);
+
+	// The binary should be much smaller
+
+	size_t jsonSize = 0;
+	for (const auto& file : files) {
+		jsonSize += file.second.size();
+	}
+	EXPECT_THAT(binary.size() * 4, Lt(jsonSize));
+}
+
+TEST(SelectionTreeBinary, Accessors)
+{
+	auto handler = getMemoryHandler(DBSELECTIONTREEBINARYTEST);
+	auto revId = repo::lib::RepoUUID::createUUID();
+	std::string project = "Accessors";
+	buildScene(handler, project, revId);
+
+	RepoScene scene(DBSELECTIONTREEBINARYTEST, project);
+	scene.setRevision(revId);
+
+	SelectionTreeBinaryReader reader(SelectionTreeMaker(&scene, handler.get()).getSelectionTreeAsBinary());
+
+	EXPECT_THAT(reader.getName(0), Eq("root"));
+	EXPECT_THAT(reader.getParent(0), Eq(SelectionTreeBinaryReader::NO_PARENT));
+	EXPECT_THAT(reader.getChildren(0).size(), Eq(10));
+	EXPECT_THAT(reader.getMeshes(0).size(), Eq(50));
+	EXPECT_THAT(reader.getToggleState(0), Eq(SelectionTree::Node::ToggleState::HALF_HIDDEN));
+
+	for (auto group : reader.getChildren(0)) {
+		EXPECT_THAT(reader.getType(group), Eq(NodeType::TRANSFORMATION));
+		EXPECT_THAT(reader.getMeshes(group).size(), Eq(5));
+
+		auto path = reader.getPath(group);
+		ASSERT_THAT(path.size(), Eq(2));
+		EXPECT_THAT(path[0], Eq(reader.getUniqueId(0)));
+		EXPECT_THAT(path[1], Eq(reader.getUniqueId(group)));
+
+		for (auto mesh : reader.getChildren(group)) {
+			EXPECT_THAT(reader.getType(mesh), Eq(NodeType::MESH));
+			EXPECT_THAT(reader.getMeshes(mesh), ElementsAre(reader.getUniqueId(mesh)));
+		}
+	}
+}
+
+TEST(SelectionTreeBinary, Invalid)
+{
+	std::vector<uint8_t> bad = { 1, 2, 3, 4, 5, 6, 7, 8 };
+	EXPECT_THROW(SelectionTreeBinaryReader{ bad }, repo::lib::RepoException);
+	EXPECT_THROW(SelectionTreeBinaryReader{ std::vector<uint8_t>() }, repo::lib::RepoException);
+
+	SelectionTreesSet trees;
+	SelectionTree::Node node;
+	node._id = repo::lib::RepoUUID::createUUID();
+	node.shared_id = repo::lib::RepoUUID::createUUID();
+	trees.fullTree.nodes.push_back(node);
+	trees.fullTree.root = &trees.fullTree.nodes[0];
+
+	auto binary = serialiseSelectionTreesToBinary(trees);
+	EXPECT_NO_THROW(SelectionTreeBinaryReader{ binary });
+
+	binary.resize(binary.size() - 1);
+	EXPECT_THROW(SelectionTreeBinaryReader{ binary }, repo::lib::RepoException);
+}
@@ -0,0 +1,135 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <repo/manipulator/modelutility/repo_sequence_cache.h>
+#include <repo/lib/repo_exception.h>
+
+using namespace repo::manipulator::modelutility;
+using namespace testing;
+
+static std::vector<SequenceFrameState> makeFrames(size_t numFrames)
+{
+	std::vector<repo::lib::RepoUUID> ids;
+	for (int i = 0; i < 50; i++) {
+		ids.push_back(repo::lib::RepoUUID::createUUID());
+	}
+
+	// Each frame changes a few properties of the previous one, in the same way
+	// as an animation would
+
+	std::vector<SequenceFrameState> frames;
+	SequenceFrameState state;
+	for (size_t f = 0; f < numFrames; f++) {
+		state.timestamp = f * 1000;
+		state.transparency[ids[f % 50]] = f * 0.001f;
+		if (f % 7 == 0) {
+			state.transparency.erase(ids[(f + 3) % 50]);
+		}
+		state.colour[ids[f % 13]] = { f * 0.1f, 0.5f, 1.0f };
+		state.transformation[ids[f % 11]] = std::vector<double>(16, (double)f);
+		if (f % 100 == 0) {
+			state.clip[ids[3]] = { { 1, 2, (double)f }, { 0, 0, 1 } };
+		}
+		if (f == numFrames / 2) {
+			state.camera = SequenceFrameState::Camera{ { 1, 2, 3 }, { 0, 0, 1 }, { 0, 1, 0 }, 0.5f, true };
+		}
+		frames.push_back(state);
+	}
+	return frames;
+}
+
+TEST(SequenceCache, RoundTrip)
+{
+	auto frames = makeFrames(1000);
+
+	// Small files and multiple threads, so frames are split across files and
+	// batches are encoded in parallel
+
+	SequenceCacheWriter writer(16, 4096, 4);
+	for (const auto& frame : frames) {
+		writer.addFrame(frame);
+	}
+	auto files = writer.finalise();
+
+	EXPECT_THAT(writer.getNumFrames(), Eq(frames.size()));
+	EXPECT_THAT(files.size(), Gt(2));
+	ASSERT_THAT(files.count(writer.getIndexName()), Eq(1));
+
+	SequenceCacheReader reader(files[writer.getIndexName()], [&](const std::string& name) {
+		return files.at(name);
+	});
+
+	ASSERT_THAT(reader.getNumFrames(), Eq(frames.size()));
+	for (size_t i = 0; i < frames.size(); i++) {
+		EXPECT_THAT(reader.getTimestamp(i), Eq(frames[i].timestamp));
+		EXPECT_THAT(reader.getFrame(i) == frames[i], IsTrue());
+		EXPECT_THAT(files[writer.getFileName(i)].size(), Gt(0));
+	}
+
+	// Frames can be read in any order
+
+	EXPECT_THAT(reader.getFrame(537) == frames[537], IsTrue());
+	EXPECT_THAT(reader.getFrame(3) == frames[3], IsTrue());
+	EXPECT_THROW(reader.getFrame(frames.size()), repo::lib::RepoException);
+}
+
+TEST(SequenceCache, Compact)
+{
+	// As each frame only changes a few entries, the delta encoded cache should
+	// be considerably smaller than writing out each state in full
+
+	auto frames = makeFrames(1000);
+
+	SequenceCacheWriter delta(64);
+	SequenceCacheWriter full(1);
+	for (const auto& frame : frames) {
+		delta.addFrame(frame);
+		full.addFrame(frame);
+	}
+
+	size_t deltaSize = 0, fullSize = 0;
+	for (auto& f : delta.finalise()) {
+		deltaSize += f.second.size();
+	}
+	for (auto& f : full.finalise()) {
+		fullSize += f.second.size();
+	}
+
+	EXPECT_THAT(deltaSize * 4, Lt(fullSize));
+}
+
+TEST(SequenceCache, Empty)
+{
+	SequenceCacheWriter writer;
+	writer.addFrame({});
+	auto files = writer.finalise();
+
+	SequenceCacheReader reader(files[writer.getIndexName()], [&](const std::string& name) {
+		return files.at(name);
+	});
+	ASSERT_THAT(reader.getNumFrames(), Eq(1));
+	EXPECT_THAT(reader.getFrame(0) == SequenceFrameState(), IsTrue());
+}
+
+TEST(SequenceCache, InvalidIndex)
+{
+	std::vector<uint8_t> bad = { 1, 2, 3, 4, 5, 6, 7, 8 };
+	EXPECT_THROW(SequenceCacheReader(bad, [](const std::string&) { return std::vector<uint8_t>(); }), repo::lib::RepoException);
+	EXPECT_THROW(SequenceCacheReader({}, [](const std::string&) { return std::vector<uint8_t>(); }), repo::lib::RepoException);
+}
@@ -0,0 +1,97 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <repo/manipulator/modelutility/repo_sequence_frame_serialiser.h>
+
+using namespace repo::manipulator::modelutility;
+using namespace testing;
+
+static std::vector<SequenceFrameSnapshot> makeSnapshots(size_t numFrames)
+{
+	std::vector<repo::lib::RepoUUID> ids;
+	for (int i = 0; i < 50; i++) {
+		ids.push_back(repo::lib::RepoUUID::createUUID());
+	}
+
+	std::vector<SequenceFrameSnapshot> snapshots;
+	for (size_t f = 0; f < numFrames; f++) {
+		SequenceFrameSnapshot snapshot;
+		snapshot.transparency.push_back({ f * 0.001f, { ids[f % 50].toString(), ids[(f + 1) % 50].toString() } });
+		snapshot.colour.push_back({ { f * 0.1f, 0.5f, 1.0f }, { ids[f % 13] } });
+		if (f % 3 == 0) {
+			snapshot.transformation.push_back({ std::vector<double>(16, (double)f), { ids[f % 11], ids[(f + 5) % 11] } });
+		}
+		if (f % 100 == 0) {
+			snapshot.clip.push_back({ ids[3], { { 1, 2, (double)f }, { 0, 0, 1 } } });
+		}
+		if (f % 10 == 0) {
+			snapshot.camera = SequenceFrameState::Camera{ { 1, 2, 3 }, { 0, 0, 1 }, { 0, 1, 0 }, 0.5f, true };
+		}
+		snapshots.push_back(snapshot);
+	}
+	return snapshots;
+}
+
+TEST(SequenceFrameSerialiser, Document)
+{
+	auto id = repo::lib::RepoUUID::createUUID();
+
+	SequenceFrameSnapshot snapshot;
+	snapshot.colour.push_back({ { 1, 0, 0 }, { id } });
+	snapshot.camera = SequenceFrameState::Camera{ { 1, 2, 3 }, { 0, 0, 1 }, { 0, 1, 0 }, 0.5f, false };
+
+	auto document = serialiseSequenceFrame(snapshot);
+	std::string json(document.begin(), document.end());
+
+	EXPECT_THAT(json, HasSubstr("\"color\""));
+	EXPECT_THAT(json, HasSubstr(id.toString()));
+	EXPECT_THAT(json, HasSubstr("\"camera\""));
+	EXPECT_THAT(json, Not(HasSubstr("\"transparency\"")));
+	EXPECT_THAT(json, Not(HasSubstr("\"clip\"")));
+}
+
+TEST(SequenceFrameSerialiser, MatchesSequential)
+{
+	// Documents written by the pool must be identical to, and in the same order
+	// as, those written one at a time. A small queue makes the importer wait on
+	// the workers, as it would with a large sequence.
+
+	auto snapshots = makeSnapshots(1000);
+
+	std::vector<std::vector<uint8_t>> expected;
+	for (const auto& snapshot : snapshots) {
+		expected.push_back(serialiseSequenceFrame(snapshot));
+	}
+
+	for (size_t threads : { 1, 4 }) {
+		SequenceFrameSerialiser serialiser(threads, 2);
+		for (size_t i = 0; i < snapshots.size(); i++) {
+			auto copy = snapshots[i];
+			EXPECT_THAT(serialiser.addFrame(std::move(copy)), Eq(i));
+		}
+		auto documents = serialiser.finalise();
+		EXPECT_THAT(documents, ElementsAreArray(expected));
+	}
+}
+
+TEST(SequenceFrameSerialiser, Empty)
+{
+	SequenceFrameSerialiser serialiser;
+	EXPECT_THAT(serialiser.finalise(), IsEmpty());
+}
@@ -0,0 +1,219 @@
+/**
+*  Copyright (C) 2025 3D Repo Ltd
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU Affero General Public License as
+*  published by the Free Software Foundation, either version 3 of the
+*  License, or (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Affero General Public License for more details.
+*
+*  You should have received a copy of the GNU Affero General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <repo/manipulator/modelutility/repo_texture_processor.h>
+#include <repo/lib/repo_image.h>
+#include <repo/lib/repo_exception.h>
+#include <repo/lib/repo_memory_accounting.h>
+
+#include <set>
+#include <thread>
+
+using namespace repo::manipulator::modelutility;
+using namespace testing;
+
+static repo::lib::RepoImage makeImage(uint32_t width, uint32_t height, int seed = 0)
+{
+	repo::lib::RepoImage image(width, height, 3);
+	auto& pixels = image.getPixels();
+	for (size_t i = 0; i < pixels.size(); i++) {
+		pixels[i] = (uint8_t)((i * 7 + seed) % 251);
+	}
+	return image;
+}
+
+TEST(TextureProcessor, Downscale)
+{
+	TextureProcessorOptions options;
+	options.maxDimension = 64;
+	TextureProcessor processor(options);
+
+	auto hash = processor.submit(makeImage(300, 200).encodePNG());
+	auto texture = processor.get(hash);
+
+	EXPECT_THAT(texture->width, Eq(64));
+	EXPECT_THAT(texture->height, Eq(43));
+	EXPECT_THAT(texture->extension, Eq("png"));
+	EXPECT_THAT(texture->mipLevels, IsEmpty());
+
+	auto decoded = repo::lib::RepoImage::decode(texture->data);
+	ASSERT_TRUE(decoded.has_value());
+	EXPECT_THAT(decoded->getWidth(), Eq(64));
+	EXPECT_THAT(decoded->getHeight(), Eq(43));
+}
+
+TEST(TextureProcessor, MipLevels)
+{
+	TextureProcessorOptions options;
+	options.generateMipLevels = true;
+	TextureProcessor processor(options);
+
+	auto texture = processor.get(processor.submit(makeImage(16, 8).encodePNG()));
+
+	ASSERT_THAT(texture->mipLevels.size(), Eq(4));
+	for (auto& level : texture->mipLevels) {
+		auto decoded = repo::lib::RepoImage::decode(level.data);
+		ASSERT_TRUE(decoded.has_value());
+		EXPECT_THAT(decoded->getWidth(), Eq(level.width));
+		EXPECT_THAT(decoded->getHeight(), Eq(level.height));
+	}
+	EXPECT_THAT(texture->mipLevels.back().width, Eq(1));
+	EXPECT_THAT(texture->mipLevels.back().height, Eq(1));
+}
+
+TEST(TextureProcessor, IdenticalContent)
+{
+	TextureProcessor processor;
+
+	auto png = makeImage(32, 32).encodePNG();
+	auto a = processor.submit(png);
+	auto b = processor.submit(png);
+	auto c = processor.submit(makeImage(32, 32, 1).encodePNG());
+
+	EXPECT_THAT(a, Eq(b));
+	EXPECT_THAT(a, Ne(c));
+	EXPECT_THAT(processor.get(a), Eq(processor.get(b)));
+	EXPECT_THROW(processor.get("unknown"), repo::lib::RepoException);
+}
+
+TEST(TextureProcessor, Recompress)
+{
+	// Uncompressed formats are re-encoded as PNG, but images that are not
+	// resized keep their original encoding if PNG would not be smaller
+
+	auto image = makeImage(100, 100);
+	std::string ppm = "P6\n100 100\n255\n";
+	std::vector<uint8_t> file(ppm.begin(), ppm.end());
+	file.insert(file.end(), image.getPixels().begin(), image.getPixels().end());
+
+	TextureProcessor processor;
+	auto texture = processor.get(processor.submit(file));
+	EXPECT_THAT(texture->extension, Eq("png"));
+	EXPECT_THAT(texture->data.size(), Lt(file.size()));
+
+	auto png = image.encodePNG(9);
+	texture = processor.get(processor.submit(png));
+	EXPECT_THAT(texture->extension, IsEmpty());
+	EXPECT_THAT(texture->data, Eq(png));
+
+	TextureProcessorOptions options;
+	options.recompress = false;
+	TextureProcessor keep(options);
+	texture = keep.get(keep.submit(file));
+	EXPECT_THAT(texture->extension, IsEmpty());
+	EXPECT_THAT(texture->data, Eq(file));
+}
+
+TEST(TextureProcessor, Undecodable)
+{
+	// Images that cannot be decoded, because they are in an unsupported format
+	// or are corrupt, are stored as they are
+
+	TextureProcessorOptions options;
+	options.maxDimension = 16;
+	options.generateMipLevels = true;
+	TextureProcessor processor(options);
+
+	std::vector<uint8_t> jpeg = { 0xFF, 0xD8, 0xFF, 0xE0, 0, 16, 'J', 'F', 'I', 'F', 0 };
+	auto png = makeImage(64, 64).encodePNG();
+	png.resize(png.size() / 2);
+
+	for (auto& data : { jpeg, png }) {
+		auto texture = processor.get(processor.submit(data));
+		EXPECT_THAT(texture->data, Eq(data));
+		EXPECT_THAT(texture->width, Eq(0));
+		EXPECT_THAT(texture->extension, IsEmpty());
+		EXPECT_THAT(texture->mipLevels, IsEmpty());
+	}
+}
+
+TEST(TextureProcessor, Threads)
+{
+	// The results are the same however many threads the images are processed on
+
+	TextureProcessorOptions options;
+	options.maxDimension = 50;
+	options.generateMipLevels = true;
+
+	std::vector<std::vector<uint8_t>> files;
+	for (int i = 0; i < 20; i++) {
+		files.push_back(makeImage(120 + i, 80, i).encodePNG());
+	}
+
+	auto expected = TextureProcessor::process(files[7], options);
+	for (size_t numThreads : { 1, 4 }) {
+		options.numThreads = numThreads;
+		TextureProcessor processor(options);
+		std::vector<std::string> hashes;
+		for (auto& f : files) {
+			hashes.push_back(processor.submit(f));
+		}
+		auto texture = processor.get(hashes[7]);
+		EXPECT_THAT(texture->data, Eq(expected.data));
+		EXPECT_THAT(texture->mipLevels, Eq(expected.mipLevels));
+		for (auto& h : hashes) {
+			EXPECT_THAT(processor.get(h)->width, Eq(50));
+		}
+	}
+}
+
+TEST(TextureProcessor, Take)
+{
+	TextureProcessor processor;
+
+	std::set<std::string> hashes;
+	for (int i = 0; i < 4; i++) {
+		hashes.insert(processor.submit(makeImage(32, 32, i).encodePNG()));
+	}
+
+	// Every image is eventually reported as completed, exactly once
+
+	std::set<std::string> completed;
+	while (completed.size() < hashes.size()) {
+		for (auto& h : processor.takeCompleted()) {
+			EXPECT_TRUE(completed.insert(h).second);
+		}
+		std::this_thread::yield();
+	}
+	EXPECT_THAT(completed, Eq(hashes));
+	EXPECT_THAT(processor.takeCompleted(), IsEmpty());
+
+	// A result can be taken only once
+
+	auto hash = *hashes.begin();
+	auto texture = processor.take(hash);
+	EXPECT_THAT(texture->width, Eq(32));
+	EXPECT_THROW(processor.take(hash), repo::lib::RepoException);
+	EXPECT_THROW(processor.get(hash), repo::lib::RepoException);
+}
+
+TEST(TextureProcessor, MemoryAccounting)
+{
+	// The images are counted under the texture tag until the results are freed
+
+	using repo::lib::RepoMemoryAccounting;
+
+	auto before = RepoMemoryAccounting::getCurrent(RepoMemoryAccounting::Tag::TEXTURE);
+	{
+		TextureProcessor processor;
+		auto texture = processor.take(processor.submit(makeImage(64, 64).encodePNG()));
+		EXPECT_THAT(RepoMemoryAccounting::getCurrent(RepoMemoryAccounting::Tag::TEXTURE), Ge(before + texture->data.size()));
+	}
+	EXPECT_THAT(RepoMemoryAccounting::getCurrent(RepoMemoryAccounting::Tag::TEXTURE), Eq(before));
+}
@@ -40,6 +40,19 @@ std::shared_ptr<repo::core::handler::MongoDatabaseHandler> getHandler()
 	return handler;
 }
 
+std::shared_ptr<repo::core::handler::MemoryDatabaseHandler> getMemoryHandler(
+	const std::string& fileShareName,
+	const std::string& path)
+{
+	auto handler = repo::core::handler::MemoryDatabaseHandler::getHandler(path);
+	auto config = getConfig();
+	auto dir = boost::filesystem::temp_directory_path() / fileShareName;
+	boost::filesystem::create_directories(dir);
+	config.configureFS(dir.string());
+	handler->setFileManager(std::make_shared<repo::core::handler::fileservice::FileManager>(config, handler));
+	return handler;
+}
+
 std::string getClientExePath()
 {
 	char* pathChr = getenv("REPO_CLIENT_PATH");
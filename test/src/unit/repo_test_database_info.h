@@ -17,6 +17,7 @@
 
 #pragma once
 #include <repo/core/handler/repo_database_handler_mongo.h>
+#include <repo/core/handler/repo_database_handler_memory.h>
 #include <repo/core/handler/fileservice/repo_file_manager.h>
 #include <repo/lib/datastructure/repo_vector.h>
 #include <repo/lib/datastructure/repo_bounds.h>
@@ -156,6 +157,15 @@ std::string getDataPath(const std::string& file);
 
 std::shared_ptr<repo::core::handler::MongoDatabaseHandler> getHandler();
 
+/*
+* Returns a MemoryDatabaseHandler with a FileManager that writes to a directory
+* of the given name in the temporary directory. Without a path, the handler is
+* a new, empty instance; with one, it is loaded from and persisted to the file.
+*/
+std::shared_ptr<repo::core::handler::MemoryDatabaseHandler> getMemoryHandler(
+	const std::string& fileShareName,
+	const std::string& path = std::string());
+
 repo::lib::RepoBounds getGoldenDataForBBoxTest();
 
 /*
@@ -114,6 +114,40 @@ namespace repo {
 						supermeshNodes.push_back(*supermesh);
 					}
 
+					bool supportsExistingSupermeshes() const {
+						return reuseSupermeshes;
+					}
+
+					bool addExistingSupermesh(
+						const repo::lib::RepoUUID& revId,
+						const repo::lib::RepoUUID& supermeshId,
+						const std::vector<repo::lib::repo_mesh_mapping_t>& mapping)
+					{
+						if (reuseSupermeshes) {
+							existingSupermeshes.push_back(mapping);
+						}
+						return reuseSupermeshes;
+					}
+
+					void setReuseSupermeshes(bool reuse) {
+						reuseSupermeshes = reuse;
+					}
+
+					bool supportsLods() const
+					{
+						return lodsSupported;
+					}
+
+					void addSupermeshLod(repo::core::model::SupermeshNode* lod)
+					{
+						numLodCalls++;
+						lodNodes.push_back(*lod);
+					}
+
+					void setSupportsLods(bool supports) {
+						lodsSupported = supports;
+					}
+
 					void finalise() {
 						finalised = true;
 						// Do nothing else
@@ -131,9 +165,34 @@ namespace repo {
 						return supermeshNodes.size();
 					};
 
+					/*
+					* The mappings passed to addExistingSupermesh, for supermeshes reused from
+					* previous revisions.
+					*/
+					std::vector<std::vector<repo::lib::repo_mesh_mapping_t>> getExistingSupermeshes() {
+						return existingSupermeshes;
+					};
+
+					/*
+					* The levels of detail passed to addSupermeshLod, and the number of
+					* times it was called.
+					*/
+					std::vector<repo::core::model::SupermeshNode> getLods() {
+						return lodNodes;
+					};
+
+					int getLodCallCount() {
+						return numLodCalls;
+					};
+
 				private:
 					bool finalised = false;
+					bool reuseSupermeshes = false;
+					bool lodsSupported = false;
+					int numLodCalls = 0;
 					std::vector<repo::core::model::SupermeshNode> supermeshNodes;
+					std::vector<repo::core::model::SupermeshNode> lodNodes;
+					std::vector<std::vector<repo::lib::repo_mesh_mapping_t>> existingSupermeshes;
 				};
 
 				/**
@@ -3,6 +3,7 @@ import os
 srcDir='bouncer/src'
 testDir='test/src'
 clientDir='client/src'
+benchDir='bench/src'
 
 
 def printHeaderForCMakeFiles(file):
@@ -85,3 +86,6 @@ for dir, subDirList, fl in os.walk(testDir):
 
 for dir, subDirList, fl in os.walk(clientDir):
 	createCMakeList(dir, fl, subDirList, "CLIENT_SOURCES", "CLIENT_HEADERS")
+
+for dir, subDirList, fl in os.walk(benchDir):
+	createCMakeList(dir, fl, subDirList, "BENCH_SOURCES", "BENCH_HEADERS")